@@ -1319,6 +1319,9 @@ const char *OBSApp::GetRenderModule() const
 	const char *renderer =
 		config_get_string(globalConfig, "Video", "Renderer");
 
+	if (astrcmpi(renderer, "Software") == 0 && *DL_SOFTWARE)
+		return DL_SOFTWARE;
+
 	return (astrcmpi(renderer, "Direct3D 11") == 0) ? DL_D3D11 : DL_OPENGL;
 }
 
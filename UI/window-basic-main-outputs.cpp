@@ -1186,6 +1186,19 @@ static void ApplyEncoderDefaults(OBSData &settings,
 	settings = std::move(dataRet);
 }
 
+/* "native" or "swscale", only in basic.ini, the default lets libobs pick */
+static enum video_scaler_impl GetRescaleScaler(config_t *config)
+{
+	const char *scaler =
+		config_get_string(config, "AdvOut", "RescaleScaler");
+
+	if (scaler && astrcmpi(scaler, "native") == 0)
+		return VIDEO_SCALER_IMPL_NATIVE;
+	if (scaler && astrcmpi(scaler, "swscale") == 0)
+		return VIDEO_SCALER_IMPL_SWSCALE;
+	return VIDEO_SCALER_IMPL_AUTO;
+}
+
 #define ADV_ARCHIVE_NAME "adv_archive_aac"
 
 #ifdef __APPLE__
@@ -1405,6 +1418,7 @@ inline void AdvancedOutput::SetupStreaming()
 
 	obs_output_set_audio_encoder(streamOutput, streamAudioEnc, 0);
 	obs_encoder_set_scaled_size(h264Streaming, cx, cy);
+	obs_encoder_set_scaler(h264Streaming, GetRescaleScaler(main->Config()));
 	obs_encoder_set_video(h264Streaming, obs_get_video());
 
 	const char *id = obs_service_get_id(main->GetService());
@@ -1460,6 +1474,8 @@ inline void AdvancedOutput::SetupRecording()
 		}
 
 		obs_encoder_set_scaled_size(h264Recording, cx, cy);
+		obs_encoder_set_scaler(h264Recording,
+				       GetRescaleScaler(main->Config()));
 		obs_encoder_set_video(h264Recording, obs_get_video());
 		obs_output_set_video_encoder(fileOutput, h264Recording);
 		if (replayBuffer)
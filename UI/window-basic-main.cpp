@@ -1785,6 +1785,8 @@ void OBSBasic::OBSInit()
 #endif
 
 	AddExtraModulePaths();
+	obs_set_lazy_module_loading(config_get_bool(
+		GetGlobalConfig(), "General", "LazyModuleLoading"));
 	blog(LOG_INFO, "---------------------------------");
 	obs_load_all_modules();
 	blog(LOG_INFO, "---------------------------------");
@@ -4208,6 +4210,9 @@ int OBSBasic::ResetVideo()
 				ovi.base_height);
 	}
 
+	obs_set_video_zero_copy(config_get_bool(GetGlobalConfig(), "Video",
+						"ZeroCopyReadback"));
+
 	ret = AttemptToResetVideo(&ovi);
 	if (IS_WIN32 && ret != OBS_VIDEO_SUCCESS) {
 		if (ret == OBS_VIDEO_CURRENTLY_ACTIVE) {
@@ -620,8 +620,14 @@ OBSBasicSettings::OBSBasicSettings(QWidget *parent)
 		ui->processPriority->addItem(QTStr(pri.name), pri.val);
 
 #else
-	delete ui->rendererLabel;
-	delete ui->renderer;
+	// OpenGL is the only GPU renderer, so there's only a choice when the
+	// software renderer is available
+	if (!*DL_SOFTWARE) {
+		delete ui->rendererLabel;
+		delete ui->renderer;
+		ui->rendererLabel = nullptr;
+		ui->renderer = nullptr;
+	}
 	delete ui->adapterLabel;
 	delete ui->adapter;
 	delete ui->processPriorityLabel;
@@ -636,8 +642,6 @@ OBSBasicSettings::OBSBasicSettings(QWidget *parent)
 #if defined(__APPLE__) || HAVE_PULSEAUDIO
 	delete ui->disableAudioDucking;
 #endif
-	ui->rendererLabel = nullptr;
-	ui->renderer = nullptr;
 	ui->adapterLabel = nullptr;
 	ui->adapter = nullptr;
 	ui->processPriorityLabel = nullptr;
@@ -1371,18 +1375,32 @@ void OBSBasicSettings::LoadGeneralSettings()
 
 void OBSBasicSettings::LoadRendererList()
 {
-#ifdef _WIN32
+	if (!ui->renderer)
+		return;
+
 	const char *renderer =
 		config_get_string(GetGlobalConfig(), "Video", "Renderer");
 
-	ui->renderer->addItem(QT_UTF8("Direct3D 11"));
+#ifdef _WIN32
+	ui->renderer->addItem(QT_UTF8("Direct3D 11"), "Direct3D 11");
 	if (opt_allow_opengl || strcmp(renderer, "OpenGL") == 0)
-		ui->renderer->addItem(QT_UTF8("OpenGL"));
+		ui->renderer->addItem(QT_UTF8("OpenGL"), "OpenGL");
+#else
+	ui->renderer->addItem(QT_UTF8("OpenGL"), "OpenGL");
+#endif
 
-	int idx = ui->renderer->findText(QT_UTF8(renderer));
+	// renders on the CPU, labelled so that it isn't mistaken for a
+	// faster alternative to the GPU renderers
+	if (*DL_SOFTWARE)
+		ui->renderer->addItem(
+			QTStr("Basic.Settings.Video.Renderer.Software"),
+			"Software");
+
+	int idx = ui->renderer->findData(QT_UTF8(renderer));
 	if (idx == -1)
 		idx = 0;
 
+#ifdef _WIN32
 	// the video adapter selection is not currently implemented, hide for now
 	// to avoid user confusion. was previously protected by
 	// if (strcmp(renderer, "OpenGL") == 0)
@@ -1390,9 +1408,9 @@ void OBSBasicSettings::LoadRendererList()
 	delete ui->adapterLabel;
 	ui->adapter = nullptr;
 	ui->adapterLabel = nullptr;
+#endif
 
 	ui->renderer->setCurrentIndex(idx);
-#endif
 }
 
 static string ResString(uint32_t cx, uint32_t cy)
@@ -3184,11 +3202,12 @@ void OBSBasicSettings::SaveAdvancedSettings()
 	QString lastMonitoringDevice = config_get_string(
 		main->Config(), "Audio", "MonitoringDeviceId");
 
-#ifdef _WIN32
-	if (WidgetChanged(ui->renderer))
-		config_set_string(App()->GlobalConfig(), "Video", "Renderer",
-				  QT_TO_UTF8(ui->renderer->currentText()));
+	if (ui->renderer && WidgetChanged(ui->renderer))
+		config_set_string(
+			App()->GlobalConfig(), "Video", "Renderer",
+			QT_TO_UTF8(ui->renderer->currentData().toString()));
 
+#ifdef _WIN32
 	std::string priority =
 		QT_TO_UTF8(ui->processPriority->currentData().toString());
 	config_set_string(App()->GlobalConfig(), "General", "ProcessPriority",
@@ -3668,8 +3687,8 @@ void OBSBasicSettings::SaveSettings()
 	if (videoChanged || advancedChanged)
 		main->ResetVideo();
 
-	config_save_safe(main->Config(), "tmp", nullptr);
-	config_save_safe(GetGlobalConfig(), "tmp", nullptr);
+	config_save_safe_deferred(main->Config(), "tmp", nullptr);
+	config_save_safe_deferred(GetGlobalConfig(), "tmp", nullptr);
 	main->SaveProject();
 
 	if (Changed()) {
@@ -13,10 +13,13 @@
 #include <QGridLayout>
 #include <QScreen>
 
+#include <algorithm>
 #include <string>
+#include <vector>
 
 #define TIMER_INTERVAL 2000
 #define REC_TIME_LEFT_INTERVAL 30000
+#define TOP_SOURCES 10
 
 void OBSBasicStats::OBSFrontendEvent(enum obs_frontend_event event, void *ptr)
 {
@@ -94,6 +97,9 @@ OBSBasicStats::OBSBasicStats(QWidget *parent, bool closeable)
 	renderTime = new QLabel(this);
 	skippedFrames = new QLabel(this);
 	missedFrames = new QLabel(this);
+	reusedTextures = new QLabel(this);
+	culledItems = new QLabel(this);
+	drawCalls = new QLabel(this);
 
 	str = MakeMissedFramesText(999999, 999999, 99.99);
 	textWidth = missedFrames->fontMetrics().boundingRect(str).width();
@@ -105,6 +111,9 @@ OBSBasicStats::OBSBasicStats(QWidget *parent, bool closeable)
 	newStat("AverageTimeToRender", renderTime, 2);
 	newStat("MissedFrames", missedFrames, 2);
 	newStat("SkippedFrames", skippedFrames, 2);
+	newStat("ReusedTextures", reusedTextures, 2);
+	newStat("CulledItems", culledItems, 2);
+	newStat("DrawCalls", drawCalls, 2);
 
 	/* --------------------------------------------- */
 	QPushButton *closeButton = nullptr;
@@ -139,8 +148,31 @@ OBSBasicStats::OBSBasicStats(QWidget *parent, bool closeable)
 
 	/* --------------------------------------------- */
 
+	sourceLayout = new QGridLayout();
+
+	col = 0;
+	auto addSourceCol = [&](const char *loc) {
+		QLabel *label = new QLabel(QTStr(loc), this);
+		label->setStyleSheet("font-weight: bold");
+		sourceLayout->addWidget(label, 0, col++);
+	};
+
+	addSourceCol("Basic.Stats.TopSources");
+	addSourceCol("Basic.Stats.TickTime");
+	addSourceCol("Basic.Stats.RenderTime");
+	addSourceCol("Basic.Stats.GPUTime");
+	addSourceCol("Basic.Stats.UploadRate");
+	addSourceCol("Basic.Stats.AudioTime");
+
+	for (int i = 0; i < TOP_SOURCES; i++)
+		AddSourceLabels();
+
+	/* --------------------------------------------- */
+
 	QVBoxLayout *outputContainerLayout = new QVBoxLayout();
 	outputContainerLayout->addLayout(outputLayout);
+	outputContainerLayout->addSpacing(10);
+	outputContainerLayout->addLayout(sourceLayout);
 	outputContainerLayout->addStretch();
 
 	QWidget *widget = new QWidget(this);
@@ -233,6 +265,7 @@ void OBSBasicStats::closeEvent(QCloseEvent *event)
 OBSBasicStats::~OBSBasicStats()
 {
 	obs_frontend_remove_event_callback(OBSFrontendEvent, this);
+	EnableGPUTiming(false);
 
 	delete shortcutFilter;
 	os_cpu_usage_info_destroy(cpu_info);
@@ -264,10 +297,35 @@ void OBSBasicStats::AddOutputLabels(QString name)
 	outputLabels.push_back(ol);
 }
 
+void OBSBasicStats::AddSourceLabels()
+{
+	SourceLabels sl;
+	sl.name = new QLabel(this);
+	sl.tickTime = new QLabel(this);
+	sl.renderTime = new QLabel(this);
+	sl.gpuTime = new QLabel(this);
+	sl.uploadRate = new QLabel(this);
+	sl.audioTime = new QLabel(this);
+
+	int col = 0;
+	int row = sourceLabels.size() + 1;
+	sourceLayout->addWidget(sl.name, row, col++);
+	sourceLayout->addWidget(sl.tickTime, row, col++);
+	sourceLayout->addWidget(sl.renderTime, row, col++);
+	sourceLayout->addWidget(sl.gpuTime, row, col++);
+	sourceLayout->addWidget(sl.uploadRate, row, col++);
+	sourceLayout->addWidget(sl.audioTime, row, col++);
+	sourceLabels.push_back(sl);
+}
+
 static uint32_t first_encoded = 0xFFFFFFFF;
 static uint32_t first_skipped = 0xFFFFFFFF;
 static uint32_t first_rendered = 0xFFFFFFFF;
 static uint32_t first_lagged = 0xFFFFFFFF;
+static uint64_t first_cache_hits = UINT64_MAX;
+static uint64_t first_cache_misses = UINT64_MAX;
+static uint64_t first_items = UINT64_MAX;
+static uint64_t first_culled = UINT64_MAX;
 
 void OBSBasicStats::InitializeValues()
 {
@@ -276,6 +334,10 @@ void OBSBasicStats::InitializeValues()
 	first_skipped = video_output_get_skipped_frames(video);
 	first_rendered = obs_get_total_frames();
 	first_lagged = obs_get_lagged_frames();
+	first_cache_hits = obs_get_render_cache_hits();
+	first_cache_misses = obs_get_render_cache_misses();
+	first_items = obs_get_total_scene_items();
+	first_culled = obs_get_culled_scene_items();
 }
 
 void OBSBasicStats::Update()
@@ -429,6 +491,64 @@ void OBSBasicStats::Update()
 	else
 		setThemeID(missedFrames, "");
 
+	/* ------------------ */
+
+	uint64_t cache_hits = obs_get_render_cache_hits();
+	uint64_t cache_misses = obs_get_render_cache_misses();
+
+	if (cache_hits < first_cache_hits ||
+	    cache_misses < first_cache_misses) {
+		first_cache_hits = cache_hits;
+		first_cache_misses = cache_misses;
+	}
+	cache_hits -= first_cache_hits;
+	cache_misses -= first_cache_misses;
+
+	uint64_t cache_total = cache_hits + cache_misses;
+	num = cache_total ? (long double)cache_hits / (long double)cache_total
+			  : 0.0l;
+	num *= 100.0l;
+
+	str = QString("%1 / %2 (%3%)")
+		      .arg(QString::number(cache_hits),
+			   QString::number(cache_total),
+			   QString::number(num, 'f', 1));
+	reusedTextures->setText(str);
+
+	/* ------------------ */
+
+	uint64_t total_items = obs_get_total_scene_items();
+	uint64_t culled = obs_get_culled_scene_items();
+
+	if (total_items < first_items || culled < first_culled) {
+		first_items = total_items;
+		first_culled = culled;
+	}
+	total_items -= first_items;
+	culled -= first_culled;
+
+	num = total_items ? (long double)culled / (long double)total_items
+			  : 0.0l;
+	num *= 100.0l;
+
+	str = QString("%1 / %2 (%3%)")
+		      .arg(QString::number(culled),
+			   QString::number(total_items),
+			   QString::number(num, 'f', 1));
+	culledItems->setText(str);
+
+	/* ------------------ */
+
+	str = QTStr("Basic.Stats.DrawCalls.Value")
+		      .arg(QString::number(obs_get_frame_draw_calls()),
+			   QString::number(obs_get_frame_batched_sprites()));
+	drawCalls->setText(str);
+
+	/* ------------------------------------------- */
+	/* source costs                                */
+
+	UpdateSources();
+
 	/* ------------------------------------------- */
 	/* recording/streaming stats                   */
 
@@ -441,6 +561,156 @@ void OBSBasicStats::Update()
 	}
 }
 
+static void AddCostFilter(obs_source_t *, obs_source_t *filter, void *param)
+{
+	auto sources = reinterpret_cast<std::vector<OBSSource> *>(param);
+	sources->push_back(filter);
+}
+
+static bool AddCostSource(void *param, obs_source_t *source)
+{
+	auto sources = reinterpret_cast<std::vector<OBSSource> *>(param);
+	sources->push_back(source);
+
+	obs_source_enum_filters(source, AddCostFilter, param);
+	return true;
+}
+
+static QString GetCostSourceName(obs_source_t *source)
+{
+	obs_source_t *parent = obs_filter_get_parent(source);
+	QString name = QT_UTF8(obs_source_get_name(source));
+
+	if (parent)
+		name = QString("%1 / %2").arg(
+			QT_UTF8(obs_source_get_name(parent)), name);
+	return name;
+}
+
+void OBSBasicStats::UpdateSources()
+{
+	struct Cost {
+		OBSSource source;
+		double tick;
+		double render;
+		double gpu;
+		double upload;
+		double audio;
+		bool gpuMeasured;
+	};
+
+	std::vector<OBSSource> sources;
+	std::vector<Cost> costs;
+
+	obs_enum_scenes(AddCostSource, &sources);
+	obs_enum_sources(AddCostSource, &sources);
+
+	uint64_t curTime = os_gettime_ns();
+	uint32_t curFrames = obs_get_total_frames();
+	double seconds = (double)(curTime - lastSourceCostTime) / 1000000000.0;
+	double frames = (double)(curFrames - lastSourceCostFrames);
+	bool valid = lastSourceCostTime && seconds > 0.0 && frames > 0.0;
+
+	for (auto &it : sourceCosts)
+		it.second.seen = false;
+
+	/* video costs are shown per rendered frame, upload and audio costs
+	 * per second */
+	for (obs_source_t *source : sources) {
+		struct obs_source_perf_stats stats = {};
+		obs_source_get_perf_stats(source, &stats);
+
+		auto it = sourceCosts.find(source);
+		if (it == sourceCosts.end() ||
+		    !obs_weak_source_references_source(it->second.source,
+						       source)) {
+			SourceCost &sc = sourceCosts[source];
+			sc.source = OBSGetWeakRef(source);
+			sc.last = stats;
+			sc.seen = true;
+			continue;
+		}
+
+		SourceCost &sc = it->second;
+		struct obs_source_perf_stats &last = sc.last;
+
+		if (valid) {
+			Cost cost;
+			cost.source = source;
+			cost.tick = (double)(stats.tick_time_ns -
+					     last.tick_time_ns) /
+				    frames / 1000000.0;
+			cost.render = (double)(stats.render_time_ns -
+					       last.render_time_ns) /
+				      frames / 1000000.0;
+			cost.gpu = (double)(stats.gpu_time_ns -
+					    last.gpu_time_ns) /
+				   frames / 1000000.0;
+			cost.upload = (double)(stats.upload_bytes -
+					       last.upload_bytes) /
+				      seconds / (1024.0 * 1024.0);
+			cost.audio = (double)(stats.audio_render_time_ns -
+					      last.audio_render_time_ns) /
+				     seconds / 1000000.0;
+			cost.gpuMeasured = stats.gpu_renders !=
+					   last.gpu_renders;
+			costs.push_back(cost);
+		}
+
+		sc.last = stats;
+		sc.seen = true;
+	}
+
+	for (auto it = sourceCosts.begin(); it != sourceCosts.end();) {
+		if (!it->second.seen)
+			it = sourceCosts.erase(it);
+		else
+			++it;
+	}
+
+	std::sort(costs.begin(), costs.end(),
+		  [](const Cost &a, const Cost &b) {
+			  return a.tick + a.render + a.gpu >
+				 b.tick + b.render + b.gpu;
+		  });
+
+	for (int i = 0; i < sourceLabels.size(); i++) {
+		SourceLabels &sl = sourceLabels[i];
+
+		if ((size_t)i >= costs.size()) {
+			sl.name->setText("");
+			sl.tickTime->setText("");
+			sl.renderTime->setText("");
+			sl.gpuTime->setText("");
+			sl.uploadRate->setText("");
+			sl.audioTime->setText("");
+			continue;
+		}
+
+		const Cost &cost = costs[i];
+		sl.name->setText(GetCostSourceName(cost.source));
+		sl.tickTime->setText(QString::number(cost.tick, 'f', 2));
+		sl.renderTime->setText(QString::number(cost.render, 'f', 2));
+		sl.gpuTime->setText(cost.gpuMeasured
+					    ? QString::number(cost.gpu, 'f', 2)
+					    : QString("-"));
+		sl.uploadRate->setText(QString::number(cost.upload, 'f', 1));
+		sl.audioTime->setText(QString::number(cost.audio, 'f', 2));
+	}
+
+	lastSourceCostTime = curTime;
+	lastSourceCostFrames = curFrames;
+}
+
+void OBSBasicStats::EnableGPUTiming(bool enable)
+{
+	if (gpuTiming == enable)
+		return;
+
+	gpuTiming = enable;
+	obs_enable_source_gpu_timing(enable);
+}
+
 void OBSBasicStats::StartRecTimeLeft()
 {
 	if (recTimeLeft.isActive())
@@ -486,6 +756,13 @@ void OBSBasicStats::Reset()
 	first_skipped = 0xFFFFFFFF;
 	first_rendered = 0xFFFFFFFF;
 	first_lagged = 0xFFFFFFFF;
+	first_cache_hits = UINT64_MAX;
+	first_cache_misses = UINT64_MAX;
+	first_items = UINT64_MAX;
+	first_culled = UINT64_MAX;
+
+	sourceCosts.clear();
+	lastSourceCostTime = 0;
 
 	OBSOutput strOutput = obs_frontend_get_streaming_output();
 	OBSOutput recOutput = obs_frontend_get_recording_output();
@@ -593,9 +870,11 @@ void OBSBasicStats::OutputLabels::Reset(obs_output_t *output)
 void OBSBasicStats::showEvent(QShowEvent *)
 {
 	timer.start(TIMER_INTERVAL);
+	EnableGPUTiming(true);
 }
 
 void OBSBasicStats::hideEvent(QHideEvent *)
 {
 	timer.stop();
+	EnableGPUTiming(false);
 }
@@ -9,6 +9,8 @@
 #include <QLabel>
 #include <QList>
 
+#include <unordered_map>
+
 class QGridLayout;
 class QCloseEvent;
 
@@ -24,8 +26,12 @@ class OBSBasicStats : public QWidget {
 	QLabel *renderTime = nullptr;
 	QLabel *skippedFrames = nullptr;
 	QLabel *missedFrames = nullptr;
+	QLabel *reusedTextures = nullptr;
+	QLabel *culledItems = nullptr;
+	QLabel *drawCalls = nullptr;
 
 	QGridLayout *outputLayout = nullptr;
+	QGridLayout *sourceLayout = nullptr;
 
 	os_cpu_usage_info_t *cpu_info = nullptr;
 
@@ -55,8 +61,32 @@ class OBSBasicStats : public QWidget {
 
 	QList<OutputLabels> outputLabels;
 
+	struct SourceLabels {
+		QPointer<QLabel> name;
+		QPointer<QLabel> tickTime;
+		QPointer<QLabel> renderTime;
+		QPointer<QLabel> gpuTime;
+		QPointer<QLabel> uploadRate;
+		QPointer<QLabel> audioTime;
+	};
+
+	struct SourceCost {
+		OBSWeakSource source;
+		struct obs_source_perf_stats last = {};
+		bool seen = false;
+	};
+
+	QList<SourceLabels> sourceLabels;
+	std::unordered_map<obs_source_t *, SourceCost> sourceCosts;
+	uint64_t lastSourceCostTime = 0;
+	uint32_t lastSourceCostFrames = 0;
+	bool gpuTiming = false;
+
 	void AddOutputLabels(QString name);
+	void AddSourceLabels();
 	void Update();
+	void UpdateSources();
+	void EnableGPUTiming(bool enable);
 
 	virtual void closeEvent(QCloseEvent *event) override;
 
@@ -0,0 +1,155 @@
+/*
+ * Copyright (c) 2021 Hugh Bailey <obs.jim@gmail.com>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#include "cache.h"
+
+static inline size_t frame_size(const AVFrame *frame)
+{
+	size_t size = 0;
+
+	for (size_t i = 0; i < AV_NUM_DATA_POINTERS && frame->buf[i]; i++)
+		size += frame->buf[i]->size;
+	for (int i = 0; i < frame->nb_extended_buf; i++)
+		size += frame->extended_buf[i]->size;
+
+	return size;
+}
+
+static void free_frames(struct mp_decode *d)
+{
+	for (size_t i = 0; i < d->cache.num; i++)
+		av_frame_free(&d->cache.array[i].frame);
+
+	/* the frame being presented may be one of them */
+	if (d->out.cached) {
+		d->out.frame = NULL;
+		d->out.cached = false;
+		d->out_ready = false;
+	}
+
+	da_free(d->cache);
+	d->cache_pos = 0;
+}
+
+static void cache_clear(mp_media_t *m)
+{
+	free_frames(&m->v);
+	free_frames(&m->a);
+
+	pthread_mutex_lock(&m->pipe_mutex);
+	m->cache_size = 0;
+	pthread_mutex_unlock(&m->pipe_mutex);
+
+	m->cache_filling = false;
+	m->cache_complete = false;
+	m->cache_replaying = false;
+}
+
+void mp_cache_free(mp_media_t *m)
+{
+	cache_clear(m);
+}
+
+/* called whenever the media thread seeks, returns whether playback is now
+ * served from memory */
+bool mp_cache_seek(mp_media_t *m, bool from_start)
+{
+	if (!m->cache_budget || m->cache_failed || !m->is_local_file)
+		return false;
+
+	if (!from_start) {
+		m->cache_replaying = false;
+		if (m->cache_filling)
+			cache_clear(m);
+		return false;
+	}
+
+	if (m->cache_complete) {
+		m->v.cache_pos = 0;
+		m->a.cache_pos = 0;
+		m->cache_replaying = true;
+
+		pthread_mutex_lock(&m->pipe_mutex);
+		m->cache_replays++;
+		pthread_mutex_unlock(&m->pipe_mutex);
+		return true;
+	}
+
+	cache_clear(m);
+	m->cache_filling = true;
+	return false;
+}
+
+/* takes ownership of the frame that was just presented */
+void mp_cache_add(mp_media_t *m, struct mp_decode *d)
+{
+	struct mp_frame *f = &d->out;
+	size_t size;
+
+	if (!m->cache_filling || !f->frame || f->cached || d->out_ready)
+		return;
+
+	size = frame_size(f->frame);
+
+	pthread_mutex_lock(&m->pipe_mutex);
+	m->cache_size += size;
+	size = m->cache_size;
+	pthread_mutex_unlock(&m->pipe_mutex);
+
+	f->cached = true;
+	da_push_back(d->cache, f);
+	f->frame = NULL;
+	f->cached = false;
+
+	if (size > m->cache_budget) {
+		blog(LOG_INFO, "MP: '%s' does not fit in the %d MB frame cache",
+		     m->path, (int)(m->cache_budget / (1024 * 1024)));
+		cache_clear(m);
+		m->cache_failed = true;
+	}
+}
+
+void mp_cache_check_complete(mp_media_t *m)
+{
+	if (!m->cache_filling)
+		return;
+	if (m->has_video && !m->v.out_eof)
+		return;
+	if (m->has_audio && !m->a.out_eof)
+		return;
+
+	m->cache_filling = false;
+	m->cache_complete = true;
+}
+
+void mp_cache_pop_frame(mp_media_t *m, struct mp_decode *d)
+{
+	if (d->out_ready || d->out_eof)
+		return;
+
+	if (d->cache_pos == d->cache.num) {
+		d->out_eof = true;
+		return;
+	}
+
+	d->out = d->cache.array[d->cache_pos++];
+	d->out_ready = true;
+
+	pthread_mutex_lock(&m->pipe_mutex);
+	m->cache_hits++;
+	pthread_mutex_unlock(&m->pipe_mutex);
+}
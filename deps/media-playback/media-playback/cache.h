@@ -0,0 +1,48 @@
+/*
+ * Copyright (c) 2021 Hugh Bailey <obs.jim@gmail.com>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#pragma once
+
+#include "media.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Decoded frame cache
+ *
+ * When enabled, the frames presented during a playthrough that started at
+ * the beginning of a local file are kept in memory instead of being recycled.
+ * Once the whole file has been played within the memory budget, playback from
+ * the beginning (looping, restarting) is served from memory and the demuxer
+ * and decoders stay idle.  Going over the budget drops the cache for good,
+ * seeking anywhere else drops a cache that is still being filled.
+ *
+ * Everything here is only used by the media thread, apart from the counters
+ * which are protected by the pipeline mutex.
+ */
+
+extern bool mp_cache_seek(mp_media_t *m, bool from_start);
+extern void mp_cache_add(mp_media_t *m, struct mp_decode *d);
+extern void mp_cache_pop_frame(mp_media_t *m, struct mp_decode *d);
+extern void mp_cache_check_complete(mp_media_t *m);
+extern void mp_cache_free(mp_media_t *m);
+
+#ifdef __cplusplus
+}
+#endif
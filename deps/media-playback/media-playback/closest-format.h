@@ -41,7 +41,6 @@ static enum AVPixelFormat closest_format(enum AVPixelFormat fmt)
 	case AV_PIX_FMT_YUV422P16LE:
 	case AV_PIX_FMT_YUV422P16BE:
 	case AV_PIX_FMT_YUV422P10BE:
-	case AV_PIX_FMT_YUV422P10LE:
 	case AV_PIX_FMT_YUV422P9BE:
 	case AV_PIX_FMT_YUV422P9LE:
 	case AV_PIX_FMT_YVYU422:
@@ -65,7 +64,6 @@ static enum AVPixelFormat closest_format(enum AVPixelFormat fmt)
 	case AV_PIX_FMT_YUV420P9BE:
 	case AV_PIX_FMT_YUV420P9LE:
 	case AV_PIX_FMT_YUV420P10BE:
-	case AV_PIX_FMT_YUV420P10LE:
 	case AV_PIX_FMT_YUV420P12BE:
 	case AV_PIX_FMT_YUV420P12LE:
 	case AV_PIX_FMT_YUV420P14BE:
@@ -91,6 +89,12 @@ static enum AVPixelFormat closest_format(enum AVPixelFormat fmt)
 #endif
 		return AV_PIX_FMT_YUVA444P;
 
+	/* 10-bit formats are converted on the GPU */
+	case AV_PIX_FMT_YUV420P10LE:
+	case AV_PIX_FMT_P010LE:
+	case AV_PIX_FMT_YUV422P10LE:
+		return fmt;
+
 	case AV_PIX_FMT_RGBA:
 	case AV_PIX_FMT_BGRA:
 	case AV_PIX_FMT_BGR0:
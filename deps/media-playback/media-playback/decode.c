@@ -14,6 +14,8 @@
  * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
  */
 
+#include <util/platform.h>
+
 #include "decode.h"
 #include "media.h"
 
@@ -73,6 +75,41 @@ static void init_hw_decoder(struct mp_decode *d, AVCodecContext *c)
 }
 #endif
 
+/* frame threading has the lowest cost per frame, but delays every frame by
+ * one frame per thread, which is only acceptable for local files */
+static void set_thread_options(struct mp_decode *d, AVCodecContext *c)
+{
+	int cores = os_get_logical_cores();
+	int pixels = c->width * c->height;
+	int count;
+
+	if (d->audio) {
+		c->thread_count = 1;
+		return;
+	}
+
+	if (c->codec_id == AV_CODEC_ID_PNG || c->codec_id == AV_CODEC_ID_TIFF ||
+	    c->codec_id == AV_CODEC_ID_JPEG2000 ||
+	    c->codec_id == AV_CODEC_ID_MPEG4 || c->codec_id == AV_CODEC_ID_WEBP)
+		return;
+
+	if (pixels >= 3840 * 2160)
+		count = cores;
+	else if (pixels >= 1920 * 1080)
+		count = cores / 2;
+	else
+		count = 2;
+
+	if (count < 1)
+		count = 1;
+	if (count > 16)
+		count = 16;
+
+	c->thread_count = count;
+	c->thread_type = d->m->is_local_file ? FF_THREAD_FRAME | FF_THREAD_SLICE
+					     : FF_THREAD_SLICE;
+}
+
 static int mp_open_codec(struct mp_decode *d, bool hw)
 {
 	AVCodecContext *c;
@@ -99,11 +136,7 @@ static int mp_open_codec(struct mp_decode *d, bool hw)
 		init_hw_decoder(d, c);
 #endif
 
-	if (c->thread_count == 1 && c->codec_id != AV_CODEC_ID_PNG &&
-	    c->codec_id != AV_CODEC_ID_TIFF &&
-	    c->codec_id != AV_CODEC_ID_JPEG2000 &&
-	    c->codec_id != AV_CODEC_ID_MPEG4 && c->codec_id != AV_CODEC_ID_WEBP)
-		c->thread_count = 0;
+	set_thread_options(d, c);
 
 	ret = avcodec_open2(c, d->codec, NULL);
 	if (ret < 0)
@@ -195,6 +228,15 @@ bool mp_decode_init(mp_media_t *m, enum AVMediaType type, bool hw)
 	return true;
 }
 
+static inline void free_packets(struct circlebuf *packets)
+{
+	while (packets->size) {
+		AVPacket pkt;
+		circlebuf_pop_front(packets, &pkt, sizeof(pkt));
+		av_packet_unref(&pkt);
+	}
+}
+
 void mp_decode_clear_packets(struct mp_decode *d)
 {
 	if (d->packet_pending) {
@@ -202,17 +244,56 @@ void mp_decode_clear_packets(struct mp_decode *d)
 		d->packet_pending = false;
 	}
 
-	while (d->packets.size) {
-		AVPacket pkt;
-		circlebuf_pop_front(&d->packets, &pkt, sizeof(pkt));
-		av_packet_unref(&pkt);
+	free_packets(&d->packets);
+	free_packets(&d->input);
+}
+
+/* scaled frames keep their buffers and are reused by the decode thread,
+ * cached frames belong to the cache */
+static void recycle_frame(struct mp_decode *d, struct mp_frame *f)
+{
+	if (!f->frame)
+		return;
+
+	if (f->cached)
+		f->frame = NULL;
+	else if (f->scaled)
+		circlebuf_push_back(&d->free_frames, &f->frame,
+				    sizeof(f->frame));
+	else
+		av_frame_free(&f->frame);
+
+	f->frame = NULL;
+}
+
+static void clear_frames(struct mp_decode *d)
+{
+	while (d->frames.size) {
+		struct mp_frame f;
+		circlebuf_pop_front(&d->frames, &f, sizeof(f));
+		recycle_frame(d, &f);
 	}
+
+	recycle_frame(d, &d->out);
+	d->out_ready = false;
+	d->out_eof = false;
+	d->frames_eof = false;
 }
 
 void mp_decode_free(struct mp_decode *d)
 {
 	mp_decode_clear_packets(d);
 	circlebuf_free(&d->packets);
+	circlebuf_free(&d->input);
+
+	clear_frames(d);
+	while (d->free_frames.size) {
+		AVFrame *frame;
+		circlebuf_pop_front(&d->free_frames, &frame, sizeof(frame));
+		av_frame_free(&frame);
+	}
+	circlebuf_free(&d->frames);
+	circlebuf_free(&d->free_frames);
 
 	if (d->hw_frame) {
 		av_frame_unref(d->hw_frame);
@@ -239,9 +320,10 @@ void mp_decode_free(struct mp_decode *d)
 	memset(d, 0, sizeof(*d));
 }
 
+/* called by the demux thread with the pipeline mutex locked */
 void mp_decode_push_packet(struct mp_decode *decode, AVPacket *packet)
 {
-	circlebuf_push_back(&decode->packets, packet, sizeof(*packet));
+	circlebuf_push_back(&decode->input, packet, sizeof(*packet));
 }
 
 static inline int64_t get_estimated_duration(struct mp_decode *d,
@@ -330,7 +412,7 @@ static int decode_packet(struct mp_decode *d, int *got_frame)
 
 bool mp_decode_next(struct mp_decode *d)
 {
-	bool eof = d->m->eof;
+	bool eof = d->input_eof;
 	int got_frame;
 	int ret;
 
@@ -428,11 +510,91 @@ bool mp_decode_next(struct mp_decode *d)
 	return true;
 }
 
+/* called with the pipeline stopped */
 void mp_decode_flush(struct mp_decode *d)
 {
 	avcodec_flush_buffers(d->decoder);
 	mp_decode_clear_packets(d);
 	d->eof = false;
+	d->input_eof = false;
 	d->frame_pts = 0;
 	d->frame_ready = false;
+
+	pthread_mutex_lock(&d->m->pipe_mutex);
+	clear_frames(d);
+	pthread_mutex_unlock(&d->m->pipe_mutex);
+}
+
+/* ------------------------------------------------------------------------- */
+/* the following functions are called by the decode thread with the
+ * pipeline mutex locked */
+
+bool mp_decode_take_input(struct mp_decode *d)
+{
+	bool taken = d->input.size != 0;
+
+	while (d->input.size) {
+		AVPacket pkt;
+		circlebuf_pop_front(&d->input, &pkt, sizeof(pkt));
+		circlebuf_push_back(&d->packets, &pkt, sizeof(pkt));
+	}
+
+	d->input_eof = d->m->demux_eof;
+	return taken;
+}
+
+bool mp_decode_has_work(struct mp_decode *d)
+{
+	if (!d->stream || d->frames_eof)
+		return false;
+	if (mp_decode_queued_frames(d) >= d->max_frames)
+		return false;
+
+	return d->input.size || d->packets.size || d->packet_pending ||
+	       (d->m->demux_eof && !d->eof);
+}
+
+AVFrame *mp_decode_get_free_frame(struct mp_decode *d)
+{
+	AVFrame *frame = NULL;
+
+	if (d->free_frames.size)
+		circlebuf_pop_front(&d->free_frames, &frame, sizeof(frame));
+	return frame;
+}
+
+void mp_decode_push_frame(struct mp_decode *d, const struct mp_frame *frame)
+{
+	circlebuf_push_back(&d->frames, frame, sizeof(*frame));
+}
+
+size_t mp_decode_queued_frames(struct mp_decode *d)
+{
+	return d->frames.size / sizeof(struct mp_frame);
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* called by the media thread, replaces the frame being presented with the
+ * next decoded frame if there is one */
+bool mp_decode_pop_frame(struct mp_decode *d)
+{
+	if (d->out_ready)
+		return true;
+
+	pthread_mutex_lock(&d->m->pipe_mutex);
+
+	if (d->frames.size) {
+		recycle_frame(d, &d->out);
+		circlebuf_pop_front(&d->frames, &d->out, sizeof(d->out));
+		d->out_ready = true;
+	} else if (d->frames_eof) {
+		d->out_eof = true;
+	}
+
+	pthread_mutex_unlock(&d->m->pipe_mutex);
+
+	if (d->out_ready)
+		os_event_signal(d->m->decode_event);
+	return d->out_ready;
 }
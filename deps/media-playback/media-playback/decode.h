@@ -21,6 +21,7 @@ extern "C" {
 #endif
 
 #include <util/circlebuf.h>
+#include <util/darray.h>
 
 #ifdef _MSC_VER
 #pragma warning(push)
@@ -46,6 +47,14 @@ extern "C" {
 
 struct mp_media;
 
+struct mp_frame {
+	AVFrame *frame;
+	int64_t pts;
+	int64_t next_pts;
+	bool scaled;
+	bool cached;
+};
+
 struct mp_decode {
 	struct mp_media *m;
 	AVStream *stream;
@@ -72,6 +81,28 @@ struct mp_decode {
 	AVPacket pkt;
 	bool packet_pending;
 	struct circlebuf packets;
+	bool input_eof;
+
+	/* packets from the demux thread and decoded frames for the media
+	 * thread, protected by the pipeline mutex */
+	struct circlebuf input;
+	struct circlebuf frames;
+	struct circlebuf free_frames;
+	size_t max_frames;
+	bool frames_eof;
+
+	/* frames that end before this are dropped after a seek, set while
+	 * the pipeline is paused */
+	int64_t skip_until;
+
+	/* frame being presented, only used by the media thread */
+	struct mp_frame out;
+	bool out_ready;
+	bool out_eof;
+
+	/* frames kept in memory for replaying, see cache.h */
+	DARRAY(struct mp_frame) cache;
+	size_t cache_pos;
 };
 
 extern bool mp_decode_init(struct mp_media *media, enum AVMediaType type,
@@ -84,6 +115,14 @@ extern void mp_decode_push_packet(struct mp_decode *decode, AVPacket *pkt);
 extern bool mp_decode_next(struct mp_decode *decode);
 extern void mp_decode_flush(struct mp_decode *decode);
 
+extern bool mp_decode_take_input(struct mp_decode *decode);
+extern bool mp_decode_has_work(struct mp_decode *decode);
+extern AVFrame *mp_decode_get_free_frame(struct mp_decode *decode);
+extern void mp_decode_push_frame(struct mp_decode *decode,
+				 const struct mp_frame *frame);
+extern bool mp_decode_pop_frame(struct mp_decode *decode);
+extern size_t mp_decode_queued_frames(struct mp_decode *decode);
+
 #ifdef __cplusplus
 }
 #endif
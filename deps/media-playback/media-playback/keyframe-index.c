@@ -0,0 +1,529 @@
+/*
+ * Copyright (c) 2021 Hugh Bailey <obs.jim@gmail.com>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#include <util/platform.h>
+#include <util/dstr.h>
+#include <sys/stat.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "media.h"
+#include "keyframe-index.h"
+
+#define INDEX_MAGIC 0x3149464B /* "KFI1" */
+#define MAX_SECONDS (1 << 24)
+
+/* the oldest index files are removed when the cache grows past this, and
+ * files that haven't been used for this long are always removed */
+#define CACHE_MAX_SIZE (64LL * 1024 * 1024)
+#define CACHE_MAX_AGE (30LL * 24 * 60 * 60)
+
+/* demuxer indexes are only used if they reach this close to the end of the
+ * stream, and have no larger gaps between keyframes */
+#define INDEX_END_MARGIN_US (2LL * 1000000)
+#define INDEX_MAX_GAP_US (30LL * 1000000)
+
+struct index_header {
+	uint32_t magic;
+	uint32_t count;
+	int64_t size;
+	int64_t mtime;
+	int32_t stream_index;
+	int32_t reserved;
+};
+
+void mp_keyframe_index_free(struct mp_keyframe_index *index)
+{
+	da_free(index->keys);
+	da_free(index->seconds);
+	memset(index, 0, sizeof(*index));
+}
+
+static uint64_t hash_path(const char *path)
+{
+	uint64_t hash = 14695981039346656037ULL;
+
+	while (*path) {
+		hash ^= (uint8_t)*(path++);
+		hash *= 1099511628211ULL;
+	}
+
+	return hash;
+}
+
+static bool get_file_info(const char *path, int64_t *size, int64_t *mtime)
+{
+	struct stat st;
+
+	if (os_stat(path, &st) != 0)
+		return false;
+
+	*size = (int64_t)st.st_size;
+	*mtime = (int64_t)st.st_mtime;
+	return true;
+}
+
+static bool load_index(struct mp_keyframe_index *index, const char *file,
+		       int64_t size, int64_t mtime)
+{
+	struct index_header header;
+	bool success = false;
+	FILE *f;
+
+	f = os_fopen(file, "rb");
+	if (!f)
+		return false;
+
+	if (fread(&header, sizeof(header), 1, f) == 1 &&
+	    header.magic == INDEX_MAGIC && header.size == size &&
+	    header.mtime == mtime && header.count) {
+		da_resize(index->keys, header.count);
+		success = fread(index->keys.array, sizeof(struct mp_keyframe),
+				header.count, f) == header.count;
+		index->stream_index = header.stream_index;
+	}
+
+	fclose(f);
+
+	if (!success)
+		da_free(index->keys);
+	return success;
+}
+
+/* rewrites the header so that the file time says when the index was last
+ * used, which is what the cache is trimmed by */
+static void touch_index(const char *file)
+{
+	struct index_header header;
+	FILE *f = os_fopen(file, "r+b");
+	if (!f)
+		return;
+
+	if (fread(&header, sizeof(header), 1, f) == 1 &&
+	    fseek(f, 0, SEEK_SET) == 0)
+		fwrite(&header, sizeof(header), 1, f);
+	fclose(f);
+}
+
+struct cache_file {
+	char *path;
+	int64_t size;
+	int64_t mtime;
+};
+
+static int compare_cache_files(const void *a, const void *b)
+{
+	const struct cache_file *file_a = a;
+	const struct cache_file *file_b = b;
+
+	if (file_a->mtime == file_b->mtime)
+		return 0;
+	return file_a->mtime < file_b->mtime ? -1 : 1;
+}
+
+/* removes unused index files, and the least recently used ones until the
+ * cache fits in CACHE_MAX_SIZE.  the file that was just written is kept */
+static void trim_cache(const char *dir, const char *keep)
+{
+	DARRAY(struct cache_file) files;
+	struct os_dirent *ent;
+	struct dstr path = {0};
+	int64_t now = (int64_t)time(NULL);
+	int64_t total = 0;
+	int64_t size, mtime;
+	os_dir_t *d;
+
+	d = os_opendir(dir);
+	if (!d)
+		return;
+
+	da_init(files);
+
+	while ((ent = os_readdir(d)) != NULL) {
+		struct cache_file *file;
+		const char *ext = os_get_path_extension(ent->d_name);
+
+		if (ent->directory || !ext || astrcmpi(ext, ".kfi") != 0)
+			continue;
+
+		dstr_printf(&path, "%s/%s", dir, ent->d_name);
+		if (strcmp(path.array, keep) == 0 ||
+		    !get_file_info(path.array, &size, &mtime))
+			continue;
+
+		file = da_push_back_new(files);
+		file->path = bstrdup(path.array);
+		file->size = size;
+		file->mtime = mtime;
+		total += size;
+	}
+
+	os_closedir(d);
+
+	if (get_file_info(keep, &size, &mtime))
+		total += size;
+
+	qsort(files.array, files.num, sizeof(struct cache_file),
+	      compare_cache_files);
+
+	for (size_t i = 0; i < files.num; i++) {
+		struct cache_file *file = &files.array[i];
+
+		if ((total > CACHE_MAX_SIZE ||
+		     now - file->mtime > CACHE_MAX_AGE) &&
+		    os_unlink(file->path) == 0)
+			total -= file->size;
+
+		bfree(file->path);
+	}
+
+	da_free(files);
+	dstr_free(&path);
+}
+
+static void save_index(const struct mp_keyframe_index *index, const char *dir,
+		       const char *file, int64_t size, int64_t mtime)
+{
+	struct index_header header = {
+		.magic = INDEX_MAGIC,
+		.count = (uint32_t)index->keys.num,
+		.size = size,
+		.mtime = mtime,
+		.stream_index = index->stream_index,
+	};
+	bool success;
+	FILE *f;
+
+	os_mkdirs(dir);
+
+	f = os_fopen(file, "wb");
+	if (!f)
+		return;
+
+	success = fwrite(&header, sizeof(header), 1, f) == 1 &&
+		  fwrite(index->keys.array, sizeof(struct mp_keyframe),
+			 index->keys.num, f) == index->keys.num;
+	fclose(f);
+
+	if (!success)
+		os_unlink(file);
+}
+
+static int interrupt_scan(void *opaque)
+{
+	struct mp_media *m = opaque;
+	return os_atomic_load_bool(&m->index_kill);
+}
+
+static int compare_keys(const void *a, const void *b)
+{
+	const struct mp_keyframe *key_a = a;
+	const struct mp_keyframe *key_b = b;
+
+	if (key_a->time_us == key_b->time_us)
+		return 0;
+	return key_a->time_us < key_b->time_us ? -1 : 1;
+}
+
+#if LIBAVFORMAT_VERSION_INT >= AV_VERSION_INT(58, 78, 100)
+static inline int get_index_count(AVStream *stream)
+{
+	return avformat_index_get_entries_count(stream);
+}
+
+static inline const AVIndexEntry *get_index_entry(AVStream *stream, int i)
+{
+	return avformat_index_get_entry(stream, i);
+}
+#else
+static inline int get_index_count(AVStream *stream)
+{
+	return stream->nb_index_entries;
+}
+
+static inline const AVIndexEntry *get_index_entry(AVStream *stream, int i)
+{
+	return &stream->index_entries[i];
+}
+#endif
+
+static inline int64_t get_stream_start_us(AVStream *stream)
+{
+	if (stream->start_time == AV_NOPTS_VALUE)
+		return 0;
+	return av_rescale_q(stream->start_time, stream->time_base,
+			    AV_TIME_BASE_Q);
+}
+
+static int64_t get_stream_end_us(AVFormatContext *fmt, AVStream *stream)
+{
+	int64_t start = get_stream_start_us(stream);
+
+	if (stream->duration != AV_NOPTS_VALUE && stream->duration > 0)
+		return start + av_rescale_q(stream->duration,
+					    stream->time_base, AV_TIME_BASE_Q);
+	if (fmt->duration != AV_NOPTS_VALUE && fmt->duration > 0)
+		return start + fmt->duration;
+	return AV_NOPTS_VALUE;
+}
+
+/* index timestamps can be decode times, which come up to the reorder delay
+ * before the presentation times.  adding the delay to the lookup times picks
+ * the earlier keyframe when in doubt */
+static int64_t get_reorder_delay(AVStream *stream)
+{
+	AVRational rate = stream->avg_frame_rate;
+	int delay = stream->codecpar->video_delay;
+
+	if (delay <= 0 || rate.num <= 0 || rate.den <= 0)
+		return 0;
+
+	return av_rescale_q(delay, av_inv_q(rate), stream->time_base);
+}
+
+/*
+ * Demuxers that read the index of the whole file when opening it (mp4/mov,
+ * avi, matroska cues) already know where the keyframes are, so the file
+ * doesn't have to be read.  Other demuxers only add entries as packets are
+ * read, so the index is only used if it covers the whole stream.
+ */
+static bool read_stream_index(AVFormatContext *fmt, AVStream *stream,
+			      struct mp_keyframe_index *index)
+{
+	int count = get_index_count(stream);
+	int64_t prev_us = get_stream_start_us(stream);
+	int64_t end_us = get_stream_end_us(fmt, stream);
+	int64_t delay = get_reorder_delay(stream);
+	int64_t last_us;
+
+	if (count <= 0 || end_us == AV_NOPTS_VALUE)
+		return false;
+
+	last_us = av_rescale_q(get_index_entry(stream, count - 1)->timestamp,
+			       stream->time_base, AV_TIME_BASE_Q);
+	if (last_us < end_us - INDEX_END_MARGIN_US)
+		return false;
+
+	for (int i = 0; i < count; i++) {
+		const AVIndexEntry *entry = get_index_entry(stream, i);
+		struct mp_keyframe *key;
+		int64_t time_us;
+
+		if (!(entry->flags & AVINDEX_KEYFRAME) ||
+		    entry->timestamp == AV_NOPTS_VALUE)
+			continue;
+
+		time_us = av_rescale_q(entry->timestamp + delay,
+				       stream->time_base, AV_TIME_BASE_Q);
+		if (time_us - prev_us > INDEX_MAX_GAP_US)
+			goto incomplete;
+
+		key = da_push_back_new(index->keys);
+		key->ts = entry->timestamp;
+		key->time_us = time_us;
+		key->pos = entry->pos;
+		prev_us = time_us;
+	}
+
+	if (!index->keys.num || end_us - prev_us > INDEX_MAX_GAP_US)
+		goto incomplete;
+
+	return true;
+
+incomplete:
+	da_free(index->keys);
+	return false;
+}
+
+/* uses the demuxer index when it is complete, otherwise reads the packets of
+ * the video stream, without decoding them */
+static bool scan_file(struct mp_media *m, struct mp_keyframe_index *index)
+{
+	AVFormatContext *fmt = avformat_alloc_context();
+	AVStream *stream;
+	AVPacket pkt;
+	bool success = false;
+	int idx;
+
+	fmt->interrupt_callback.callback = interrupt_scan;
+	fmt->interrupt_callback.opaque = m;
+
+	if (avformat_open_input(&fmt, m->path, NULL, NULL) < 0)
+		return false;
+	if (avformat_find_stream_info(fmt, NULL) < 0)
+		goto fail;
+
+	idx = av_find_best_stream(fmt, AVMEDIA_TYPE_VIDEO, -1, -1, NULL, 0);
+	if (idx < 0)
+		goto fail;
+
+	for (unsigned int i = 0; i < fmt->nb_streams; i++) {
+		if ((int)i != idx)
+			fmt->streams[i]->discard = AVDISCARD_ALL;
+	}
+
+	stream = fmt->streams[idx];
+	index->stream_index = idx;
+
+	if (read_stream_index(fmt, stream, index)) {
+		success = true;
+		goto sort;
+	}
+
+	av_init_packet(&pkt);
+
+	while (!os_atomic_load_bool(&m->index_kill) &&
+	       av_read_frame(fmt, &pkt) >= 0) {
+		int64_t ts = pkt.pts != AV_NOPTS_VALUE ? pkt.pts : pkt.dts;
+
+		if (pkt.stream_index == idx && (pkt.flags & AV_PKT_FLAG_KEY) &&
+		    ts != AV_NOPTS_VALUE) {
+			struct mp_keyframe *key = da_push_back_new(index->keys);
+			key->ts = ts;
+			key->time_us = av_rescale_q(ts, stream->time_base,
+						    AV_TIME_BASE_Q);
+			key->pos = pkt.pos;
+		}
+
+		av_packet_unref(&pkt);
+	}
+
+	success = !os_atomic_load_bool(&m->index_kill) && index->keys.num;
+
+sort:
+	if (success)
+		qsort(index->keys.array, index->keys.num,
+		      sizeof(struct mp_keyframe), compare_keys);
+
+fail:
+	avformat_close_input(&fmt);
+	return success;
+}
+
+static bool build_seconds(struct mp_keyframe_index *index)
+{
+	const struct mp_keyframe *keys = index->keys.array;
+	size_t num = index->keys.num;
+	int64_t first = keys[0].time_us;
+	int64_t span = keys[num - 1].time_us - first;
+	size_t count = (size_t)(span / 1000000) + 1;
+	uint32_t k = 0;
+
+	if (span < 0 || count > MAX_SECONDS)
+		return false;
+
+	da_resize(index->seconds, count);
+
+	for (size_t s = 0; s < count; s++) {
+		int64_t t = first + (int64_t)s * 1000000;
+
+		while (k + 1 < num && keys[k + 1].time_us <= t)
+			k++;
+		index->seconds.array[s] = k;
+	}
+
+	index->first_us = first;
+	return true;
+}
+
+static void *index_thread(void *opaque)
+{
+	struct mp_media *m = opaque;
+	struct mp_keyframe_index index = {0};
+	struct dstr file = {0};
+	int64_t size = 0;
+	int64_t mtime = 0;
+	bool loaded = false;
+
+	os_set_thread_name("mp_index_thread");
+
+	if (m->index_dir && get_file_info(m->path, &size, &mtime)) {
+		dstr_printf(&file, "%s/%016llx.kfi", m->index_dir,
+			    (unsigned long long)hash_path(m->path));
+		loaded = load_index(&index, file.array, size, mtime);
+		if (loaded)
+			touch_index(file.array);
+	}
+
+	if (!loaded && scan_file(m, &index) && file.len) {
+		save_index(&index, m->index_dir, file.array, size, mtime);
+		trim_cache(m->index_dir, file.array);
+	}
+
+	if (index.keys.num && build_seconds(&index)) {
+		m->index = index;
+		os_atomic_set_bool(&m->index_ready, true);
+	} else {
+		mp_keyframe_index_free(&index);
+	}
+
+	dstr_free(&file);
+	return NULL;
+}
+
+bool mp_keyframe_index_start(struct mp_media *m)
+{
+	if (!m->is_local_file || !m->path || !os_file_exists(m->path))
+		return false;
+
+	os_atomic_set_bool(&m->index_kill, false);
+
+	if (pthread_create(&m->index_thread, NULL, index_thread, m) != 0) {
+		blog(LOG_WARNING, "MP: Could not create keyframe index thread");
+		return false;
+	}
+
+	m->index_thread_valid = true;
+	return true;
+}
+
+void mp_keyframe_index_stop(struct mp_media *m)
+{
+	if (!m->index_thread_valid)
+		return;
+
+	os_atomic_set_bool(&m->index_kill, true);
+	pthread_join(m->index_thread, NULL);
+	m->index_thread_valid = false;
+}
+
+bool mp_keyframe_index_find(const struct mp_keyframe_index *index,
+			    int64_t time_us, struct mp_keyframe *key)
+{
+	const struct mp_keyframe *keys = index->keys.array;
+	size_t num = index->keys.num;
+	size_t k;
+
+	if (!num || !index->seconds.num)
+		return false;
+
+	if (time_us <= index->first_us) {
+		*key = keys[0];
+		return true;
+	}
+
+	size_t second = (size_t)((time_us - index->first_us) / 1000000);
+	if (second >= index->seconds.num)
+		second = index->seconds.num - 1;
+
+	k = index->seconds.array[second];
+	while (k + 1 < num && keys[k + 1].time_us <= time_us)
+		k++;
+
+	*key = keys[k];
+	return true;
+}
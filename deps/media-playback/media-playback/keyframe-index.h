@@ -0,0 +1,63 @@
+/*
+ * Copyright (c) 2021 Hugh Bailey <obs.jim@gmail.com>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#pragma once
+
+#include <util/darray.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Keyframe index
+ *
+ * The video keyframes of a local file, taken from the demuxer index when it
+ * covers the whole file, or otherwise built by reading through the file, on
+ * a thread of its own once it has been opened.  They are kept in the index
+ * cache directory (when there is one) so that the next time the file is
+ * opened they are available right away, and the least recently used files
+ * are removed when the cache gets too large or old.  Lookups go through a
+ * table of the last keyframe at or before every second, and only have to
+ * walk the few keyframes that follow within that second.
+ */
+
+struct mp_keyframe {
+	int64_t ts;      /* stream time base */
+	int64_t time_us; /* AV_TIME_BASE */
+	int64_t pos;     /* byte offset, -1 if unknown */
+};
+
+struct mp_keyframe_index {
+	DARRAY(struct mp_keyframe) keys;
+	DARRAY(uint32_t) seconds;
+	int64_t first_us;
+	int stream_index;
+};
+
+struct mp_media;
+
+extern bool mp_keyframe_index_start(struct mp_media *m);
+extern void mp_keyframe_index_stop(struct mp_media *m);
+extern void mp_keyframe_index_free(struct mp_keyframe_index *index);
+
+extern bool mp_keyframe_index_find(const struct mp_keyframe_index *index,
+				   int64_t time_us, struct mp_keyframe *key);
+
+#ifdef __cplusplus
+}
+#endif
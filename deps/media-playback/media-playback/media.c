@@ -20,10 +20,11 @@
 #include <assert.h>
 
 #include "media.h"
+#include "share.h"
+#include "cache.h"
 #include "closest-format.h"
 
 #include <libavdevice/avdevice.h>
-#include <libavutil/imgutils.h>
 
 static int64_t base_sys_ts = 0;
 
@@ -54,6 +55,12 @@ static inline enum video_format convert_pixel_format(int f)
 		return VIDEO_FORMAT_I42A;
 	case AV_PIX_FMT_YUVA444P:
 		return VIDEO_FORMAT_YUVA;
+	case AV_PIX_FMT_YUV420P10LE:
+		return VIDEO_FORMAT_I010;
+	case AV_PIX_FMT_P010LE:
+		return VIDEO_FORMAT_P010;
+	case AV_PIX_FMT_YUV422P10LE:
+		return VIDEO_FORMAT_I210;
 	default:;
 	}
 
@@ -160,7 +167,12 @@ static int mp_media_next_packet(mp_media_t *media)
 	struct mp_decode *d = get_packet_decoder(media, &pkt);
 	if (d && pkt.size) {
 		av_packet_ref(&new_pkt, &pkt);
+
+		pthread_mutex_lock(&media->pipe_mutex);
 		mp_decode_push_packet(d, &new_pkt);
+		pthread_mutex_unlock(&media->pipe_mutex);
+
+		os_event_signal(media->decode_event);
 	}
 
 	av_packet_unref(&pkt);
@@ -169,18 +181,13 @@ static int mp_media_next_packet(mp_media_t *media)
 
 static inline bool mp_media_ready_to_start(mp_media_t *m)
 {
-	if (m->has_audio && !m->a.eof && !m->a.frame_ready)
+	if (m->has_audio && !m->a.out_eof && !m->a.out_ready)
 		return false;
-	if (m->has_video && !m->v.eof && !m->v.frame_ready)
+	if (m->has_video && !m->v.out_eof && !m->v.out_ready)
 		return false;
 	return true;
 }
 
-static inline bool mp_decode_frame(struct mp_decode *d)
-{
-	return d->frame_ready || mp_decode_next(d);
-}
-
 static inline int get_sws_colorspace(enum AVColorSpace cs)
 {
 	switch (cs) {
@@ -225,49 +232,388 @@ static bool mp_media_init_scaling(mp_media_t *m)
 
 	sws_setColorspaceDetails(m->swscale, coeff, range, coeff, range, 0,
 				 FIXED_1_0, FIXED_1_0);
+	return true;
+}
+
+/* ------------------------------------------------------------------------- */
+/* demux thread: reads packets ahead of the decoders until every stream has
+ * enough of them queued */
+
+#define MAX_QUEUED_PACKETS 64
+
+static inline bool enough_packets(struct mp_decode *d)
+{
+	return d->input.size >= MAX_QUEUED_PACKETS * sizeof(AVPacket);
+}
+
+static bool mp_demux_wait(mp_media_t *m)
+{
+	bool kill;
+
+	pthread_mutex_lock(&m->pipe_mutex);
+
+	while (!m->pipe_kill) {
+		bool enough = (!m->has_video || enough_packets(&m->v)) &&
+			      (!m->has_audio || enough_packets(&m->a));
+
+		if (!m->pipe_pause && !m->demux_eof && !enough)
+			break;
+
+		if (!m->demux_idle) {
+			m->demux_idle = true;
+			os_event_signal(m->idle_event);
+		}
+
+		pthread_mutex_unlock(&m->pipe_mutex);
+		os_event_wait(m->demux_event);
+		pthread_mutex_lock(&m->pipe_mutex);
+	}
+
+	kill = m->pipe_kill;
+	m->demux_idle = false;
+	pthread_mutex_unlock(&m->pipe_mutex);
+	return !kill;
+}
+
+static void *mp_demux_thread(void *opaque)
+{
+	mp_media_t *m = opaque;
+
+	os_set_thread_name("mp_demux_thread");
 
-	int ret = av_image_alloc(m->scale_pic, m->scale_linesizes,
-				 m->v.decoder->width, m->v.decoder->height,
-				 m->scale_format, 32);
+	while (mp_demux_wait(m)) {
+		int ret = mp_media_next_packet(m);
+		if (ret >= 0)
+			continue;
+
+		pthread_mutex_lock(&m->pipe_mutex);
+		m->demux_eof = true;
+		if (ret != AVERROR_EOF && ret != AVERROR_EXIT)
+			m->demux_error = true;
+		pthread_mutex_unlock(&m->pipe_mutex);
+
+		os_event_signal(m->decode_event);
+		os_event_signal(m->frame_event);
+	}
+
+	return NULL;
+}
+
+/* ------------------------------------------------------------------------- */
+/* decode thread: decodes and converts frames until the frame queues of the
+ * streams are full */
+
+static AVFrame *mp_media_scale_frame(mp_media_t *m, const AVFrame *src)
+{
+	int width = m->v.decoder->width;
+	int height = m->v.decoder->height;
+	AVFrame *dst;
+	int ret;
+
+	pthread_mutex_lock(&m->pipe_mutex);
+	dst = mp_decode_get_free_frame(&m->v);
+	pthread_mutex_unlock(&m->pipe_mutex);
+
+	if (dst && (dst->width != width || dst->height != height ||
+		    dst->format != m->scale_format))
+		av_frame_free(&dst);
+
+	if (!dst) {
+		dst = av_frame_alloc();
+		dst->format = m->scale_format;
+		dst->width = width;
+		dst->height = height;
+
+		if (av_frame_get_buffer(dst, 32) < 0) {
+			blog(LOG_WARNING, "MP: Failed to allocate frame");
+			av_frame_free(&dst);
+			return NULL;
+		}
+	}
+
+	ret = sws_scale(m->swscale, (const uint8_t *const *)src->data,
+			src->linesize, 0, src->height, dst->data,
+			dst->linesize);
 	if (ret < 0) {
-		blog(LOG_WARNING, "MP: Failed to create scale pic data");
-		return false;
+		av_frame_free(&dst);
+		return NULL;
 	}
 
-	return true;
+	dst->colorspace = src->colorspace;
+	dst->color_range = src->color_range;
+	dst->color_trc = src->color_trc;
+	dst->key_frame = src->key_frame;
+	return dst;
 }
 
-static bool mp_media_prepare_frames(mp_media_t *m)
+static void mp_media_queue_frame(mp_media_t *m, struct mp_decode *d)
 {
-	bool actively_seeking = m->seek_next_ts && m->pause;
-
-	while (!mp_media_ready_to_start(m)) {
-		if (!m->eof) {
-			int ret = mp_media_next_packet(m);
-			if (ret == AVERROR_EOF || ret == AVERROR_EXIT) {
-				if (!actively_seeking) {
-					m->eof = true;
-				} else {
-					break;
-				}
-			} else if (ret < 0) {
-				return false;
-			}
+	struct mp_frame out = {0};
+	AVFrame *f = d->frame;
+
+	out.pts = d->frame_pts;
+	out.next_pts = d->next_pts;
+
+	if (!d->audio && !m->swscale) {
+		m->scale_format = closest_format(f->format);
+		if (m->scale_format != f->format)
+			mp_media_init_scaling(m);
+	}
+
+	if (!d->audio && m->swscale) {
+		uint64_t start = os_gettime_ns();
+
+		out.frame = mp_media_scale_frame(m, f);
+		out.scaled = true;
+
+		pthread_mutex_lock(&m->pipe_mutex);
+		m->convert_time_ns += os_gettime_ns() - start;
+		pthread_mutex_unlock(&m->pipe_mutex);
+
+		if (!out.frame)
+			return;
+	} else {
+		/* copies the data if the decoder owns the frame buffers */
+		out.frame = av_frame_alloc();
+		if (av_frame_ref(out.frame, f) < 0) {
+			av_frame_free(&out.frame);
+			return;
 		}
+	}
 
-		if (m->has_video && !mp_decode_frame(&m->v))
-			return false;
-		if (m->has_audio && !mp_decode_frame(&m->a))
-			return false;
+	pthread_mutex_lock(&m->pipe_mutex);
+	mp_decode_push_frame(d, &out);
+	pthread_mutex_unlock(&m->pipe_mutex);
+}
+
+static void mp_media_decode(mp_media_t *m, struct mp_decode *d)
+{
+	uint64_t start = os_gettime_ns();
+	bool ready = mp_decode_next(d) && d->frame_ready;
+	uint64_t elapsed = os_gettime_ns() - start;
+
+	/* a decoder that fails while draining would never reach eof */
+	if (!ready && d->input_eof && !d->packets.size && !d->packet_pending)
+		d->eof = true;
+
+	/* frames before the seek position are decoded but never presented */
+	if (ready && d->next_pts <= d->skip_until) {
+		d->frame_ready = false;
+		ready = false;
+	} else if (ready) {
+		mp_media_queue_frame(m, d);
+		d->frame_ready = false;
+		d->skip_until = 0;
 	}
 
-	if (m->has_video && m->v.frame_ready && !m->swscale) {
-		m->scale_format = closest_format(m->v.frame->format);
-		if (m->scale_format != m->v.frame->format) {
-			if (!mp_media_init_scaling(m)) {
-				return false;
+	pthread_mutex_lock(&m->pipe_mutex);
+	if (d->eof)
+		d->frames_eof = true;
+	if (ready && !d->audio) {
+		m->decoded_frames++;
+		m->decode_time_ns += elapsed;
+		if (elapsed > m->max_decode_time_ns)
+			m->max_decode_time_ns = elapsed;
+	}
+	pthread_mutex_unlock(&m->pipe_mutex);
+
+	os_event_signal(m->frame_event);
+}
+
+/* picks the stream whose frame queue is the least full */
+static struct mp_decode *next_decode_work(mp_media_t *m)
+{
+	struct mp_decode *v = NULL;
+	struct mp_decode *a = NULL;
+
+	if (m->has_video && mp_decode_has_work(&m->v))
+		v = &m->v;
+	if (m->has_audio && mp_decode_has_work(&m->a))
+		a = &m->a;
+
+	if (v && a) {
+		size_t v_fill = mp_decode_queued_frames(v) * a->max_frames;
+		size_t a_fill = mp_decode_queued_frames(a) * v->max_frames;
+		return v_fill <= a_fill ? v : a;
+	}
+
+	return v ? v : a;
+}
+
+static void *mp_decode_thread(void *opaque)
+{
+	mp_media_t *m = opaque;
+
+	os_set_thread_name("mp_decode_thread");
+
+	for (;;) {
+		struct mp_decode *d = NULL;
+		bool took_input;
+
+		pthread_mutex_lock(&m->pipe_mutex);
+		while (!m->pipe_kill) {
+			if (!m->pipe_pause && (d = next_decode_work(m)) != NULL)
+				break;
+
+			if (!m->decode_idle) {
+				m->decode_idle = true;
+				os_event_signal(m->idle_event);
 			}
+
+			pthread_mutex_unlock(&m->pipe_mutex);
+			os_event_wait(m->decode_event);
+			pthread_mutex_lock(&m->pipe_mutex);
 		}
+
+		if (m->pipe_kill) {
+			pthread_mutex_unlock(&m->pipe_mutex);
+			break;
+		}
+
+		m->decode_idle = false;
+		took_input = mp_decode_take_input(d);
+		pthread_mutex_unlock(&m->pipe_mutex);
+
+		if (took_input)
+			os_event_signal(m->demux_event);
+
+		mp_media_decode(m, d);
+	}
+
+	return NULL;
+}
+
+/* ------------------------------------------------------------------------- */
+/* pipeline control, only called by the media thread */
+
+static bool mp_pipeline_start(mp_media_t *m)
+{
+	int lookahead = m->lookahead;
+
+	m->v.max_frames = (size_t)lookahead;
+	m->a.max_frames = (size_t)(lookahead * 2 > 8 ? lookahead * 2 : 8);
+
+	if (pthread_create(&m->demux_thread, NULL, mp_demux_thread, m) != 0) {
+		blog(LOG_WARNING, "MP: Could not create demux thread");
+		return false;
+	}
+	m->demux_thread_valid = true;
+
+	if (pthread_create(&m->decode_thread, NULL, mp_decode_thread, m) != 0) {
+		blog(LOG_WARNING, "MP: Could not create decode thread");
+		return false;
+	}
+	m->decode_thread_valid = true;
+	return true;
+}
+
+static void mp_pipeline_stop(mp_media_t *m)
+{
+	pthread_mutex_lock(&m->pipe_mutex);
+	m->pipe_kill = true;
+	pthread_mutex_unlock(&m->pipe_mutex);
+
+	os_event_signal(m->demux_event);
+	os_event_signal(m->decode_event);
+
+	if (m->demux_thread_valid)
+		pthread_join(m->demux_thread, NULL);
+	if (m->decode_thread_valid)
+		pthread_join(m->decode_thread, NULL);
+
+	m->demux_thread_valid = false;
+	m->decode_thread_valid = false;
+}
+
+/* waits for both threads to finish what they are doing so that the format
+ * context and the decoders can be used directly */
+static void mp_pipeline_pause(mp_media_t *m)
+{
+	if (!m->demux_thread_valid)
+		return;
+
+	pthread_mutex_lock(&m->pipe_mutex);
+	m->pipe_pause = true;
+	pthread_mutex_unlock(&m->pipe_mutex);
+
+	os_event_signal(m->demux_event);
+	os_event_signal(m->decode_event);
+
+	for (;;) {
+		bool idle;
+
+		pthread_mutex_lock(&m->pipe_mutex);
+		idle = m->demux_idle && m->decode_idle;
+		pthread_mutex_unlock(&m->pipe_mutex);
+
+		if (idle)
+			break;
+
+		os_event_wait(m->idle_event);
+	}
+}
+
+static void mp_pipeline_resume(mp_media_t *m)
+{
+	pthread_mutex_lock(&m->pipe_mutex);
+	m->pipe_pause = false;
+	m->demux_eof = false;
+	m->demux_error = false;
+	pthread_mutex_unlock(&m->pipe_mutex);
+
+	os_event_signal(m->demux_event);
+	os_event_signal(m->decode_event);
+}
+
+/* ------------------------------------------------------------------------- */
+/* media thread */
+
+static void mp_media_pop_frame(mp_media_t *m, struct mp_decode *d)
+{
+	if (m->cache_replaying) {
+		mp_cache_pop_frame(m, d);
+		return;
+	}
+
+	mp_cache_add(m, d);
+	mp_decode_pop_frame(d);
+	mp_cache_add(m, d);
+}
+
+static bool mp_media_prepare_frames(mp_media_t *m)
+{
+	bool waited = false;
+
+	for (;;) {
+		bool error, kill;
+
+		if (m->has_video)
+			mp_media_pop_frame(m, &m->v);
+		if (m->has_audio)
+			mp_media_pop_frame(m, &m->a);
+
+		mp_cache_check_complete(m);
+		if (mp_media_ready_to_start(m))
+			break;
+
+		pthread_mutex_lock(&m->pipe_mutex);
+		error = m->demux_error;
+		if (!waited)
+			m->decoder_waits++;
+		pthread_mutex_unlock(&m->pipe_mutex);
+
+		if (error)
+			return false;
+
+		pthread_mutex_lock(&m->mutex);
+		kill = m->kill;
+		pthread_mutex_unlock(&m->mutex);
+
+		if (kill)
+			break;
+
+		os_event_timedwait(m->frame_event, 100);
+		waited = true;
 	}
 
 	return true;
@@ -277,13 +623,13 @@ static inline int64_t mp_media_get_next_min_pts(mp_media_t *m)
 {
 	int64_t min_next_ns = 0x7FFFFFFFFFFFFFFFLL;
 
-	if (m->has_video && m->v.frame_ready) {
-		if (m->v.frame_pts < min_next_ns)
-			min_next_ns = m->v.frame_pts;
+	if (m->has_video && m->v.out_ready) {
+		if (m->v.out.pts < min_next_ns)
+			min_next_ns = m->v.out.pts;
 	}
-	if (m->has_audio && m->a.frame_ready) {
-		if (m->a.frame_pts < min_next_ns)
-			min_next_ns = m->a.frame_pts;
+	if (m->has_audio && m->a.out_ready) {
+		if (m->a.out.pts < min_next_ns)
+			min_next_ns = m->a.out.pts;
 	}
 
 	return min_next_ns;
@@ -293,29 +639,29 @@ static inline int64_t mp_media_get_base_pts(mp_media_t *m)
 {
 	int64_t base_ts = 0;
 
-	if (m->has_video && m->v.next_pts > base_ts)
-		base_ts = m->v.next_pts;
-	if (m->has_audio && m->a.next_pts > base_ts)
-		base_ts = m->a.next_pts;
+	if (m->has_video && m->v.out.next_pts > base_ts)
+		base_ts = m->v.out.next_pts;
+	if (m->has_audio && m->a.out.next_pts > base_ts)
+		base_ts = m->a.out.next_pts;
 
 	return base_ts;
 }
 
 static inline bool mp_media_can_play_frame(mp_media_t *m, struct mp_decode *d)
 {
-	return d->frame_ready && d->frame_pts <= m->next_pts_ns;
+	return d->out_ready && d->out.pts <= m->next_pts_ns;
 }
 
 static void mp_media_next_audio(mp_media_t *m)
 {
 	struct mp_decode *d = &m->a;
 	struct obs_source_audio audio = {0};
-	AVFrame *f = d->frame;
+	AVFrame *f = d->out.frame;
 
 	if (!mp_media_can_play_frame(m, d))
 		return;
 
-	d->frame_ready = false;
+	d->out_ready = false;
 	if (!m->a_cb)
 		return;
 
@@ -327,7 +673,7 @@ static void mp_media_next_audio(mp_media_t *m)
 	audio.format = convert_sample_format(f->format);
 	audio.frames = f->nb_samples;
 
-	audio.timestamp = m->base_ts + d->frame_pts - m->start_ts +
+	audio.timestamp = m->base_ts + d->out.pts - m->start_ts +
 			  m->play_sys_ts - base_sys_ts;
 
 	if (audio.format == AUDIO_FORMAT_UNKNOWN)
@@ -343,47 +689,32 @@ static void mp_media_next_video(mp_media_t *m, bool preload)
 	enum video_format new_format;
 	enum video_colorspace new_space;
 	enum video_range_type new_range;
-	AVFrame *f = d->frame;
+	AVFrame *f = d->out.frame;
 
 	if (!preload) {
 		if (!mp_media_can_play_frame(m, d))
 			return;
 
-		d->frame_ready = false;
+		d->out_ready = false;
 
 		if (!m->v_cb)
 			return;
-	} else if (!d->frame_ready) {
+	} else if (!d->out_ready) {
 		return;
 	}
 
-	bool flip = false;
-	if (m->swscale) {
-		int ret = sws_scale(m->swscale, (const uint8_t *const *)f->data,
-				    f->linesize, 0, f->height, m->scale_pic,
-				    m->scale_linesizes);
-		if (ret < 0)
-			return;
+	/* frames were already converted by the decode thread */
+	bool flip = f->linesize[0] < 0 && f->linesize[1] == 0;
 
-		flip = m->scale_linesizes[0] < 0 && m->scale_linesizes[1] == 0;
-		for (size_t i = 0; i < 4; i++) {
-			frame->data[i] = m->scale_pic[i];
-			frame->linesize[i] = abs(m->scale_linesizes[i]);
-		}
-
-	} else {
-		flip = f->linesize[0] < 0 && f->linesize[1] == 0;
-
-		for (size_t i = 0; i < MAX_AV_PLANES; i++) {
-			frame->data[i] = f->data[i];
-			frame->linesize[i] = abs(f->linesize[i]);
-		}
+	for (size_t i = 0; i < MAX_AV_PLANES; i++) {
+		frame->data[i] = f->data[i];
+		frame->linesize[i] = abs(f->linesize[i]);
 	}
 
 	if (flip)
 		frame->data[0] -= frame->linesize[0] * (f->height - 1);
 
-	new_format = convert_pixel_format(m->scale_format);
+	new_format = convert_pixel_format(f->format);
 	new_space = convert_color_space(f->colorspace, f->color_trc);
 	new_range = m->force_range == VIDEO_RANGE_DEFAULT
 			    ? convert_color_range(f->color_range)
@@ -414,7 +745,7 @@ static void mp_media_next_video(mp_media_t *m, bool preload)
 	if (frame->format == VIDEO_FORMAT_NONE)
 		return;
 
-	frame->timestamp = m->base_ts + d->frame_pts - m->start_ts +
+	frame->timestamp = m->base_ts + d->out.pts - m->start_ts +
 			   m->play_sys_ts - base_sys_ts;
 
 	frame->width = f->width;
@@ -462,6 +793,28 @@ static void mp_media_calc_next_ns(mp_media_t *m)
 	m->next_pts_ns = min_next_ns;
 }
 
+/* seeks the video stream straight to the keyframe before the position */
+static int seek_keyframe(mp_media_t *m, int64_t pos)
+{
+	struct mp_keyframe key;
+	AVStream *stream = m->v.stream;
+	int ret;
+
+	if (!m->has_video || !os_atomic_load_bool(&m->index_ready))
+		return -1;
+	if (m->index.stream_index != stream->index)
+		return -1;
+	if (!mp_keyframe_index_find(&m->index, pos, &key))
+		return -1;
+
+	ret = av_seek_frame(m->fmt, stream->index, key.ts,
+			    AVSEEK_FLAG_BACKWARD);
+	if (ret < 0 && key.pos >= 0 &&
+	    !(m->fmt->iformat->flags & AVFMT_NO_BYTE_SEEK))
+		ret = av_seek_frame(m->fmt, -1, key.pos, AVSEEK_FLAG_BYTE);
+	return ret;
+}
+
 static void seek_to(mp_media_t *m, int64_t pos)
 {
 	AVStream *stream = m->fmt->streams[0];
@@ -478,22 +831,43 @@ static void seek_to(mp_media_t *m, int64_t pos)
 						     stream->time_base)
 				      : seek_pos;
 
+	bool from_start = pos == m->fmt->start_time;
+
+	mp_pipeline_pause(m);
+
 	if (m->is_local_file) {
-		int ret = av_seek_frame(m->fmt, 0, seek_target, seek_flags);
-		if (ret < 0) {
-			blog(LOG_WARNING, "MP: Failed to seek: %s",
-			     av_err2str(ret));
-		}
+		if (m->has_video)
+			mp_decode_flush(&m->v);
+		if (m->has_audio)
+			mp_decode_flush(&m->a);
 	}
 
-	if (m->has_video && m->is_local_file) {
-		mp_decode_flush(&m->v);
-		if (m->seek_next_ts && m->pause && m->v_preload_cb &&
-		    mp_media_prepare_frames(m))
-			mp_media_next_video(m, true);
+	/* the pipeline stays paused while frames are replayed from memory */
+	if (!mp_cache_seek(m, from_start)) {
+		if (m->is_local_file) {
+			int ret = seek_keyframe(m, pos);
+			if (ret < 0)
+				ret = av_seek_frame(m->fmt, 0, seek_target,
+						    seek_flags);
+			if (ret < 0) {
+				blog(LOG_WARNING, "MP: Failed to seek: %s",
+				     av_err2str(ret));
+			}
+
+			/* frame pts are scaled by the playback speed */
+			if (!from_start) {
+				int64_t skip = pos * 1000 * 100 / m->speed;
+				m->v.skip_until = skip;
+				m->a.skip_until = skip;
+			}
+		}
+
+		mp_pipeline_resume(m);
 	}
-	if (m->has_audio && m->is_local_file)
-		mp_decode_flush(&m->a);
+
+	if (m->has_video && m->is_local_file && m->seek_next_ts && m->pause &&
+	    m->v_preload_cb && mp_media_prepare_frames(m))
+		mp_media_next_video(m, true);
 }
 
 static bool mp_media_reset(mp_media_t *m)
@@ -506,7 +880,6 @@ static bool mp_media_reset(mp_media_t *m)
 	int64_t next_ts = mp_media_get_base_pts(m);
 	int64_t offset = next_ts - m->next_pts_ns;
 
-	m->eof = false;
 	m->base_ts += next_ts;
 	m->seek_next_ts = false;
 
@@ -563,8 +936,8 @@ static inline bool mp_media_sleepto(mp_media_t *m)
 
 static inline bool mp_media_eof(mp_media_t *m)
 {
-	bool v_ended = !m->has_video || !m->v.frame_ready;
-	bool a_ended = !m->has_audio || !m->a.frame_ready;
+	bool v_ended = !m->has_video || !m->v.out_ready;
+	bool a_ended = !m->has_audio || !m->a.out_ready;
 	bool eof = v_ended && a_ended;
 
 	if (eof) {
@@ -595,6 +968,10 @@ static int interrupt_callback(void *data)
 		stop = m->kill || m->stopping;
 		pthread_mutex_unlock(&m->mutex);
 
+		pthread_mutex_lock(&m->pipe_mutex);
+		stop = stop || m->pipe_kill;
+		pthread_mutex_unlock(&m->pipe_mutex);
+
 		m->interrupt_poll_ts = ts;
 	}
 
@@ -675,6 +1052,12 @@ static inline bool mp_media_thread(mp_media_t *m)
 	if (!init_avformat(m)) {
 		return false;
 	}
+	if (!mp_pipeline_start(m)) {
+		return false;
+	}
+	if (m->has_video) {
+		mp_keyframe_index_start(m);
+	}
 	if (!mp_media_reset(m)) {
 		return false;
 	}
@@ -758,8 +1141,12 @@ static inline bool mp_media_thread(mp_media_t *m)
 static void *mp_media_thread_start(void *opaque)
 {
 	mp_media_t *m = opaque;
+	bool success = mp_media_thread(m);
 
-	if (!mp_media_thread(m)) {
+	mp_keyframe_index_stop(m);
+	mp_pipeline_stop(m);
+
+	if (!success) {
 		if (m->stop_cb) {
 			m->stop_cb(m->opaque);
 		}
@@ -768,8 +1155,7 @@ static void *mp_media_thread_start(void *opaque)
 	return NULL;
 }
 
-static inline bool mp_media_init_internal(mp_media_t *m,
-					  const struct mp_media_info *info)
+static bool mp_media_init_internal(mp_media_t *m)
 {
 	if (pthread_mutex_init(&m->mutex, NULL) != 0) {
 		blog(LOG_WARNING, "MP: Failed to init mutex");
@@ -779,10 +1165,17 @@ static inline bool mp_media_init_internal(mp_media_t *m,
 		blog(LOG_WARNING, "MP: Failed to init semaphore");
 		return false;
 	}
-
-	m->path = info->path ? bstrdup(info->path) : NULL;
-	m->format_name = info->format ? bstrdup(info->format) : NULL;
-	m->hw = info->hardware_decoding;
+	if (pthread_mutex_init(&m->pipe_mutex, NULL) != 0) {
+		blog(LOG_WARNING, "MP: Failed to init pipeline mutex");
+		return false;
+	}
+	if (os_event_init(&m->demux_event, OS_EVENT_TYPE_AUTO) != 0 ||
+	    os_event_init(&m->decode_event, OS_EVENT_TYPE_AUTO) != 0 ||
+	    os_event_init(&m->frame_event, OS_EVENT_TYPE_AUTO) != 0 ||
+	    os_event_init(&m->idle_event, OS_EVENT_TYPE_AUTO) != 0) {
+		blog(LOG_WARNING, "MP: Failed to init pipeline events");
+		return false;
+	}
 
 	if (pthread_create(&m->thread, NULL, mp_media_thread_start, m) != 0) {
 		blog(LOG_WARNING, "MP: Could not create media thread");
@@ -797,6 +1190,7 @@ bool mp_media_init(mp_media_t *media, const struct mp_media_info *info)
 {
 	memset(media, 0, sizeof(*media));
 	pthread_mutex_init_value(&media->mutex);
+	pthread_mutex_init_value(&media->pipe_mutex);
 	media->opaque = info->opaque;
 	media->v_cb = info->v_cb;
 	media->a_cb = info->a_cb;
@@ -808,9 +1202,19 @@ bool mp_media_init(mp_media_t *media, const struct mp_media_info *info)
 	media->buffering = info->buffering;
 	media->speed = info->speed;
 	media->is_local_file = info->is_local_file;
+	media->lookahead = info->lookahead_frames;
+	media->path = info->path ? bstrdup(info->path) : NULL;
+	media->format_name = info->format ? bstrdup(info->format) : NULL;
+	media->hw = info->hardware_decoding;
+	media->cache_budget = (size_t)info->cache_size_mb * 1024 * 1024;
+	media->index_dir = info->index_cache_dir
+				   ? bstrdup(info->index_cache_dir)
+				   : NULL;
 
 	if (!info->is_local_file || media->speed < 1 || media->speed > 200)
 		media->speed = 100;
+	if (media->lookahead < 1 || media->lookahead > MP_MAX_LOOKAHEAD)
+		media->lookahead = MP_DEFAULT_LOOKAHEAD;
 
 	static bool initialized = false;
 	if (!initialized) {
@@ -826,7 +1230,11 @@ bool mp_media_init(mp_media_t *media, const struct mp_media_info *info)
 	if (!base_sys_ts)
 		base_sys_ts = (int64_t)os_gettime_ns();
 
-	if (!mp_media_init_internal(media, info)) {
+	if (info->shareable && media->is_local_file &&
+	    mp_share_subscribe(media))
+		return true;
+
+	if (!mp_media_init_internal(media)) {
 		mp_media_free(media);
 		return false;
 	}
@@ -834,6 +1242,24 @@ bool mp_media_init(mp_media_t *media, const struct mp_media_info *info)
 	return true;
 }
 
+/* gives a media playing through a shared decoder a decoder of its own,
+ * optionally continuing from where the shared playback currently is */
+static void mp_media_detach(mp_media_t *m, bool resume)
+{
+	int64_t pos;
+	bool loop;
+	bool active = mp_share_leave(m, &pos, &loop);
+
+	if (!mp_media_init_internal(m))
+		return;
+
+	if (resume && active) {
+		mp_media_play(m, loop, false);
+		if (pos)
+			mp_media_seek_to(m, pos);
+	}
+}
+
 static void mp_kill_thread(mp_media_t *m)
 {
 	if (m->thread_valid) {
@@ -851,23 +1277,40 @@ void mp_media_free(mp_media_t *media)
 	if (!media)
 		return;
 
+	if (media->share)
+		mp_share_unsubscribe(media);
+
 	mp_media_stop(media);
 	mp_kill_thread(media);
+	mp_cache_free(media);
+	mp_keyframe_index_free(&media->index);
 	mp_decode_free(&media->v);
 	mp_decode_free(&media->a);
 	avformat_close_input(&media->fmt);
 	pthread_mutex_destroy(&media->mutex);
+	pthread_mutex_destroy(&media->pipe_mutex);
 	os_sem_destroy(media->sem);
+	os_event_destroy(media->demux_event);
+	os_event_destroy(media->decode_event);
+	os_event_destroy(media->frame_event);
+	os_event_destroy(media->idle_event);
 	sws_freeContext(media->swscale);
-	av_freep(&media->scale_pic[0]);
 	bfree(media->path);
 	bfree(media->format_name);
+	bfree(media->index_dir);
 	memset(media, 0, sizeof(*media));
 	pthread_mutex_init_value(&media->mutex);
+	pthread_mutex_init_value(&media->pipe_mutex);
 }
 
 void mp_media_play(mp_media_t *m, bool loop, bool reconnecting)
 {
+	if (m->share) {
+		if (mp_share_play(m, loop))
+			return;
+		mp_media_detach(m, false);
+	}
+
 	pthread_mutex_lock(&m->mutex);
 
 	if (m->active)
@@ -884,6 +1327,14 @@ void mp_media_play(mp_media_t *m, bool loop, bool reconnecting)
 
 void mp_media_play_pause(mp_media_t *m, bool pause)
 {
+	if (m->share) {
+		if (mp_share_alone(m)) {
+			mp_media_play_pause(mp_share_get_media(m), pause);
+			return;
+		}
+		mp_media_detach(m, true);
+	}
+
 	pthread_mutex_lock(&m->mutex);
 	if (m->active) {
 		m->pause = pause;
@@ -896,6 +1347,11 @@ void mp_media_play_pause(mp_media_t *m, bool pause)
 
 void mp_media_stop(mp_media_t *m)
 {
+	if (m->share) {
+		mp_share_stop(m);
+		return;
+	}
+
 	pthread_mutex_lock(&m->mutex);
 	if (m->active) {
 		m->reset = true;
@@ -909,11 +1365,22 @@ void mp_media_stop(mp_media_t *m)
 
 int64_t mp_get_current_time(mp_media_t *m)
 {
+	if (m->share)
+		return mp_get_current_time(mp_share_get_media(m));
+
 	return mp_media_get_base_pts(m) * (int64_t)m->speed / 100000000LL;
 }
 
 void mp_media_seek_to(mp_media_t *m, int64_t pos)
 {
+	if (m->share) {
+		if (mp_share_alone(m)) {
+			mp_media_seek_to(mp_share_get_media(m), pos);
+			return;
+		}
+		mp_media_detach(m, true);
+	}
+
 	pthread_mutex_lock(&m->mutex);
 	if (m->active) {
 		m->seek = true;
@@ -923,3 +1390,39 @@ void mp_media_seek_to(mp_media_t *m, int64_t pos)
 
 	os_sem_post(m->sem);
 }
+
+void mp_media_get_stats(mp_media_t *m, struct obs_source_media_stats *stats)
+{
+	if (m->share) {
+		mp_media_get_stats(mp_share_get_media(m), stats);
+		return;
+	}
+
+	memset(stats, 0, sizeof(*stats));
+
+	pthread_mutex_lock(&m->pipe_mutex);
+	stats->queued_video_frames = (uint32_t)mp_decode_queued_frames(&m->v);
+	stats->queued_audio_frames = (uint32_t)mp_decode_queued_frames(&m->a);
+	stats->max_video_frames = (uint32_t)m->v.max_frames;
+	stats->queued_packets =
+		(uint32_t)((m->v.input.size + m->a.input.size) /
+			   sizeof(AVPacket));
+	stats->decoded_video_frames = m->decoded_frames;
+	stats->video_decode_time_ns = m->decode_time_ns;
+	stats->max_video_decode_time_ns = m->max_decode_time_ns;
+	stats->video_convert_time_ns = m->convert_time_ns;
+	stats->decoder_waits = m->decoder_waits;
+	stats->cache_budget = m->cache_budget;
+	stats->cache_size = m->cache_size;
+	stats->cache_hits = m->cache_hits;
+	stats->cache_replays = m->cache_replays;
+	pthread_mutex_unlock(&m->pipe_mutex);
+
+	if (os_atomic_load_bool(&m->index_ready))
+		stats->indexed_keyframes = (uint32_t)m->index.keys.num;
+}
+
+AVFormatContext *mp_media_get_format(mp_media_t *m)
+{
+	return m->share ? mp_share_get_media(m)->fmt : m->fmt;
+}
@@ -18,6 +18,7 @@
 
 #include <obs.h>
 #include "decode.h"
+#include "keyframe-index.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -38,6 +39,8 @@ extern "C" {
 #pragma warning(pop)
 #endif
 
+struct mp_share;
+
 typedef void (*mp_video_cb)(void *opaque, struct obs_source_frame *frame);
 typedef void (*mp_audio_cb)(void *opaque, struct obs_source_audio *audio);
 typedef void (*mp_stop_cb)(void *opaque);
@@ -59,8 +62,6 @@ struct mp_media {
 
 	enum AVPixelFormat scale_format;
 	struct SwsContext *swscale;
-	int scale_linesizes[4];
-	uint8_t *scale_pic[4];
 
 	struct mp_decode v;
 	struct mp_decode a;
@@ -69,7 +70,6 @@ struct mp_media {
 	bool has_video;
 	bool has_audio;
 	bool is_file;
-	bool eof;
 	bool hw;
 
 	struct obs_source_frame obsframe;
@@ -102,6 +102,54 @@ struct mp_media {
 	bool seek;
 	bool seek_next_ts;
 	int64_t seek_pos;
+
+	/* demuxing and decoding run on their own threads, ahead of the media
+	 * thread which only presents the decoded frames on time */
+	pthread_mutex_t pipe_mutex;
+	os_event_t *demux_event;
+	os_event_t *decode_event;
+	os_event_t *frame_event;
+	os_event_t *idle_event;
+	pthread_t demux_thread;
+	pthread_t decode_thread;
+	bool demux_thread_valid;
+	bool decode_thread_valid;
+	bool pipe_pause;
+	bool pipe_kill;
+	bool demux_idle;
+	bool decode_idle;
+	bool demux_eof;
+	bool demux_error;
+	int lookahead;
+
+	uint64_t decoded_frames;
+	uint64_t decode_time_ns;
+	uint64_t max_decode_time_ns;
+	uint64_t convert_time_ns;
+	uint64_t decoder_waits;
+
+	/* decoded frames kept in memory, see cache.h */
+	size_t cache_budget;
+	size_t cache_size;
+	bool cache_filling;
+	bool cache_complete;
+	bool cache_failed;
+	bool cache_replaying;
+	uint64_t cache_hits;
+	uint64_t cache_replays;
+
+	/* keyframes of local files, see keyframe-index.h */
+	char *index_dir;
+	struct mp_keyframe_index index;
+	pthread_t index_thread;
+	bool index_thread_valid;
+	volatile bool index_ready;
+	volatile bool index_kill;
+
+	/* set while the media plays through a decoder shared with other
+	 * media, see share.h */
+	struct mp_share *share;
+	bool share_active;
 };
 
 typedef struct mp_media mp_media_t;
@@ -124,6 +172,10 @@ struct mp_media_info {
 	bool hardware_decoding;
 	bool is_local_file;
 	bool reconnecting;
+	int lookahead_frames;
+	int cache_size_mb;
+	bool shareable;
+	const char *index_cache_dir;
 };
 
 extern bool mp_media_init(mp_media_t *media, const struct mp_media_info *info);
@@ -134,6 +186,12 @@ extern void mp_media_stop(mp_media_t *media);
 extern void mp_media_play_pause(mp_media_t *media, bool pause);
 extern int64_t mp_get_current_time(mp_media_t *m);
 extern void mp_media_seek_to(mp_media_t *m, int64_t pos);
+extern void mp_media_get_stats(mp_media_t *m,
+			       struct obs_source_media_stats *stats);
+extern AVFormatContext *mp_media_get_format(mp_media_t *m);
+
+#define MP_DEFAULT_LOOKAHEAD 4
+#define MP_MAX_LOOKAHEAD 60
 
 /* #define DETAILED_DEBUG_INFO */
 
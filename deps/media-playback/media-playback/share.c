@@ -0,0 +1,452 @@
+/*
+ * Copyright (c) 2021 Hugh Bailey <obs.jim@gmail.com>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#include <util/platform.h>
+#include <util/darray.h>
+
+#include "share.h"
+
+struct mp_share {
+	mp_media_t media;
+
+	/* subscribers, and whether they are playing, are protected by the
+	 * mutex because the callbacks of the shared media go through them */
+	pthread_mutex_t mutex;
+	DARRAY(mp_media_t *) subscribers;
+
+	/* the subscriber whose stop callback is running, unsubscribing it
+	 * waits for the callback to return */
+	pthread_cond_t stop_cond;
+	mp_media_t *stopping;
+	pthread_t stop_thread;
+
+	/* the last subscriber left from within its stop callback, which runs
+	 * on the thread of the shared media, so the media cannot be freed
+	 * there.  share_stopped has it destroyed once it is done with it. */
+	bool destroy_pending;
+};
+
+static pthread_mutex_t shares_mutex = PTHREAD_MUTEX_INITIALIZER;
+static DARRAY(struct mp_share *) shares;
+
+/* shares destroyed in the background, see share_destroy_async */
+static pthread_cond_t destroys_cond = PTHREAD_COND_INITIALIZER;
+static size_t pending_destroys;
+
+static void share_video(void *opaque, struct obs_source_frame *frame)
+{
+	struct mp_share *share = opaque;
+
+	pthread_mutex_lock(&share->mutex);
+	for (size_t i = 0; i < share->subscribers.num; i++) {
+		mp_media_t *m = share->subscribers.array[i];
+		if (m->share_active && m->v_cb)
+			m->v_cb(m->opaque, frame);
+	}
+	pthread_mutex_unlock(&share->mutex);
+}
+
+static void share_audio(void *opaque, struct obs_source_audio *audio)
+{
+	struct mp_share *share = opaque;
+
+	pthread_mutex_lock(&share->mutex);
+	for (size_t i = 0; i < share->subscribers.num; i++) {
+		mp_media_t *m = share->subscribers.array[i];
+		if (m->share_active && m->a_cb)
+			m->a_cb(m->opaque, audio);
+	}
+	pthread_mutex_unlock(&share->mutex);
+}
+
+static void share_preload(void *opaque, struct obs_source_frame *frame)
+{
+	struct mp_share *share = opaque;
+
+	pthread_mutex_lock(&share->mutex);
+	for (size_t i = 0; i < share->subscribers.num; i++) {
+		mp_media_t *m = share->subscribers.array[i];
+		if (m->v_preload_cb)
+			m->v_preload_cb(m->opaque, frame);
+	}
+	pthread_mutex_unlock(&share->mutex);
+}
+
+static void share_seek(void *opaque, struct obs_source_frame *frame)
+{
+	struct mp_share *share = opaque;
+
+	pthread_mutex_lock(&share->mutex);
+	for (size_t i = 0; i < share->subscribers.num; i++) {
+		mp_media_t *m = share->subscribers.array[i];
+		if (m->v_seek_cb)
+			m->v_seek_cb(m->opaque, frame);
+	}
+	pthread_mutex_unlock(&share->mutex);
+}
+
+static void share_destroy(struct mp_share *share);
+
+static void share_destroy_task(void *param)
+{
+	share_destroy(param);
+
+	pthread_mutex_lock(&shares_mutex);
+	pending_destroys--;
+	pthread_cond_broadcast(&destroys_cond);
+	pthread_mutex_unlock(&shares_mutex);
+}
+
+static void *share_destroy_thread(void *param)
+{
+	os_set_thread_name("mp_share_destroy");
+	share_destroy_task(param);
+	return NULL;
+}
+
+/* freeing the shared media joins its thread, so the share is destroyed from
+ * another thread */
+static void share_destroy_async(struct mp_share *share)
+{
+	os_task_scheduler_t *ts = obs_get_task_scheduler();
+	pthread_t thread;
+
+	if (ts && os_task_scheduler_queue(ts, share_destroy_task, share,
+					  OS_TASK_PRIORITY_LOW, -1))
+		return;
+
+	if (pthread_create(&thread, NULL, share_destroy_thread, share) == 0)
+		pthread_detach(thread);
+	else
+		blog(LOG_ERROR, "MP: Failed to create share destroy thread");
+}
+
+static inline bool subscribed(struct mp_share *share, mp_media_t *m)
+{
+	for (size_t i = 0; i < share->subscribers.num; i++) {
+		if (share->subscribers.array[i] == m)
+			return true;
+	}
+
+	return false;
+}
+
+/* stop callbacks are called without the mutex held, they may very well
+ * restart the media from within.  a subscriber that unsubscribed in the
+ * meantime is skipped, and one that unsubscribes while its callback runs
+ * waits for the callback to return. */
+static void share_stopped(void *opaque)
+{
+	struct mp_share *share = opaque;
+	DARRAY(mp_media_t *) stopped;
+	bool destroy;
+
+	da_init(stopped);
+
+	pthread_mutex_lock(&share->mutex);
+	for (size_t i = 0; i < share->subscribers.num; i++) {
+		mp_media_t *m = share->subscribers.array[i];
+
+		if (!m->share_active)
+			continue;
+
+		m->share_active = false;
+		if (m->stop_cb)
+			da_push_back(stopped, &m);
+	}
+
+	for (size_t i = 0; i < stopped.num; i++) {
+		mp_media_t *m = stopped.array[i];
+		mp_stop_cb stop_cb;
+		void *cb_opaque;
+
+		if (!subscribed(share, m))
+			continue;
+
+		stop_cb = m->stop_cb;
+		cb_opaque = m->opaque;
+		share->stopping = m;
+		share->stop_thread = pthread_self();
+		pthread_mutex_unlock(&share->mutex);
+
+		stop_cb(cb_opaque);
+
+		pthread_mutex_lock(&share->mutex);
+		share->stopping = NULL;
+		pthread_cond_broadcast(&share->stop_cond);
+	}
+
+	destroy = share->destroy_pending;
+	pthread_mutex_unlock(&share->mutex);
+
+	da_free(stopped);
+
+	if (destroy)
+		share_destroy_async(share);
+}
+
+static inline bool share_looping(struct mp_share *share)
+{
+	bool looping;
+
+	pthread_mutex_lock(&share->media.mutex);
+	looping = share->media.looping;
+	pthread_mutex_unlock(&share->media.mutex);
+
+	return looping;
+}
+
+static inline bool share_compatible(struct mp_share *share, mp_media_t *m)
+{
+	mp_media_t *s = &share->media;
+
+	return strcmp(s->path, m->path) == 0 && s->speed == m->speed &&
+	       s->force_range == m->force_range &&
+	       s->is_linear_alpha == m->is_linear_alpha && s->hw == m->hw &&
+	       s->lookahead == m->lookahead &&
+	       s->cache_budget == m->cache_budget;
+}
+
+static struct mp_share *share_create(mp_media_t *m)
+{
+	struct mp_share *share = bzalloc(sizeof(struct mp_share));
+	struct mp_media_info info = {
+		.opaque = share,
+		.v_cb = share_video,
+		.v_preload_cb = share_preload,
+		.v_seek_cb = share_seek,
+		.a_cb = share_audio,
+		.stop_cb = share_stopped,
+		.path = m->path,
+		.speed = m->speed,
+		.force_range = m->force_range,
+		.is_linear_alpha = m->is_linear_alpha,
+		.hardware_decoding = m->hw,
+		.is_local_file = true,
+		.lookahead_frames = m->lookahead,
+		.cache_size_mb = (int)(m->cache_budget / (1024 * 1024)),
+		.index_cache_dir = m->index_dir,
+	};
+
+	if (pthread_mutex_init(&share->mutex, NULL) != 0) {
+		bfree(share);
+		return NULL;
+	}
+	if (pthread_cond_init(&share->stop_cond, NULL) != 0) {
+		pthread_mutex_destroy(&share->mutex);
+		bfree(share);
+		return NULL;
+	}
+	if (!mp_media_init(&share->media, &info)) {
+		pthread_cond_destroy(&share->stop_cond);
+		pthread_mutex_destroy(&share->mutex);
+		bfree(share);
+		return NULL;
+	}
+
+	return share;
+}
+
+static void share_destroy(struct mp_share *share)
+{
+	mp_media_free(&share->media);
+	pthread_cond_destroy(&share->stop_cond);
+	pthread_mutex_destroy(&share->mutex);
+	da_free(share->subscribers);
+	bfree(share);
+}
+
+bool mp_share_subscribe(mp_media_t *m)
+{
+	struct mp_share *share = NULL;
+
+	if (!m->path || !*m->path || m->format_name)
+		return false;
+
+	pthread_mutex_lock(&shares_mutex);
+
+	for (size_t i = 0; i < shares.num; i++) {
+		if (share_compatible(shares.array[i], m)) {
+			share = shares.array[i];
+			break;
+		}
+	}
+
+	if (!share) {
+		share = share_create(m);
+		if (share)
+			da_push_back(shares, &share);
+	}
+
+	if (share) {
+		pthread_mutex_lock(&share->mutex);
+		da_push_back(share->subscribers, &m);
+		m->share = share;
+		m->share_active = false;
+		pthread_mutex_unlock(&share->mutex);
+	}
+
+	pthread_mutex_unlock(&shares_mutex);
+	return share != NULL;
+}
+
+static inline bool others_active(struct mp_share *share, mp_media_t *m)
+{
+	for (size_t i = 0; i < share->subscribers.num; i++) {
+		mp_media_t *sub = share->subscribers.array[i];
+		if (sub != m && sub->share_active)
+			return true;
+	}
+
+	return false;
+}
+
+void mp_share_unsubscribe(mp_media_t *m)
+{
+	struct mp_share *share = m->share;
+	bool in_stop_cb;
+	bool destroy;
+	bool active;
+
+	if (!share)
+		return;
+
+	pthread_mutex_lock(&shares_mutex);
+
+	pthread_mutex_lock(&share->mutex);
+	da_erase_item(share->subscribers, &m);
+	destroy = share->subscribers.num == 0;
+	active = others_active(share, NULL);
+	in_stop_cb = share->stopping == m &&
+		     pthread_equal(share->stop_thread, pthread_self());
+	if (destroy && in_stop_cb)
+		share->destroy_pending = true;
+	pthread_mutex_unlock(&share->mutex);
+
+	if (destroy)
+		da_erase_item(shares, &share);
+	if (destroy && in_stop_cb)
+		pending_destroys++;
+
+	pthread_mutex_unlock(&shares_mutex);
+
+	/* m may be freed once this returns */
+	pthread_mutex_lock(&share->mutex);
+	while (share->stopping == m && !in_stop_cb)
+		pthread_cond_wait(&share->stop_cond, &share->mutex);
+	pthread_mutex_unlock(&share->mutex);
+
+	m->share = NULL;
+	m->share_active = false;
+
+	if (destroy) {
+		if (!in_stop_cb)
+			share_destroy(share);
+	} else if (!active) {
+		mp_media_stop(&share->media);
+	}
+}
+
+void mp_share_wait(void)
+{
+	pthread_mutex_lock(&shares_mutex);
+	while (pending_destroys)
+		pthread_cond_wait(&destroys_cond, &shares_mutex);
+	pthread_mutex_unlock(&shares_mutex);
+}
+
+/* leaves the shared media before playback diverges, returning whether the
+ * media was playing and where */
+bool mp_share_leave(mp_media_t *m, int64_t *pos, bool *loop)
+{
+	struct mp_share *share = m->share;
+	bool active;
+
+	pthread_mutex_lock(&share->mutex);
+	active = m->share_active;
+	pthread_mutex_unlock(&share->mutex);
+
+	*pos = mp_get_current_time(&share->media);
+	*loop = share_looping(share);
+
+	mp_share_unsubscribe(m);
+	return active;
+}
+
+/* starts playing the shared media if nothing else plays it.  a looping media
+ * can join a shared media that is already looping, anything else would
+ * restart it for the other subscribers and has to play on its own. */
+bool mp_share_play(mp_media_t *m, bool loop)
+{
+	struct mp_share *share = m->share;
+	bool looping = share_looping(share);
+	bool start = false;
+	bool joined = true;
+
+	pthread_mutex_lock(&share->mutex);
+
+	if (!others_active(share, m)) {
+		m->share_active = true;
+		start = true;
+	} else if (!m->share_active && loop && looping) {
+		m->share_active = true;
+	} else {
+		joined = false;
+	}
+
+	pthread_mutex_unlock(&share->mutex);
+
+	if (start)
+		mp_media_play(&share->media, loop, false);
+	return joined;
+}
+
+void mp_share_stop(mp_media_t *m)
+{
+	struct mp_share *share = m->share;
+	bool was_active;
+	bool alone;
+
+	pthread_mutex_lock(&share->mutex);
+	was_active = m->share_active;
+	alone = !others_active(share, m);
+	if (!alone)
+		m->share_active = false;
+	pthread_mutex_unlock(&share->mutex);
+
+	if (alone)
+		mp_media_stop(&share->media);
+	else if (was_active && m->stop_cb)
+		m->stop_cb(m->opaque);
+}
+
+bool mp_share_alone(mp_media_t *m)
+{
+	struct mp_share *share = m->share;
+	bool alone;
+
+	pthread_mutex_lock(&share->mutex);
+	alone = !others_active(share, m);
+	pthread_mutex_unlock(&share->mutex);
+
+	return alone;
+}
+
+mp_media_t *mp_share_get_media(mp_media_t *m)
+{
+	return &m->share->media;
+}
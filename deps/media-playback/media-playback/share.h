@@ -0,0 +1,49 @@
+/*
+ * Copyright (c) 2021 Hugh Bailey <obs.jim@gmail.com>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#pragma once
+
+#include "media.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Media that play the same local file with the same settings can share a
+ * single decoder.  Each of them keeps its own mp_media_t, which subscribes to
+ * the shared media instead of starting threads of its own, and receives the
+ * frames of the shared media for as long as its playback does not diverge
+ * from the other subscribers.
+ */
+
+extern bool mp_share_subscribe(mp_media_t *m);
+extern void mp_share_unsubscribe(mp_media_t *m);
+
+extern bool mp_share_leave(mp_media_t *m, int64_t *pos, bool *loop);
+extern bool mp_share_play(mp_media_t *m, bool loop);
+extern void mp_share_stop(mp_media_t *m);
+extern bool mp_share_alone(mp_media_t *m);
+
+/* waits for shared media that are being destroyed in the background, which
+ * happens when the last subscriber leaves from within its stop callback */
+extern void mp_share_wait(void);
+extern mp_media_t *mp_share_get_media(mp_media_t *m);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,366 @@
+/******************************************************************************
+    Copyright (C) 2021 by Hugh Bailey <obs.jim@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include <util/platform.h>
+#include <util/dstr.h>
+#include <util/file-serializer.h>
+#include "gl-subsystem.h"
+
+/*
+ * Program binary cache
+ *
+ * Linked programs are saved with glGetProgramBinary and loaded back with
+ * glProgramBinary, keyed by the GLSL of both shaders and the driver's
+ * vendor, renderer and version strings.  The hashes of shaders that have
+ * compiled successfully with this driver are kept in an index, and those
+ * shaders are only compiled once a program using them actually has to be
+ * linked, which on a warm start is never.
+ */
+
+#define PROGRAM_CACHE_MAGIC 0x50474F42 /* "BOGP" */
+#define PROGRAM_CACHE_VERSION 1
+
+#define MAX_PROGRAM_BINARY (64 * 1024 * 1024)
+#define MAX_INDEX_SHADERS 65536
+
+#define FNV_OFFSET 0xCBF29CE484222325ULL
+#define FNV_PRIME 0x100000001B3ULL
+
+struct program_cache_header {
+	uint32_t magic;
+	uint32_t version;
+	uint64_t key;
+	uint32_t format;
+	uint32_t size;
+};
+
+struct shader_index_header {
+	uint32_t magic;
+	uint32_t version;
+	uint64_t driver_hash;
+	uint32_t num;
+	uint32_t reserved;
+};
+
+static uint64_t hash_data(uint64_t hash, const void *data, size_t size)
+{
+	const uint8_t *bytes = data;
+
+	for (size_t i = 0; i < size; i++) {
+		hash ^= bytes[i];
+		hash *= FNV_PRIME;
+	}
+
+	return hash;
+}
+
+uint64_t gl_program_cache_hash(const char *str)
+{
+	return hash_data(FNV_OFFSET, str, str ? strlen(str) : 0);
+}
+
+static inline uint64_t hash_gl_string(uint64_t hash, GLenum name)
+{
+	const char *str = (const char *)glGetString(name);
+
+	if (str)
+		hash = hash_data(hash, str, strlen(str) + 1);
+	return hash;
+}
+
+static void get_cache_file(struct dstr *file, const char *path,
+			   const char *name, uint64_t hash)
+{
+	dstr_copy(file, path);
+	dstr_replace(file, "\\", "/");
+	if (dstr_end(file) != '/')
+		dstr_cat_ch(file, '/');
+	dstr_catf(file, "gl-%s%016llx.bin", name, (unsigned long long)hash);
+}
+
+void gl_program_cache_init(gs_device_t *device)
+{
+	GLint num_formats = 0;
+	uint64_t hash = FNV_OFFSET;
+
+	hash = hash_gl_string(hash, GL_VENDOR);
+	hash = hash_gl_string(hash, GL_RENDERER);
+	hash = hash_gl_string(hash, GL_VERSION);
+	device->driver_hash = hash;
+
+	if (GLAD_GL_VERSION_4_1 || GLAD_GL_ARB_get_program_binary) {
+		glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &num_formats);
+		gl_success("glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS)");
+	}
+
+	device->program_binary_supported = num_formats > 0;
+	if (!device->program_binary_supported)
+		blog(LOG_INFO, "OpenGL program binaries are not supported, "
+			       "shader programs will not be cached");
+}
+
+/* ------------------------------------------------------------------------- */
+
+static void load_shader_index(gs_device_t *device)
+{
+	struct shader_index_header header;
+	struct serializer s;
+	struct dstr file = {0};
+	bool success;
+
+	get_cache_file(&file, device->program_cache_path, "shaders-",
+		       device->driver_hash);
+	success = file_input_serializer_init(&s, file.array);
+	dstr_free(&file);
+
+	if (!success)
+		return;
+
+	success = s_read(&s, &header, sizeof(header)) == sizeof(header) &&
+		  header.magic == PROGRAM_CACHE_MAGIC &&
+		  header.version == PROGRAM_CACHE_VERSION &&
+		  header.driver_hash == device->driver_hash &&
+		  header.num <= MAX_INDEX_SHADERS;
+
+	if (success) {
+		size_t size = header.num * sizeof(uint64_t);
+
+		da_resize(device->compiled_shaders, header.num);
+		if (s_read(&s, device->compiled_shaders.array, size) != size)
+			da_resize(device->compiled_shaders, 0);
+	}
+
+	file_input_serializer_free(&s);
+}
+
+static void save_shader_index(gs_device_t *device)
+{
+	struct shader_index_header header = {0};
+	struct serializer s;
+	struct dstr file = {0};
+
+	if (!device->compiled_shaders_changed)
+		return;
+
+	header.magic = PROGRAM_CACHE_MAGIC;
+	header.version = PROGRAM_CACHE_VERSION;
+	header.driver_hash = device->driver_hash;
+	header.num = (uint32_t)device->compiled_shaders.num;
+
+	os_mkdirs(device->program_cache_path);
+	get_cache_file(&file, device->program_cache_path, "shaders-",
+		       device->driver_hash);
+
+	if (file_output_serializer_init_safe(&s, file.array, "tmp")) {
+		s_write(&s, &header, sizeof(header));
+		s_write(&s, device->compiled_shaders.array,
+			header.num * sizeof(uint64_t));
+		file_output_serializer_free(&s);
+		device->compiled_shaders_changed = false;
+	}
+
+	dstr_free(&file);
+}
+
+void gl_program_cache_free(gs_device_t *device)
+{
+	if (device->program_cache_path)
+		save_shader_index(device);
+
+	da_free(device->compiled_shaders);
+	bfree(device->program_cache_path);
+	device->program_cache_path = NULL;
+}
+
+void device_set_shader_cache_path(gs_device_t *device, const char *path)
+{
+	gl_program_cache_free(device);
+
+	if (path && *path && device->program_binary_supported) {
+		device->program_cache_path = bstrdup(path);
+		load_shader_index(device);
+	}
+}
+
+void device_get_shader_cache_stats(gs_device_t *device,
+				   struct gs_shader_cache_stats *stats)
+{
+	const struct gs_shader_cache_stats *program_stats =
+		&device->program_cache_stats;
+
+	stats->program_hits = program_stats->program_hits;
+	stats->program_misses = program_stats->program_misses;
+	stats->program_writes = program_stats->program_writes;
+	stats->compiles_skipped = program_stats->compiles_skipped;
+}
+
+/* ------------------------------------------------------------------------- */
+
+bool gl_program_cache_shader_compiled(gs_device_t *device, uint64_t hash)
+{
+	if (!device->program_cache_path)
+		return false;
+
+	for (size_t i = 0; i < device->compiled_shaders.num; i++) {
+		if (device->compiled_shaders.array[i] == hash)
+			return true;
+	}
+
+	return false;
+}
+
+void gl_program_cache_add_shader(gs_device_t *device, uint64_t hash)
+{
+	if (!device->program_cache_path)
+		return;
+
+	for (size_t i = 0; i < device->compiled_shaders.num; i++) {
+		if (device->compiled_shaders.array[i] == hash)
+			return;
+	}
+
+	da_push_back(device->compiled_shaders, &hash);
+	device->compiled_shaders_changed = true;
+}
+
+static uint64_t program_key(struct gs_program *program)
+{
+	uint64_t hash = FNV_OFFSET;
+
+	hash = hash_data(hash, &program->device->driver_hash,
+			 sizeof(uint64_t));
+	hash = hash_data(hash, &program->vertex_shader->hash,
+			 sizeof(uint64_t));
+	return hash_data(hash, &program->pixel_shader->hash, sizeof(uint64_t));
+}
+
+static bool load_program_binary(struct gs_program *program, uint64_t key)
+{
+	struct program_cache_header header;
+	struct serializer s;
+	struct dstr file = {0};
+	void *data = NULL;
+	GLint linked = GL_FALSE;
+	bool success;
+
+	get_cache_file(&file, program->device->program_cache_path, "", key);
+	success = file_input_serializer_init(&s, file.array);
+	dstr_free(&file);
+
+	if (!success)
+		return false;
+
+	success = s_read(&s, &header, sizeof(header)) == sizeof(header) &&
+		  header.magic == PROGRAM_CACHE_MAGIC &&
+		  header.version == PROGRAM_CACHE_VERSION &&
+		  header.key == key && header.size > 0 &&
+		  header.size <= MAX_PROGRAM_BINARY;
+
+	if (success) {
+		data = bmalloc(header.size);
+		success = s_read(&s, data, header.size) == header.size;
+	}
+
+	file_input_serializer_free(&s);
+
+	if (success) {
+		glProgramBinary(program->obj, (GLenum)header.format, data,
+				(GLsizei)header.size);
+		success = gl_success("glProgramBinary");
+	}
+	if (success) {
+		glGetProgramiv(program->obj, GL_LINK_STATUS, &linked);
+		success = gl_success("glGetProgramiv") && linked == GL_TRUE;
+	}
+
+	bfree(data);
+	return success;
+}
+
+bool gl_program_cache_load(struct gs_program *program)
+{
+	gs_device_t *device = program->device;
+
+	if (!device->program_cache_path)
+		return false;
+
+	/* drivers reject binaries from other driver versions, in which case
+	 * the program is simply linked from source again */
+	if (load_program_binary(program, program_key(program))) {
+		device->program_cache_stats.program_hits++;
+		return true;
+	}
+
+	device->program_cache_stats.program_misses++;
+	return false;
+}
+
+void gl_program_cache_prepare(struct gs_program *program)
+{
+	if (!program->device->program_cache_path)
+		return;
+
+	glProgramParameteri(program->obj, GL_PROGRAM_BINARY_RETRIEVABLE_HINT,
+			    GL_TRUE);
+	gl_success("glProgramParameteri");
+}
+
+void gl_program_cache_save(struct gs_program *program)
+{
+	gs_device_t *device = program->device;
+	struct program_cache_header header = {0};
+	struct serializer s;
+	struct dstr file = {0};
+	GLint size = 0;
+	GLsizei written = 0;
+	GLenum format = 0;
+	void *data;
+
+	if (!device->program_cache_path)
+		return;
+
+	glGetProgramiv(program->obj, GL_PROGRAM_BINARY_LENGTH, &size);
+	if (!gl_success("glGetProgramiv") || size <= 0 ||
+	    size > MAX_PROGRAM_BINARY)
+		return;
+
+	data = bmalloc(size);
+	glGetProgramBinary(program->obj, size, &written, &format, data);
+	if (!gl_success("glGetProgramBinary") || written <= 0) {
+		bfree(data);
+		return;
+	}
+
+	header.magic = PROGRAM_CACHE_MAGIC;
+	header.version = PROGRAM_CACHE_VERSION;
+	header.key = program_key(program);
+	header.format = (uint32_t)format;
+	header.size = (uint32_t)written;
+
+	os_mkdirs(device->program_cache_path);
+	get_cache_file(&file, device->program_cache_path, "", header.key);
+
+	if (file_output_serializer_init_safe(&s, file.array, "tmp")) {
+		s_write(&s, &header, sizeof(header));
+		s_write(&s, data, header.size);
+		file_output_serializer_free(&s);
+		device->program_cache_stats.program_writes++;
+	}
+
+	dstr_free(&file);
+	bfree(data);
+}
@@ -189,9 +189,8 @@ static inline bool gl_process_attribs(struct gs_shader *shader,
 	return true;
 }
 
-static bool gl_shader_init(struct gs_shader *shader,
-			   struct gl_shader_parser *glsp, const char *file,
-			   char **error_string)
+static bool gl_shader_compile(struct gs_shader *shader, const char *source,
+			      const char *file, char **error_string)
 {
 	GLenum type = convert_shader_type(shader->type);
 	int compiled = 0;
@@ -201,8 +200,7 @@ static bool gl_shader_init(struct gs_shader *shader,
 	if (!gl_success("glCreateShader") || !shader->obj)
 		return false;
 
-	glShaderSource(shader->obj, 1, (const GLchar **)&glsp->gl_string.array,
-		       0);
+	glShaderSource(shader->obj, 1, (const GLchar **)&source, 0);
 	if (!gl_success("glShaderSource"))
 		return false;
 
@@ -210,14 +208,6 @@ static bool gl_shader_init(struct gs_shader *shader,
 	if (!gl_success("glCompileShader"))
 		return false;
 
-#if 0
-	blog(LOG_DEBUG, "+++++++++++++++++++++++++++++++++++");
-	blog(LOG_DEBUG, "  GL shader string for: %s", file);
-	blog(LOG_DEBUG, "-----------------------------------");
-	blog(LOG_DEBUG, "%s", glsp->gl_string.array);
-	blog(LOG_DEBUG, "+++++++++++++++++++++++++++++++++++");
-#endif
-
 	glGetShaderiv(shader->obj, GL_COMPILE_STATUS, &compiled);
 	if (!gl_success("glGetShaderiv"))
 		return false;
@@ -240,6 +230,54 @@ static bool gl_shader_init(struct gs_shader *shader,
 
 	gl_get_shader_info(shader->obj, file, error_string);
 
+	if (success)
+		gl_program_cache_add_shader(shader->device, shader->hash);
+
+	return success;
+}
+
+static bool gl_shader_compile_deferred(struct gs_shader *shader)
+{
+	bool success;
+
+	if (!shader->deferred_source)
+		return true;
+
+	success = gl_shader_compile(shader, shader->deferred_source,
+				    "(deferred shader)", NULL);
+	shader->device->program_cache_stats.compiles_skipped--;
+
+	bfree(shader->deferred_source);
+	shader->deferred_source = NULL;
+	return success;
+}
+
+static bool gl_shader_init(struct gs_shader *shader,
+			   struct gl_shader_parser *glsp, const char *file,
+			   char **error_string)
+{
+	bool success = true;
+
+#if 0
+	blog(LOG_DEBUG, "+++++++++++++++++++++++++++++++++++");
+	blog(LOG_DEBUG, "  GL shader string for: %s", file);
+	blog(LOG_DEBUG, "-----------------------------------");
+	blog(LOG_DEBUG, "%s", glsp->gl_string.array);
+	blog(LOG_DEBUG, "+++++++++++++++++++++++++++++++++++");
+#endif
+
+	shader->hash = gl_program_cache_hash(glsp->gl_string.array);
+
+	/* a shader that has compiled with this driver before is only compiled
+	 * again if a program using it is not in the program cache */
+	if (gl_program_cache_shader_compiled(shader->device, shader->hash)) {
+		shader->deferred_source = bstrdup(glsp->gl_string.array);
+		shader->device->program_cache_stats.compiles_skipped++;
+	} else {
+		success = gl_shader_compile(shader, glsp->gl_string.array, file,
+					    error_string);
+	}
+
 	if (success)
 		success = gl_add_params(shader, glsp);
 	/* Only vertex shaders actually require input attributes */
@@ -346,6 +384,8 @@ void gs_shader_destroy(gs_shader_t *shader)
 		gl_success("glDeleteShader");
 	}
 
+	bfree(shader->deferred_source);
+
 	da_free(shader->samplers);
 	da_free(shader->params);
 	da_free(shader->attribs);
@@ -634,51 +674,75 @@ static inline bool assign_program_params(struct gs_program *program)
 	return true;
 }
 
-struct gs_program *gs_program_create(struct gs_device *device)
+static bool gl_program_link(struct gs_program *program)
 {
-	struct gs_program *program = bzalloc(sizeof(*program));
+	GLuint vertex_obj, pixel_obj;
 	int linked = false;
 
-	program->device = device;
-	program->vertex_shader = device->cur_vertex_shader;
-	program->pixel_shader = device->cur_pixel_shader;
+	if (!gl_shader_compile_deferred(program->vertex_shader))
+		return false;
+	if (!gl_shader_compile_deferred(program->pixel_shader))
+		return false;
 
-	program->obj = glCreateProgram();
-	if (!gl_success("glCreateProgram"))
-		goto error_detach_neither;
+	vertex_obj = program->vertex_shader->obj;
+	pixel_obj = program->pixel_shader->obj;
 
-	glAttachShader(program->obj, program->vertex_shader->obj);
+	gl_program_cache_prepare(program);
+
+	glAttachShader(program->obj, vertex_obj);
 	if (!gl_success("glAttachShader (vertex)"))
-		goto error_detach_neither;
+		return false;
 
-	glAttachShader(program->obj, program->pixel_shader->obj);
+	glAttachShader(program->obj, pixel_obj);
 	if (!gl_success("glAttachShader (pixel)"))
-		goto error_detach_vertex;
+		goto detach_vertex;
 
 	glLinkProgram(program->obj);
 	if (!gl_success("glLinkProgram"))
-		goto error;
+		goto detach;
 
 	glGetProgramiv(program->obj, GL_LINK_STATUS, &linked);
-	if (!gl_success("glGetProgramiv"))
-		goto error;
+	if (!gl_success("glGetProgramiv")) {
+		linked = GL_FALSE;
+		goto detach;
+	}
 
-	if (linked == GL_FALSE) {
+	if (linked == GL_FALSE)
 		print_link_errors(program->obj);
+	else
+		gl_program_cache_save(program);
+
+detach:
+	glDetachShader(program->obj, pixel_obj);
+	gl_success("glDetachShader (pixel)");
+
+detach_vertex:
+	glDetachShader(program->obj, vertex_obj);
+	gl_success("glDetachShader (vertex)");
+
+	return linked != GL_FALSE;
+}
+
+struct gs_program *gs_program_create(struct gs_device *device)
+{
+	struct gs_program *program = bzalloc(sizeof(*program));
+
+	program->device = device;
+	program->vertex_shader = device->cur_vertex_shader;
+	program->pixel_shader = device->cur_pixel_shader;
+
+	program->obj = glCreateProgram();
+	if (!gl_success("glCreateProgram"))
+		goto error;
+
+	if (!gl_program_cache_load(program) && !gl_program_link(program))
 		goto error;
-	}
 
 	if (!assign_program_attribs(program))
 		goto error;
 	if (!assign_program_params(program))
 		goto error;
 
-	glDetachShader(program->obj, program->vertex_shader->obj);
-	gl_success("glDetachShader (vertex)");
-
-	glDetachShader(program->obj, program->pixel_shader->obj);
-	gl_success("glDetachShader (pixel)");
-
 	program->next = device->first_program;
 	program->prev_next = &device->first_program;
 	device->first_program = program;
@@ -688,14 +752,6 @@ struct gs_program *gs_program_create(struct gs_device *device)
 	return program;
 
 error:
-	glDetachShader(program->obj, program->pixel_shader->obj);
-	gl_success("glDetachShader (pixel)");
-
-error_detach_vertex:
-	glDetachShader(program->obj, program->vertex_shader->obj);
-	gl_success("glDetachShader (vertex)");
-
-error_detach_neither:
 	gs_program_destroy(program);
 	return NULL;
 }
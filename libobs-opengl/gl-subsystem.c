@@ -239,6 +239,11 @@ int device_create(gs_device_t **p_device, uint32_t adapter)
 		goto fail;
 	}
 
+	gl_program_cache_init(device);
+
+	device->upload_buffers_supported = GLAD_GL_VERSION_4_4 ||
+					   GLAD_GL_ARB_buffer_storage;
+
 	const char *glVersion = (const char *)glGetString(GL_VERSION);
 	const char *glShadingLanguage =
 		(const char *)glGetString(GL_SHADING_LANGUAGE_VERSION);
@@ -289,6 +294,8 @@ void device_destroy(gs_device_t *device)
 		while (device->first_program)
 			gs_program_destroy(device->first_program);
 
+		gl_program_cache_free(device);
+
 		samplerstate_release(device->raw_load_sampler);
 		gl_delete_vertex_arrays(1, &device->empty_vao);
 
@@ -1527,6 +1534,8 @@ bool gs_timer_get_data(gs_timer_t *timer, uint64_t *ticks)
 	GLint available = 0;
 	glGetQueryObjectiv(timer->queries[1], GL_QUERY_RESULT_AVAILABLE,
 			   &available);
+	if (!available)
+		return false;
 
 	GLuint64 begin, end;
 	glGetQueryObjectui64v(timer->queries[0], GL_QUERY_RESULT, &begin);
@@ -456,6 +456,11 @@ struct gs_shader {
 	enum gs_shader_type type;
 	GLuint obj;
 
+	/* GLSL hash for the program cache, and the GLSL itself while
+	 * compiling it is deferred */
+	uint64_t hash;
+	char *deferred_source;
+
 	struct gs_shader_param *viewproj;
 	struct gs_shader_param *world;
 
@@ -576,6 +581,14 @@ struct gs_stage_surface {
 	GLuint pack_buffer;
 };
 
+struct gs_upload_buffer {
+	gs_device_t *device;
+	GLuint buffer;
+	GLsync fence;
+	uint8_t *data;
+	size_t size;
+};
+
 struct gs_zstencil_buffer {
 	gs_device_t *device;
 	GLuint buffer;
@@ -641,11 +654,31 @@ struct gs_device {
 	DARRAY(struct matrix4) proj_stack;
 
 	struct fbo_info *cur_fbo;
+
+	/* program binary cache */
+	char *program_cache_path;
+	uint64_t driver_hash;
+	bool program_binary_supported;
+	DARRAY(uint64_t) compiled_shaders;
+	bool compiled_shaders_changed;
+	struct gs_shader_cache_stats program_cache_stats;
+
+	bool upload_buffers_supported;
 };
 
 extern struct fbo_info *get_fbo(gs_texture_t *tex, uint32_t width,
 				uint32_t height);
 
+extern uint64_t gl_program_cache_hash(const char *str);
+extern void gl_program_cache_init(gs_device_t *device);
+extern void gl_program_cache_free(gs_device_t *device);
+extern bool gl_program_cache_shader_compiled(gs_device_t *device,
+					     uint64_t hash);
+extern void gl_program_cache_add_shader(gs_device_t *device, uint64_t hash);
+extern bool gl_program_cache_load(struct gs_program *program);
+extern void gl_program_cache_prepare(struct gs_program *program);
+extern void gl_program_cache_save(struct gs_program *program);
+
 extern void gl_update(gs_device_t *device);
 extern void gl_clear_context(gs_device_t *device);
 
@@ -258,6 +258,52 @@ failed:
 	blog(LOG_ERROR, "gs_texture_unmap (GL) failed");
 }
 
+bool device_texture_set_image_from_buffer(gs_device_t *device,
+					  gs_texture_t *tex,
+					  gs_upload_buffer_t *buf,
+					  size_t offset, uint32_t linesize)
+{
+	struct gs_texture_2d *tex2d = (struct gs_texture_2d *)tex;
+	uint32_t bytes_per_pixel;
+	bool success = false;
+
+	if (!is_texture_2d(tex, "device_texture_set_image_from_buffer"))
+		return false;
+	if (gs_is_compressed_format(tex->format))
+		return false;
+
+	bytes_per_pixel = gs_get_format_bpp(tex->format) / 8;
+	if (!bytes_per_pixel || linesize % bytes_per_pixel != 0)
+		return false;
+	if (offset + (size_t)linesize * tex2d->height > buf->size)
+		return false;
+
+	if (!gl_bind_buffer(GL_PIXEL_UNPACK_BUFFER, buf->buffer))
+		goto failed;
+	if (!gl_bind_texture(tex->gl_target, tex->texture))
+		goto failed;
+
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, linesize / bytes_per_pixel);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+	glTexSubImage2D(tex->gl_target, 0, 0, 0, tex2d->width, tex2d->height,
+			tex->gl_format, tex->gl_type, (const void *)offset);
+	success = gl_success("glTexSubImage2D");
+
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+failed:
+	gl_bind_buffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	gl_bind_texture(tex->gl_target, 0);
+	if (!success)
+		blog(LOG_ERROR, "device_texture_set_image_from_buffer (GL) "
+				"failed");
+
+	UNUSED_PARAMETER(device);
+	return success;
+}
+
 bool gs_texture_is_rect(const gs_texture_t *tex)
 {
 	if (tex->type == GS_TEXTURE_3D)
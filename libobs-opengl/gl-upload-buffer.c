@@ -0,0 +1,126 @@
+/******************************************************************************
+    Copyright (C) 2021 by Hugh Bailey <obs.jim@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include "gl-subsystem.h"
+
+/*
+ * Upload buffers
+ *
+ * Pixel unpack buffers with immutable storage that are mapped once,
+ * persistently and coherently, so that other threads can write pixel data
+ * into them without a GL context.  The graphics thread only issues the
+ * buffer to texture copy, followed by a fence that tells libobs when the
+ * GPU is done reading and the buffer can be written to again.
+ */
+
+#define UPLOAD_BUFFER_FLAGS \
+	(GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT)
+
+gs_upload_buffer_t *device_upload_buffer_create(gs_device_t *device,
+						size_t size)
+{
+	struct gs_upload_buffer *buf;
+
+	if (!device->upload_buffers_supported || !size)
+		return NULL;
+
+	buf = bzalloc(sizeof(struct gs_upload_buffer));
+	buf->device = device;
+	buf->size = size;
+
+	if (!gl_gen_buffers(1, &buf->buffer))
+		goto fail;
+	if (!gl_bind_buffer(GL_PIXEL_UNPACK_BUFFER, buf->buffer))
+		goto fail;
+
+	glBufferStorage(GL_PIXEL_UNPACK_BUFFER, (GLsizeiptr)size, NULL,
+			UPLOAD_BUFFER_FLAGS);
+	if (!gl_success("glBufferStorage"))
+		goto fail;
+
+	buf->data = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0,
+				     (GLsizeiptr)size, UPLOAD_BUFFER_FLAGS);
+	if (!gl_success("glMapBufferRange") || !buf->data)
+		goto fail;
+
+	gl_bind_buffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	return buf;
+
+fail:
+	gl_bind_buffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	gs_upload_buffer_destroy(buf);
+	blog(LOG_ERROR, "device_upload_buffer_create (GL) failed");
+	return NULL;
+}
+
+void gs_upload_buffer_destroy(gs_upload_buffer_t *buf)
+{
+	if (!buf)
+		return;
+
+	if (buf->fence) {
+		glDeleteSync(buf->fence);
+		gl_success("glDeleteSync");
+	}
+
+	/* deleting the buffer also unmaps it */
+	if (buf->buffer)
+		gl_delete_buffers(1, &buf->buffer);
+
+	bfree(buf);
+}
+
+uint8_t *gs_upload_buffer_get_data(gs_upload_buffer_t *buf)
+{
+	return buf->data;
+}
+
+void device_upload_buffer_fence(gs_device_t *device, gs_upload_buffer_t *buf)
+{
+	if (buf->fence) {
+		glDeleteSync(buf->fence);
+		gl_success("glDeleteSync");
+	}
+
+	buf->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	if (!gl_success("glFenceSync"))
+		buf->fence = NULL;
+
+	UNUSED_PARAMETER(device);
+}
+
+bool device_upload_buffer_signaled(gs_device_t *device,
+				   gs_upload_buffer_t *buf)
+{
+	GLenum result;
+
+	if (!buf->fence)
+		return true;
+
+	result = glClientWaitSync(buf->fence, 0, 0);
+	if (!gl_success("glClientWaitSync"))
+		return false;
+	if (result != GL_ALREADY_SIGNALED && result != GL_CONDITION_SATISFIED)
+		return false;
+
+	glDeleteSync(buf->fence);
+	gl_success("glDeleteSync");
+	buf->fence = NULL;
+
+	UNUSED_PARAMETER(device);
+	return true;
+}
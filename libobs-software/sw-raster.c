@@ -0,0 +1,716 @@
+/******************************************************************************
+    Copyright (C) 2021 by Hugh Bailey <obs.jim@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include <math.h>
+#include <obs.h>
+#include "sw-subsystem.h"
+
+/* primitives covering at least this many pixels are split into bands of rows
+ * and shaded on the shared task scheduler */
+#define SW_PARALLEL_MIN_PIXELS (64 * 64)
+#define SW_BAND_ROWS 16
+
+struct raster_vert {
+	float x;
+	float y;
+	float inv_w;
+	struct vec4 v[SW_MAX_VARYINGS];
+};
+
+/* varyings as planes over window coordinates.  for affine primitives the
+ * planes are of the varyings themselves, otherwise they're of the varyings
+ * divided by w (along with 1/w) for perspective correct interpolation */
+struct sw_interp {
+	float ox, oy;
+	float w, dwdx, dwdy;
+	struct vec4 v[SW_MAX_VARYINGS];
+	struct vec4 dvdx[SW_MAX_VARYINGS];
+	struct vec4 dvdy[SW_MAX_VARYINGS];
+	bool affine;
+};
+
+struct sw_triangle {
+	struct sw_interp interp;
+
+	/* edge i runs from (ex[i], ey[i]) along (edx[i], edy[i]) */
+	float ex[3], ey[3];
+	float edx[3], edy[3];
+	bool top_left[3];
+};
+
+struct raster_job {
+	const struct sw_draw *draw;
+	const struct sw_triangle *tri;
+	const struct sw_interp *interp;
+	int x0, x1;
+	int y0;
+};
+
+/* ------------------------------------------------------------------------- */
+
+static inline float blend_alpha_factor(enum gs_blend_type type,
+				       const struct vec4 *src,
+				       const struct vec4 *dst)
+{
+	switch (type) {
+	case GS_BLEND_ZERO:
+		return 0.0f;
+	case GS_BLEND_ONE:
+	case GS_BLEND_SRCALPHASAT:
+		return 1.0f;
+	case GS_BLEND_SRCCOLOR:
+	case GS_BLEND_SRCALPHA:
+		return src->w;
+	case GS_BLEND_INVSRCCOLOR:
+	case GS_BLEND_INVSRCALPHA:
+		return 1.0f - src->w;
+	case GS_BLEND_DSTCOLOR:
+	case GS_BLEND_DSTALPHA:
+		return dst->w;
+	case GS_BLEND_INVDSTCOLOR:
+	case GS_BLEND_INVDSTALPHA:
+		return 1.0f - dst->w;
+	}
+
+	return 1.0f;
+}
+
+static inline void blend_color_factor(enum gs_blend_type type,
+				      const struct vec4 *src,
+				      const struct vec4 *dst, struct vec4 *out)
+{
+	float f;
+
+	switch (type) {
+	case GS_BLEND_SRCCOLOR:
+		*out = *src;
+		return;
+	case GS_BLEND_INVSRCCOLOR:
+		vec4_set(out, 1.0f - src->x, 1.0f - src->y, 1.0f - src->z,
+			 0.0f);
+		return;
+	case GS_BLEND_DSTCOLOR:
+		*out = *dst;
+		return;
+	case GS_BLEND_INVDSTCOLOR:
+		vec4_set(out, 1.0f - dst->x, 1.0f - dst->y, 1.0f - dst->z,
+			 0.0f);
+		return;
+	case GS_BLEND_SRCALPHASAT:
+		f = fminf(src->w, 1.0f - dst->w);
+		break;
+	default:
+		f = blend_alpha_factor(type, src, dst);
+	}
+
+	vec4_set(out, f, f, f, f);
+}
+
+/* out may be dst */
+static inline void blend_pixel(const struct sw_draw *draw,
+			       const struct vec4 *color,
+			       const struct vec4 *dst, struct vec4 *out)
+{
+	struct vec4 src_f, dst_f, t, res;
+	float src_alpha, dst_alpha;
+
+	/* what libobs draws with nearly everywhere, without the factors going
+	 * through memory */
+	if (draw->src_c == GS_BLEND_SRCALPHA &&
+	    draw->dest_c == GS_BLEND_INVSRCALPHA) {
+		__m128 a = _mm_shuffle_ps(color->m, color->m,
+					  _MM_SHUFFLE(3, 3, 3, 3));
+		__m128 inv_a = _mm_sub_ps(_mm_set1_ps(1.0f), a);
+
+		res.m = _mm_add_ps(_mm_mul_ps(color->m, a),
+				   _mm_mul_ps(dst->m, inv_a));
+	} else {
+		blend_color_factor(draw->src_c, color, dst, &src_f);
+		blend_color_factor(draw->dest_c, color, dst, &dst_f);
+
+		vec4_mul(&res, color, &src_f);
+		vec4_mul(&t, dst, &dst_f);
+		vec4_add(&res, &res, &t);
+	}
+
+	src_alpha = blend_alpha_factor(draw->src_a, color, dst);
+	dst_alpha = blend_alpha_factor(draw->dest_a, color, dst);
+	res.w = color->w * src_alpha + dst->w * dst_alpha;
+	*out = res;
+}
+
+void sw_write_pixel(const struct sw_draw *draw, int x, int y,
+		    const struct vec4 *color)
+{
+	const bool *mask = draw->write_mask;
+	bool masked = !mask[0] || !mask[1] || !mask[2] || !mask[3];
+	struct vec4 dst;
+	struct vec4 out;
+
+	if (!draw->blend && !masked) {
+		sw_texel_store(draw->target, draw->target_slice, x, y, color,
+			       draw->srgb_write);
+		return;
+	}
+
+	sw_texel_load(draw->target, draw->target_slice, x, y,
+		      draw->srgb_write, &dst);
+
+	if (draw->blend)
+		blend_pixel(draw, color, &dst, &out);
+	else
+		out = *color;
+
+	if (masked) {
+		if (!mask[0])
+			out.x = dst.x;
+		if (!mask[1])
+			out.y = dst.y;
+		if (!mask[2])
+			out.z = dst.z;
+		if (!mask[3])
+			out.w = dst.w;
+	}
+
+	sw_texel_store(draw->target, draw->target_slice, x, y, &out,
+		       draw->srgb_write);
+}
+
+/* writes up to SW_SPAN_PIXELS colors from (x, y) to the right */
+static void write_span(const struct sw_draw *draw, int x, int y, int count,
+		       const struct vec4 *colors)
+{
+	const bool *mask = draw->write_mask;
+	struct vec4 dst[SW_SPAN_PIXELS];
+
+	if (!mask[0] || !mask[1] || !mask[2] || !mask[3]) {
+		for (int i = 0; i < count; i++)
+			sw_write_pixel(draw, x + i, y, &colors[i]);
+		return;
+	}
+
+	if (draw->blend) {
+		sw_texel_load_span(draw->target, draw->target_slice, x, y,
+				   count, draw->srgb_write, dst);
+		for (int i = 0; i < count; i++)
+			blend_pixel(draw, &colors[i], &dst[i], &dst[i]);
+		colors = dst;
+	}
+
+	sw_texel_store_span(draw->target, draw->target_slice, x, y, count,
+			    colors, draw->srgb_write);
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* spans are shaded and written SW_SPAN_PIXELS at a time, by the span kernel
+ * of the pixel shader if it has one and the span is affine */
+static void shade_span(const struct sw_draw *draw, const struct sw_interp *in,
+		       int py, int x0, int x1)
+{
+	struct vec4 colors[SW_SPAN_PIXELS];
+	struct vec4 num[SW_MAX_VARYINGS];
+	struct sw_fragment frag;
+	struct vec4 t;
+	float dx = (float)x0 + 0.5f - in->ox;
+	float dy = (float)py + 0.5f - in->oy;
+	float w = in->w + in->dwdx * dx + in->dwdy * dy;
+
+	for (int i = 0; i < SW_MAX_VARYINGS; i++) {
+		vec4_mulf(&num[i], &in->dvdx[i], dx);
+		vec4_mulf(&t, &in->dvdy[i], dy);
+		vec4_add(&num[i], &num[i], &t);
+		vec4_add(&num[i], &num[i], &in->v[i]);
+	}
+
+	frag.y = (float)py + 0.5f;
+	if (in->affine) {
+		frag.ddx = in->dvdx[0];
+		frag.ddy = in->dvdy[0];
+	}
+
+	for (int px = x0; px < x1; px += SW_SPAN_PIXELS) {
+		int count = x1 - px;
+
+		if (count > SW_SPAN_PIXELS)
+			count = SW_SPAN_PIXELS;
+
+		if (in->affine && draw->span) {
+			frag.x = (float)px + 0.5f;
+			for (int i = 0; i < SW_MAX_VARYINGS; i++)
+				frag.v[i] = num[i];
+
+			draw->span(draw, &frag, in->dvdx, count, colors);
+
+			for (int n = 0; n < count; n++) {
+				for (int i = 0; i < SW_MAX_VARYINGS; i++)
+					vec4_add(&num[i], &num[i],
+						 &in->dvdx[i]);
+			}
+
+			write_span(draw, px, py, count, colors);
+			continue;
+		}
+
+		for (int n = 0; n < count; n++) {
+			frag.x = (float)(px + n) + 0.5f;
+
+			if (in->affine) {
+				for (int i = 0; i < SW_MAX_VARYINGS; i++)
+					frag.v[i] = num[i];
+			} else {
+				float inv = 1.0f / w;
+
+				for (int i = 0; i < SW_MAX_VARYINGS; i++)
+					vec4_mulf(&frag.v[i], &num[i], inv);
+
+				/* derivatives from the neighbouring pixels */
+				vec4_add(&t, &num[0], &in->dvdx[0]);
+				vec4_mulf(&t, &t, 1.0f / (w + in->dwdx));
+				vec4_sub(&frag.ddx, &t, &frag.v[0]);
+				vec4_add(&t, &num[0], &in->dvdy[0]);
+				vec4_mulf(&t, &t, 1.0f / (w + in->dwdy));
+				vec4_sub(&frag.ddy, &t, &frag.v[0]);
+			}
+
+			draw->pixel(draw, &frag, &colors[n]);
+
+			for (int i = 0; i < SW_MAX_VARYINGS; i++)
+				vec4_add(&num[i], &num[i], &in->dvdx[i]);
+			w += in->dwdx;
+		}
+
+		write_span(draw, px, py, count, colors);
+	}
+}
+
+static inline bool edge_covers(const struct sw_triangle *tri, int i, float x,
+			       float y)
+{
+	float e = tri->edx[i] * (y - tri->ey[i]) -
+		  tri->edy[i] * (x - tri->ex[i]);
+	return e > 0.0f || (e == 0.0f && tri->top_left[i]);
+}
+
+static inline bool triangle_covers(const struct sw_triangle *tri, float x,
+				   float y)
+{
+	return edge_covers(tri, 0, x, y) && edge_covers(tri, 1, x, y) &&
+	       edge_covers(tri, 2, x, y);
+}
+
+static void raster_rows(const struct raster_job *job, int y0, int y1)
+{
+	for (int py = y0; py < y1; py++) {
+		int first = job->x0;
+		int last = job->x1;
+
+		if (job->tri) {
+			float y = (float)py + 0.5f;
+
+			/* triangles are convex, so the covered pixels of a
+			 * row are contiguous */
+			while (first < last &&
+			       !triangle_covers(job->tri, (float)first + 0.5f,
+						y))
+				first++;
+			while (last > first &&
+			       !triangle_covers(job->tri, (float)last - 0.5f,
+						y))
+				last--;
+		}
+
+		if (first < last)
+			shade_span(job->draw, job->interp, py, first, last);
+	}
+}
+
+static void raster_band(void *param, size_t start, size_t end)
+{
+	const struct raster_job *job = param;
+	raster_rows(job, job->y0 + (int)start, job->y0 + (int)end);
+}
+
+static void raster_region(const struct raster_job *job, int y1)
+{
+	size_t rows = (size_t)(y1 - job->y0);
+	size_t cols = (size_t)(job->x1 - job->x0);
+
+	if (rows * cols >= SW_PARALLEL_MIN_PIXELS &&
+	    rows >= SW_BAND_ROWS * 2) {
+		os_task_scheduler_parallel_for(obs_get_task_scheduler(), rows,
+					       SW_BAND_ROWS, raster_band,
+					       (void *)job);
+	} else {
+		raster_rows(job, job->y0, y1);
+	}
+}
+
+/* returns false if the pixel range is empty */
+static inline bool clip_range(const struct sw_draw *draw, float min_x,
+			      float max_x, float min_y, float max_y,
+			      int *x0, int *x1, int *y0, int *y1)
+{
+	/* pixel centers in [min, max) are covered */
+	*x0 = (int)ceilf(min_x - 0.5f);
+	*x1 = (int)ceilf(max_x - 0.5f);
+	*y0 = (int)ceilf(min_y - 0.5f);
+	*y1 = (int)ceilf(max_y - 0.5f);
+
+	if (*x0 < draw->clip_x0)
+		*x0 = draw->clip_x0;
+	if (*y0 < draw->clip_y0)
+		*y0 = draw->clip_y0;
+	if (*x1 > draw->clip_x1)
+		*x1 = draw->clip_x1;
+	if (*y1 > draw->clip_y1)
+		*y1 = draw->clip_y1;
+
+	return *x0 < *x1 && *y0 < *y1;
+}
+
+/* ------------------------------------------------------------------------- */
+
+static bool project_vertex(const struct sw_draw *draw,
+			   const struct sw_vertex_out *in,
+			   struct raster_vert *out)
+{
+	const struct gs_rect *vp = &draw->viewport;
+	float inv_w;
+
+	/* there's no near plane clipping, primitives crossing w = 0 are
+	 * dropped, which never happens with the orthographic projections
+	 * libobs uses */
+	if (!(in->pos.w > 0.0f))
+		return false;
+
+	inv_w = 1.0f / in->pos.w;
+	out->x = (in->pos.x * inv_w * 0.5f + 0.5f) * (float)vp->cx +
+		 (float)vp->x;
+	out->y = (1.0f - in->pos.y * inv_w) * 0.5f * (float)vp->cy +
+		 (float)vp->y;
+	out->inv_w = inv_w;
+
+	for (int i = 0; i < SW_MAX_VARYINGS; i++)
+		out->v[i] = in->v[i];
+	return true;
+}
+
+static inline bool cull(enum gs_cull_mode cull_mode, float area)
+{
+	/* clockwise on screen is front facing */
+	if (area == 0.0f)
+		return true;
+	if (cull_mode == GS_BACK)
+		return area < 0.0f;
+	if (cull_mode == GS_FRONT)
+		return area > 0.0f;
+	return false;
+}
+
+static inline void setup_gradient(float d1, float d2, float ex1, float ey1,
+				  float ex2, float ey2, float inv_area,
+				  float *ddx, float *ddy)
+{
+	*ddx = (d1 * ey2 - d2 * ey1) * inv_area;
+	*ddy = (d2 * ex1 - d1 * ex2) * inv_area;
+}
+
+static void setup_interp(struct sw_interp *in, const struct raster_vert *v0,
+			 const struct raster_vert *v1,
+			 const struct raster_vert *v2)
+{
+	float ex1 = v1->x - v0->x;
+	float ey1 = v1->y - v0->y;
+	float ex2 = v2->x - v0->x;
+	float ey2 = v2->y - v0->y;
+	float inv_area = 1.0f / (ex1 * ey2 - ex2 * ey1);
+	float w0 = v0->inv_w, w1 = v1->inv_w, w2 = v2->inv_w;
+
+	in->ox = v0->x;
+	in->oy = v0->y;
+	in->affine = w0 == w1 && w0 == w2;
+
+	if (in->affine) {
+		w0 = w1 = w2 = 1.0f;
+		in->w = 1.0f;
+		in->dwdx = 0.0f;
+		in->dwdy = 0.0f;
+	} else {
+		in->w = w0;
+		setup_gradient(w1 - w0, w2 - w0, ex1, ey1, ex2, ey2, inv_area,
+			       &in->dwdx, &in->dwdy);
+	}
+
+	for (int i = 0; i < SW_MAX_VARYINGS; i++) {
+		struct vec4 a0, a1, a2;
+
+		vec4_mulf(&a0, &v0->v[i], w0);
+		vec4_mulf(&a1, &v1->v[i], w1);
+		vec4_mulf(&a2, &v2->v[i], w2);
+		in->v[i] = a0;
+
+		for (int c = 0; c < 4; c++)
+			setup_gradient(a1.ptr[c] - a0.ptr[c],
+				       a2.ptr[c] - a0.ptr[c], ex1, ey1, ex2,
+				       ey2, inv_area, &in->dvdx[i].ptr[c],
+				       &in->dvdy[i].ptr[c]);
+	}
+}
+
+static void draw_triangle(const struct sw_draw *draw,
+			  const struct raster_vert *v0,
+			  const struct raster_vert *v1,
+			  const struct raster_vert *v2,
+			  enum gs_cull_mode cull_mode)
+{
+	const struct raster_vert *verts[3] = {v0, v1, v2};
+	struct sw_triangle tri;
+	struct raster_job job;
+	int x0, x1, y0, y1;
+	float area;
+
+	area = (v1->x - v0->x) * (v2->y - v0->y) -
+	       (v2->x - v0->x) * (v1->y - v0->y);
+	if (cull(cull_mode, area))
+		return;
+
+	if (area < 0.0f) {
+		verts[1] = v2;
+		verts[2] = v1;
+	}
+
+	if (!clip_range(draw, fminf(fminf(v0->x, v1->x), v2->x),
+			fmaxf(fmaxf(v0->x, v1->x), v2->x) + 1.0f,
+			fminf(fminf(v0->y, v1->y), v2->y),
+			fmaxf(fmaxf(v0->y, v1->y), v2->y) + 1.0f, &x0, &x1,
+			&y0, &y1))
+		return;
+
+	for (int i = 0; i < 3; i++) {
+		const struct raster_vert *a = verts[i];
+		const struct raster_vert *b = verts[(i + 1) % 3];
+
+		tri.ex[i] = a->x;
+		tri.ey[i] = a->y;
+		tri.edx[i] = b->x - a->x;
+		tri.edy[i] = b->y - a->y;
+
+		/* top-left fill rule */
+		tri.top_left[i] = (a->y == b->y && b->x > a->x) || b->y < a->y;
+	}
+
+	setup_interp(&tri.interp, verts[0], verts[1], verts[2]);
+
+	job.draw = draw;
+	job.tri = &tri;
+	job.interp = &tri.interp;
+	job.x0 = x0;
+	job.x1 = x1;
+	job.y0 = y0;
+	raster_region(&job, y1);
+}
+
+static inline bool vec4_equal(const struct vec4 *a, const struct vec4 *b)
+{
+	return a->x == b->x && a->y == b->y && a->z == b->z && a->w == b->w;
+}
+
+/* nearly everything libobs draws is a sprite: an axis aligned 4 vertex
+ * strip with affine varyings, which is filled as one rect with no edge
+ * tests */
+static bool try_draw_quad(const struct sw_draw *draw,
+			  const struct raster_vert *v,
+			  enum gs_cull_mode cull_mode)
+{
+	struct raster_job job;
+	struct sw_interp interp;
+	int x0, x1, y0, y1;
+
+	if (v[0].inv_w != 1.0f || v[1].inv_w != 1.0f || v[2].inv_w != 1.0f ||
+	    v[3].inv_w != 1.0f)
+		return false;
+	if (v[0].y != v[1].y || v[2].y != v[3].y || v[0].x != v[2].x ||
+	    v[1].x != v[3].x)
+		return false;
+
+	for (int i = 0; i < SW_MAX_VARYINGS; i++) {
+		struct vec4 d0, d1;
+
+		vec4_sub(&d0, &v[1].v[i], &v[0].v[i]);
+		vec4_sub(&d1, &v[3].v[i], &v[2].v[i]);
+		if (!vec4_equal(&d0, &d1))
+			return false;
+	}
+
+	if (cull(cull_mode, (v[1].x - v[0].x) * (v[2].y - v[0].y)))
+		return true;
+
+	if (!clip_range(draw, fminf(v[0].x, v[1].x), fmaxf(v[0].x, v[1].x),
+			fminf(v[0].y, v[2].y), fmaxf(v[0].y, v[2].y), &x0, &x1,
+			&y0, &y1))
+		return true;
+
+	interp.ox = v[0].x;
+	interp.oy = v[0].y;
+	interp.w = 1.0f;
+	interp.dwdx = 0.0f;
+	interp.dwdy = 0.0f;
+	interp.affine = true;
+
+	for (int i = 0; i < SW_MAX_VARYINGS; i++) {
+		interp.v[i] = v[0].v[i];
+		vec4_sub(&interp.dvdx[i], &v[1].v[i], &v[0].v[i]);
+		vec4_divf(&interp.dvdx[i], &interp.dvdx[i], v[1].x - v[0].x);
+		vec4_sub(&interp.dvdy[i], &v[2].v[i], &v[0].v[i]);
+		vec4_divf(&interp.dvdy[i], &interp.dvdy[i], v[2].y - v[0].y);
+	}
+
+	job.draw = draw;
+	job.tri = NULL;
+	job.interp = &interp;
+	job.x0 = x0;
+	job.x1 = x1;
+	job.y0 = y0;
+	raster_region(&job, y1);
+	return true;
+}
+
+/* ------------------------------------------------------------------------- */
+
+static void shade_point(const struct sw_draw *draw, float x, float y,
+			const struct vec4 *v)
+{
+	struct sw_fragment frag;
+	struct vec4 color;
+	int px = (int)floorf(x);
+	int py = (int)floorf(y);
+
+	if (px < draw->clip_x0 || px >= draw->clip_x1 || py < draw->clip_y0 ||
+	    py >= draw->clip_y1)
+		return;
+
+	frag.x = (float)px + 0.5f;
+	frag.y = (float)py + 0.5f;
+	for (int i = 0; i < SW_MAX_VARYINGS; i++)
+		frag.v[i] = v[i];
+	vec4_zero(&frag.ddx);
+	vec4_zero(&frag.ddy);
+
+	draw->pixel(draw, &frag, &color);
+	sw_write_pixel(draw, px, py, &color);
+}
+
+static void draw_line(const struct sw_draw *draw, const struct raster_vert *a,
+		      const struct raster_vert *b)
+{
+	float dx = b->x - a->x;
+	float dy = b->y - a->y;
+	float steps = fmaxf(fabsf(dx), fabsf(dy));
+	int count = (int)ceilf(steps);
+	struct vec4 v[SW_MAX_VARYINGS];
+
+	if (count < 1)
+		count = 1;
+
+	for (int s = 0; s < count; s++) {
+		float t = ((float)s + 0.5f) / (float)count;
+		float inv_w = a->inv_w + (b->inv_w - a->inv_w) * t;
+		float wa = (1.0f - t) * a->inv_w / inv_w;
+		float wb = t * b->inv_w / inv_w;
+
+		for (int i = 0; i < SW_MAX_VARYINGS; i++) {
+			struct vec4 tmp;
+			vec4_mulf(&v[i], &a->v[i], wa);
+			vec4_mulf(&tmp, &b->v[i], wb);
+			vec4_add(&v[i], &v[i], &tmp);
+		}
+
+		shade_point(draw, a->x + dx * t, a->y + dy * t, v);
+	}
+}
+
+/* ------------------------------------------------------------------------- */
+
+void sw_rasterize(struct sw_draw *draw, enum gs_draw_mode mode,
+		  const struct sw_vertex_out *verts, size_t num,
+		  enum gs_cull_mode cull_mode)
+{
+	struct raster_vert r[4];
+	bool valid[4];
+
+	if (!draw->pixel || draw->clip_x0 >= draw->clip_x1 ||
+	    draw->clip_y0 >= draw->clip_y1)
+		return;
+
+	if (mode == GS_TRISTRIP && num == 4) {
+		bool projected = true;
+
+		for (size_t i = 0; i < 4; i++)
+			projected &= project_vertex(draw, &verts[i], &r[i]);
+
+		if (projected && try_draw_quad(draw, r, cull_mode))
+			return;
+	}
+
+	switch (mode) {
+	case GS_POINTS:
+		for (size_t i = 0; i < num; i++) {
+			if (project_vertex(draw, &verts[i], &r[0]))
+				shade_point(draw, r[0].x, r[0].y, r[0].v);
+		}
+		break;
+
+	case GS_LINES:
+	case GS_LINESTRIP: {
+		size_t step = mode == GS_LINES ? 2 : 1;
+
+		for (size_t i = 0; i + 1 < num; i += step) {
+			if (project_vertex(draw, &verts[i], &r[0]) &&
+			    project_vertex(draw, &verts[i + 1], &r[1]))
+				draw_line(draw, &r[0], &r[1]);
+		}
+		break;
+	}
+
+	case GS_TRIS:
+		for (size_t i = 0; i + 2 < num; i += 3) {
+			for (size_t j = 0; j < 3; j++)
+				valid[j] = project_vertex(draw, &verts[i + j],
+							  &r[j]);
+			if (valid[0] && valid[1] && valid[2])
+				draw_triangle(draw, &r[0], &r[1], &r[2],
+					      cull_mode);
+		}
+		break;
+
+	case GS_TRISTRIP:
+		for (size_t i = 0; i + 2 < num; i++) {
+			/* odd triangles are flipped to keep the winding */
+			size_t i0 = (i & 1) ? i + 1 : i;
+			size_t i1 = (i & 1) ? i : i + 1;
+
+			valid[0] = project_vertex(draw, &verts[i0], &r[0]);
+			valid[1] = project_vertex(draw, &verts[i1], &r[1]);
+			valid[2] = project_vertex(draw, &verts[i + 2], &r[2]);
+			if (valid[0] && valid[1] && valid[2])
+				draw_triangle(draw, &r[0], &r[1], &r[2],
+					      cull_mode);
+		}
+		break;
+	}
+}
@@ -0,0 +1,1813 @@
+/******************************************************************************
+    Copyright (C) 2021 by Hugh Bailey <obs.jim@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include <ctype.h>
+#include <math.h>
+#include <util/dstr.h>
+#include <graphics/srgb.h>
+#include <graphics/shader-parser.h>
+#include <graphics/matrix3.h>
+#include "sw-subsystem.h"
+
+static const char *const const_names[SW_CONST_COUNT] = {
+	[SW_CONST_COLOR] = "color",
+	[SW_CONST_RANDOMVALS1] = "randomvals1",
+	[SW_CONST_RANDOMVALS2] = "randomvals2",
+	[SW_CONST_RANDOMVALS3] = "randomvals3",
+	[SW_CONST_SCALE] = "scale",
+	[SW_CONST_BASE_DIMENSION] = "base_dimension",
+	[SW_CONST_BASE_DIMENSION_I] = "base_dimension_i",
+	[SW_CONST_UNDISTORT_FACTOR] = "undistort_factor",
+	[SW_CONST_COLOR_VEC0] = "color_vec0",
+	[SW_CONST_COLOR_VEC1] = "color_vec1",
+	[SW_CONST_COLOR_VEC2] = "color_vec2",
+	[SW_CONST_COLOR_RANGE_MIN] = "color_range_min",
+	[SW_CONST_COLOR_RANGE_MAX] = "color_range_max",
+	[SW_CONST_WIDTH] = "width",
+	[SW_CONST_HEIGHT] = "height",
+	[SW_CONST_WIDTH_I] = "width_i",
+	[SW_CONST_WIDTH_D2] = "width_d2",
+	[SW_CONST_HEIGHT_D2] = "height_d2",
+};
+
+static const char *const image_names[SW_MAX_IMAGES] = {
+	"image",
+	"image1",
+	"image2",
+	"image3",
+};
+
+#define CONST(draw, c) (&(draw)->consts[SW_CONST_##c])
+
+/* ------------------------------------------------------------------------- */
+/* vertex shaders                                                            */
+
+static inline void transform_pos(const struct sw_draw *draw,
+				 const struct sw_vertex_in *in,
+				 struct sw_vertex_out *out)
+{
+	struct vec4 pos;
+
+	vec4_set(&pos, in->pos.x, in->pos.y, in->pos.z, 1.0f);
+	vec4_transform(&out->pos, &pos, &draw->viewproj);
+}
+
+static void vs_default(const struct sw_draw *draw,
+		       const struct sw_vertex_in *in, struct sw_vertex_out *out)
+{
+	transform_pos(draw, in, out);
+	out->v[0] = in->uv;
+	out->v[1] = in->color;
+}
+
+static void vs_repeat(const struct sw_draw *draw, const struct sw_vertex_in *in,
+		      struct sw_vertex_out *out)
+{
+	const struct vec4 *scale = CONST(draw, SCALE);
+
+	transform_pos(draw, in, out);
+	vec4_set(&out->v[0], in->uv.x * scale->x, in->uv.y * scale->y, 0.0f,
+		 0.0f);
+}
+
+static void vs_scale_texels(const struct sw_draw *draw,
+			    const struct sw_vertex_in *in,
+			    struct sw_vertex_out *out)
+{
+	const struct vec4 *dim = CONST(draw, BASE_DIMENSION);
+
+	transform_pos(draw, in, out);
+	vec4_set(&out->v[0], in->uv.x * dim->x, in->uv.y * dim->y, 0.0f,
+		 0.0f);
+}
+
+/* the format conversion passes draw one oversized triangle from the vertex
+ * ID alone, with no vertex buffer */
+static inline void fullscreen_pos(const struct sw_vertex_in *in,
+				  struct sw_vertex_out *out, float *u, float *v)
+{
+	float id_high = (float)(in->id >> 1);
+	float id_low = (float)(in->id & 1);
+
+	vec4_set(&out->pos, id_high * 4.0f - 1.0f, id_low * 4.0f - 1.0f, 0.0f,
+		 1.0f);
+	*u = id_high * 2.0f;
+	*v = 1.0f - id_low * 2.0f;
+}
+
+static void vs_pos(const struct sw_draw *draw, const struct sw_vertex_in *in,
+		   struct sw_vertex_out *out)
+{
+	float u, v;
+
+	UNUSED_PARAMETER(draw);
+	fullscreen_pos(in, out, &u, &v);
+}
+
+static void vs_texpos_left(const struct sw_draw *draw,
+			   const struct sw_vertex_in *in,
+			   struct sw_vertex_out *out)
+{
+	float u, v;
+
+	fullscreen_pos(in, out, &u, &v);
+	vec4_set(&out->v[0], u - CONST(draw, WIDTH_I)->x, u, v, 0.0f);
+}
+
+static void vs_texpos_half_reverse(const struct sw_draw *draw,
+				   const struct sw_vertex_in *in,
+				   struct sw_vertex_out *out)
+{
+	float u, v;
+
+	fullscreen_pos(in, out, &u, &v);
+	vec4_set(&out->v[0], CONST(draw, WIDTH_D2)->x * u,
+		 CONST(draw, HEIGHT)->x * v, 0.0f, 0.0f);
+}
+
+static void vs_texpos_halfhalf_reverse(const struct sw_draw *draw,
+				       const struct sw_vertex_in *in,
+				       struct sw_vertex_out *out)
+{
+	float u, v;
+
+	fullscreen_pos(in, out, &u, &v);
+	vec4_set(&out->v[0], CONST(draw, WIDTH_D2)->x * u,
+		 CONST(draw, HEIGHT_D2)->x * v, 0.0f, 0.0f);
+}
+
+static void vs_poswide_reverse(const struct sw_draw *draw,
+			       const struct sw_vertex_in *in,
+			       struct sw_vertex_out *out)
+{
+	float u, v;
+
+	fullscreen_pos(in, out, &u, &v);
+	vec4_set(&out->v[0], CONST(draw, WIDTH)->x * u,
+		 CONST(draw, WIDTH_D2)->x * u, CONST(draw, HEIGHT)->x * v,
+		 0.0f);
+}
+
+/* ------------------------------------------------------------------------- */
+/* shared pixel shader helpers                                               */
+
+static inline void sample(const struct sw_draw *draw, int image, float u,
+			  float v, struct vec4 *out)
+{
+	sw_image_sample(&draw->images[image], u, v, out);
+}
+
+static inline void load(const struct sw_draw *draw, int image, float x,
+			float y, struct vec4 *out)
+{
+	sw_image_load(&draw->images[image], (int)x, (int)y, out);
+}
+
+static inline void madd(struct vec4 *acc, const struct vec4 *v, float w)
+{
+	struct vec4 t;
+	vec4_mulf(&t, v, w);
+	vec4_add(acc, acc, &t);
+}
+
+static inline float frac(float f)
+{
+	return f - floorf(f);
+}
+
+static inline float dot3(const struct vec4 *a, float x, float y, float z)
+{
+	return a->x * x + a->y * y + a->z * z;
+}
+
+static inline void alpha_divide(struct vec4 *rgba)
+{
+	float multiplier = (rgba->w > 0.0f) ? (1.0f / rgba->w) : 0.0f;
+	float alpha = rgba->w;
+
+	vec4_mulf(rgba, rgba, multiplier);
+	rgba->w = alpha;
+}
+
+static inline float clampf(float f, float min, float max)
+{
+	return f < min ? min : (f > max ? max : f);
+}
+
+static inline void yuv_to_rgb(const struct sw_draw *draw, float y, float u,
+			      float v, float a, struct vec4 *out)
+{
+	const struct vec4 *min = CONST(draw, COLOR_RANGE_MIN);
+	const struct vec4 *max = CONST(draw, COLOR_RANGE_MAX);
+	const struct vec4 *c0 = CONST(draw, COLOR_VEC0);
+	const struct vec4 *c1 = CONST(draw, COLOR_VEC1);
+	const struct vec4 *c2 = CONST(draw, COLOR_VEC2);
+
+	y = clampf(y, min->x, max->x);
+	u = clampf(u, min->y, max->y);
+	v = clampf(v, min->z, max->z);
+
+	vec4_set(out, dot3(c0, y, u, v) + c0->w, dot3(c1, y, u, v) + c1->w,
+		 dot3(c2, y, u, v) + c2->w, a);
+}
+
+/* ------------------------------------------------------------------------- */
+/* default.effect, opaque.effect, premultiplied_alpha.effect, solid.effect   */
+
+static void ps_draw_bare(const struct sw_draw *draw,
+			 const struct sw_fragment *frag, struct vec4 *out)
+{
+	sample(draw, 0, frag->v[0].x, frag->v[0].y, out);
+}
+
+static void ps_draw_alpha_divide(const struct sw_draw *draw,
+				 const struct sw_fragment *frag,
+				 struct vec4 *out)
+{
+	sample(draw, 0, frag->v[0].x, frag->v[0].y, out);
+	alpha_divide(out);
+}
+
+static void ps_draw_nonlinear_alpha(const struct sw_draw *draw,
+				    const struct sw_fragment *frag,
+				    struct vec4 *out)
+{
+	sample(draw, 0, frag->v[0].x, frag->v[0].y, out);
+	gs_float3_srgb_linear_to_nonlinear(out->ptr);
+	out->x *= out->w;
+	out->y *= out->w;
+	out->z *= out->w;
+	gs_float3_srgb_nonlinear_to_linear(out->ptr);
+}
+
+static void ps_draw_srgb_decompress(const struct sw_draw *draw,
+				    const struct sw_fragment *frag,
+				    struct vec4 *out)
+{
+	sample(draw, 0, frag->v[0].x, frag->v[0].y, out);
+	gs_float3_srgb_nonlinear_to_linear(out->ptr);
+}
+
+static void ps_draw_srgb_decompress_premultiplied(
+	const struct sw_draw *draw, const struct sw_fragment *frag,
+	struct vec4 *out)
+{
+	float alpha;
+
+	sample(draw, 0, frag->v[0].x, frag->v[0].y, out);
+	alpha = out->w;
+	alpha_divide(out);
+	out->w = alpha;
+	gs_float3_srgb_nonlinear_to_linear(out->ptr);
+}
+
+static void ps_draw_opaque(const struct sw_draw *draw,
+			   const struct sw_fragment *frag, struct vec4 *out)
+{
+	sample(draw, 0, frag->v[0].x, frag->v[0].y, out);
+	out->w = 1.0f;
+}
+
+static void ps_draw_unpremultiply(const struct sw_draw *draw,
+				  const struct sw_fragment *frag,
+				  struct vec4 *out)
+{
+	sample(draw, 0, frag->v[0].x, frag->v[0].y, out);
+	if (out->w > 0.0f) {
+		out->x /= out->w;
+		out->y /= out->w;
+		out->z /= out->w;
+	}
+
+	vec4_maxf(out, out, 0.0f);
+	vec4_minf(out, out, 1.0f);
+}
+
+static void ps_solid(const struct sw_draw *draw,
+		     const struct sw_fragment *frag, struct vec4 *out)
+{
+	UNUSED_PARAMETER(frag);
+	*out = *CONST(draw, COLOR);
+}
+
+static void ps_solid_colored(const struct sw_draw *draw,
+			     const struct sw_fragment *frag, struct vec4 *out)
+{
+	vec4_mul(out, &frag->v[1], CONST(draw, COLOR));
+}
+
+static inline float rand_val(const struct sw_fragment *frag,
+			     const struct vec4 *vals)
+{
+	float d = frag->x * vals->x + frag->y * vals->y;
+	return 0.5f + 0.5f * frac(sinf(d) * vals->z);
+}
+
+static void ps_random(const struct sw_draw *draw,
+		      const struct sw_fragment *frag, struct vec4 *out)
+{
+	vec4_set(out, rand_val(frag, CONST(draw, RANDOMVALS1)),
+		 rand_val(frag, CONST(draw, RANDOMVALS2)),
+		 rand_val(frag, CONST(draw, RANDOMVALS3)), 1.0f);
+}
+
+/* ------------------------------------------------------------------------- */
+/* format_conversion.effect                                                  */
+
+static inline void load_rgb_wide(const struct sw_draw *draw,
+				 const struct sw_fragment *frag,
+				 struct vec4 *rgb)
+{
+	struct vec4 right;
+
+	sample(draw, 0, frag->v[0].x, frag->v[0].z, rgb);
+	sample(draw, 0, frag->v[0].y, frag->v[0].z, &right);
+	vec4_add(rgb, rgb, &right);
+	vec4_mulf(rgb, rgb, 0.5f);
+}
+
+static inline float convert_channel(const struct vec4 *vec,
+				    const struct vec4 *rgb)
+{
+	return dot3(vec, rgb->x, rgb->y, rgb->z) + vec->w;
+}
+
+static void ps_y(const struct sw_draw *draw, const struct sw_fragment *frag,
+		 struct vec4 *out)
+{
+	struct vec4 rgb;
+
+	load(draw, 0, frag->x, frag->y, &rgb);
+	vec4_set(out, convert_channel(CONST(draw, COLOR_VEC0), &rgb), 0.0f,
+		 0.0f, 1.0f);
+}
+
+static void ps_u(const struct sw_draw *draw, const struct sw_fragment *frag,
+		 struct vec4 *out)
+{
+	struct vec4 rgb;
+
+	load(draw, 0, frag->x, frag->y, &rgb);
+	vec4_set(out, convert_channel(CONST(draw, COLOR_VEC1), &rgb), 0.0f,
+		 0.0f, 1.0f);
+}
+
+static void ps_v(const struct sw_draw *draw, const struct sw_fragment *frag,
+		 struct vec4 *out)
+{
+	struct vec4 rgb;
+
+	load(draw, 0, frag->x, frag->y, &rgb);
+	vec4_set(out, convert_channel(CONST(draw, COLOR_VEC2), &rgb), 0.0f,
+		 0.0f, 1.0f);
+}
+
+static void ps_u_wide(const struct sw_draw *draw,
+		      const struct sw_fragment *frag, struct vec4 *out)
+{
+	struct vec4 rgb;
+
+	load_rgb_wide(draw, frag, &rgb);
+	vec4_set(out, convert_channel(CONST(draw, COLOR_VEC1), &rgb), 0.0f,
+		 0.0f, 1.0f);
+}
+
+static void ps_v_wide(const struct sw_draw *draw,
+		      const struct sw_fragment *frag, struct vec4 *out)
+{
+	struct vec4 rgb;
+
+	load_rgb_wide(draw, frag, &rgb);
+	vec4_set(out, convert_channel(CONST(draw, COLOR_VEC2), &rgb), 0.0f,
+		 0.0f, 1.0f);
+}
+
+static void ps_uv_wide(const struct sw_draw *draw,
+		       const struct sw_fragment *frag, struct vec4 *out)
+{
+	struct vec4 rgb;
+
+	load_rgb_wide(draw, frag, &rgb);
+	vec4_set(out, convert_channel(CONST(draw, COLOR_VEC1), &rgb),
+		 convert_channel(CONST(draw, COLOR_VEC2), &rgb), 0.0f, 1.0f);
+}
+
+enum packed_422 {
+	PACKED_UYVY,
+	PACKED_YUY2,
+	PACKED_YVYU,
+};
+
+static inline void packed_422_reverse(const struct sw_draw *draw,
+				      const struct sw_fragment *frag,
+				      enum packed_422 type, struct vec4 *out)
+{
+	struct vec4 p;
+	float y0, y1, cb, cr;
+
+	load(draw, 0, frag->v[0].x, frag->v[0].y, &p);
+
+	switch (type) {
+	case PACKED_UYVY:
+		y0 = p.y;
+		y1 = p.w;
+		cb = p.z;
+		cr = p.x;
+		break;
+	case PACKED_YUY2:
+		y0 = p.z;
+		y1 = p.x;
+		cb = p.y;
+		cr = p.w;
+		break;
+	case PACKED_YVYU:
+	default:
+		y0 = p.z;
+		y1 = p.x;
+		cb = p.w;
+		cr = p.y;
+	}
+
+	yuv_to_rgb(draw, frac(frag->v[0].x) < 0.5f ? y0 : y1, cb, cr, 1.0f,
+		   out);
+}
+
+static void ps_uyvy_reverse(const struct sw_draw *draw,
+			    const struct sw_fragment *frag, struct vec4 *out)
+{
+	packed_422_reverse(draw, frag, PACKED_UYVY, out);
+}
+
+static void ps_yuy2_reverse(const struct sw_draw *draw,
+			    const struct sw_fragment *frag, struct vec4 *out)
+{
+	packed_422_reverse(draw, frag, PACKED_YUY2, out);
+}
+
+static void ps_yvyu_reverse(const struct sw_draw *draw,
+			    const struct sw_fragment *frag, struct vec4 *out)
+{
+	packed_422_reverse(draw, frag, PACKED_YVYU, out);
+}
+
+static inline void planar_reverse(const struct sw_draw *draw, float luma_x,
+				  float luma_y, float chroma_x,
+				  float chroma_y, bool alpha,
+				  struct vec4 *out)
+{
+	struct vec4 y, cb, cr, a;
+
+	load(draw, 0, luma_x, luma_y, &y);
+	load(draw, 1, chroma_x, chroma_y, &cb);
+	load(draw, 2, chroma_x, chroma_y, &cr);
+	if (alpha)
+		load(draw, 3, luma_x, luma_y, &a);
+	else
+		a.x = 1.0f;
+
+	yuv_to_rgb(draw, y.x, cb.x, cr.x, a.x, out);
+}
+
+static void ps_planar420_reverse(const struct sw_draw *draw,
+				 const struct sw_fragment *frag,
+				 struct vec4 *out)
+{
+	planar_reverse(draw, frag->x, frag->y, frag->v[0].x, frag->v[0].y,
+		       false, out);
+}
+
+static void ps_planar420a_reverse(const struct sw_draw *draw,
+				  const struct sw_fragment *frag,
+				  struct vec4 *out)
+{
+	planar_reverse(draw, frag->x, frag->y, frag->v[0].x, frag->v[0].y,
+		       true, out);
+}
+
+static void ps_planar422_reverse(const struct sw_draw *draw,
+				 const struct sw_fragment *frag,
+				 struct vec4 *out)
+{
+	planar_reverse(draw, frag->v[0].x, frag->v[0].z, frag->v[0].y,
+		       frag->v[0].z, false, out);
+}
+
+static void ps_planar422a_reverse(const struct sw_draw *draw,
+				  const struct sw_fragment *frag,
+				  struct vec4 *out)
+{
+	planar_reverse(draw, frag->v[0].x, frag->v[0].z, frag->v[0].y,
+		       frag->v[0].z, true, out);
+}
+
+static void ps_planar444_reverse(const struct sw_draw *draw,
+				 const struct sw_fragment *frag,
+				 struct vec4 *out)
+{
+	planar_reverse(draw, frag->x, frag->y, frag->x, frag->y, false, out);
+}
+
+static void ps_planar444a_reverse(const struct sw_draw *draw,
+				  const struct sw_fragment *frag,
+				  struct vec4 *out)
+{
+	planar_reverse(draw, frag->x, frag->y, frag->x, frag->y, true, out);
+}
+
+static void ps_ayuv_reverse(const struct sw_draw *draw,
+			    const struct sw_fragment *frag, struct vec4 *out)
+{
+	struct vec4 yuva;
+
+	load(draw, 0, frag->x, frag->y, &yuva);
+	yuv_to_rgb(draw, yuva.x, yuva.y, yuva.z, yuva.w, out);
+}
+
+static void ps_nv12_reverse(const struct sw_draw *draw,
+			    const struct sw_fragment *frag, struct vec4 *out)
+{
+	struct vec4 y, cbcr;
+
+	load(draw, 0, frag->x, frag->y, &y);
+	load(draw, 1, frag->v[0].x, frag->v[0].y, &cbcr);
+	yuv_to_rgb(draw, y.x, cbcr.x, cbcr.y, 1.0f, out);
+}
+
+static inline float expand_limited(float limited)
+{
+	return (255.0f / 219.0f) * limited - (16.0f / 219.0f);
+}
+
+static void ps_y800_limited(const struct sw_draw *draw,
+			    const struct sw_fragment *frag, struct vec4 *out)
+{
+	struct vec4 y;
+	float full;
+
+	load(draw, 0, frag->x, frag->y, &y);
+	full = expand_limited(y.x);
+	vec4_set(out, full, full, full, 1.0f);
+}
+
+static void ps_y800_full(const struct sw_draw *draw,
+			 const struct sw_fragment *frag, struct vec4 *out)
+{
+	struct vec4 y;
+
+	load(draw, 0, frag->x, frag->y, &y);
+	vec4_set(out, y.x, y.x, y.x, 1.0f);
+}
+
+static void ps_rgb_limited(const struct sw_draw *draw,
+			   const struct sw_fragment *frag, struct vec4 *out)
+{
+	load(draw, 0, frag->x, frag->y, out);
+	out->x = expand_limited(out->x);
+	out->y = expand_limited(out->y);
+	out->z = expand_limited(out->z);
+}
+
+static inline void bgr3(const struct sw_draw *draw,
+			const struct sw_fragment *frag, bool limited,
+			struct vec4 *out)
+{
+	float x = frag->x * 3.0f;
+	struct vec4 b, g, r;
+
+	load(draw, 0, x - 1.0f, frag->y, &b);
+	load(draw, 0, x, frag->y, &g);
+	load(draw, 0, x + 1.0f, frag->y, &r);
+
+	if (limited)
+		vec4_set(out, expand_limited(r.x), expand_limited(g.x),
+			 expand_limited(b.x), 1.0f);
+	else
+		vec4_set(out, r.x, g.x, b.x, 1.0f);
+}
+
+static void ps_bgr3_limited(const struct sw_draw *draw,
+			    const struct sw_fragment *frag, struct vec4 *out)
+{
+	bgr3(draw, frag, true, out);
+}
+
+static void ps_bgr3_full(const struct sw_draw *draw,
+			 const struct sw_fragment *frag, struct vec4 *out)
+{
+	bgr3(draw, frag, false, out);
+}
+
+/* ------------------------------------------------------------------------- */
+/* bicubic_scale.effect, lanczos_scale.effect                                */
+
+static inline float undistort_u(const struct sw_draw *draw, float u)
+{
+	float a = CONST(draw, UNDISTORT_FACTOR)->x;
+	float x = (u - 0.5f) * 2.0f;
+
+	x = (1.0f - a) * (x * x * x * x * x) + a * x;
+	return x * 0.5f + 0.5f;
+}
+
+/* separable filter over a square grid of taps, sampled through the
+ * undistort curve */
+static void draw_undistorted(const struct sw_draw *draw, const float *xpos,
+			     const float *ypos, const float *rowtaps,
+			     const float *coltaps, int taps, struct vec4 *out)
+{
+	vec4_zero(out);
+
+	for (int j = 0; j < taps; j++) {
+		struct vec4 line, texel;
+		vec4_zero(&line);
+
+		for (int i = 0; i < taps; i++) {
+			sample(draw, 0, undistort_u(draw, xpos[i]), ypos[j],
+			       &texel);
+			madd(&line, &texel, rowtaps[i]);
+		}
+
+		madd(out, &line, coltaps[j]);
+	}
+}
+
+static inline void bicubic_weights(float x, float *w)
+{
+	w[0] = ((-0.75f * x + 1.5f) * x - 0.75f) * x;
+	w[1] = (1.25f * x - 2.25f) * x * x + 1.0f;
+	w[2] = ((-1.25f * x + 1.5f) * x + 0.75f) * x;
+	w[3] = (0.75f * x - 0.75f) * x * x;
+}
+
+static void draw_bicubic(const struct sw_draw *draw,
+			 const struct sw_fragment *frag, struct vec4 *out)
+{
+	const struct vec4 *dim = CONST(draw, BASE_DIMENSION);
+	const struct vec4 *dim_i = CONST(draw, BASE_DIMENSION_I);
+	float pos1_x = floorf(frag->v[0].x - 0.5f) + 0.5f;
+	float pos1_y = floorf(frag->v[0].y - 0.5f) + 0.5f;
+	float rowtaps[4], coltaps[4];
+	float xpos[4], ypos[4];
+	struct vec4 texel, row;
+
+	bicubic_weights(frag->v[0].x - pos1_x, rowtaps);
+	bicubic_weights(frag->v[0].y - pos1_y, coltaps);
+
+	for (int i = 0; i < 4; i++) {
+		xpos[i] = (pos1_x + (float)(i - 1)) * dim_i->x;
+		ypos[i] = (pos1_y + (float)(i - 1)) * dim_i->y;
+	}
+
+	if (draw->undistort) {
+		draw_undistorted(draw, xpos, ypos, rowtaps, coltaps, 4, out);
+		return;
+	}
+
+	/* the middle taps are merged into one bilinear sample, and the
+	 * corners are loaded directly, as the effect does */
+	float u_weight_sum = rowtaps[1] + rowtaps[2];
+	float u_middle = xpos[1] + rowtaps[2] * dim_i->x / u_weight_sum;
+	float v_weight_sum = coltaps[1] + coltaps[2];
+	float v_middle = ypos[1] + coltaps[2] * dim_i->y / v_weight_sum;
+
+	float left = fmaxf(xpos[0] * dim->x, 0.5f);
+	float top = fmaxf(ypos[0] * dim->y, 0.5f);
+	float right = fminf(xpos[3] * dim->x, dim->x - 0.5f);
+	float bottom = fminf(ypos[3] * dim->y, dim->y - 0.5f);
+
+	load(draw, 0, left, top, &texel);
+	vec4_mulf(&row, &texel, rowtaps[0]);
+	sample(draw, 0, u_middle, ypos[0], &texel);
+	madd(&row, &texel, u_weight_sum);
+	load(draw, 0, right, top, &texel);
+	madd(&row, &texel, rowtaps[3]);
+	vec4_mulf(out, &row, coltaps[0]);
+
+	sample(draw, 0, xpos[0], v_middle, &texel);
+	vec4_mulf(&row, &texel, rowtaps[0]);
+	sample(draw, 0, u_middle, v_middle, &texel);
+	madd(&row, &texel, u_weight_sum);
+	sample(draw, 0, xpos[3], v_middle, &texel);
+	madd(&row, &texel, rowtaps[3]);
+	madd(out, &row, v_weight_sum);
+
+	load(draw, 0, left, bottom, &texel);
+	vec4_mulf(&row, &texel, rowtaps[0]);
+	sample(draw, 0, u_middle, ypos[3], &texel);
+	madd(&row, &texel, u_weight_sum);
+	load(draw, 0, right, bottom, &texel);
+	madd(&row, &texel, rowtaps[3]);
+	madd(out, &row, coltaps[3]);
+}
+
+static void ps_bicubic(const struct sw_draw *draw,
+		       const struct sw_fragment *frag, struct vec4 *out)
+{
+	draw_bicubic(draw, frag, out);
+}
+
+static void ps_bicubic_divide(const struct sw_draw *draw,
+			      const struct sw_fragment *frag, struct vec4 *out)
+{
+	draw_bicubic(draw, frag, out);
+	alpha_divide(out);
+}
+
+static inline float lanczos_weight(float x)
+{
+	float x_pi = x * 3.141592654f;
+	return 3.0f * sinf(x_pi) * sinf(x_pi * (1.0f / 3.0f)) / (x_pi * x_pi);
+}
+
+static inline void lanczos_weights(float f_neg, float *w)
+{
+	float sum = 0.0f;
+
+	w[0] = lanczos_weight(f_neg - 2.0f);
+	w[1] = lanczos_weight(f_neg - 1.0f);
+	w[2] = fminf(1.0f, lanczos_weight(f_neg)); /* replaces NaN with 1 */
+	w[3] = lanczos_weight(f_neg + 1.0f);
+	w[4] = lanczos_weight(f_neg + 2.0f);
+	w[5] = lanczos_weight(f_neg + 3.0f);
+
+	for (int i = 0; i < 6; i++)
+		sum += w[i];
+	for (int i = 0; i < 6; i++)
+		w[i] /= sum;
+}
+
+static void draw_lanczos(const struct sw_draw *draw,
+			 const struct sw_fragment *frag, struct vec4 *out)
+{
+	const struct vec4 *dim = CONST(draw, BASE_DIMENSION);
+	const struct vec4 *dim_i = CONST(draw, BASE_DIMENSION_I);
+	float pos2_x = floorf(frag->v[0].x - 0.5f) + 0.5f;
+	float pos2_y = floorf(frag->v[0].y - 0.5f) + 0.5f;
+	float rowtaps[6], coltaps[6];
+	float xpos[6], ypos[6];
+	float load_x[6], load_y[6];
+	struct vec4 texel, row;
+
+	lanczos_weights(pos2_x - frag->v[0].x, rowtaps);
+	lanczos_weights(pos2_y - frag->v[0].y, coltaps);
+
+	for (int i = 0; i < 6; i++) {
+		xpos[i] = (pos2_x + (float)(i - 2)) * dim_i->x;
+		ypos[i] = (pos2_y + (float)(i - 2)) * dim_i->y;
+	}
+
+	if (draw->undistort) {
+		draw_undistorted(draw, xpos, ypos, rowtaps, coltaps, 6, out);
+		return;
+	}
+
+	/* taps 2 and 3 are merged into one bilinear sample on each axis, the
+	 * rest are loaded directly, as the effect does */
+	float u_weight_sum = rowtaps[2] + rowtaps[3];
+	float u_middle = xpos[2] + rowtaps[3] * dim_i->x / u_weight_sum;
+	float v_weight_sum = coltaps[2] + coltaps[3];
+	float v_middle = ypos[2] + coltaps[3] * dim_i->y / v_weight_sum;
+
+	for (int i = 0; i < 2; i++) {
+		load_x[i] = fmaxf(xpos[i] * dim->x, 0.5f);
+		load_y[i] = fmaxf(ypos[i] * dim->y, 0.5f);
+	}
+	for (int i = 4; i < 6; i++) {
+		load_x[i] = fminf(xpos[i] * dim->x, dim->x - 0.5f);
+		load_y[i] = fminf(ypos[i] * dim->y, dim->y - 0.5f);
+	}
+
+	vec4_zero(out);
+
+	for (int j = 0; j < 6; j++) {
+		if (j == 3)
+			continue;
+
+		vec4_zero(&row);
+
+		for (int i = 0; i < 6; i++) {
+			if (i == 3)
+				continue;
+
+			if (j == 2) {
+				float u = i == 2 ? u_middle : xpos[i];
+				sample(draw, 0, u, v_middle, &texel);
+			} else if (i == 2) {
+				sample(draw, 0, u_middle, ypos[j], &texel);
+			} else {
+				load(draw, 0, load_x[i], load_y[j], &texel);
+			}
+
+			madd(&row, &texel, i == 2 ? u_weight_sum : rowtaps[i]);
+		}
+
+		madd(out, &row, j == 2 ? v_weight_sum : coltaps[j]);
+	}
+}
+
+static void ps_lanczos(const struct sw_draw *draw,
+		       const struct sw_fragment *frag, struct vec4 *out)
+{
+	draw_lanczos(draw, frag, out);
+}
+
+static void ps_lanczos_divide(const struct sw_draw *draw,
+			      const struct sw_fragment *frag, struct vec4 *out)
+{
+	draw_lanczos(draw, frag, out);
+	alpha_divide(out);
+}
+
+/* ------------------------------------------------------------------------- */
+/* area.effect, bilinear_lowres_scale.effect                                 */
+
+static void draw_area(const struct sw_draw *draw,
+		      const struct sw_fragment *frag, struct vec4 *out)
+{
+	const struct vec4 *dim = CONST(draw, BASE_DIMENSION);
+	const struct vec4 *dim_i = CONST(draw, BASE_DIMENSION_I);
+	float u = frag->v[0].x;
+	float v = frag->v[0].y;
+	float du = frag->ddx.x;
+	float dv = fabsf(frag->ddy.y);
+
+	float u_min = u - 0.5f * du;
+	float v_min = v - 0.5f * dv;
+	float begin_x = floorf(u_min * dim->x);
+	float begin_y = floorf(v_min * dim->y);
+	float end_x = ceilf((u_min + du) * dim->x);
+	float end_y = ceilf((v_min + dv) * dim->y);
+
+	float target_x = u / du;
+	float target_y = v / dv;
+	float scale_x = dim_i->x / du;
+	float scale_y = dim_i->y / dv;
+
+	struct vec4 texel;
+	vec4_zero(out);
+
+	float y = begin_y;
+	do {
+		float src_y_min = y * scale_y;
+		float y_min = fmaxf(src_y_min, target_y - 0.5f);
+		float y_max = fminf(src_y_min + scale_y, target_y + 0.5f);
+		float height = y_max - y_min;
+
+		float x = begin_x;
+		do {
+			float src_x_min = x * scale_x;
+			float x_min = fmaxf(src_x_min, target_x - 0.5f);
+			float x_max =
+				fminf(src_x_min + scale_x, target_x + 0.5f);
+
+			load(draw, 0, x, y, &texel);
+			madd(out, &texel, (x_max - x_min) * height);
+			x += 1.0f;
+		} while (x < end_x);
+
+		y += 1.0f;
+	} while (y < end_y);
+}
+
+static void ps_area(const struct sw_draw *draw,
+		    const struct sw_fragment *frag, struct vec4 *out)
+{
+	draw_area(draw, frag, out);
+}
+
+static void ps_area_divide(const struct sw_draw *draw,
+			   const struct sw_fragment *frag, struct vec4 *out)
+{
+	draw_area(draw, frag, out);
+	alpha_divide(out);
+}
+
+static void ps_area_upscale(const struct sw_draw *draw,
+			    const struct sw_fragment *frag, struct vec4 *out)
+{
+	const struct vec4 *dim = CONST(draw, BASE_DIMENSION);
+	const struct vec4 *dim_i = CONST(draw, BASE_DIMENSION_I);
+	float u = frag->v[0].x;
+	float v = frag->v[0].y;
+	float du = frag->ddx.x;
+	float dv = fabsf(frag->ddy.y);
+
+	float u_min = u - 0.5f * du;
+	float v_min = v - 0.5f * dv;
+	float first_x = floorf(u_min * dim->x);
+	float first_y = floorf(v_min * dim->y);
+	float last_x = ceilf((u_min + du) * dim->x) - 1.0f;
+	float last_y = ceilf((v_min + dv) * dim->y) - 1.0f;
+
+	if (first_x < last_x) {
+		float boundary = last_x * dim_i->x;
+		u = ((u - boundary) / du) * dim_i->x + boundary;
+	} else {
+		u = (first_x + 0.5f) * dim_i->x;
+	}
+
+	if (first_y < last_y) {
+		float boundary = last_y * dim_i->y;
+		v = ((v - boundary) / dv) * dim_i->y + boundary;
+	} else {
+		v = (first_y + 0.5f) * dim_i->y;
+	}
+
+	sample(draw, 0, u, v, out);
+}
+
+static void draw_lowres_bilinear(const struct sw_draw *draw,
+				 const struct sw_fragment *frag,
+				 struct vec4 *out)
+{
+	/* Direct3D 8-sample pattern, in sixteenths of a pixel */
+	static const float offsets[8][2] = {
+		{1.0f, -3.0f}, {-1.0f, 3.0f}, {5.0f, 1.0f},  {-3.0f, -5.0f},
+		{-5.0f, 5.0f}, {-7.0f, -1.0f}, {3.0f, 7.0f}, {7.0f, -7.0f},
+	};
+	float step_x = frag->ddx.x * 0.0625f;
+	float step_y = frag->ddy.y * 0.0625f;
+	struct vec4 texel;
+
+	vec4_zero(out);
+
+	for (int i = 0; i < 8; i++) {
+		sample(draw, 0, frag->v[0].x + offsets[i][0] * step_x,
+		       frag->v[0].y + offsets[i][1] * step_y, &texel);
+		vec4_add(out, out, &texel);
+	}
+
+	vec4_mulf(out, out, 0.125f);
+}
+
+static void ps_lowres_bilinear(const struct sw_draw *draw,
+			       const struct sw_fragment *frag,
+			       struct vec4 *out)
+{
+	draw_lowres_bilinear(draw, frag, out);
+}
+
+static void ps_lowres_bilinear_divide(const struct sw_draw *draw,
+				      const struct sw_fragment *frag,
+				      struct vec4 *out)
+{
+	draw_lowres_bilinear(draw, frag, out);
+	alpha_divide(out);
+}
+
+/* ------------------------------------------------------------------------- */
+/* span kernels                                                              */
+
+static void span_draw_bare(const struct sw_draw *draw,
+			   const struct sw_fragment *frag,
+			   const struct vec4 *dvdx, int count, struct vec4 *out)
+{
+	sw_image_sample_span(&draw->images[0], frag->v[0].x, frag->v[0].y,
+			     dvdx[0].x, dvdx[0].y, count, out);
+}
+
+static void span_draw_alpha_divide(const struct sw_draw *draw,
+				   const struct sw_fragment *frag,
+				   const struct vec4 *dvdx, int count,
+				   struct vec4 *out)
+{
+	span_draw_bare(draw, frag, dvdx, count, out);
+	for (int i = 0; i < count; i++)
+		alpha_divide(&out[i]);
+}
+
+static void span_draw_opaque(const struct sw_draw *draw,
+			     const struct sw_fragment *frag,
+			     const struct vec4 *dvdx, int count,
+			     struct vec4 *out)
+{
+	span_draw_bare(draw, frag, dvdx, count, out);
+	for (int i = 0; i < count; i++)
+		out[i].w = 1.0f;
+}
+
+/* the color conversions run on four pixels at a time, with each channel of
+ * the four in its own register.  spans are padded with zeros to a multiple
+ * of four */
+
+static inline void pad4(struct vec4 *v, int count)
+{
+	for (int i = count; i & 3; i++)
+		vec4_zero(&v[i]);
+}
+
+static inline __m128 gather4(const struct vec4 *v, int channel)
+{
+	return _mm_set_ps(v[3].ptr[channel], v[2].ptr[channel],
+			  v[1].ptr[channel], v[0].ptr[channel]);
+}
+
+static inline void scatter4(struct vec4 *out, __m128 x, __m128 y, __m128 z,
+			    __m128 w)
+{
+	_MM_TRANSPOSE4_PS(x, y, z, w);
+	out[0].m = x;
+	out[1].m = y;
+	out[2].m = z;
+	out[3].m = w;
+}
+
+static inline __m128 convert_channel4(const struct vec4 *vec, __m128 x,
+				      __m128 y, __m128 z)
+{
+	__m128 c = _mm_mul_ps(x, _mm_set1_ps(vec->x));
+
+	c = _mm_add_ps(c, _mm_mul_ps(y, _mm_set1_ps(vec->y)));
+	c = _mm_add_ps(c, _mm_mul_ps(z, _mm_set1_ps(vec->z)));
+	return _mm_add_ps(c, _mm_set1_ps(vec->w));
+}
+
+static inline __m128 clamp4(__m128 v, float min, float max)
+{
+	return _mm_min_ps(_mm_max_ps(v, _mm_set1_ps(min)), _mm_set1_ps(max));
+}
+
+static inline void yuv_to_rgb4(const struct sw_draw *draw, __m128 y,
+			       __m128 u, __m128 v, __m128 a, struct vec4 *out)
+{
+	const struct vec4 *min = CONST(draw, COLOR_RANGE_MIN);
+	const struct vec4 *max = CONST(draw, COLOR_RANGE_MAX);
+
+	y = clamp4(y, min->x, max->x);
+	u = clamp4(u, min->y, max->y);
+	v = clamp4(v, min->z, max->z);
+
+	scatter4(out, convert_channel4(CONST(draw, COLOR_VEC0), y, u, v),
+		 convert_channel4(CONST(draw, COLOR_VEC1), y, u, v),
+		 convert_channel4(CONST(draw, COLOR_VEC2), y, u, v), a);
+}
+
+/* out is (vec0 . rgb, vec1 . rgb or 0, 0, 1), and may be rgb */
+static inline void rgb_to_channel_span(const struct vec4 *rgb, int count,
+				       const struct vec4 *vec0,
+				       const struct vec4 *vec1,
+				       struct vec4 *out)
+{
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 one = _mm_set1_ps(1.0f);
+
+	for (int i = 0; i < count; i += 4) {
+		__m128 r = gather4(&rgb[i], 0);
+		__m128 g = gather4(&rgb[i], 1);
+		__m128 b = gather4(&rgb[i], 2);
+		__m128 c1 = vec1 ? convert_channel4(vec1, r, g, b) : zero;
+
+		scatter4(&out[i], convert_channel4(vec0, r, g, b), c1, zero,
+			 one);
+	}
+}
+
+static inline void load_rgb_span(const struct sw_draw *draw,
+				 const struct sw_fragment *frag, int count,
+				 struct vec4 *rgb)
+{
+	sw_image_load_span(&draw->images[0], frag->x, frag->y, 1.0f, 0.0f,
+			   count, rgb);
+	pad4(rgb, count);
+}
+
+static inline void load_rgb_wide_span(const struct sw_draw *draw,
+				      const struct sw_fragment *frag,
+				      const struct vec4 *dvdx, int count,
+				      struct vec4 *rgb)
+{
+	struct vec4 right[SW_SPAN_PIXELS];
+
+	sw_image_sample_span(&draw->images[0], frag->v[0].x, frag->v[0].z,
+			     dvdx[0].x, dvdx[0].z, count, rgb);
+	sw_image_sample_span(&draw->images[0], frag->v[0].y, frag->v[0].z,
+			     dvdx[0].y, dvdx[0].z, count, right);
+
+	for (int i = 0; i < count; i++) {
+		vec4_add(&rgb[i], &rgb[i], &right[i]);
+		vec4_mulf(&rgb[i], &rgb[i], 0.5f);
+	}
+
+	pad4(rgb, count);
+}
+
+static void span_y(const struct sw_draw *draw, const struct sw_fragment *frag,
+		   const struct vec4 *dvdx, int count, struct vec4 *out)
+{
+	UNUSED_PARAMETER(dvdx);
+
+	load_rgb_span(draw, frag, count, out);
+	rgb_to_channel_span(out, count, CONST(draw, COLOR_VEC0), NULL, out);
+}
+
+static void span_u(const struct sw_draw *draw, const struct sw_fragment *frag,
+		   const struct vec4 *dvdx, int count, struct vec4 *out)
+{
+	UNUSED_PARAMETER(dvdx);
+
+	load_rgb_span(draw, frag, count, out);
+	rgb_to_channel_span(out, count, CONST(draw, COLOR_VEC1), NULL, out);
+}
+
+static void span_v(const struct sw_draw *draw, const struct sw_fragment *frag,
+		   const struct vec4 *dvdx, int count, struct vec4 *out)
+{
+	UNUSED_PARAMETER(dvdx);
+
+	load_rgb_span(draw, frag, count, out);
+	rgb_to_channel_span(out, count, CONST(draw, COLOR_VEC2), NULL, out);
+}
+
+static void span_u_wide(const struct sw_draw *draw,
+			const struct sw_fragment *frag,
+			const struct vec4 *dvdx, int count, struct vec4 *out)
+{
+	load_rgb_wide_span(draw, frag, dvdx, count, out);
+	rgb_to_channel_span(out, count, CONST(draw, COLOR_VEC1), NULL, out);
+}
+
+static void span_v_wide(const struct sw_draw *draw,
+			const struct sw_fragment *frag,
+			const struct vec4 *dvdx, int count, struct vec4 *out)
+{
+	load_rgb_wide_span(draw, frag, dvdx, count, out);
+	rgb_to_channel_span(out, count, CONST(draw, COLOR_VEC2), NULL, out);
+}
+
+static void span_uv_wide(const struct sw_draw *draw,
+			 const struct sw_fragment *frag,
+			 const struct vec4 *dvdx, int count, struct vec4 *out)
+{
+	load_rgb_wide_span(draw, frag, dvdx, count, out);
+	rgb_to_channel_span(out, count, CONST(draw, COLOR_VEC1),
+			    CONST(draw, COLOR_VEC2), out);
+}
+
+static inline void planar_reverse_span(const struct sw_draw *draw,
+				       const struct vec4 *luma,
+				       const struct vec4 *luma_d,
+				       const struct vec4 *chroma,
+				       const struct vec4 *chroma_d, int count,
+				       struct vec4 *out)
+{
+	struct vec4 y[SW_SPAN_PIXELS];
+	struct vec4 cb[SW_SPAN_PIXELS];
+	struct vec4 cr[SW_SPAN_PIXELS];
+	const __m128 one = _mm_set1_ps(1.0f);
+
+	sw_image_load_span(&draw->images[0], luma->x, luma->y, luma_d->x,
+			   luma_d->y, count, y);
+	sw_image_load_span(&draw->images[1], chroma->x, chroma->y,
+			   chroma_d->x, chroma_d->y, count, cb);
+	sw_image_load_span(&draw->images[2], chroma->x, chroma->y,
+			   chroma_d->x, chroma_d->y, count, cr);
+	pad4(y, count);
+	pad4(cb, count);
+	pad4(cr, count);
+
+	for (int i = 0; i < count; i += 4)
+		yuv_to_rgb4(draw, gather4(&y[i], 0), gather4(&cb[i], 0),
+			    gather4(&cr[i], 0), one, &out[i]);
+}
+
+/* x and y of luma/chroma hold the coordinates, as planar_reverse takes them,
+ * and x and y of luma_d/chroma_d their steps */
+
+static void span_planar420_reverse(const struct sw_draw *draw,
+				   const struct sw_fragment *frag,
+				   const struct vec4 *dvdx, int count,
+				   struct vec4 *out)
+{
+	struct vec4 luma, luma_d, chroma, chroma_d;
+
+	vec4_set(&luma, frag->x, frag->y, 0.0f, 0.0f);
+	vec4_set(&luma_d, 1.0f, 0.0f, 0.0f, 0.0f);
+	vec4_set(&chroma, frag->v[0].x, frag->v[0].y, 0.0f, 0.0f);
+	vec4_set(&chroma_d, dvdx[0].x, dvdx[0].y, 0.0f, 0.0f);
+	planar_reverse_span(draw, &luma, &luma_d, &chroma, &chroma_d, count,
+			    out);
+}
+
+static void span_planar422_reverse(const struct sw_draw *draw,
+				   const struct sw_fragment *frag,
+				   const struct vec4 *dvdx, int count,
+				   struct vec4 *out)
+{
+	struct vec4 luma, luma_d, chroma, chroma_d;
+
+	vec4_set(&luma, frag->v[0].x, frag->v[0].z, 0.0f, 0.0f);
+	vec4_set(&luma_d, dvdx[0].x, dvdx[0].z, 0.0f, 0.0f);
+	vec4_set(&chroma, frag->v[0].y, frag->v[0].z, 0.0f, 0.0f);
+	vec4_set(&chroma_d, dvdx[0].y, dvdx[0].z, 0.0f, 0.0f);
+	planar_reverse_span(draw, &luma, &luma_d, &chroma, &chroma_d, count,
+			    out);
+}
+
+static void span_planar444_reverse(const struct sw_draw *draw,
+				   const struct sw_fragment *frag,
+				   const struct vec4 *dvdx, int count,
+				   struct vec4 *out)
+{
+	struct vec4 pos, d;
+
+	UNUSED_PARAMETER(dvdx);
+
+	vec4_set(&pos, frag->x, frag->y, 0.0f, 0.0f);
+	vec4_set(&d, 1.0f, 0.0f, 0.0f, 0.0f);
+	planar_reverse_span(draw, &pos, &d, &pos, &d, count, out);
+}
+
+static void span_nv12_reverse(const struct sw_draw *draw,
+			      const struct sw_fragment *frag,
+			      const struct vec4 *dvdx, int count,
+			      struct vec4 *out)
+{
+	struct vec4 y[SW_SPAN_PIXELS];
+	struct vec4 cbcr[SW_SPAN_PIXELS];
+	const __m128 one = _mm_set1_ps(1.0f);
+
+	sw_image_load_span(&draw->images[0], frag->x, frag->y, 1.0f, 0.0f,
+			   count, y);
+	sw_image_load_span(&draw->images[1], frag->v[0].x, frag->v[0].y,
+			   dvdx[0].x, dvdx[0].y, count, cbcr);
+	pad4(y, count);
+	pad4(cbcr, count);
+
+	for (int i = 0; i < count; i += 4)
+		yuv_to_rgb4(draw, gather4(&y[i], 0), gather4(&cbcr[i], 0),
+			    gather4(&cbcr[i], 1), one, &out[i]);
+}
+
+/* ------------------------------------------------------------------------- */
+
+struct sw_func {
+	const char *effect; /* NULL matches any effect file */
+	const char *name;
+	sw_vertex_func vertex;
+	sw_pixel_func pixel;
+	sw_span_func span;
+};
+
+#define VS(effect, name, func) {effect, name, func, NULL, NULL}
+#define PS(effect, name, func) {effect, name, NULL, func, NULL}
+#define PS_SPAN(effect, name, func, span) {effect, name, NULL, func, span}
+
+static const struct sw_func sw_funcs[] = {
+	VS("repeat.effect", "VSDefault", vs_repeat),
+	VS("bicubic_scale.effect", "VSDefault", vs_scale_texels),
+	VS("lanczos_scale.effect", "VSDefault", vs_scale_texels),
+	VS(NULL, "VSDefault", vs_default),
+	VS(NULL, "VSSolid", vs_default),
+	VS(NULL, "VSSolidColored", vs_default),
+	VS(NULL, "VSPos", vs_pos),
+	VS(NULL, "VSTexPos_Left", vs_texpos_left),
+	VS(NULL, "VSTexPosHalf_Reverse", vs_texpos_half_reverse),
+	VS(NULL, "VSTexPosHalfHalf_Reverse", vs_texpos_halfhalf_reverse),
+	VS(NULL, "VSPosWide_Reverse", vs_poswide_reverse),
+
+	PS_SPAN("opaque.effect", "PSDraw", ps_draw_opaque, span_draw_opaque),
+	PS("premultiplied_alpha.effect", "PSDraw", ps_draw_unpremultiply),
+	PS_SPAN(NULL, "PSDrawBare", ps_draw_bare, span_draw_bare),
+	PS_SPAN(NULL, "PSDrawAlphaDivide", ps_draw_alpha_divide,
+		span_draw_alpha_divide),
+	PS(NULL, "PSDrawNonlinearAlpha", ps_draw_nonlinear_alpha),
+	PS(NULL, "PSDrawSrgbDecompress", ps_draw_srgb_decompress),
+	PS(NULL, "PSDrawSrgbDecompressPremultiplied",
+	   ps_draw_srgb_decompress_premultiplied),
+	PS(NULL, "PSSolid", ps_solid),
+	PS(NULL, "PSSolidColored", ps_solid_colored),
+	PS(NULL, "PSRandom", ps_random),
+
+	PS_SPAN(NULL, "PS_Y", ps_y, span_y),
+	PS_SPAN(NULL, "PS_U", ps_u, span_u),
+	PS_SPAN(NULL, "PS_V", ps_v, span_v),
+	PS_SPAN(NULL, "PS_U_Wide", ps_u_wide, span_u_wide),
+	PS_SPAN(NULL, "PS_V_Wide", ps_v_wide, span_v_wide),
+	PS_SPAN(NULL, "PS_UV_Wide", ps_uv_wide, span_uv_wide),
+	PS(NULL, "PSUYVY_Reverse", ps_uyvy_reverse),
+	PS(NULL, "PSYUY2_Reverse", ps_yuy2_reverse),
+	PS(NULL, "PSYVYU_Reverse", ps_yvyu_reverse),
+	PS_SPAN(NULL, "PSPlanar420_Reverse", ps_planar420_reverse,
+		span_planar420_reverse),
+	PS(NULL, "PSPlanar420A_Reverse", ps_planar420a_reverse),
+	PS_SPAN(NULL, "PSPlanar422_Reverse", ps_planar422_reverse,
+		span_planar422_reverse),
+	PS(NULL, "PSPlanar422A_Reverse", ps_planar422a_reverse),
+	PS_SPAN(NULL, "PSPlanar444_Reverse", ps_planar444_reverse,
+		span_planar444_reverse),
+	PS(NULL, "PSPlanar444A_Reverse", ps_planar444a_reverse),
+	PS(NULL, "PSAYUV_Reverse", ps_ayuv_reverse),
+	PS_SPAN(NULL, "PSNV12_Reverse", ps_nv12_reverse,
+		span_nv12_reverse),
+	PS(NULL, "PSY800_Limited", ps_y800_limited),
+	PS(NULL, "PSY800_Full", ps_y800_full),
+	PS(NULL, "PSRGB_Limited", ps_rgb_limited),
+	PS(NULL, "PSBGR3_Limited", ps_bgr3_limited),
+	PS(NULL, "PSBGR3_Full", ps_bgr3_full),
+
+	PS(NULL, "PSDrawBicubicRGBA", ps_bicubic),
+	PS(NULL, "PSDrawBicubicRGBADivide", ps_bicubic_divide),
+	PS(NULL, "PSDrawLanczosRGBA", ps_lanczos),
+	PS(NULL, "PSDrawLanczosRGBADivide", ps_lanczos_divide),
+	PS(NULL, "PSDrawAreaRGBA", ps_area),
+	PS(NULL, "PSDrawAreaRGBADivide", ps_area_divide),
+	PS(NULL, "PSDrawAreaRGBAUpscale", ps_area_upscale),
+	PS(NULL, "PSDrawLowresBilinearRGBA", ps_lowres_bilinear),
+	PS(NULL, "PSDrawLowresBilinearRGBADivide",
+	   ps_lowres_bilinear_divide),
+};
+
+#undef VS
+#undef PS
+#undef PS_SPAN
+
+static const struct sw_func *find_func(enum gs_shader_type type,
+				       const char *effect, const char *name)
+{
+	const struct sw_func *generic = NULL;
+
+	for (size_t i = 0; i < sizeof(sw_funcs) / sizeof(sw_funcs[0]); i++) {
+		const struct sw_func *func = &sw_funcs[i];
+		bool is_vertex = func->vertex != NULL;
+
+		if (is_vertex != (type == GS_SHADER_VERTEX))
+			continue;
+		if (strcmp(func->name, name) != 0)
+			continue;
+
+		if (!func->effect) {
+			if (!generic)
+				generic = func;
+		} else if (effect && strcmp(func->effect, effect) == 0) {
+			return func;
+		}
+	}
+
+	return generic;
+}
+
+/* effect shaders end in a generated "main" that returns a call to the entry
+ * function, so that call names the function to emulate */
+static void get_entry_func(struct dstr *name, const char *shader_str)
+{
+	const char *ret = NULL;
+	const char *pos = shader_str;
+	const char *end;
+
+	while ((pos = strstr(pos, "return ")) != NULL) {
+		ret = pos;
+		pos++;
+	}
+
+	if (!ret)
+		return;
+
+	ret += 7;
+	end = ret;
+	while (*end == '_' || isalnum((unsigned char)*end))
+		end++;
+
+	dstr_ncopy(name, ret, end - ret);
+}
+
+/* effect shaders are named "<path> (<type> shader, technique <name>, ...)" */
+static void get_effect_location(struct dstr *effect, struct dstr *technique,
+				const char *file)
+{
+	const char *paren;
+	const char *start;
+	const char *tech;
+
+	if (!file)
+		return;
+
+	paren = strstr(file, " (");
+	dstr_ncopy(effect, file, paren ? (size_t)(paren - file) : strlen(file));
+
+	start = strrchr(effect->array ? effect->array : "", '/');
+	if (!start)
+		start = strrchr(effect->array ? effect->array : "", '\\');
+	if (start)
+		dstr_remove(effect, 0, start + 1 - effect->array);
+
+	tech = paren ? strstr(paren, "technique ") : NULL;
+	if (tech) {
+		const char *tech_end;
+
+		tech += 10;
+		tech_end = strchr(tech, ',');
+		dstr_ncopy(technique, tech,
+			   tech_end ? (size_t)(tech_end - tech) : strlen(tech));
+	}
+}
+
+void sw_shader_resolve(gs_shader_t *shader, const char *shader_str,
+		       const char *file)
+{
+	struct dstr name = {0};
+	struct dstr effect = {0};
+	struct dstr technique = {0};
+	const struct sw_func *func = NULL;
+
+	for (int i = 0; i < SW_CONST_COUNT; i++)
+		shader->consts[i] =
+			gs_shader_get_param_by_name(shader, const_names[i]);
+	for (int i = 0; i < SW_MAX_IMAGES; i++)
+		shader->images[i] =
+			gs_shader_get_param_by_name(shader, image_names[i]);
+
+	get_entry_func(&name, shader_str);
+	get_effect_location(&effect, &technique, file);
+
+	if (name.len)
+		func = find_func(shader->type, effect.array, name.array);
+
+	shader->undistort = technique.array &&
+			    strstr(technique.array, "Undistort") != NULL;
+	shader->func_name = bstrdup(name.len ? name.array : "main");
+
+	if (func) {
+		shader->vertex = func->vertex;
+		shader->pixel = func->pixel;
+		shader->span = func->span;
+	} else {
+		blog(LOG_WARNING,
+		     "sw_shader_resolve: no software implementation of "
+		     "'%s' in %s, falling back to a plain %s",
+		     shader->func_name, file ? file : "(unknown)",
+		     shader->type == GS_SHADER_VERTEX ? "transform"
+						      : "texture sample");
+
+		if (shader->type == GS_SHADER_VERTEX) {
+			shader->vertex = vs_default;
+		} else if (shader->images[0]) {
+			shader->pixel = ps_draw_bare;
+			shader->span = span_draw_bare;
+		} else {
+			shader->pixel = ps_solid;
+		}
+	}
+
+	dstr_free(&name);
+	dstr_free(&effect);
+	dstr_free(&technique);
+}
+
+void sw_draw_load_shader_params(struct sw_draw *draw, gs_shader_t *vs,
+				gs_shader_t *ps)
+{
+	gs_device_t *device = draw->device;
+
+	for (int i = 0; i < SW_CONST_COUNT; i++) {
+		struct gs_shader_param *param = ps->consts[i] ? ps->consts[i]
+							      : vs->consts[i];
+		size_t size = param ? param->cur_value.num : 0;
+
+		if (size > sizeof(struct vec4))
+			size = sizeof(struct vec4);
+
+		vec4_zero(&draw->consts[i]);
+		if (size)
+			memcpy(draw->consts[i].ptr, param->cur_value.array,
+			       size);
+	}
+
+	/* solid.effect's color defaults to white when never set */
+	if (!ps->consts[SW_CONST_COLOR] && !vs->consts[SW_CONST_COLOR])
+		vec4_set(&draw->consts[SW_CONST_COLOR], 1.0f, 1.0f, 1.0f,
+			 1.0f);
+
+	for (int i = 0; i < SW_MAX_IMAGES; i++) {
+		struct gs_shader_param *param = ps->images[i];
+		struct sw_image *image = &draw->images[i];
+
+		if (param) {
+			image->tex = param->texture;
+			image->srgb = param->srgb;
+			image->sampler = param->next_sampler;
+			param->next_sampler = NULL;
+
+			if (!image->sampler && ps->samplers.num)
+				image->sampler = ps->samplers.array[0];
+		} else {
+			image->tex = device->cur_textures[i];
+			image->srgb = false;
+			image->sampler = device->cur_samplers[i];
+		}
+
+		if (!image->sampler)
+			image->sampler = device->default_sampler;
+	}
+
+	draw->vertex = vs->vertex;
+	draw->pixel = ps->pixel;
+	draw->span = ps->span;
+	draw->undistort = ps->undistort;
+}
+
+/* ------------------------------------------------------------------------- */
+
+static inline void shader_param_free(struct gs_shader_param *param)
+{
+	bfree(param->name);
+	da_free(param->cur_value);
+	da_free(param->def_value);
+}
+
+static void sw_add_param(struct gs_shader *shader, struct shader_var *var)
+{
+	struct gs_shader_param param = {0};
+
+	param.array_count = var->array_count;
+	param.name = bstrdup(var->name);
+	param.shader = shader;
+	param.type = get_shader_param_type(var->type);
+
+	da_move(param.def_value, var->default_val);
+	da_copy(param.cur_value, param.def_value);
+
+	da_push_back(shader->params, &param);
+}
+
+static void sw_add_params(struct gs_shader *shader,
+			  struct shader_parser *parser)
+{
+	for (size_t i = 0; i < parser->params.num; i++)
+		sw_add_param(shader, parser->params.array + i);
+
+	shader->viewproj = gs_shader_get_param_by_name(shader, "ViewProj");
+	shader->world = gs_shader_get_param_by_name(shader, "World");
+}
+
+static void sw_add_samplers(struct gs_shader *shader,
+			    struct shader_parser *parser)
+{
+	for (size_t i = 0; i < parser->samplers.num; i++) {
+		struct shader_sampler *sampler = parser->samplers.array + i;
+		gs_samplerstate_t *new_sampler;
+		struct gs_sampler_info info;
+
+		shader_sampler_convert(sampler, &info);
+		new_sampler = device_samplerstate_create(shader->device, &info);
+
+		da_push_back(shader->samplers, &new_sampler);
+	}
+}
+
+static struct gs_shader *shader_create(gs_device_t *device,
+				       enum gs_shader_type type,
+				       const char *shader_str, const char *file,
+				       char **error_string)
+{
+	struct gs_shader *shader = bzalloc(sizeof(struct gs_shader));
+	struct shader_parser parser;
+	bool success;
+
+	shader->device = device;
+	shader->type = type;
+
+	shader_parser_init(&parser);
+	success = shader_parse(&parser, shader_str, file);
+
+	if (success) {
+		sw_add_params(shader, &parser);
+		sw_add_samplers(shader, &parser);
+		sw_shader_resolve(shader, shader_str, file);
+	} else {
+		char *errors = shader_parser_geterrors(&parser);
+		if (errors) {
+			blog(LOG_DEBUG, "Shader errors for %s:\n%s", file,
+			     errors);
+			if (error_string)
+				*error_string = errors;
+			else
+				bfree(errors);
+		}
+
+		gs_shader_destroy(shader);
+		shader = NULL;
+	}
+
+	shader_parser_free(&parser);
+	return shader;
+}
+
+gs_shader_t *device_vertexshader_create(gs_device_t *device, const char *shader,
+					const char *file, char **error_string)
+{
+	struct gs_shader *ptr;
+	ptr = shader_create(device, GS_SHADER_VERTEX, shader, file,
+			    error_string);
+	if (!ptr)
+		blog(LOG_ERROR, "device_vertexshader_create (software) failed");
+	return ptr;
+}
+
+gs_shader_t *device_pixelshader_create(gs_device_t *device, const char *shader,
+				       const char *file, char **error_string)
+{
+	struct gs_shader *ptr;
+	ptr = shader_create(device, GS_SHADER_PIXEL, shader, file,
+			    error_string);
+	if (!ptr)
+		blog(LOG_ERROR, "device_pixelshader_create (software) failed");
+	return ptr;
+}
+
+void gs_shader_destroy(gs_shader_t *shader)
+{
+	if (!shader)
+		return;
+
+	if (shader->device->cur_vertex_shader == shader)
+		shader->device->cur_vertex_shader = NULL;
+	if (shader->device->cur_pixel_shader == shader)
+		shader->device->cur_pixel_shader = NULL;
+
+	for (size_t i = 0; i < shader->samplers.num; i++)
+		gs_samplerstate_destroy(shader->samplers.array[i]);
+
+	for (size_t i = 0; i < shader->params.num; i++)
+		shader_param_free(shader->params.array + i);
+
+	da_free(shader->samplers);
+	da_free(shader->params);
+	bfree(shader->func_name);
+	bfree(shader);
+}
+
+int gs_shader_get_num_params(const gs_shader_t *shader)
+{
+	return (int)shader->params.num;
+}
+
+gs_sparam_t *gs_shader_get_param_by_idx(gs_shader_t *shader, uint32_t param)
+{
+	assert(param < shader->params.num);
+	return shader->params.array + param;
+}
+
+gs_sparam_t *gs_shader_get_param_by_name(gs_shader_t *shader, const char *name)
+{
+	for (size_t i = 0; i < shader->params.num; i++) {
+		struct gs_shader_param *param = shader->params.array + i;
+
+		if (strcmp(param->name, name) == 0)
+			return param;
+	}
+
+	return NULL;
+}
+
+gs_sparam_t *gs_shader_get_viewproj_matrix(const gs_shader_t *shader)
+{
+	return shader->viewproj;
+}
+
+gs_sparam_t *gs_shader_get_world_matrix(const gs_shader_t *shader)
+{
+	return shader->world;
+}
+
+void gs_shader_get_param_info(const gs_sparam_t *param,
+			      struct gs_shader_param_info *info)
+{
+	info->type = param->type;
+	info->name = param->name;
+}
+
+void gs_shader_set_bool(gs_sparam_t *param, bool val)
+{
+	int int_val = val;
+	da_copy_array(param->cur_value, &int_val, sizeof(int_val));
+}
+
+void gs_shader_set_float(gs_sparam_t *param, float val)
+{
+	da_copy_array(param->cur_value, &val, sizeof(val));
+}
+
+void gs_shader_set_int(gs_sparam_t *param, int val)
+{
+	da_copy_array(param->cur_value, &val, sizeof(val));
+}
+
+void gs_shader_set_matrix3(gs_sparam_t *param, const struct matrix3 *val)
+{
+	struct matrix4 mat;
+	matrix4_from_matrix3(&mat, val);
+
+	da_copy_array(param->cur_value, &mat, sizeof(mat));
+}
+
+void gs_shader_set_matrix4(gs_sparam_t *param, const struct matrix4 *val)
+{
+	da_copy_array(param->cur_value, val, sizeof(*val));
+}
+
+void gs_shader_set_vec2(gs_sparam_t *param, const struct vec2 *val)
+{
+	da_copy_array(param->cur_value, val->ptr, sizeof(*val));
+}
+
+void gs_shader_set_vec3(gs_sparam_t *param, const struct vec3 *val)
+{
+	da_copy_array(param->cur_value, val->ptr, sizeof(float) * 3);
+}
+
+void gs_shader_set_vec4(gs_sparam_t *param, const struct vec4 *val)
+{
+	da_copy_array(param->cur_value, val->ptr, sizeof(*val));
+}
+
+void gs_shader_set_texture(gs_sparam_t *param, gs_texture_t *val)
+{
+	param->texture = val;
+}
+
+void gs_shader_set_val(gs_sparam_t *param, const void *val, size_t size)
+{
+	int count = param->array_count;
+	size_t expected_size = 0;
+	if (!count)
+		count = 1;
+
+	switch ((uint32_t)param->type) {
+	case GS_SHADER_PARAM_FLOAT:
+		expected_size = sizeof(float);
+		break;
+	case GS_SHADER_PARAM_BOOL:
+	case GS_SHADER_PARAM_INT:
+		expected_size = sizeof(int);
+		break;
+	case GS_SHADER_PARAM_INT2:
+		expected_size = sizeof(int) * 2;
+		break;
+	case GS_SHADER_PARAM_INT3:
+		expected_size = sizeof(int) * 3;
+		break;
+	case GS_SHADER_PARAM_INT4:
+		expected_size = sizeof(int) * 4;
+		break;
+	case GS_SHADER_PARAM_VEC2:
+		expected_size = sizeof(float) * 2;
+		break;
+	case GS_SHADER_PARAM_VEC3:
+		expected_size = sizeof(float) * 3;
+		break;
+	case GS_SHADER_PARAM_VEC4:
+		expected_size = sizeof(float) * 4;
+		break;
+	case GS_SHADER_PARAM_MATRIX4X4:
+		expected_size = sizeof(float) * 4 * 4;
+		break;
+	case GS_SHADER_PARAM_TEXTURE:
+		expected_size = sizeof(struct gs_shader_texture);
+		break;
+	default:
+		expected_size = 0;
+	}
+
+	expected_size *= count;
+	if (!expected_size)
+		return;
+
+	if (expected_size != size) {
+		blog(LOG_ERROR, "gs_shader_set_val (software): Size of shader "
+				"param does not match the size of the input");
+		return;
+	}
+
+	if (param->type == GS_SHADER_PARAM_TEXTURE) {
+		struct gs_shader_texture shader_tex;
+		memcpy(&shader_tex, val, sizeof(shader_tex));
+		gs_shader_set_texture(param, shader_tex.tex);
+		param->srgb = shader_tex.srgb;
+	} else {
+		da_copy_array(param->cur_value, val, size);
+	}
+}
+
+void gs_shader_set_default(gs_sparam_t *param)
+{
+	gs_shader_set_val(param, param->def_value.array, param->def_value.num);
+}
+
+void gs_shader_set_next_sampler(gs_sparam_t *param, gs_samplerstate_t *sampler)
+{
+	param->next_sampler = sampler;
+}
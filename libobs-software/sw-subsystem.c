@@ -0,0 +1,835 @@
+/******************************************************************************
+    Copyright (C) 2021 by Hugh Bailey <obs.jim@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include <graphics/effect.h>
+#include "sw-subsystem.h"
+
+const char *device_get_name(void)
+{
+	return "Software";
+}
+
+int device_get_type(void)
+{
+	return GS_DEVICE_SOFTWARE;
+}
+
+const char *device_preprocessor_name(void)
+{
+	return "_SOFTWARE";
+}
+
+bool device_enum_adapters(bool (*callback)(void *param, const char *name,
+					   uint32_t id),
+			  void *param)
+{
+	callback(param, "Software", 0);
+	return true;
+}
+
+int device_create(gs_device_t **p_device, uint32_t adapter)
+{
+	struct gs_device *device = bzalloc(sizeof(struct gs_device));
+	struct gs_sampler_info info = {0};
+
+	UNUSED_PARAMETER(adapter);
+
+	blog(LOG_INFO, "---------------------------------");
+	blog(LOG_INFO, "Initializing software renderer...");
+
+	sw_init_tables();
+
+	info.filter = GS_FILTER_LINEAR;
+	info.address_u = GS_ADDRESS_CLAMP;
+	info.address_v = GS_ADDRESS_CLAMP;
+	info.address_w = GS_ADDRESS_CLAMP;
+	info.max_anisotropy = 1;
+	device->default_sampler = device_samplerstate_create(device, &info);
+
+	device->cur_cull_mode = GS_BACK;
+	device->blend_enabled = true;
+	device->blend_src_c = GS_BLEND_SRCALPHA;
+	device->blend_dest_c = GS_BLEND_INVSRCALPHA;
+	device->blend_src_a = GS_BLEND_ONE;
+	device->blend_dest_a = GS_BLEND_INVSRCALPHA;
+	for (int i = 0; i < 4; i++)
+		device->write_mask[i] = true;
+
+	*p_device = device;
+	blog(LOG_INFO, "Software renderer loaded successfully");
+	return GS_SUCCESS;
+}
+
+void device_destroy(gs_device_t *device)
+{
+	if (!device)
+		return;
+
+	gs_samplerstate_destroy(device->default_sampler);
+	da_free(device->proj_stack);
+	da_free(device->transformed);
+	bfree(device);
+}
+
+void device_enter_context(gs_device_t *device)
+{
+	/* does nothing */
+	UNUSED_PARAMETER(device);
+}
+
+void device_leave_context(gs_device_t *device)
+{
+	/* does nothing */
+	UNUSED_PARAMETER(device);
+}
+
+void *device_get_device_obj(gs_device_t *device)
+{
+	UNUSED_PARAMETER(device);
+	return NULL;
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* there's nothing to present to, so a swap chain is just a render target
+ * that's drawn to when no other target is set */
+gs_swapchain_t *device_swapchain_create(gs_device_t *device,
+					const struct gs_init_data *info)
+{
+	struct gs_swap_chain *swap = bzalloc(sizeof(struct gs_swap_chain));
+
+	swap->device = device;
+	swap->info = *info;
+	swap->target = device_texture_create(device, info->cx, info->cy,
+					     GS_BGRA, 1, NULL,
+					     GS_RENDER_TARGET);
+	if (!swap->target) {
+		blog(LOG_ERROR, "device_swapchain_create (software) failed");
+		bfree(swap);
+		return NULL;
+	}
+
+	return swap;
+}
+
+void gs_swapchain_destroy(gs_swapchain_t *swapchain)
+{
+	if (!swapchain)
+		return;
+
+	if (swapchain->device->cur_swap == swapchain)
+		device_load_swapchain(swapchain->device, NULL);
+
+	gs_texture_destroy(swapchain->target);
+	bfree(swapchain);
+}
+
+void device_resize(gs_device_t *device, uint32_t cx, uint32_t cy)
+{
+	struct gs_swap_chain *swap = device->cur_swap;
+	gs_texture_t *target;
+
+	if (!swap) {
+		blog(LOG_WARNING, "device_resize (software): No active swap");
+		return;
+	}
+
+	target = device_texture_create(device, cx, cy, GS_BGRA, 1, NULL,
+				       GS_RENDER_TARGET);
+	if (!target)
+		return;
+
+	gs_texture_destroy(swap->target);
+	swap->target = target;
+	swap->info.cx = cx;
+	swap->info.cy = cy;
+}
+
+void device_get_size(const gs_device_t *device, uint32_t *cx, uint32_t *cy)
+{
+	if (device->cur_swap) {
+		*cx = device->cur_swap->info.cx;
+		*cy = device->cur_swap->info.cy;
+	} else {
+		blog(LOG_ERROR, "device_get_size (software): No active swap");
+		*cx = 0;
+		*cy = 0;
+	}
+}
+
+uint32_t device_get_width(const gs_device_t *device)
+{
+	if (device->cur_swap) {
+		return device->cur_swap->info.cx;
+	} else {
+		blog(LOG_ERROR, "device_get_width (software): No active swap");
+		return 0;
+	}
+}
+
+uint32_t device_get_height(const gs_device_t *device)
+{
+	if (device->cur_swap) {
+		return device->cur_swap->info.cy;
+	} else {
+		blog(LOG_ERROR, "device_get_height (software): No active "
+				"swap");
+		return 0;
+	}
+}
+
+void device_load_swapchain(gs_device_t *device, gs_swapchain_t *swapchain)
+{
+	device->cur_swap = swapchain;
+}
+
+/* ------------------------------------------------------------------------- */
+
+void device_load_vertexbuffer(gs_device_t *device, gs_vertbuffer_t *vb)
+{
+	device->cur_vertex_buffer = vb;
+}
+
+void device_load_indexbuffer(gs_device_t *device, gs_indexbuffer_t *ib)
+{
+	device->cur_index_buffer = ib;
+}
+
+void device_load_texture(gs_device_t *device, gs_texture_t *tex, int unit)
+{
+	device->cur_textures[unit] = tex;
+}
+
+void device_load_texture_srgb(gs_device_t *device, gs_texture_t *tex, int unit)
+{
+	device_load_texture(device, tex, unit);
+}
+
+void device_load_samplerstate(gs_device_t *device, gs_samplerstate_t *ss,
+			      int unit)
+{
+	device->cur_samplers[unit] = ss;
+}
+
+void device_load_default_samplerstate(gs_device_t *device, bool b_3d, int unit)
+{
+	UNUSED_PARAMETER(b_3d);
+	device->cur_samplers[unit] = NULL;
+}
+
+void device_load_vertexshader(gs_device_t *device, gs_shader_t *vertshader)
+{
+	if (vertshader && vertshader->type != GS_SHADER_VERTEX) {
+		blog(LOG_ERROR, "device_load_vertexshader (software): "
+				"Specified shader is not a vertex shader");
+		return;
+	}
+
+	device->cur_vertex_shader = vertshader;
+}
+
+void device_load_pixelshader(gs_device_t *device, gs_shader_t *pixelshader)
+{
+	if (pixelshader && pixelshader->type != GS_SHADER_PIXEL) {
+		blog(LOG_ERROR, "device_load_pixelshader (software): "
+				"Specified shader is not a pixel shader");
+		return;
+	}
+
+	device->cur_pixel_shader = pixelshader;
+}
+
+gs_shader_t *device_get_vertex_shader(const gs_device_t *device)
+{
+	return device->cur_vertex_shader;
+}
+
+gs_shader_t *device_get_pixel_shader(const gs_device_t *device)
+{
+	return device->cur_pixel_shader;
+}
+
+gs_texture_t *device_get_render_target(const gs_device_t *device)
+{
+	return device->cur_render_target;
+}
+
+gs_zstencil_t *device_get_zstencil_target(const gs_device_t *device)
+{
+	return device->cur_zstencil_buffer;
+}
+
+void device_set_render_target(gs_device_t *device, gs_texture_t *tex,
+			      gs_zstencil_t *zstencil)
+{
+	if (tex && tex->type != GS_TEXTURE_2D) {
+		blog(LOG_ERROR, "device_set_render_target (software): "
+				"texture is not a 2D texture");
+		return;
+	}
+
+	device->cur_render_target = tex;
+	device->cur_render_side = 0;
+	device->cur_zstencil_buffer = zstencil;
+}
+
+void device_set_cube_render_target(gs_device_t *device, gs_texture_t *cubetex,
+				   int side, gs_zstencil_t *zstencil)
+{
+	if (cubetex && cubetex->type != GS_TEXTURE_CUBE) {
+		blog(LOG_ERROR, "device_set_cube_render_target (software): "
+				"texture is not a cube texture");
+		return;
+	}
+
+	device->cur_render_target = cubetex;
+	device->cur_render_side = side;
+	device->cur_zstencil_buffer = zstencil;
+}
+
+void device_enable_framebuffer_srgb(gs_device_t *device, bool enable)
+{
+	device->framebuffer_srgb = enable;
+}
+
+bool device_framebuffer_srgb_enabled(gs_device_t *device)
+{
+	return device->framebuffer_srgb;
+}
+
+/* ------------------------------------------------------------------------- */
+
+void device_copy_texture_region(gs_device_t *device, gs_texture_t *dst,
+				uint32_t dst_x, uint32_t dst_y,
+				gs_texture_t *src, uint32_t src_x,
+				uint32_t src_y, uint32_t src_w, uint32_t src_h)
+{
+	uint32_t width, height;
+	size_t row_size;
+
+	UNUSED_PARAMETER(device);
+
+	if (!src || !dst) {
+		blog(LOG_ERROR, "device_copy_texture_region (software): "
+				"Source or destination texture is NULL");
+		return;
+	}
+	if (src->type != GS_TEXTURE_2D || dst->type != GS_TEXTURE_2D) {
+		blog(LOG_ERROR, "device_copy_texture_region (software): "
+				"Source and destination textures must be 2D "
+				"textures");
+		return;
+	}
+	if (src->format != dst->format) {
+		blog(LOG_ERROR, "device_copy_texture_region (software): "
+				"Source and destination formats do not match");
+		return;
+	}
+
+	width = src_w ? src_w : (src->width - src_x);
+	height = src_h ? src_h : (src->height - src_y);
+
+	if (src_x + width > src->width || src_y + height > src->height ||
+	    dst_x + width > dst->width || dst_y + height > dst->height) {
+		blog(LOG_ERROR, "device_copy_texture_region (software): "
+				"Region is out of bounds");
+		return;
+	}
+
+	row_size = (size_t)width * src->pixel_size;
+
+	for (uint32_t y = 0; y < height; y++) {
+		const uint8_t *in = src->data +
+				    (size_t)(src_y + y) * src->linesize +
+				    (size_t)src_x * src->pixel_size;
+		uint8_t *out = dst->data + (size_t)(dst_y + y) * dst->linesize +
+			       (size_t)dst_x * dst->pixel_size;
+
+		memmove(out, in, row_size);
+	}
+}
+
+void device_copy_texture(gs_device_t *device, gs_texture_t *dst,
+			 gs_texture_t *src)
+{
+	device_copy_texture_region(device, dst, 0, 0, src, 0, 0, 0, 0);
+}
+
+void device_stage_texture(gs_device_t *device, gs_stagesurf_t *dst,
+			  gs_texture_t *src)
+{
+	UNUSED_PARAMETER(device);
+
+	if (!src || !dst) {
+		blog(LOG_ERROR, "device_stage_texture (software): Source or "
+				"destination is NULL");
+		return;
+	}
+	if (src->type != GS_TEXTURE_2D) {
+		blog(LOG_ERROR, "device_stage_texture (software): Source "
+				"texture must be a 2D texture");
+		return;
+	}
+	if (src->format != dst->format || src->width != dst->width ||
+	    src->height != dst->height) {
+		blog(LOG_ERROR, "device_stage_texture (software): Source and "
+				"destination do not match");
+		return;
+	}
+
+	if (src->linesize == dst->linesize) {
+		memcpy(dst->data, src->data, src->slice_size);
+		return;
+	}
+
+	for (uint32_t y = 0; y < src->height; y++)
+		memcpy(dst->data + (size_t)y * dst->linesize,
+		       src->data + (size_t)y * src->linesize, src->linesize);
+}
+
+/* ------------------------------------------------------------------------- */
+
+void device_begin_frame(gs_device_t *device)
+{
+	/* does nothing */
+	UNUSED_PARAMETER(device);
+}
+
+void device_begin_scene(gs_device_t *device)
+{
+	/* does nothing */
+	UNUSED_PARAMETER(device);
+}
+
+void device_end_scene(gs_device_t *device)
+{
+	/* does nothing */
+	UNUSED_PARAMETER(device);
+}
+
+static inline gs_texture_t *get_target(gs_device_t *device)
+{
+	if (device->cur_render_target)
+		return device->cur_render_target;
+	return device->cur_swap ? device->cur_swap->target : NULL;
+}
+
+static void get_viewproj(gs_device_t *device, struct matrix4 *viewproj)
+{
+	struct matrix4 view;
+
+	gs_matrix_get(&view);
+
+	/* negate Z col of the view matrix for right-handed coordinate system */
+	view.x.z = -view.x.z;
+	view.y.z = -view.y.z;
+	view.z.z = -view.z.z;
+	view.t.z = -view.t.z;
+
+	matrix4_mul(viewproj, &view, &device->cur_proj);
+}
+
+static void setup_draw(gs_device_t *device, gs_texture_t *target,
+		       struct sw_draw *draw)
+{
+	const struct gs_rect *vp = &device->cur_viewport;
+	int x0 = vp->x, y0 = vp->y;
+	int x1 = vp->x + vp->cx, y1 = vp->y + vp->cy;
+
+	if (device->scissor_enabled) {
+		const struct gs_rect *sc = &device->cur_scissor;
+
+		if (x0 < sc->x)
+			x0 = sc->x;
+		if (y0 < sc->y)
+			y0 = sc->y;
+		if (x1 > sc->x + sc->cx)
+			x1 = sc->x + sc->cx;
+		if (y1 > sc->y + sc->cy)
+			y1 = sc->y + sc->cy;
+	}
+
+	if (x0 < 0)
+		x0 = 0;
+	if (y0 < 0)
+		y0 = 0;
+	if (x1 > (int)target->width)
+		x1 = (int)target->width;
+	if (y1 > (int)target->height)
+		y1 = (int)target->height;
+
+	draw->device = device;
+	draw->target = target;
+	draw->target_slice = device->cur_render_side;
+	draw->srgb_write = device->framebuffer_srgb;
+	draw->clip_x0 = x0;
+	draw->clip_y0 = y0;
+	draw->clip_x1 = x1;
+	draw->clip_y1 = y1;
+	draw->viewport = *vp;
+
+	draw->blend = device->blend_enabled;
+	draw->src_c = device->blend_src_c;
+	draw->dest_c = device->blend_dest_c;
+	draw->src_a = device->blend_src_a;
+	draw->dest_a = device->blend_dest_a;
+	for (int i = 0; i < 4; i++)
+		draw->write_mask[i] = device->write_mask[i];
+
+	get_viewproj(device, &draw->viewproj);
+}
+
+static inline uint32_t get_index(const struct gs_index_buffer *ib, size_t i)
+{
+	if (ib->type == GS_UNSIGNED_SHORT)
+		return ((const uint16_t *)ib->data)[i];
+	return ((const uint32_t *)ib->data)[i];
+}
+
+static void fetch_vertex(const struct gs_vertex_buffer *vb, uint32_t idx,
+			 struct sw_vertex_in *in)
+{
+	const struct gs_vb_data *data = vb ? vb->data : NULL;
+
+	in->id = idx;
+	vec4_zero(&in->pos);
+	vec4_zero(&in->uv);
+	vec4_set(&in->color, 1.0f, 1.0f, 1.0f, 1.0f);
+
+	if (!data || idx >= data->num)
+		return;
+
+	if (data->points)
+		vec4_from_vec3(&in->pos, &data->points[idx]);
+	if (data->colors)
+		vec4_from_rgba(&in->color, data->colors[idx]);
+
+	if (data->num_tex && data->tvarray[0].array) {
+		const struct gs_tvertarray *tv = &data->tvarray[0];
+		const float *uv = (const float *)tv->array + idx * tv->width;
+
+		for (size_t i = 0; i < tv->width && i < 4; i++)
+			in->uv.ptr[i] = uv[i];
+	}
+}
+
+void device_draw(gs_device_t *device, enum gs_draw_mode draw_mode,
+		 uint32_t start_vert, uint32_t num_verts)
+{
+	struct gs_vertex_buffer *vb = device->cur_vertex_buffer;
+	struct gs_index_buffer *ib = device->cur_index_buffer;
+	gs_shader_t *vs = device->cur_vertex_shader;
+	gs_shader_t *ps = device->cur_pixel_shader;
+	gs_effect_t *effect = gs_get_effect();
+	gs_texture_t *target = get_target(device);
+	struct sw_draw draw = {0};
+
+	if (!vs || !ps) {
+		blog(LOG_ERROR, "device_draw (software): No shader loaded");
+		goto fail;
+	}
+	if (!target) {
+		blog(LOG_ERROR, "device_draw (software): No render target or "
+				"swap chain to render to");
+		goto fail;
+	}
+
+	if (effect)
+		gs_effect_update_params(effect);
+
+	if (num_verts == 0) {
+		if (ib)
+			num_verts = (uint32_t)ib->num;
+		else if (vb)
+			num_verts = (uint32_t)vb->num;
+	}
+	if (ib && start_vert + num_verts > ib->num) {
+		blog(LOG_ERROR, "device_draw (software): Index range is out "
+				"of bounds");
+		goto fail;
+	}
+
+	setup_draw(device, target, &draw);
+	sw_draw_load_shader_params(&draw, vs, ps);
+
+	da_resize(device->transformed, num_verts);
+
+	for (uint32_t i = 0; i < num_verts; i++) {
+		struct sw_vertex_in in;
+		uint32_t idx = ib ? get_index(ib, start_vert + i)
+				  : start_vert + i;
+
+		fetch_vertex(vb, idx, &in);
+		draw.vertex(&draw, &in, &device->transformed.array[i]);
+	}
+
+	sw_rasterize(&draw, draw_mode, device->transformed.array, num_verts,
+		     device->cur_cull_mode);
+	return;
+
+fail:
+	blog(LOG_ERROR, "device_draw (software) failed");
+}
+
+void device_clear(gs_device_t *device, uint32_t clear_flags,
+		  const struct vec4 *color, float depth, uint8_t stencil)
+{
+	gs_texture_t *target = get_target(device);
+	uint8_t *slice;
+
+	/* there's no depth or stencil buffer to clear */
+	UNUSED_PARAMETER(depth);
+	UNUSED_PARAMETER(stencil);
+
+	if (!(clear_flags & GS_CLEAR_COLOR) || !target)
+		return;
+
+	slice = target->data +
+		target->slice_size * (size_t)device->cur_render_side;
+
+	for (uint32_t x = 0; x < target->width; x++)
+		sw_texel_store(target, device->cur_render_side, (int)x, 0,
+			       color, device->framebuffer_srgb);
+	for (uint32_t y = 1; y < target->height; y++)
+		memcpy(slice + (size_t)y * target->linesize, slice,
+		       target->linesize);
+}
+
+void device_present(gs_device_t *device)
+{
+	/* does nothing */
+	UNUSED_PARAMETER(device);
+}
+
+void device_flush(gs_device_t *device)
+{
+	/* does nothing */
+	UNUSED_PARAMETER(device);
+}
+
+/* ------------------------------------------------------------------------- */
+
+void device_set_cull_mode(gs_device_t *device, enum gs_cull_mode mode)
+{
+	device->cur_cull_mode = mode;
+}
+
+enum gs_cull_mode device_get_cull_mode(const gs_device_t *device)
+{
+	return device->cur_cull_mode;
+}
+
+void device_enable_blending(gs_device_t *device, bool enable)
+{
+	device->blend_enabled = enable;
+}
+
+void device_enable_depth_test(gs_device_t *device, bool enable)
+{
+	/* no depth buffer */
+	UNUSED_PARAMETER(device);
+	UNUSED_PARAMETER(enable);
+}
+
+void device_enable_stencil_test(gs_device_t *device, bool enable)
+{
+	/* no stencil buffer */
+	UNUSED_PARAMETER(device);
+	UNUSED_PARAMETER(enable);
+}
+
+void device_enable_stencil_write(gs_device_t *device, bool enable)
+{
+	/* no stencil buffer */
+	UNUSED_PARAMETER(device);
+	UNUSED_PARAMETER(enable);
+}
+
+void device_enable_color(gs_device_t *device, bool red, bool green, bool blue,
+			 bool alpha)
+{
+	device->write_mask[0] = red;
+	device->write_mask[1] = green;
+	device->write_mask[2] = blue;
+	device->write_mask[3] = alpha;
+}
+
+void device_blend_function(gs_device_t *device, enum gs_blend_type src,
+			   enum gs_blend_type dest)
+{
+	device_blend_function_separate(device, src, dest, src, dest);
+}
+
+void device_blend_function_separate(gs_device_t *device,
+				    enum gs_blend_type src_c,
+				    enum gs_blend_type dest_c,
+				    enum gs_blend_type src_a,
+				    enum gs_blend_type dest_a)
+{
+	device->blend_src_c = src_c;
+	device->blend_dest_c = dest_c;
+	device->blend_src_a = src_a;
+	device->blend_dest_a = dest_a;
+}
+
+void device_depth_function(gs_device_t *device, enum gs_depth_test test)
+{
+	UNUSED_PARAMETER(device);
+	UNUSED_PARAMETER(test);
+}
+
+void device_stencil_function(gs_device_t *device, enum gs_stencil_side side,
+			     enum gs_depth_test test)
+{
+	UNUSED_PARAMETER(device);
+	UNUSED_PARAMETER(side);
+	UNUSED_PARAMETER(test);
+}
+
+void device_stencil_op(gs_device_t *device, enum gs_stencil_side side,
+		       enum gs_stencil_op_type fail,
+		       enum gs_stencil_op_type zfail,
+		       enum gs_stencil_op_type zpass)
+{
+	UNUSED_PARAMETER(device);
+	UNUSED_PARAMETER(side);
+	UNUSED_PARAMETER(fail);
+	UNUSED_PARAMETER(zfail);
+	UNUSED_PARAMETER(zpass);
+}
+
+void device_set_viewport(gs_device_t *device, int x, int y, int width,
+			 int height)
+{
+	device->cur_viewport.x = x;
+	device->cur_viewport.y = y;
+	device->cur_viewport.cx = width;
+	device->cur_viewport.cy = height;
+}
+
+void device_get_viewport(const gs_device_t *device, struct gs_rect *rect)
+{
+	*rect = device->cur_viewport;
+}
+
+void device_set_scissor_rect(gs_device_t *device, const struct gs_rect *rect)
+{
+	device->scissor_enabled = rect != NULL;
+	if (rect)
+		device->cur_scissor = *rect;
+}
+
+void device_ortho(gs_device_t *device, float left, float right, float top,
+		  float bottom, float near, float far)
+{
+	struct matrix4 *dst = &device->cur_proj;
+
+	float rml = right - left;
+	float bmt = bottom - top;
+	float fmn = far - near;
+
+	vec4_zero(&dst->x);
+	vec4_zero(&dst->y);
+	vec4_zero(&dst->z);
+	vec4_zero(&dst->t);
+
+	dst->x.x = 2.0f / rml;
+	dst->t.x = (left + right) / -rml;
+
+	dst->y.y = 2.0f / -bmt;
+	dst->t.y = (bottom + top) / bmt;
+
+	dst->z.z = 1.0f / fmn;
+	dst->t.z = near / -fmn;
+
+	dst->t.w = 1.0f;
+}
+
+void device_frustum(gs_device_t *device, float left, float right, float top,
+		    float bottom, float near, float far)
+{
+	struct matrix4 *dst = &device->cur_proj;
+
+	float rml = right - left;
+	float bmt = bottom - top;
+	float fmn = far - near;
+	float nearx2 = 2.0f * near;
+
+	vec4_zero(&dst->x);
+	vec4_zero(&dst->y);
+	vec4_zero(&dst->z);
+	vec4_zero(&dst->t);
+
+	dst->x.x = nearx2 / rml;
+	dst->z.x = (left + right) / -rml;
+
+	dst->y.y = nearx2 / -bmt;
+	dst->z.y = (bottom + top) / bmt;
+
+	dst->z.z = far / fmn;
+	dst->t.z = (near * far) / -fmn;
+
+	dst->z.w = 1.0f;
+}
+
+void device_projection_push(gs_device_t *device)
+{
+	da_push_back(device->proj_stack, &device->cur_proj);
+}
+
+void device_projection_pop(gs_device_t *device)
+{
+	struct matrix4 *end;
+	if (!device->proj_stack.num)
+		return;
+
+	end = da_end(device->proj_stack);
+	device->cur_proj = *end;
+	da_pop_back(device->proj_stack);
+}
+
+void device_debug_marker_begin(gs_device_t *device, const char *markername,
+			       const float color[4])
+{
+	UNUSED_PARAMETER(device);
+	UNUSED_PARAMETER(markername);
+	UNUSED_PARAMETER(color);
+}
+
+void device_debug_marker_end(gs_device_t *device)
+{
+	UNUSED_PARAMETER(device);
+}
+
+/* ------------------------------------------------------------------------- */
+
+#ifdef _WIN32
+bool device_gdi_texture_available(void)
+{
+	return false;
+}
+
+bool device_shared_texture_available(void)
+{
+	return false;
+}
+#elif defined(__APPLE__)
+bool device_shared_texture_available(void)
+{
+	return false;
+}
+#endif
@@ -0,0 +1,327 @@
+/******************************************************************************
+    Copyright (C) 2021 by Hugh Bailey <obs.jim@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#pragma once
+
+#include <util/darray.h>
+#include <util/threading.h>
+#include <graphics/graphics.h>
+#include <graphics/device-exports.h>
+#include <graphics/vec2.h>
+#include <graphics/vec4.h>
+#include <graphics/matrix4.h>
+
+/*
+ * Software (CPU) renderer.
+ *
+ * Shaders aren't compiled: each effect function libobs uses is matched by
+ * effect file and function name to a C implementation, and the parameters
+ * those implementations read are resolved into fixed slots when the shader
+ * is created, so that nothing is looked up by name per pixel.
+ *
+ * Pixels are shaded in floating point, one at a time in general.  Affine
+ * spans of the common pixel shaders (the default effect and the color format
+ * conversions) have span kernels instead, which shade a run of pixels at once
+ * with SSE2 (SIMDe elsewhere), and spans written to 8-bit RGBA targets are
+ * converted, blended and stored a run at a time.  Large primitives are also
+ * split into bands of rows on the task scheduler.
+ * test/benchmark/sw-render-benchmark times the common draws.
+ */
+
+enum sw_const {
+	SW_CONST_COLOR,
+	SW_CONST_RANDOMVALS1,
+	SW_CONST_RANDOMVALS2,
+	SW_CONST_RANDOMVALS3,
+	SW_CONST_SCALE,
+	SW_CONST_BASE_DIMENSION,
+	SW_CONST_BASE_DIMENSION_I,
+	SW_CONST_UNDISTORT_FACTOR,
+	SW_CONST_COLOR_VEC0,
+	SW_CONST_COLOR_VEC1,
+	SW_CONST_COLOR_VEC2,
+	SW_CONST_COLOR_RANGE_MIN,
+	SW_CONST_COLOR_RANGE_MAX,
+	SW_CONST_WIDTH,
+	SW_CONST_HEIGHT,
+	SW_CONST_WIDTH_I,
+	SW_CONST_WIDTH_D2,
+	SW_CONST_HEIGHT_D2,
+	SW_CONST_COUNT
+};
+
+#define SW_MAX_IMAGES 4
+#define SW_MAX_VARYINGS 2
+
+/* the most pixels a span kernel shades per call */
+#define SW_SPAN_PIXELS 64
+
+struct sw_draw;
+
+struct sw_vertex_in {
+	uint32_t id;
+	struct vec4 pos;
+	struct vec4 uv;
+	struct vec4 color;
+};
+
+struct sw_vertex_out {
+	struct vec4 pos;
+	struct vec4 v[SW_MAX_VARYINGS];
+};
+
+struct sw_fragment {
+	/* pixel center, in render target coordinates */
+	float x;
+	float y;
+	struct vec4 v[SW_MAX_VARYINGS];
+
+	/* screen-space derivatives of v[0] */
+	struct vec4 ddx;
+	struct vec4 ddy;
+};
+
+typedef void (*sw_vertex_func)(const struct sw_draw *draw,
+			       const struct sw_vertex_in *in,
+			       struct sw_vertex_out *out);
+typedef void (*sw_pixel_func)(const struct sw_draw *draw,
+			      const struct sw_fragment *frag, struct vec4 *out);
+
+/* shades count pixels from frag to the right, with varyings advancing by
+ * dvdx per pixel.  frag->ddx/ddy are constant over the span.  out has room
+ * for SW_SPAN_PIXELS colors, so kernels may shade in groups of four past
+ * count */
+typedef void (*sw_span_func)(const struct sw_draw *draw,
+			     const struct sw_fragment *frag,
+			     const struct vec4 *dvdx, int count,
+			     struct vec4 *out);
+
+struct sw_image {
+	gs_texture_t *tex;
+	gs_samplerstate_t *sampler;
+	bool srgb;
+};
+
+struct sw_draw {
+	gs_device_t *device;
+
+	struct matrix4 viewproj;
+	struct vec4 consts[SW_CONST_COUNT];
+	struct sw_image images[SW_MAX_IMAGES];
+	bool undistort;
+
+	sw_vertex_func vertex;
+	sw_pixel_func pixel;
+	sw_span_func span;
+
+	gs_texture_t *target;
+	int target_slice;
+	bool srgb_write;
+
+	/* pixels outside of this rect (viewport clipped by scissor and the
+	 * target size) are never written */
+	int clip_x0, clip_y0;
+	int clip_x1, clip_y1;
+	struct gs_rect viewport;
+
+	bool blend;
+	enum gs_blend_type src_c, dest_c;
+	enum gs_blend_type src_a, dest_a;
+	bool write_mask[4];
+};
+
+/* ------------------------------------------------------------------------- */
+
+struct gs_sampler_state {
+	gs_device_t *device;
+	struct gs_sampler_info info;
+	struct vec4 border_color;
+	bool point;
+};
+
+struct gs_shader_param {
+	enum gs_shader_param_type type;
+
+	char *name;
+	gs_shader_t *shader;
+	gs_samplerstate_t *next_sampler;
+	int array_count;
+
+	struct gs_texture *texture;
+	bool srgb;
+
+	DARRAY(uint8_t) cur_value;
+	DARRAY(uint8_t) def_value;
+};
+
+struct gs_shader {
+	gs_device_t *device;
+	enum gs_shader_type type;
+	char *func_name;
+
+	sw_vertex_func vertex;
+	sw_pixel_func pixel;
+	sw_span_func span;
+	bool undistort;
+
+	struct gs_shader_param *viewproj;
+	struct gs_shader_param *world;
+	struct gs_shader_param *consts[SW_CONST_COUNT];
+	struct gs_shader_param *images[SW_MAX_IMAGES];
+
+	DARRAY(struct gs_shader_param) params;
+	DARRAY(gs_samplerstate_t *) samplers;
+};
+
+struct gs_texture {
+	gs_device_t *device;
+	enum gs_texture_type type;
+	enum gs_color_format format;
+	uint32_t width;
+	uint32_t height;
+	uint32_t depth;
+	uint32_t levels;
+	bool is_dynamic;
+	bool is_render_target;
+
+	uint32_t pixel_size;
+	uint32_t linesize;
+	size_t slice_size;
+	uint8_t *data;
+};
+
+struct gs_stage_surface {
+	gs_device_t *device;
+
+	enum gs_color_format format;
+	uint32_t width;
+	uint32_t height;
+
+	uint32_t linesize;
+	uint8_t *data;
+};
+
+struct gs_zstencil_buffer {
+	gs_device_t *device;
+	enum gs_zstencil_format format;
+	uint32_t width;
+	uint32_t height;
+};
+
+struct gs_vertex_buffer {
+	gs_device_t *device;
+	size_t num;
+	bool dynamic;
+	struct gs_vb_data *data;
+};
+
+struct gs_index_buffer {
+	gs_device_t *device;
+	enum gs_index_type type;
+	void *data;
+	size_t num;
+	size_t width;
+	size_t size;
+	bool dynamic;
+};
+
+struct gs_timer {
+	uint64_t begin;
+	uint64_t end;
+};
+
+struct gs_swap_chain {
+	gs_device_t *device;
+	struct gs_init_data info;
+	gs_texture_t *target;
+};
+
+struct gs_device {
+	gs_texture_t *cur_render_target;
+	gs_zstencil_t *cur_zstencil_buffer;
+	int cur_render_side;
+	gs_texture_t *cur_textures[GS_MAX_TEXTURES];
+	gs_samplerstate_t *cur_samplers[GS_MAX_TEXTURES];
+	gs_vertbuffer_t *cur_vertex_buffer;
+	gs_indexbuffer_t *cur_index_buffer;
+	gs_shader_t *cur_vertex_shader;
+	gs_shader_t *cur_pixel_shader;
+	gs_swapchain_t *cur_swap;
+
+	gs_samplerstate_t *default_sampler;
+
+	enum gs_cull_mode cur_cull_mode;
+	struct gs_rect cur_viewport;
+	struct gs_rect cur_scissor;
+	bool scissor_enabled;
+
+	bool blend_enabled;
+	enum gs_blend_type blend_src_c;
+	enum gs_blend_type blend_dest_c;
+	enum gs_blend_type blend_src_a;
+	enum gs_blend_type blend_dest_a;
+	bool write_mask[4];
+	bool framebuffer_srgb;
+
+	struct matrix4 cur_proj;
+	DARRAY(struct matrix4) proj_stack;
+
+	DARRAY(struct sw_vertex_out) transformed;
+};
+
+/* ------------------------------------------------------------------------- */
+/* sw-texture.c */
+
+extern void sw_texel_load(const gs_texture_t *tex, int slice, int x, int y,
+			  bool srgb, struct vec4 *out);
+extern void sw_texel_store(gs_texture_t *tex, int slice, int x, int y,
+			   const struct vec4 *color, bool srgb);
+extern void sw_image_load(const struct sw_image *image, int x, int y,
+			  struct vec4 *out);
+extern void sw_image_sample(const struct sw_image *image, float u, float v,
+			    struct vec4 *out);
+
+extern void sw_texel_load_span(const gs_texture_t *tex, int slice, int x,
+			       int y, int count, bool srgb, struct vec4 *out);
+extern void sw_texel_store_span(gs_texture_t *tex, int slice, int x, int y,
+				int count, const struct vec4 *colors,
+				bool srgb);
+extern void sw_image_load_span(const struct sw_image *image, float x,
+			       float y, float dx, float dy, int count,
+			       struct vec4 *out);
+extern void sw_image_sample_span(const struct sw_image *image, float u,
+				 float v, float du, float dv, int count,
+				 struct vec4 *out);
+
+extern void sw_init_tables(void);
+
+/* ------------------------------------------------------------------------- */
+/* sw-shader.c */
+
+extern void sw_shader_resolve(gs_shader_t *shader, const char *shader_str,
+			      const char *file);
+extern void sw_draw_load_shader_params(struct sw_draw *draw,
+				       gs_shader_t *vs, gs_shader_t *ps);
+
+/* ------------------------------------------------------------------------- */
+/* sw-raster.c */
+
+extern void sw_rasterize(struct sw_draw *draw, enum gs_draw_mode mode,
+			 const struct sw_vertex_out *verts, size_t num,
+			 enum gs_cull_mode cull_mode);
+extern void sw_write_pixel(const struct sw_draw *draw, int x, int y,
+			   const struct vec4 *color);
@@ -0,0 +1,1002 @@
+/******************************************************************************
+    Copyright (C) 2021 by Hugh Bailey <obs.jim@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include <math.h>
+#include <util/bmem.h>
+#include <graphics/srgb.h>
+#include "sw-subsystem.h"
+
+/* linear values are quantized to this many steps when encoding to 8-bit
+ * sRGB, which keeps the error well under one step near black */
+#define SRGB_ENCODE_STEPS 16384
+
+static float unorm8_to_float[256];
+static float srgb8_to_linear[256];
+static uint8_t linear_to_srgb8[SRGB_ENCODE_STEPS + 1];
+static bool tables_initialized = false;
+
+void sw_init_tables(void)
+{
+	if (tables_initialized)
+		return;
+
+	for (int i = 0; i < 256; i++) {
+		unorm8_to_float[i] = (float)i / 255.0f;
+		srgb8_to_linear[i] =
+			gs_srgb_nonlinear_to_linear(unorm8_to_float[i]);
+	}
+
+	for (int i = 0; i <= SRGB_ENCODE_STEPS; i++) {
+		float linear = (float)i / (float)SRGB_ENCODE_STEPS;
+		float srgb = gs_srgb_linear_to_nonlinear(linear);
+		linear_to_srgb8[i] = (uint8_t)(srgb * 255.0f + 0.5f);
+	}
+
+	tables_initialized = true;
+}
+
+/* ------------------------------------------------------------------------- */
+
+static inline float half_to_float(uint16_t h)
+{
+	uint32_t sign = (uint32_t)(h & 0x8000) << 16;
+	uint32_t exp = (h >> 10) & 0x1F;
+	uint32_t mant = h & 0x3FF;
+	union {
+		uint32_t u;
+		float f;
+	} v;
+
+	if (exp == 0) {
+		float f = (float)mant / 16777216.0f;
+		return sign ? -f : f;
+	} else if (exp == 31) {
+		v.u = sign | 0x7F800000 | (mant << 13);
+	} else {
+		v.u = sign | ((exp + 112) << 23) | (mant << 13);
+	}
+
+	return v.f;
+}
+
+static inline uint16_t float_to_half(float f)
+{
+	union {
+		uint32_t u;
+		float f;
+	} v;
+	v.f = f;
+
+	uint32_t sign = (v.u >> 16) & 0x8000;
+	uint32_t f_exp = (v.u >> 23) & 0xFF;
+	int32_t exp = (int32_t)f_exp - 127 + 15;
+	uint32_t mant = v.u & 0x7FFFFF;
+	uint32_t half;
+
+	if (f_exp == 0xFF)
+		return (uint16_t)(sign | 0x7C00 | (mant ? 0x200 : 0));
+	if (exp >= 31)
+		return (uint16_t)(sign | 0x7C00);
+
+	if (exp <= 0) {
+		uint32_t shift;
+
+		if (exp < -10)
+			return (uint16_t)sign;
+
+		mant |= 0x800000;
+		shift = (uint32_t)(14 - exp);
+		half = mant >> shift;
+		if ((mant >> (shift - 1)) & 1)
+			half++;
+		return (uint16_t)(sign | half);
+	}
+
+	half = sign | ((uint32_t)exp << 10) | (mant >> 13);
+	if (mant & 0x1000)
+		half++;
+	return (uint16_t)half;
+}
+
+static inline float saturate(float f)
+{
+	/* written so that NaN becomes 0 */
+	return f > 0.0f ? (f < 1.0f ? f : 1.0f) : 0.0f;
+}
+
+static inline uint8_t float_to_unorm8(float f)
+{
+	return (uint8_t)(saturate(f) * 255.0f + 0.5f);
+}
+
+static inline uint8_t float_to_srgb8(float f)
+{
+	return linear_to_srgb8[(int)(saturate(f) * SRGB_ENCODE_STEPS + 0.5f)];
+}
+
+static inline uint16_t float_to_unorm16(float f)
+{
+	return (uint16_t)(saturate(f) * 65535.0f + 0.5f);
+}
+
+static inline uint32_t float_to_unorm10(float f)
+{
+	return (uint32_t)(saturate(f) * 1023.0f + 0.5f);
+}
+
+/* ------------------------------------------------------------------------- */
+
+void sw_texel_load(const gs_texture_t *tex, int slice, int x, int y,
+		   bool srgb, struct vec4 *out)
+{
+	const uint8_t *p = tex->data + tex->slice_size * (size_t)slice +
+			   (size_t)tex->linesize * (size_t)y +
+			   (size_t)tex->pixel_size * (size_t)x;
+	const float *rgb8 = (srgb && gs_is_srgb_format(tex->format))
+				    ? srgb8_to_linear
+				    : unorm8_to_float;
+	const uint16_t *p16 = (const uint16_t *)p;
+	const float *p32 = (const float *)p;
+	uint32_t packed;
+
+	switch (tex->format) {
+	case GS_A8:
+		vec4_set(out, 0.0f, 0.0f, 0.0f, unorm8_to_float[p[0]]);
+		break;
+	case GS_R8:
+		vec4_set(out, unorm8_to_float[p[0]], 0.0f, 0.0f, 1.0f);
+		break;
+	case GS_R8G8:
+		vec4_set(out, unorm8_to_float[p[0]], unorm8_to_float[p[1]],
+			 0.0f, 1.0f);
+		break;
+	case GS_RGBA:
+	case GS_RGBA_UNORM:
+		vec4_set(out, rgb8[p[0]], rgb8[p[1]], rgb8[p[2]],
+			 unorm8_to_float[p[3]]);
+		break;
+	case GS_BGRX:
+	case GS_BGRX_UNORM:
+		vec4_set(out, rgb8[p[2]], rgb8[p[1]], rgb8[p[0]], 1.0f);
+		break;
+	case GS_BGRA:
+	case GS_BGRA_UNORM:
+		vec4_set(out, rgb8[p[2]], rgb8[p[1]], rgb8[p[0]],
+			 unorm8_to_float[p[3]]);
+		break;
+	case GS_R10G10B10A2:
+		memcpy(&packed, p, sizeof(packed));
+		vec4_set(out, (float)(packed & 0x3FF) / 1023.0f,
+			 (float)((packed >> 10) & 0x3FF) / 1023.0f,
+			 (float)((packed >> 20) & 0x3FF) / 1023.0f,
+			 (float)(packed >> 30) / 3.0f);
+		break;
+	case GS_RGBA16:
+		vec4_set(out, (float)p16[0] / 65535.0f,
+			 (float)p16[1] / 65535.0f, (float)p16[2] / 65535.0f,
+			 (float)p16[3] / 65535.0f);
+		break;
+	case GS_R16:
+		vec4_set(out, (float)p16[0] / 65535.0f, 0.0f, 0.0f, 1.0f);
+		break;
+	case GS_RGBA16F:
+		vec4_set(out, half_to_float(p16[0]), half_to_float(p16[1]),
+			 half_to_float(p16[2]), half_to_float(p16[3]));
+		break;
+	case GS_RG16F:
+		vec4_set(out, half_to_float(p16[0]), half_to_float(p16[1]),
+			 0.0f, 1.0f);
+		break;
+	case GS_R16F:
+		vec4_set(out, half_to_float(p16[0]), 0.0f, 0.0f, 1.0f);
+		break;
+	case GS_RGBA32F:
+		vec4_set(out, p32[0], p32[1], p32[2], p32[3]);
+		break;
+	case GS_RG32F:
+		vec4_set(out, p32[0], p32[1], 0.0f, 1.0f);
+		break;
+	case GS_R32F:
+		vec4_set(out, p32[0], 0.0f, 0.0f, 1.0f);
+		break;
+	default:
+		vec4_zero(out);
+	}
+}
+
+void sw_texel_store(gs_texture_t *tex, int slice, int x, int y,
+		    const struct vec4 *color, bool srgb)
+{
+	uint8_t *p = tex->data + tex->slice_size * (size_t)slice +
+		     (size_t)tex->linesize * (size_t)y +
+		     (size_t)tex->pixel_size * (size_t)x;
+	bool encode = srgb && gs_is_srgb_format(tex->format);
+	uint16_t *p16 = (uint16_t *)p;
+	float *p32 = (float *)p;
+	uint8_t r, g, b;
+	uint32_t packed;
+
+	if (tex->format == GS_RGBA || tex->format == GS_BGRX ||
+	    tex->format == GS_BGRA || tex->format == GS_RGBA_UNORM ||
+	    tex->format == GS_BGRX_UNORM || tex->format == GS_BGRA_UNORM) {
+		r = encode ? float_to_srgb8(color->x)
+			   : float_to_unorm8(color->x);
+		g = encode ? float_to_srgb8(color->y)
+			   : float_to_unorm8(color->y);
+		b = encode ? float_to_srgb8(color->z)
+			   : float_to_unorm8(color->z);
+	} else {
+		r = g = b = 0;
+	}
+
+	switch (tex->format) {
+	case GS_A8:
+		p[0] = float_to_unorm8(color->w);
+		break;
+	case GS_R8:
+		p[0] = float_to_unorm8(color->x);
+		break;
+	case GS_R8G8:
+		p[0] = float_to_unorm8(color->x);
+		p[1] = float_to_unorm8(color->y);
+		break;
+	case GS_RGBA:
+	case GS_RGBA_UNORM:
+		p[0] = r;
+		p[1] = g;
+		p[2] = b;
+		p[3] = float_to_unorm8(color->w);
+		break;
+	case GS_BGRX:
+	case GS_BGRX_UNORM:
+		p[0] = b;
+		p[1] = g;
+		p[2] = r;
+		p[3] = 255;
+		break;
+	case GS_BGRA:
+	case GS_BGRA_UNORM:
+		p[0] = b;
+		p[1] = g;
+		p[2] = r;
+		p[3] = float_to_unorm8(color->w);
+		break;
+	case GS_R10G10B10A2:
+		packed = float_to_unorm10(color->x) |
+			 (float_to_unorm10(color->y) << 10) |
+			 (float_to_unorm10(color->z) << 20) |
+			 ((uint32_t)(saturate(color->w) * 3.0f + 0.5f) << 30);
+		memcpy(p, &packed, sizeof(packed));
+		break;
+	case GS_RGBA16:
+		p16[0] = float_to_unorm16(color->x);
+		p16[1] = float_to_unorm16(color->y);
+		p16[2] = float_to_unorm16(color->z);
+		p16[3] = float_to_unorm16(color->w);
+		break;
+	case GS_R16:
+		p16[0] = float_to_unorm16(color->x);
+		break;
+	case GS_RGBA16F:
+		p16[0] = float_to_half(color->x);
+		p16[1] = float_to_half(color->y);
+		p16[2] = float_to_half(color->z);
+		p16[3] = float_to_half(color->w);
+		break;
+	case GS_RG16F:
+		p16[0] = float_to_half(color->x);
+		p16[1] = float_to_half(color->y);
+		break;
+	case GS_R16F:
+		p16[0] = float_to_half(color->x);
+		break;
+	case GS_RGBA32F:
+		p32[0] = color->x;
+		p32[1] = color->y;
+		p32[2] = color->z;
+		p32[3] = color->w;
+		break;
+	case GS_RG32F:
+		p32[0] = color->x;
+		p32[1] = color->y;
+		break;
+	case GS_R32F:
+		p32[0] = color->x;
+		break;
+	default:;
+	}
+}
+
+/* ------------------------------------------------------------------------- */
+
+static inline int address_coord(enum gs_address_mode mode, int i, int size,
+				bool *border)
+{
+	int period;
+
+	switch (mode) {
+	case GS_ADDRESS_WRAP:
+		i %= size;
+		return i < 0 ? i + size : i;
+	case GS_ADDRESS_MIRROR:
+		period = size * 2;
+		i %= period;
+		if (i < 0)
+			i += period;
+		return i < size ? i : period - 1 - i;
+	case GS_ADDRESS_MIRRORONCE:
+		if (i < 0)
+			i = -i - 1;
+		return i >= size ? size - 1 : i;
+	case GS_ADDRESS_BORDER:
+		if (i < 0 || i >= size)
+			*border = true;
+		return i;
+	case GS_ADDRESS_CLAMP:
+	default:
+		return i < 0 ? 0 : (i >= size ? size - 1 : i);
+	}
+}
+
+static inline void fetch_texel(const struct sw_image *image, int x, int y,
+			       struct vec4 *out)
+{
+	const gs_texture_t *tex = image->tex;
+	const gs_samplerstate_t *ss = image->sampler;
+	bool border = false;
+
+	x = address_coord(ss->info.address_u, x, (int)tex->width, &border);
+	y = address_coord(ss->info.address_v, y, (int)tex->height, &border);
+
+	if (border)
+		vec4_copy(out, &ss->border_color);
+	else
+		sw_texel_load(tex, 0, x, y, image->srgb, out);
+}
+
+static inline void lerp(struct vec4 *dst, const struct vec4 *a,
+			const struct vec4 *b, float t)
+{
+	struct vec4 delta;
+	vec4_sub(&delta, b, a);
+	vec4_mulf(&delta, &delta, t);
+	vec4_add(dst, a, &delta);
+}
+
+void sw_image_sample(const struct sw_image *image, float u, float v,
+		     struct vec4 *out)
+{
+	const gs_texture_t *tex = image->tex;
+	struct vec4 t00, t10, t01, t11, top, bottom;
+	float x, y, fx, fy;
+	int x0, y0;
+
+	if (!tex || !tex->data) {
+		vec4_zero(out);
+		return;
+	}
+
+	x = u * (float)tex->width;
+	y = v * (float)tex->height;
+
+	if (image->sampler->point) {
+		fetch_texel(image, (int)floorf(x), (int)floorf(y), out);
+		return;
+	}
+
+	x -= 0.5f;
+	y -= 0.5f;
+	fx = floorf(x);
+	fy = floorf(y);
+	x0 = (int)fx;
+	y0 = (int)fy;
+
+	fetch_texel(image, x0, y0, &t00);
+	fetch_texel(image, x0 + 1, y0, &t10);
+	fetch_texel(image, x0, y0 + 1, &t01);
+	fetch_texel(image, x0 + 1, y0 + 1, &t11);
+
+	lerp(&top, &t00, &t10, x - fx);
+	lerp(&bottom, &t01, &t11, x - fx);
+	lerp(out, &top, &bottom, y - fy);
+}
+
+void sw_image_load(const struct sw_image *image, int x, int y,
+		   struct vec4 *out)
+{
+	const gs_texture_t *tex = image->tex;
+
+	/* out of range loads return zero, as they do on the GPU */
+	if (!tex || !tex->data || x < 0 || y < 0 || x >= (int)tex->width ||
+	    y >= (int)tex->height) {
+		vec4_zero(out);
+		return;
+	}
+
+	sw_texel_load(tex, 0, x, y, image->srgb, out);
+}
+
+/* ------------------------------------------------------------------------- */
+/* spans                                                                     */
+
+/* 8-bit color texels that convert without the sRGB tables are converted a
+ * whole texel at a time */
+static inline bool is_rgba8(enum gs_color_format format, bool srgb)
+{
+	switch (format) {
+	case GS_RGBA:
+	case GS_BGRX:
+	case GS_BGRA:
+		return !srgb;
+	case GS_RGBA_UNORM:
+	case GS_BGRX_UNORM:
+	case GS_BGRA_UNORM:
+		return true;
+	default:
+		return false;
+	}
+}
+
+static inline bool is_bgr8(enum gs_color_format format)
+{
+	return format == GS_BGRX || format == GS_BGRA ||
+	       format == GS_BGRX_UNORM || format == GS_BGRA_UNORM;
+}
+
+static inline bool is_bgrx8(enum gs_color_format format)
+{
+	return format == GS_BGRX || format == GS_BGRX_UNORM;
+}
+
+static inline void rgba8_load(const uint8_t *p, bool bgr, bool opaque,
+			      struct vec4 *out)
+{
+	const __m128i zero = _mm_setzero_si128();
+	uint32_t packed = (uint32_t)p[0] | ((uint32_t)p[1] << 8) |
+			  ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+	__m128i i = _mm_cvtsi32_si128((int)packed);
+	__m128 f;
+
+	i = _mm_unpacklo_epi8(i, zero);
+	i = _mm_unpacklo_epi16(i, zero);
+
+	/* divided rather than multiplied by 1/255 to match unorm8_to_float */
+	f = _mm_div_ps(_mm_cvtepi32_ps(i), _mm_set1_ps(255.0f));
+	if (bgr)
+		f = _mm_shuffle_ps(f, f, _MM_SHUFFLE(3, 0, 1, 2));
+
+	out->m = f;
+	if (opaque)
+		out->w = 1.0f;
+}
+
+static inline void rgba8_store(uint8_t *p, const struct vec4 *color, bool bgr,
+			       bool opaque)
+{
+	/* max first so that NaN becomes 0, as with saturate */
+	__m128 f = _mm_max_ps(color->m, _mm_setzero_ps());
+	__m128i i;
+	uint32_t packed;
+
+	f = _mm_min_ps(f, _mm_set1_ps(1.0f));
+	f = _mm_add_ps(_mm_mul_ps(f, _mm_set1_ps(255.0f)), _mm_set1_ps(0.5f));
+	if (bgr)
+		f = _mm_shuffle_ps(f, f, _MM_SHUFFLE(3, 0, 1, 2));
+
+	i = _mm_cvttps_epi32(f);
+	i = _mm_packs_epi32(i, i);
+	i = _mm_packus_epi16(i, i);
+	packed = (uint32_t)_mm_cvtsi128_si32(i);
+
+	p[0] = (uint8_t)packed;
+	p[1] = (uint8_t)(packed >> 8);
+	p[2] = (uint8_t)(packed >> 16);
+	p[3] = opaque ? 255 : (uint8_t)(packed >> 24);
+}
+
+void sw_texel_load_span(const gs_texture_t *tex, int slice, int x, int y,
+			int count, bool srgb, struct vec4 *out)
+{
+	const uint8_t *p = tex->data + tex->slice_size * (size_t)slice +
+			   (size_t)tex->linesize * (size_t)y + (size_t)x * 4;
+	bool bgr = is_bgr8(tex->format);
+	bool opaque = is_bgrx8(tex->format);
+
+	if (!is_rgba8(tex->format, srgb)) {
+		for (int i = 0; i < count; i++)
+			sw_texel_load(tex, slice, x + i, y, srgb, &out[i]);
+		return;
+	}
+
+	for (int i = 0; i < count; i++, p += 4)
+		rgba8_load(p, bgr, opaque, &out[i]);
+}
+
+void sw_texel_store_span(gs_texture_t *tex, int slice, int x, int y,
+			 int count, const struct vec4 *colors, bool srgb)
+{
+	uint8_t *p = tex->data + tex->slice_size * (size_t)slice +
+		     (size_t)tex->linesize * (size_t)y + (size_t)x * 4;
+	bool bgr = is_bgr8(tex->format);
+	bool opaque = is_bgrx8(tex->format);
+
+	if (!is_rgba8(tex->format, srgb)) {
+		for (int i = 0; i < count; i++)
+			sw_texel_store(tex, slice, x + i, y, &colors[i], srgb);
+		return;
+	}
+
+	for (int i = 0; i < count; i++, p += 4)
+		rgba8_store(p, &colors[i], bgr, opaque);
+}
+
+void sw_image_load_span(const struct sw_image *image, float x, float y,
+			float dx, float dy, int count, struct vec4 *out)
+{
+	const gs_texture_t *tex = image->tex;
+	bool rgba8;
+	bool bgr;
+	bool opaque;
+
+	if (!tex || !tex->data) {
+		for (int i = 0; i < count; i++)
+			vec4_zero(&out[i]);
+		return;
+	}
+
+	rgba8 = is_rgba8(tex->format, image->srgb);
+	bgr = is_bgr8(tex->format);
+	opaque = is_bgrx8(tex->format);
+
+	for (int i = 0; i < count; i++, x += dx, y += dy) {
+		int ix = (int)x;
+		int iy = (int)y;
+
+		if (ix < 0 || iy < 0 || ix >= (int)tex->width ||
+		    iy >= (int)tex->height)
+			vec4_zero(&out[i]);
+		else if (rgba8)
+			rgba8_load(tex->data + (size_t)tex->linesize * iy +
+					   (size_t)ix * 4,
+				   bgr, opaque, &out[i]);
+		else
+			sw_texel_load(tex, 0, ix, iy, image->srgb, &out[i]);
+	}
+}
+
+void sw_image_sample_span(const struct sw_image *image, float u, float v,
+			  float du, float dv, int count, struct vec4 *out)
+{
+	const gs_texture_t *tex = image->tex;
+	float width, height;
+	bool point;
+	bool bgr;
+	bool opaque;
+
+	if (!tex || !tex->data || !is_rgba8(tex->format, image->srgb)) {
+		for (int i = 0; i < count; i++, u += du, v += dv)
+			sw_image_sample(image, u, v, &out[i]);
+		return;
+	}
+
+	width = (float)tex->width;
+	height = (float)tex->height;
+	point = image->sampler->point;
+	bgr = is_bgr8(tex->format);
+	opaque = is_bgrx8(tex->format);
+
+	for (int i = 0; i < count; i++, u += du, v += dv) {
+		struct vec4 t00, t10, t01, t11, top, bottom;
+		float x = u * width;
+		float y = v * height;
+		float fx, fy;
+		int x0, y0;
+
+		if (point) {
+			fetch_texel(image, (int)floorf(x), (int)floorf(y),
+				    &out[i]);
+			continue;
+		}
+
+		x -= 0.5f;
+		y -= 0.5f;
+		fx = floorf(x);
+		fy = floorf(y);
+		x0 = (int)fx;
+		y0 = (int)fy;
+
+		/* the address mode only matters at the edges */
+		if (x0 >= 0 && y0 >= 0 && x0 + 1 < (int)tex->width &&
+		    y0 + 1 < (int)tex->height) {
+			const uint8_t *p = tex->data +
+					   (size_t)tex->linesize * y0 +
+					   (size_t)x0 * 4;
+
+			rgba8_load(p, bgr, opaque, &t00);
+			rgba8_load(p + 4, bgr, opaque, &t10);
+			rgba8_load(p + tex->linesize, bgr, opaque, &t01);
+			rgba8_load(p + tex->linesize + 4, bgr, opaque, &t11);
+		} else {
+			fetch_texel(image, x0, y0, &t00);
+			fetch_texel(image, x0 + 1, y0, &t10);
+			fetch_texel(image, x0, y0 + 1, &t01);
+			fetch_texel(image, x0 + 1, y0 + 1, &t11);
+		}
+
+		lerp(&top, &t00, &t10, x - fx);
+		lerp(&bottom, &t01, &t11, x - fx);
+		lerp(&out[i], &top, &bottom, y - fy);
+	}
+}
+
+/* ------------------------------------------------------------------------- */
+
+static inline bool is_supported_format(enum gs_color_format format)
+{
+	return format != GS_UNKNOWN && !gs_is_compressed_format(format);
+}
+
+static gs_texture_t *texture_create(gs_device_t *device,
+				    enum gs_texture_type type, uint32_t width,
+				    uint32_t height, uint32_t depth,
+				    enum gs_color_format format,
+				    uint32_t levels, uint32_t flags)
+{
+	struct gs_texture *tex;
+
+	if (!is_supported_format(format)) {
+		blog(LOG_ERROR, "texture_create (software): unsupported "
+				"color format %d",
+		     (int)format);
+		return NULL;
+	}
+	if (!width || !height || !depth)
+		return NULL;
+
+	tex = bzalloc(sizeof(struct gs_texture));
+	tex->device = device;
+	tex->type = type;
+	tex->format = format;
+	tex->width = width;
+	tex->height = height;
+	tex->depth = depth;
+	tex->levels = levels;
+	tex->is_dynamic = (flags & GS_DYNAMIC) != 0;
+	tex->is_render_target = (flags & GS_RENDER_TARGET) != 0;
+
+	tex->pixel_size = gs_get_format_bpp(format) / 8;
+	tex->linesize = tex->pixel_size * width;
+	tex->slice_size = (size_t)tex->linesize * height;
+	tex->data = bzalloc(tex->slice_size * depth);
+	return tex;
+}
+
+static inline void texture_upload(gs_texture_t *tex, int slice,
+				  const uint8_t *data)
+{
+	if (data)
+		memcpy(tex->data + tex->slice_size * (size_t)slice, data,
+		       tex->slice_size);
+}
+
+gs_texture_t *device_texture_create(gs_device_t *device, uint32_t width,
+				    uint32_t height,
+				    enum gs_color_format color_format,
+				    uint32_t levels, const uint8_t **data,
+				    uint32_t flags)
+{
+	gs_texture_t *tex = texture_create(device, GS_TEXTURE_2D, width,
+					   height, 1, color_format, levels,
+					   flags);
+	if (!tex) {
+		blog(LOG_ERROR, "device_texture_create (software) failed");
+		return NULL;
+	}
+
+	/* mipmaps are never sampled, so only the base level is kept */
+	if (data)
+		texture_upload(tex, 0, data[0]);
+	return tex;
+}
+
+gs_texture_t *device_cubetexture_create(gs_device_t *device, uint32_t size,
+					enum gs_color_format color_format,
+					uint32_t levels, const uint8_t **data,
+					uint32_t flags)
+{
+	gs_texture_t *tex = texture_create(device, GS_TEXTURE_CUBE, size,
+					   size, 6, color_format, levels,
+					   flags);
+	if (!tex) {
+		blog(LOG_ERROR, "device_cubetexture_create (software) failed");
+		return NULL;
+	}
+
+	if (data) {
+		uint32_t side_levels = levels ? levels : 1;
+		for (int i = 0; i < 6; i++)
+			texture_upload(tex, i, data[i * side_levels]);
+	}
+	return tex;
+}
+
+gs_texture_t *device_voltexture_create(gs_device_t *device, uint32_t width,
+				       uint32_t height, uint32_t depth,
+				       enum gs_color_format color_format,
+				       uint32_t levels,
+				       const uint8_t *const *data,
+				       uint32_t flags)
+{
+	gs_texture_t *tex = texture_create(device, GS_TEXTURE_3D, width,
+					   height, depth, color_format, levels,
+					   flags);
+	if (!tex) {
+		blog(LOG_ERROR, "device_voltexture_create (software) failed");
+		return NULL;
+	}
+
+	if (data && data[0])
+		memcpy(tex->data, data[0], tex->slice_size * depth);
+	return tex;
+}
+
+#ifdef __linux__
+gs_texture_t *device_texture_create_from_dmabuf(
+	gs_device_t *device, unsigned int width, unsigned int height,
+	uint32_t drm_format, enum gs_color_format color_format,
+	uint32_t n_planes, const int *fds, const uint32_t *strides,
+	const uint32_t *offsets, const uint64_t *modifiers)
+{
+	UNUSED_PARAMETER(device);
+	UNUSED_PARAMETER(width);
+	UNUSED_PARAMETER(height);
+	UNUSED_PARAMETER(drm_format);
+	UNUSED_PARAMETER(color_format);
+	UNUSED_PARAMETER(n_planes);
+	UNUSED_PARAMETER(fds);
+	UNUSED_PARAMETER(strides);
+	UNUSED_PARAMETER(offsets);
+	UNUSED_PARAMETER(modifiers);
+
+	blog(LOG_WARNING, "device_texture_create_from_dmabuf (software): "
+			  "DMA-BUF import is not supported");
+	return NULL;
+}
+#endif
+
+enum gs_texture_type device_get_texture_type(const gs_texture_t *texture)
+{
+	return texture->type;
+}
+
+void gs_texture_destroy(gs_texture_t *tex)
+{
+	if (!tex)
+		return;
+
+	if (tex->device->cur_render_target == tex)
+		tex->device->cur_render_target = NULL;
+	for (int i = 0; i < GS_MAX_TEXTURES; i++) {
+		if (tex->device->cur_textures[i] == tex)
+			tex->device->cur_textures[i] = NULL;
+	}
+
+	bfree(tex->data);
+	bfree(tex);
+}
+
+uint32_t gs_texture_get_width(const gs_texture_t *tex)
+{
+	return tex->width;
+}
+
+uint32_t gs_texture_get_height(const gs_texture_t *tex)
+{
+	return tex->height;
+}
+
+enum gs_color_format gs_texture_get_color_format(const gs_texture_t *tex)
+{
+	return tex->format;
+}
+
+/* textures live in system memory, so mapping hands out the storage itself */
+bool gs_texture_map(gs_texture_t *tex, uint8_t **ptr, uint32_t *linesize)
+{
+	if (tex->type != GS_TEXTURE_2D) {
+		blog(LOG_ERROR, "gs_texture_map (software): texture is not "
+				"a 2D texture");
+		return false;
+	}
+
+	*ptr = tex->data;
+	*linesize = tex->linesize;
+	return true;
+}
+
+void gs_texture_unmap(gs_texture_t *tex)
+{
+	UNUSED_PARAMETER(tex);
+}
+
+bool gs_texture_is_rect(const gs_texture_t *tex)
+{
+	UNUSED_PARAMETER(tex);
+	return false;
+}
+
+void *gs_texture_get_obj(gs_texture_t *tex)
+{
+	return tex->data;
+}
+
+void gs_cubetexture_destroy(gs_texture_t *cubetex)
+{
+	gs_texture_destroy(cubetex);
+}
+
+uint32_t gs_cubetexture_get_size(const gs_texture_t *cubetex)
+{
+	return cubetex->width;
+}
+
+enum gs_color_format
+gs_cubetexture_get_color_format(const gs_texture_t *cubetex)
+{
+	return cubetex->format;
+}
+
+void gs_voltexture_destroy(gs_texture_t *voltex)
+{
+	gs_texture_destroy(voltex);
+}
+
+uint32_t gs_voltexture_get_width(const gs_texture_t *voltex)
+{
+	return voltex->width;
+}
+
+uint32_t gs_voltexture_get_height(const gs_texture_t *voltex)
+{
+	return voltex->height;
+}
+
+uint32_t gs_voltexture_get_depth(const gs_texture_t *voltex)
+{
+	return voltex->depth;
+}
+
+enum gs_color_format gs_voltexture_get_color_format(const gs_texture_t *voltex)
+{
+	return voltex->format;
+}
+
+/* ------------------------------------------------------------------------- */
+
+gs_stagesurf_t *device_stagesurface_create(gs_device_t *device,
+					   uint32_t width, uint32_t height,
+					   enum gs_color_format color_format)
+{
+	struct gs_stage_surface *surf;
+
+	if (!is_supported_format(color_format) || !width || !height) {
+		blog(LOG_ERROR, "device_stagesurface_create (software) failed");
+		return NULL;
+	}
+
+	surf = bzalloc(sizeof(struct gs_stage_surface));
+	surf->device = device;
+	surf->format = color_format;
+	surf->width = width;
+	surf->height = height;
+	surf->linesize = gs_get_format_bpp(color_format) / 8 * width;
+	surf->data = bzalloc((size_t)surf->linesize * height);
+	return surf;
+}
+
+void gs_stagesurface_destroy(gs_stagesurf_t *stagesurf)
+{
+	if (!stagesurf)
+		return;
+
+	bfree(stagesurf->data);
+	bfree(stagesurf);
+}
+
+uint32_t gs_stagesurface_get_width(const gs_stagesurf_t *stagesurf)
+{
+	return stagesurf->width;
+}
+
+uint32_t gs_stagesurface_get_height(const gs_stagesurf_t *stagesurf)
+{
+	return stagesurf->height;
+}
+
+enum gs_color_format
+gs_stagesurface_get_color_format(const gs_stagesurf_t *stagesurf)
+{
+	return stagesurf->format;
+}
+
+bool gs_stagesurface_map(gs_stagesurf_t *stagesurf, uint8_t **data,
+			 uint32_t *linesize)
+{
+	*data = stagesurf->data;
+	*linesize = stagesurf->linesize;
+	return true;
+}
+
+void gs_stagesurface_unmap(gs_stagesurf_t *stagesurf)
+{
+	UNUSED_PARAMETER(stagesurf);
+}
+
+/* ------------------------------------------------------------------------- */
+
+gs_zstencil_t *device_zstencil_create(gs_device_t *device, uint32_t width,
+				      uint32_t height,
+				      enum gs_zstencil_format format)
+{
+	struct gs_zstencil_buffer *zs;
+
+	zs = bzalloc(sizeof(struct gs_zstencil_buffer));
+	zs->device = device;
+	zs->format = format;
+	zs->width = width;
+	zs->height = height;
+	return zs;
+}
+
+void gs_zstencil_destroy(gs_zstencil_t *zstencil)
+{
+	bfree(zstencil);
+}
+
+/* ------------------------------------------------------------------------- */
+
+static inline bool is_point_filter(enum gs_sample_filter filter)
+{
+	switch (filter) {
+	case GS_FILTER_POINT:
+	case GS_FILTER_MIN_MAG_POINT_MIP_LINEAR:
+	case GS_FILTER_MIN_LINEAR_MAG_MIP_POINT:
+	case GS_FILTER_MIN_LINEAR_MAG_POINT_MIP_LINEAR:
+		return true;
+	default:
+		return false;
+	}
+}
+
+gs_samplerstate_t *
+device_samplerstate_create(gs_device_t *device,
+			   const struct gs_sampler_info *info)
+{
+	struct gs_sampler_state *sampler;
+
+	sampler = bzalloc(sizeof(struct gs_sampler_state));
+	sampler->device = device;
+	sampler->info = *info;
+	sampler->point = is_point_filter(info->filter);
+	vec4_from_rgba(&sampler->border_color, info->border_color);
+	return sampler;
+}
+
+void gs_samplerstate_destroy(gs_samplerstate_t *samplerstate)
+{
+	bfree(samplerstate);
+}
@@ -169,6 +169,23 @@ EXPORT void device_debug_marker_begin(gs_device_t *device,
 				      const char *markername,
 				      const float color[4]);
 EXPORT void device_debug_marker_end(gs_device_t *device);
+EXPORT void device_set_shader_cache_path(gs_device_t *device,
+					 const char *path);
+EXPORT void device_get_shader_cache_stats(gs_device_t *device,
+					  struct gs_shader_cache_stats *stats);
+EXPORT gs_upload_buffer_t *device_upload_buffer_create(gs_device_t *device,
+						       size_t size);
+EXPORT void gs_upload_buffer_destroy(gs_upload_buffer_t *buf);
+EXPORT uint8_t *gs_upload_buffer_get_data(gs_upload_buffer_t *buf);
+EXPORT bool device_texture_set_image_from_buffer(gs_device_t *device,
+						 gs_texture_t *tex,
+						 gs_upload_buffer_t *buf,
+						 size_t offset,
+						 uint32_t linesize);
+EXPORT void device_upload_buffer_fence(gs_device_t *device,
+				       gs_upload_buffer_t *buf);
+EXPORT bool device_upload_buffer_signaled(gs_device_t *device,
+					  gs_upload_buffer_t *buf);
 
 #if __linux__
 
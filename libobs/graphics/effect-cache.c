@@ -0,0 +1,494 @@
+/******************************************************************************
+    Copyright (C) 2021 by Hugh Bailey <obs.jim@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include "../util/platform.h"
+#include "../util/file-serializer.h"
+#include "../obs-config.h"
+#include "graphics-internal.h"
+#include "effect.h"
+
+/*
+ * Compiled effect cache
+ *
+ * An effect is stored after it has been parsed: its parameters (with
+ * defaults and annotations), its techniques and passes, and the shader code
+ * the effect parser generated for each pass along with the names of the
+ * effect parameters that shader uses.  Loading one back only has to create
+ * the shaders, so the preprocessor and effect parser are skipped entirely.
+ *
+ * Files are named after a hash of the effect source, the graphics module and
+ * its preprocessor define, the libobs version and the cache version, so
+ * shader code generated by another build of the effect parser is never used.
+ * Included files are recorded with a hash of their contents and checked on
+ * load, so editing an include invalidates every effect that uses it.
+ */
+
+#define EFFECT_CACHE_MAGIC 0x58464F42 /* "BOFX" */
+
+/* increment when the file layout or the code the effect parser generates
+ * changes, builds without a version string can't rely on OBS_VERSION */
+#define EFFECT_CACHE_VERSION 2
+
+#define MAX_CACHE_STRING (16 * 1024 * 1024)
+#define MAX_CACHE_ITEMS 65536
+
+#define FNV_OFFSET 0xCBF29CE484222325ULL
+#define FNV_PRIME 0x100000001B3ULL
+
+extern const char *gs_preprocessor_name(void);
+
+struct effect_cache_header {
+	uint32_t magic;
+	uint32_t version;
+	uint64_t hash;
+	uint64_t source_size;
+};
+
+static uint64_t hash_string(uint64_t hash, const char *str)
+{
+	if (str) {
+		while (*str) {
+			hash ^= (uint8_t)*(str++);
+			hash *= FNV_PRIME;
+		}
+	}
+
+	/* separator, so "ab" + "c" and "a" + "bc" differ */
+	hash ^= 0xFF;
+	hash *= FNV_PRIME;
+	return hash;
+}
+
+static uint64_t effect_cache_key(const char *effect_string)
+{
+	uint64_t hash = FNV_OFFSET;
+	hash ^= EFFECT_CACHE_VERSION;
+	hash *= FNV_PRIME;
+	hash = hash_string(hash, OBS_VERSION);
+	hash = hash_string(hash, gs_get_device_name());
+	hash = hash_string(hash, gs_preprocessor_name());
+	return hash_string(hash, effect_string);
+}
+
+static bool hash_file(const char *file, uint64_t *hash)
+{
+	char *data = os_quick_read_utf8_file(file);
+	if (!data)
+		return false;
+
+	*hash = hash_string(FNV_OFFSET, data);
+	bfree(data);
+	return true;
+}
+
+static void get_cache_file(struct dstr *file, const char *path, uint64_t hash)
+{
+	dstr_copy(file, path);
+	dstr_replace(file, "\\", "/");
+	if (dstr_end(file) != '/')
+		dstr_cat_ch(file, '/');
+	dstr_catf(file, "%016llx.fxc", (unsigned long long)hash);
+}
+
+/* ------------------------------------------------------------------------- */
+
+static inline void write_u32(struct serializer *s, uint32_t val)
+{
+	s_write(s, &val, sizeof(val));
+}
+
+static inline void write_u64(struct serializer *s, uint64_t val)
+{
+	s_write(s, &val, sizeof(val));
+}
+
+static inline void write_str(struct serializer *s, const char *str)
+{
+	size_t len = str ? strlen(str) : 0;
+	write_u32(s, (uint32_t)len);
+	s_write(s, str, len);
+}
+
+static inline void write_data(struct serializer *s, const struct darray *da)
+{
+	write_u32(s, (uint32_t)da->num);
+	s_write(s, da->array, da->num);
+}
+
+static void write_param(struct serializer *s,
+			const struct gs_effect_param *param)
+{
+	write_str(s, param->name);
+	write_u32(s, (uint32_t)param->type);
+	write_data(s, &param->default_val.da);
+
+	if (param->section == EFFECT_ANNOTATION)
+		return;
+
+	write_u32(s, (uint32_t)param->annotations.num);
+	for (size_t i = 0; i < param->annotations.num; i++)
+		write_param(s, param->annotations.array + i);
+}
+
+static void write_pass_params(struct serializer *s,
+			      const struct darray *pass_params)
+{
+	const struct pass_shaderparam *params = pass_params->array;
+
+	write_u32(s, (uint32_t)pass_params->num);
+	for (size_t i = 0; i < pass_params->num; i++)
+		write_str(s, params[i].eparam ? params[i].eparam->name : NULL);
+}
+
+static void write_dependencies(struct serializer *s, struct effect_parser *ep)
+{
+	struct cf_preprocessor *pp = &ep->cfp.pp;
+
+	write_u32(s, (uint32_t)pp->dependencies.num);
+	for (size_t i = 0; i < pp->dependencies.num; i++) {
+		const char *file = pp->dependencies.array[i].file;
+		uint64_t hash = 0;
+
+		hash_file(file, &hash);
+		write_str(s, file);
+		write_u64(s, hash);
+	}
+}
+
+bool gs_effect_cache_save(gs_effect_t *effect, struct effect_parser *ep,
+			  const char *path, const char *effect_string)
+{
+	struct effect_cache_header header = {0};
+	struct serializer s;
+	struct dstr file = {0};
+	size_t num_passes = 0;
+	size_t shader_idx = 0;
+	char **shaders = ep->shader_strings.array;
+
+	for (size_t i = 0; i < effect->techniques.num; i++)
+		num_passes += effect->techniques.array[i].passes.num;
+	if (ep->shader_strings.num != num_passes * 2)
+		return false;
+
+	header.magic = EFFECT_CACHE_MAGIC;
+	header.version = EFFECT_CACHE_VERSION;
+	header.hash = effect_cache_key(effect_string);
+	header.source_size = strlen(effect_string);
+
+	os_mkdirs(path);
+	get_cache_file(&file, path, header.hash);
+
+	if (!file_output_serializer_init_safe(&s, file.array, "tmp")) {
+		blog(LOG_WARNING, "Could not write effect cache file '%s'",
+		     file.array);
+		dstr_free(&file);
+		return false;
+	}
+
+	s_write(&s, &header, sizeof(header));
+	write_dependencies(&s, ep);
+
+	write_u32(&s, (uint32_t)effect->params.num);
+	for (size_t i = 0; i < effect->params.num; i++)
+		write_param(&s, effect->params.array + i);
+
+	write_u32(&s, (uint32_t)effect->techniques.num);
+	for (size_t i = 0; i < effect->techniques.num; i++) {
+		struct gs_effect_technique *tech = effect->techniques.array + i;
+
+		write_str(&s, tech->name);
+		write_u32(&s, (uint32_t)tech->passes.num);
+
+		for (size_t j = 0; j < tech->passes.num; j++) {
+			struct gs_effect_pass *pass = tech->passes.array + j;
+
+			write_str(&s, pass->name);
+			write_str(&s, shaders[shader_idx++]);
+			write_pass_params(&s, &pass->vertshader_params.da);
+			write_str(&s, shaders[shader_idx++]);
+			write_pass_params(&s, &pass->pixelshader_params.da);
+		}
+	}
+
+	file_output_serializer_free(&s);
+	dstr_free(&file);
+	return true;
+}
+
+/* ------------------------------------------------------------------------- */
+
+static inline bool read_u32(struct serializer *s, uint32_t *val)
+{
+	return s_read(s, val, sizeof(*val)) == sizeof(*val);
+}
+
+static inline bool read_u64(struct serializer *s, uint64_t *val)
+{
+	return s_read(s, val, sizeof(*val)) == sizeof(*val);
+}
+
+static inline bool read_count(struct serializer *s, uint32_t *num)
+{
+	return read_u32(s, num) && *num <= MAX_CACHE_ITEMS;
+}
+
+static bool read_str(struct serializer *s, char **str)
+{
+	uint32_t len;
+
+	if (!read_u32(s, &len) || len > MAX_CACHE_STRING)
+		return false;
+
+	*str = bmalloc(len + 1);
+	(*str)[len] = 0;
+	return s_read(s, *str, len) == len;
+}
+
+static bool read_data(struct serializer *s, struct darray *da)
+{
+	uint32_t size;
+
+	if (!read_u32(s, &size) || size > MAX_CACHE_STRING)
+		return false;
+
+	darray_resize(1, da, size);
+	return s_read(s, da->array, size) == size;
+}
+
+static bool read_dependencies(struct serializer *s)
+{
+	uint32_t num;
+
+	if (!read_count(s, &num))
+		return false;
+
+	for (uint32_t i = 0; i < num; i++) {
+		char *file = NULL;
+		uint64_t stored_hash;
+		uint64_t hash;
+		bool valid;
+
+		valid = read_str(s, &file) && read_u64(s, &stored_hash) &&
+			hash_file(file, &hash) && hash == stored_hash;
+		bfree(file);
+
+		if (!valid)
+			return false;
+	}
+
+	return true;
+}
+
+static bool read_param(struct serializer *s, gs_effect_t *effect,
+		       struct gs_effect_param *param,
+		       enum effect_section section)
+{
+	uint32_t type;
+	uint32_t num;
+
+	param->section = section;
+	param->effect = effect;
+
+	if (!read_str(s, &param->name) || !read_u32(s, &type) ||
+	    !read_data(s, &param->default_val.da))
+		return false;
+
+	param->type = (enum gs_shader_param_type)type;
+
+	if (section == EFFECT_ANNOTATION)
+		return true;
+
+	if (!read_count(s, &num))
+		return false;
+
+	da_resize(param->annotations, num);
+	for (uint32_t i = 0; i < num; i++) {
+		if (!read_param(s, effect, param->annotations.array + i,
+				EFFECT_ANNOTATION))
+			return false;
+	}
+
+	return true;
+}
+
+static bool read_params(struct serializer *s, gs_effect_t *effect)
+{
+	uint32_t num;
+
+	if (!read_count(s, &num))
+		return false;
+
+	da_resize(effect->params, num);
+	for (uint32_t i = 0; i < num; i++) {
+		struct gs_effect_param *param = effect->params.array + i;
+
+		if (!read_param(s, effect, param, EFFECT_PARAM))
+			return false;
+
+		if (strcmp(param->name, "ViewProj") == 0)
+			effect->view_proj = param;
+		else if (strcmp(param->name, "World") == 0)
+			effect->world = param;
+	}
+
+	return true;
+}
+
+static bool read_pass_shader(struct serializer *s, gs_effect_t *effect,
+			     struct gs_effect_technique *tech,
+			     struct gs_effect_pass *pass, uint32_t pass_idx,
+			     enum gs_shader_type type)
+{
+	struct darray *pass_params;
+	struct dstr location = {0};
+	char *shader_str = NULL;
+	gs_shader_t *shader;
+	uint32_t num;
+
+	if (!read_str(s, &shader_str)) {
+		bfree(shader_str);
+		return false;
+	}
+
+	/* same location string the effect parser uses */
+	dstr_copy(&location, effect->effect_path);
+	dstr_catf(&location, " (%s shader, technique %s, pass %u)",
+		  type == GS_SHADER_VERTEX ? "Vertex" : "Pixel", tech->name,
+		  pass_idx);
+
+	if (type == GS_SHADER_VERTEX) {
+		pass->vertshader = gs_vertexshader_create(shader_str,
+							  location.array, NULL);
+		shader = pass->vertshader;
+		pass_params = &pass->vertshader_params.da;
+	} else {
+		pass->pixelshader = gs_pixelshader_create(shader_str,
+							  location.array, NULL);
+		shader = pass->pixelshader;
+		pass_params = &pass->pixelshader_params.da;
+	}
+
+	dstr_free(&location);
+	bfree(shader_str);
+
+	if (!shader || !read_count(s, &num))
+		return false;
+
+	darray_resize(sizeof(struct pass_shaderparam), pass_params, num);
+
+	for (uint32_t i = 0; i < num; i++) {
+		struct pass_shaderparam *param = darray_item(
+			sizeof(struct pass_shaderparam), pass_params, i);
+		char *name = NULL;
+
+		if (!read_str(s, &name)) {
+			bfree(name);
+			return false;
+		}
+
+		param->eparam = gs_effect_get_param_by_name(effect, name);
+		param->sparam = gs_shader_get_param_by_name(shader, name);
+		bfree(name);
+
+		if (!param->sparam)
+			return false;
+	}
+
+	return true;
+}
+
+static bool read_techniques(struct serializer *s, gs_effect_t *effect)
+{
+	uint32_t num;
+
+	if (!read_count(s, &num))
+		return false;
+
+	da_resize(effect->techniques, num);
+	for (uint32_t i = 0; i < num; i++) {
+		struct gs_effect_technique *tech = effect->techniques.array + i;
+		uint32_t num_passes;
+
+		tech->section = EFFECT_TECHNIQUE;
+		tech->effect = effect;
+
+		if (!read_str(s, &tech->name) || !read_count(s, &num_passes))
+			return false;
+
+		da_resize(tech->passes, num_passes);
+		for (uint32_t j = 0; j < num_passes; j++) {
+			struct gs_effect_pass *pass = tech->passes.array + j;
+
+			pass->section = EFFECT_PASS;
+
+			if (!read_str(s, &pass->name))
+				return false;
+			if (!read_pass_shader(s, effect, tech, pass, j,
+					      GS_SHADER_VERTEX))
+				return false;
+			if (!read_pass_shader(s, effect, tech, pass, j,
+					      GS_SHADER_PIXEL))
+				return false;
+		}
+	}
+
+	return true;
+}
+
+static void clear_effect(gs_effect_t *effect)
+{
+	for (size_t i = 0; i < effect->params.num; i++)
+		effect_param_free(effect->params.array + i);
+	for (size_t i = 0; i < effect->techniques.num; i++)
+		effect_technique_free(effect->techniques.array + i);
+
+	da_free(effect->params);
+	da_free(effect->techniques);
+	effect->view_proj = NULL;
+	effect->world = NULL;
+}
+
+bool gs_effect_cache_load(gs_effect_t *effect, const char *path,
+			  const char *effect_string)
+{
+	struct effect_cache_header header;
+	struct serializer s;
+	struct dstr file = {0};
+	uint64_t hash = effect_cache_key(effect_string);
+	bool success;
+
+	get_cache_file(&file, path, hash);
+	success = file_input_serializer_init(&s, file.array);
+	dstr_free(&file);
+
+	if (!success)
+		return false;
+
+	success = s_read(&s, &header, sizeof(header)) == sizeof(header) &&
+		  header.magic == EFFECT_CACHE_MAGIC &&
+		  header.version == EFFECT_CACHE_VERSION &&
+		  header.hash == hash &&
+		  header.source_size == strlen(effect_string) &&
+		  read_dependencies(&s) && read_params(&s, effect) &&
+		  read_techniques(&s, effect);
+
+	file_input_serializer_free(&s);
+
+	if (!success)
+		clear_effect(effect);
+	return success;
+}
@@ -67,6 +67,8 @@ void ep_free(struct effect_parser *ep)
 		ep_sampler_free(ep->samplers.array + i);
 	for (i = 0; i < ep->techniques.num; i++)
 		ep_technique_free(ep->techniques.array + i);
+	for (i = 0; i < ep->shader_strings.num; i++)
+		bfree(ep->shader_strings.array[i]);
 
 	ep->cur_pass = NULL;
 	cf_parser_free(&ep->cfp);
@@ -75,6 +77,7 @@ void ep_free(struct effect_parser *ep)
 	da_free(ep->funcs);
 	da_free(ep->samplers);
 	da_free(ep->techniques);
+	da_free(ep->shader_strings);
 }
 
 static inline struct ep_func *ep_getfunc(struct effect_parser *ep,
@@ -1988,6 +1991,11 @@ static inline bool ep_compile_pass_shader(struct effect_parser *ep,
 	else
 		success = false;
 
+	if (success && ep->record_shaders) {
+		da_push_back(ep->shader_strings, &shader_str.array);
+		dstr_init(&shader_str);
+	}
+
 	dstr_free(&location);
 	dstr_array_free(used_params.array, used_params.num);
 	darray_free(&used_params);
@@ -270,6 +270,10 @@ struct effect_parser {
 	DARRAY(struct cf_token) tokens;
 	struct gs_effect_pass *cur_pass;
 
+	/* generated shader code, in compile order, for the effect cache */
+	bool record_shaders;
+	DARRAY(char *) shader_strings;
+
 	struct cf_parser cfp;
 };
 
@@ -282,8 +286,10 @@ static inline void ep_init(struct effect_parser *ep)
 	da_init(ep->techniques);
 	da_init(ep->files);
 	da_init(ep->tokens);
+	da_init(ep->shader_strings);
 
 	ep->cur_pass = NULL;
+	ep->record_shaders = false;
 	cf_parser_init(&ep->cfp);
 }
 
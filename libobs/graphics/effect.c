@@ -15,6 +15,7 @@
     along with this program.  If not, see <http://www.gnu.org/licenses/>.
 ******************************************************************************/
 
+#include "../util/threading.h"
 #include "effect.h"
 #include "graphics-internal.h"
 #include "vec2.h"
@@ -197,6 +198,12 @@ void gs_effect_update_params(gs_effect_t *effect)
 		upload_parameters(effect, true);
 }
 
+void effect_upload_params(gs_effect_t *effect, bool changed_only)
+{
+	if (effect)
+		upload_parameters(effect, changed_only);
+}
+
 bool gs_technique_begin_pass(gs_technique_t *tech, size_t idx)
 {
 	struct gs_effect_pass *passes;
@@ -277,6 +284,41 @@ gs_eparam_t *gs_effect_get_param_by_idx(const gs_effect_t *effect, size_t param)
 	return params + param;
 }
 
+static inline uint32_t param_name_hash(const char *name)
+{
+	uint32_t hash = 2166136261U;
+
+	while (*name) {
+		hash ^= (uint8_t)*(name++);
+		hash *= 16777619U;
+	}
+
+	return hash;
+}
+
+void effect_build_param_index(gs_effect_t *effect)
+{
+	size_t size = 8;
+	size_t mask;
+
+	while (size < effect->params.num * 2)
+		size *= 2;
+	mask = size - 1;
+
+	da_resize(effect->param_index, 0);
+	da_resize(effect->param_index, size);
+
+	for (size_t i = 0; i < effect->params.num; i++) {
+		size_t slot = param_name_hash(effect->params.array[i].name) &
+			      mask;
+
+		while (effect->param_index.array[slot])
+			slot = (slot + 1) & mask;
+
+		effect->param_index.array[slot] = (uint32_t)(i + 1);
+	}
+}
+
 gs_eparam_t *gs_effect_get_param_by_name(const gs_effect_t *effect,
 					 const char *name)
 {
@@ -284,17 +326,81 @@ gs_eparam_t *gs_effect_get_param_by_name(const gs_effect_t *effect,
 		return NULL;
 
 	struct gs_effect_param *params = effect->params.array;
+	size_t mask = effect->param_index.num - 1;
+	size_t slot;
 
-	for (size_t i = 0; i < effect->params.num; i++) {
-		struct gs_effect_param *param = params + i;
+	/* the index is built once the effect has been fully loaded, so the
+	 * effect parser itself still does a plain scan */
+	if (!effect->param_index.num) {
+		for (size_t i = 0; i < effect->params.num; i++) {
+			struct gs_effect_param *param = params + i;
+
+			if (strcmp(param->name, name) == 0)
+				return param;
+		}
+
+		return NULL;
+	}
+
+	slot = param_name_hash(name) & mask;
+
+	while (effect->param_index.array[slot]) {
+		struct gs_effect_param *param =
+			params + effect->param_index.array[slot] - 1;
 
 		if (strcmp(param->name, name) == 0)
 			return param;
+
+		slot = (slot + 1) & mask;
 	}
 
 	return NULL;
 }
 
+static volatile long last_param_key_id = 0;
+
+/* marks a key the effect has no parameter for */
+static struct gs_effect_param missing_param = {0};
+
+static inline size_t param_key_idx(struct gs_effect_param_key *key)
+{
+	long id = os_atomic_load_long(&key->id);
+
+	if (!id) {
+		long new_id = os_atomic_inc_long(&last_param_key_id);
+
+		if (os_atomic_compare_swap_long(&key->id, 0, new_id))
+			id = new_id;
+		else
+			id = os_atomic_load_long(&key->id);
+	}
+
+	return (size_t)(id - 1);
+}
+
+gs_eparam_t *gs_effect_get_param_by_key(gs_effect_t *effect,
+					struct gs_effect_param_key *key)
+{
+	struct gs_effect_param *param;
+	size_t idx;
+
+	if (!effect || !key)
+		return NULL;
+
+	idx = param_key_idx(key);
+	if (idx >= effect->key_params.num)
+		da_resize(effect->key_params, idx + 1);
+
+	param = effect->key_params.array[idx];
+	if (!param) {
+		param = gs_effect_get_param_by_name(effect, key->name);
+		effect->key_params.array[idx] = param ? param : &missing_param;
+		return param;
+	}
+
+	return param != &missing_param ? param : NULL;
+}
+
 size_t gs_param_get_num_annotations(const gs_eparam_t *param)
 {
 	return param ? param->annotations.num : 0;
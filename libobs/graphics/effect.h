@@ -155,6 +155,12 @@ struct gs_effect {
 	DARRAY(struct gs_effect_param) params;
 	DARRAY(struct gs_effect_technique) techniques;
 
+	/* open-addressed name index into params (param index + 1, 0 is an
+	 * empty slot), and params resolved through gs_effect_param_key, by
+	 * key id */
+	DARRAY(uint32_t) param_index;
+	DARRAY(struct gs_effect_param *) key_params;
+
 	struct gs_effect_technique *cur_technique;
 	struct gs_effect_pass *cur_pass;
 
@@ -182,6 +188,8 @@ static inline void effect_free(gs_effect_t *effect)
 
 	da_free(effect->params);
 	da_free(effect->techniques);
+	da_free(effect->param_index);
+	da_free(effect->key_params);
 
 	bfree(effect->effect_path);
 	bfree(effect->effect_dir);
@@ -189,6 +197,15 @@ static inline void effect_free(gs_effect_t *effect)
 	effect->effect_dir = NULL;
 }
 
+extern void effect_build_param_index(gs_effect_t *effect);
+
+/* effect-cache.c */
+extern bool gs_effect_cache_load(gs_effect_t *effect, const char *path,
+				 const char *effect_string);
+extern bool gs_effect_cache_save(gs_effect_t *effect,
+				 struct effect_parser *ep, const char *path,
+				 const char *effect_string);
+
 EXPORT void effect_upload_params(gs_effect_t *effect, bool changed_only);
 EXPORT void effect_upload_shader_params(gs_effect_t *effect,
 					gs_shader_t *shader,
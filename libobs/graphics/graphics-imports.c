@@ -193,6 +193,16 @@ bool load_graphics_imports(struct gs_exports *exports, void *module,
 	GRAPHICS_IMPORT(device_debug_marker_begin);
 	GRAPHICS_IMPORT(device_debug_marker_end);
 
+	GRAPHICS_IMPORT_OPTIONAL(device_set_shader_cache_path);
+	GRAPHICS_IMPORT_OPTIONAL(device_get_shader_cache_stats);
+
+	GRAPHICS_IMPORT_OPTIONAL(device_upload_buffer_create);
+	GRAPHICS_IMPORT_OPTIONAL(gs_upload_buffer_destroy);
+	GRAPHICS_IMPORT_OPTIONAL(gs_upload_buffer_get_data);
+	GRAPHICS_IMPORT_OPTIONAL(device_texture_set_image_from_buffer);
+	GRAPHICS_IMPORT_OPTIONAL(device_upload_buffer_fence);
+	GRAPHICS_IMPORT_OPTIONAL(device_upload_buffer_signaled);
+
 	/* OSX/Cocoa specific functions */
 #ifdef __APPLE__
 	GRAPHICS_IMPORT(device_shared_texture_available);
@@ -270,6 +270,25 @@ struct gs_exports {
 					  const float color[4]);
 	void (*device_debug_marker_end)(gs_device_t *device);
 
+	void (*device_set_shader_cache_path)(gs_device_t *device,
+					     const char *path);
+	void (*device_get_shader_cache_stats)(
+		gs_device_t *device, struct gs_shader_cache_stats *stats);
+
+	gs_upload_buffer_t *(*device_upload_buffer_create)(gs_device_t *device,
+							   size_t size);
+	void (*gs_upload_buffer_destroy)(gs_upload_buffer_t *buf);
+	uint8_t *(*gs_upload_buffer_get_data)(gs_upload_buffer_t *buf);
+	bool (*device_texture_set_image_from_buffer)(gs_device_t *device,
+						     gs_texture_t *tex,
+						     gs_upload_buffer_t *buf,
+						     size_t offset,
+						     uint32_t linesize);
+	void (*device_upload_buffer_fence)(gs_device_t *device,
+					   gs_upload_buffer_t *buf);
+	bool (*device_upload_buffer_signaled)(gs_device_t *device,
+					      gs_upload_buffer_t *buf);
+
 #ifdef __APPLE__
 	/* OSX/Cocoa specific functions */
 	gs_texture_t *(*device_texture_create_from_iosurface)(gs_device_t *dev,
@@ -344,6 +363,25 @@ struct blend_state {
 	enum gs_blend_type dest_a;
 };
 
+#define SPRITE_BATCH_MAX 256
+
+struct sprite_batch {
+	int depth;
+	bool flushing;
+	gs_vertbuffer_t *vertbuffer;
+
+	/* state the pending sprites were recorded with */
+	size_t num;
+	struct gs_effect *effect;
+	struct gs_effect_pass *pass;
+	struct blend_state blend;
+	bool srgb;
+	DARRAY(uint8_t) params;
+	DARRAY(uint8_t) scratch;
+};
+
+struct atlas_page;
+
 struct graphics_subsystem {
 	void *module;
 	gs_device_t *device;
@@ -359,6 +397,13 @@ struct graphics_subsystem {
 
 	gs_vertbuffer_t *sprite_buffer;
 
+	struct sprite_batch sprite_batch;
+	struct gs_draw_stats draw_stats;
+	gs_vertbuffer_t *cur_vertbuffer;
+	gs_indexbuffer_t *cur_indexbuffer;
+
+	DARRAY(struct atlas_page *) atlas_pages;
+
 	bool using_immediate;
 	struct gs_vb_data *vbd;
 	gs_vertbuffer_t *immediate_vertbuffer;
@@ -370,6 +415,10 @@ struct graphics_subsystem {
 	pthread_mutex_t effect_mutex;
 	struct gs_effect *first_effect;
 
+	/* protected by effect_mutex */
+	char *shader_cache_path;
+	struct gs_shader_cache_stats shader_cache_stats;
+
 	pthread_mutex_t mutex;
 	volatile long ref;
 
@@ -378,3 +427,17 @@ struct graphics_subsystem {
 
 	bool linear_srgb;
 };
+
+extern bool sprite_batch_init(struct graphics_subsystem *graphics);
+extern void sprite_batch_free(struct graphics_subsystem *graphics);
+extern bool sprite_batch_add(struct graphics_subsystem *graphics,
+			     const struct gs_vb_data *sprite);
+extern void sprite_batch_flush(struct graphics_subsystem *graphics);
+
+static inline void flush_sprites(struct graphics_subsystem *graphics)
+{
+	if (graphics->sprite_batch.num)
+		sprite_batch_flush(graphics);
+}
+
+extern void texture_atlas_free(struct graphics_subsystem *graphics);
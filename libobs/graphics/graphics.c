@@ -151,6 +151,8 @@ static bool graphics_init(struct graphics_subsystem *graphics)
 		return false;
 	if (!graphics_init_sprite_vb(graphics))
 		return false;
+	if (!sprite_batch_init(graphics))
+		return false;
 	if (pthread_mutex_init(&graphics->mutex, NULL) != 0)
 		return false;
 	if (pthread_mutex_init(&graphics->effect_mutex, NULL) != 0)
@@ -228,6 +230,8 @@ void gs_destroy(graphics_t *graphics)
 			effect = next;
 		}
 
+		texture_atlas_free(graphics);
+		sprite_batch_free(graphics);
 		graphics->exports.gs_vertexbuffer_destroy(
 			graphics->sprite_buffer);
 		graphics->exports.gs_vertexbuffer_destroy(
@@ -239,6 +243,7 @@ void gs_destroy(graphics_t *graphics)
 
 	pthread_mutex_destroy(&graphics->mutex);
 	pthread_mutex_destroy(&graphics->effect_mutex);
+	bfree(graphics->shader_cache_path);
 	da_free(graphics->matrix_stack);
 	da_free(graphics->viewport_stack);
 	da_free(graphics->blend_state_stack);
@@ -275,6 +280,7 @@ void gs_leave_context(void)
 		if (!os_atomic_dec_long(&thread_graphics->ref)) {
 			graphics_t *graphics = thread_graphics;
 
+			flush_sprites(graphics);
 			graphics->exports.device_leave_context(
 				graphics->device);
 			pthread_mutex_unlock(&graphics->mutex);
@@ -827,37 +833,106 @@ gs_effect_t *gs_effect_create(const char *effect_string, const char *filename,
 
 	struct gs_effect *effect = bzalloc(sizeof(struct gs_effect));
 	struct effect_parser parser;
+	const char *cache_path = NULL;
+	uint64_t start_time = os_gettime_ns();
+	bool cache_hit = false;
+	bool cache_write = false;
 	bool success;
 
 	effect->graphics = thread_graphics;
 	effect->effect_path = bstrdup(filename);
 
+	/* effects generated at runtime are not worth keeping around */
+	if (filename)
+		cache_path = thread_graphics->shader_cache_path;
+
 	ep_init(&parser);
-	success = ep_parse(&parser, effect, effect_string, filename);
-	if (!success) {
-		if (error_string)
-			*error_string =
-				error_data_buildstring(&parser.cfp.error_list);
-		gs_effect_destroy(effect);
-		effect = NULL;
+
+	if (cache_path)
+		cache_hit = gs_effect_cache_load(effect, cache_path,
+						 effect_string);
+
+	if (!cache_hit) {
+		parser.record_shaders = cache_path != NULL;
+		success = ep_parse(&parser, effect, effect_string, filename);
+		if (!success) {
+			if (error_string)
+				*error_string = error_data_buildstring(
+					&parser.cfp.error_list);
+			gs_effect_destroy(effect);
+			effect = NULL;
+
+		} else if (cache_path) {
+			cache_write = gs_effect_cache_save(
+				effect, &parser, cache_path, effect_string);
+		}
 	}
 
-	if (effect) {
-		pthread_mutex_lock(&thread_graphics->effect_mutex);
+	if (effect)
+		effect_build_param_index(effect);
 
-		if (effect->effect_path) {
-			effect->cached = true;
-			effect->next = thread_graphics->first_effect;
-			thread_graphics->first_effect = effect;
-		}
+	pthread_mutex_lock(&thread_graphics->effect_mutex);
 
-		pthread_mutex_unlock(&thread_graphics->effect_mutex);
+	if (cache_path) {
+		struct gs_shader_cache_stats *stats =
+			&thread_graphics->shader_cache_stats;
+
+		if (cache_hit)
+			stats->effect_hits++;
+		else
+			stats->effect_misses++;
+		if (cache_write)
+			stats->effect_writes++;
 	}
 
+	thread_graphics->shader_cache_stats.effect_load_time_ns +=
+		os_gettime_ns() - start_time;
+
+	if (effect && effect->effect_path) {
+		effect->cached = true;
+		effect->next = thread_graphics->first_effect;
+		thread_graphics->first_effect = effect;
+	}
+
+	pthread_mutex_unlock(&thread_graphics->effect_mutex);
+
 	ep_free(&parser);
 	return effect;
 }
 
+void gs_set_shader_cache_path(const char *path)
+{
+	graphics_t *graphics = thread_graphics;
+
+	if (!gs_valid("gs_set_shader_cache_path"))
+		return;
+
+	pthread_mutex_lock(&graphics->effect_mutex);
+	bfree(graphics->shader_cache_path);
+	graphics->shader_cache_path = path && *path ? bstrdup(path) : NULL;
+	pthread_mutex_unlock(&graphics->effect_mutex);
+
+	if (graphics->exports.device_set_shader_cache_path)
+		graphics->exports.device_set_shader_cache_path(graphics->device,
+							       path);
+}
+
+void gs_get_shader_cache_stats(struct gs_shader_cache_stats *stats)
+{
+	graphics_t *graphics = thread_graphics;
+
+	if (!gs_valid_p("gs_get_shader_cache_stats", stats))
+		return;
+
+	pthread_mutex_lock(&graphics->effect_mutex);
+	*stats = graphics->shader_cache_stats;
+	pthread_mutex_unlock(&graphics->effect_mutex);
+
+	if (graphics->exports.device_get_shader_cache_stats)
+		graphics->exports.device_get_shader_cache_stats(
+			graphics->device, stats);
+}
+
 gs_shader_t *gs_vertexshader_create_from_file(const char *file,
 					      char **error_string)
 {
@@ -1035,6 +1110,10 @@ void gs_draw_sprite(gs_texture_t *tex, uint32_t flip, uint32_t width,
 	else
 		build_sprite_norm(data, fcx, fcy, flip);
 
+	graphics->draw_stats.sprites++;
+	if (sprite_batch_add(graphics, data))
+		return;
+
 	gs_vertexbuffer_flush(graphics->sprite_buffer);
 	gs_load_vertexbuffer(graphics->sprite_buffer);
 	gs_load_indexbuffer(NULL);
@@ -1063,6 +1142,10 @@ void gs_draw_sprite_subregion(gs_texture_t *tex, uint32_t flip, uint32_t sub_x,
 	build_subsprite_norm(data, (float)sub_x, (float)sub_y, (float)sub_cx,
 			     (float)sub_cy, fcx, fcy, flip);
 
+	graphics->draw_stats.sprites++;
+	if (sprite_batch_add(graphics, data))
+		return;
+
 	gs_vertexbuffer_flush(graphics->sprite_buffer);
 	gs_load_vertexbuffer(graphics->sprite_buffer);
 	gs_load_indexbuffer(NULL);
@@ -1070,6 +1153,43 @@ void gs_draw_sprite_subregion(gs_texture_t *tex, uint32_t flip, uint32_t sub_x,
 	gs_draw(GS_TRISTRIP, 0, 0);
 }
 
+void gs_sprite_batch_begin(void)
+{
+	if (!gs_valid("gs_sprite_batch_begin"))
+		return;
+
+	thread_graphics->sprite_batch.depth++;
+}
+
+void gs_sprite_batch_end(void)
+{
+	graphics_t *graphics = thread_graphics;
+
+	if (!gs_valid("gs_sprite_batch_end"))
+		return;
+	if (!graphics->sprite_batch.depth)
+		return;
+
+	if (--graphics->sprite_batch.depth == 0)
+		flush_sprites(graphics);
+}
+
+void gs_sprite_batch_flush(void)
+{
+	if (!gs_valid("gs_sprite_batch_flush"))
+		return;
+
+	flush_sprites(thread_graphics);
+}
+
+void gs_get_draw_stats(struct gs_draw_stats *stats)
+{
+	if (!gs_valid_p("gs_get_draw_stats", stats))
+		return;
+
+	*stats = thread_graphics->draw_stats;
+}
+
 void gs_draw_cube_backdrop(gs_texture_t *cubetex, const struct quat *rot,
 			   float left, float right, float top, float bottom,
 			   float znear)
@@ -1593,6 +1713,7 @@ void gs_load_vertexbuffer(gs_vertbuffer_t *vertbuffer)
 	if (!gs_valid("gs_load_vertexbuffer"))
 		return;
 
+	graphics->cur_vertbuffer = vertbuffer;
 	graphics->exports.device_load_vertexbuffer(graphics->device,
 						   vertbuffer);
 }
@@ -1604,6 +1725,7 @@ void gs_load_indexbuffer(gs_indexbuffer_t *indexbuffer)
 	if (!gs_valid("gs_load_indexbuffer"))
 		return;
 
+	graphics->cur_indexbuffer = indexbuffer;
 	graphics->exports.device_load_indexbuffer(graphics->device,
 						  indexbuffer);
 }
@@ -1709,6 +1831,8 @@ void gs_set_render_target(gs_texture_t *tex, gs_zstencil_t *zstencil)
 	if (!gs_valid("gs_set_render_target"))
 		return;
 
+	flush_sprites(graphics);
+
 	graphics->exports.device_set_render_target(graphics->device, tex,
 						   zstencil);
 }
@@ -1721,6 +1845,8 @@ void gs_set_cube_render_target(gs_texture_t *cubetex, int side,
 	if (!gs_valid("gs_set_cube_render_target"))
 		return;
 
+	flush_sprites(graphics);
+
 	graphics->exports.device_set_cube_render_target(
 		graphics->device, cubetex, side, zstencil);
 }
@@ -1776,6 +1902,8 @@ void gs_copy_texture(gs_texture_t *dst, gs_texture_t *src)
 	if (!gs_valid_p2("gs_copy_texture", dst, src))
 		return;
 
+	flush_sprites(graphics);
+
 	graphics->exports.device_copy_texture(graphics->device, dst, src);
 }
 
@@ -1788,6 +1916,8 @@ void gs_copy_texture_region(gs_texture_t *dst, uint32_t dst_x, uint32_t dst_y,
 	if (!gs_valid_p("gs_copy_texture_region", dst))
 		return;
 
+	flush_sprites(graphics);
+
 	graphics->exports.device_copy_texture_region(graphics->device, dst,
 						     dst_x, dst_y, src, src_x,
 						     src_y, src_w, src_h);
@@ -1800,6 +1930,8 @@ void gs_stage_texture(gs_stagesurf_t *dst, gs_texture_t *src)
 	if (!gs_valid("gs_stage_texture"))
 		return;
 
+	flush_sprites(graphics);
+
 	graphics->exports.device_stage_texture(graphics->device, dst, src);
 }
 
@@ -1831,8 +1963,11 @@ void gs_draw(enum gs_draw_mode draw_mode, uint32_t start_vert,
 	if (!gs_valid("gs_draw"))
 		return;
 
+	flush_sprites(graphics);
+
 	graphics->exports.device_draw(graphics->device, draw_mode, start_vert,
 				      num_verts);
+	graphics->draw_stats.draw_calls++;
 }
 
 void gs_end_scene(void)
@@ -1842,6 +1977,8 @@ void gs_end_scene(void)
 	if (!gs_valid("gs_end_scene"))
 		return;
 
+	flush_sprites(graphics);
+
 	graphics->exports.device_end_scene(graphics->device);
 }
 
@@ -1852,6 +1989,8 @@ void gs_load_swapchain(gs_swapchain_t *swapchain)
 	if (!gs_valid("gs_load_swapchain"))
 		return;
 
+	flush_sprites(graphics);
+
 	graphics->exports.device_load_swapchain(graphics->device, swapchain);
 }
 
@@ -1863,6 +2002,8 @@ void gs_clear(uint32_t clear_flags, const struct vec4 *color, float depth,
 	if (!gs_valid("gs_clear"))
 		return;
 
+	flush_sprites(graphics);
+
 	graphics->exports.device_clear(graphics->device, clear_flags, color,
 				       depth, stencil);
 }
@@ -1874,6 +2015,8 @@ void gs_present(void)
 	if (!gs_valid("gs_present"))
 		return;
 
+	flush_sprites(graphics);
+
 	graphics->exports.device_present(graphics->device);
 }
 
@@ -1884,6 +2027,8 @@ void gs_flush(void)
 	if (!gs_valid("gs_flush"))
 		return;
 
+	flush_sprites(graphics);
+
 	graphics->exports.device_flush(graphics->device);
 }
 
@@ -1894,6 +2039,8 @@ void gs_set_cull_mode(enum gs_cull_mode mode)
 	if (!gs_valid("gs_set_cull_mode"))
 		return;
 
+	flush_sprites(graphics);
+
 	graphics->exports.device_set_cull_mode(graphics->device, mode);
 }
 
@@ -1925,6 +2072,8 @@ void gs_enable_depth_test(bool enable)
 	if (!gs_valid("gs_enable_depth_test"))
 		return;
 
+	flush_sprites(graphics);
+
 	graphics->exports.device_enable_depth_test(graphics->device, enable);
 }
 
@@ -1935,6 +2084,8 @@ void gs_enable_stencil_test(bool enable)
 	if (!gs_valid("gs_enable_stencil_test"))
 		return;
 
+	flush_sprites(graphics);
+
 	graphics->exports.device_enable_stencil_test(graphics->device, enable);
 }
 
@@ -1945,6 +2096,8 @@ void gs_enable_stencil_write(bool enable)
 	if (!gs_valid("gs_enable_stencil_write"))
 		return;
 
+	flush_sprites(graphics);
+
 	graphics->exports.device_enable_stencil_write(graphics->device, enable);
 }
 
@@ -1955,6 +2108,8 @@ void gs_enable_color(bool red, bool green, bool blue, bool alpha)
 	if (!gs_valid("gs_enable_color"))
 		return;
 
+	flush_sprites(graphics);
+
 	graphics->exports.device_enable_color(graphics->device, red, green,
 					      blue, alpha);
 }
@@ -1998,6 +2153,8 @@ void gs_depth_function(enum gs_depth_test test)
 	if (!gs_valid("gs_depth_function"))
 		return;
 
+	flush_sprites(graphics);
+
 	graphics->exports.device_depth_function(graphics->device, test);
 }
 
@@ -2008,6 +2165,8 @@ void gs_stencil_function(enum gs_stencil_side side, enum gs_depth_test test)
 	if (!gs_valid("gs_stencil_function"))
 		return;
 
+	flush_sprites(graphics);
+
 	graphics->exports.device_stencil_function(graphics->device, side, test);
 }
 
@@ -2019,6 +2178,8 @@ void gs_stencil_op(enum gs_stencil_side side, enum gs_stencil_op_type fail,
 	if (!gs_valid("gs_stencil_op"))
 		return;
 
+	flush_sprites(graphics);
+
 	graphics->exports.device_stencil_op(graphics->device, side, fail, zfail,
 					    zpass);
 }
@@ -2030,6 +2191,8 @@ void gs_set_viewport(int x, int y, int width, int height)
 	if (!gs_valid("gs_set_viewport"))
 		return;
 
+	flush_sprites(graphics);
+
 	graphics->exports.device_set_viewport(graphics->device, x, y, width,
 					      height);
 }
@@ -2051,6 +2214,8 @@ void gs_set_scissor_rect(const struct gs_rect *rect)
 	if (!gs_valid("gs_set_scissor_rect"))
 		return;
 
+	flush_sprites(graphics);
+
 	graphics->exports.device_set_scissor_rect(graphics->device, rect);
 }
 
@@ -2062,6 +2227,8 @@ void gs_ortho(float left, float right, float top, float bottom, float znear,
 	if (!gs_valid("gs_ortho"))
 		return;
 
+	flush_sprites(graphics);
+
 	graphics->exports.device_ortho(graphics->device, left, right, top,
 				       bottom, znear, zfar);
 }
@@ -2074,6 +2241,8 @@ void gs_frustum(float left, float right, float top, float bottom, float znear,
 	if (!gs_valid("gs_frustum"))
 		return;
 
+	flush_sprites(graphics);
+
 	graphics->exports.device_frustum(graphics->device, left, right, top,
 					 bottom, znear, zfar);
 }
@@ -2095,6 +2264,8 @@ void gs_projection_pop(void)
 	if (!gs_valid("gs_projection_pop"))
 		return;
 
+	flush_sprites(graphics);
+
 	graphics->exports.device_projection_pop(graphics->device);
 }
 
@@ -2312,6 +2483,8 @@ void gs_texture_destroy(gs_texture_t *tex)
 	if (!tex)
 		return;
 
+	flush_sprites(graphics);
+
 	graphics->exports.gs_texture_destroy(tex);
 }
 
@@ -2352,6 +2525,8 @@ bool gs_texture_map(gs_texture_t *tex, uint8_t **ptr, uint32_t *linesize)
 	if (!gs_valid_p3("gs_texture_map", tex, ptr, linesize))
 		return false;
 
+	flush_sprites(graphics);
+
 	return graphics->exports.gs_texture_map(tex, ptr, linesize);
 }
 
@@ -2397,6 +2572,8 @@ void gs_cubetexture_destroy(gs_texture_t *cubetex)
 	if (!cubetex)
 		return;
 
+	flush_sprites(graphics);
+
 	graphics->exports.gs_cubetexture_destroy(cubetex);
 }
 
@@ -2430,6 +2607,8 @@ void gs_voltexture_destroy(gs_texture_t *voltex)
 	if (!voltex)
 		return;
 
+	flush_sprites(graphics);
+
 	graphics->exports.gs_voltexture_destroy(voltex);
 }
 
@@ -2524,6 +2703,8 @@ bool gs_stagesurface_map(gs_stagesurf_t *stagesurf, uint8_t **data,
 	if (!gs_valid_p3("gs_stagesurface_map", stagesurf, data, linesize))
 		return 0;
 
+	flush_sprites(graphics);
+
 	return graphics->exports.gs_stagesurface_map(stagesurf, data, linesize);
 }
 
@@ -2554,6 +2735,8 @@ void gs_samplerstate_destroy(gs_samplerstate_t *samplerstate)
 	if (!samplerstate)
 		return;
 
+	flush_sprites(thread_graphics);
+
 	thread_graphics->exports.gs_samplerstate_destroy(samplerstate);
 }
 
@@ -2566,6 +2749,8 @@ void gs_vertexbuffer_destroy(gs_vertbuffer_t *vertbuffer)
 	if (!vertbuffer)
 		return;
 
+	if (graphics->cur_vertbuffer == vertbuffer)
+		graphics->cur_vertbuffer = NULL;
 	graphics->exports.gs_vertexbuffer_destroy(vertbuffer);
 }
 
@@ -2603,6 +2788,8 @@ void gs_indexbuffer_destroy(gs_indexbuffer_t *indexbuffer)
 	if (!indexbuffer)
 		return;
 
+	if (graphics->cur_indexbuffer == indexbuffer)
+		graphics->cur_indexbuffer = NULL;
 	graphics->exports.gs_indexbuffer_destroy(indexbuffer);
 }
 
@@ -2669,6 +2856,8 @@ void gs_timer_begin(gs_timer_t *timer)
 	if (!timer)
 		return;
 
+	flush_sprites(graphics);
+
 	graphics->exports.gs_timer_begin(timer);
 }
 
@@ -2681,6 +2870,8 @@ void gs_timer_end(gs_timer_t *timer)
 	if (!timer)
 		return;
 
+	flush_sprites(graphics);
+
 	graphics->exports.gs_timer_end(timer);
 }
 
@@ -2713,6 +2904,8 @@ void gs_timer_range_begin(gs_timer_range_t *range)
 	if (!range)
 		return;
 
+	flush_sprites(graphics);
+
 	graphics->exports.gs_timer_range_begin(range);
 }
 
@@ -2725,6 +2918,8 @@ void gs_timer_range_end(gs_timer_range_t *range)
 	if (!range)
 		return;
 
+	flush_sprites(graphics);
+
 	graphics->exports.gs_timer_range_end(range);
 }
 
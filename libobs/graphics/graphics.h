@@ -283,6 +283,7 @@ typedef struct gs_effect_technique gs_technique_t;
 typedef struct gs_effect_pass gs_epass_t;
 typedef struct gs_effect_param gs_eparam_t;
 typedef struct gs_device gs_device_t;
+typedef struct gs_upload_buffer gs_upload_buffer_t;
 typedef struct graphics_subsystem graphics_t;
 
 /* ---------------------------------------------------
@@ -400,6 +401,24 @@ EXPORT gs_eparam_t *gs_effect_get_param_by_idx(const gs_effect_t *effect,
 					       size_t param);
 EXPORT gs_eparam_t *gs_effect_get_param_by_name(const gs_effect_t *effect,
 						const char *name);
+
+/**
+ * Parameter name that resolves to a parameter handle once per effect.  Keep
+ * keys in static storage and look parameters up with
+ * gs_effect_get_param_by_key on hot paths:
+ *
+ *   static struct gs_effect_param_key image = GS_EFFECT_PARAM_KEY("image");
+ *   gs_effect_set_texture(gs_effect_get_param_by_key(effect, &image), tex);
+ */
+struct gs_effect_param_key {
+	const char *name;
+	volatile long id;
+};
+
+#define GS_EFFECT_PARAM_KEY(name) {name, 0}
+
+EXPORT gs_eparam_t *gs_effect_get_param_by_key(gs_effect_t *effect,
+					       struct gs_effect_param_key *key);
 EXPORT size_t gs_param_get_num_annotations(const gs_eparam_t *param);
 EXPORT gs_eparam_t *gs_param_get_annotation_by_idx(const gs_eparam_t *param,
 						   size_t annotation);
@@ -501,6 +520,7 @@ struct gs_init_data {
 
 #define GS_DEVICE_OPENGL 1
 #define GS_DEVICE_DIRECT3D_11 2
+#define GS_DEVICE_SOFTWARE 3
 
 EXPORT const char *gs_get_device_name(void);
 EXPORT int gs_get_device_type(void);
@@ -554,6 +574,28 @@ EXPORT gs_effect_t *gs_effect_create_from_file(const char *file,
 EXPORT gs_effect_t *gs_effect_create(const char *effect_string,
 				     const char *filename, char **error_string);
 
+struct gs_shader_cache_stats {
+	/* parsed effects (libobs) */
+	uint32_t effect_hits;
+	uint32_t effect_misses;
+	uint32_t effect_writes;
+	uint64_t effect_load_time_ns;
+
+	/* linked shader programs (graphics module, if supported) */
+	uint32_t program_hits;
+	uint32_t program_misses;
+	uint32_t program_writes;
+	uint32_t compiles_skipped;
+};
+
+/**
+ * Sets the directory compiled effects (and, when the graphics module
+ * supports it, program binaries) are cached in.  Pass NULL to disable the
+ * cache.  Should be called before any effects are loaded.
+ */
+EXPORT void gs_set_shader_cache_path(const char *path);
+EXPORT void gs_get_shader_cache_stats(struct gs_shader_cache_stats *stats);
+
 EXPORT gs_shader_t *gs_vertexshader_create_from_file(const char *file,
 						     char **error_string);
 EXPORT gs_shader_t *gs_pixelshader_create_from_file(const char *file,
@@ -590,6 +632,49 @@ EXPORT void gs_draw_sprite_subregion(gs_texture_t *tex, uint32_t flip,
 				     uint32_t x, uint32_t y, uint32_t cx,
 				     uint32_t cy);
 
+/**
+ * Sprite batching
+ *
+ *   While a batch is open, consecutive sprites drawn with the same effect
+ * pass, effect parameter values, blend state and framebuffer sRGB state are
+ * merged into a single draw call.  Matrix changes do not break a batch, any
+ * other state change flushes it.  Batches can be nested, the pending sprites
+ * are drawn at the latest when the outermost batch ends.
+ */
+EXPORT void gs_sprite_batch_begin(void);
+EXPORT void gs_sprite_batch_end(void);
+EXPORT void gs_sprite_batch_flush(void);
+
+struct gs_draw_stats {
+	uint64_t draw_calls;
+	uint64_t sprites;
+	uint64_t batched_sprites;
+};
+
+EXPORT void gs_get_draw_stats(struct gs_draw_stats *stats);
+
+/**
+ * Shared texture atlas
+ *
+ *   Packs a small static image into a texture shared with other images of the
+ * same format, so sprites of different images can still be batched.  Returns
+ * NULL if the image is too large or its format cannot be packed.  New images
+ * are uploaded once the texture of their page is next retrieved or drawn.
+ */
+typedef struct gs_atlas_region gs_atlas_region_t;
+
+EXPORT gs_atlas_region_t *gs_atlas_region_create(enum gs_color_format format,
+						 uint32_t cx, uint32_t cy,
+						 const uint8_t *data,
+						 uint32_t linesize);
+EXPORT void gs_atlas_region_destroy(gs_atlas_region_t *region);
+EXPORT gs_texture_t *
+gs_atlas_region_get_texture(const gs_atlas_region_t *region);
+
+/** Draws the image of an atlas region at its original size */
+EXPORT void gs_draw_atlas_region(const gs_atlas_region_t *region,
+				 uint32_t flip);
+
 EXPORT void gs_draw_cube_backdrop(gs_texture_t *cubetex, const struct quat *rot,
 				  float left, float right, float top,
 				  float bottom, float znear);
@@ -611,6 +696,42 @@ EXPORT void gs_cubetexture_set_image(gs_texture_t *cubetex, uint32_t side,
 				     const void *data, uint32_t linesize,
 				     bool invert);
 
+/**
+ * Upload rings
+ *
+ *   A ring of persistently mapped upload buffers, for graphics modules that
+ * support them.  A slot can be acquired and filled with pixel data on any
+ * thread without entering the graphics context.  The graphics thread then
+ * only copies it into textures and submits it, after which the slot becomes
+ * free again once the GPU has finished reading from it.
+ *
+ *   gs_upload_ring_create returns NULL if the graphics module has no support
+ * for upload buffers, in which case gs_texture_set_image should be used.
+ */
+typedef struct gs_upload_ring gs_upload_ring_t;
+
+EXPORT gs_upload_ring_t *gs_upload_ring_create(size_t slot_size,
+					       uint32_t num_slots);
+EXPORT void gs_upload_ring_destroy(gs_upload_ring_t *ring);
+EXPORT size_t gs_upload_ring_get_slot_size(const gs_upload_ring_t *ring);
+
+/** Returns the data of a free slot, or NULL if all slots are in use.  Can be
+ * called from any thread. */
+EXPORT uint8_t *gs_upload_ring_acquire(gs_upload_ring_t *ring,
+				       uint32_t *slot);
+/** Frees a slot without uploading it.  Can be called from any thread. */
+EXPORT void gs_upload_ring_release(gs_upload_ring_t *ring, uint32_t slot);
+
+EXPORT bool gs_texture_set_image_from_ring(gs_texture_t *tex,
+					   gs_upload_ring_t *ring,
+					   uint32_t slot, size_t offset,
+					   uint32_t linesize);
+/** Marks a slot as in use by the GPU until the uploads from it are done */
+EXPORT void gs_upload_ring_submit(gs_upload_ring_t *ring, uint32_t slot);
+/** Frees the slots the GPU has finished reading from.  Should be called
+ * once per frame whether or not anything was submitted. */
+EXPORT void gs_upload_ring_reclaim(gs_upload_ring_t *ring);
+
 EXPORT void gs_perspective(float fovy, float aspect, float znear, float zfar);
 
 EXPORT void gs_blend_state_push(void);
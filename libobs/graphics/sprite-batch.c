@@ -0,0 +1,270 @@
+/******************************************************************************
+    Copyright (C) 2021 by Hugh Bailey <obs.jim@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include "graphics-internal.h"
+#include "effect.h"
+#include "vec2.h"
+
+/*
+ * Sprite batching
+ *
+ * Sprites drawn while a batch is open are not drawn right away.  Their
+ * vertices are transformed by the current matrix on the CPU and appended to
+ * a shared vertex buffer, along with a snapshot of the effect parameters of
+ * the pass they were drawn with.  As long as the following sprites use the
+ * same pass, parameter values, blend state and sRGB state they are appended
+ * as well, and the whole run is drawn with a single draw call once something
+ * incompatible comes along.
+ *
+ * Device state that is not part of the snapshot (render target, viewport,
+ * projection, scissor, depth/stencil state, texture contents...) flushes the
+ * batch in graphics.c before it is changed.
+ */
+
+#define VERTS_PER_SPRITE 6
+
+bool sprite_batch_init(struct graphics_subsystem *graphics)
+{
+	struct gs_vb_data *vbd;
+	size_t num = SPRITE_BATCH_MAX * VERTS_PER_SPRITE;
+
+	vbd = gs_vbdata_create();
+	vbd->num = num;
+	vbd->points = bzalloc(sizeof(struct vec3) * num);
+	vbd->num_tex = 1;
+	vbd->tvarray = bzalloc(sizeof(struct gs_tvertarray));
+	vbd->tvarray[0].width = 2;
+	vbd->tvarray[0].array = bzalloc(sizeof(struct vec2) * num);
+
+	graphics->sprite_batch.vertbuffer =
+		graphics->exports.device_vertexbuffer_create(graphics->device,
+							     vbd, GS_DYNAMIC);
+	return graphics->sprite_batch.vertbuffer != NULL;
+}
+
+void sprite_batch_free(struct graphics_subsystem *graphics)
+{
+	struct sprite_batch *batch = &graphics->sprite_batch;
+
+	if (batch->vertbuffer)
+		graphics->exports.gs_vertexbuffer_destroy(batch->vertbuffer);
+	da_free(batch->params);
+	da_free(batch->scratch);
+	memset(batch, 0, sizeof(*batch));
+}
+
+/* ------------------------------------------------------------------------- */
+
+static void snapshot_params(struct darray *dst, const struct darray *params)
+{
+	const struct pass_shaderparam *pass_params = params->array;
+
+	for (size_t i = 0; i < params->num; i++) {
+		const struct gs_effect_param *eparam = pass_params[i].eparam;
+		const void *val = eparam->cur_val.array;
+		size_t size = eparam->cur_val.num;
+
+		if (!size) {
+			val = eparam->default_val.array;
+			size = eparam->default_val.num;
+		}
+
+		darray_push_back_array(sizeof(uint8_t), dst, &size,
+				       sizeof(size));
+		darray_push_back_array(sizeof(uint8_t), dst, val, size);
+		darray_push_back_array(sizeof(uint8_t), dst,
+				       &eparam->next_sampler,
+				       sizeof(eparam->next_sampler));
+	}
+}
+
+static const uint8_t *upload_params(const struct darray *params,
+				    const uint8_t *data)
+{
+	const struct pass_shaderparam *pass_params = params->array;
+
+	for (size_t i = 0; i < params->num; i++) {
+		gs_sparam_t *sparam = pass_params[i].sparam;
+		gs_samplerstate_t *sampler;
+		size_t size;
+
+		memcpy(&size, data, sizeof(size));
+		data += sizeof(size);
+
+		if (size)
+			gs_shader_set_val(sparam, data, size);
+		data += size;
+
+		memcpy(&sampler, data, sizeof(sampler));
+		data += sizeof(sampler);
+
+		if (sampler)
+			gs_shader_set_next_sampler(sparam, sampler);
+	}
+
+	return data;
+}
+
+static inline bool blend_equal(const struct blend_state *a,
+			       const struct blend_state *b)
+{
+	return a->enabled == b->enabled && a->src_c == b->src_c &&
+	       a->dest_c == b->dest_c && a->src_a == b->src_a &&
+	       a->dest_a == b->dest_a;
+}
+
+static inline bool batch_compatible(struct graphics_subsystem *graphics,
+				    struct gs_effect *effect, bool srgb)
+{
+	struct sprite_batch *batch = &graphics->sprite_batch;
+
+	return batch->num < SPRITE_BATCH_MAX && batch->effect == effect &&
+	       batch->pass == effect->cur_pass && batch->srgb == srgb &&
+	       blend_equal(&batch->blend, &graphics->cur_blend_state) &&
+	       batch->params.num == batch->scratch.num &&
+	       memcmp(batch->params.array, batch->scratch.array,
+		      batch->params.num) == 0;
+}
+
+bool sprite_batch_add(struct graphics_subsystem *graphics,
+		      const struct gs_vb_data *sprite)
+{
+	static const size_t order[VERTS_PER_SPRITE] = {0, 1, 2, 2, 1, 3};
+	struct sprite_batch *batch = &graphics->sprite_batch;
+	struct gs_effect *effect = graphics->cur_effect;
+	const struct vec2 *uvs = sprite->tvarray[0].array;
+	struct gs_vb_data *data;
+	struct vec2 *tvarray;
+	struct matrix4 world;
+	size_t start;
+	bool srgb;
+
+	if (!batch->depth || batch->flushing || !batch->vertbuffer)
+		return false;
+	if (!effect || !effect->cur_pass)
+		return false;
+
+	srgb = graphics->exports.device_framebuffer_srgb_enabled(
+		graphics->device);
+
+	da_resize(batch->scratch, 0);
+	snapshot_params(&batch->scratch.da,
+			&effect->cur_pass->vertshader_params.da);
+	snapshot_params(&batch->scratch.da,
+			&effect->cur_pass->pixelshader_params.da);
+
+	if (batch->num && !batch_compatible(graphics, effect, srgb))
+		sprite_batch_flush(graphics);
+
+	if (!batch->num) {
+		batch->effect = effect;
+		batch->pass = effect->cur_pass;
+		batch->blend = graphics->cur_blend_state;
+		batch->srgb = srgb;
+		da_move(batch->params, batch->scratch);
+	}
+
+	gs_matrix_get(&world);
+
+	data = gs_vertexbuffer_get_data(batch->vertbuffer);
+	tvarray = data->tvarray[0].array;
+	start = batch->num * VERTS_PER_SPRITE;
+
+	for (size_t i = 0; i < VERTS_PER_SPRITE; i++) {
+		size_t idx = order[i];
+
+		vec3_transform(data->points + start + i, sprite->points + idx,
+			       &world);
+		tvarray[start + i] = uvs[idx];
+	}
+
+	batch->num++;
+	graphics->draw_stats.batched_sprites++;
+	return true;
+}
+
+static inline void set_blend_state(const struct blend_state *state)
+{
+	gs_enable_blending(state->enabled);
+	gs_blend_function_separate(state->src_c, state->dest_c, state->src_a,
+				   state->dest_a);
+}
+
+void sprite_batch_flush(struct graphics_subsystem *graphics)
+{
+	struct sprite_batch *batch = &graphics->sprite_batch;
+	struct gs_effect *cur_effect = graphics->cur_effect;
+	struct blend_state prev_blend = graphics->cur_blend_state;
+	gs_vertbuffer_t *prev_vb = graphics->cur_vertbuffer;
+	gs_indexbuffer_t *prev_ib = graphics->cur_indexbuffer;
+	gs_shader_t *prev_vs;
+	gs_shader_t *prev_ps;
+	const uint8_t *params;
+	uint32_t num_verts;
+	bool prev_srgb;
+
+	if (!batch->num || batch->flushing)
+		return;
+
+	batch->flushing = true;
+
+	prev_vs = gs_get_vertex_shader();
+	prev_ps = gs_get_pixel_shader();
+	prev_srgb = gs_framebuffer_srgb_enabled();
+
+	gs_load_vertexshader(batch->pass->vertshader);
+	gs_load_pixelshader(batch->pass->pixelshader);
+
+	params = batch->params.array;
+	params = upload_params(&batch->pass->vertshader_params.da, params);
+	upload_params(&batch->pass->pixelshader_params.da, params);
+
+	set_blend_state(&batch->blend);
+	gs_enable_framebuffer_srgb(batch->srgb);
+
+	gs_vertexbuffer_flush(batch->vertbuffer);
+	gs_load_vertexbuffer(batch->vertbuffer);
+	gs_load_indexbuffer(NULL);
+
+	/* the vertices are already transformed, and the current effect must
+	 * not upload its own parameters over the ones of the batch */
+	gs_matrix_push();
+	gs_matrix_identity();
+	graphics->cur_effect = NULL;
+
+	num_verts = (uint32_t)(batch->num * VERTS_PER_SPRITE);
+	graphics->exports.device_draw(graphics->device, GS_TRIS, 0, num_verts);
+	graphics->draw_stats.draw_calls++;
+
+	graphics->cur_effect = cur_effect;
+	gs_matrix_pop();
+
+	gs_load_vertexbuffer(prev_vb);
+	gs_load_indexbuffer(prev_ib);
+	gs_enable_framebuffer_srgb(prev_srgb);
+	set_blend_state(&prev_blend);
+	gs_load_vertexshader(prev_vs);
+	gs_load_pixelshader(prev_ps);
+
+	if (cur_effect && cur_effect->cur_pass)
+		effect_upload_params(cur_effect, false);
+
+	batch->num = 0;
+	batch->effect = NULL;
+	batch->pass = NULL;
+	batch->flushing = false;
+}
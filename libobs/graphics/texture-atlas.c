@@ -0,0 +1,304 @@
+/******************************************************************************
+    Copyright (C) 2021 by Hugh Bailey <obs.jim@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include "graphics-internal.h"
+
+/*
+ * Texture atlas
+ *
+ * Small images are packed into shared pages with a simple shelf allocator.
+ * Every image gets a one pixel border that repeats its edge pixels so that
+ * linear filtering never picks up a neighboring image.  Space is not reused
+ * until every region of a page has been destroyed, at which point the page
+ * is freed.  Pages keep a copy of their pixels; regions created since a page
+ * was last used are uploaded together before it is drawn, and only the
+ * rectangle around them is sent to the GPU.
+ */
+
+#define ATLAS_PAGE_SIZE 1024
+#define ATLAS_MAX_IMAGE_SIZE 256
+#define ATLAS_PADDING 1
+
+struct atlas_shelf {
+	uint32_t y;
+	uint32_t height;
+	uint32_t used;
+};
+
+struct atlas_page {
+	enum gs_color_format format;
+	gs_texture_t *texture;
+	uint8_t *data;
+
+	DARRAY(struct atlas_shelf) shelves;
+	uint32_t used_height;
+	size_t regions;
+
+	bool dirty;
+	uint32_t dirty_x0;
+	uint32_t dirty_y0;
+	uint32_t dirty_x1;
+	uint32_t dirty_y1;
+};
+
+struct gs_atlas_region {
+	struct atlas_page *page;
+	uint32_t x;
+	uint32_t y;
+	uint32_t cx;
+	uint32_t cy;
+};
+
+static void atlas_page_destroy(struct atlas_page *page)
+{
+	gs_texture_destroy(page->texture);
+	da_free(page->shelves);
+	bfree(page->data);
+	bfree(page);
+}
+
+void texture_atlas_free(struct graphics_subsystem *graphics)
+{
+	for (size_t i = 0; i < graphics->atlas_pages.num; i++)
+		atlas_page_destroy(graphics->atlas_pages.array[i]);
+	da_free(graphics->atlas_pages);
+}
+
+static struct atlas_page *atlas_page_create(enum gs_color_format format)
+{
+	struct atlas_page *page = bzalloc(sizeof(struct atlas_page));
+
+	page->format = format;
+	page->data = bzalloc(ATLAS_PAGE_SIZE * ATLAS_PAGE_SIZE * 4);
+	page->texture = gs_texture_create(ATLAS_PAGE_SIZE, ATLAS_PAGE_SIZE,
+					  format, 1, NULL, 0);
+	if (!page->texture) {
+		atlas_page_destroy(page);
+		return NULL;
+	}
+
+	return page;
+}
+
+/* places a block in the shelf that wastes the least height, or starts a new
+ * shelf below the last one */
+static bool atlas_page_alloc(struct atlas_page *page, uint32_t cx, uint32_t cy,
+			     uint32_t *x, uint32_t *y)
+{
+	struct atlas_shelf *best = NULL;
+
+	for (size_t i = 0; i < page->shelves.num; i++) {
+		struct atlas_shelf *shelf = page->shelves.array + i;
+
+		if (shelf->height < cy || ATLAS_PAGE_SIZE - shelf->used < cx)
+			continue;
+		if (!best || shelf->height < best->height)
+			best = shelf;
+	}
+
+	if (!best) {
+		if (ATLAS_PAGE_SIZE - page->used_height < cy)
+			return false;
+
+		best = da_push_back_new(page->shelves);
+		best->y = page->used_height;
+		best->height = cy;
+		page->used_height += cy;
+	}
+
+	*x = best->used;
+	*y = best->y;
+	best->used += cx;
+	return true;
+}
+
+static inline uint32_t clamp_coord(int64_t val, uint32_t size)
+{
+	if (val < 0)
+		return 0;
+	return val >= (int64_t)size ? size - 1 : (uint32_t)val;
+}
+
+static void copy_padded(struct atlas_page *page, const uint8_t *data,
+			uint32_t linesize, const struct gs_atlas_region *region)
+{
+	const uint32_t page_linesize = ATLAS_PAGE_SIZE * 4;
+	const int64_t pad = ATLAS_PADDING;
+
+	for (int64_t row = -pad; row < (int64_t)region->cy + pad; row++) {
+		const uint8_t *src =
+			data + clamp_coord(row, region->cy) * linesize;
+		uint8_t *dst = page->data +
+			       (size_t)(region->y + row) * page_linesize +
+			       (size_t)(region->x - pad) * 4;
+
+		memcpy(dst, src, 4);
+		memcpy(dst + 4, src, region->cx * 4);
+		memcpy(dst + (region->cx + 1) * 4,
+		       src + (region->cx - 1) * 4, 4);
+	}
+}
+
+static void mark_dirty(struct atlas_page *page,
+		       const struct gs_atlas_region *region)
+{
+	uint32_t x0 = region->x - ATLAS_PADDING;
+	uint32_t y0 = region->y - ATLAS_PADDING;
+	uint32_t x1 = region->x + region->cx + ATLAS_PADDING;
+	uint32_t y1 = region->y + region->cy + ATLAS_PADDING;
+
+	if (!page->dirty) {
+		page->dirty_x0 = x0;
+		page->dirty_y0 = y0;
+		page->dirty_x1 = x1;
+		page->dirty_y1 = y1;
+		page->dirty = true;
+		return;
+	}
+
+	if (x0 < page->dirty_x0)
+		page->dirty_x0 = x0;
+	if (y0 < page->dirty_y0)
+		page->dirty_y0 = y0;
+	if (x1 > page->dirty_x1)
+		page->dirty_x1 = x1;
+	if (y1 > page->dirty_y1)
+		page->dirty_y1 = y1;
+}
+
+/* uploads the dirty rectangle of the page to a temporary texture and copies
+ * it into the page on the GPU */
+static void atlas_page_flush(struct atlas_page *page)
+{
+	const uint32_t page_linesize = ATLAS_PAGE_SIZE * 4;
+	uint32_t cx = page->dirty_x1 - page->dirty_x0;
+	uint32_t cy = page->dirty_y1 - page->dirty_y0;
+	const uint8_t *src = page->data + page->dirty_y0 * page_linesize +
+			     page->dirty_x0 * 4;
+	uint8_t *packed = NULL;
+	gs_texture_t *tex;
+
+	if (!page->dirty)
+		return;
+
+	if (cx != ATLAS_PAGE_SIZE) {
+		packed = bmalloc((size_t)cx * cy * 4);
+
+		for (uint32_t y = 0; y < cy; y++)
+			memcpy(packed + (size_t)y * cx * 4,
+			       src + (size_t)y * page_linesize, cx * 4);
+		src = packed;
+	}
+
+	tex = gs_texture_create(cx, cy, page->format, 1, &src, 0);
+	if (tex) {
+		gs_copy_texture_region(page->texture, page->dirty_x0,
+				       page->dirty_y0, tex, 0, 0, cx, cy);
+		gs_texture_destroy(tex);
+	}
+
+	bfree(packed);
+	page->dirty = false;
+}
+
+gs_atlas_region_t *gs_atlas_region_create(enum gs_color_format format,
+					  uint32_t cx, uint32_t cy,
+					  const uint8_t *data,
+					  uint32_t linesize)
+{
+	graphics_t *graphics = gs_get_context();
+	struct gs_atlas_region *region;
+	struct atlas_page *page = NULL;
+	uint32_t x = 0, y = 0;
+
+	if (!graphics || !data || !cx || !cy)
+		return NULL;
+	if (cx > ATLAS_MAX_IMAGE_SIZE || cy > ATLAS_MAX_IMAGE_SIZE)
+		return NULL;
+	if (gs_is_compressed_format(format) || gs_get_format_bpp(format) != 32)
+		return NULL;
+
+	for (size_t i = 0; i < graphics->atlas_pages.num; i++) {
+		struct atlas_page *cur = graphics->atlas_pages.array[i];
+
+		if (cur->format == format &&
+		    atlas_page_alloc(cur, cx + ATLAS_PADDING * 2,
+				     cy + ATLAS_PADDING * 2, &x, &y)) {
+			page = cur;
+			break;
+		}
+	}
+
+	if (!page) {
+		page = atlas_page_create(format);
+		if (!page)
+			return NULL;
+
+		da_push_back(graphics->atlas_pages, &page);
+		atlas_page_alloc(page, cx + ATLAS_PADDING * 2,
+				 cy + ATLAS_PADDING * 2, &x, &y);
+	}
+
+	region = bzalloc(sizeof(struct gs_atlas_region));
+	region->page = page;
+	region->x = x + ATLAS_PADDING;
+	region->y = y + ATLAS_PADDING;
+	region->cx = cx;
+	region->cy = cy;
+	page->regions++;
+
+	copy_padded(page, data, linesize, region);
+	mark_dirty(page, region);
+	return region;
+}
+
+void gs_atlas_region_destroy(gs_atlas_region_t *region)
+{
+	graphics_t *graphics = gs_get_context();
+	struct atlas_page *page;
+
+	if (!region)
+		return;
+
+	page = region->page;
+	bfree(region);
+
+	if (--page->regions > 0 || !graphics)
+		return;
+
+	da_erase_item(graphics->atlas_pages, &page);
+	atlas_page_destroy(page);
+}
+
+gs_texture_t *gs_atlas_region_get_texture(const gs_atlas_region_t *region)
+{
+	if (!region)
+		return NULL;
+
+	atlas_page_flush(region->page);
+	return region->page->texture;
+}
+
+void gs_draw_atlas_region(const gs_atlas_region_t *region, uint32_t flip)
+{
+	if (!region)
+		return;
+
+	atlas_page_flush(region->page);
+	gs_draw_sprite_subregion(region->page->texture, flip, region->x,
+				 region->y, region->cx, region->cy);
+}
@@ -0,0 +1,187 @@
+/******************************************************************************
+    Copyright (C) 2021 by Hugh Bailey <obs.jim@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include "../util/threading.h"
+#include "graphics-internal.h"
+
+/*
+ * Upload rings
+ *
+ * Every slot is one upload buffer of the graphics module.  Slots move from
+ * free to filling when a producer acquires them, and from filling to in
+ * flight when the graphics thread submits them.  Fences are only checked on
+ * the graphics thread, which returns signaled slots to the free state once
+ * per frame and whenever a slot of the ring is submitted.
+ */
+
+enum slot_state {
+	SLOT_FREE,
+	SLOT_FILLING,
+	SLOT_IN_FLIGHT,
+};
+
+struct upload_slot {
+	gs_upload_buffer_t *buffer;
+	uint8_t *data;
+	volatile long state;
+};
+
+struct gs_upload_ring {
+	graphics_t *graphics;
+	size_t slot_size;
+	uint32_t num_slots;
+	struct upload_slot *slots;
+};
+
+static inline bool upload_buffers_available(graphics_t *graphics)
+{
+	return graphics->exports.device_upload_buffer_create &&
+	       graphics->exports.gs_upload_buffer_destroy &&
+	       graphics->exports.gs_upload_buffer_get_data &&
+	       graphics->exports.device_texture_set_image_from_buffer &&
+	       graphics->exports.device_upload_buffer_fence &&
+	       graphics->exports.device_upload_buffer_signaled;
+}
+
+gs_upload_ring_t *gs_upload_ring_create(size_t slot_size, uint32_t num_slots)
+{
+	graphics_t *graphics = gs_get_context();
+	struct gs_upload_ring *ring;
+
+	if (!graphics || !slot_size || !num_slots)
+		return NULL;
+	if (!upload_buffers_available(graphics))
+		return NULL;
+
+	ring = bzalloc(sizeof(struct gs_upload_ring));
+	ring->graphics = graphics;
+	ring->slot_size = slot_size;
+	ring->num_slots = num_slots;
+	ring->slots = bzalloc(sizeof(struct upload_slot) * num_slots);
+
+	for (uint32_t i = 0; i < num_slots; i++) {
+		struct upload_slot *slot = ring->slots + i;
+
+		slot->buffer = graphics->exports.device_upload_buffer_create(
+			graphics->device, slot_size);
+		if (!slot->buffer) {
+			gs_upload_ring_destroy(ring);
+			return NULL;
+		}
+
+		slot->data = graphics->exports.gs_upload_buffer_get_data(
+			slot->buffer);
+	}
+
+	return ring;
+}
+
+void gs_upload_ring_destroy(gs_upload_ring_t *ring)
+{
+	if (!ring)
+		return;
+
+	for (uint32_t i = 0; i < ring->num_slots; i++) {
+		if (ring->slots[i].buffer)
+			ring->graphics->exports.gs_upload_buffer_destroy(
+				ring->slots[i].buffer);
+	}
+
+	bfree(ring->slots);
+	bfree(ring);
+}
+
+size_t gs_upload_ring_get_slot_size(const gs_upload_ring_t *ring)
+{
+	return ring ? ring->slot_size : 0;
+}
+
+uint8_t *gs_upload_ring_acquire(gs_upload_ring_t *ring, uint32_t *slot)
+{
+	if (!ring || !slot)
+		return NULL;
+
+	for (uint32_t i = 0; i < ring->num_slots; i++) {
+		struct upload_slot *cur = ring->slots + i;
+
+		if (os_atomic_compare_swap_long(&cur->state, SLOT_FREE,
+						SLOT_FILLING)) {
+			*slot = i;
+			return cur->data;
+		}
+	}
+
+	return NULL;
+}
+
+void gs_upload_ring_release(gs_upload_ring_t *ring, uint32_t slot)
+{
+	if (!ring || slot >= ring->num_slots)
+		return;
+
+	os_atomic_compare_swap_long(&ring->slots[slot].state, SLOT_FILLING,
+				    SLOT_FREE);
+}
+
+bool gs_texture_set_image_from_ring(gs_texture_t *tex, gs_upload_ring_t *ring,
+				    uint32_t slot, size_t offset,
+				    uint32_t linesize)
+{
+	graphics_t *graphics = gs_get_context();
+
+	if (!graphics || !tex || !ring || slot >= ring->num_slots)
+		return false;
+
+	flush_sprites(graphics);
+
+	return graphics->exports.device_texture_set_image_from_buffer(
+		graphics->device, tex, ring->slots[slot].buffer, offset,
+		linesize);
+}
+
+void gs_upload_ring_reclaim(gs_upload_ring_t *ring)
+{
+	graphics_t *graphics = gs_get_context();
+
+	if (!graphics || !ring)
+		return;
+
+	for (uint32_t i = 0; i < ring->num_slots; i++) {
+		struct upload_slot *cur = ring->slots + i;
+
+		if (os_atomic_load_long(&cur->state) != SLOT_IN_FLIGHT)
+			continue;
+
+		if (graphics->exports.device_upload_buffer_signaled(
+			    graphics->device, cur->buffer))
+			os_atomic_set_long(&cur->state, SLOT_FREE);
+	}
+}
+
+void gs_upload_ring_submit(gs_upload_ring_t *ring, uint32_t slot)
+{
+	graphics_t *graphics = gs_get_context();
+
+	if (!graphics || !ring || slot >= ring->num_slots)
+		return;
+
+	gs_upload_ring_reclaim(ring);
+
+	graphics->exports.device_upload_buffer_fence(
+		graphics->device, ring->slots[slot].buffer);
+	os_atomic_set_long(&ring->slots[slot].state, SLOT_IN_FLIGHT);
+}
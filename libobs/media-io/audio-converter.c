@@ -0,0 +1,769 @@
+/******************************************************************************
+    Copyright (C) 2021 by Hugh Bailey <obs.jim@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include <math.h>
+#include <string.h>
+
+#include "../util/bmem.h"
+#include "../util/sse-intrin.h"
+#include "audio-converter.h"
+
+/*
+ * Input is converted BLOCK_FRAMES frames at a time: the samples of a block
+ * are converted to float planes, and every output channel is then computed
+ * from the planes with its row of the remix matrix.  Gains and the mono
+ * downmix are folded into the matrix, so applying them costs nothing.
+ *
+ * Different sample rates are converted with a polyphase windowed sinc filter.
+ * With the ratio of the rates reduced to out/in = up/down, the filter has up
+ * phases with taps coefficients each, so only ratios with up <= MAX_PHASES
+ * are supported.  Remixed input is appended to a history that keeps the last
+ * frames the filter still needs for every channel.
+ */
+
+#define BLOCK_FRAMES 256
+#define MAX_PHASES 1024
+#define INITIAL_FRAMES 4096
+#define MAX_TAPS 64
+
+#define PI 3.14159265358979323846
+
+struct quality_preset {
+	uint32_t taps;
+	double cutoff;
+	double beta;
+};
+
+static const struct quality_preset presets[] = {
+	{16, 0.90, 6.0},
+	{32, 0.95, 9.0},
+	{64, 0.97, 12.0},
+};
+
+enum channel {
+	CH_FL,
+	CH_FR,
+	CH_FC,
+	CH_LFE,
+	CH_BL,
+	CH_BR,
+	CH_BC,
+	CH_SL,
+	CH_SR,
+	CH_COUNT,
+};
+
+#define CH_BIT(ch) (1 << (ch))
+
+struct layout {
+	uint32_t channels;
+	enum channel order[MAX_AUDIO_CHANNELS];
+};
+
+/* the layouts the swresample path uses, 2.1 is mapped to FL, FR, FC there */
+static const struct layout layouts[] = {
+	[SPEAKERS_MONO] = {1, {CH_FC}},
+	[SPEAKERS_STEREO] = {2, {CH_FL, CH_FR}},
+	[SPEAKERS_2POINT1] = {3, {CH_FL, CH_FR, CH_FC}},
+	[SPEAKERS_4POINT0] = {4, {CH_FL, CH_FR, CH_FC, CH_BC}},
+	[SPEAKERS_4POINT1] = {5, {CH_FL, CH_FR, CH_FC, CH_LFE, CH_BC}},
+	[SPEAKERS_5POINT1] = {6,
+			      {CH_FL, CH_FR, CH_FC, CH_LFE, CH_BL, CH_BR}},
+	[SPEAKERS_7POINT1] = {8,
+			      {CH_FL, CH_FR, CH_FC, CH_LFE, CH_BL, CH_BR,
+			       CH_SL, CH_SR}},
+};
+
+struct audio_converter {
+	enum audio_format format;
+	size_t sample_size;
+	bool planar;
+	uint32_t in_channels;
+	uint32_t out_channels;
+	uint32_t in_rate;
+
+	float base[MAX_AUDIO_CHANNELS][MAX_AUDIO_CHANNELS];
+	float matrix[MAX_AUDIO_CHANNELS][MAX_AUDIO_CHANNELS];
+	float gains[MAX_AUDIO_CHANNELS];
+	bool mono;
+	bool passthrough;
+
+	float planes[MAX_AUDIO_CHANNELS][BLOCK_FRAMES];
+	float packed[MAX_AUDIO_CHANNELS * BLOCK_FRAMES];
+
+	/* resampler */
+	bool resample;
+	uint32_t up;
+	uint32_t down;
+	uint32_t step;
+	uint32_t step_phase;
+	uint32_t taps;
+	float *coeffs;
+
+	float *history[MAX_AUDIO_CHANNELS];
+	uint32_t capacity;
+	uint32_t frames;
+	uint32_t pos;
+	uint32_t phase;
+};
+
+/* ------------------------------------------------------------------------- */
+
+static const struct layout *get_layout(enum speaker_layout speakers)
+{
+	size_t idx = (size_t)speakers;
+
+	if (idx >= sizeof(layouts) / sizeof(layouts[0]))
+		return NULL;
+	return layouts[idx].channels ? &layouts[idx] : NULL;
+}
+
+static uint32_t layout_bits(const struct layout *layout)
+{
+	uint32_t bits = 0;
+
+	for (uint32_t i = 0; i < layout->channels; i++)
+		bits |= CH_BIT(layout->order[i]);
+	return bits;
+}
+
+static inline void mix_pair(double m[CH_COUNT][CH_COUNT], enum channel out_l,
+			    enum channel out_r, enum channel in_l,
+			    enum channel in_r, double level)
+{
+	m[out_l][in_l] += level;
+	m[out_r][in_r] += level;
+}
+
+/*
+ * Builds the same matrix swresample builds with its default mix levels for
+ * float output, channels the output lacks are mixed into the nearest ones and
+ * LFE is dropped.  Mono is copied to every channel except LFE, like the
+ * swresample path does.
+ */
+static void build_matrix(float matrix[MAX_AUDIO_CHANNELS][MAX_AUDIO_CHANNELS],
+			 const struct layout *out, const struct layout *in)
+{
+	const double level = 0.70710678118654752440;
+	double m[CH_COUNT][CH_COUNT];
+	uint32_t in_bits = layout_bits(in);
+	uint32_t out_bits = layout_bits(out);
+	uint32_t missing = in_bits & ~out_bits;
+
+	memset(m, 0, sizeof(m));
+	memset(matrix, 0, sizeof(float) * MAX_AUDIO_CHANNELS *
+				  MAX_AUDIO_CHANNELS);
+
+	if (in->channels == 1) {
+		for (uint32_t o = 0; o < out->channels; o++)
+			matrix[o][0] = out->order[o] == CH_LFE ? 0.0f : 1.0f;
+		return;
+	}
+
+	for (int ch = 0; ch < CH_COUNT; ch++) {
+		if ((in_bits & out_bits & CH_BIT(ch)) != 0)
+			m[ch][ch] = 1.0;
+	}
+
+	if (missing & CH_BIT(CH_FC)) {
+		m[CH_FL][CH_FC] += level;
+		m[CH_FR][CH_FC] += level;
+	}
+
+	if (missing & (CH_BIT(CH_FL) | CH_BIT(CH_FR))) {
+		m[CH_FC][CH_FL] += level;
+		m[CH_FC][CH_FR] += level;
+		if (in_bits & CH_BIT(CH_FC))
+			m[CH_FC][CH_FC] = 1.0;
+	}
+
+	if (missing & CH_BIT(CH_BC)) {
+		if (out_bits & CH_BIT(CH_BL)) {
+			m[CH_BL][CH_BC] += level;
+			m[CH_BR][CH_BC] += level;
+		} else if (out_bits & CH_BIT(CH_SL)) {
+			m[CH_SL][CH_BC] += level;
+			m[CH_SR][CH_BC] += level;
+		} else if (out_bits & CH_BIT(CH_FL)) {
+			m[CH_FL][CH_BC] += level * level;
+			m[CH_FR][CH_BC] += level * level;
+		} else {
+			m[CH_FC][CH_BC] += level * level;
+		}
+	}
+
+	if (missing & CH_BIT(CH_BL)) {
+		if (out_bits & CH_BIT(CH_BC)) {
+			mix_pair(m, CH_BC, CH_BC, CH_BL, CH_BR, level);
+		} else if (out_bits & CH_BIT(CH_SL)) {
+			mix_pair(m, CH_SL, CH_SR, CH_BL, CH_BR,
+				 (in_bits & CH_BIT(CH_SL)) ? level : 1.0);
+		} else if (out_bits & CH_BIT(CH_FL)) {
+			mix_pair(m, CH_FL, CH_FR, CH_BL, CH_BR, level);
+		} else {
+			mix_pair(m, CH_FC, CH_FC, CH_BL, CH_BR, level * level);
+		}
+	}
+
+	if (missing & CH_BIT(CH_SL)) {
+		if (out_bits & CH_BIT(CH_BL)) {
+			mix_pair(m, CH_BL, CH_BR, CH_SL, CH_SR,
+				 (in_bits & CH_BIT(CH_BL)) ? level : 1.0);
+		} else if (out_bits & CH_BIT(CH_BC)) {
+			mix_pair(m, CH_BC, CH_BC, CH_SL, CH_SR, level);
+		} else if (out_bits & CH_BIT(CH_FL)) {
+			mix_pair(m, CH_FL, CH_FR, CH_SL, CH_SR, level);
+		} else {
+			mix_pair(m, CH_FC, CH_FC, CH_SL, CH_SR, level * level);
+		}
+	}
+
+	for (uint32_t o = 0; o < out->channels; o++) {
+		for (uint32_t i = 0; i < in->channels; i++)
+			matrix[o][i] = (float)m[out->order[o]][in->order[i]];
+	}
+}
+
+/* folds the gains and the mono downmix into the matrix */
+static void update_matrix(struct audio_converter *conv)
+{
+	uint32_t out_ch = conv->out_channels;
+	uint32_t in_ch = conv->in_channels;
+	bool identity = in_ch == out_ch;
+
+	for (uint32_t i = 0; i < in_ch; i++) {
+		float mono = 0.0f;
+
+		for (uint32_t o = 0; o < out_ch; o++)
+			mono += conv->gains[o] * conv->base[o][i];
+		mono /= (float)out_ch;
+
+		for (uint32_t o = 0; o < out_ch; o++) {
+			float val = conv->mono ? mono
+					       : conv->gains[o] *
+							 conv->base[o][i];
+
+			conv->matrix[o][i] = val;
+			if (val != (o == i ? 1.0f : 0.0f))
+				identity = false;
+		}
+	}
+
+	conv->passthrough = identity && !conv->resample &&
+			    conv->format == AUDIO_FORMAT_FLOAT_PLANAR;
+}
+
+/* ------------------------------------------------------------------------- */
+
+static double bessel_i0(double x)
+{
+	double sum = 1.0;
+	double term = 1.0;
+
+	for (int k = 1; k < 64; k++) {
+		double f = x / (2.0 * k);
+
+		term *= f * f;
+		sum += term;
+		if (term < sum * 1e-12)
+			break;
+	}
+
+	return sum;
+}
+
+static uint32_t gcd(uint32_t a, uint32_t b)
+{
+	while (b) {
+		uint32_t t = a % b;
+		a = b;
+		b = t;
+	}
+	return a;
+}
+
+/*
+ * Phase p of the prototype filter h holds h[p + j * up], stored in reverse
+ * so that the output is the dot product of the phase with the input frames
+ * in order.  Every phase is normalized to unity gain.
+ */
+static void init_filter(struct audio_converter *conv,
+			const struct quality_preset *preset)
+{
+	uint32_t taps = preset->taps;
+	uint32_t up = conv->up;
+	double length = (double)taps * up;
+	double center = (length - 1.0) / 2.0;
+	double ratio = conv->up < conv->down ? (double)up / conv->down : 1.0;
+	double fc = preset->cutoff * ratio / (2.0 * up);
+	double norm = bessel_i0(preset->beta);
+
+	conv->taps = taps;
+	conv->coeffs = bmalloc(sizeof(float) * taps * up);
+
+	for (uint32_t p = 0; p < up; p++) {
+		float *coeffs = conv->coeffs + p * taps;
+		double phase[MAX_TAPS];
+		double sum = 0.0;
+
+		for (uint32_t j = 0; j < taps; j++) {
+			double t = (double)(p + (taps - 1 - j) * up) - center;
+			double w = t / (length / 2.0);
+			double x = 2.0 * fc * t;
+			double sinc = fabs(x) < 1e-9 ? 1.0
+						     : sin(PI * x) / (PI * x);
+			double window = w * w < 1.0 ? sqrt(1.0 - w * w) : 0.0;
+
+			window = bessel_i0(preset->beta * window);
+
+			phase[j] = sinc * window / norm;
+			sum += phase[j];
+		}
+
+		for (uint32_t j = 0; j < taps; j++)
+			coeffs[j] = (float)(phase[j] / sum);
+	}
+}
+
+static void reserve_history(struct audio_converter *conv, uint32_t frames)
+{
+	if (frames <= conv->capacity)
+		return;
+
+	for (uint32_t c = 0; c < conv->out_channels; c++)
+		conv->history[c] =
+			brealloc(conv->history[c], sizeof(float) * frames);
+	conv->capacity = frames;
+}
+
+static bool init_resampler(struct audio_converter *conv, uint32_t out_rate,
+			   enum audio_converter_quality quality)
+{
+	uint32_t div = gcd(out_rate, conv->in_rate);
+
+	if ((size_t)quality >= sizeof(presets) / sizeof(presets[0]))
+		quality = AUDIO_CONVERTER_QUALITY_MEDIUM;
+
+	conv->up = out_rate / div;
+	conv->down = conv->in_rate / div;
+	if (conv->up > MAX_PHASES)
+		return false;
+
+	conv->step = conv->down / conv->up;
+	conv->step_phase = conv->down % conv->up;
+	conv->resample = true;
+
+	init_filter(conv, &presets[quality]);
+
+	/* the filter starts on silence */
+	reserve_history(conv, INITIAL_FRAMES + conv->taps);
+	for (uint32_t c = 0; c < conv->out_channels; c++)
+		memset(conv->history[c], 0, sizeof(float) * (conv->taps - 1));
+	conv->frames = conv->taps - 1;
+	conv->pos = conv->taps - 1;
+	conv->phase = 0;
+	return true;
+}
+
+audio_converter_t *audio_converter_create(const struct resample_info *dst,
+					  const struct resample_info *src,
+					  enum audio_converter_quality quality)
+{
+	const struct layout *out = get_layout(dst->speakers);
+	const struct layout *in = get_layout(src->speakers);
+	struct audio_converter *conv;
+
+	if (!out || !in || dst->format != AUDIO_FORMAT_FLOAT_PLANAR)
+		return NULL;
+	if (src->format == AUDIO_FORMAT_UNKNOWN)
+		return NULL;
+	if (!dst->samples_per_sec || !src->samples_per_sec)
+		return NULL;
+
+	conv = bzalloc(sizeof(struct audio_converter));
+	conv->format = src->format;
+	conv->sample_size = get_audio_bytes_per_channel(src->format);
+	conv->planar = is_audio_planar(src->format);
+	conv->in_channels = in->channels;
+	conv->out_channels = out->channels;
+	conv->in_rate = src->samples_per_sec;
+
+	if (dst->samples_per_sec != src->samples_per_sec &&
+	    !init_resampler(conv, dst->samples_per_sec, quality)) {
+		audio_converter_destroy(conv);
+		return NULL;
+	}
+
+	build_matrix(conv->base, out, in);
+	for (uint32_t o = 0; o < MAX_AUDIO_CHANNELS; o++)
+		conv->gains[o] = 1.0f;
+	update_matrix(conv);
+	return conv;
+}
+
+void audio_converter_destroy(audio_converter_t *conv)
+{
+	if (!conv)
+		return;
+
+	for (uint32_t c = 0; c < MAX_AUDIO_CHANNELS; c++)
+		bfree(conv->history[c]);
+	bfree(conv->coeffs);
+	bfree(conv);
+}
+
+void audio_converter_set_mix(audio_converter_t *conv, const float *gains,
+			     bool mono)
+{
+	bool changed = conv->mono != mono;
+
+	for (uint32_t o = 0; o < conv->out_channels; o++) {
+		if (conv->gains[o] != gains[o]) {
+			conv->gains[o] = gains[o];
+			changed = true;
+		}
+	}
+
+	conv->mono = mono;
+	if (changed)
+		update_matrix(conv);
+}
+
+uint32_t audio_converter_get_max_frames(audio_converter_t *conv,
+					uint32_t in_frames)
+{
+	uint64_t frames = (uint64_t)conv->frames + in_frames;
+
+	if (!conv->resample)
+		return in_frames;
+	return (uint32_t)(frames * conv->up / conv->down + 1);
+}
+
+/* ------------------------------------------------------------------------- */
+
+static void u8_to_float(float *dst, const uint8_t *src, size_t count)
+{
+	const __m128 scale = _mm_set1_ps(1.0f / 128.0f);
+	const __m128 bias = _mm_set1_ps(-1.0f);
+	const __m128i zero = _mm_setzero_si128();
+	size_t i = 0;
+
+	for (; i + 16 <= count; i += 16) {
+		__m128i v = _mm_loadu_si128((const __m128i *)(src + i));
+		__m128i lo = _mm_unpacklo_epi8(v, zero);
+		__m128i hi = _mm_unpackhi_epi8(v, zero);
+		__m128i w[4] = {
+			_mm_unpacklo_epi16(lo, zero),
+			_mm_unpackhi_epi16(lo, zero),
+			_mm_unpacklo_epi16(hi, zero),
+			_mm_unpackhi_epi16(hi, zero),
+		};
+
+		for (size_t j = 0; j < 4; j++) {
+			__m128 f = _mm_cvtepi32_ps(w[j]);
+			f = _mm_add_ps(_mm_mul_ps(f, scale), bias);
+			_mm_storeu_ps(dst + i + j * 4, f);
+		}
+	}
+
+	for (; i < count; i++)
+		dst[i] = (float)src[i] * (1.0f / 128.0f) - 1.0f;
+}
+
+static void s16_to_float(float *dst, const int16_t *src, size_t count)
+{
+	const __m128 scale = _mm_set1_ps(1.0f / 32768.0f);
+	const __m128i zero = _mm_setzero_si128();
+	size_t i = 0;
+
+	for (; i + 8 <= count; i += 8) {
+		__m128i v = _mm_loadu_si128((const __m128i *)(src + i));
+		__m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(zero, v), 16);
+		__m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(zero, v), 16);
+
+		_mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(lo), scale));
+		_mm_storeu_ps(dst + i + 4,
+			      _mm_mul_ps(_mm_cvtepi32_ps(hi), scale));
+	}
+
+	for (; i < count; i++)
+		dst[i] = (float)src[i] * (1.0f / 32768.0f);
+}
+
+static void s32_to_float(float *dst, const int32_t *src, size_t count)
+{
+	const __m128 scale = _mm_set1_ps(1.0f / 2147483648.0f);
+	size_t i = 0;
+
+	for (; i + 4 <= count; i += 4) {
+		__m128i v = _mm_loadu_si128((const __m128i *)(src + i));
+		_mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(v), scale));
+	}
+
+	for (; i < count; i++)
+		dst[i] = (float)src[i] * (1.0f / 2147483648.0f);
+}
+
+static void convert_samples(enum audio_format format, float *dst,
+			    const uint8_t *src, size_t count)
+{
+	switch (format) {
+	case AUDIO_FORMAT_U8BIT:
+	case AUDIO_FORMAT_U8BIT_PLANAR:
+		u8_to_float(dst, src, count);
+		break;
+	case AUDIO_FORMAT_16BIT:
+	case AUDIO_FORMAT_16BIT_PLANAR:
+		s16_to_float(dst, (const int16_t *)src, count);
+		break;
+	case AUDIO_FORMAT_32BIT:
+	case AUDIO_FORMAT_32BIT_PLANAR:
+		s32_to_float(dst, (const int32_t *)src, count);
+		break;
+	case AUDIO_FORMAT_FLOAT:
+	case AUDIO_FORMAT_FLOAT_PLANAR:
+		memcpy(dst, src, count * sizeof(float));
+		break;
+	case AUDIO_FORMAT_UNKNOWN:
+		break;
+	}
+}
+
+static void deinterleave(float planes[][BLOCK_FRAMES], const float *src,
+			 uint32_t channels, size_t frames)
+{
+	size_t i = 0;
+
+	if (channels == 2) {
+		for (; i + 4 <= frames; i += 4) {
+			__m128 a = _mm_loadu_ps(src + i * 2);
+			__m128 b = _mm_loadu_ps(src + i * 2 + 4);
+
+			_mm_storeu_ps(planes[0] + i,
+				      _mm_shuffle_ps(a, b,
+						     _MM_SHUFFLE(2, 0, 2, 0)));
+			_mm_storeu_ps(planes[1] + i,
+				      _mm_shuffle_ps(a, b,
+						     _MM_SHUFFLE(3, 1, 3, 1)));
+		}
+	}
+
+	for (; i < frames; i++) {
+		for (uint32_t c = 0; c < channels; c++)
+			planes[c][i] = src[i * channels + c];
+	}
+}
+
+/* converts a block of input to float planes, float planes are used as is */
+static void load_block(struct audio_converter *conv, const float *planes[],
+		       const uint8_t *const input[], size_t offset,
+		       size_t frames)
+{
+	uint32_t channels = conv->in_channels;
+	const uint8_t *src;
+
+	if (conv->planar) {
+		for (uint32_t c = 0; c < channels; c++) {
+			src = input[c] + offset * conv->sample_size;
+
+			if (conv->format == AUDIO_FORMAT_FLOAT_PLANAR) {
+				planes[c] = (const float *)src;
+			} else {
+				convert_samples(conv->format, conv->planes[c],
+						src, frames);
+				planes[c] = conv->planes[c];
+			}
+		}
+		return;
+	}
+
+	src = input[0] + offset * conv->sample_size * channels;
+	if (conv->format != AUDIO_FORMAT_FLOAT) {
+		convert_samples(conv->format, conv->packed, src,
+				frames * channels);
+		src = (const uint8_t *)conv->packed;
+	}
+
+	deinterleave(conv->planes, (const float *)src, channels, frames);
+	for (uint32_t c = 0; c < channels; c++)
+		planes[c] = conv->planes[c];
+}
+
+static void scale_plane(float *dst, const float *src, float gain,
+			size_t frames)
+{
+	const __m128 g = _mm_set1_ps(gain);
+	size_t i = 0;
+
+	for (; i + 4 <= frames; i += 4)
+		_mm_storeu_ps(dst + i, _mm_mul_ps(_mm_loadu_ps(src + i), g));
+	for (; i < frames; i++)
+		dst[i] = src[i] * gain;
+}
+
+static void mix_plane(float *dst, const float *src, float gain, size_t frames)
+{
+	const __m128 g = _mm_set1_ps(gain);
+	size_t i = 0;
+
+	for (; i + 4 <= frames; i += 4) {
+		__m128 v = _mm_mul_ps(_mm_loadu_ps(src + i), g);
+		_mm_storeu_ps(dst + i, _mm_add_ps(_mm_loadu_ps(dst + i), v));
+	}
+	for (; i < frames; i++)
+		dst[i] += src[i] * gain;
+}
+
+static void remix(const struct audio_converter *conv, float *const out[],
+		  size_t out_offset, const float *const planes[], size_t frames)
+{
+	for (uint32_t o = 0; o < conv->out_channels; o++) {
+		const float *row = conv->matrix[o];
+		float *dst = out[o] + out_offset;
+		bool first = true;
+
+		for (uint32_t i = 0; i < conv->in_channels; i++) {
+			if (row[i] == 0.0f)
+				continue;
+
+			if (first)
+				scale_plane(dst, planes[i], row[i], frames);
+			else
+				mix_plane(dst, planes[i], row[i], frames);
+			first = false;
+		}
+
+		if (first)
+			memset(dst, 0, frames * sizeof(float));
+	}
+}
+
+static inline float dot_product(const float *coeffs, const float *src,
+				uint32_t taps)
+{
+	__m128 sum0 = _mm_setzero_ps();
+	__m128 sum1 = _mm_setzero_ps();
+
+	for (uint32_t i = 0; i < taps; i += 8) {
+		__m128 a = _mm_mul_ps(_mm_loadu_ps(coeffs + i),
+				      _mm_loadu_ps(src + i));
+		__m128 b = _mm_mul_ps(_mm_loadu_ps(coeffs + i + 4),
+				      _mm_loadu_ps(src + i + 4));
+
+		sum0 = _mm_add_ps(sum0, a);
+		sum1 = _mm_add_ps(sum1, b);
+	}
+
+	sum0 = _mm_add_ps(sum0, sum1);
+	sum0 = _mm_add_ps(sum0, _mm_movehl_ps(sum0, sum0));
+	sum0 = _mm_add_ss(sum0, _mm_shuffle_ps(sum0, sum0, 1));
+	return _mm_cvtss_f32(sum0);
+}
+
+/* filters the history into the output and drops the frames no longer used */
+static uint32_t resample(struct audio_converter *conv, float *const output[])
+{
+	uint32_t taps = conv->taps;
+	uint32_t pos = conv->pos;
+	uint32_t phase = conv->phase;
+	uint32_t frames = 0;
+	uint32_t drop;
+
+	for (uint32_t c = 0; c < conv->out_channels; c++) {
+		const float *src = conv->history[c] + 1 - taps;
+		float *dst = output[c];
+
+		pos = conv->pos;
+		phase = conv->phase;
+		frames = 0;
+
+		while (pos < conv->frames) {
+			dst[frames++] = dot_product(conv->coeffs + phase * taps,
+						    src + pos, taps);
+
+			pos += conv->step;
+			phase += conv->step_phase;
+			if (phase >= conv->up) {
+				phase -= conv->up;
+				pos++;
+			}
+		}
+	}
+
+	drop = pos + 1 - taps;
+	if (drop > conv->frames)
+		drop = conv->frames;
+
+	for (uint32_t c = 0; c < conv->out_channels; c++)
+		memmove(conv->history[c], conv->history[c] + drop,
+			(conv->frames - drop) * sizeof(float));
+
+	conv->frames -= drop;
+	conv->pos = pos - drop;
+	conv->phase = phase;
+	return frames;
+}
+
+void audio_converter_convert(audio_converter_t *conv, float *const output[],
+			     uint32_t *out_frames, uint64_t *ts_offset,
+			     const uint8_t *const input[], uint32_t in_frames)
+{
+	const float *planes[MAX_AUDIO_CHANNELS];
+	float *const *dst = output;
+	size_t dst_offset = 0;
+
+	if (conv->passthrough) {
+		for (uint32_t c = 0; c < conv->out_channels; c++)
+			memcpy(output[c], input[c], in_frames * sizeof(float));
+
+		*out_frames = in_frames;
+		*ts_offset = 0;
+		return;
+	}
+
+	if (conv->resample) {
+		double center = ((double)conv->taps * conv->up - 1.0) / 2.0;
+		double delay = (double)conv->frames - (double)conv->pos +
+			       (center - (double)conv->phase) / conv->up;
+
+		*ts_offset = delay > 0.0 ? (uint64_t)(delay * 1000000000.0 /
+						       conv->in_rate)
+					 : 0;
+
+		reserve_history(conv, conv->frames + in_frames);
+		dst = conv->history;
+		dst_offset = conv->frames;
+	} else {
+		*ts_offset = 0;
+	}
+
+	for (uint32_t i = 0; i < in_frames; i += BLOCK_FRAMES) {
+		uint32_t frames = in_frames - i;
+		if (frames > BLOCK_FRAMES)
+			frames = BLOCK_FRAMES;
+
+		load_block(conv, planes, input, i, frames);
+		remix(conv, dst, dst_offset + i, planes, frames);
+	}
+
+	if (conv->resample) {
+		conv->frames += in_frames;
+		*out_frames = resample(conv, output);
+	} else {
+		*out_frames = in_frames;
+	}
+}
@@ -0,0 +1,93 @@
+/******************************************************************************
+    Copyright (C) 2021 by Hugh Bailey <obs.jim@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#pragma once
+
+#include "../util/c99defs.h"
+#include "audio-resampler.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Audio conversion stage for sources
+ *
+ * Converts audio of any format and speaker layout to planar float audio of
+ * the output layout in one pass, and resamples it with a polyphase filter if
+ * the sample rates differ.  Gains and a mono downmix can be applied to the
+ * output channels as part of the conversion.  Buffers are allocated when the
+ * converter is created and only grow when larger packets arrive.
+ */
+
+struct audio_converter;
+typedef struct audio_converter audio_converter_t;
+
+enum audio_converter_quality {
+	AUDIO_CONVERTER_QUALITY_LOW,
+	AUDIO_CONVERTER_QUALITY_MEDIUM,
+	AUDIO_CONVERTER_QUALITY_HIGH,
+};
+
+/**
+ * Creates a converter
+ *
+ * @param dst output format, has to be AUDIO_FORMAT_FLOAT_PLANAR
+ * @param src input format
+ * @param quality filter quality used when resampling
+ *
+ * @return the converter, or NULL if the formats are not supported or the
+ *         ratio of the sample rates can't be resampled exactly, in which
+ *         case audio_resampler_t has to be used
+ */
+EXPORT audio_converter_t *
+audio_converter_create(const struct resample_info *dst,
+		       const struct resample_info *src,
+		       enum audio_converter_quality quality);
+EXPORT void audio_converter_destroy(audio_converter_t *converter);
+
+/**
+ * Sets the gains of the output channels and whether the output channels are
+ * downmixed to mono after the gains are applied
+ *
+ * @param gains one gain for every output channel
+ * @param mono replace every output channel with the average of all of them
+ */
+EXPORT void audio_converter_set_mix(audio_converter_t *converter,
+				    const float *gains, bool mono);
+
+/** @return the maximum number of frames converting in_frames can output */
+EXPORT uint32_t audio_converter_get_max_frames(audio_converter_t *converter,
+					       uint32_t in_frames);
+
+/**
+ * Converts a packet of audio
+ *
+ * @param output one plane per output channel, each large enough for
+ *        audio_converter_get_max_frames() frames
+ * @param out_frames receives the number of frames output
+ * @param ts_offset receives the delay of the output in nanoseconds
+ */
+EXPORT void audio_converter_convert(audio_converter_t *converter,
+				    float *const output[],
+				    uint32_t *out_frames, uint64_t *ts_offset,
+				    const uint8_t *const input[],
+				    uint32_t in_frames);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,126 @@
+/******************************************************************************
+    Copyright (C) 2021 by Hugh Bailey <obs.jim@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include "format-conversion-avx2.h"
+
+#ifdef HAVE_AVX2_KERNELS
+#include <immintrin.h>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#define TARGET_AVX2
+#else
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+TARGET_AVX2
+uint32_t avx2_deinterleave_row(const uint8_t *uv, uint8_t *u, uint8_t *v,
+			       uint32_t count)
+{
+	const __m256i mask = _mm256_set1_epi16(0x00FF);
+	uint32_t x = 0;
+
+	for (; x + 32 <= count; x += 32) {
+		__m256i a = _mm256_loadu_si256((const __m256i *)(uv + x * 2));
+		__m256i b =
+			_mm256_loadu_si256((const __m256i *)(uv + x * 2 + 32));
+		__m256i u_val = _mm256_packus_epi16(_mm256_and_si256(a, mask),
+						    _mm256_and_si256(b, mask));
+		__m256i v_val = _mm256_packus_epi16(_mm256_srli_epi16(a, 8),
+						    _mm256_srli_epi16(b, 8));
+
+		/* packs work per 128 bit lane, restore the order */
+		_mm256_storeu_si256((__m256i *)(u + x),
+				    _mm256_permute4x64_epi64(u_val, 0xD8));
+		_mm256_storeu_si256((__m256i *)(v + x),
+				    _mm256_permute4x64_epi64(v_val, 0xD8));
+	}
+
+	return x;
+}
+
+TARGET_AVX2
+uint32_t avx2_interleave_row(const uint8_t *u, const uint8_t *v, uint8_t *uv,
+			     uint32_t count)
+{
+	uint32_t x = 0;
+
+	for (; x + 32 <= count; x += 32) {
+		__m256i u_val = _mm256_loadu_si256((const __m256i *)(u + x));
+		__m256i v_val = _mm256_loadu_si256((const __m256i *)(v + x));
+		__m256i lo = _mm256_unpacklo_epi8(u_val, v_val);
+		__m256i hi = _mm256_unpackhi_epi8(u_val, v_val);
+
+		_mm256_storeu_si256((__m256i *)(uv + x * 2),
+				    _mm256_permute2x128_si256(lo, hi, 0x20));
+		_mm256_storeu_si256((__m256i *)(uv + x * 2 + 32),
+				    _mm256_permute2x128_si256(lo, hi, 0x31));
+	}
+
+	return x;
+}
+
+TARGET_AVX2
+uint32_t avx2_swap_rb_row(const uint8_t *input, uint8_t *output,
+			  uint32_t count, uint32_t alpha)
+{
+	const uint32_t *in32 = (const uint32_t *)input;
+	uint32_t *out32 = (uint32_t *)output;
+	const __m256i rb_mask = _mm256_set1_epi32(0x00FF00FF);
+	const __m256i ga_mask = _mm256_set1_epi32((int)0xFF00FF00);
+	const __m256i alpha_val = _mm256_set1_epi32((int)alpha);
+	uint32_t x = 0;
+
+	for (; x + 8 <= count; x += 8) {
+		__m256i val = _mm256_loadu_si256((const __m256i *)(in32 + x));
+		__m256i rb = _mm256_and_si256(val, rb_mask);
+
+		val = _mm256_or_si256(_mm256_and_si256(val, ga_mask),
+				      alpha_val);
+		rb = _mm256_or_si256(_mm256_slli_epi32(rb, 16),
+				     _mm256_srli_epi32(rb, 16));
+		_mm256_storeu_si256((__m256i *)(out32 + x),
+				    _mm256_or_si256(val, rb));
+	}
+
+	return x;
+}
+
+bool avx2_supported(void)
+{
+#ifdef _MSC_VER
+	int info[4];
+
+	__cpuid(info, 0);
+	if (info[0] < 7)
+		return false;
+
+	/* the OS also has to save the AVX registers */
+	__cpuid(info, 1);
+	if ((info[2] & (1 << 27)) == 0 || (info[2] & (1 << 28)) == 0)
+		return false;
+	if ((_xgetbv(0) & 6) != 6)
+		return false;
+
+	__cpuidex(info, 7, 0);
+	return (info[1] & (1 << 5)) != 0;
+#else
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2") != 0;
+#endif
+}
+#endif
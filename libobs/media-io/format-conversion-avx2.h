@@ -0,0 +1,43 @@
+/******************************************************************************
+    Copyright (C) 2021 by Hugh Bailey <obs.jim@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#pragma once
+
+#include "../util/c99defs.h"
+
+/*
+ * AVX2 row kernels of format-conversion.c
+ *
+ * These live in their own file so that immintrin.h is never included along
+ * with SIMDe.  Each kernel converts as many samples as it can in whole
+ * vectors and returns how many it converted, the caller converts the rest.
+ */
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || \
+	defined(__i386__)
+#define HAVE_AVX2_KERNELS
+
+/* returns true if both the CPU and the OS support AVX2 */
+extern bool avx2_supported(void);
+
+extern uint32_t avx2_deinterleave_row(const uint8_t *uv, uint8_t *u,
+				      uint8_t *v, uint32_t count);
+extern uint32_t avx2_interleave_row(const uint8_t *u, const uint8_t *v,
+				    uint8_t *uv, uint32_t count);
+extern uint32_t avx2_swap_rb_row(const uint8_t *input, uint8_t *output,
+				 uint32_t count, uint32_t alpha);
+#endif
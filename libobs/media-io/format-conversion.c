@@ -15,8 +15,10 @@
     along with this program.  If not, see <http://www.gnu.org/licenses/>.
 ******************************************************************************/
 
-#include "format-conversion.h"
+#include <string.h>
 
+#include "format-conversion.h"
+#include "format-conversion-avx2.h"
 #include "../util/sse-intrin.h"
 
 /* ...surprisingly, if I don't use a macro to force inlining, it causes the
@@ -316,3 +318,521 @@ void decompress_422(const uint8_t *input, uint32_t in_linesize,
 		}
 	}
 }
+
+/* ------------------------------------------------------------------------- */
+/* row kernels, SSE2 maps to NEON on ARM through SIMDe                       */
+
+static void copy_rows(const uint8_t *input, uint32_t in_linesize,
+		      uint8_t *output, uint32_t out_linesize, size_t size,
+		      uint32_t start_y, uint32_t end_y)
+{
+	input += (size_t)start_y * in_linesize;
+	output += (size_t)start_y * out_linesize;
+
+	for (uint32_t y = start_y; y < end_y; y++) {
+		memcpy(output, input, size);
+		input += in_linesize;
+		output += out_linesize;
+	}
+}
+
+static void deinterleave_row(const uint8_t *uv, uint8_t *u, uint8_t *v,
+			     uint32_t count)
+{
+	const __m128i mask = _mm_set1_epi16(0x00FF);
+	uint32_t x = 0;
+
+	for (; x + 16 <= count; x += 16) {
+		__m128i a = _mm_loadu_si128((const __m128i *)(uv + x * 2));
+		__m128i b = _mm_loadu_si128((const __m128i *)(uv + x * 2 + 16));
+
+		_mm_storeu_si128((__m128i *)(u + x),
+				 _mm_packus_epi16(_mm_and_si128(a, mask),
+						  _mm_and_si128(b, mask)));
+		_mm_storeu_si128((__m128i *)(v + x),
+				 _mm_packus_epi16(_mm_srli_epi16(a, 8),
+						  _mm_srli_epi16(b, 8)));
+	}
+
+	for (; x < count; x++) {
+		u[x] = uv[x * 2];
+		v[x] = uv[x * 2 + 1];
+	}
+}
+
+static void interleave_row(const uint8_t *u, const uint8_t *v, uint8_t *uv,
+			   uint32_t count)
+{
+	uint32_t x = 0;
+
+	for (; x + 16 <= count; x += 16) {
+		__m128i u_val = _mm_loadu_si128((const __m128i *)(u + x));
+		__m128i v_val = _mm_loadu_si128((const __m128i *)(v + x));
+
+		_mm_storeu_si128((__m128i *)(uv + x * 2),
+				 _mm_unpacklo_epi8(u_val, v_val));
+		_mm_storeu_si128((__m128i *)(uv + x * 2 + 16),
+				 _mm_unpackhi_epi8(u_val, v_val));
+	}
+
+	for (; x < count; x++) {
+		uv[x * 2] = u[x];
+		uv[x * 2 + 1] = v[x];
+	}
+}
+
+/* swaps the first and third byte of every pixel and ORs in alpha */
+static void swap_rb_row(const uint8_t *input, uint8_t *output, uint32_t count,
+			uint32_t alpha)
+{
+	const uint32_t *in32 = (const uint32_t *)input;
+	uint32_t *out32 = (uint32_t *)output;
+	const __m128i rb_mask = _mm_set1_epi32(0x00FF00FF);
+	const __m128i ga_mask = _mm_set1_epi32((int)0xFF00FF00);
+	const __m128i alpha_val = _mm_set1_epi32((int)alpha);
+	uint32_t x = 0;
+
+	for (; x + 4 <= count; x += 4) {
+		__m128i val = _mm_loadu_si128((const __m128i *)(in32 + x));
+		__m128i rb = _mm_and_si128(val, rb_mask);
+
+		val = _mm_or_si128(_mm_and_si128(val, ga_mask), alpha_val);
+		rb = _mm_or_si128(_mm_slli_epi32(rb, 16),
+				  _mm_srli_epi32(rb, 16));
+		_mm_storeu_si128((__m128i *)(out32 + x), _mm_or_si128(val, rb));
+	}
+
+	for (; x < count; x++) {
+		uint32_t val = in32[x];
+		uint32_t rb = val & 0x00FF00FF;
+
+		out32[x] = (val & 0xFF00FF00) | alpha | (rb << 16) | (rb >> 16);
+	}
+}
+
+static void fill_alpha_row(const uint8_t *input, uint8_t *output,
+			   uint32_t count)
+{
+	const uint32_t *in32 = (const uint32_t *)input;
+	uint32_t *out32 = (uint32_t *)output;
+	const __m128i alpha_val = _mm_set1_epi32((int)0xFF000000);
+	uint32_t x = 0;
+
+	for (; x + 4 <= count; x += 4) {
+		__m128i val = _mm_loadu_si128((const __m128i *)(in32 + x));
+		_mm_storeu_si128((__m128i *)(out32 + x),
+				 _mm_or_si128(val, alpha_val));
+	}
+
+	for (; x < count; x++)
+		out32[x] = in32[x] | 0xFF000000;
+}
+
+/* splits a row of packed 4:2:2 pixels, count must be even */
+static void unpack_422_row(const uint8_t *input, uint8_t *y_out,
+			   uint8_t *u_out, uint8_t *v_out, uint32_t count,
+			   bool leading_lum, bool swap_uv)
+{
+	const __m128i mask = _mm_set1_epi16(0x00FF);
+	const size_t y_idx = leading_lum ? 0 : 1;
+	const size_t u_idx = (leading_lum ? 1 : 0) + (swap_uv ? 2 : 0);
+	const size_t v_idx = (leading_lum ? 1 : 0) + (swap_uv ? 0 : 2);
+	uint8_t *u_plane = swap_uv ? v_out : u_out;
+	uint8_t *v_plane = swap_uv ? u_out : v_out;
+	uint32_t x = 0;
+
+	for (; x + 16 <= count; x += 16) {
+		const uint8_t *in = input + x * 2;
+		__m128i a = _mm_loadu_si128((const __m128i *)in);
+		__m128i b = _mm_loadu_si128((const __m128i *)(in + 16));
+		__m128i even = _mm_packus_epi16(_mm_and_si128(a, mask),
+						_mm_and_si128(b, mask));
+		__m128i odd = _mm_packus_epi16(_mm_srli_epi16(a, 8),
+					       _mm_srli_epi16(b, 8));
+		__m128i lum = leading_lum ? even : odd;
+		__m128i chroma = leading_lum ? odd : even;
+
+		_mm_storeu_si128((__m128i *)(y_out + x), lum);
+		_mm_storel_epi64((__m128i *)(u_plane + x / 2),
+				 _mm_packus_epi16(_mm_and_si128(chroma, mask),
+						  chroma));
+		_mm_storel_epi64((__m128i *)(v_plane + x / 2),
+				 _mm_packus_epi16(_mm_srli_epi16(chroma, 8),
+						  chroma));
+	}
+
+	for (; x < count; x += 2) {
+		const uint8_t *in = input + x * 2;
+
+		y_out[x] = in[y_idx];
+		y_out[x + 1] = in[y_idx + 2];
+		u_out[x / 2] = in[u_idx];
+		v_out[x / 2] = in[v_idx];
+	}
+}
+
+/* P010 keeps samples in the high bits, I010 in the low bits */
+static void unpack_p010_row(const uint16_t *uv, uint16_t *u, uint16_t *v,
+			    uint32_t count)
+{
+	uint32_t x = 0;
+
+	for (; x + 8 <= count; x += 8) {
+		__m128i a = _mm_loadu_si128((const __m128i *)(uv + x * 2));
+		__m128i b = _mm_loadu_si128((const __m128i *)(uv + x * 2 + 8));
+		__m128i u_a = _mm_srli_epi32(_mm_slli_epi32(a, 16), 22);
+		__m128i u_b = _mm_srli_epi32(_mm_slli_epi32(b, 16), 22);
+
+		_mm_storeu_si128((__m128i *)(u + x),
+				 _mm_packs_epi32(u_a, u_b));
+		_mm_storeu_si128((__m128i *)(v + x),
+				 _mm_packs_epi32(_mm_srli_epi32(a, 22),
+						 _mm_srli_epi32(b, 22)));
+	}
+
+	for (; x < count; x++) {
+		u[x] = uv[x * 2] >> 6;
+		v[x] = uv[x * 2 + 1] >> 6;
+	}
+}
+
+static void pack_p010_row(const uint16_t *u, const uint16_t *v, uint16_t *uv,
+			  uint32_t count)
+{
+	uint32_t x = 0;
+
+	for (; x + 8 <= count; x += 8) {
+		__m128i u_val = _mm_loadu_si128((const __m128i *)(u + x));
+		__m128i v_val = _mm_loadu_si128((const __m128i *)(v + x));
+
+		u_val = _mm_slli_epi16(u_val, 6);
+		v_val = _mm_slli_epi16(v_val, 6);
+		_mm_storeu_si128((__m128i *)(uv + x * 2),
+				 _mm_unpacklo_epi16(u_val, v_val));
+		_mm_storeu_si128((__m128i *)(uv + x * 2 + 8),
+				 _mm_unpackhi_epi16(u_val, v_val));
+	}
+
+	for (; x < count; x++) {
+		uv[x * 2] = (uint16_t)(u[x] << 6);
+		uv[x * 2 + 1] = (uint16_t)(v[x] << 6);
+	}
+}
+
+static void shift_row(const uint16_t *input, uint16_t *output, uint32_t count,
+		      bool left)
+{
+	uint32_t x = 0;
+
+	for (; x + 8 <= count; x += 8) {
+		__m128i val = _mm_loadu_si128((const __m128i *)(input + x));
+
+		val = left ? _mm_slli_epi16(val, 6) : _mm_srli_epi16(val, 6);
+		_mm_storeu_si128((__m128i *)(output + x), val);
+	}
+
+	for (; x < count; x++)
+		output[x] = left ? (uint16_t)(input[x] << 6) : input[x] >> 6;
+}
+
+/* ------------------------------------------------------------------------- */
+/* AVX2 row kernels, only used if the CPU supports them                      */
+
+#ifdef HAVE_AVX2_KERNELS
+static void deinterleave_row_avx2(const uint8_t *uv, uint8_t *u, uint8_t *v,
+				  uint32_t count)
+{
+	uint32_t x = avx2_deinterleave_row(uv, u, v, count);
+	deinterleave_row(uv + x * 2, u + x, v + x, count - x);
+}
+
+static void interleave_row_avx2(const uint8_t *u, const uint8_t *v,
+				uint8_t *uv, uint32_t count)
+{
+	uint32_t x = avx2_interleave_row(u, v, uv, count);
+	interleave_row(u + x, v + x, uv + x * 2, count - x);
+}
+
+static void swap_rb_row_avx2(const uint8_t *input, uint8_t *output,
+			     uint32_t count, uint32_t alpha)
+{
+	uint32_t x = avx2_swap_rb_row(input, output, count, alpha);
+	swap_rb_row(input + x * 4, output + x * 4, count - x, alpha);
+}
+#endif
+
+/* ------------------------------------------------------------------------- */
+/* converters                                                                */
+
+typedef void (*deinterleave_row_t)(const uint8_t *, uint8_t *, uint8_t *,
+				   uint32_t);
+typedef void (*interleave_row_t)(const uint8_t *, const uint8_t *, uint8_t *,
+				 uint32_t);
+typedef void (*swap_rb_row_t)(const uint8_t *, uint8_t *, uint32_t, uint32_t);
+
+static FORCE_INLINE void
+nv12_to_i420_with(const uint8_t *const input[], const uint32_t in_linesize[],
+		  uint32_t width, uint32_t start_y, uint32_t end_y,
+		  uint8_t *const output[], const uint32_t out_linesize[],
+		  deinterleave_row_t deinterleave)
+{
+	uint32_t width_d2 = width / 2;
+
+	copy_rows(input[0], in_linesize[0], output[0], out_linesize[0], width,
+		  start_y, end_y);
+
+	for (uint32_t y = start_y / 2; y < end_y / 2; y++) {
+		deinterleave(input[1] + y * in_linesize[1],
+			     output[1] + y * out_linesize[1],
+			     output[2] + y * out_linesize[2], width_d2);
+	}
+}
+
+static FORCE_INLINE void
+i420_to_nv12_with(const uint8_t *const input[], const uint32_t in_linesize[],
+		  uint32_t width, uint32_t start_y, uint32_t end_y,
+		  uint8_t *const output[], const uint32_t out_linesize[],
+		  interleave_row_t interleave)
+{
+	uint32_t width_d2 = width / 2;
+
+	copy_rows(input[0], in_linesize[0], output[0], out_linesize[0], width,
+		  start_y, end_y);
+
+	for (uint32_t y = start_y / 2; y < end_y / 2; y++) {
+		interleave(input[1] + y * in_linesize[1],
+			   input[2] + y * in_linesize[2],
+			   output[1] + y * out_linesize[1], width_d2);
+	}
+}
+
+static FORCE_INLINE void
+rgb_swap_with(const uint8_t *const input[], const uint32_t in_linesize[],
+	      uint32_t width, uint32_t start_y, uint32_t end_y,
+	      uint8_t *const output[], const uint32_t out_linesize[],
+	      uint32_t alpha, swap_rb_row_t swap_rb)
+{
+	for (uint32_t y = start_y; y < end_y; y++) {
+		swap_rb(input[0] + y * in_linesize[0],
+			output[0] + y * out_linesize[0], width, alpha);
+	}
+}
+
+#define CONVERT_PARAMS                                                    \
+	const uint8_t *const input[], const uint32_t in_linesize[],       \
+		uint32_t width, uint32_t start_y, uint32_t end_y,         \
+		uint8_t *const output[], const uint32_t out_linesize[]
+#define CONVERT_ARGS \
+	input, in_linesize, width, start_y, end_y, output, out_linesize
+
+static void convert_nv12_to_i420(CONVERT_PARAMS)
+{
+	nv12_to_i420_with(CONVERT_ARGS, deinterleave_row);
+}
+
+static void convert_i420_to_nv12(CONVERT_PARAMS)
+{
+	i420_to_nv12_with(CONVERT_ARGS, interleave_row);
+}
+
+static void convert_swap_rb(CONVERT_PARAMS)
+{
+	rgb_swap_with(CONVERT_ARGS, 0, swap_rb_row);
+}
+
+static void convert_bgrx_to_rgba(CONVERT_PARAMS)
+{
+	rgb_swap_with(CONVERT_ARGS, 0xFF000000, swap_rb_row);
+}
+
+#ifdef HAVE_AVX2_KERNELS
+static void convert_nv12_to_i420_avx2(CONVERT_PARAMS)
+{
+	nv12_to_i420_with(CONVERT_ARGS, deinterleave_row_avx2);
+}
+
+static void convert_i420_to_nv12_avx2(CONVERT_PARAMS)
+{
+	i420_to_nv12_with(CONVERT_ARGS, interleave_row_avx2);
+}
+
+static void convert_swap_rb_avx2(CONVERT_PARAMS)
+{
+	rgb_swap_with(CONVERT_ARGS, 0, swap_rb_row_avx2);
+}
+
+static void convert_bgrx_to_rgba_avx2(CONVERT_PARAMS)
+{
+	rgb_swap_with(CONVERT_ARGS, 0xFF000000, swap_rb_row_avx2);
+}
+#endif
+
+static void convert_bgrx_to_bgra(CONVERT_PARAMS)
+{
+	for (uint32_t y = start_y; y < end_y; y++) {
+		fill_alpha_row(input[0] + y * in_linesize[0],
+			       output[0] + y * out_linesize[0], width);
+	}
+}
+
+static void convert_bgra_to_bgrx(CONVERT_PARAMS)
+{
+	copy_rows(input[0], in_linesize[0], output[0], out_linesize[0],
+		  (size_t)width * 4, start_y, end_y);
+}
+
+/* drops the alpha plane of I40A, I42A and YUVA */
+static FORCE_INLINE void drop_alpha(CONVERT_PARAMS, uint32_t chroma_shift_x,
+				    uint32_t chroma_shift_y)
+{
+	uint32_t chroma_width = width >> chroma_shift_x;
+	uint32_t chroma_start = start_y >> chroma_shift_y;
+	uint32_t chroma_end = end_y >> chroma_shift_y;
+
+	copy_rows(input[0], in_linesize[0], output[0], out_linesize[0], width,
+		  start_y, end_y);
+	for (size_t i = 1; i < 3; i++) {
+		copy_rows(input[i], in_linesize[i], output[i], out_linesize[i],
+			  chroma_width, chroma_start, chroma_end);
+	}
+}
+
+static void convert_i40a_to_i420(CONVERT_PARAMS)
+{
+	drop_alpha(CONVERT_ARGS, 1, 1);
+}
+
+static void convert_i42a_to_i422(CONVERT_PARAMS)
+{
+	drop_alpha(CONVERT_ARGS, 1, 0);
+}
+
+static void convert_yuva_to_i444(CONVERT_PARAMS)
+{
+	drop_alpha(CONVERT_ARGS, 0, 0);
+}
+
+static FORCE_INLINE void unpack_422(CONVERT_PARAMS, bool leading_lum,
+				    bool swap_uv)
+{
+	for (uint32_t y = start_y; y < end_y; y++) {
+		unpack_422_row(input[0] + y * in_linesize[0],
+			       output[0] + y * out_linesize[0],
+			       output[1] + y * out_linesize[1],
+			       output[2] + y * out_linesize[2], width & ~1,
+			       leading_lum, swap_uv);
+	}
+}
+
+static void convert_yuy2_to_i422(CONVERT_PARAMS)
+{
+	unpack_422(CONVERT_ARGS, true, false);
+}
+
+static void convert_uyvy_to_i422(CONVERT_PARAMS)
+{
+	unpack_422(CONVERT_ARGS, false, false);
+}
+
+static void convert_yvyu_to_i422(CONVERT_PARAMS)
+{
+	unpack_422(CONVERT_ARGS, true, true);
+}
+
+static void convert_p010_to_i010(CONVERT_PARAMS)
+{
+	uint32_t width_d2 = width / 2;
+
+	for (uint32_t y = start_y; y < end_y; y++) {
+		shift_row((const uint16_t *)(input[0] + y * in_linesize[0]),
+			  (uint16_t *)(output[0] + y * out_linesize[0]), width,
+			  false);
+	}
+
+	for (uint32_t y = start_y / 2; y < end_y / 2; y++) {
+		unpack_p010_row(
+			(const uint16_t *)(input[1] + y * in_linesize[1]),
+			(uint16_t *)(output[1] + y * out_linesize[1]),
+			(uint16_t *)(output[2] + y * out_linesize[2]),
+			width_d2);
+	}
+}
+
+static void convert_i010_to_p010(CONVERT_PARAMS)
+{
+	uint32_t width_d2 = width / 2;
+
+	for (uint32_t y = start_y; y < end_y; y++) {
+		shift_row((const uint16_t *)(input[0] + y * in_linesize[0]),
+			  (uint16_t *)(output[0] + y * out_linesize[0]), width,
+			  true);
+	}
+
+	for (uint32_t y = start_y / 2; y < end_y / 2; y++) {
+		pack_p010_row(
+			(const uint16_t *)(input[1] + y * in_linesize[1]),
+			(const uint16_t *)(input[2] + y * in_linesize[2]),
+			(uint16_t *)(output[1] + y * out_linesize[1]),
+			width_d2);
+	}
+}
+
+struct format_convert {
+	enum video_format src;
+	enum video_format dst;
+	video_format_convert_t convert;
+	video_format_convert_t convert_avx2;
+};
+
+#ifdef HAVE_AVX2_KERNELS
+#define AVX2(func) func##_avx2
+#else
+#define AVX2(func) NULL
+#endif
+
+static const struct format_convert converters[] = {
+	{VIDEO_FORMAT_NV12, VIDEO_FORMAT_I420, convert_nv12_to_i420,
+	 AVX2(convert_nv12_to_i420)},
+	{VIDEO_FORMAT_I420, VIDEO_FORMAT_NV12, convert_i420_to_nv12,
+	 AVX2(convert_i420_to_nv12)},
+	{VIDEO_FORMAT_RGBA, VIDEO_FORMAT_BGRA, convert_swap_rb,
+	 AVX2(convert_swap_rb)},
+	{VIDEO_FORMAT_BGRA, VIDEO_FORMAT_RGBA, convert_swap_rb,
+	 AVX2(convert_swap_rb)},
+	{VIDEO_FORMAT_RGBA, VIDEO_FORMAT_BGRX, convert_swap_rb,
+	 AVX2(convert_swap_rb)},
+	{VIDEO_FORMAT_BGRX, VIDEO_FORMAT_RGBA, convert_bgrx_to_rgba,
+	 AVX2(convert_bgrx_to_rgba)},
+	{VIDEO_FORMAT_BGRX, VIDEO_FORMAT_BGRA, convert_bgrx_to_bgra, NULL},
+	{VIDEO_FORMAT_BGRA, VIDEO_FORMAT_BGRX, convert_bgra_to_bgrx, NULL},
+	{VIDEO_FORMAT_I40A, VIDEO_FORMAT_I420, convert_i40a_to_i420, NULL},
+	{VIDEO_FORMAT_I42A, VIDEO_FORMAT_I422, convert_i42a_to_i422, NULL},
+	{VIDEO_FORMAT_YUVA, VIDEO_FORMAT_I444, convert_yuva_to_i444, NULL},
+	{VIDEO_FORMAT_YUY2, VIDEO_FORMAT_I422, convert_yuy2_to_i422, NULL},
+	{VIDEO_FORMAT_UYVY, VIDEO_FORMAT_I422, convert_uyvy_to_i422, NULL},
+	{VIDEO_FORMAT_YVYU, VIDEO_FORMAT_I422, convert_yvyu_to_i422, NULL},
+	{VIDEO_FORMAT_P010, VIDEO_FORMAT_I010, convert_p010_to_i010, NULL},
+	{VIDEO_FORMAT_I010, VIDEO_FORMAT_P010, convert_i010_to_p010, NULL},
+};
+
+#undef AVX2
+
+video_format_convert_t video_format_get_convert(enum video_format src,
+						enum video_format dst)
+{
+	for (size_t i = 0; i < sizeof(converters) / sizeof(converters[0]);
+	     i++) {
+		const struct format_convert *c = &converters[i];
+
+		if (c->src != src || c->dst != dst)
+			continue;
+
+#ifdef HAVE_AVX2_KERNELS
+		if (c->convert_avx2 && avx2_supported())
+			return c->convert_avx2;
+#endif
+		return c->convert;
+	}
+
+	return NULL;
+}
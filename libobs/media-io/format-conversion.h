@@ -18,6 +18,7 @@
 #pragma once
 
 #include "../util/c99defs.h"
+#include "video-io.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -56,6 +57,26 @@ EXPORT void decompress_422(const uint8_t *input, uint32_t in_linesize,
 			   uint32_t start_y, uint32_t end_y, uint8_t *output,
 			   uint32_t out_linesize, bool leading_lum);
 
+/*
+ * Functions for converting between formats of the same size
+ *
+ * Only conversions that move samples between planes without changing their
+ * values are provided, so the result doesn't depend on the color space or
+ * range.  start_y and end_y are rows of the frame, start_y must be even for
+ * formats with vertically subsampled chroma so that frames can be converted
+ * in slices.
+ */
+
+typedef void (*video_format_convert_t)(const uint8_t *const input[],
+				       const uint32_t in_linesize[],
+				       uint32_t width, uint32_t start_y,
+				       uint32_t end_y, uint8_t *const output[],
+				       const uint32_t out_linesize[]);
+
+/* returns the fastest converter for this CPU, or NULL if there is none */
+EXPORT video_format_convert_t video_format_get_convert(enum video_format src,
+						       enum video_format dst);
+
 #ifdef __cplusplus
 }
 #endif
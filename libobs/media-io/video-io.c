@@ -38,6 +38,12 @@ struct cached_frame_info {
 	struct video_data frame;
 	int skipped;
 	int count;
+
+	/* set when the frame data is owned by the caller of
+	 * video_output_push_external_frame rather than the cache */
+	struct video_data external;
+	void (*release)(void *param);
+	void *release_param;
 };
 
 struct video_input {
@@ -119,6 +125,8 @@ static inline bool scale_video_output(struct video_input *input,
 static inline bool video_output_cur_frame(struct video_output *video)
 {
 	struct cached_frame_info *frame_info;
+	void (*release)(void *param) = NULL;
+	void *release_param = NULL;
 	bool complete;
 	bool skipped;
 
@@ -138,6 +146,11 @@ static inline bool video_output_cur_frame(struct video_output *video)
 		struct video_input *input = video->inputs.array + i;
 		struct video_data frame = frame_info->frame;
 
+		if (frame_info->release) {
+			frame = frame_info->external;
+			frame.timestamp = frame_info->frame.timestamp;
+		}
+
 		if (scale_video_output(input, &frame))
 			input->callback(input->param, &frame);
 	}
@@ -153,6 +166,11 @@ static inline bool video_output_cur_frame(struct video_output *video)
 	skipped = frame_info->skipped > 0;
 
 	if (complete) {
+		release = frame_info->release;
+		release_param = frame_info->release_param;
+		frame_info->release = NULL;
+		frame_info->release_param = NULL;
+
 		if (++video->first_added == video->info.cache_size)
 			video->first_added = 0;
 
@@ -167,6 +185,9 @@ static inline bool video_output_cur_frame(struct video_output *video)
 
 	/* -------------------------------- */
 
+	if (release)
+		release(release_param);
+
 	return complete;
 }
 
@@ -274,8 +295,14 @@ void video_output_close(video_t *video)
 		video_input_free(&video->inputs.array[i]);
 	da_free(video->inputs);
 
-	for (size_t i = 0; i < video->info.cache_size; i++)
-		video_frame_free((struct video_frame *)&video->cache[i]);
+	for (size_t i = 0; i < video->info.cache_size; i++) {
+		struct cached_frame_info *cfi = &video->cache[i];
+
+		/* hand back external frames that were never delivered */
+		if (cfi->release)
+			cfi->release(cfi->release_param);
+		video_frame_free((struct video_frame *)&cfi->frame);
+	}
 
 	os_sem_destroy(video->update_semaphore);
 	pthread_mutex_destroy(&video->data_mutex);
@@ -310,9 +337,22 @@ static inline bool video_input_init(struct video_input *input,
 						.colorspace =
 							video->info.colorspace};
 
-		int ret = video_scaler_create(&input->scaler,
-					      &input->conversion, &from,
-					      VIDEO_SCALE_FAST_BILINEAR);
+		enum video_scaler_impl impl = input->conversion.scaler;
+		int ret = video_scaler_create2(&input->scaler,
+					       &input->conversion, &from,
+					       VIDEO_SCALE_FAST_BILINEAR, impl);
+
+		/* the native scaler can't convert between color spaces */
+		if (ret == VIDEO_SCALER_BAD_CONVERSION &&
+		    impl == VIDEO_SCALER_IMPL_NATIVE) {
+			blog(LOG_INFO, "video_input_init: The native scaler "
+				       "can't do this conversion, using the "
+				       "default scaler");
+			ret = video_scaler_create(&input->scaler,
+						  &input->conversion, &from,
+						  VIDEO_SCALE_FAST_BILINEAR);
+		}
+
 		if (ret != VIDEO_SCALER_SUCCESS) {
 			if (ret == VIDEO_SCALER_BAD_CONVERSION)
 				blog(LOG_ERROR, "video_input_init: Bad "
@@ -493,6 +533,36 @@ void video_output_unlock_frame(video_t *video)
 	pthread_mutex_unlock(&video->data_mutex);
 }
 
+bool video_output_push_external_frame(video_t *video,
+				      const struct video_data *frame, int count,
+				      void (*release)(void *param),
+				      void *param)
+{
+	struct video_frame cache_frame;
+	bool locked;
+
+	if (!video || !frame || !release)
+		return false;
+
+	pthread_mutex_lock(&video->data_mutex);
+
+	locked = video_output_lock_frame(video, &cache_frame, count,
+					 frame->timestamp);
+	if (locked) {
+		struct cached_frame_info *cfi =
+			&video->cache[video->last_added];
+		cfi->external = *frame;
+		cfi->release = release;
+		cfi->release_param = param;
+	}
+
+	pthread_mutex_unlock(&video->data_mutex);
+
+	if (locked)
+		video_output_unlock_frame(video);
+	return locked;
+}
+
 uint64_t video_output_get_frame_time(const video_t *video)
 {
 	return video ? video->frame_time : 0;
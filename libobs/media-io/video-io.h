@@ -68,6 +68,15 @@ enum video_format {
 
 	/* packed 4:4:4 with alpha */
 	VIDEO_FORMAT_AYUV,
+
+	/* planar 4:2:0, 10 bits in the low bits of 16-bit samples */
+	VIDEO_FORMAT_I010,
+
+	/* two-plane 4:2:0, 10 bits in the high bits of 16-bit samples */
+	VIDEO_FORMAT_P010,
+
+	/* planar 4:2:2, 10 bits in the low bits of 16-bit samples */
+	VIDEO_FORMAT_I210,
 };
 
 enum video_colorspace {
@@ -117,6 +126,9 @@ static inline bool format_is_yuv(enum video_format format)
 	case VIDEO_FORMAT_I42A:
 	case VIDEO_FORMAT_YUVA:
 	case VIDEO_FORMAT_AYUV:
+	case VIDEO_FORMAT_I010:
+	case VIDEO_FORMAT_P010:
+	case VIDEO_FORMAT_I210:
 		return true;
 	case VIDEO_FORMAT_NONE:
 	case VIDEO_FORMAT_RGBA:
@@ -165,6 +177,12 @@ static inline const char *get_video_format_name(enum video_format format)
 		return "YUVA";
 	case VIDEO_FORMAT_AYUV:
 		return "AYUV";
+	case VIDEO_FORMAT_I010:
+		return "I010";
+	case VIDEO_FORMAT_P010:
+		return "P010";
+	case VIDEO_FORMAT_I210:
+		return "I210";
 	case VIDEO_FORMAT_NONE:;
 	}
 
@@ -209,6 +227,23 @@ enum video_scale_type {
 	VIDEO_SCALE_FAST_BILINEAR,
 	VIDEO_SCALE_BILINEAR,
 	VIDEO_SCALE_BICUBIC,
+	VIDEO_SCALE_AREA,
+};
+
+/*
+ * AUTO, which video_scaler_create uses, converts with the format converters
+ * when the size, color space and range stay the same and only samples have
+ * to be moved between planes, and uses swscale for everything else.
+ *
+ * NATIVE opts in to the native scaler, which handles 8 bit planar and packed
+ * RGBA-like formats when the color space and range stay the same, and scales
+ * slices of the frame on the libobs task scheduler.  Creating the scaler
+ * fails with VIDEO_SCALER_BAD_CONVERSION if it can't do the conversion.
+ */
+enum video_scaler_impl {
+	VIDEO_SCALER_IMPL_AUTO,
+	VIDEO_SCALER_IMPL_SWSCALE,
+	VIDEO_SCALER_IMPL_NATIVE,
 };
 
 struct video_scale_info {
@@ -217,6 +252,9 @@ struct video_scale_info {
 	uint32_t height;
 	enum video_range_type range;
 	enum video_colorspace colorspace;
+
+	/* scaler video_output_connect converts frames with, if needed */
+	enum video_scaler_impl scaler;
 };
 
 EXPORT enum video_format video_format_from_fourcc(uint32_t fourcc);
@@ -249,6 +287,19 @@ video_output_get_info(const video_t *video);
 EXPORT bool video_output_lock_frame(video_t *video, struct video_frame *frame,
 				    int count, uint64_t timestamp);
 EXPORT void video_output_unlock_frame(video_t *video);
+
+/**
+ * Queues a frame without copying it.  The frame's planes must stay valid
+ * until release is called, which happens from the video thread once every
+ * input has received all duplicates of the frame (or when the output is
+ * closed).  Returns false if the cache is full, in which case the frame is
+ * counted as skipped and release is not called.
+ */
+EXPORT bool video_output_push_external_frame(video_t *video,
+					     const struct video_data *frame,
+					     int count,
+					     void (*release)(void *param),
+					     void *param);
 EXPORT uint64_t video_output_get_frame_time(const video_t *video);
 EXPORT void video_output_stop(video_t *video);
 EXPORT bool video_output_stopped(video_t *video);
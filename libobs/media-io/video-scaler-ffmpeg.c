@@ -16,14 +16,34 @@
 ******************************************************************************/
 
 #include "../util/bmem.h"
+#include "../util/threading.h"
 #include "video-scaler.h"
+#include "format-conversion.h"
+#include "video-scaler-native.h"
 
 #include <libavutil/imgutils.h>
 #include <libswscale/swscale.h>
 
+/* large frames are converted in slices on the libobs task scheduler, like
+ * the native scaler does */
+#define MAX_CONVERT_SLICES 8
+#define MIN_CONVERT_SLICE_HEIGHT 128
+
+extern os_task_scheduler_t *obs_get_task_scheduler(void);
+
 struct video_scaler {
 	struct SwsContext *swscale;
+	video_format_convert_t convert;
+	struct video_scaler_native *native;
+	uint32_t src_width;
 	int src_height;
+
+	uint32_t num_slices;
+	uint32_t slice_height;
+	const uint8_t *const *input;
+	const uint32_t *in_linesize;
+	uint8_t *const *output;
+	const uint32_t *out_linesize;
 	int dst_heights[4];
 	uint8_t *dst_pointers[4];
 	int dst_linesizes[4];
@@ -61,6 +81,12 @@ get_ffmpeg_video_format(enum video_format format)
 		return AV_PIX_FMT_YUVA422P;
 	case VIDEO_FORMAT_YUVA:
 		return AV_PIX_FMT_YUVA444P;
+	case VIDEO_FORMAT_I010:
+		return AV_PIX_FMT_YUV420P10LE;
+	case VIDEO_FORMAT_P010:
+		return AV_PIX_FMT_P010LE;
+	case VIDEO_FORMAT_I210:
+		return AV_PIX_FMT_YUV422P10LE;
 	case VIDEO_FORMAT_NONE:
 	case VIDEO_FORMAT_YVYU:
 	case VIDEO_FORMAT_AYUV:
@@ -84,6 +110,8 @@ static inline int get_ffmpeg_scale_type(enum video_scale_type type)
 		return SWS_BILINEAR | SWS_AREA;
 	case VIDEO_SCALE_BICUBIC:
 		return SWS_BICUBIC;
+	case VIDEO_SCALE_AREA:
+		return SWS_AREA;
 	}
 
 	return SWS_POINT;
@@ -116,6 +144,49 @@ int video_scaler_create(video_scaler_t **scaler_out,
 			const struct video_scale_info *dst,
 			const struct video_scale_info *src,
 			enum video_scale_type type)
+{
+	return video_scaler_create2(scaler_out, dst, src, type,
+				    VIDEO_SCALER_IMPL_AUTO);
+}
+
+static void init_convert_slices(struct video_scaler *scaler, uint32_t height)
+{
+	uint32_t count = height / MIN_CONVERT_SLICE_HEIGHT;
+
+	if (count > MAX_CONVERT_SLICES)
+		count = MAX_CONVERT_SLICES;
+	if (!count)
+		count = 1;
+
+	/* slices have to start on even rows for subsampled chroma */
+	scaler->slice_height = ((height + count - 1) / count + 1) & ~1;
+	scaler->num_slices = (height + scaler->slice_height - 1) /
+			     scaler->slice_height;
+}
+
+static void convert_slices(void *param, size_t start, size_t end)
+{
+	struct video_scaler *scaler = param;
+	uint32_t height = (uint32_t)scaler->src_height;
+
+	for (size_t i = start; i < end; i++) {
+		uint32_t start_y = (uint32_t)i * scaler->slice_height;
+		uint32_t end_y = start_y + scaler->slice_height;
+
+		if (end_y > height)
+			end_y = height;
+
+		scaler->convert(scaler->input, scaler->in_linesize,
+				scaler->src_width, start_y, end_y,
+				scaler->output, scaler->out_linesize);
+	}
+}
+
+int video_scaler_create2(video_scaler_t **scaler_out,
+			 const struct video_scale_info *dst,
+			 const struct video_scale_info *src,
+			 enum video_scale_type type,
+			 enum video_scaler_impl impl)
 {
 	enum AVPixelFormat format_src = get_ffmpeg_video_format(src->format);
 	enum AVPixelFormat format_dst = get_ffmpeg_video_format(dst->format);
@@ -130,6 +201,36 @@ int video_scaler_create(video_scaler_t **scaler_out,
 	if (!scaler_out)
 		return VIDEO_SCALER_FAILED;
 
+	/* the native scaler and converters don't change colors */
+	if (impl != VIDEO_SCALER_IMPL_SWSCALE && coeff_src == coeff_dst &&
+	    range_src == range_dst) {
+		video_format_convert_t convert = NULL;
+		struct video_scaler_native *native = NULL;
+
+		/* conversions that only move samples don't need scaling */
+		if (src->width == dst->width && src->height == dst->height)
+			convert = video_format_get_convert(src->format,
+							   dst->format);
+		if (!convert && impl == VIDEO_SCALER_IMPL_NATIVE &&
+		    video_scaler_native_supported(dst, src))
+			native = video_scaler_native_create(dst, src, type);
+
+		if (convert || native) {
+			scaler = bzalloc(sizeof(struct video_scaler));
+			scaler->convert = convert;
+			scaler->native = native;
+			scaler->src_width = src->width;
+			scaler->src_height = src->height;
+			if (convert)
+				init_convert_slices(scaler, src->height);
+			*scaler_out = scaler;
+			return VIDEO_SCALER_SUCCESS;
+		}
+	}
+
+	if (impl == VIDEO_SCALER_IMPL_NATIVE)
+		return VIDEO_SCALER_BAD_CONVERSION;
+
 	if (format_src == AV_PIX_FMT_NONE || format_dst == AV_PIX_FMT_NONE)
 		return VIDEO_SCALER_BAD_CONVERSION;
 
@@ -187,6 +288,7 @@ fail:
 void video_scaler_destroy(video_scaler_t *scaler)
 {
 	if (scaler) {
+		video_scaler_native_destroy(scaler->native);
 		sws_freeContext(scaler->swscale);
 
 		if (scaler->dst_pointers[0])
@@ -204,6 +306,24 @@ bool video_scaler_scale(video_scaler_t *scaler, uint8_t *output[],
 	if (!scaler)
 		return false;
 
+	if (scaler->convert) {
+		scaler->input = input;
+		scaler->in_linesize = in_linesize;
+		scaler->output = output;
+		scaler->out_linesize = out_linesize;
+
+		os_task_scheduler_parallel_for(obs_get_task_scheduler(),
+					       scaler->num_slices, 1,
+					       convert_slices, scaler);
+		return true;
+	}
+
+	if (scaler->native) {
+		video_scaler_native_scale(scaler->native, output, out_linesize,
+					  input, in_linesize);
+		return true;
+	}
+
 	int ret = sws_scale(scaler->swscale, input, (const int *)in_linesize, 0,
 			    scaler->src_height, scaler->dst_pointers,
 			    scaler->dst_linesizes);
@@ -0,0 +1,686 @@
+/******************************************************************************
+    Copyright (C) 2021 by Hugh Bailey <obs.jim@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../util/bmem.h"
+#include "../util/platform.h"
+#include "../util/threading.h"
+#include "../util/sse-intrin.h"
+#include "video-scaler-native.h"
+#include "format-conversion.h"
+#include "video-frame.h"
+
+/*
+ * Frames are scaled one output row at a time: the source rows a row depends
+ * on are filtered vertically into a row of 16 bit values with INTER_BITS
+ * fractional bits, which is then filtered horizontally into the output.
+ * Filter coefficients are computed once and have COEF_BITS fractional bits.
+ *
+ * Output rows are split into slices that are scaled in parallel on the libobs
+ * task scheduler, the calling thread helps and waits for all of them.  The
+ * slices only depend on the frame height, so the output is the same however
+ * many threads there are.
+ */
+
+#define COEF_BITS 14
+#define INTER_BITS 6
+#define V_SHIFT (COEF_BITS - INTER_BITS)
+#define H_SHIFT (COEF_BITS + INTER_BITS)
+
+#define MAX_SLICES 8
+#define MIN_SLICE_HEIGHT 128
+
+extern os_task_scheduler_t *obs_get_task_scheduler(void);
+
+struct plane_info {
+	uint32_t channels;
+	uint32_t shift_x;
+	uint32_t shift_y;
+};
+
+struct filter {
+	uint32_t taps;
+	uint32_t *starts;
+	int16_t *coeffs;
+};
+
+struct scale_plane {
+	struct plane_info info;
+	uint32_t src_width;
+	uint32_t src_height;
+	uint32_t dst_width;
+	uint32_t dst_height;
+	struct filter h;
+	struct filter v;
+};
+
+struct scale_slice {
+	uint32_t start_y;
+	uint32_t end_y;
+	int16_t *row;
+	const uint8_t **src_rows;
+};
+
+struct video_scaler_native {
+	struct scale_plane planes[MAX_AV_PLANES];
+	size_t num_planes;
+	uint32_t dst_width;
+
+	/* scaled frame in the source format if the format changes */
+	video_format_convert_t convert;
+	struct video_frame frame;
+
+	struct scale_slice slices[MAX_SLICES];
+	size_t num_slices;
+
+	/* only valid while a frame is scaled */
+	const uint8_t *const *input;
+	const uint32_t *in_linesize;
+	uint8_t *const *output;
+	const uint32_t *out_linesize;
+};
+
+static inline void set_plane(struct plane_info *plane, uint32_t channels,
+			     uint32_t shift_x, uint32_t shift_y)
+{
+	plane->channels = channels;
+	plane->shift_x = shift_x;
+	plane->shift_y = shift_y;
+}
+
+static size_t get_planes(enum video_format format, struct plane_info *planes)
+{
+	switch (format) {
+	case VIDEO_FORMAT_Y800:
+		set_plane(&planes[0], 1, 0, 0);
+		return 1;
+	case VIDEO_FORMAT_NV12:
+		set_plane(&planes[0], 1, 0, 0);
+		set_plane(&planes[1], 2, 1, 1);
+		return 2;
+	case VIDEO_FORMAT_I420:
+	case VIDEO_FORMAT_I40A:
+		set_plane(&planes[0], 1, 0, 0);
+		set_plane(&planes[1], 1, 1, 1);
+		set_plane(&planes[2], 1, 1, 1);
+		set_plane(&planes[3], 1, 0, 0);
+		return format == VIDEO_FORMAT_I40A ? 4 : 3;
+	case VIDEO_FORMAT_I422:
+	case VIDEO_FORMAT_I42A:
+		set_plane(&planes[0], 1, 0, 0);
+		set_plane(&planes[1], 1, 1, 0);
+		set_plane(&planes[2], 1, 1, 0);
+		set_plane(&planes[3], 1, 0, 0);
+		return format == VIDEO_FORMAT_I42A ? 4 : 3;
+	case VIDEO_FORMAT_I444:
+	case VIDEO_FORMAT_YUVA:
+		for (size_t i = 0; i < 4; i++)
+			set_plane(&planes[i], 1, 0, 0);
+		return format == VIDEO_FORMAT_YUVA ? 4 : 3;
+	case VIDEO_FORMAT_RGBA:
+	case VIDEO_FORMAT_BGRA:
+	case VIDEO_FORMAT_BGRX:
+	case VIDEO_FORMAT_AYUV:
+		set_plane(&planes[0], 4, 0, 0);
+		return 1;
+	case VIDEO_FORMAT_NONE:
+	case VIDEO_FORMAT_YVYU:
+	case VIDEO_FORMAT_YUY2:
+	case VIDEO_FORMAT_UYVY:
+	case VIDEO_FORMAT_BGR3:
+	case VIDEO_FORMAT_I010:
+	case VIDEO_FORMAT_P010:
+	case VIDEO_FORMAT_I210:
+		break;
+	}
+
+	return 0;
+}
+
+/* ------------------------------------------------------------------------- */
+/* coefficients                                                              */
+
+static double filter_weight(enum video_scale_type type, double x)
+{
+	x = fabs(x);
+
+	if (type == VIDEO_SCALE_BICUBIC) {
+		/* Keys cubic with a = -0.5 */
+		if (x < 1.0)
+			return (1.5 * x - 2.5) * x * x + 1.0;
+		if (x < 2.0)
+			return ((-0.5 * x + 2.5) * x - 4.0) * x + 2.0;
+		return 0.0;
+	}
+
+	return x < 1.0 ? 1.0 - x : 0.0;
+}
+
+static inline double filter_radius(enum video_scale_type type)
+{
+	return type == VIDEO_SCALE_BICUBIC ? 2.0 : 1.0;
+}
+
+/* weights of source pixels lo to lo + taps - 1 for output pixel i */
+static int32_t filter_window(enum video_scale_type type, uint32_t i,
+			     double scale, uint32_t taps, double *weights)
+{
+	double center = ((double)i + 0.5) * scale - 0.5;
+	double stretch = scale > 1.0 ? scale : 1.0;
+	int32_t lo;
+
+	if (type == VIDEO_SCALE_POINT) {
+		weights[0] = 1.0;
+		return (int32_t)floor(center + 0.5);
+	}
+
+	if (type == VIDEO_SCALE_AREA && scale > 1.0) {
+		double begin = (double)i * scale;
+		double end = begin + scale;
+
+		lo = (int32_t)floor(begin);
+		for (uint32_t k = 0; k < taps; k++) {
+			double a = fmax(begin, (double)(lo + (int32_t)k));
+			double b = fmin(end, (double)(lo + (int32_t)k + 1));
+			weights[k] = b > a ? b - a : 0.0;
+		}
+		return lo;
+	}
+
+	lo = (int32_t)floor(center - filter_radius(type) * stretch) + 1;
+	for (uint32_t k = 0; k < taps; k++) {
+		double x = ((double)(lo + (int32_t)k) - center) / stretch;
+		weights[k] = filter_weight(type, x);
+	}
+	return lo;
+}
+
+static inline int32_t clamp_int32(int32_t val, int32_t min, int32_t max)
+{
+	return val < min ? min : (val > max ? max : val);
+}
+
+/*
+ * Windows are moved inside the source and weights of pixels outside of it
+ * are added to the edge pixels, so rows and columns never have to be
+ * clamped while filtering.
+ */
+static void filter_init(struct filter *f, uint32_t src_size,
+			uint32_t dst_size, enum video_scale_type type,
+			uint32_t align)
+{
+	double scale = (double)src_size / (double)dst_size;
+	double stretch = scale > 1.0 ? scale : 1.0;
+	uint32_t raw_taps;
+	double *weights;
+	double *folded;
+
+	if (type == VIDEO_SCALE_POINT)
+		raw_taps = 1;
+	else if (type == VIDEO_SCALE_AREA && scale > 1.0)
+		raw_taps = (uint32_t)ceil(scale) + 1;
+	else
+		raw_taps = (uint32_t)ceil(2.0 * filter_radius(type) * stretch) +
+			   1;
+
+	f->taps = (raw_taps + align - 1) / align * align;
+	f->starts = bmalloc(dst_size * sizeof(uint32_t));
+	f->coeffs = bzalloc(dst_size * f->taps * sizeof(int16_t));
+	weights = bmalloc(raw_taps * sizeof(double));
+	folded = bmalloc(f->taps * sizeof(double));
+
+	for (uint32_t i = 0; i < dst_size; i++) {
+		int16_t *coeffs = f->coeffs + i * f->taps;
+		int32_t lo = filter_window(type, i, scale, raw_taps, weights);
+		int32_t max_start = (int32_t)src_size - (int32_t)f->taps;
+		int32_t start = clamp_int32(lo, 0, max_start > 0 ? max_start
+								: 0);
+		double total = 0.0;
+		int32_t sum = 0;
+		uint32_t largest = 0;
+
+		memset(folded, 0, f->taps * sizeof(double));
+
+		for (uint32_t k = 0; k < raw_taps; k++) {
+			int32_t idx = clamp_int32(lo + (int32_t)k, 0,
+						  (int32_t)src_size - 1);
+			folded[idx - start] += weights[k];
+			total += weights[k];
+		}
+
+		if (total <= 0.0) {
+			folded[0] = 1.0;
+			total = 1.0;
+		}
+
+		for (uint32_t k = 0; k < f->taps; k++) {
+			coeffs[k] = (int16_t)lrint(folded[k] / total *
+						   (double)(1 << COEF_BITS));
+			sum += coeffs[k];
+			if (abs(coeffs[k]) > abs(coeffs[largest]))
+				largest = k;
+		}
+
+		/* make sure the weights add up to exactly 1.0 */
+		coeffs[largest] += (int16_t)((1 << COEF_BITS) - sum);
+		f->starts[i] = (uint32_t)start;
+	}
+
+	bfree(weights);
+	bfree(folded);
+}
+
+static void filter_free(struct filter *f)
+{
+	bfree(f->starts);
+	bfree(f->coeffs);
+}
+
+/* ------------------------------------------------------------------------- */
+/* row kernels, SSE2 maps to NEON on ARM through SIMDe                       */
+
+static inline __m128i coeff_pair(const int16_t *coeffs)
+{
+	uint32_t pair = (uint32_t)(uint16_t)coeffs[0] |
+			((uint32_t)(uint16_t)coeffs[1] << 16);
+	return _mm_set1_epi32((int)pair);
+}
+
+static inline uint8_t clamp_uint8(int32_t val)
+{
+	return (uint8_t)(val < 0 ? 0 : (val > 255 ? 255 : val));
+}
+
+static void scale_vertical(const uint8_t *const *rows, const int16_t *coeffs,
+			   uint32_t taps, int16_t *out, uint32_t count)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i round = _mm_set1_epi32(1 << (V_SHIFT - 1));
+	uint32_t x = 0;
+
+	for (; x + 8 <= count; x += 8) {
+		__m128i lo = zero;
+		__m128i hi = zero;
+
+		for (uint32_t k = 0; k < taps; k += 2) {
+			__m128i a = _mm_unpacklo_epi8(
+				_mm_loadl_epi64((const __m128i *)(rows[k] + x)),
+				zero);
+			__m128i b = _mm_unpacklo_epi8(
+				_mm_loadl_epi64(
+					(const __m128i *)(rows[k + 1] + x)),
+				zero);
+			__m128i c = coeff_pair(coeffs + k);
+			__m128i ab_lo = _mm_unpacklo_epi16(a, b);
+			__m128i ab_hi = _mm_unpackhi_epi16(a, b);
+
+			lo = _mm_add_epi32(lo, _mm_madd_epi16(ab_lo, c));
+			hi = _mm_add_epi32(hi, _mm_madd_epi16(ab_hi, c));
+		}
+
+		lo = _mm_srai_epi32(_mm_add_epi32(lo, round), V_SHIFT);
+		hi = _mm_srai_epi32(_mm_add_epi32(hi, round), V_SHIFT);
+		_mm_storeu_si128((__m128i *)(out + x), _mm_packs_epi32(lo, hi));
+	}
+
+	for (; x < count; x++) {
+		int32_t sum = 0;
+
+		for (uint32_t k = 0; k < taps; k++)
+			sum += rows[k][x] * coeffs[k];
+		out[x] = (int16_t)((sum + (1 << (V_SHIFT - 1))) >> V_SHIFT);
+	}
+}
+
+static inline __m128i load_taps(const int16_t *a, const int16_t *b)
+{
+	return _mm_unpacklo_epi64(_mm_loadl_epi64((const __m128i *)a),
+				  _mm_loadl_epi64((const __m128i *)b));
+}
+
+/* output rows have no alignment guarantees */
+static inline void store_u16(uint8_t *out, __m128i val)
+{
+	uint16_t bits = (uint16_t)_mm_cvtsi128_si32(val);
+	memcpy(out, &bits, sizeof(bits));
+}
+
+static inline void store_u32(uint8_t *out, __m128i val)
+{
+	uint32_t bits = (uint32_t)_mm_cvtsi128_si32(val);
+	memcpy(out, &bits, sizeof(bits));
+}
+
+/* taps are a multiple of 4 for single channel planes, four pixels per step */
+static void scale_horizontal_1(const int16_t *in, const struct filter *f,
+			       uint8_t *out, uint32_t count)
+{
+	const __m128i round = _mm_set1_epi32(1 << (H_SHIFT - 1));
+	const uint32_t taps = f->taps;
+	uint32_t x = 0;
+
+	for (; x + 4 <= count; x += 4) {
+		const uint32_t *starts = f->starts + x;
+		const int16_t *coeffs = f->coeffs + x * taps;
+		__m128i acc01 = _mm_setzero_si128();
+		__m128i acc23 = _mm_setzero_si128();
+		__m128 even, odd;
+		__m128i sum;
+
+		for (uint32_t k = 0; k < taps; k += 4) {
+			__m128i v01 = load_taps(in + starts[0] + k,
+						in + starts[1] + k);
+			__m128i v23 = load_taps(in + starts[2] + k,
+						in + starts[3] + k);
+			__m128i c01 = load_taps(coeffs + k, coeffs + taps + k);
+			__m128i c23 = load_taps(coeffs + taps * 2 + k,
+						coeffs + taps * 3 + k);
+
+			acc01 = _mm_add_epi32(acc01, _mm_madd_epi16(v01, c01));
+			acc23 = _mm_add_epi32(acc23, _mm_madd_epi16(v23, c23));
+		}
+
+		/* add up the two partial sums of every pixel */
+		even = _mm_shuffle_ps(_mm_castsi128_ps(acc01),
+				      _mm_castsi128_ps(acc23),
+				      _MM_SHUFFLE(2, 0, 2, 0));
+		odd = _mm_shuffle_ps(_mm_castsi128_ps(acc01),
+				     _mm_castsi128_ps(acc23),
+				     _MM_SHUFFLE(3, 1, 3, 1));
+		sum = _mm_add_epi32(_mm_castps_si128(even),
+				    _mm_castps_si128(odd));
+
+		sum = _mm_srai_epi32(_mm_add_epi32(sum, round), H_SHIFT);
+		sum = _mm_packs_epi32(sum, sum);
+		sum = _mm_packus_epi16(sum, sum);
+		store_u32(out + x, sum);
+	}
+
+	for (; x < count; x++) {
+		const int16_t *src = in + f->starts[x];
+		const int16_t *coeffs = f->coeffs + x * taps;
+		int32_t sum = 1 << (H_SHIFT - 1);
+
+		for (uint32_t k = 0; k < taps; k++)
+			sum += src[k] * coeffs[k];
+		out[x] = clamp_uint8(sum >> H_SHIFT);
+	}
+}
+
+/* two taps per step, shuffled so that madd pairs them per channel */
+static void scale_horizontal_2(const int16_t *in, const struct filter *f,
+			       uint8_t *out, uint32_t count)
+{
+	const __m128i round = _mm_set1_epi32(1 << (H_SHIFT - 1));
+
+	for (uint32_t x = 0; x < count; x++) {
+		const int16_t *src = in + f->starts[x] * 2;
+		const int16_t *coeffs = f->coeffs + x * f->taps;
+		__m128i acc = round;
+
+		for (uint32_t k = 0; k < f->taps; k += 2) {
+			__m128i c = coeff_pair(coeffs + k);
+			__m128i val =
+				_mm_loadl_epi64((const __m128i *)(src + k * 2));
+
+			val = _mm_shufflelo_epi16(val, _MM_SHUFFLE(3, 1, 2, 0));
+			acc = _mm_add_epi32(acc, _mm_madd_epi16(val, c));
+		}
+
+		acc = _mm_srai_epi32(acc, H_SHIFT);
+		acc = _mm_packs_epi32(acc, acc);
+		acc = _mm_packus_epi16(acc, acc);
+		store_u16(out + x * 2, acc);
+	}
+}
+
+/* two pixels per step, interleaved so that madd pairs their channels */
+static void scale_horizontal_4(const int16_t *in, const struct filter *f,
+			       uint8_t *out, uint32_t count)
+{
+	const __m128i round = _mm_set1_epi32(1 << (H_SHIFT - 1));
+
+	for (uint32_t x = 0; x < count; x++) {
+		const int16_t *src = in + f->starts[x] * 4;
+		const int16_t *coeffs = f->coeffs + x * f->taps;
+		__m128i acc = round;
+
+		for (uint32_t k = 0; k < f->taps; k += 2) {
+			__m128i c = coeff_pair(coeffs + k);
+			__m128i val =
+				_mm_loadu_si128((const __m128i *)(src + k * 4));
+
+			val = _mm_unpacklo_epi16(val, _mm_srli_si128(val, 8));
+			acc = _mm_add_epi32(acc, _mm_madd_epi16(val, c));
+		}
+
+		acc = _mm_srai_epi32(acc, H_SHIFT);
+		acc = _mm_packs_epi32(acc, acc);
+		acc = _mm_packus_epi16(acc, acc);
+		store_u32(out + x * 4, acc);
+	}
+}
+
+/* ------------------------------------------------------------------------- */
+
+static void scale_plane_rows(struct scale_slice *slice, struct scale_plane *p,
+			     const uint8_t *input, uint32_t in_linesize,
+			     uint8_t *output, uint32_t out_linesize)
+{
+	const uint32_t shift_y = p->info.shift_y;
+	const uint32_t channels = p->info.channels;
+	const uint32_t start_y = slice->start_y >> shift_y;
+	const uint32_t end_y = slice->end_y >> shift_y;
+	const uint32_t count = p->src_width * channels;
+	const uint8_t **rows = slice->src_rows;
+	int16_t *inter = slice->row;
+
+	for (uint32_t y = start_y; y < end_y; y++) {
+		const int16_t *coeffs = p->v.coeffs + y * p->v.taps;
+		uint32_t start = p->v.starts[y];
+		uint8_t *out = output + y * out_linesize;
+
+		for (uint32_t k = 0; k < p->v.taps; k++) {
+			uint32_t row = start + k;
+			if (row >= p->src_height)
+				row = p->src_height - 1;
+			rows[k] = input + row * in_linesize;
+		}
+
+		scale_vertical(rows, coeffs, p->v.taps, inter, count);
+
+		if (channels == 1)
+			scale_horizontal_1(inter, &p->h, out, p->dst_width);
+		else if (channels == 2)
+			scale_horizontal_2(inter, &p->h, out, p->dst_width);
+		else
+			scale_horizontal_4(inter, &p->h, out, p->dst_width);
+	}
+}
+
+static void scale_slice(struct video_scaler_native *scaler,
+			struct scale_slice *slice)
+{
+	uint8_t *const *output = scaler->output;
+	const uint32_t *out_linesize = scaler->out_linesize;
+
+	if (scaler->convert) {
+		output = scaler->frame.data;
+		out_linesize = scaler->frame.linesize;
+	}
+
+	for (size_t i = 0; i < scaler->num_planes; i++) {
+		scale_plane_rows(slice, &scaler->planes[i], scaler->input[i],
+				 scaler->in_linesize[i], output[i],
+				 out_linesize[i]);
+	}
+
+	if (scaler->convert) {
+		scaler->convert((const uint8_t *const *)scaler->frame.data,
+				scaler->frame.linesize, scaler->dst_width,
+				slice->start_y, slice->end_y, scaler->output,
+				scaler->out_linesize);
+	}
+}
+
+static void scale_slices(void *param, size_t start, size_t end)
+{
+	struct video_scaler_native *scaler = param;
+
+	for (size_t i = start; i < end; i++)
+		scale_slice(scaler, &scaler->slices[i]);
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* subsampled planes are rounded down, like in video_frame_init */
+bool video_scaler_native_supported(const struct video_scale_info *dst,
+				   const struct video_scale_info *src)
+{
+	struct plane_info planes[MAX_AV_PLANES];
+	size_t num_planes = get_planes(src->format, planes);
+
+	if (!num_planes)
+		return false;
+
+	for (size_t i = 0; i < num_planes; i++) {
+		uint32_t shift_x = planes[i].shift_x;
+		uint32_t shift_y = planes[i].shift_y;
+
+		if (!(src->width >> shift_x) || !(src->height >> shift_y) ||
+		    !(dst->width >> shift_x) || !(dst->height >> shift_y))
+			return false;
+	}
+
+	return src->format == dst->format ||
+	       video_format_get_convert(src->format, dst->format) != NULL;
+}
+
+static size_t get_num_slices(uint32_t height)
+{
+	size_t count = height / MIN_SLICE_HEIGHT;
+
+	if (count > MAX_SLICES)
+		count = MAX_SLICES;
+	return count ? count : 1;
+}
+
+struct video_scaler_native *
+video_scaler_native_create(const struct video_scale_info *dst,
+			   const struct video_scale_info *src,
+			   enum video_scale_type type)
+{
+	struct plane_info planes[MAX_AV_PLANES];
+	struct video_scaler_native *scaler;
+	uint32_t max_row = 0;
+	uint32_t max_taps = 0;
+	uint32_t slice_height;
+
+	if (!video_scaler_native_supported(dst, src))
+		return NULL;
+
+	if (type == VIDEO_SCALE_DEFAULT || type == VIDEO_SCALE_FAST_BILINEAR)
+		type = VIDEO_SCALE_BILINEAR;
+
+	scaler = bzalloc(sizeof(struct video_scaler_native));
+	scaler->num_planes = get_planes(src->format, planes);
+	scaler->dst_width = dst->width;
+
+	for (size_t i = 0; i < scaler->num_planes; i++) {
+		struct scale_plane *p = &scaler->planes[i];
+		uint32_t row;
+
+		p->info = planes[i];
+		p->src_width = src->width >> p->info.shift_x;
+		p->src_height = src->height >> p->info.shift_y;
+		p->dst_width = dst->width >> p->info.shift_x;
+		p->dst_height = dst->height >> p->info.shift_y;
+
+		filter_init(&p->h, p->src_width, p->dst_width, type,
+			    p->info.channels == 1 ? 4 : 2);
+		filter_init(&p->v, p->src_height, p->dst_height, type, 2);
+
+		/* horizontal filters may read up to taps past the row */
+		row = (p->src_width + p->h.taps) * p->info.channels + 8;
+		if (row > max_row)
+			max_row = row;
+		if (p->v.taps > max_taps)
+			max_taps = p->v.taps;
+	}
+
+	if (src->format != dst->format) {
+		scaler->convert =
+			video_format_get_convert(src->format, dst->format);
+		video_frame_init(&scaler->frame, src->format, dst->width,
+				 dst->height);
+	}
+
+	/* slices start on even rows so that chroma rows aren't split */
+	scaler->num_slices = get_num_slices(dst->height);
+	slice_height = (dst->height / (uint32_t)scaler->num_slices + 1) & ~1;
+
+	for (size_t i = 0; i < scaler->num_slices; i++) {
+		struct scale_slice *slice = &scaler->slices[i];
+
+		slice->start_y = (uint32_t)i * slice_height;
+		slice->end_y = i + 1 == scaler->num_slices
+				       ? dst->height
+				       : slice->start_y + slice_height;
+		slice->row = bzalloc(max_row * sizeof(int16_t));
+		slice->src_rows = bzalloc(max_taps * sizeof(uint8_t *));
+	}
+
+	return scaler;
+}
+
+void video_scaler_native_destroy(struct video_scaler_native *scaler)
+{
+	if (!scaler)
+		return;
+
+	for (size_t i = 0; i < scaler->num_slices; i++) {
+		bfree(scaler->slices[i].row);
+		bfree(scaler->slices[i].src_rows);
+	}
+
+	for (size_t i = 0; i < scaler->num_planes; i++) {
+		filter_free(&scaler->planes[i].h);
+		filter_free(&scaler->planes[i].v);
+	}
+
+	video_frame_free(&scaler->frame);
+	bfree(scaler);
+}
+
+void video_scaler_native_scale(struct video_scaler_native *scaler,
+			       uint8_t *const output[],
+			       const uint32_t out_linesize[],
+			       const uint8_t *const input[],
+			       const uint32_t in_linesize[])
+{
+	scaler->input = input;
+	scaler->in_linesize = in_linesize;
+	scaler->output = output;
+	scaler->out_linesize = out_linesize;
+
+	os_task_scheduler_parallel_for(obs_get_task_scheduler(),
+				       scaler->num_slices, 1, scale_slices,
+				       scaler);
+}
@@ -0,0 +1,46 @@
+/******************************************************************************
+    Copyright (C) 2021 by Hugh Bailey <obs.jim@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#pragma once
+
+#include "video-scaler.h"
+
+/*
+ * Native scaler used by video_scaler_t
+ *
+ * Scales planar and packed 8 bit formats with separable filters, and
+ * optionally converts the result with the format converters.  Frames are
+ * split into slices of rows that are scaled in parallel.  It does not change
+ * color spaces or ranges.
+ */
+
+struct video_scaler_native;
+
+bool video_scaler_native_supported(const struct video_scale_info *dst,
+				   const struct video_scale_info *src);
+
+struct video_scaler_native *
+video_scaler_native_create(const struct video_scale_info *dst,
+			   const struct video_scale_info *src,
+			   enum video_scale_type type);
+void video_scaler_native_destroy(struct video_scaler_native *scaler);
+
+void video_scaler_native_scale(struct video_scaler_native *scaler,
+			       uint8_t *const output[],
+			       const uint32_t out_linesize[],
+			       const uint8_t *const input[],
+			       const uint32_t in_linesize[]);
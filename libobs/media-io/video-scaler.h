@@ -31,10 +31,16 @@ typedef struct video_scaler video_scaler_t;
 #define VIDEO_SCALER_BAD_CONVERSION -1
 #define VIDEO_SCALER_FAILED -2
 
+/* see enum video_scaler_impl in video-io.h for which scaler is used */
 EXPORT int video_scaler_create(video_scaler_t **scaler,
 			       const struct video_scale_info *dst,
 			       const struct video_scale_info *src,
 			       enum video_scale_type type);
+EXPORT int video_scaler_create2(video_scaler_t **scaler,
+				const struct video_scale_info *dst,
+				const struct video_scale_info *src,
+				enum video_scale_type type,
+				enum video_scaler_impl impl);
 EXPORT void video_scaler_destroy(video_scaler_t *scaler);
 
 EXPORT bool video_scaler_scale(video_scaler_t *scaler, uint8_t *output[],
@@ -23,7 +23,7 @@
 #define set_encoder_active(encoder, val) \
 	os_atomic_set_bool(&encoder->active, val)
 
-struct obs_encoder_info *find_encoder(const char *id)
+static struct obs_encoder_info *find_encoder_type(const char *id)
 {
 	for (size_t i = 0; i < obs->encoder_types.num; i++) {
 		struct obs_encoder_info *info = obs->encoder_types.array + i;
@@ -35,6 +35,15 @@ struct obs_encoder_info *find_encoder(const char *id)
 	return NULL;
 }
 
+struct obs_encoder_info *find_encoder(const char *id)
+{
+	struct obs_encoder_info *info = find_encoder_type(id);
+
+	if (!info && obs_load_deferred_module_for_type("encoders", id))
+		info = find_encoder_type(id);
+	return info;
+}
+
 const char *obs_encoder_get_display_name(const char *id)
 {
 	struct obs_encoder_info *ei = find_encoder(id);
@@ -115,7 +124,8 @@ create_encoder(const char *id, enum obs_encoder_type type, const char *name,
 	encoder->control->encoder = encoder;
 
 	obs_context_data_insert(&encoder->context, &obs->data.encoders_mutex,
-				&obs->data.first_encoder);
+				&obs->data.first_encoder,
+				&obs->data.encoders_index);
 
 	blog(LOG_DEBUG, "encoder '%s' (%s) created", name, id);
 	return encoder;
@@ -172,6 +182,7 @@ static inline void get_video_info(struct obs_encoder *encoder,
 	info->range = voi->range;
 	info->width = obs_encoder_get_width(encoder);
 	info->height = obs_encoder_get_height(encoder);
+	info->scaler = encoder->scaler;
 
 	if (encoder->info.get_video_info)
 		encoder->info.get_video_info(encoder->context.data, info);
@@ -698,6 +709,29 @@ void obs_encoder_set_scaled_size(obs_encoder_t *encoder, uint32_t width,
 	encoder->scaled_height = height;
 }
 
+void obs_encoder_set_scaler(obs_encoder_t *encoder,
+			    enum video_scaler_impl scaler)
+{
+	if (!obs_encoder_valid(encoder, "obs_encoder_set_scaler"))
+		return;
+	if (encoder->info.type != OBS_ENCODER_VIDEO) {
+		blog(LOG_WARNING,
+		     "obs_encoder_set_scaler: "
+		     "encoder '%s' is not a video encoder",
+		     obs_encoder_get_name(encoder));
+		return;
+	}
+	if (encoder_active(encoder)) {
+		blog(LOG_WARNING,
+		     "encoder '%s': Cannot set the scaler "
+		     "while the encoder is active",
+		     obs_encoder_get_name(encoder));
+		return;
+	}
+
+	encoder->scaler = scaler;
+}
+
 bool obs_encoder_scaling_enabled(const obs_encoder_t *encoder)
 {
 	if (!obs_encoder_valid(encoder, "obs_encoder_scaling_enabled"))
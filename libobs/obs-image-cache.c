@@ -0,0 +1,507 @@
+/******************************************************************************
+    Copyright (C) 2021 by Hugh Bailey <obs.jim@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include <sys/stat.h>
+#include <inttypes.h>
+
+#include "util/platform.h"
+#include "graphics/image-file.h"
+#include "obs-internal.h"
+
+/*
+ * Image cache
+ *
+ * Decoded images are shared by everything that loads the same file with the
+ * same alpha mode, keyed by the path and the modification time of the file.
+ * The texture of an image is created the first time it is needed and is
+ * shared as well.  Images nobody references anymore stay cached, most
+ * recently used first, until the resident size of the cache exceeds its
+ * budget.  Animated images are not shared, as every user animates them
+ * separately; the decoded animation is handed to the first user that takes
+ * it.  Acquiring the file again after that decodes it again, in the
+ * background like any other miss.
+ */
+
+#define DEFAULT_BUDGET (512ULL * 1024ULL * 1024ULL)
+
+#define FNV_OFFSET 0xCBF29CE484222325ULL
+#define FNV_PRIME 0x100000001B3ULL
+
+struct obs_cached_image {
+	struct obs_cached_image *prev;
+	struct obs_cached_image *next;
+
+	char *path;
+	uint64_t hash;
+	time_t mtime;
+	enum gs_image_alpha_mode alpha_mode;
+
+	long refs;
+	bool cached;
+	volatile bool pending;
+	os_event_t *decoded_event;
+
+	gs_image_file3_t if3;
+	gs_atlas_region_t *region;
+	bool animated;
+	bool taken;
+	bool textured;
+	uint64_t size;
+};
+
+static uint64_t hash_path(const char *path)
+{
+	uint64_t hash = FNV_OFFSET;
+
+	while (*path) {
+		hash ^= (uint8_t)*(path++);
+		hash *= FNV_PRIME;
+	}
+
+	return hash;
+}
+
+static time_t get_modified_timestamp(const char *path)
+{
+	struct stat stats;
+	if (os_stat(path, &stats) != 0)
+		return -1;
+	return stats.st_mtime;
+}
+
+bool obs_init_image_cache(void)
+{
+	struct obs_core_image_cache *cache = &obs->image_cache;
+
+	cache->budget = DEFAULT_BUDGET;
+	return pthread_mutex_init(&cache->mutex, NULL) == 0;
+}
+
+static void image_destroy(struct obs_cached_image *image)
+{
+	if (image->region || image->textured) {
+		obs_enter_graphics();
+		gs_atlas_region_destroy(image->region);
+		gs_image_file3_free(&image->if3);
+		obs_leave_graphics();
+	} else {
+		gs_image_file3_free(&image->if3);
+	}
+
+	os_event_destroy(image->decoded_event);
+	bfree(image->path);
+	bfree(image);
+}
+
+void obs_free_image_cache(void)
+{
+	struct obs_core_image_cache *cache = &obs->image_cache;
+	struct obs_cached_image *image;
+
+	/* decode tasks still queued reference their images */
+	os_task_scheduler_wait(obs->task_scheduler);
+	image = cache->first;
+
+	if (cache->hits || cache->misses)
+		blog(LOG_INFO,
+		     "Image cache: %" PRIu64 " hit(s), %" PRIu64
+		     " miss(es), %" PRIu64 " eviction(s)",
+		     cache->hits, cache->misses, cache->evictions);
+
+	while (image) {
+		struct obs_cached_image *next = image->next;
+		image_destroy(image);
+		image = next;
+	}
+
+	cache->first = NULL;
+	cache->last = NULL;
+	pthread_mutex_destroy(&cache->mutex);
+}
+
+/* ------------------------------------------------------------------------- */
+
+static inline void unlink_image(struct obs_core_image_cache *cache,
+				struct obs_cached_image *image)
+{
+	if (image->prev)
+		image->prev->next = image->next;
+	else
+		cache->first = image->next;
+
+	if (image->next)
+		image->next->prev = image->prev;
+	else
+		cache->last = image->prev;
+
+	image->prev = NULL;
+	image->next = NULL;
+	image->cached = false;
+
+	cache->bytes_resident -= image->size;
+	cache->images--;
+}
+
+static inline void link_image_first(struct obs_core_image_cache *cache,
+				    struct obs_cached_image *image)
+{
+	image->prev = NULL;
+	image->next = cache->first;
+
+	if (cache->first)
+		cache->first->prev = image;
+	else
+		cache->last = image;
+
+	cache->first = image;
+	image->cached = true;
+
+	cache->bytes_resident += image->size;
+	cache->images++;
+}
+
+/* unlinks the least recently used images nobody references until the cache
+ * fits its budget again.  they are returned as a list, as destroying them may
+ * need the graphics context, which must not be entered with the cache locked.
+ */
+static struct obs_cached_image *
+evict_images(struct obs_core_image_cache *cache)
+{
+	struct obs_cached_image *evicted = NULL;
+	struct obs_cached_image *image = cache->last;
+
+	while (image && cache->bytes_resident > cache->budget) {
+		struct obs_cached_image *prev = image->prev;
+
+		if (!image->refs) {
+			unlink_image(cache, image);
+			image->next = evicted;
+			evicted = image;
+			cache->evictions++;
+		}
+
+		image = prev;
+	}
+
+	return evicted;
+}
+
+static void destroy_images(struct obs_cached_image *image)
+{
+	while (image) {
+		struct obs_cached_image *next = image->next;
+		image_destroy(image);
+		image = next;
+	}
+}
+
+static void decode_image(void *param)
+{
+	struct obs_core_image_cache *cache = &obs->image_cache;
+	struct obs_cached_image *image = param;
+	struct obs_cached_image *evicted;
+	gs_image_file_t *file = &image->if3.image2.image;
+
+	gs_image_file3_init(&image->if3, image->path, image->alpha_mode);
+	image->animated = file->is_animated_gif;
+
+	pthread_mutex_lock(&cache->mutex);
+
+	image->size = image->if3.image2.mem_usage;
+	if (image->cached)
+		cache->bytes_resident += image->size;
+
+	evicted = evict_images(cache);
+
+	pthread_mutex_unlock(&cache->mutex);
+
+	os_atomic_set_bool(&image->pending, false);
+	os_event_signal(image->decoded_event);
+
+	destroy_images(evicted);
+	obs_cached_image_release(image);
+}
+
+static struct obs_cached_image *
+find_image(struct obs_core_image_cache *cache, const char *path,
+	   uint64_t hash, time_t mtime, enum gs_image_alpha_mode alpha_mode)
+{
+	struct obs_cached_image *image = cache->first;
+
+	while (image) {
+		if (image->hash == hash && image->mtime == mtime &&
+		    image->alpha_mode == alpha_mode &&
+		    strcmp(image->path, path) == 0)
+			return image;
+
+		image = image->next;
+	}
+
+	return NULL;
+}
+
+/* drops outdated versions of the file that nobody references anymore */
+static struct obs_cached_image *
+drop_outdated(struct obs_core_image_cache *cache, const char *path,
+	      uint64_t hash, time_t mtime)
+{
+	struct obs_cached_image *evicted = NULL;
+	struct obs_cached_image *image = cache->first;
+
+	while (image) {
+		struct obs_cached_image *next = image->next;
+
+		if (image->hash == hash && image->mtime != mtime &&
+		    strcmp(image->path, path) == 0) {
+			unlink_image(cache, image);
+
+			if (!image->refs) {
+				image->next = evicted;
+				evicted = image;
+			}
+		}
+
+		image = next;
+	}
+
+	return evicted;
+}
+
+obs_cached_image_t *obs_image_cache_acquire(const char *path,
+					    enum gs_image_alpha_mode alpha_mode,
+					    bool wait)
+{
+	struct obs_core_image_cache *cache = &obs->image_cache;
+	struct obs_cached_image *image;
+	struct obs_cached_image *outdated;
+	uint64_t hash;
+	time_t mtime;
+	bool decode = false;
+
+	if (!obs_ptr_valid(path, "obs_image_cache_acquire") || !*path)
+		return NULL;
+
+	hash = hash_path(path);
+	mtime = get_modified_timestamp(path);
+
+	pthread_mutex_lock(&cache->mutex);
+
+	outdated = drop_outdated(cache, path, hash, mtime);
+	image = find_image(cache, path, hash, mtime, alpha_mode);
+
+	/* the animation has been handed out, so it has to be decoded again */
+	if (image && image->taken) {
+		unlink_image(cache, image);
+
+		if (!image->refs) {
+			image->next = outdated;
+			outdated = image;
+		}
+
+		image = NULL;
+	}
+
+	if (image) {
+		unlink_image(cache, image);
+		link_image_first(cache, image);
+		cache->hits++;
+	} else {
+		image = bzalloc(sizeof(struct obs_cached_image));
+		image->path = bstrdup(path);
+		image->hash = hash;
+		image->mtime = mtime;
+		image->alpha_mode = alpha_mode;
+		image->pending = true;
+		os_event_init(&image->decoded_event, OS_EVENT_TYPE_MANUAL);
+		link_image_first(cache, image);
+		cache->misses++;
+		decode = true;
+	}
+
+	image->refs++;
+
+	/* the decode task holds its own reference */
+	if (decode)
+		image->refs++;
+
+	pthread_mutex_unlock(&cache->mutex);
+
+	destroy_images(outdated);
+
+	if (decode) {
+		os_task_scheduler_t *ts = obs->task_scheduler;
+
+		if (wait || !ts ||
+		    !os_task_scheduler_queue(ts, decode_image, image,
+					     OS_TASK_PRIORITY_LOW, -1))
+			decode_image(image);
+	}
+
+	if (wait && os_atomic_load_bool(&image->pending))
+		os_event_wait(image->decoded_event);
+
+	return image;
+}
+
+void obs_cached_image_release(obs_cached_image_t *image)
+{
+	struct obs_core_image_cache *cache = &obs->image_cache;
+	struct obs_cached_image *evicted = NULL;
+
+	if (!image)
+		return;
+
+	pthread_mutex_lock(&cache->mutex);
+
+	if (--image->refs == 0) {
+		if (image->cached) {
+			evicted = evict_images(cache);
+		} else {
+			image->next = NULL;
+			evicted = image;
+		}
+	}
+
+	pthread_mutex_unlock(&cache->mutex);
+
+	destroy_images(evicted);
+}
+
+bool obs_cached_image_pending(const obs_cached_image_t *image)
+{
+	return image ? os_atomic_load_bool(&image->pending) : false;
+}
+
+bool obs_cached_image_loaded(const obs_cached_image_t *image)
+{
+	return image && !obs_cached_image_pending(image) && !image->animated &&
+	       image->if3.image2.image.loaded;
+}
+
+bool obs_cached_image_animated(const obs_cached_image_t *image)
+{
+	return image && !obs_cached_image_pending(image) && image->animated;
+}
+
+bool obs_cached_image_take_animated(obs_cached_image_t *image,
+				    gs_image_file3_t *if3)
+{
+	struct obs_core_image_cache *cache = &obs->image_cache;
+	bool taken = false;
+
+	if (!obs_cached_image_animated(image) ||
+	    !obs_ptr_valid(if3, "obs_cached_image_take_animated"))
+		return false;
+
+	pthread_mutex_lock(&cache->mutex);
+
+	if (image->if3.image2.image.loaded) {
+		*if3 = image->if3;
+		memset(&image->if3, 0, sizeof(image->if3));
+
+		if (image->cached)
+			cache->bytes_resident -= image->size;
+		image->size = 0;
+		image->taken = true;
+		taken = true;
+	}
+
+	pthread_mutex_unlock(&cache->mutex);
+	return taken;
+}
+
+uint32_t obs_cached_image_get_width(const obs_cached_image_t *image)
+{
+	return obs_cached_image_loaded(image) ? image->if3.image2.image.cx : 0;
+}
+
+uint32_t obs_cached_image_get_height(const obs_cached_image_t *image)
+{
+	return obs_cached_image_loaded(image) ? image->if3.image2.image.cy : 0;
+}
+
+uint64_t obs_cached_image_get_memory_usage(const obs_cached_image_t *image)
+{
+	return obs_cached_image_loaded(image) ? image->size : 0;
+}
+
+/* small images are packed into the shared texture atlas so that they can be
+ * batched with each other */
+static void create_texture(struct obs_cached_image *image)
+{
+	gs_image_file_t *file = &image->if3.image2.image;
+
+	image->region = gs_atlas_region_create(file->format, file->cx,
+					       file->cy, file->texture_data,
+					       file->cx * 4);
+
+	if (image->region) {
+		bfree(file->texture_data);
+		file->texture_data = NULL;
+	} else {
+		gs_image_file3_init_texture(&image->if3);
+	}
+
+	image->textured = true;
+}
+
+gs_texture_t *obs_cached_image_get_texture(obs_cached_image_t *image)
+{
+	if (!obs_cached_image_loaded(image))
+		return NULL;
+
+	if (!image->textured)
+		create_texture(image);
+
+	return image->region ? gs_atlas_region_get_texture(image->region)
+			     : image->if3.image2.image.texture;
+}
+
+gs_atlas_region_t *obs_cached_image_get_atlas_region(obs_cached_image_t *image)
+{
+	return obs_cached_image_get_texture(image) ? image->region : NULL;
+}
+
+void obs_image_cache_set_budget(uint64_t bytes)
+{
+	struct obs_core_image_cache *cache = &obs->image_cache;
+	struct obs_cached_image *evicted;
+
+	pthread_mutex_lock(&cache->mutex);
+	cache->budget = bytes;
+	evicted = evict_images(cache);
+	pthread_mutex_unlock(&cache->mutex);
+
+	destroy_images(evicted);
+}
+
+void obs_image_cache_get_stats(struct obs_image_cache_stats *stats)
+{
+	struct obs_core_image_cache *cache = &obs->image_cache;
+
+	if (!obs_ptr_valid(stats, "obs_image_cache_get_stats"))
+		return;
+
+	pthread_mutex_lock(&cache->mutex);
+	stats->hits = cache->hits;
+	stats->misses = cache->misses;
+	stats->evictions = cache->evictions;
+	stats->bytes_resident = cache->bytes_resident;
+	stats->budget = cache->budget;
+	stats->images = cache->images;
+	pthread_mutex_unlock(&cache->mutex);
+}
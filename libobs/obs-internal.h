@@ -31,6 +31,7 @@
 #include "graphics/matrix4.h"
 
 #include "media-io/audio-resampler.h"
+#include "media-io/audio-converter.h"
 #include "media-io/video-io.h"
 #include "media-io/audio-io.h"
 
@@ -40,6 +41,9 @@
 
 #define NUM_TEXTURES 2
 #define NUM_CHANNELS 3
+/* staging surfaces used for zero-copy readback: one per frame in the
+ * video-io cache, plus one being staged and one being mapped */
+#define NUM_STAGE_SURFACES 8
 #define MICROSECOND_DEN 1000000
 #define NUM_ENCODE_TEXTURES 3
 #define NUM_ENCODE_TEXTURE_FRAMES_TO_WAIT 1
@@ -103,11 +107,28 @@ struct obs_module {
 	const char *(*description)(void);
 	const char *(*author)(void);
 
+	uint64_t load_time_ns;
+	obs_data_t *manifest;
+
 	struct obs_module *next;
 };
 
 extern void free_module(struct obs_module *mod);
 
+/* module found on a previous run whose manifest says it only registers
+ * types; it isn't opened until one of those types is first used */
+struct obs_deferred_module {
+	char *bin_path;
+	char *data_path;
+	obs_data_t *manifest;
+};
+
+extern bool obs_load_deferred_module_for_type(const char *list,
+					      const char *id);
+extern void obs_load_deferred_modules(void);
+extern void obs_save_module_manifest(void);
+extern void obs_free_deferred_modules(void);
+
 struct obs_module_path {
 	char *bin;
 	char *data;
@@ -243,9 +264,78 @@ struct obs_task_info {
 	void *param;
 };
 
+/* per-source cost accounting.  every counter has a single writer at a time
+ * and is read without locking through a sequence count */
+struct obs_perf_counter {
+	volatile long seq;
+	uint64_t count;
+	uint64_t total;
+};
+
+static inline void obs_perf_counter_add(struct obs_perf_counter *counter,
+					uint64_t val)
+{
+	os_atomic_inc_long(&counter->seq);
+	counter->count++;
+	counter->total += val;
+	os_atomic_inc_long(&counter->seq);
+}
+
+extern void obs_perf_counter_read(const struct obs_perf_counter *counter,
+				  uint64_t *count, uint64_t *total);
+
+struct obs_source_perf {
+	struct obs_perf_counter tick;
+	struct obs_perf_counter render;
+	struct obs_perf_counter gpu;
+	struct obs_perf_counter upload;
+	struct obs_perf_counter audio;
+};
+
+/* GPU time of source renders is measured with timer queries, which are read
+ * back a few frames later so that the graphics thread never waits on them */
+#define GPU_TIMING_FRAMES 3
+#define GPU_TIMING_NONE ((size_t)-1)
+
+struct gpu_timing_record {
+	obs_weak_source_t *source;
+	gs_timer_t *timer;
+	size_t parent;
+	uint64_t child_ticks;
+	bool child_failed;
+};
+
+struct gpu_timing_frame {
+	DARRAY(struct gpu_timing_record) records;
+	gs_timer_range_t *range;
+	bool active;
+};
+
+struct obs_gpu_timing {
+	struct gpu_timing_frame frames[GPU_TIMING_FRAMES];
+	DARRAY(gs_timer_t *) free_timers;
+	size_t cur_frame;
+	size_t parent;
+	bool recording;
+};
+
+struct obs_core_video;
+
+extern void obs_gpu_timing_frame_begin(struct obs_core_video *video);
+extern void obs_gpu_timing_frame_end(struct obs_core_video *video);
+extern void obs_gpu_timing_free(struct obs_core_video *video);
+extern size_t obs_gpu_timing_begin(struct obs_source *source);
+extern void obs_gpu_timing_end(size_t record);
+
 struct obs_core_video {
 	graphics_t *graphics;
-	gs_stagesurf_t *copy_surfaces[NUM_TEXTURES][NUM_CHANNELS];
+	gs_stagesurf_t *copy_surfaces[NUM_STAGE_SURFACES][NUM_CHANNELS];
+	size_t num_stage_surfaces;
+	int staged_surfaces[NUM_TEXTURES];
+	bool stage_surfaces_mapped[NUM_STAGE_SURFACES];
+	volatile bool stage_surfaces_busy[NUM_STAGE_SURFACES];
+	bool zero_copy;
+	bool zero_copy_active;
 	gs_texture_t *render_texture;
 	gs_texture_t *output_texture;
 	gs_texture_t *convert_textures[NUM_CHANNELS];
@@ -289,6 +379,16 @@ struct obs_core_video {
 	pthread_t video_thread;
 	uint32_t total_frames;
 	uint32_t lagged_frames;
+	uint64_t render_cache_hits;
+	uint64_t render_cache_misses;
+	uint64_t total_scene_items;
+	uint64_t culled_scene_items;
+	struct gs_draw_stats draw_stats;
+	uint64_t frame_draw_calls;
+	uint64_t frame_batched_sprites;
+	uint64_t render_nested_ns;
+	volatile long gpu_timing_refs;
+	struct obs_gpu_timing gpu_timing;
 	bool thread_initialized;
 
 	bool gpu_conversion;
@@ -341,6 +441,16 @@ struct obs_core_audio {
 	char *monitoring_device_id;
 };
 
+/* name -> context hash index, kept alongside the context linked lists so
+ * that obs_get_*_by_name doesn't have to walk the whole list */
+struct obs_context_index {
+	pthread_rwlock_t rwlock;
+	struct obs_context_data **buckets;
+	size_t num_buckets;
+	size_t num;
+	uint64_t next_order;
+};
+
 /* user sources, output channels, and displays */
 struct obs_core_data {
 	struct obs_source *first_source;
@@ -360,6 +470,11 @@ struct obs_core_data {
 	DARRAY(struct draw_callback) draw_callbacks;
 	DARRAY(struct tick_callback) tick_callbacks;
 
+	struct obs_context_index sources_index;
+	struct obs_context_index outputs_index;
+	struct obs_context_index encoders_index;
+	struct obs_context_index services_index;
+
 	struct obs_view main_view;
 
 	long long unnamed_index;
@@ -404,10 +519,34 @@ struct obs_core_hotkeys {
 	char *sceneitem_hide;
 };
 
+/* shared decoded images */
+struct obs_cached_image;
+
+struct obs_core_image_cache {
+	pthread_mutex_t mutex;
+	struct obs_cached_image *first;
+	struct obs_cached_image *last;
+	uint64_t budget;
+	uint64_t bytes_resident;
+	uint64_t hits;
+	uint64_t misses;
+	uint64_t evictions;
+	uint32_t images;
+};
+
+extern bool obs_init_image_cache(void);
+extern void obs_free_image_cache(void);
+
 struct obs_core {
 	struct obs_module *first_module;
 	DARRAY(struct obs_module_path) module_paths;
 
+	pthread_mutex_t deferred_modules_mutex;
+	DARRAY(struct obs_deferred_module) deferred_modules;
+	pthread_t module_thread;
+	bool lazy_module_loading;
+	bool loading_modules;
+
 	DARRAY(struct obs_source_info) source_types;
 	DARRAY(struct obs_source_info) input_types;
 	DARRAY(struct obs_source_info) filter_types;
@@ -432,8 +571,10 @@ struct obs_core {
 	struct obs_core_audio audio;
 	struct obs_core_data data;
 	struct obs_core_hotkeys hotkeys;
+	struct obs_core_image_cache image_cache;
 
 	obs_task_handler_t ui_task_handler;
+	os_task_scheduler_t *task_scheduler;
 };
 
 extern struct obs_core *obs;
@@ -497,6 +638,11 @@ struct obs_context_data {
 	struct obs_context_data *next;
 	struct obs_context_data **prev_next;
 
+	struct obs_context_index *index;
+	struct obs_context_data *hash_next;
+	uint32_t name_hash;
+	uint64_t index_order;
+
 	bool private;
 };
 
@@ -507,7 +653,8 @@ extern bool obs_context_data_init(struct obs_context_data *context,
 extern void obs_context_data_free(struct obs_context_data *context);
 
 extern void obs_context_data_insert(struct obs_context_data *context,
-				    pthread_mutex_t *mutex, void *first);
+				    pthread_mutex_t *mutex, void *first,
+				    struct obs_context_index *index);
 extern void obs_context_data_remove(struct obs_context_data *context);
 
 extern void obs_context_data_setname(struct obs_context_data *context,
@@ -560,9 +707,14 @@ static inline bool obs_weak_ref_get_ref(struct obs_weak_ref *ref)
 struct async_frame {
 	struct obs_source_frame *frame;
 	long unused_count;
+	long upload_slot;
 	bool used;
+	bool external;
 };
 
+/* frame data owned by the source, see obs_source_output_video_external */
+#define OBS_SOURCE_FRAME_EXTERNAL (1 << 7)
+
 enum audio_action_type {
 	AUDIO_ACTION_VOL,
 	AUDIO_ACTION_MUTE,
@@ -610,6 +762,10 @@ struct obs_source {
 	/* signals to call the source update in the video thread */
 	long defer_update_count;
 
+	/* incremented whenever the video of the source or of one of its
+	 * filters may have changed, used to cache scene item textures */
+	volatile long video_version;
+
 	/* ensures show/hide are only called once */
 	volatile long show_refs;
 
@@ -633,6 +789,9 @@ struct obs_source {
 	/* hint to allow sources to render more quickly */
 	bool texcoords_centered;
 
+	/* hint that the video of the source covers its whole area */
+	bool video_opaque;
+
 	/* timing (if video is present, is based upon video) */
 	volatile bool timing_set;
 	volatile uint64_t timing_adjust;
@@ -661,6 +820,7 @@ struct obs_source {
 	float *audio_mix_buf[MAX_AUDIO_CHANNELS];
 	struct resample_info sample_info;
 	audio_resampler_t *resampler;
+	audio_converter_t *audio_converter;
 	pthread_mutex_t audio_actions_mutex;
 	pthread_mutex_t audio_buf_mutex;
 	pthread_mutex_t audio_mutex;
@@ -703,6 +863,22 @@ struct obs_source {
 	uint32_t async_cache_height;
 	uint32_t async_convert_width[MAX_AV_PLANES];
 	uint32_t async_convert_height[MAX_AV_PLANES];
+	bool async_filtered;
+
+	/* async video uploads through upload buffers */
+	pthread_mutex_t async_upload_mutex;
+	gs_upload_ring_t *async_upload_ring;
+	DARRAY(gs_upload_ring_t *) async_upload_retired;
+	long async_upload_staging;
+	enum video_format async_upload_format;
+	uint32_t async_upload_width;
+	uint32_t async_upload_height;
+	uint32_t async_upload_linesize[MAX_AV_PLANES];
+	uint32_t async_upload_lines[MAX_AV_PLANES];
+	size_t async_upload_offset[MAX_AV_PLANES];
+	struct obs_source_upload_stats upload_stats;
+
+	struct obs_source_perf perf;
 
 	pthread_mutex_t caption_cb_mutex;
 	DARRAY(struct caption_cb_info) caption_cb_list;
@@ -853,6 +1029,10 @@ convert_video_format(enum video_format format)
 extern void obs_source_set_texcoords_centered(obs_source_t *source,
 					      bool centered);
 extern void obs_source_activate(obs_source_t *source, enum view_type type);
+extern void obs_source_bump_video_version(obs_source_t *source);
+extern uint64_t obs_source_get_content_version(obs_source_t *source);
+extern uint64_t obs_scene_get_content_version(obs_scene_t *scene);
+extern bool obs_source_renders_opaque(obs_source_t *source);
 extern void obs_source_deactivate(obs_source_t *source, enum view_type type);
 extern void obs_source_video_tick(obs_source_t *source, float seconds);
 extern float obs_source_get_target_volume(obs_source_t *source,
@@ -1078,6 +1258,7 @@ struct obs_encoder {
 	uint32_t scaled_width;
 	uint32_t scaled_height;
 	enum video_format preferred_format;
+	enum video_scaler_impl scaler;
 
 	volatile bool active;
 	volatile bool paused;
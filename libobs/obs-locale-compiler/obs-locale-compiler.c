@@ -0,0 +1,95 @@
+/******************************************************************************
+    Copyright (C) 2021 by Hugh Bailey <obs.jim@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+
+#include <util/dstr.h>
+#include <util/platform.h>
+#include <util/text-lookup.h>
+
+/*
+ * Compiles every .ini file in the locale directories below the given data
+ * directories into a .locale table next to it (see text_lookup_compile).
+ * Runs when installing, text_lookup_add falls back to the .ini files where
+ * a table is missing or out of date.
+ */
+
+static inline bool is_ini(const char *name)
+{
+	size_t len = strlen(name);
+	return len > 4 && astrcmpi(name + len - 4, ".ini") == 0;
+}
+
+static bool compile_dir(const char *path, bool locale_dir, size_t *count)
+{
+	struct os_dirent *ent;
+	struct dstr child = {0};
+	os_dir_t *dir;
+	bool success = true;
+
+	dir = os_opendir(path);
+	if (!dir)
+		return true;
+
+	while ((ent = os_readdir(dir)) != NULL) {
+		const char *name = ent->d_name;
+
+		if (strcmp(name, ".") == 0 || strcmp(name, "..") == 0)
+			continue;
+
+		dstr_printf(&child, "%s/%s", path, name);
+
+		if (ent->directory) {
+			bool locale = astrcmpi(name, "locale") == 0;
+			if (!compile_dir(child.array, locale, count))
+				success = false;
+
+		} else if (locale_dir && is_ini(name)) {
+			if (text_lookup_compile(child.array, NULL)) {
+				(*count)++;
+			} else {
+				fprintf(stderr, "Failed to compile '%s'\n",
+					child.array);
+				success = false;
+			}
+		}
+	}
+
+	os_closedir(dir);
+	dstr_free(&child);
+	return success;
+}
+
+int main(int argc, char *argv[])
+{
+	size_t count = 0;
+	bool success = true;
+
+	if (argc < 2) {
+		fprintf(stderr, "Usage: %s <data directory>...\n", argv[0]);
+		return 1;
+	}
+
+	for (int i = 1; i < argc; i++) {
+		if (!compile_dir(argv[i], false, &count))
+			success = false;
+	}
+
+	printf("Compiled %zu locale files\n", count);
+	return success ? 0 : 1;
+}
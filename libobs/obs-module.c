@@ -15,6 +15,8 @@
     along with this program.  If not, see <http://www.gnu.org/licenses/>.
 ******************************************************************************/
 
+#include <sys/stat.h>
+
 #include "util/platform.h"
 #include "util/dstr.h"
 
@@ -176,7 +178,18 @@ void obs_log_loaded_modules(void)
 	blog(LOG_INFO, "  Loaded Modules:");
 
 	for (obs_module_t *mod = obs->first_module; !!mod; mod = mod->next)
-		blog(LOG_INFO, "    %s", mod->file);
+		blog(LOG_INFO, "    %s (%.1f ms)", mod->file,
+		     (double)mod->load_time_ns / 1000000.0);
+
+	if (obs->deferred_modules.num) {
+		blog(LOG_INFO, "  Deferred Modules:");
+
+		pthread_mutex_lock(&obs->deferred_modules_mutex);
+		for (size_t i = 0; i < obs->deferred_modules.num; i++)
+			blog(LOG_INFO, "    %s",
+			     obs->deferred_modules.array[i].bin_path);
+		pthread_mutex_unlock(&obs->deferred_modules_mutex);
+	}
 }
 
 const char *obs_get_module_file_name(obs_module_t *module)
@@ -209,7 +222,7 @@ const char *obs_get_module_data_path(obs_module_t *module)
 	return module ? module->data_path : NULL;
 }
 
-obs_module_t *obs_get_module(const char *name)
+static obs_module_t *find_module(const char *name)
 {
 	obs_module_t *module = obs->first_module;
 	while (module) {
@@ -223,6 +236,17 @@ obs_module_t *obs_get_module(const char *name)
 	return NULL;
 }
 
+static bool load_deferred_module_by_name(const char *name);
+
+obs_module_t *obs_get_module(const char *name)
+{
+	obs_module_t *module = find_module(name);
+
+	if (!module && load_deferred_module_by_name(name))
+		module = find_module(name);
+	return module;
+}
+
 void *obs_get_module_lib(obs_module_t *module)
 {
 	return module ? module->module : NULL;
@@ -274,24 +298,484 @@ void obs_add_module_path(const char *bin, const char *data)
 	da_push_back(obs->module_paths, &omp);
 }
 
-static void load_all_callback(void *param, const struct obs_module_info *info)
+/* ------------------------------------------------------------------------- */
+/* module manifest
+ *
+ * Every module loaded through obs_load_all_modules records which source,
+ * output, encoder and service ids it registered, along with the size and
+ * modification time of its binary.  With lazy loading enabled, the next run
+ * skips modules whose binary hasn't changed and which only register types;
+ * they're opened the first time one of their ids is looked up. */
+
+static const char *manifest_lists[] = {"sources", "outputs", "encoders",
+				       "services"};
+#define MANIFEST_LIST_COUNT \
+	(sizeof(manifest_lists) / sizeof(manifest_lists[0]))
+
+struct module_load_info {
+	char *bin_path;
+	char *data_path;
+	obs_data_t *manifest;
+};
+
+struct type_counts {
+	size_t counts[MANIFEST_LIST_COUNT];
+};
+
+static char *get_manifest_path(void)
+{
+	struct dstr path = {0};
+
+	if (!obs->module_config_path || !*obs->module_config_path)
+		return NULL;
+
+	dstr_copy(&path, obs->module_config_path);
+	if (dstr_end(&path) != '/')
+		dstr_cat_ch(&path, '/');
+	dstr_cat(&path, "module-manifest.json");
+	return path.array;
+}
+
+static inline const char *get_type_id(size_t list, size_t idx)
+{
+	switch (list) {
+	case 0:
+		return obs->source_types.array[idx].id;
+	case 1:
+		return obs->output_types.array[idx].id;
+	case 2:
+		return obs->encoder_types.array[idx].id;
+	default:
+		return obs->service_types.array[idx].id;
+	}
+}
+
+static inline void get_type_counts(struct type_counts *tc)
+{
+	tc->counts[0] = obs->source_types.num;
+	tc->counts[1] = obs->output_types.num;
+	tc->counts[2] = obs->encoder_types.num;
+	tc->counts[3] = obs->service_types.num;
+}
+
+static obs_data_t *create_manifest_entry(struct obs_module *mod,
+					 const struct type_counts *before)
+{
+	struct type_counts after;
+	struct stat st;
+	obs_data_t *entry;
+	long long num_types = 0;
+
+	if (os_stat(mod->bin_path, &st) != 0)
+		return NULL;
+
+	entry = obs_data_create();
+	obs_data_set_string(entry, "bin_path", mod->bin_path);
+	obs_data_set_int(entry, "size", (long long)st.st_size);
+	obs_data_set_int(entry, "mtime", (long long)st.st_mtime);
+	obs_data_set_bool(entry, "loaded", mod->loaded);
+	obs_data_set_bool(entry, "post_load", !!mod->post_load);
+
+	get_type_counts(&after);
+
+	for (size_t i = 0; i < MANIFEST_LIST_COUNT; i++) {
+		obs_data_array_t *ids = obs_data_array_create();
+
+		for (size_t j = before->counts[i]; j < after.counts[i]; j++) {
+			obs_data_t *item = obs_data_create();
+			obs_data_set_string(item, "id", get_type_id(i, j));
+			obs_data_array_push_back(ids, item);
+			obs_data_release(item);
+			num_types++;
+		}
+
+		obs_data_set_array(entry, manifest_lists[i], ids);
+		obs_data_array_release(ids);
+	}
+
+	obs_data_set_int(entry, "num_types", num_types);
+	return entry;
+}
+
+static obs_data_t *find_manifest_entry(obs_data_array_t *modules,
+				       const char *bin_path)
+{
+	size_t count = obs_data_array_count(modules);
+
+	for (size_t i = 0; i < count; i++) {
+		obs_data_t *entry = obs_data_array_item(modules, i);
+		const char *path = obs_data_get_string(entry, "bin_path");
+
+		if (strcmp(path, bin_path) == 0)
+			return entry;
+
+		obs_data_release(entry);
+	}
+
+	return NULL;
+}
+
+/* a module can be deferred if it loaded successfully last time, nothing about
+ * its binary has changed since, and all it did was register types */
+static bool can_defer_module(obs_data_t *entry, const char *bin_path)
+{
+	struct stat st;
+
+	if (!entry || os_stat(bin_path, &st) != 0)
+		return false;
+
+	return obs_data_get_bool(entry, "loaded") &&
+	       !obs_data_get_bool(entry, "post_load") &&
+	       obs_data_get_int(entry, "num_types") > 0 &&
+	       obs_data_get_int(entry, "size") == (long long)st.st_size &&
+	       obs_data_get_int(entry, "mtime") == (long long)st.st_mtime;
+}
+
+static bool manifest_has_id(obs_data_t *entry, const char *list,
+			    const char *id)
+{
+	obs_data_array_t *ids = obs_data_get_array(entry, list);
+	size_t count = obs_data_array_count(ids);
+	bool found = false;
+
+	for (size_t i = 0; i < count && !found; i++) {
+		obs_data_t *item = obs_data_array_item(ids, i);
+		found = strcmp(obs_data_get_string(item, "id"), id) == 0;
+		obs_data_release(item);
+	}
+
+	obs_data_array_release(ids);
+	return found;
+}
+
+void obs_save_module_manifest(void)
 {
+	obs_data_array_t *modules;
+	obs_data_t *manifest;
+	char *path;
+
+	if (!obs)
+		return;
+
+	path = get_manifest_path();
+	if (!path)
+		return;
+
+	modules = obs_data_array_create();
+
+	pthread_mutex_lock(&obs->deferred_modules_mutex);
+
+	for (obs_module_t *mod = obs->first_module; !!mod; mod = mod->next) {
+		if (mod->manifest)
+			obs_data_array_push_back(modules, mod->manifest);
+	}
+	for (size_t i = 0; i < obs->deferred_modules.num; i++) {
+		struct obs_deferred_module *dm =
+			&obs->deferred_modules.array[i];
+		obs_data_array_push_back(modules, dm->manifest);
+	}
+
+	pthread_mutex_unlock(&obs->deferred_modules_mutex);
+
+	/* nothing was loaded through obs_load_all_modules */
+	if (!obs_data_array_count(modules)) {
+		obs_data_array_release(modules);
+		bfree(path);
+		return;
+	}
+
+	manifest = obs_data_create();
+
+	obs_data_set_array(manifest, "modules", modules);
+
+	if (os_mkdirs(obs->module_config_path) == MKDIR_ERROR ||
+	    !obs_data_save_json_safe(manifest, path, "tmp", NULL))
+		blog(LOG_WARNING, "Failed to save module manifest '%s'", path);
+
+	obs_data_array_release(modules);
+	obs_data_release(manifest);
+	bfree(path);
+}
+
+/* ------------------------------------------------------------------------- */
+
+static void load_module(const char *bin_path, const char *data_path)
+{
+	struct type_counts before;
 	obs_module_t *module;
+	const char *file;
+	uint64_t start;
 
-	if (!os_is_obs_plugin(info->bin_path))
-		blog(LOG_WARNING, "Skipping module '%s', not an OBS plugin",
-		     info->bin_path);
+	file = strrchr(bin_path, '/');
+	file = file ? file + 1 : bin_path;
+
+	const char *profile_name = profile_store_name(
+		obs_get_profiler_name_store(), "obs_open_module(%s)", file);
+
+	start = os_gettime_ns();
+
+	profile_start(profile_name);
+	int code = obs_open_module(&module, bin_path, data_path);
+	profile_end(profile_name);
 
-	int code = obs_open_module(&module, info->bin_path, info->data_path);
 	if (code != MODULE_SUCCESS) {
 		blog(LOG_DEBUG, "Failed to load module file '%s': %d",
-		     info->bin_path, code);
+		     bin_path, code);
 		return;
 	}
 
+	get_type_counts(&before);
 	obs_init_module(module);
 
-	UNUSED_PARAMETER(param);
+	module->load_time_ns = os_gettime_ns() - start;
+	module->manifest = create_manifest_entry(module, &before);
+}
+
+static void free_load_info(struct module_load_info *info)
+{
+	bfree(info->bin_path);
+	bfree(info->data_path);
+	obs_data_release(info->manifest);
+}
+
+/* the module has already been taken out of the list, the mutex is not held
+ * while it loads as its obs_module_load may wait for other threads */
+static void load_deferred_module(struct obs_deferred_module *dm)
+{
+	blog(LOG_INFO, "Loading deferred module '%s'", dm->bin_path);
+
+	obs->loading_modules = true;
+	load_module(dm->bin_path, dm->data_path);
+	obs->loading_modules = false;
+
+	bfree(dm->bin_path);
+	bfree(dm->data_path);
+	obs_data_release(dm->manifest);
+}
+
+struct deferred_load {
+	char *list;
+	char *id;
+	char *name;
+	bool found;
+};
+
+static bool deferred_module_matches(struct obs_deferred_module *dm,
+				    const struct deferred_load *dl)
+{
+	const char *slash;
+	char *mod_name;
+	bool match;
+
+	if (dl->id)
+		return manifest_has_id(dm->manifest, dl->list, dl->id);
+	if (!dl->name)
+		return true;
+
+	slash = strrchr(dm->bin_path, '/');
+	mod_name = get_module_name(slash ? slash + 1 : dm->bin_path);
+	match = strcmp(mod_name, dl->name) == 0;
+	bfree(mod_name);
+	return match;
+}
+
+/* takes the next deferred module matching the load out of the list */
+static bool take_deferred_module(struct deferred_load *dl,
+				 struct obs_deferred_module *dm)
+{
+	bool found = false;
+
+	pthread_mutex_lock(&obs->deferred_modules_mutex);
+
+	for (size_t i = 0; i < obs->deferred_modules.num; i++) {
+		if (deferred_module_matches(&obs->deferred_modules.array[i],
+					    dl)) {
+			*dm = obs->deferred_modules.array[i];
+			da_erase(obs->deferred_modules, i);
+			found = true;
+			break;
+		}
+	}
+
+	pthread_mutex_unlock(&obs->deferred_modules_mutex);
+	return found;
+}
+
+static bool has_deferred_module(struct deferred_load *dl)
+{
+	bool found = false;
+
+	pthread_mutex_lock(&obs->deferred_modules_mutex);
+
+	for (size_t i = 0; i < obs->deferred_modules.num; i++) {
+		if (deferred_module_matches(&obs->deferred_modules.array[i],
+					    dl)) {
+			found = true;
+			break;
+		}
+	}
+
+	pthread_mutex_unlock(&obs->deferred_modules_mutex);
+	return found;
+}
+
+/* loads the deferred modules matching an id or name, or all of them if
+ * neither is set.  only runs on the thread that loads modules */
+static void deferred_load_task(void *param)
+{
+	struct deferred_load *dl = param;
+	struct obs_deferred_module dm;
+
+	/* types registered while a module loads are checked against the
+	 * existing ones, which must not pull in another module */
+	if (obs->loading_modules) {
+		dl->found = has_deferred_module(dl);
+		return;
+	}
+
+	while (take_deferred_module(dl, &dm)) {
+		dl->found = true;
+		load_deferred_module(&dm);
+
+		if (dl->id || dl->name)
+			break;
+	}
+}
+
+static void free_deferred_load(struct deferred_load *dl)
+{
+	bfree(dl->list);
+	bfree(dl->id);
+	bfree(dl->name);
+	bfree(dl);
+}
+
+static void deferred_load_async_task(void *param)
+{
+	deferred_load_task(param);
+	free_deferred_load(param);
+}
+
+/* modules are opened on the UI thread like the ones obs_load_all_modules
+ * loads.  other threads can't wait for it, as the UI thread may be waiting
+ * for them (obs_enter_graphics, for example), so for them the module is
+ * loaded in the background and the lookup fails until it is there */
+static bool run_deferred_load(struct deferred_load *dl)
+{
+	struct deferred_load *async;
+
+	if (!obs || !obs->deferred_modules.num)
+		return false;
+
+	if (pthread_equal(obs->module_thread, pthread_self())) {
+		deferred_load_task(dl);
+		return dl->found;
+	}
+
+	if (!has_deferred_module(dl))
+		return false;
+
+	async = bzalloc(sizeof(*async));
+	async->list = bstrdup(dl->list);
+	async->id = bstrdup(dl->id);
+	async->name = bstrdup(dl->name);
+	obs_queue_task(OBS_TASK_UI, deferred_load_async_task, async, false);
+	return false;
+}
+
+bool obs_load_deferred_module_for_type(const char *list, const char *id)
+{
+	struct deferred_load dl = {(char *)list, (char *)id, NULL, false};
+
+	return id && run_deferred_load(&dl);
+}
+
+void obs_load_deferred_modules(void)
+{
+	struct deferred_load dl = {NULL, NULL, NULL, false};
+
+	run_deferred_load(&dl);
+}
+
+static bool load_deferred_module_by_name(const char *name)
+{
+	struct deferred_load dl = {NULL, NULL, (char *)name, false};
+
+	return run_deferred_load(&dl);
+}
+
+void obs_free_deferred_modules(void)
+{
+	for (size_t i = 0; i < obs->deferred_modules.num; i++) {
+		struct obs_deferred_module *dm =
+			&obs->deferred_modules.array[i];
+		bfree(dm->bin_path);
+		bfree(dm->data_path);
+		obs_data_release(dm->manifest);
+	}
+	da_free(obs->deferred_modules);
+}
+
+void obs_set_lazy_module_loading(bool enable)
+{
+	if (obs)
+		obs->lazy_module_loading = enable;
+}
+
+/* ------------------------------------------------------------------------- */
+
+struct find_modules_data {
+	DARRAY(struct module_load_info) modules;
+	obs_data_array_t *manifest;
+};
+
+static void find_all_callback(void *param, const struct obs_module_info *info)
+{
+	struct find_modules_data *data = param;
+	struct module_load_info *mli;
+
+	if (!os_is_obs_plugin(info->bin_path))
+		blog(LOG_WARNING, "Skipping module '%s', not an OBS plugin",
+		     info->bin_path);
+
+	mli = da_push_back_new(data->modules);
+	mli->bin_path = bstrdup(info->bin_path);
+	mli->data_path = bstrdup(info->data_path);
+
+	if (data->manifest)
+		mli->manifest =
+			find_manifest_entry(data->manifest, info->bin_path);
+}
+
+/* reads each module image once on a worker thread so that the page cache is
+ * warm by the time the main thread opens it.  the open itself stays serial:
+ * the dynamic loader serializes it anyway, and on windows it relies on the
+ * process-wide dll directory */
+static void prefetch_modules(void *param, size_t start, size_t end)
+{
+	struct module_load_info *modules = param;
+
+	for (size_t i = start; i < end; i++) {
+		os_mapped_file_t *file;
+		volatile uint8_t sum = 0;
+		const uint8_t *data;
+		size_t size;
+
+		if (!modules[i].bin_path)
+			continue;
+
+		file = os_mapped_file_open(modules[i].bin_path);
+		if (!file)
+			continue;
+
+		data = os_mapped_file_data(file);
+		size = os_mapped_file_size(file);
+
+		for (size_t pos = 0; pos < size; pos += 4096)
+			sum += data[pos];
+
+		os_mapped_file_close(file);
+	}
 }
 
 static const char *obs_load_all_modules_name = "obs_load_all_modules";
@@ -301,8 +785,64 @@ static const char *reset_win32_symbol_paths_name = "reset_win32_symbol_paths";
 
 void obs_load_all_modules(void)
 {
+	struct find_modules_data data = {0};
+	obs_data_t *manifest = NULL;
+
 	profile_start(obs_load_all_modules_name);
-	obs_find_modules(load_all_callback, NULL);
+
+	if (obs->lazy_module_loading) {
+		char *path = get_manifest_path();
+		if (path && os_file_exists(path))
+			manifest = obs_data_create_from_json_file(path);
+		if (manifest)
+			data.manifest = obs_data_get_array(manifest, "modules");
+		bfree(path);
+	}
+
+	obs_find_modules(find_all_callback, &data);
+
+	/* deferred modules are loaded on this thread later on, or through the
+	 * UI task handler when requested from another thread */
+	obs->module_thread = pthread_self();
+
+	pthread_mutex_lock(&obs->deferred_modules_mutex);
+
+	for (size_t i = 0; obs->ui_task_handler && i < data.modules.num; i++) {
+		struct module_load_info *mli = &data.modules.array[i];
+
+		if (can_defer_module(mli->manifest, mli->bin_path)) {
+			struct obs_deferred_module *dm =
+				da_push_back_new(obs->deferred_modules);
+			dm->bin_path = mli->bin_path;
+			dm->data_path = mli->data_path;
+			dm->manifest = mli->manifest;
+			memset(mli, 0, sizeof(*mli));
+		}
+	}
+
+	pthread_mutex_unlock(&obs->deferred_modules_mutex);
+
+	os_task_scheduler_parallel_for(obs->task_scheduler, data.modules.num,
+				       1, prefetch_modules, data.modules.array);
+
+	obs->loading_modules = true;
+	for (size_t i = 0; i < data.modules.num; i++) {
+		struct module_load_info *mli = &data.modules.array[i];
+
+		if (mli->bin_path)
+			load_module(mli->bin_path, mli->data_path);
+		free_load_info(mli);
+	}
+	obs->loading_modules = false;
+
+	if (obs->deferred_modules.num)
+		blog(LOG_INFO, "Deferred loading of %d module(s)",
+		     (int)obs->deferred_modules.num);
+
+	da_free(data.modules);
+	obs_data_array_release(data.manifest);
+	obs_data_release(manifest);
+
 #ifdef _WIN32
 	profile_start(reset_win32_symbol_paths_name);
 	reset_win32_symbol_paths();
@@ -316,6 +856,8 @@ void obs_post_load_modules(void)
 	for (obs_module_t *mod = obs->first_module; !!mod; mod = mod->next)
 		if (mod->post_load)
 			mod->post_load();
+
+	obs_save_module_manifest();
 }
 
 static inline void make_data_dir(struct dstr *parsed_data_dir,
@@ -473,6 +1015,8 @@ void obs_enum_modules(obs_enum_module_callback_t callback, void *param)
 	if (!obs)
 		return;
 
+	obs_load_deferred_modules();
+
 	module = obs->first_module;
 	while (module) {
 		callback(param, module);
@@ -497,6 +1041,7 @@ void free_module(struct obs_module *mod)
 		/* os_dlclose(mod->module); */
 	}
 
+	obs_data_release(mod->manifest);
 	bfree(mod->mod_name);
 	bfree(mod->bin_path);
 	bfree(mod->data_path);
@@ -54,7 +54,7 @@ static inline bool data_capture_ending(const struct obs_output *output)
 	return os_atomic_load_bool(&output->end_data_capture_thread_active);
 }
 
-const struct obs_output_info *find_output(const char *id)
+static const struct obs_output_info *find_output_type(const char *id)
 {
 	size_t i;
 	for (i = 0; i < obs->output_types.num; i++)
@@ -64,6 +64,15 @@ const struct obs_output_info *find_output(const char *id)
 	return NULL;
 }
 
+const struct obs_output_info *find_output(const char *id)
+{
+	const struct obs_output_info *info = find_output_type(id);
+
+	if (!info && obs_load_deferred_module_for_type("outputs", id))
+		info = find_output_type(id);
+	return info;
+}
+
 const char *obs_output_get_display_name(const char *id)
 {
 	const struct obs_output_info *info = find_output(id);
@@ -149,7 +158,8 @@ obs_output_t *obs_output_create(const char *id, const char *name,
 	output->control->output = output;
 
 	obs_context_data_insert(&output->context, &obs->data.outputs_mutex,
-				&obs->data.first_output);
+				&obs->data.first_output,
+				&obs->data.outputs_index);
 
 	if (info)
 		output->context.data =
@@ -454,6 +454,7 @@ static void update_item_transform(struct obs_scene_item *item, bool update_tex)
 	} else if (!item->item_render && item_texture_enabled(item)) {
 		obs_enter_graphics();
 		item->item_render = gs_texrender_create(GS_RGBA, GS_ZS_NONE);
+		item->render_version = 0;
 		obs_leave_graphics();
 	}
 
@@ -489,6 +490,127 @@ static inline bool item_texture_enabled(const struct obs_scene_item *item)
 	       (item_is_scene(item) && !item->is_group);
 }
 
+/* ------------------------------------------------------------------------- */
+/* content versions, used to reuse item textures while nothing has changed */
+
+#define FNV_OFFSET 0xCBF29CE484222325ULL
+#define FNV_PRIME 0x100000001B3ULL
+
+static uint64_t hash_data(uint64_t hash, const void *data, size_t size)
+{
+	const uint8_t *bytes = data;
+
+	for (size_t i = 0; i < size; i++) {
+		hash ^= bytes[i];
+		hash *= FNV_PRIME;
+	}
+
+	return hash;
+}
+
+static inline bool item_cacheable(struct obs_scene_item *item)
+{
+	return !os_atomic_load_bool(&item->update_transform) &&
+	       !os_atomic_load_bool(&item->update_group_resize) &&
+	       !source_size_changed(item) &&
+	       !obs_source_removed(item->source) &&
+	       !transition_active(item->show_transition) &&
+	       !transition_active(item->hide_transition);
+}
+
+/* returns 0 if the scene has to be rendered again, otherwise a hash of
+ * everything that affects what the scene renders */
+uint64_t obs_scene_get_content_version(obs_scene_t *scene)
+{
+	struct obs_scene_item *item;
+	uint64_t hash = FNV_OFFSET;
+	long version;
+
+	if (!scene)
+		return 0;
+
+	version = os_atomic_load_long(&scene->source->video_version);
+	hash = hash_data(hash, &version, sizeof(version));
+
+	video_lock(scene);
+
+	for (item = scene->first_item; item; item = item->next) {
+		uint64_t item_version;
+
+		if (!item_cacheable(item)) {
+			hash = 0;
+			break;
+		}
+
+		hash = hash_data(hash, &item, sizeof(item));
+		hash = hash_data(hash, &item->user_visible,
+				 sizeof(item->user_visible));
+		if (!item->user_visible)
+			continue;
+
+		item_version = obs_source_get_content_version(item->source);
+		if (!item_version) {
+			hash = 0;
+			break;
+		}
+
+		hash = hash_data(hash, &item_version, sizeof(item_version));
+		hash = hash_data(hash, &item->draw_transform,
+				 sizeof(item->draw_transform));
+		hash = hash_data(hash, &item->crop, sizeof(item->crop));
+		hash = hash_data(hash, &item->scale_filter,
+				 sizeof(item->scale_filter));
+		hash = hash_data(hash, &item->last_width,
+				 sizeof(item->last_width));
+		hash = hash_data(hash, &item->last_height,
+				 sizeof(item->last_height));
+	}
+
+	video_unlock(scene);
+
+	return hash;
+}
+
+/* resets item_render unless the texture from the last render can be reused */
+static void update_item_render_cache(struct obs_scene_item *item, uint32_t cx,
+				     uint32_t cy)
+{
+	uint64_t version = 0;
+
+	if (item_cacheable(item)) {
+		version = obs_source_get_content_version(item->source);
+		if (version) {
+			version = hash_data(version, &item->crop,
+					    sizeof(item->crop));
+			version = hash_data(version, &cx, sizeof(cx));
+			version = hash_data(version, &cy, sizeof(cy));
+			if (!version)
+				version = 1;
+		}
+	}
+
+	if (version && version == item->render_version) {
+		obs->video.render_cache_hits++;
+		return;
+	}
+
+	/* items that cannot be cached are reset in scene_video_tick so that
+	 * they still only render once per frame */
+	if (version != item->render_version)
+		gs_texrender_reset(item->item_render);
+
+	item->render_version = version;
+	obs->video.render_cache_misses++;
+}
+
+/* ------------------------------------------------------------------------- */
+
+static struct gs_effect_param_key image_key = GS_EFFECT_PARAM_KEY("image");
+static struct gs_effect_param_key base_dimension_key =
+	GS_EFFECT_PARAM_KEY("base_dimension");
+static struct gs_effect_param_key base_dimension_i_key =
+	GS_EFFECT_PARAM_KEY("base_dimension_i");
+
 static void render_item_texture(struct obs_scene_item *item)
 {
 	gs_texture_t *tex = gs_texrender_get_texture(item->item_render);
@@ -508,7 +630,7 @@ static void render_item_texture(struct obs_scene_item *item)
 	if (type != OBS_SCALE_DISABLE) {
 		if (type == OBS_SCALE_POINT) {
 			gs_eparam_t *image =
-				gs_effect_get_param_by_name(effect, "image");
+				gs_effect_get_param_by_key(effect, &image_key);
 			gs_effect_set_next_sampler(image,
 						   obs->video.point_sampler);
 
@@ -531,16 +653,16 @@ static void render_item_texture(struct obs_scene_item *item)
 					tech = "DrawUpscale";
 			}
 
-			scale_param = gs_effect_get_param_by_name(
-				effect, "base_dimension");
+			scale_param = gs_effect_get_param_by_key(
+				effect, &base_dimension_key);
 			if (scale_param) {
 				struct vec2 base_res = {(float)cx, (float)cy};
 
 				gs_effect_set_vec2(scale_param, &base_res);
 			}
 
-			scale_i_param = gs_effect_get_param_by_name(
-				effect, "base_dimension_i");
+			scale_i_param = gs_effect_get_param_by_key(
+				effect, &base_dimension_i_key);
 			if (scale_i_param) {
 				struct vec2 base_res_i = {1.0f / (float)cx,
 							  1.0f / (float)cy};
@@ -591,6 +713,8 @@ static inline void render_item(struct obs_scene_item *item)
 		uint32_t cx = calc_cx(item, width);
 		uint32_t cy = calc_cy(item, height);
 
+		update_item_render_cache(item, cx, cy);
+
 		if (cx && cy && gs_texrender_begin(item->item_render, cx, cy)) {
 			float cx_scale = (float)width / (float)cx;
 			float cy_scale = (float)height / (float)cy;
@@ -674,7 +798,7 @@ static void scene_video_tick(void *data, float seconds)
 	video_lock(scene);
 	item = scene->first_item;
 	while (item) {
-		if (item->item_render)
+		if (item->item_render && !item->render_version)
 			gs_texrender_reset(item->item_render);
 		item = item->next;
 	}
@@ -729,6 +853,143 @@ update_transforms_and_prune_sources(obs_scene_t *scene,
 		resize_group(group_sceneitem);
 }
 
+/* ------------------------------------------------------------------------- */
+/* culling of items that are off-canvas or hidden behind opaque items */
+
+#define MAX_OCCLUDERS 8
+
+static uint32_t scene_getwidth(void *data);
+static uint32_t scene_getheight(void *data);
+
+struct cull_rect {
+	float left;
+	float top;
+	float right;
+	float bottom;
+};
+
+static inline bool item_drawn(const struct obs_scene_item *item)
+{
+	return item->user_visible || transition_active(item->hide_transition);
+}
+
+static inline bool item_occludes(struct obs_scene_item *item)
+{
+	return item->user_visible &&
+	       !transition_active(item->show_transition) &&
+	       !transition_active(item->hide_transition) &&
+	       obs_source_renders_opaque(item->source);
+}
+
+static inline bool transform_axis_aligned(const struct matrix4 *m)
+{
+	return (fabsf(m->x.y) < TINY_EPSILON &&
+		fabsf(m->y.x) < TINY_EPSILON) ||
+	       (fabsf(m->x.x) < TINY_EPSILON && fabsf(m->y.y) < TINY_EPSILON);
+}
+
+/* gets the area the item draws to in scene space, returns false if the item
+ * has no known size */
+static bool get_item_rect(const struct obs_scene_item *item,
+			  struct cull_rect *rect)
+{
+	float cx = (float)calc_cx(item, item->last_width);
+	float cy = (float)calc_cy(item, item->last_height);
+	const struct vec2 corners[4] = {
+		{0.0f, 0.0f},
+		{cx, 0.0f},
+		{0.0f, cy},
+		{cx, cy},
+	};
+
+	if (!item->last_width || !item->last_height)
+		return false;
+
+	rect->left = rect->top = M_INFINITE;
+	rect->right = rect->bottom = -M_INFINITE;
+
+	for (size_t i = 0; i < 4; i++) {
+		struct vec3 v;
+
+		vec3_set(&v, corners[i].x, corners[i].y, 0.0f);
+		vec3_transform(&v, &v, &item->draw_transform);
+
+		if (v.x < rect->left)
+			rect->left = v.x;
+		if (v.x > rect->right)
+			rect->right = v.x;
+		if (v.y < rect->top)
+			rect->top = v.y;
+		if (v.y > rect->bottom)
+			rect->bottom = v.y;
+	}
+
+	return true;
+}
+
+static inline bool clip_rect(struct cull_rect *rect,
+			     const struct cull_rect *clip)
+{
+	rect->left = fmaxf(rect->left, clip->left);
+	rect->top = fmaxf(rect->top, clip->top);
+	rect->right = fminf(rect->right, clip->right);
+	rect->bottom = fminf(rect->bottom, clip->bottom);
+	return rect->left < rect->right && rect->top < rect->bottom;
+}
+
+static inline bool rect_contains(const struct cull_rect *outer,
+				 const struct cull_rect *inner)
+{
+	return inner->left >= outer->left && inner->top >= outer->top &&
+	       inner->right <= outer->right && inner->bottom <= outer->bottom;
+}
+
+/* walks the items from top to bottom and marks the items that are entirely
+ * outside of the canvas or entirely covered by an opaque item above them.
+ * groups do not know the canvas they end up on, so only occlusion is
+ * checked for their items. */
+static void cull_items(struct obs_scene *scene)
+{
+	struct cull_rect occluders[MAX_OCCLUDERS];
+	size_t num_occluders = 0;
+	struct cull_rect canvas;
+	struct obs_scene_item *item = scene->first_item;
+
+	canvas.left = 0.0f;
+	canvas.top = 0.0f;
+	canvas.right = (float)scene_getwidth(scene);
+	canvas.bottom = (float)scene_getheight(scene);
+
+	while (item && item->next)
+		item = item->next;
+
+	for (; item; item = item->prev) {
+		struct cull_rect rect;
+
+		item->culled = false;
+
+		if (!item_drawn(item) || !get_item_rect(item, &rect))
+			continue;
+
+		if (!scene->is_group && !clip_rect(&rect, &canvas)) {
+			item->culled = true;
+			continue;
+		}
+
+		for (size_t i = 0; i < num_occluders; i++) {
+			if (rect_contains(&occluders[i], &rect)) {
+				item->culled = true;
+				break;
+			}
+		}
+
+		if (!item->culled && num_occluders < MAX_OCCLUDERS &&
+		    transform_axis_aligned(&item->draw_transform) &&
+		    item_occludes(item))
+			occluders[num_occluders++] = rect;
+	}
+}
+
 static void scene_video_render(void *data, gs_effect_t *effect)
 {
 	DARRAY(struct obs_scene_item *) remove_items;
@@ -744,18 +1005,30 @@ static void scene_video_render(void *data, gs_effect_t *effect)
 						    NULL);
 	}
 
+	cull_items(scene);
+
 	gs_blend_state_push();
 	gs_reset_blend_state();
 
+	/* consecutive small items that share a texture (or an atlas page) and
+	 * effect parameters are drawn with a single draw call */
+	gs_sprite_batch_begin();
+
 	item = scene->first_item;
 	while (item) {
-		if (item->user_visible ||
-		    transition_active(item->hide_transition))
-			render_item(item);
+		if (item_drawn(item)) {
+			obs->video.total_scene_items++;
+
+			if (item->culled)
+				obs->video.culled_scene_items++;
+			else
+				render_item(item);
+		}
 
 		item = item->next;
 	}
 
+	gs_sprite_batch_end();
 	gs_blend_state_pop();
 
 	video_unlock(scene);
@@ -895,6 +1168,7 @@ static void scene_load_item(struct obs_scene *scene, obs_data_t *item_data)
 	} else if (!item->item_render && item_texture_enabled(item)) {
 		obs_enter_graphics();
 		item->item_render = gs_texrender_create(GS_RGBA, GS_ZS_NONE);
+		item->render_version = 0;
 		obs_leave_graphics();
 	}
 
@@ -50,6 +50,13 @@ struct obs_scene_item {
 	gs_texrender_t *item_render;
 	struct obs_sceneitem_crop crop;
 
+	/* content version item_render was last rendered with, 0 if the item
+	 * has to be rendered again every frame */
+	uint64_t render_version;
+
+	/* set when the item cannot contribute any pixels this frame */
+	bool culled;
+
 	struct vec2 pos;
 	struct vec2 scale;
 	float rot;
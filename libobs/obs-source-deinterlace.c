@@ -365,18 +365,28 @@ static bool deinterlace_linear_required(enum obs_deinterlace_mode mode)
 	return false;
 }
 
+static struct gs_effect_param_key image_key = GS_EFFECT_PARAM_KEY("image");
+static struct gs_effect_param_key previous_image_key =
+	GS_EFFECT_PARAM_KEY("previous_image");
+static struct gs_effect_param_key field_order_key =
+	GS_EFFECT_PARAM_KEY("field_order");
+static struct gs_effect_param_key frame2_key = GS_EFFECT_PARAM_KEY("frame2");
+static struct gs_effect_param_key dimensions_key =
+	GS_EFFECT_PARAM_KEY("dimensions");
+
 void deinterlace_render(obs_source_t *s)
 {
 	gs_effect_t *effect = s->deinterlace_effect;
 
 	uint64_t frame2_ts;
-	gs_eparam_t *image = gs_effect_get_param_by_name(effect, "image");
+	gs_eparam_t *image = gs_effect_get_param_by_key(effect, &image_key);
 	gs_eparam_t *prev =
-		gs_effect_get_param_by_name(effect, "previous_image");
-	gs_eparam_t *field = gs_effect_get_param_by_name(effect, "field_order");
-	gs_eparam_t *frame2 = gs_effect_get_param_by_name(effect, "frame2");
+		gs_effect_get_param_by_key(effect, &previous_image_key);
+	gs_eparam_t *field =
+		gs_effect_get_param_by_key(effect, &field_order_key);
+	gs_eparam_t *frame2 = gs_effect_get_param_by_key(effect, &frame2_key);
 	gs_eparam_t *dimensions =
-		gs_effect_get_param_by_name(effect, "dimensions");
+		gs_effect_get_param_by_key(effect, &dimensions_key);
 	struct vec2 size = {(float)s->async_width, (float)s->async_height};
 
 	gs_texture_t *cur_tex =
@@ -0,0 +1,247 @@
+/******************************************************************************
+    Copyright (C) 2021 by Hugh Bailey <obs.jim@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include "obs-internal.h"
+#include "util/util_uint64.h"
+
+/*
+ * Source cost accounting
+ *
+ * CPU costs are measured around the tick, render and audio render calls of
+ * every source and added to counters in the source.  GPU costs are measured
+ * with a pair of timestamp queries around every source render while GPU
+ * timing is enabled.  The queries of a frame are kept in a list of records
+ * that point to the record of the render they were nested in, so that the
+ * time of nested renders can be subtracted from their parent once the
+ * results are available, GPU_TIMING_FRAMES frames later.
+ *
+ * Everything related to GPU timing is only accessed with the graphics
+ * context entered.
+ */
+
+void obs_perf_counter_read(const struct obs_perf_counter *counter,
+			   uint64_t *count, uint64_t *total)
+{
+	struct obs_perf_counter *c = (struct obs_perf_counter *)counter;
+	long seq;
+
+	do {
+		seq = os_atomic_load_long(&c->seq);
+		*count = c->count;
+		*total = c->total;
+	} while ((seq & 1) != 0 || os_atomic_load_long(&c->seq) != seq);
+}
+
+void obs_source_get_perf_stats(const obs_source_t *source,
+			       struct obs_source_perf_stats *stats)
+{
+	const struct obs_source_perf *perf;
+
+	if (!obs_source_valid(source, "obs_source_get_perf_stats"))
+		return;
+	if (!obs_ptr_valid(stats, "obs_source_get_perf_stats"))
+		return;
+
+	perf = &source->perf;
+	obs_perf_counter_read(&perf->tick, &stats->ticks, &stats->tick_time_ns);
+	obs_perf_counter_read(&perf->render, &stats->renders,
+			      &stats->render_time_ns);
+	obs_perf_counter_read(&perf->gpu, &stats->gpu_renders,
+			      &stats->gpu_time_ns);
+	obs_perf_counter_read(&perf->upload, &stats->uploads,
+			      &stats->upload_bytes);
+	obs_perf_counter_read(&perf->audio, &stats->audio_renders,
+			      &stats->audio_render_time_ns);
+}
+
+void obs_enable_source_gpu_timing(bool enable)
+{
+	if (!obs)
+		return;
+
+	if (enable)
+		os_atomic_inc_long(&obs->video.gpu_timing_refs);
+	else
+		os_atomic_dec_long(&obs->video.gpu_timing_refs);
+}
+
+/* ------------------------------------------------------------------------- */
+
+static void resolve_frame(struct obs_gpu_timing *timing,
+			  struct gpu_timing_frame *frame)
+{
+	struct gpu_timing_record *records = frame->records.array;
+	uint64_t frequency = 1000000000;
+	bool disjoint = false;
+	bool valid = true;
+
+	/* OpenGL has no timer ranges, its timestamps are in nanoseconds */
+	if (frame->range)
+		valid = gs_timer_range_get_data(frame->range, &disjoint,
+						&frequency) &&
+			!disjoint && frequency;
+
+	/* nested renders always come after the render they are nested in */
+	for (size_t i = frame->records.num; i > 0; i--) {
+		struct gpu_timing_record *record = records + (i - 1);
+		obs_source_t *source = NULL;
+		uint64_t ticks = 0;
+		bool have_ticks;
+
+		have_ticks = valid && gs_timer_get_data(record->timer, &ticks);
+
+		/* the time of a render without its nested renders can't be
+		 * known if one of them has no data either */
+		if (record->parent != GPU_TIMING_NONE) {
+			struct gpu_timing_record *parent =
+				records + record->parent;
+
+			if (have_ticks)
+				parent->child_ticks += ticks;
+			else
+				parent->child_failed = true;
+		}
+
+		/* renders without data are left out rather than counted as
+		 * taking no time */
+		if (have_ticks && !record->child_failed)
+			source = obs_weak_source_get_source(record->source);
+		if (source) {
+			uint64_t self = ticks > record->child_ticks
+						? ticks - record->child_ticks
+						: 0;
+			obs_perf_counter_add(&source->perf.gpu,
+					     util_mul_div64(self, 1000000000ULL,
+							    frequency));
+			obs_source_release(source);
+		}
+
+		obs_weak_source_release(record->source);
+		da_push_back(timing->free_timers, &record->timer);
+	}
+
+	da_resize(frame->records, 0);
+	frame->active = false;
+}
+
+void obs_gpu_timing_frame_begin(struct obs_core_video *video)
+{
+	struct obs_gpu_timing *timing = &video->gpu_timing;
+	struct gpu_timing_frame *frame;
+
+	if (++timing->cur_frame == GPU_TIMING_FRAMES)
+		timing->cur_frame = 0;
+
+	frame = &timing->frames[timing->cur_frame];
+	if (frame->active)
+		resolve_frame(timing, frame);
+
+	if (os_atomic_load_long(&video->gpu_timing_refs) <= 0)
+		return;
+
+	if (!frame->range)
+		frame->range = gs_timer_range_create();
+	if (frame->range)
+		gs_timer_range_begin(frame->range);
+
+	frame->active = true;
+	timing->parent = GPU_TIMING_NONE;
+	timing->recording = true;
+}
+
+void obs_gpu_timing_frame_end(struct obs_core_video *video)
+{
+	struct obs_gpu_timing *timing = &video->gpu_timing;
+	struct gpu_timing_frame *frame = &timing->frames[timing->cur_frame];
+
+	if (!timing->recording)
+		return;
+
+	if (frame->range)
+		gs_timer_range_end(frame->range);
+	timing->recording = false;
+}
+
+void obs_gpu_timing_free(struct obs_core_video *video)
+{
+	struct obs_gpu_timing *timing = &video->gpu_timing;
+
+	for (size_t i = 0; i < GPU_TIMING_FRAMES; i++) {
+		struct gpu_timing_frame *frame = &timing->frames[i];
+
+		for (size_t j = 0; j < frame->records.num; j++) {
+			struct gpu_timing_record *record =
+				frame->records.array + j;
+
+			obs_weak_source_release(record->source);
+			gs_timer_destroy(record->timer);
+		}
+
+		if (frame->range)
+			gs_timer_range_destroy(frame->range);
+		da_free(frame->records);
+	}
+
+	for (size_t i = 0; i < timing->free_timers.num; i++)
+		gs_timer_destroy(timing->free_timers.array[i]);
+	da_free(timing->free_timers);
+
+	memset(timing, 0, sizeof(*timing));
+}
+
+size_t obs_gpu_timing_begin(struct obs_source *source)
+{
+	struct obs_gpu_timing *timing = &obs->video.gpu_timing;
+	struct gpu_timing_frame *frame = &timing->frames[timing->cur_frame];
+	struct gpu_timing_record *record;
+	gs_timer_t *timer = NULL;
+
+	if (!timing->recording)
+		return GPU_TIMING_NONE;
+
+	if (timing->free_timers.num) {
+		timer = timing->free_timers.array[timing->free_timers.num - 1];
+		da_pop_back(timing->free_timers);
+	} else {
+		timer = gs_timer_create();
+		if (!timer)
+			return GPU_TIMING_NONE;
+	}
+
+	record = da_push_back_new(frame->records);
+	record->source = obs_source_get_weak_source(source);
+	record->timer = timer;
+	record->parent = timing->parent;
+
+	gs_timer_begin(timer);
+	timing->parent = frame->records.num - 1;
+	return timing->parent;
+}
+
+void obs_gpu_timing_end(size_t idx)
+{
+	struct obs_gpu_timing *timing = &obs->video.gpu_timing;
+	struct gpu_timing_frame *frame = &timing->frames[timing->cur_frame];
+	struct gpu_timing_record *record;
+
+	if (idx == GPU_TIMING_NONE || idx >= frame->records.num)
+		return;
+
+	record = frame->records.array + idx;
+	gs_timer_end(record->timer);
+	timing->parent = record->parent;
+}
@@ -43,7 +43,7 @@ static inline bool deinterlacing_enabled(const struct obs_source *source)
 	return source->deinterlace_mode != OBS_DEINTERLACE_MODE_DISABLE;
 }
 
-struct obs_source_info *get_source_info(const char *id)
+static struct obs_source_info *find_source_type(const char *id)
 {
 	for (size_t i = 0; i < obs->source_types.num; i++) {
 		struct obs_source_info *info = &obs->source_types.array[i];
@@ -54,6 +54,15 @@ struct obs_source_info *get_source_info(const char *id)
 	return NULL;
 }
 
+struct obs_source_info *get_source_info(const char *id)
+{
+	struct obs_source_info *info = find_source_type(id);
+
+	if (!info && obs_load_deferred_module_for_type("sources", id))
+		info = find_source_type(id);
+	return info;
+}
+
 struct obs_source_info *get_source_info2(const char *unversioned_id,
 					 uint32_t ver)
 {
@@ -181,6 +190,7 @@ static bool obs_source_init(struct obs_source *source)
 	source->audio_active = true;
 	pthread_mutex_init_value(&source->filter_mutex);
 	pthread_mutex_init_value(&source->async_mutex);
+	pthread_mutex_init_value(&source->async_upload_mutex);
 	pthread_mutex_init_value(&source->audio_mutex);
 	pthread_mutex_init_value(&source->audio_buf_mutex);
 	pthread_mutex_init_value(&source->audio_cb_mutex);
@@ -202,6 +212,8 @@ static bool obs_source_init(struct obs_source *source)
 		return false;
 	if (pthread_mutex_init(&source->async_mutex, NULL) != 0)
 		return false;
+	if (pthread_mutex_init(&source->async_upload_mutex, NULL) != 0)
+		return false;
 	if (pthread_mutex_init(&source->caption_cb_mutex, NULL) != 0)
 		return false;
 
@@ -240,7 +252,8 @@ static void obs_source_init_finalize(struct obs_source *source)
 	}
 
 	obs_context_data_insert(&source->context, &obs->data.sources_mutex,
-				&obs->data.first_source);
+				&obs->data.first_source,
+				&obs->data.sources_index);
 }
 
 static bool obs_source_hotkey_mute(void *data, obs_hotkey_pair_id id,
@@ -603,10 +616,30 @@ void obs_source_frame_init(struct obs_source_frame *frame,
 	}
 }
 
+struct external_frame {
+	struct obs_source_frame frame;
+	void (*release)(void *param);
+	void *param;
+};
+
+/* external frames only wrap the data of the source, which gets it back once
+ * the frame is destroyed */
+static void async_frame_destroy(struct obs_source_frame *frame)
+{
+	if (frame && (frame->flags & OBS_SOURCE_FRAME_EXTERNAL) != 0) {
+		struct external_frame *ext = (struct external_frame *)frame;
+
+		ext->release(ext->param);
+		bfree(ext);
+	} else {
+		obs_source_frame_destroy(frame);
+	}
+}
+
 static inline void obs_source_frame_decref(struct obs_source_frame *frame)
 {
 	if (os_atomic_dec_long(&frame->refs) == 0)
-		obs_source_frame_destroy(frame);
+		async_frame_destroy(frame);
 }
 
 static bool obs_source_filter_remove_refless(obs_source_t *source,
@@ -667,6 +700,10 @@ void obs_source_destroy(struct obs_source *source)
 		gs_texture_destroy(source->async_textures[c]);
 		gs_texture_destroy(source->async_prev_textures[c]);
 	}
+	gs_upload_ring_destroy(source->async_upload_ring);
+	for (i = 0; i < source->async_upload_retired.num; i++)
+		gs_upload_ring_destroy(source->async_upload_retired.array[i]);
+	da_free(source->async_upload_retired);
 	if (source->filter_texrender)
 		gs_texrender_destroy(source->filter_texrender);
 	gs_leave_context();
@@ -676,6 +713,7 @@ void obs_source_destroy(struct obs_source *source)
 	for (i = 0; i < MAX_AUDIO_CHANNELS; i++)
 		circlebuf_free(&source->audio_input_buf[i]);
 	audio_resampler_destroy(source->resampler);
+	audio_converter_destroy(source->audio_converter);
 	bfree(source->audio_output_buf[0][0]);
 	bfree(source->audio_mix_buf[0]);
 
@@ -697,6 +735,7 @@ void obs_source_destroy(struct obs_source *source)
 	pthread_mutex_destroy(&source->audio_mutex);
 	pthread_mutex_destroy(&source->caption_cb_mutex);
 	pthread_mutex_destroy(&source->async_mutex);
+	pthread_mutex_destroy(&source->async_upload_mutex);
 	obs_data_release(source->private_settings);
 	obs_context_data_free(&source->context);
 
@@ -913,12 +952,82 @@ uint32_t obs_get_source_output_flags(const char *id)
 	return info ? info->output_flags : 0;
 }
 
+void obs_source_bump_video_version(obs_source_t *source)
+{
+	while (source) {
+		os_atomic_inc_long(&source->video_version);
+		source = source->filter_parent;
+	}
+}
+
+void obs_source_invalidate_video(obs_source_t *source)
+{
+	if (!obs_source_valid(source, "obs_source_invalidate_video"))
+		return;
+
+	obs_source_bump_video_version(source);
+}
+
+static inline bool video_content_static(const obs_source_t *source)
+{
+	uint32_t flags = source->info.output_flags;
+
+	if ((flags & OBS_SOURCE_STATIC_VIDEO) != 0)
+		return true;
+
+	/* async frames bump the version when they are consumed */
+	return (flags & OBS_SOURCE_ASYNC_VIDEO) == OBS_SOURCE_ASYNC_VIDEO &&
+	       !source->info.video_render && !deinterlacing_enabled(source);
+}
+
+static bool filters_static(obs_source_t *source)
+{
+	bool success = true;
+
+	pthread_mutex_lock(&source->filter_mutex);
+	for (size_t i = 0; i < source->filters.num; i++) {
+		obs_source_t *filter = source->filters.array[i];
+		uint32_t flags = filter->info.output_flags;
+
+		if (!filter->enabled || (flags & OBS_SOURCE_VIDEO) == 0)
+			continue;
+		if ((flags & OBS_SOURCE_STATIC_VIDEO) == 0) {
+			success = false;
+			break;
+		}
+	}
+	pthread_mutex_unlock(&source->filter_mutex);
+
+	return success;
+}
+
+/* returns 0 if the video of the source cannot be cached, otherwise a value
+ * that changes whenever its video may have changed */
+uint64_t obs_source_get_content_version(obs_source_t *source)
+{
+	if (!source || source->removed || !source->enabled)
+		return 0;
+	if (source->info.type == OBS_SOURCE_TYPE_TRANSITION)
+		return 0;
+	if (source->info.type != OBS_SOURCE_TYPE_SCENE &&
+	    !video_content_static(source))
+		return 0;
+	if (!filters_static(source))
+		return 0;
+
+	if (source->info.type == OBS_SOURCE_TYPE_SCENE)
+		return obs_scene_get_content_version(source->context.data);
+
+	return (uint64_t)os_atomic_load_long(&source->video_version) + 1;
+}
+
 static void obs_source_deferred_update(obs_source_t *source)
 {
 	if (source->context.data && source->info.update) {
 		long count = os_atomic_load_long(&source->defer_update_count);
 		source->info.update(source->context.data,
 				    source->context.settings);
+		obs_source_bump_video_version(source);
 		os_atomic_compare_swap_long(&source->defer_update_count, count,
 					    0);
 	}
@@ -938,6 +1047,7 @@ void obs_source_update(obs_source_t *source, obs_data_t *settings)
 	} else if (source->context.data && source->info.update) {
 		source->info.update(source->context.data,
 				    source->context.settings);
+		obs_source_bump_video_version(source);
 	}
 }
 
@@ -1139,6 +1249,7 @@ static inline struct obs_source_frame *get_closest_frame(obs_source_t *source,
 							 uint64_t sys_time);
 bool set_async_texture_size(struct obs_source *source,
 			    const struct obs_source_frame *frame);
+static void tick_async_upload_ring(struct obs_source *source);
 
 static void async_tick(obs_source_t *source)
 {
@@ -1160,18 +1271,25 @@ static void async_tick(obs_source_t *source)
 	source->last_sys_timestamp = sys_time;
 	pthread_mutex_unlock(&source->async_mutex);
 
-	if (source->cur_async_frame)
+	if (source->cur_async_frame) {
 		source->async_update_texture =
 			set_async_texture_size(source, source->cur_async_frame);
+		obs_source_bump_video_version(source);
+	}
+
+	tick_async_upload_ring(source);
 }
 
 void obs_source_video_tick(obs_source_t *source, float seconds)
 {
 	bool now_showing, now_active;
+	uint64_t start;
 
 	if (!obs_source_valid(source, "obs_source_video_tick"))
 		return;
 
+	start = os_gettime_ns();
+
 	if (source->info.type == OBS_SOURCE_TYPE_TRANSITION)
 		obs_transition_tick(source, seconds);
 
@@ -1238,6 +1356,8 @@ void obs_source_video_tick(obs_source_t *source, float seconds)
 
 	source->async_rendered = false;
 	source->deinterlace_rendered = false;
+
+	obs_perf_counter_add(&source->perf.tick, os_gettime_ns() - start);
 }
 
 /* unless the value is 3+ hours worth of frames, this won't overflow */
@@ -1503,6 +1623,9 @@ enum convert_type {
 	CONVERT_800,
 	CONVERT_RGB_LIMITED,
 	CONVERT_BGR3,
+	CONVERT_I010,
+	CONVERT_P010,
+	CONVERT_I210,
 };
 
 static inline enum convert_type get_convert_type(enum video_format format,
@@ -1546,6 +1669,15 @@ static inline enum convert_type get_convert_type(enum video_format format,
 
 	case VIDEO_FORMAT_AYUV:
 		return CONVERT_444_A_PACK;
+
+	case VIDEO_FORMAT_I010:
+		return CONVERT_I010;
+
+	case VIDEO_FORMAT_P010:
+		return CONVERT_P010;
+
+	case VIDEO_FORMAT_I210:
+		return CONVERT_I210;
 	}
 
 	return CONVERT_NONE;
@@ -1723,6 +1855,53 @@ static inline bool set_bgr3_sizes(struct obs_source *source,
 	return true;
 }
 
+static inline bool set_i010_sizes(struct obs_source *source,
+				  const struct obs_source_frame *frame)
+{
+	source->async_convert_width[0] = frame->width;
+	source->async_convert_width[1] = frame->width / 2;
+	source->async_convert_width[2] = frame->width / 2;
+	source->async_convert_height[0] = frame->height;
+	source->async_convert_height[1] = frame->height / 2;
+	source->async_convert_height[2] = frame->height / 2;
+	source->async_texture_formats[0] = GS_R16;
+	source->async_texture_formats[1] = GS_R16;
+	source->async_texture_formats[2] = GS_R16;
+	source->async_channel_count = 3;
+	return true;
+}
+
+/* the interleaved chroma plane is uploaded as single channel texture of
+ * twice the width, the same way as BGR3 */
+static inline bool set_p010_sizes(struct obs_source *source,
+				  const struct obs_source_frame *frame)
+{
+	source->async_convert_width[0] = frame->width;
+	source->async_convert_width[1] = (frame->width / 2) * 2;
+	source->async_convert_height[0] = frame->height;
+	source->async_convert_height[1] = frame->height / 2;
+	source->async_texture_formats[0] = GS_R16;
+	source->async_texture_formats[1] = GS_R16;
+	source->async_channel_count = 2;
+	return true;
+}
+
+static inline bool set_i210_sizes(struct obs_source *source,
+				  const struct obs_source_frame *frame)
+{
+	source->async_convert_width[0] = frame->width;
+	source->async_convert_width[1] = frame->width / 2;
+	source->async_convert_width[2] = frame->width / 2;
+	source->async_convert_height[0] = frame->height;
+	source->async_convert_height[1] = frame->height;
+	source->async_convert_height[2] = frame->height;
+	source->async_texture_formats[0] = GS_R16;
+	source->async_texture_formats[1] = GS_R16;
+	source->async_texture_formats[2] = GS_R16;
+	source->async_channel_count = 3;
+	return true;
+}
+
 static inline bool init_gpu_conversion(struct obs_source *source,
 				       const struct obs_source_frame *frame)
 {
@@ -1763,6 +1942,15 @@ static inline bool init_gpu_conversion(struct obs_source *source,
 	case CONVERT_444_A_PACK:
 		return set_packed444_alpha_sizes(source, frame);
 
+	case CONVERT_I010:
+		return set_i010_sizes(source, frame);
+
+	case CONVERT_P010:
+		return set_p010_sizes(source, frame);
+
+	case CONVERT_I210:
+		return set_i210_sizes(source, frame);
+
 	case CONVERT_NONE:
 		assert(false && "No conversion requested");
 		break;
@@ -1770,6 +1958,89 @@ static inline bool init_gpu_conversion(struct obs_source *source,
 	return false;
 }
 
+#define ASYNC_UPLOAD_SLOTS 4
+
+/* lays the planes of the frame out one after another in every slot of the
+ * upload ring, with the same line sizes as the frame */
+static void reset_async_upload_ring(struct obs_source *source,
+				    const struct obs_source_frame *frame)
+{
+	uint32_t linesize[MAX_AV_PLANES] = {0};
+	uint32_t lines[MAX_AV_PLANES] = {0};
+	size_t offset[MAX_AV_PLANES] = {0};
+	gs_upload_ring_t *ring = NULL;
+	gs_upload_ring_t *prev_ring;
+	size_t size = 0;
+
+	for (size_t c = 0; c < MAX_AV_PLANES; c++) {
+		gs_texture_t *tex = source->async_textures[c];
+
+		if (!tex)
+			break;
+
+		linesize[c] = frame->linesize[c];
+		lines[c] = gs_texture_get_height(tex);
+		offset[c] = size;
+		size += ((size_t)linesize[c] * lines[c] + 63) & ~(size_t)63;
+	}
+
+	if (size)
+		ring = gs_upload_ring_create(size, ASYNC_UPLOAD_SLOTS);
+
+	pthread_mutex_lock(&source->async_upload_mutex);
+	pthread_mutex_lock(&source->async_mutex);
+
+	for (size_t i = 0; i < source->async_cache.num; i++)
+		source->async_cache.array[i].upload_slot = -1;
+
+	/* a thread that is still copying into the previous ring keeps it
+	 * alive until the copy is done */
+	prev_ring = source->async_upload_ring;
+	if (prev_ring && source->async_upload_staging) {
+		da_push_back(source->async_upload_retired, &prev_ring);
+		prev_ring = NULL;
+	}
+
+	source->async_upload_ring = ring;
+	source->async_upload_format = frame->format;
+	source->async_upload_width = frame->width;
+	source->async_upload_height = frame->height;
+	memcpy(source->async_upload_linesize, linesize, sizeof(linesize));
+	memcpy(source->async_upload_lines, lines, sizeof(lines));
+	memcpy(source->async_upload_offset, offset, sizeof(offset));
+
+	pthread_mutex_unlock(&source->async_mutex);
+	pthread_mutex_unlock(&source->async_upload_mutex);
+
+	gs_upload_ring_destroy(prev_ring);
+}
+
+/* returns the slots the GPU is done with and destroys retired rings.  this
+ * runs every frame, a ring with all slots in flight would otherwise only be
+ * reclaimed when something is submitted, which needs a free slot. */
+static void tick_async_upload_ring(struct obs_source *source)
+{
+	DARRAY(gs_upload_ring_t *) retired;
+
+	da_init(retired);
+
+	pthread_mutex_lock(&source->async_upload_mutex);
+	if (!source->async_upload_staging)
+		da_move(retired, source->async_upload_retired);
+	pthread_mutex_unlock(&source->async_upload_mutex);
+
+	if (!source->async_upload_ring && !retired.num)
+		return;
+
+	obs_enter_graphics();
+	gs_upload_ring_reclaim(source->async_upload_ring);
+	for (size_t i = 0; i < retired.num; i++)
+		gs_upload_ring_destroy(retired.array[i]);
+	obs_leave_graphics();
+
+	da_free(retired);
+}
+
 bool set_async_texture_size(struct obs_source *source,
 			    const struct obs_source_frame *frame)
 {
@@ -1824,6 +2095,8 @@ bool set_async_texture_size(struct obs_source *source,
 	if (deinterlacing_enabled(source))
 		set_deinterlace_texture_size(source);
 
+	reset_async_upload_ring(source, frame);
+
 	gs_leave_context();
 
 	return source->async_textures[0] != NULL;
@@ -1845,6 +2118,9 @@ static void upload_raw_frame(gs_texture_t *tex[MAX_AV_PLANES],
 	case CONVERT_422_A:
 	case CONVERT_444_A:
 	case CONVERT_444_A_PACK:
+	case CONVERT_I010:
+	case CONVERT_P010:
+	case CONVERT_I210:
 		for (size_t c = 0; c < MAX_AV_PLANES; c++) {
 			if (tex[c])
 				gs_texture_set_image(tex[c], frame->data[c],
@@ -1858,6 +2134,97 @@ static void upload_raw_frame(gs_texture_t *tex[MAX_AV_PLANES],
 	}
 }
 
+static long take_upload_slot(struct obs_source *source,
+			     const struct obs_source_frame *frame)
+{
+	long slot = -1;
+
+	pthread_mutex_lock(&source->async_mutex);
+
+	for (size_t i = 0; i < source->async_cache.num; i++) {
+		struct async_frame *af = &source->async_cache.array[i];
+
+		if (af->frame == frame) {
+			slot = af->upload_slot;
+			af->upload_slot = -1;
+			break;
+		}
+	}
+
+	pthread_mutex_unlock(&source->async_mutex);
+	return slot;
+}
+
+/* copies the planes of a frame that was already staged in an upload buffer by
+ * the thread that output it.  async filters may have changed the frame data
+ * since then, in which case the staged copy cannot be used. */
+static bool upload_staged_frame(struct obs_source *source,
+				gs_texture_t *tex[MAX_AV_PLANES],
+				const struct obs_source_frame *frame)
+{
+	gs_upload_ring_t *ring = source->async_upload_ring;
+	long slot = take_upload_slot(source, frame);
+	bool submit = false;
+	bool success = true;
+
+	if (slot < 0)
+		return false;
+
+	if (source->async_filtered) {
+		gs_upload_ring_release(ring, (uint32_t)slot);
+		return false;
+	}
+
+	for (size_t c = 0; c < MAX_AV_PLANES && success; c++) {
+		if (!tex[c])
+			continue;
+
+		success = source->async_upload_lines[c] != 0 &&
+			  gs_texture_set_image_from_ring(
+				  tex[c], ring, (uint32_t)slot,
+				  source->async_upload_offset[c],
+				  source->async_upload_linesize[c]);
+		submit = submit || success;
+	}
+
+	if (submit)
+		gs_upload_ring_submit(ring, (uint32_t)slot);
+	else
+		gs_upload_ring_release(ring, (uint32_t)slot);
+
+	return success;
+}
+
+static void upload_async_frame(struct obs_source *source,
+			       gs_texture_t *tex[MAX_AV_PLANES],
+			       const struct obs_source_frame *frame)
+{
+	struct obs_source_upload_stats *stats = &source->upload_stats;
+	uint64_t start = os_gettime_ns();
+	bool streamed = upload_staged_frame(source, tex, frame);
+	uint64_t bytes = 0;
+
+	if (!streamed) {
+		if (get_convert_type(frame->format, frame->full_range) ==
+		    CONVERT_NONE)
+			gs_texture_set_image(tex[0], frame->data[0],
+					     frame->linesize[0], false);
+		else
+			upload_raw_frame(tex, frame);
+	}
+
+	stats->last_upload_time_ns = os_gettime_ns() - start;
+	stats->upload_time_ns += stats->last_upload_time_ns;
+	stats->uploaded_frames++;
+	if (streamed)
+		stats->streamed_frames++;
+
+	for (size_t c = 0; c < MAX_AV_PLANES && tex[c]; c++)
+		bytes += (uint64_t)frame->linesize[c] *
+			 gs_texture_get_height(tex[c]);
+	obs_perf_counter_add(&source->perf.upload, bytes);
+}
+
 static const char *select_conversion_technique(enum video_format format,
 					       bool full_range)
 {
@@ -1901,6 +2268,15 @@ static const char *select_conversion_technique(enum video_format format,
 	case VIDEO_FORMAT_AYUV:
 		return "AYUV_Reverse";
 
+	case VIDEO_FORMAT_I010:
+		return "I010_Reverse";
+
+	case VIDEO_FORMAT_P010:
+		return "P010_Reverse";
+
+	case VIDEO_FORMAT_I210:
+		return "I210_Reverse";
+
 	case VIDEO_FORMAT_BGRA:
 	case VIDEO_FORMAT_BGRX:
 	case VIDEO_FORMAT_RGBA:
@@ -1914,16 +2290,39 @@ static const char *select_conversion_technique(enum video_format format,
 	return NULL;
 }
 
-static inline void set_eparam(gs_effect_t *effect, const char *name, float val)
-{
-	gs_eparam_t *param = gs_effect_get_param_by_name(effect, name);
-	gs_effect_set_float(param, val);
-}
+static struct gs_effect_param_key image_key = GS_EFFECT_PARAM_KEY("image");
 
-static inline void set_eparami(gs_effect_t *effect, const char *name, int val)
+static struct gs_effect_param_key conv_image_keys[] = {
+	GS_EFFECT_PARAM_KEY("image"),
+	GS_EFFECT_PARAM_KEY("image1"),
+	GS_EFFECT_PARAM_KEY("image2"),
+	GS_EFFECT_PARAM_KEY("image3"),
+};
+static struct gs_effect_param_key conv_width = GS_EFFECT_PARAM_KEY("width");
+static struct gs_effect_param_key conv_height = GS_EFFECT_PARAM_KEY("height");
+static struct gs_effect_param_key conv_width_d2 =
+	GS_EFFECT_PARAM_KEY("width_d2");
+static struct gs_effect_param_key conv_height_d2 =
+	GS_EFFECT_PARAM_KEY("height_d2");
+static struct gs_effect_param_key conv_width_x2_i =
+	GS_EFFECT_PARAM_KEY("width_x2_i");
+static struct gs_effect_param_key conv_color_vec[] = {
+	GS_EFFECT_PARAM_KEY("color_vec0"),
+	GS_EFFECT_PARAM_KEY("color_vec1"),
+	GS_EFFECT_PARAM_KEY("color_vec2"),
+};
+static struct gs_effect_param_key color_matrix_key =
+	GS_EFFECT_PARAM_KEY("color_matrix");
+static struct gs_effect_param_key color_range_min_key =
+	GS_EFFECT_PARAM_KEY("color_range_min");
+static struct gs_effect_param_key color_range_max_key =
+	GS_EFFECT_PARAM_KEY("color_range_max");
+
+static inline void set_eparam(gs_effect_t *effect,
+			      struct gs_effect_param_key *key, float val)
 {
-	gs_eparam_t *param = gs_effect_get_param_by_name(effect, name);
-	gs_effect_set_int(param, val);
+	gs_eparam_t *param = gs_effect_get_param_by_key(effect, key);
+	gs_effect_set_float(param, val);
 }
 
 static bool update_async_texrender(struct obs_source *source,
@@ -1935,7 +2334,7 @@ static bool update_async_texrender(struct obs_source *source,
 
 	gs_texrender_reset(texrender);
 
-	upload_raw_frame(tex, frame);
+	upload_async_frame(source, tex, frame);
 
 	uint32_t cx = source->async_width;
 	uint32_t cy = source->async_height;
@@ -1953,27 +2352,18 @@ static bool update_async_texrender(struct obs_source *source,
 		gs_technique_begin(tech);
 		gs_technique_begin_pass(tech, 0);
 
-		if (tex[0])
-			gs_effect_set_texture(
-				gs_effect_get_param_by_name(conv, "image"),
-				tex[0]);
-		if (tex[1])
-			gs_effect_set_texture(
-				gs_effect_get_param_by_name(conv, "image1"),
-				tex[1]);
-		if (tex[2])
-			gs_effect_set_texture(
-				gs_effect_get_param_by_name(conv, "image2"),
-				tex[2]);
-		if (tex[3])
-			gs_effect_set_texture(
-				gs_effect_get_param_by_name(conv, "image3"),
-				tex[3]);
-		set_eparam(conv, "width", (float)cx);
-		set_eparam(conv, "height", (float)cy);
-		set_eparam(conv, "width_d2", (float)cx * 0.5f);
-		set_eparam(conv, "height_d2", (float)cy * 0.5f);
-		set_eparam(conv, "width_x2_i", 0.5f / (float)cx);
+		for (size_t i = 0; i < 4; i++) {
+			if (tex[i])
+				gs_effect_set_texture(
+					gs_effect_get_param_by_key(
+						conv, &conv_image_keys[i]),
+					tex[i]);
+		}
+		set_eparam(conv, &conv_width, (float)cx);
+		set_eparam(conv, &conv_height, (float)cy);
+		set_eparam(conv, &conv_width_d2, (float)cx * 0.5f);
+		set_eparam(conv, &conv_height_d2, (float)cy * 0.5f);
+		set_eparam(conv, &conv_width_x2_i, 0.5f / (float)cx);
 
 		struct vec4 vec0, vec1, vec2;
 		vec4_set(&vec0, frame->color_matrix[0], frame->color_matrix[1],
@@ -1983,18 +2373,21 @@ static bool update_async_texrender(struct obs_source *source,
 		vec4_set(&vec2, frame->color_matrix[8], frame->color_matrix[9],
 			 frame->color_matrix[10], frame->color_matrix[11]);
 		gs_effect_set_vec4(
-			gs_effect_get_param_by_name(conv, "color_vec0"), &vec0);
+			gs_effect_get_param_by_key(conv, &conv_color_vec[0]),
+			&vec0);
 		gs_effect_set_vec4(
-			gs_effect_get_param_by_name(conv, "color_vec1"), &vec1);
+			gs_effect_get_param_by_key(conv, &conv_color_vec[1]),
+			&vec1);
 		gs_effect_set_vec4(
-			gs_effect_get_param_by_name(conv, "color_vec2"), &vec2);
+			gs_effect_get_param_by_key(conv, &conv_color_vec[2]),
+			&vec2);
 		if (!frame->full_range) {
-			gs_eparam_t *min_param = gs_effect_get_param_by_name(
-				conv, "color_range_min");
+			gs_eparam_t *min_param = gs_effect_get_param_by_key(
+				conv, &color_range_min_key);
 			gs_effect_set_val(min_param, frame->color_range_min,
 					  sizeof(float) * 3);
-			gs_eparam_t *max_param = gs_effect_get_param_by_name(
-				conv, "color_range_max");
+			gs_eparam_t *max_param = gs_effect_get_param_by_key(
+				conv, &color_range_max_key);
 			gs_effect_set_val(max_param, frame->color_range_max,
 					  sizeof(float) * 3);
 		}
@@ -2038,8 +2431,7 @@ bool update_async_textures(struct obs_source *source,
 
 	type = get_convert_type(frame->format, frame->full_range);
 	if (type == CONVERT_NONE) {
-		gs_texture_set_image(tex[0], frame->data[0], frame->linesize[0],
-				     false);
+		upload_async_frame(source, tex, frame);
 		return true;
 	}
 
@@ -2055,7 +2447,7 @@ static inline void obs_source_draw_texture(struct obs_source *source,
 	if (source->async_texrender)
 		tex = gs_texrender_get_texture(source->async_texrender);
 
-	param = gs_effect_get_param_by_name(effect, "image");
+	param = gs_effect_get_param_by_key(effect, &image_key);
 
 	const bool linear_srgb = gs_get_linear_srgb();
 
@@ -2322,11 +2714,32 @@ static inline void render_video(obs_source_t *source)
 
 void obs_source_video_render(obs_source_t *source)
 {
+	struct obs_core_video *video = &obs->video;
+	uint64_t nested_ns, start, elapsed;
+	size_t gpu_record;
+
 	if (!obs_source_valid(source, "obs_source_video_render"))
 		return;
 
 	obs_source_addref(source);
+
+	/* the time spent rendering other sources from within this one is
+	 * accounted to them, not to this source */
+	nested_ns = video->render_nested_ns;
+	video->render_nested_ns = 0;
+	gpu_record = obs_gpu_timing_begin(source);
+	start = os_gettime_ns();
+
 	render_video(source);
+
+	elapsed = os_gettime_ns() - start;
+	obs_gpu_timing_end(gpu_record);
+	obs_perf_counter_add(&source->perf.render,
+			     elapsed > video->render_nested_ns
+				     ? elapsed - video->render_nested_ns
+				     : 0);
+	video->render_nested_ns = nested_ns + elapsed;
+
 	obs_source_release(source);
 }
 
@@ -2505,6 +2918,8 @@ void obs_source_filter_add(obs_source_t *source, obs_source_t *filter)
 
 	pthread_mutex_unlock(&source->filter_mutex);
 
+	obs_source_bump_video_version(source);
+
 	calldata_init_fixed(&cd, stack, sizeof(stack));
 	calldata_set_ptr(&cd, "source", source);
 	calldata_set_ptr(&cd, "filter", filter);
@@ -2539,6 +2954,8 @@ static bool obs_source_filter_remove_refless(obs_source_t *source,
 
 	pthread_mutex_unlock(&source->filter_mutex);
 
+	obs_source_bump_video_version(source);
+
 	calldata_init_fixed(&cd, stack, sizeof(stack));
 	calldata_set_ptr(&cd, "source", source);
 	calldata_set_ptr(&cd, "filter", filter);
@@ -2666,8 +3083,10 @@ void obs_source_filter_set_order(obs_source_t *source, obs_source_t *filter,
 	success = move_filter_dir(source, filter, movement);
 	pthread_mutex_unlock(&source->filter_mutex);
 
-	if (success)
+	if (success) {
+		obs_source_bump_video_version(source);
 		obs_source_dosignal(source, NULL, "reorder_filters");
+	}
 }
 
 obs_data_t *obs_source_get_settings(const obs_source_t *source)
@@ -2682,6 +3101,7 @@ obs_data_t *obs_source_get_settings(const obs_source_t *source)
 struct obs_source_frame *filter_async_video(obs_source_t *source,
 					    struct obs_source_frame *in)
 {
+	bool filtered = false;
 	size_t i;
 
 	pthread_mutex_lock(&source->filter_mutex);
@@ -2693,6 +3113,7 @@ struct obs_source_frame *filter_async_video(obs_source_t *source,
 			continue;
 
 		if (filter->context.data && filter->info.filter_video) {
+			filtered = true;
 			in = filter->info.filter_video(filter->context.data,
 						       in);
 			if (!in)
@@ -2702,6 +3123,8 @@ struct obs_source_frame *filter_async_video(obs_source_t *source,
 
 	pthread_mutex_unlock(&source->filter_mutex);
 
+	source->async_filtered = filtered;
+
 	return in;
 }
 
@@ -2735,7 +3158,7 @@ static void copy_frame_data(struct obs_source_frame *dst,
 			    const struct obs_source_frame *src)
 {
 	dst->flip = src->flip;
-	dst->flags = src->flags;
+	dst->flags = src->flags & ~OBS_SOURCE_FRAME_EXTERNAL;
 	dst->full_range = src->full_range;
 	dst->timestamp = src->timestamp;
 	memcpy(dst->color_matrix, src->color_matrix, sizeof(float) * 16);
@@ -2747,18 +3170,21 @@ static void copy_frame_data(struct obs_source_frame *dst,
 
 	switch (src->format) {
 	case VIDEO_FORMAT_I420:
+	case VIDEO_FORMAT_I010:
 		copy_frame_data_plane(dst, src, 0, dst->height);
 		copy_frame_data_plane(dst, src, 1, dst->height / 2);
 		copy_frame_data_plane(dst, src, 2, dst->height / 2);
 		break;
 
 	case VIDEO_FORMAT_NV12:
+	case VIDEO_FORMAT_P010:
 		copy_frame_data_plane(dst, src, 0, dst->height);
 		copy_frame_data_plane(dst, src, 1, dst->height / 2);
 		break;
 
 	case VIDEO_FORMAT_I444:
 	case VIDEO_FORMAT_I422:
+	case VIDEO_FORMAT_I210:
 		copy_frame_data_plane(dst, src, 0, dst->height);
 		copy_frame_data_plane(dst, src, 1, dst->height);
 		copy_frame_data_plane(dst, src, 2, dst->height);
@@ -2812,10 +3238,22 @@ static inline bool async_texture_changed(struct obs_source *source,
 	       source->async_cache_height != frame->height || prev != cur;
 }
 
+static inline void release_upload_slot(struct obs_source *source,
+				       struct async_frame *af)
+{
+	if (af->upload_slot >= 0) {
+		gs_upload_ring_release(source->async_upload_ring,
+				       (uint32_t)af->upload_slot);
+		af->upload_slot = -1;
+	}
+}
+
 static inline void free_async_cache(struct obs_source *source)
 {
-	for (size_t i = 0; i < source->async_cache.num; i++)
+	for (size_t i = 0; i < source->async_cache.num; i++) {
+		release_upload_slot(source, &source->async_cache.array[i]);
 		obs_source_frame_decref(source->async_cache.array[i].frame);
+	}
 
 	da_resize(source->async_cache, 0);
 	da_resize(source->async_frames, 0);
@@ -2833,13 +3271,100 @@ static void clean_cache(obs_source_t *source)
 		struct async_frame *af = &source->async_cache.array[i - 1];
 		if (!af->used) {
 			if (++af->unused_count == MAX_UNUSED_FRAME_DURATION) {
-				obs_source_frame_destroy(af->frame);
+				release_upload_slot(source, af);
+				async_frame_destroy(af->frame);
 				da_erase(source->async_cache, i - 1);
 			}
 		}
 	}
 }
 
+static inline bool upload_layout_matches(const struct obs_source *source,
+					 const struct obs_source_frame *frame)
+{
+	if (!source->async_upload_ring ||
+	    source->async_upload_format != frame->format ||
+	    source->async_upload_width != frame->width ||
+	    source->async_upload_height != frame->height)
+		return false;
+
+	for (size_t c = 0; c < MAX_AV_PLANES; c++) {
+		if (source->async_upload_lines[c] &&
+		    source->async_upload_linesize[c] != frame->linesize[c])
+			return false;
+	}
+
+	return true;
+}
+
+/* copies a cached frame into a free slot of the upload ring, so that the
+ * graphics thread only has to issue the copy from the slot to the textures.
+ * the copy is done without the mutex held, the graphics thread retires the
+ * ring instead of destroying it if it is replaced in the meantime. */
+static void stage_async_upload(struct obs_source *source,
+			       const struct obs_source_frame *frame)
+{
+	uint64_t start = os_gettime_ns();
+	uint32_t linesize[MAX_AV_PLANES];
+	uint32_t lines[MAX_AV_PLANES];
+	size_t offset[MAX_AV_PLANES];
+	gs_upload_ring_t *ring = NULL;
+	uint32_t slot = 0;
+	uint8_t *data = NULL;
+
+	pthread_mutex_lock(&source->async_upload_mutex);
+
+	if (upload_layout_matches(source, frame)) {
+		ring = source->async_upload_ring;
+		data = gs_upload_ring_acquire(ring, &slot);
+	}
+	if (!data) {
+		pthread_mutex_unlock(&source->async_upload_mutex);
+		return;
+	}
+
+	memcpy(linesize, source->async_upload_linesize, sizeof(linesize));
+	memcpy(lines, source->async_upload_lines, sizeof(lines));
+	memcpy(offset, source->async_upload_offset, sizeof(offset));
+	source->async_upload_staging++;
+
+	pthread_mutex_unlock(&source->async_upload_mutex);
+
+	for (size_t c = 0; c < MAX_AV_PLANES; c++) {
+		size_t size = (size_t)linesize[c] * lines[c];
+		if (size)
+			memcpy(data + offset[c], frame->data[c], size);
+	}
+
+	pthread_mutex_lock(&source->async_upload_mutex);
+	source->async_upload_staging--;
+
+	if (ring == source->async_upload_ring) {
+		pthread_mutex_lock(&source->async_mutex);
+
+		for (size_t i = 0; i < source->async_cache.num; i++) {
+			struct async_frame *af = &source->async_cache.array[i];
+
+			if (af->frame == frame) {
+				release_upload_slot(source, af);
+				af->upload_slot = (long)slot;
+				data = NULL;
+				break;
+			}
+		}
+
+		if (data)
+			gs_upload_ring_release(ring, slot);
+
+		pthread_mutex_unlock(&source->async_mutex);
+
+		source->upload_stats.staged_frames++;
+		source->upload_stats.stage_time_ns += os_gettime_ns() - start;
+	}
+
+	pthread_mutex_unlock(&source->async_upload_mutex);
+}
+
 #define MAX_ASYNC_FRAMES 30
 //if return value is not null then do (os_atomic_dec_long(&output->refs) == 0) && obs_source_frame_destroy(output)
 static inline struct obs_source_frame *
@@ -2873,6 +3398,7 @@ cache_video(struct obs_source *source, const struct obs_source_frame *frame)
 			new_frame->format = format;
 			af->used = true;
 			af->unused_count = 0;
+			release_upload_slot(source, af);
 			break;
 		}
 	}
@@ -2886,7 +3412,9 @@ cache_video(struct obs_source *source, const struct obs_source_frame *frame)
 						    frame->height);
 		new_af.frame = new_frame;
 		new_af.used = true;
+		new_af.external = false;
 		new_af.unused_count = 0;
+		new_af.upload_slot = -1;
 		new_frame->refs = 1;
 
 		da_push_back(source->async_cache, &new_af);
@@ -2897,29 +3425,70 @@ cache_video(struct obs_source *source, const struct obs_source_frame *frame)
 	pthread_mutex_unlock(&source->async_mutex);
 
 	copy_frame_data(new_frame, frame);
+	stage_async_upload(source, new_frame);
 
 	return new_frame;
 }
 
-static void
-obs_source_output_video_internal(obs_source_t *source,
-				 const struct obs_source_frame *frame)
+/* same as cache_video, but the frame keeps pointing to the data of the source
+ * instead of a copy of it */
+static inline struct obs_source_frame *
+cache_external_video(struct obs_source *source,
+		     const struct obs_source_frame *frame,
+		     void (*release)(void *param), void *param)
 {
-	if (!obs_source_valid(source, "obs_source_output_video"))
-		return;
+	struct external_frame *ext;
+	struct async_frame new_af;
 
-	if (!frame) {
-		source->async_active = false;
-		return;
+	pthread_mutex_lock(&source->async_mutex);
+
+	if (source->async_frames.num >= MAX_ASYNC_FRAMES) {
+		free_async_cache(source);
+		source->last_frame_ts = 0;
+		pthread_mutex_unlock(&source->async_mutex);
+		return NULL;
 	}
 
-	struct obs_source_frame *output = cache_video(source, frame);
+	if (async_texture_changed(source, frame)) {
+		free_async_cache(source);
+		source->async_cache_width = frame->width;
+		source->async_cache_height = frame->height;
+	}
+
+	source->async_cache_format = frame->format;
+	source->async_cache_full_range = frame->full_range;
 
-	/* ------------------------------------------- */
+	clean_cache(source);
+
+	ext = bzalloc(sizeof(struct external_frame));
+	ext->frame = *frame;
+	ext->frame.flags |= OBS_SOURCE_FRAME_EXTERNAL;
+	ext->frame.prev_frame = false;
+	ext->frame.refs = 2;
+	ext->release = release;
+	ext->param = param;
+
+	new_af.frame = &ext->frame;
+	new_af.used = true;
+	new_af.external = true;
+	new_af.unused_count = 0;
+	new_af.upload_slot = -1;
+	da_push_back(source->async_cache, &new_af);
+
+	pthread_mutex_unlock(&source->async_mutex);
+
+	stage_async_upload(source, &ext->frame);
+
+	return &ext->frame;
+}
+
+static void queue_async_frame(obs_source_t *source,
+			      struct obs_source_frame *output)
+{
 	pthread_mutex_lock(&source->async_mutex);
 	if (output) {
 		if (os_atomic_dec_long(&output->refs) == 0) {
-			obs_source_frame_destroy(output);
+			async_frame_destroy(output);
 			output = NULL;
 		} else {
 			da_push_back(source->async_frames, &output);
@@ -2929,6 +3498,77 @@ obs_source_output_video_internal(obs_source_t *source,
 	pthread_mutex_unlock(&source->async_mutex);
 }
 
+static void
+obs_source_output_video_internal(obs_source_t *source,
+				 const struct obs_source_frame *frame)
+{
+	if (!obs_source_valid(source, "obs_source_output_video"))
+		return;
+
+	if (!frame) {
+		source->async_active = false;
+		obs_source_bump_video_version(source);
+		return;
+	}
+
+	queue_async_frame(source, cache_video(source, frame));
+}
+
+static bool has_async_video_filters(obs_source_t *source)
+{
+	bool found = false;
+
+	pthread_mutex_lock(&source->filter_mutex);
+	for (size_t i = 0; i < source->filters.num; i++) {
+		obs_source_t *filter = source->filters.array[i];
+
+		if (filter->enabled && filter->info.filter_video) {
+			found = true;
+			break;
+		}
+	}
+	pthread_mutex_unlock(&source->filter_mutex);
+
+	return found;
+}
+
+void obs_source_output_video_external(obs_source_t *source,
+				      const struct obs_source_frame *frame,
+				      void (*release)(void *param),
+				      void *param)
+{
+	struct obs_source_frame new_frame;
+	struct obs_source_frame *output;
+
+	if (!obs_ptr_valid(frame, "obs_source_output_video_external") ||
+	    !obs_ptr_valid(release, "obs_source_output_video_external"))
+		return;
+	if (!obs_source_valid(source, "obs_source_output_video_external")) {
+		release(param);
+		return;
+	}
+
+	new_frame = *frame;
+	new_frame.full_range =
+		format_is_yuv(frame->format) ? new_frame.full_range : true;
+
+	/* async filters such as delays may hold on to frames for long, which
+	 * would starve the source of buffers */
+	if (has_async_video_filters(source)) {
+		obs_source_output_video_internal(source, &new_frame);
+		release(param);
+		return;
+	}
+
+	output = cache_external_video(source, &new_frame, release, param);
+	if (!output) {
+		release(param);
+		return;
+	}
+
+	queue_async_frame(source, output);
+}
+
 void obs_source_output_video(obs_source_t *source,
 			     const struct obs_source_frame *frame)
 {
@@ -2985,6 +3625,17 @@ void obs_source_set_async_rotation(obs_source_t *source, long rotation)
 		source->async_rotation = rotation;
 }
 
+void obs_source_get_upload_stats(const obs_source_t *source,
+				 struct obs_source_upload_stats *stats)
+{
+	if (!obs_source_valid(source, "obs_source_get_upload_stats"))
+		return;
+	if (!obs_ptr_valid(stats, "obs_source_get_upload_stats"))
+		return;
+
+	*stats = source->upload_stats;
+}
+
 void obs_source_output_cea708(obs_source_t *source,
 			      const struct obs_source_cea_708 *captions)
 {
@@ -3127,6 +3778,7 @@ void obs_source_show_preloaded_video(obs_source_t *source)
 	update_async_textures(source, source->async_preload_frame,
 			      source->async_textures, source->async_texrender);
 	source->async_active = true;
+	obs_source_bump_video_version(source);
 
 	obs_leave_graphics();
 
@@ -3254,142 +3906,114 @@ static inline void reset_resampler(obs_source_t *source,
 	source->sample_info.speakers = audio->speakers;
 
 	audio_resampler_destroy(source->resampler);
+	audio_converter_destroy(source->audio_converter);
 	source->resampler = NULL;
 	source->resample_offset = 0;
 
-	if (source->sample_info.samples_per_sec == obs_info->samples_per_sec &&
-	    source->sample_info.format == obs_info->format &&
-	    source->sample_info.speakers == obs_info->speakers) {
-		source->audio_failed = false;
-		return;
-	}
+	source->audio_converter =
+		audio_converter_create(&output_info, &source->sample_info,
+				       AUDIO_CONVERTER_QUALITY_MEDIUM);
 
-	source->resampler =
-		audio_resampler_create(&output_info, &source->sample_info);
+	/* formats the converter can't handle are converted with swresample
+	 * first, the converter then only applies the mix */
+	if (!source->audio_converter) {
+		source->resampler = audio_resampler_create(
+			&output_info, &source->sample_info);
+		if (source->resampler)
+			source->audio_converter = audio_converter_create(
+				&output_info, &output_info,
+				AUDIO_CONVERTER_QUALITY_MEDIUM);
+	}
 
-	source->audio_failed = source->resampler == NULL;
-	if (source->resampler == NULL)
+	source->audio_failed = source->audio_converter == NULL;
+	if (source->audio_failed)
 		blog(LOG_ERROR, "creation of resampler failed");
 }
 
-static void copy_audio_data(obs_source_t *source, const uint8_t *const data[],
-			    uint32_t frames, uint64_t ts)
+static void reserve_audio_data(obs_source_t *source, uint32_t frames)
 {
 	size_t planes = audio_output_get_planes(obs->audio.audio);
 	size_t blocksize = audio_output_get_block_size(obs->audio.audio);
 	size_t size = (size_t)frames * blocksize;
-	bool resize = source->audio_storage_size < size;
 
-	source->audio_data.frames = frames;
-	source->audio_data.timestamp = ts;
+	if (source->audio_storage_size >= size)
+		return;
 
 	for (size_t i = 0; i < planes; i++) {
-		/* ensure audio storage capacity */
-		if (resize) {
-			bfree(source->audio_data.data[i]);
-			source->audio_data.data[i] = bmalloc(size);
-		}
-
-		memcpy(source->audio_data.data[i], data[i], size);
+		bfree(source->audio_data.data[i]);
+		source->audio_data.data[i] = bmalloc(size);
 	}
 
-	if (resize)
-		source->audio_storage_size = size;
+	source->audio_storage_size = size;
 }
 
-/* TODO: SSE optimization */
-static void downmix_to_mono_planar(struct obs_source *source, uint32_t frames)
+/* balance and forced mono are applied by the converter as part of the mix */
+static bool get_audio_mix(obs_source_t *source, float *gains)
 {
 	size_t channels = audio_output_get_channels(obs->audio.audio);
-	const float channels_i = 1.0f / (float)channels;
-	float **data = (float **)source->audio_data.data;
+	bool mono_output = channels == 1;
+	float balance = source->balance;
 
-	for (size_t channel = 1; channel < channels; channel++) {
-		for (uint32_t frame = 0; frame < frames; frame++)
-			data[0][frame] += data[channel][frame];
-	}
-
-	for (uint32_t frame = 0; frame < frames; frame++)
-		data[0][frame] *= channels_i;
+	for (size_t i = 0; i < MAX_AUDIO_CHANNELS; i++)
+		gains[i] = 1.0f;
 
-	for (size_t channel = 1; channel < channels; channel++) {
-		for (uint32_t frame = 0; frame < frames; frame++)
-			data[channel][frame] = data[0][frame];
+	if (!mono_output && source->sample_info.speakers == SPEAKERS_STEREO &&
+	    (balance > 0.51f || balance < 0.49f)) {
+		gains[0] = sinf((1.0f - balance) * (M_PI / 2.0f));
+		gains[1] = sinf(balance * (M_PI / 2.0f));
 	}
-}
-
-static void process_audio_balancing(struct obs_source *source, uint32_t frames,
-				    float balance, enum obs_balance_type type)
-{
-	float **data = (float **)source->audio_data.data;
 
-	switch (type) {
-	case OBS_BALANCE_TYPE_SINE_LAW:
-		for (uint32_t frame = 0; frame < frames; frame++) {
-			data[0][frame] = data[0][frame] *
-					 sinf((1.0f - balance) * (M_PI / 2.0f));
-			data[1][frame] =
-				data[1][frame] * sinf(balance * (M_PI / 2.0f));
-		}
-		break;
-	case OBS_BALANCE_TYPE_SQUARE_LAW:
-		for (uint32_t frame = 0; frame < frames; frame++) {
-			data[0][frame] = data[0][frame] * sqrtf(1.0f - balance);
-			data[1][frame] = data[1][frame] * sqrtf(balance);
-		}
-		break;
-	case OBS_BALANCE_TYPE_LINEAR:
-		for (uint32_t frame = 0; frame < frames; frame++) {
-			data[0][frame] = data[0][frame] * (1.0f - balance);
-			data[1][frame] = data[1][frame] * balance;
-		}
-		break;
-	default:
-		break;
-	}
+	return !mono_output &&
+	       (source->flags & OBS_SOURCE_FLAG_FORCE_MONO) != 0;
 }
 
-/* resamples/remixes new audio to the designated main audio output format */
-static void process_audio(obs_source_t *source,
+/* resamples/remixes new audio to the designated main audio output format,
+ * returns false if there is nothing to output */
+static bool process_audio(obs_source_t *source,
 			  const struct obs_source_audio *audio)
 {
+	const uint8_t *const *data = audio->data;
+	uint8_t *output[MAX_AV_PLANES];
 	uint32_t frames = audio->frames;
-	bool mono_output;
+	float gains[MAX_AUDIO_CHANNELS];
+	uint64_t ts_offset;
+	bool mono;
 
 	if (source->sample_info.samples_per_sec != audio->samples_per_sec ||
 	    source->sample_info.format != audio->format ||
 	    source->sample_info.speakers != audio->speakers)
 		reset_resampler(source, audio);
 
+	source->audio_data.frames = 0;
+
 	if (source->audio_failed)
-		return;
+		return false;
 
 	if (source->resampler) {
-		uint8_t *output[MAX_AV_PLANES];
-
 		memset(output, 0, sizeof(output));
 
-		audio_resampler_resample(source->resampler, output, &frames,
-					 &source->resample_offset, audio->data,
-					 audio->frames);
-
-		copy_audio_data(source, (const uint8_t *const *)output, frames,
-				audio->timestamp);
-	} else {
-		copy_audio_data(source, audio->data, audio->frames,
-				audio->timestamp);
+		if (!audio_resampler_resample(source->resampler, output,
+					      &frames, &source->resample_offset,
+					      audio->data, audio->frames))
+			return false;
+		data = (const uint8_t *const *)output;
 	}
 
-	mono_output = audio_output_get_channels(obs->audio.audio) == 1;
+	mono = get_audio_mix(source, gains);
+	audio_converter_set_mix(source->audio_converter, gains, mono);
 
-	if (!mono_output && source->sample_info.speakers == SPEAKERS_STEREO &&
-	    (source->balance > 0.51f || source->balance < 0.49f)) {
-		process_audio_balancing(source, frames, source->balance,
-					OBS_BALANCE_TYPE_SINE_LAW);
-	}
+	reserve_audio_data(source, audio_converter_get_max_frames(
+					   source->audio_converter, frames));
+
+	audio_converter_convert(source->audio_converter,
+				(float *const *)source->audio_data.data,
+				&frames, &ts_offset, data, frames);
+	if (!source->resampler)
+		source->resample_offset = ts_offset;
 
-	if (!mono_output && (source->flags & OBS_SOURCE_FLAG_FORCE_MONO) != 0)
-		downmix_to_mono_planar(source, frames);
+	source->audio_data.frames = frames;
+	source->audio_data.timestamp = audio->timestamp;
+	return true;
 }
 
 void obs_source_output_audio(obs_source_t *source,
@@ -3402,7 +4026,8 @@ void obs_source_output_audio(obs_source_t *source,
 	if (!obs_ptr_valid(audio, "obs_source_output_audio"))
 		return;
 
-	process_audio(source, audio);
+	if (!process_audio(source, audio))
+		return;
 
 	pthread_mutex_lock(&source->filter_mutex);
 	output = filter_async_audio(source, &source->audio_data);
@@ -3433,7 +4058,14 @@ void remove_async_frame(obs_source_t *source, struct obs_source_frame *frame)
 		struct async_frame *f = &source->async_cache.array[i];
 
 		if (f->frame == frame) {
+			release_upload_slot(source, f);
 			f->used = false;
+
+			/* external frames go back to their source right away */
+			if (f->external) {
+				da_erase(source->async_cache, i);
+				obs_source_frame_decref(frame);
+			}
 			break;
 		}
 	}
@@ -3584,12 +4216,12 @@ void obs_source_release_frame(obs_source_t *source,
 		return;
 
 	if (!source) {
-		obs_source_frame_destroy(frame);
+		async_frame_destroy(frame);
 	} else {
 		pthread_mutex_lock(&source->async_mutex);
 
 		if (os_atomic_dec_long(&frame->refs) == 0)
-			obs_source_frame_destroy(frame);
+			async_frame_destroy(frame);
 		else
 			remove_async_frame(source, frame);
 
@@ -3669,7 +4301,7 @@ static inline void render_filter_tex(gs_texture_t *tex, gs_effect_t *effect,
 				     const char *tech_name)
 {
 	gs_technique_t *tech = gs_effect_get_technique(effect, tech_name);
-	gs_eparam_t *image = gs_effect_get_param_by_name(effect, "image");
+	gs_eparam_t *image = gs_effect_get_param_by_key(effect, &image_key);
 	size_t passes, i;
 
 	const bool linear_srgb = gs_get_linear_srgb();
@@ -4272,9 +4904,9 @@ void obs_source_draw_set_color_matrix(const struct matrix4 *color_matrix,
 	if (!color_range_max)
 		color_range_max = &color_range_max_def;
 
-	matrix = gs_effect_get_param_by_name(effect, "color_matrix");
-	range_min = gs_effect_get_param_by_name(effect, "color_range_min");
-	range_max = gs_effect_get_param_by_name(effect, "color_range_max");
+	matrix = gs_effect_get_param_by_key(effect, &color_matrix_key);
+	range_min = gs_effect_get_param_by_key(effect, &color_range_min_key);
+	range_max = gs_effect_get_param_by_key(effect, &color_range_max_key);
 
 	gs_effect_set_matrix4(matrix, color_matrix);
 	gs_effect_set_val(range_min, color_range_min, sizeof(float) * 3);
@@ -4298,7 +4930,7 @@ void obs_source_draw(gs_texture_t *texture, int x, int y, uint32_t cx,
 	const bool previous = gs_framebuffer_srgb_enabled();
 	gs_enable_framebuffer_srgb(linear_srgb);
 
-	gs_eparam_t *image = gs_effect_get_param_by_name(effect, "image");
+	gs_eparam_t *image = gs_effect_get_param_by_key(effect, &image_key);
 	if (linear_srgb)
 		gs_effect_set_texture_srgb(image, texture);
 	else
@@ -4418,6 +5050,7 @@ void obs_source_set_enabled(obs_source_t *source, bool enabled)
 		return;
 
 	source->enabled = enabled;
+	obs_source_bump_video_version(source);
 
 	calldata_init_fixed(&data, stack, sizeof(stack));
 	calldata_set_ptr(&data, "source", source);
@@ -4895,8 +5528,8 @@ static inline void process_audio_source_tick(obs_source_t *source,
 	source->audio_pending = false;
 }
 
-void obs_source_audio_render(obs_source_t *source, uint32_t mixers,
-			     size_t channels, size_t sample_rate, size_t size)
+static void audio_render(obs_source_t *source, uint32_t mixers,
+			 size_t channels, size_t sample_rate, size_t size)
 {
 	if (!source->audio_output_buf[0][0]) {
 		source->audio_pending = true;
@@ -4924,6 +5557,15 @@ void obs_source_audio_render(obs_source_t *source, uint32_t mixers,
 	process_audio_source_tick(source, mixers, channels, sample_rate, size);
 }
 
+void obs_source_audio_render(obs_source_t *source, uint32_t mixers,
+			     size_t channels, size_t sample_rate, size_t size)
+{
+	uint64_t start = os_gettime_ns();
+
+	audio_render(source, mixers, channels, sample_rate, size);
+	obs_perf_counter_add(&source->perf.audio, os_gettime_ns() - start);
+}
+
 bool obs_source_audio_pending(const obs_source_t *source)
 {
 	if (!obs_source_valid(source, "obs_source_audio_pending"))
@@ -5034,6 +5676,93 @@ bool obs_source_async_unbuffered(const obs_source_t *source)
 		       : false;
 }
 
+void obs_source_set_video_opaque(obs_source_t *source, bool opaque)
+{
+	if (!obs_source_valid(source, "obs_source_set_video_opaque"))
+		return;
+
+	source->video_opaque = opaque;
+}
+
+bool obs_source_video_opaque(const obs_source_t *source)
+{
+	return obs_source_valid(source, "obs_source_video_opaque")
+		       ? source->video_opaque
+		       : false;
+}
+
+static inline bool format_has_alpha(enum video_format format)
+{
+	switch (format) {
+	case VIDEO_FORMAT_NONE:
+	case VIDEO_FORMAT_RGBA:
+	case VIDEO_FORMAT_BGRA:
+	case VIDEO_FORMAT_I40A:
+	case VIDEO_FORMAT_I42A:
+	case VIDEO_FORMAT_YUVA:
+	case VIDEO_FORMAT_AYUV:
+		return true;
+	case VIDEO_FORMAT_I420:
+	case VIDEO_FORMAT_NV12:
+	case VIDEO_FORMAT_YVYU:
+	case VIDEO_FORMAT_YUY2:
+	case VIDEO_FORMAT_UYVY:
+	case VIDEO_FORMAT_BGRX:
+	case VIDEO_FORMAT_Y800:
+	case VIDEO_FORMAT_I444:
+	case VIDEO_FORMAT_BGR3:
+	case VIDEO_FORMAT_I422:
+	case VIDEO_FORMAT_I010:
+	case VIDEO_FORMAT_P010:
+	case VIDEO_FORMAT_I210:
+		return false;
+	}
+
+	return true;
+}
+
+static bool has_video_filters(obs_source_t *source)
+{
+	bool found = false;
+
+	pthread_mutex_lock(&source->filter_mutex);
+	for (size_t i = 0; i < source->filters.num; i++) {
+		obs_source_t *filter = source->filters.array[i];
+		uint32_t flags = filter->info.output_flags;
+
+		if (filter->enabled && (flags & OBS_SOURCE_VIDEO) != 0) {
+			found = true;
+			break;
+		}
+	}
+	pthread_mutex_unlock(&source->filter_mutex);
+
+	return found;
+}
+
+/* whether the source draws fully opaque pixels over its whole area.  filters
+ * may change alpha, so any enabled video filter disqualifies the source */
+bool obs_source_renders_opaque(obs_source_t *source)
+{
+	uint32_t flags;
+	bool opaque;
+	bool async;
+
+	if (!source || source->removed || !source->enabled)
+		return false;
+
+	flags = source->info.output_flags;
+	async = (flags & OBS_SOURCE_ASYNC_VIDEO) == OBS_SOURCE_ASYNC_VIDEO;
+	opaque = source->video_opaque;
+
+	if (!opaque && async && !source->info.video_render) {
+		opaque = source->async_active && source->async_textures[0] &&
+			 !format_has_alpha(source->async_format);
+	}
+
+	return opaque && !has_video_filters(source);
+}
+
 obs_data_t *obs_source_get_private_settings(obs_source_t *source)
 {
 	if (!obs_ptr_valid(source, "obs_source_get_private_settings"))
@@ -5246,6 +5975,22 @@ enum obs_media_state obs_source_media_get_state(obs_source_t *source)
 		return OBS_MEDIA_STATE_NONE;
 }
 
+bool obs_source_media_get_stats(obs_source_t *source,
+				struct obs_source_media_stats *stats)
+{
+	if (!data_valid(source, "obs_source_media_get_stats"))
+		return false;
+	if (!obs_ptr_valid(stats, "obs_source_media_get_stats"))
+		return false;
+
+	memset(stats, 0, sizeof(*stats));
+	if (!source->info.media_get_stats)
+		return false;
+
+	source->info.media_get_stats(source->context.data, stats);
+	return true;
+}
+
 void obs_source_media_started(obs_source_t *source)
 {
 	if (!obs_source_valid(source, "obs_source_media_started"))
@@ -30,6 +30,8 @@
 extern "C" {
 #endif
 
+struct obs_source_media_stats;
+
 enum obs_source_type {
 	OBS_SOURCE_TYPE_INPUT,
 	OBS_SOURCE_TYPE_FILTER,
@@ -196,6 +198,13 @@ enum obs_media_state {
  */
 #define OBS_SOURCE_SRGB (1 << 15)
 
+/**
+ * Source video only changes when the source is updated or when
+ * obs_source_invalidate_video is called.  Scenes are allowed to reuse the
+ * last rendered texture of such sources.
+ */
+#define OBS_SOURCE_STATIC_VIDEO (1 << 16)
+
 /** @} */
 
 typedef void (*obs_source_enum_proc_t)(obs_source_t *parent,
@@ -540,6 +549,10 @@ struct obs_source_info {
 
 	/** Missing files **/
 	obs_missing_files_t *(*missing_files)(void *data);
+
+	/** Decoding statistics of media sources */
+	void (*media_get_stats)(void *data,
+				struct obs_source_media_stats *stats);
 };
 
 EXPORT void obs_register_source_s(const struct obs_source_info *info,
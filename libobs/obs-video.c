@@ -112,6 +112,14 @@ static inline void set_render_size(uint32_t width, uint32_t height)
 	gs_set_viewport(0, 0, width, height);
 }
 
+static inline void unmap_stage_surfaces(struct obs_core_video *video, int idx)
+{
+	for (int c = 0; c < NUM_CHANNELS; ++c) {
+		if (video->copy_surfaces[idx][c])
+			gs_stagesurface_unmap(video->copy_surfaces[idx][c]);
+	}
+}
+
 static inline void unmap_last_surface(struct obs_core_video *video)
 {
 	for (int c = 0; c < NUM_CHANNELS; ++c) {
@@ -120,6 +128,38 @@ static inline void unmap_last_surface(struct obs_core_video *video)
 			video->mapped_surfaces[c] = NULL;
 		}
 	}
+
+	/* with zero-copy readback, surfaces stay mapped until video-io is
+	 * done with them, and can only be unmapped on this thread */
+	for (size_t i = 0; i < video->num_stage_surfaces; i++) {
+		if (video->stage_surfaces_mapped[i] &&
+		    !os_atomic_load_bool(&video->stage_surfaces_busy[i])) {
+			unmap_stage_surfaces(video, (int)i);
+			video->stage_surfaces_mapped[i] = false;
+		}
+	}
+}
+
+static int get_free_stage_surface(struct obs_core_video *video,
+				  int cur_texture)
+{
+	int prev_texture = cur_texture == 0 ? NUM_TEXTURES - 1
+					    : cur_texture - 1;
+
+	if (!video->zero_copy_active)
+		return cur_texture;
+
+	for (size_t i = 0; i < video->num_stage_surfaces; i++) {
+		if (video->stage_surfaces_mapped[i])
+			continue;
+		if (video->textures_copied[prev_texture] &&
+		    video->staged_surfaces[prev_texture] == (int)i)
+			continue;
+
+		return (int)i;
+	}
+
+	return -1;
 }
 
 static const char *render_main_texture_name = "render_main_texture";
@@ -208,6 +248,18 @@ static inline gs_effect_t *get_scale_effect(struct obs_core_video *video,
 	}
 }
 
+static struct gs_effect_param_key image_key = GS_EFFECT_PARAM_KEY("image");
+static struct gs_effect_param_key base_dimension_key =
+	GS_EFFECT_PARAM_KEY("base_dimension");
+static struct gs_effect_param_key base_dimension_i_key =
+	GS_EFFECT_PARAM_KEY("base_dimension_i");
+static struct gs_effect_param_key color_vec_keys[] = {
+	GS_EFFECT_PARAM_KEY("color_vec0"),
+	GS_EFFECT_PARAM_KEY("color_vec1"),
+	GS_EFFECT_PARAM_KEY("color_vec2"),
+};
+static struct gs_effect_param_key width_i_key = GS_EFFECT_PARAM_KEY("width_i");
+
 static const char *render_output_texture_name = "render_output_texture";
 static inline gs_texture_t *render_output_texture(struct obs_core_video *video)
 {
@@ -232,11 +284,11 @@ static inline gs_texture_t *render_output_texture(struct obs_core_video *video)
 
 	profile_start(render_output_texture_name);
 
-	gs_eparam_t *image = gs_effect_get_param_by_name(effect, "image");
+	gs_eparam_t *image = gs_effect_get_param_by_key(effect, &image_key);
 	gs_eparam_t *bres =
-		gs_effect_get_param_by_name(effect, "base_dimension");
+		gs_effect_get_param_by_key(effect, &base_dimension_key);
 	gs_eparam_t *bres_i =
-		gs_effect_get_param_by_name(effect, "base_dimension_i");
+		gs_effect_get_param_by_key(effect, &base_dimension_i_key);
 	size_t passes, i;
 
 	gs_set_render_target(target, NULL);
@@ -303,13 +355,13 @@ static void render_convert_texture(struct obs_core_video *video,
 
 	gs_effect_t *effect = video->conversion_effect;
 	gs_eparam_t *color_vec0 =
-		gs_effect_get_param_by_name(effect, "color_vec0");
+		gs_effect_get_param_by_key(effect, &color_vec_keys[0]);
 	gs_eparam_t *color_vec1 =
-		gs_effect_get_param_by_name(effect, "color_vec1");
+		gs_effect_get_param_by_key(effect, &color_vec_keys[1]);
 	gs_eparam_t *color_vec2 =
-		gs_effect_get_param_by_name(effect, "color_vec2");
-	gs_eparam_t *image = gs_effect_get_param_by_name(effect, "image");
-	gs_eparam_t *width_i = gs_effect_get_param_by_name(effect, "width_i");
+		gs_effect_get_param_by_key(effect, &color_vec_keys[2]);
+	gs_eparam_t *image = gs_effect_get_param_by_key(effect, &image_key);
+	gs_eparam_t *width_i = gs_effect_get_param_by_key(effect, &width_i_key);
 
 	struct vec4 vec0, vec1, vec2;
 	vec4_set(&vec0, video->color_matrix[4], video->color_matrix[5],
@@ -359,20 +411,30 @@ static const char *stage_output_texture_name = "stage_output_texture";
 static inline void stage_output_texture(struct obs_core_video *video,
 					int cur_texture)
 {
+	int idx;
+
 	profile_start(stage_output_texture_name);
 
 	unmap_last_surface(video);
 
+	idx = get_free_stage_surface(video, cur_texture);
+	if (idx < 0) {
+		/* every surface is still held by video-io */
+		video->textures_copied[cur_texture] = false;
+		goto end;
+	}
+
+	video->staged_surfaces[cur_texture] = idx;
+
 	if (!video->gpu_conversion) {
-		gs_stagesurf_t *copy = video->copy_surfaces[cur_texture][0];
+		gs_stagesurf_t *copy = video->copy_surfaces[idx][0];
 		if (copy)
 			gs_stage_texture(copy, video->output_texture);
 
 		video->textures_copied[cur_texture] = true;
 	} else if (video->texture_converted) {
 		for (int i = 0; i < NUM_CHANNELS; i++) {
-			gs_stagesurf_t *copy =
-				video->copy_surfaces[cur_texture][i];
+			gs_stagesurf_t *copy = video->copy_surfaces[idx][i];
 			if (copy)
 				gs_stage_texture(copy,
 						 video->convert_textures[i]);
@@ -381,6 +443,7 @@ static inline void stage_output_texture(struct obs_core_video *video,
 		video->textures_copied[cur_texture] = true;
 	}
 
+end:
 	profile_end(stage_output_texture_name);
 }
 
@@ -518,21 +581,41 @@ static inline void render_video(struct obs_core_video *video, bool raw_active,
 static inline bool download_frame(struct obs_core_video *video,
 				  int prev_texture, struct video_data *frame)
 {
+	int idx = video->staged_surfaces[prev_texture];
+
 	if (!video->textures_copied[prev_texture])
 		return false;
 
+	/* a zero-copy surface may still be mapped by the time this slot comes
+	 * around again, so never download the same one twice */
+	if (video->zero_copy_active)
+		video->textures_copied[prev_texture] = false;
+
 	for (int channel = 0; channel < NUM_CHANNELS; ++channel) {
-		gs_stagesurf_t *surface =
-			video->copy_surfaces[prev_texture][channel];
+		gs_stagesurf_t *surface = video->copy_surfaces[idx][channel];
 		if (surface) {
 			if (!gs_stagesurface_map(surface, &frame->data[channel],
 						 &frame->linesize[channel]))
-				return false;
+				goto fail;
 
-			video->mapped_surfaces[channel] = surface;
+			if (!video->zero_copy_active)
+				video->mapped_surfaces[channel] = surface;
 		}
 	}
+
+	if (video->zero_copy_active)
+		video->stage_surfaces_mapped[idx] = true;
 	return true;
+
+fail:
+	if (video->zero_copy_active) {
+		for (int channel = 0; channel < NUM_CHANNELS; ++channel) {
+			if (frame->data[channel])
+				gs_stagesurface_unmap(
+					video->copy_surfaces[idx][channel]);
+		}
+	}
+	return false;
 }
 
 static const uint8_t *set_gpu_converted_plane(uint32_t width, uint32_t height,
@@ -659,6 +742,9 @@ static void set_gpu_converted_data(struct obs_core_video *video,
 		case VIDEO_FORMAT_I42A:
 		case VIDEO_FORMAT_YUVA:
 		case VIDEO_FORMAT_AYUV:
+		case VIDEO_FORMAT_I010:
+		case VIDEO_FORMAT_P010:
+		case VIDEO_FORMAT_I210:
 			/* unimplemented */
 			;
 		}
@@ -709,6 +795,33 @@ static inline void output_video_data(struct obs_core_video *video,
 	}
 }
 
+static void release_stage_surface(void *param)
+{
+	os_atomic_set_bool((volatile bool *)param, false);
+}
+
+static inline void output_zero_copy_data(struct obs_core_video *video,
+					 struct video_data *input_frame,
+					 int count, int idx)
+{
+	if (video->using_nv12_tex) {
+		const struct video_output_info *info =
+			video_output_get_info(video->video);
+
+		input_frame->data[1] = input_frame->data[0] +
+				       input_frame->linesize[0] * info->height;
+		input_frame->linesize[1] = input_frame->linesize[0];
+	}
+
+	volatile bool *busy = &video->stage_surfaces_busy[idx];
+	os_atomic_set_bool(busy, true);
+
+	if (!video_output_push_external_frame(video->video, input_frame, count,
+					      release_stage_surface,
+					      (void *)busy))
+		os_atomic_set_bool(busy, false);
+}
+
 static inline void video_sleep(struct obs_core_video *video, bool raw_active,
 			       const bool gpu_active, uint64_t *p_time,
 			       uint64_t interval_ns)
@@ -745,6 +858,18 @@ static const char *output_frame_render_video_name = "render_video";
 static const char *output_frame_download_frame_name = "download_frame";
 static const char *output_frame_gs_flush_name = "gs_flush";
 static const char *output_frame_output_video_data_name = "output_video_data";
+static inline void update_draw_stats(struct obs_core_video *video)
+{
+	struct gs_draw_stats stats;
+
+	gs_get_draw_stats(&stats);
+	video->frame_draw_calls = stats.draw_calls -
+				  video->draw_stats.draw_calls;
+	video->frame_batched_sprites = stats.batched_sprites -
+				       video->draw_stats.batched_sprites;
+	video->draw_stats = stats;
+}
+
 static inline void output_frame(bool raw_active, const bool gpu_active)
 {
 	struct obs_core_video *video = &obs->video;
@@ -776,6 +901,8 @@ static inline void output_frame(bool raw_active, const bool gpu_active)
 	gs_flush();
 	profile_end(output_frame_gs_flush_name);
 
+	update_draw_stats(video);
+
 	gs_leave_context();
 	profile_end(output_frame_gs_context_name);
 
@@ -786,7 +913,12 @@ static inline void output_frame(bool raw_active, const bool gpu_active)
 
 		frame.timestamp = vframe_info.timestamp;
 		profile_start(output_frame_output_video_data_name);
-		output_video_data(video, &frame, vframe_info.count);
+		if (video->zero_copy_active)
+			output_zero_copy_data(
+				video, &frame, vframe_info.count,
+				video->staged_surfaces[prev_texture]);
+		else
+			output_video_data(video, &frame, vframe_info.count);
 		profile_end(output_frame_output_video_data_name);
 	}
 
@@ -956,6 +1088,7 @@ bool obs_graphics_thread_loop(struct obs_graphics_context *context)
 
 	gs_enter_context(obs->video.graphics);
 	gs_begin_frame();
+	obs_gpu_timing_frame_begin(&obs->video);
 	gs_leave_context();
 
 	profile_start(tick_sources_name);
@@ -981,6 +1114,12 @@ bool obs_graphics_thread_loop(struct obs_graphics_context *context)
 	render_displays();
 	profile_end(render_displays_name);
 
+	if (obs->video.gpu_timing.recording) {
+		gs_enter_context(obs->video.graphics);
+		obs_gpu_timing_frame_end(&obs->video);
+		gs_leave_context();
+	}
+
 	frame_time_ns = os_gettime_ns() - frame_start;
 
 	profile_end(context->video_thread_name);
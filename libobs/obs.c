@@ -19,6 +19,7 @@
 
 #include "graphics/matrix4.h"
 #include "callback/calldata.h"
+#include "util/crc32.h"
 
 #include "obs.h"
 #include "obs-internal.h"
@@ -203,7 +204,14 @@ static bool obs_init_textures(struct obs_video_info *ovi)
 {
 	struct obs_core_video *video = &obs->video;
 
-	for (size_t i = 0; i < NUM_TEXTURES; i++) {
+	video->num_stage_surfaces = video->zero_copy_active
+					    ? NUM_STAGE_SURFACES
+					    : NUM_TEXTURES;
+
+	for (size_t i = 0; i < NUM_TEXTURES; i++)
+		video->staged_surfaces[i] = (int)i;
+
+	for (size_t i = 0; i < video->num_stage_surfaces; i++) {
 #ifdef _WIN32
 		if (video->using_nv12_tex) {
 			video->copy_surfaces[i][0] =
@@ -258,6 +266,36 @@ gs_effect_t *obs_load_effect(gs_effect_t **effect, const char *file)
 	return *effect;
 }
 
+static struct gs_effect_param_key image_key = GS_EFFECT_PARAM_KEY("image");
+
+static void set_shader_cache_path(void)
+{
+	struct dstr path = {0};
+
+	if (!obs->module_config_path || !*obs->module_config_path)
+		return;
+
+	dstr_copy(&path, obs->module_config_path);
+	if (dstr_end(&path) != '/')
+		dstr_cat_ch(&path, '/');
+	dstr_cat(&path, "shader-cache");
+
+	gs_set_shader_cache_path(path.array);
+	dstr_free(&path);
+}
+
+static void log_shader_cache_stats(void)
+{
+	struct gs_shader_cache_stats stats = {0};
+
+	gs_get_shader_cache_stats(&stats);
+	blog(LOG_INFO,
+	     "Built-in effects loaded in %.1f ms "
+	     "(effect cache: %u hits, %u misses; %u shader compiles skipped)",
+	     (double)stats.effect_load_time_ns / 1000000.0, stats.effect_hits,
+	     stats.effect_misses, stats.compiles_skipped);
+}
+
 static int obs_init_graphics(struct obs_video_info *ovi)
 {
 	struct obs_core_video *video = &obs->video;
@@ -281,6 +319,7 @@ static int obs_init_graphics(struct obs_video_info *ovi)
 	}
 
 	gs_enter_context(video->graphics);
+	set_shader_cache_path();
 
 	char *filename = obs_find_data_file("default.effect");
 	video->default_effect = gs_effect_create_from_file(filename, NULL);
@@ -331,6 +370,8 @@ static int obs_init_graphics(struct obs_video_info *ovi)
 		gs_effect_create_from_file(filename, NULL);
 	bfree(filename);
 
+	log_shader_cache_stats();
+
 	point_sampler.max_anisotropy = 1;
 	video->point_sampler = gs_samplerstate_create(&point_sampler);
 
@@ -382,6 +423,18 @@ static inline void set_video_matrix(struct obs_core_video *video,
 	memcpy(video->color_matrix, &mat, sizeof(float) * 16);
 }
 
+/* the mapped staging surfaces can only be handed to video-io directly when
+ * their layout is what the output format expects */
+static inline bool zero_copy_supported(const struct obs_core_video *video,
+				       enum video_format format)
+{
+	if (video->gpu_conversion)
+		return true;
+
+	return format == VIDEO_FORMAT_RGBA || format == VIDEO_FORMAT_BGRA ||
+	       format == VIDEO_FORMAT_BGRX;
+}
+
 static int obs_init_video(struct obs_video_info *ovi)
 {
 	struct obs_core_video *video = &obs->video;
@@ -415,6 +468,12 @@ static int obs_init_video(struct obs_video_info *ovi)
 
 	if (ovi->gpu_conversion && !obs_init_gpu_conversion(ovi))
 		return OBS_VIDEO_FAIL;
+
+	video->zero_copy_active = video->zero_copy &&
+				  zero_copy_supported(video, vi.format);
+	if (video->zero_copy_active)
+		blog(LOG_INFO, "Zero-copy video readback enabled");
+
 	if (!obs_init_textures(ovi))
 		return OBS_VIDEO_FAIL;
 
@@ -479,7 +538,21 @@ static void obs_free_video(void)
 			}
 		}
 
-		for (size_t i = 0; i < NUM_TEXTURES; i++) {
+		for (size_t i = 0; i < NUM_STAGE_SURFACES; i++) {
+			if (!video->stage_surfaces_mapped[i])
+				continue;
+
+			for (size_t c = 0; c < NUM_CHANNELS; c++) {
+				if (video->copy_surfaces[i][c])
+					gs_stagesurface_unmap(
+						video->copy_surfaces[i][c]);
+			}
+
+			video->stage_surfaces_mapped[i] = false;
+			video->stage_surfaces_busy[i] = false;
+		}
+
+		for (size_t i = 0; i < NUM_STAGE_SURFACES; i++) {
 			for (size_t c = 0; c < NUM_CHANNELS; c++) {
 				if (video->copy_surfaces[i][c]) {
 					gs_stagesurface_destroy(
@@ -498,7 +571,7 @@ static void obs_free_video(void)
 			}
 		}
 
-		for (size_t i = 0; i < NUM_TEXTURES; i++) {
+		for (size_t i = 0; i < NUM_STAGE_SURFACES; i++) {
 			for (size_t c = 0; c < NUM_CHANNELS; c++) {
 				if (video->copy_surfaces[i][c]) {
 					gs_stagesurface_destroy(
@@ -532,6 +605,8 @@ static void obs_free_video(void)
 
 		video->gpu_encoder_active = 0;
 		video->cur_texture = 0;
+		video->num_stage_surfaces = 0;
+		video->zero_copy_active = false;
 	}
 }
 
@@ -542,6 +617,8 @@ static void obs_free_graphics(void)
 	if (video->graphics) {
 		gs_enter_context(video->graphics);
 
+		obs_gpu_timing_free(video);
+
 		gs_texture_destroy(video->transparent_texture);
 
 		gs_samplerstate_destroy(video->point_sampler);
@@ -615,6 +692,31 @@ static void obs_free_audio(void)
 	memset(audio, 0, sizeof(struct obs_core_audio));
 }
 
+#define CONTEXT_INDEX_MIN_BUCKETS 64
+
+static bool obs_context_index_init(struct obs_context_index *index)
+{
+	memset(index, 0, sizeof(*index));
+
+	if (pthread_rwlock_init(&index->rwlock, NULL) != 0)
+		return false;
+
+	index->num_buckets = CONTEXT_INDEX_MIN_BUCKETS;
+	index->buckets =
+		bzalloc(sizeof(struct obs_context_data *) * index->num_buckets);
+	return true;
+}
+
+static void obs_context_index_free(struct obs_context_index *index)
+{
+	if (!index->buckets)
+		return;
+
+	pthread_rwlock_destroy(&index->rwlock);
+	bfree(index->buckets);
+	memset(index, 0, sizeof(*index));
+}
+
 static bool obs_init_data(void)
 {
 	struct obs_core_data *data = &obs->data;
@@ -643,6 +745,14 @@ static bool obs_init_data(void)
 		goto fail;
 	if (pthread_mutex_init(&obs->data.draw_callbacks_mutex, &attr) != 0)
 		goto fail;
+	if (!obs_context_index_init(&data->sources_index))
+		goto fail;
+	if (!obs_context_index_init(&data->outputs_index))
+		goto fail;
+	if (!obs_context_index_init(&data->encoders_index))
+		goto fail;
+	if (!obs_context_index_init(&data->services_index))
+		goto fail;
 	if (!obs_view_init(&data->main_view))
 		goto fail;
 
@@ -701,6 +811,10 @@ static void obs_free_data(void)
 	pthread_mutex_destroy(&data->encoders_mutex);
 	pthread_mutex_destroy(&data->services_mutex);
 	pthread_mutex_destroy(&data->draw_callbacks_mutex);
+	obs_context_index_free(&data->sources_index);
+	obs_context_index_free(&data->outputs_index);
+	obs_context_index_free(&data->encoders_index);
+	obs_context_index_free(&data->services_index);
 	da_free(data->draw_callbacks);
 	da_free(data->tick_callbacks);
 	obs_data_release(data->private_data);
@@ -845,11 +959,29 @@ const struct obs_source_info audio_line_info = {
 
 extern void log_system_info(void);
 
+static bool obs_init_module_data(void)
+{
+	pthread_mutexattr_t attr;
+	bool success;
+
+	if (pthread_mutexattr_init(&attr) != 0)
+		return false;
+	if (pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE) != 0) {
+		pthread_mutexattr_destroy(&attr);
+		return false;
+	}
+
+	success = pthread_mutex_init(&obs->deferred_modules_mutex, &attr) == 0;
+	pthread_mutexattr_destroy(&attr);
+	return success;
+}
+
 static bool obs_init(const char *locale, const char *module_config_path,
 		     profiler_name_store_t *store)
 {
 	obs = bzalloc(sizeof(struct obs_core));
 
+	pthread_mutex_init_value(&obs->deferred_modules_mutex);
 	pthread_mutex_init_value(&obs->audio.monitoring_mutex);
 	pthread_mutex_init_value(&obs->video.gpu_encoder_mutex);
 	pthread_mutex_init_value(&obs->video.task_mutex);
@@ -863,12 +995,20 @@ static bool obs_init(const char *locale, const char *module_config_path,
 
 	log_system_info();
 
+	if (!obs_init_module_data())
+		return false;
 	if (!obs_init_data())
 		return false;
 	if (!obs_init_handlers())
 		return false;
 	if (!obs_init_hotkeys())
 		return false;
+	if (!obs_init_image_cache())
+		return false;
+
+	obs->task_scheduler = os_task_scheduler_create(0);
+	if (!obs->task_scheduler)
+		return false;
 
 	if (module_config_path)
 		obs->module_config_path = bstrdup(module_config_path);
@@ -990,10 +1130,32 @@ struct obs_cmdline_args obs_get_cmdline_args(void)
 	return cmdline_args;
 }
 
+static void obs_free_task_scheduler(void)
+{
+	struct os_task_scheduler_stats stats;
+
+	if (!obs->task_scheduler)
+		return;
+
+	os_task_scheduler_get_stats(obs->task_scheduler, &stats);
+	os_task_scheduler_destroy(obs->task_scheduler);
+	obs->task_scheduler = NULL;
+
+	blog(LOG_INFO,
+	     "Task scheduler: %" PRIu64 " task(s) executed, %" PRIu64
+	     " stolen, average queue latency %" PRIu64
+	     " us, max queue latency %" PRIu64 " us",
+	     stats.tasks_executed, stats.tasks_stolen,
+	     stats.avg_queue_latency_ns / 1000,
+	     stats.max_queue_latency_ns / 1000);
+}
+
 void obs_shutdown(void)
 {
 	struct obs_module *module;
 
+	obs_save_module_manifest();
+
 	for (size_t i = 0; i < obs->source_types.num; i++) {
 		struct obs_source_info *item = &obs->source_types.array[i];
 		if (item->type_data && item->free_type_data)
@@ -1036,11 +1198,16 @@ void obs_shutdown(void)
 	}
 	obs->first_module = NULL;
 
+	obs_free_deferred_modules();
+	pthread_mutex_destroy(&obs->deferred_modules_mutex);
+
 	obs_free_audio();
 	obs_free_data();
+	obs_free_image_cache();
 	obs_free_video();
 	obs_free_hotkeys();
 	obs_free_graphics();
+	obs_free_task_scheduler();
 	proc_handler_destroy(obs->procs);
 	signal_handler_destroy(obs->signals);
 	obs->procs = NULL;
@@ -1213,6 +1380,12 @@ bool obs_reset_audio(const struct obs_audio_info *oai)
 	return obs_init_audio(&ai);
 }
 
+void obs_set_video_zero_copy(bool enable)
+{
+	if (obs)
+		obs->video.zero_copy = enable;
+}
+
 bool obs_get_video_info(struct obs_video_info *ovi)
 {
 	struct obs_core_video *video = &obs->video;
@@ -1241,6 +1414,8 @@ bool obs_get_audio_info(struct obs_audio_info *oai)
 
 bool obs_enum_source_types(size_t idx, const char **id)
 {
+	if (idx == 0)
+		obs_load_deferred_modules();
 	if (idx >= obs->source_types.num)
 		return false;
 	*id = obs->source_types.array[idx].id;
@@ -1249,6 +1424,8 @@ bool obs_enum_source_types(size_t idx, const char **id)
 
 bool obs_enum_input_types(size_t idx, const char **id)
 {
+	if (idx == 0)
+		obs_load_deferred_modules();
 	if (idx >= obs->input_types.num)
 		return false;
 	*id = obs->input_types.array[idx].id;
@@ -1258,6 +1435,8 @@ bool obs_enum_input_types(size_t idx, const char **id)
 bool obs_enum_input_types2(size_t idx, const char **id,
 			   const char **unversioned_id)
 {
+	if (idx == 0)
+		obs_load_deferred_modules();
 	if (idx >= obs->input_types.num)
 		return false;
 	if (id)
@@ -1275,6 +1454,9 @@ const char *obs_get_latest_input_type_id(const char *unversioned_id)
 	if (!unversioned_id)
 		return NULL;
 
+	/* deferred modules are only indexed by versioned id */
+	obs_load_deferred_modules();
+
 	for (size_t i = 0; i < obs->source_types.num; i++) {
 		struct obs_source_info *info = &obs->source_types.array[i];
 		if (strcmp(info->unversioned_id, unversioned_id) == 0 &&
@@ -1293,6 +1475,8 @@ const char *obs_get_latest_input_type_id(const char *unversioned_id)
 
 bool obs_enum_filter_types(size_t idx, const char **id)
 {
+	if (idx == 0)
+		obs_load_deferred_modules();
 	if (idx >= obs->filter_types.num)
 		return false;
 	*id = obs->filter_types.array[idx].id;
@@ -1301,6 +1485,8 @@ bool obs_enum_filter_types(size_t idx, const char **id)
 
 bool obs_enum_transition_types(size_t idx, const char **id)
 {
+	if (idx == 0)
+		obs_load_deferred_modules();
 	if (idx >= obs->transition_types.num)
 		return false;
 	*id = obs->transition_types.array[idx].id;
@@ -1309,6 +1495,8 @@ bool obs_enum_transition_types(size_t idx, const char **id)
 
 bool obs_enum_output_types(size_t idx, const char **id)
 {
+	if (idx == 0)
+		obs_load_deferred_modules();
 	if (idx >= obs->output_types.num)
 		return false;
 	*id = obs->output_types.array[idx].id;
@@ -1317,6 +1505,8 @@ bool obs_enum_output_types(size_t idx, const char **id)
 
 bool obs_enum_encoder_types(size_t idx, const char **id)
 {
+	if (idx == 0)
+		obs_load_deferred_modules();
 	if (idx >= obs->encoder_types.num)
 		return false;
 	*id = obs->encoder_types.array[idx].id;
@@ -1325,6 +1515,8 @@ bool obs_enum_encoder_types(size_t idx, const char **id)
 
 bool obs_enum_service_types(size_t idx, const char **id)
 {
+	if (idx == 0)
+		obs_load_deferred_modules();
 	if (idx >= obs->service_types.num)
 		return false;
 	*id = obs->service_types.array[idx].id;
@@ -1551,25 +1743,31 @@ void obs_enum_services(bool (*enum_proc)(void *, obs_service_t *), void *param)
 		 param);
 }
 
-static inline void *get_context_by_name(void *vfirst, const char *name,
-					pthread_mutex_t *mutex,
+static inline void *get_context_by_name(struct obs_context_index *index,
+					const char *name,
 					void *(*addref)(void *))
 {
-	struct obs_context_data **first = vfirst;
 	struct obs_context_data *context;
+	uint32_t hash;
 
-	pthread_mutex_lock(mutex);
+	if (!name)
+		return NULL;
+
+	hash = calc_crc32(0, name, strlen(name));
+
+	pthread_rwlock_rdlock(&index->rwlock);
 
-	context = *first;
+	context = index->buckets[hash & (index->num_buckets - 1)];
 	while (context) {
-		if (!context->private && strcmp(context->name, name) == 0) {
+		if (context->name_hash == hash &&
+		    strcmp(context->name, name) == 0) {
 			context = addref(context);
 			break;
 		}
-		context = context->next;
+		context = context->hash_next;
 	}
 
-	pthread_mutex_unlock(mutex);
+	pthread_rwlock_unlock(&index->rwlock);
 	return context;
 }
 
@@ -1600,29 +1798,25 @@ static inline void *obs_id_(void *data)
 
 obs_source_t *obs_get_source_by_name(const char *name)
 {
-	return get_context_by_name(&obs->data.first_source, name,
-				   &obs->data.sources_mutex,
+	return get_context_by_name(&obs->data.sources_index, name,
 				   obs_source_addref_safe_);
 }
 
 obs_output_t *obs_get_output_by_name(const char *name)
 {
-	return get_context_by_name(&obs->data.first_output, name,
-				   &obs->data.outputs_mutex,
+	return get_context_by_name(&obs->data.outputs_index, name,
 				   obs_output_addref_safe_);
 }
 
 obs_encoder_t *obs_get_encoder_by_name(const char *name)
 {
-	return get_context_by_name(&obs->data.first_encoder, name,
-				   &obs->data.encoders_mutex,
+	return get_context_by_name(&obs->data.encoders_index, name,
 				   obs_encoder_addref_safe_);
 }
 
 obs_service_t *obs_get_service_by_name(const char *name)
 {
-	return get_context_by_name(&obs->data.first_service, name,
-				   &obs->data.services_mutex,
+	return get_context_by_name(&obs->data.services_index, name,
 				   obs_service_addref_safe_);
 }
 
@@ -1692,7 +1886,7 @@ static void obs_render_main_texture_internal(enum gs_blend_type src_c,
 
 	tex = video->render_texture;
 	effect = obs_get_base_effect(OBS_EFFECT_DEFAULT);
-	param = gs_effect_get_param_by_name(effect, "image");
+	param = gs_effect_get_param_by_key(effect, &image_key);
 	gs_effect_set_texture(param, tex);
 
 	gs_blend_state_push();
@@ -2130,16 +2324,100 @@ void obs_context_data_free(struct obs_context_data *context)
 	memset(context, 0, sizeof(*context));
 }
 
+/* --------------------------------------------------------------------------
+ * name index helpers, index->rwlock must be write-locked by the caller.
+ * buckets are kept in the order of the context list, most recently added
+ * first, so that the most recently added context wins on duplicate names,
+ * same as the old list walk did.  a rename keeps that position. */
+
+static void context_index_grow(struct obs_context_index *index)
+{
+	size_t new_num_buckets = index->num_buckets * 2;
+	struct obs_context_data **new_buckets;
+
+	new_buckets = bzalloc(sizeof(struct obs_context_data *) *
+			      new_num_buckets);
+
+	for (size_t i = 0; i < index->num_buckets; i++) {
+		struct obs_context_data *context = index->buckets[i];
+
+		while (context) {
+			struct obs_context_data *next = context->hash_next;
+			struct obs_context_data **tail;
+
+			/* append to preserve the relative bucket order */
+			tail = &new_buckets[context->name_hash &
+					    (new_num_buckets - 1)];
+			while (*tail)
+				tail = &(*tail)->hash_next;
+
+			context->hash_next = NULL;
+			*tail = context;
+			context = next;
+		}
+	}
+
+	bfree(index->buckets);
+	index->buckets = new_buckets;
+	index->num_buckets = new_num_buckets;
+}
+
+static void context_index_link(struct obs_context_index *index,
+			       struct obs_context_data *context)
+{
+	struct obs_context_data **bucket;
+
+	if (context->private || !context->name)
+		return;
+
+	if (index->num >= index->num_buckets)
+		context_index_grow(index);
+
+	context->name_hash =
+		calc_crc32(0, context->name, strlen(context->name));
+
+	bucket = &index->buckets[context->name_hash & (index->num_buckets - 1)];
+	while (*bucket && (*bucket)->index_order > context->index_order)
+		bucket = &(*bucket)->hash_next;
+
+	context->hash_next = *bucket;
+	*bucket = context;
+	index->num++;
+}
+
+static void context_index_unlink(struct obs_context_index *index,
+				 struct obs_context_data *context)
+{
+	struct obs_context_data **cur;
+
+	if (context->private || !context->name)
+		return;
+
+	cur = &index->buckets[context->name_hash & (index->num_buckets - 1)];
+	while (*cur) {
+		if (*cur == context) {
+			*cur = context->hash_next;
+			context->hash_next = NULL;
+			index->num--;
+			break;
+		}
+		cur = &(*cur)->hash_next;
+	}
+}
+
 void obs_context_data_insert(struct obs_context_data *context,
-			     pthread_mutex_t *mutex, void *pfirst)
+			     pthread_mutex_t *mutex, void *pfirst,
+			     struct obs_context_index *index)
 {
 	struct obs_context_data **first = pfirst;
 
 	assert(context);
 	assert(mutex);
 	assert(first);
+	assert(index);
 
 	context->mutex = mutex;
+	context->index = index;
 
 	pthread_mutex_lock(mutex);
 	context->prev_next = first;
@@ -2148,11 +2426,20 @@ void obs_context_data_insert(struct obs_context_data *context,
 	if (context->next)
 		context->next->prev_next = &context->next;
 	pthread_mutex_unlock(mutex);
+
+	pthread_rwlock_wrlock(&index->rwlock);
+	context->index_order = index->next_order++;
+	context_index_link(index, context);
+	pthread_rwlock_unlock(&index->rwlock);
 }
 
 void obs_context_data_remove(struct obs_context_data *context)
 {
 	if (context && context->mutex) {
+		pthread_rwlock_wrlock(&context->index->rwlock);
+		context_index_unlink(context->index, context);
+		pthread_rwlock_unlock(&context->index->rwlock);
+
 		pthread_mutex_lock(context->mutex);
 		if (context->prev_next)
 			*context->prev_next = context->next;
@@ -2161,18 +2448,31 @@ void obs_context_data_remove(struct obs_context_data *context)
 		pthread_mutex_unlock(context->mutex);
 
 		context->mutex = NULL;
+		context->index = NULL;
 	}
 }
 
 void obs_context_data_setname(struct obs_context_data *context,
 			      const char *name)
 {
+	struct obs_context_index *index = context->index;
+
 	pthread_mutex_lock(&context->rename_cache_mutex);
 
+	if (index) {
+		pthread_rwlock_wrlock(&index->rwlock);
+		context_index_unlink(index, context);
+	}
+
 	if (context->name)
 		da_push_back(context->rename_cache, &context->name);
 	context->name = dup_name(name, context->private);
 
+	if (index) {
+		context_index_link(index, context);
+		pthread_rwlock_unlock(&index->rwlock);
+	}
+
 	pthread_mutex_unlock(&context->rename_cache_mutex);
 }
 
@@ -2346,6 +2646,36 @@ uint32_t obs_get_lagged_frames(void)
 	return obs->video.lagged_frames;
 }
 
+uint64_t obs_get_render_cache_hits(void)
+{
+	return obs->video.render_cache_hits;
+}
+
+uint64_t obs_get_render_cache_misses(void)
+{
+	return obs->video.render_cache_misses;
+}
+
+uint64_t obs_get_total_scene_items(void)
+{
+	return obs->video.total_scene_items;
+}
+
+uint64_t obs_get_culled_scene_items(void)
+{
+	return obs->video.culled_scene_items;
+}
+
+uint64_t obs_get_frame_draw_calls(void)
+{
+	return obs->video.frame_draw_calls;
+}
+
+uint64_t obs_get_frame_batched_sprites(void)
+{
+	return obs->video.frame_batched_sprites;
+}
+
 void start_raw_video(video_t *v, const struct video_scale_info *conversion,
 		     void (*callback)(void *param, struct video_data *frame),
 		     void *param)
@@ -2541,3 +2871,8 @@ void obs_set_ui_task_handler(obs_task_handler_t handler)
 {
 	obs->ui_task_handler = handler;
 }
+
+os_task_scheduler_t *obs_get_task_scheduler(void)
+{
+	return obs ? obs->task_scheduler : NULL;
+}
@@ -37,6 +37,7 @@
 #include "obs-interaction.h"
 
 struct matrix4;
+struct gs_image_file3;
 
 /* opaque types */
 struct obs_display;
@@ -254,6 +255,76 @@ struct obs_source_frame {
 	bool prev_frame;
 };
 
+/** Texture upload statistics of an asynchronous video source */
+struct obs_source_upload_stats {
+	/* frames copied into upload buffers on the thread that output them */
+	uint64_t staged_frames;
+	uint64_t stage_time_ns;
+
+	/* frames uploaded on the graphics thread, and how many of them only
+	 * needed a copy from an upload buffer */
+	uint64_t uploaded_frames;
+	uint64_t streamed_frames;
+	uint64_t upload_time_ns;
+	uint64_t last_upload_time_ns;
+};
+
+/**
+ * Costs of a source, accumulated since the source was created.  Render times
+ * do not include the time spent rendering other sources (filters, scene
+ * items) from within the render callback.
+ */
+struct obs_source_perf_stats {
+	uint64_t ticks;
+	uint64_t tick_time_ns;
+
+	uint64_t renders;
+	uint64_t render_time_ns;
+
+	/* only measured while GPU timing is enabled */
+	uint64_t gpu_renders;
+	uint64_t gpu_time_ns;
+
+	uint64_t uploads;
+	uint64_t upload_bytes;
+
+	uint64_t audio_renders;
+	uint64_t audio_render_time_ns;
+};
+
+/**
+ * Decoding statistics of a media source.  Counters are accumulated since the
+ * media was opened.
+ */
+struct obs_source_media_stats {
+	/* decoded frames waiting to be presented, and how many video frames
+	 * the decoder is allowed to run ahead */
+	uint32_t queued_video_frames;
+	uint32_t queued_audio_frames;
+	uint32_t max_video_frames;
+
+	/* demuxed packets waiting to be decoded */
+	uint32_t queued_packets;
+
+	uint64_t decoded_video_frames;
+	uint64_t video_decode_time_ns;
+	uint64_t max_video_decode_time_ns;
+	uint64_t video_convert_time_ns;
+
+	/* number of times presentation had to wait for the decoder */
+	uint64_t decoder_waits;
+
+	/* memory used by decoded frames kept for replaying, the frames
+	 * served from it, and how many times playback restarted from it */
+	uint64_t cache_budget;
+	uint64_t cache_size;
+	uint64_t cache_hits;
+	uint64_t cache_replays;
+
+	/* keyframes found by the keyframe index, 0 until it is ready */
+	uint32_t indexed_keyframes;
+};
+
 struct obs_source_frame2 {
 	uint8_t *data[MAX_AV_PLANES];
 	uint32_t linesize[MAX_AV_PLANES];
@@ -387,6 +458,13 @@ EXPORT profiler_name_store_t *obs_get_profiler_name_store(void);
  */
 EXPORT int obs_reset_video(struct obs_video_info *ovi);
 
+/**
+ * Hands the mapped GPU staging surfaces straight to raw video outputs instead
+ * of copying each frame into the video output cache.  Uses a deeper ring of
+ * staging surfaces.  Takes effect on the next obs_reset_video call.
+ */
+EXPORT void obs_set_video_zero_copy(bool enable);
+
 /**
  * Sets base audio output format/channels/samples/etc
  *
@@ -479,6 +557,24 @@ EXPORT void obs_add_module_path(const char *bin, const char *data);
 /** Automatically loads all modules from module paths (convenience function) */
 EXPORT void obs_load_all_modules(void);
 
+/**
+ * Enables lazy module loading for obs_load_all_modules.  Disabled by default.
+ *
+ * A module is deferred if, according to the module manifest in the module
+ * config path, on the previous run it loaded successfully, registered at
+ * least one source, output, encoder or service, and didn't export
+ * obs_module_post_load, and its binary has the same size and modification
+ * time.  A module that does more than register types in obs_module_load has
+ * to export obs_module_post_load, otherwise that work is delayed too.
+ *
+ * A deferred module is opened the first time one of its type ids is looked
+ * up, or when it is requested by name or enumerated.  Modules are always
+ * opened on the UI thread through the UI task handler, and lookups from
+ * other threads block until that is done, so nothing is deferred if there
+ * is no UI task handler when obs_load_all_modules is called.
+ */
+EXPORT void obs_set_lazy_module_loading(bool enable);
+
 /** Notifies modules that all modules have been loaded.  This function should
  * be called after all modules have been loaded. */
 EXPORT void obs_post_load_modules(void);
@@ -772,6 +868,24 @@ EXPORT uint64_t obs_get_frame_interval_ns(void);
 EXPORT uint32_t obs_get_total_frames(void);
 EXPORT uint32_t obs_get_lagged_frames(void);
 
+/** Scene item textures that were reused/rendered because of a content change */
+EXPORT uint64_t obs_get_render_cache_hits(void);
+EXPORT uint64_t obs_get_render_cache_misses(void);
+
+/** Scene items that were drawn/skipped because they could not be seen */
+EXPORT uint64_t obs_get_total_scene_items(void);
+EXPORT uint64_t obs_get_culled_scene_items(void);
+
+/** Draw calls/batched sprites of the last rendered frame */
+EXPORT uint64_t obs_get_frame_draw_calls(void);
+EXPORT uint64_t obs_get_frame_batched_sprites(void);
+
+/**
+ * Enables/disables measuring the GPU time of source renders with timer
+ * queries.  Calls are counted, every enable must be matched by a disable.
+ */
+EXPORT void obs_enable_source_gpu_timing(bool enable);
+
 EXPORT bool obs_nv12_tex_active(void);
 
 EXPORT void obs_apply_private_data(obs_data_t *settings);
@@ -791,6 +905,79 @@ EXPORT void obs_queue_task(enum obs_task_type type, obs_task_t task,
 typedef void (*obs_task_handler_t)(obs_task_t task, void *param, bool wait);
 EXPORT void obs_set_ui_task_handler(obs_task_handler_t handler);
 
+/**
+ * Returns the shared work-stealing task scheduler (see util/threading.h).
+ * CPU work that doesn't need a dedicated thread (conversion, filtering,
+ * scaling, etc) can be queued on it or split with parallel_for.
+ */
+EXPORT struct os_task_scheduler *obs_get_task_scheduler(void);
+
+/* ------------------------------------------------------------------------- */
+/* Image cache */
+
+/**
+ * Shared decoded images.
+ *
+ *   Images are keyed by their path, the modification time of the file and
+ * the alpha mode, so everything loading the same file shares one decoded
+ * copy and one texture.  Unreferenced images stay cached until the cache
+ * exceeds its memory budget, least recently used first.
+ *
+ *   Animated images are not shared: obs_cached_image_animated returns true
+ * for them once decoded.  The first caller of obs_cached_image_take_animated
+ * gets the decoded animation.  Acquiring the file after that starts a new
+ * decode, so everyone else releases the image and acquires it again.
+ */
+typedef struct obs_cached_image obs_cached_image_t;
+
+struct obs_image_cache_stats {
+	uint64_t hits;
+	uint64_t misses;
+	uint64_t evictions;
+	uint64_t bytes_resident;
+	uint64_t budget;
+	uint32_t images;
+};
+
+/**
+ * Gets a reference to a cached image.  On a miss, the image is decoded on
+ * the calling thread if wait is true, otherwise it is decoded on the task
+ * scheduler and obs_cached_image_pending returns true until it is done.
+ */
+EXPORT obs_cached_image_t *
+obs_image_cache_acquire(const char *path, enum gs_image_alpha_mode alpha_mode,
+			bool wait);
+EXPORT void obs_cached_image_release(obs_cached_image_t *image);
+
+EXPORT bool obs_cached_image_pending(const obs_cached_image_t *image);
+EXPORT bool obs_cached_image_loaded(const obs_cached_image_t *image);
+EXPORT bool obs_cached_image_animated(const obs_cached_image_t *image);
+
+/**
+ * Moves the decoded animation of an animated image to if3, which the caller
+ * then owns.  Returns false if the image is not animated or the animation
+ * has already been taken.
+ */
+EXPORT bool obs_cached_image_take_animated(obs_cached_image_t *image,
+					   struct gs_image_file3 *if3);
+EXPORT uint32_t obs_cached_image_get_width(const obs_cached_image_t *image);
+EXPORT uint32_t obs_cached_image_get_height(const obs_cached_image_t *image);
+EXPORT uint64_t
+obs_cached_image_get_memory_usage(const obs_cached_image_t *image);
+
+/**
+ * Gets the texture of a cached image, creating it on first use.  Small
+ * images live in the shared texture atlas, in which case the atlas region
+ * should be drawn with gs_draw_atlas_region.  Requires the graphics context.
+ */
+EXPORT gs_texture_t *obs_cached_image_get_texture(obs_cached_image_t *image);
+EXPORT gs_atlas_region_t *
+obs_cached_image_get_atlas_region(obs_cached_image_t *image);
+
+/** Sets the memory budget of the image cache in bytes */
+EXPORT void obs_image_cache_set_budget(uint64_t bytes);
+EXPORT void obs_image_cache_get_stats(struct obs_image_cache_stats *stats);
+
 /* ------------------------------------------------------------------------- */
 /* View context */
 
@@ -950,6 +1137,20 @@ EXPORT obs_properties_t *obs_source_properties(const obs_source_t *source);
 
 /** Updates settings for this source */
 EXPORT void obs_source_update(obs_source_t *source, obs_data_t *settings);
+
+/**
+ * Marks the video of the source as changed.  Sources with the
+ * OBS_SOURCE_STATIC_VIDEO flag must call this whenever their video changes
+ * outside of an update.
+ */
+EXPORT void obs_source_invalidate_video(obs_source_t *source);
+
+/**
+ * Hints that the video of the source is fully opaque and covers its whole
+ * area, which allows scenes to skip items that are hidden behind it
+ */
+EXPORT void obs_source_set_video_opaque(obs_source_t *source, bool opaque);
+EXPORT bool obs_source_video_opaque(const obs_source_t *source);
 EXPORT void obs_source_reset_settings(obs_source_t *source,
 				      obs_data_t *settings);
 
@@ -1269,8 +1470,27 @@ EXPORT void obs_source_output_video(obs_source_t *source,
 EXPORT void obs_source_output_video2(obs_source_t *source,
 				     const struct obs_source_frame2 *frame);
 
+/**
+ * Outputs asynchronous video data without copying it.  The data has to stay
+ * valid until release is called, which may happen on any thread, including
+ * from within this function.  release must not call back into the source.
+ */
+EXPORT void
+obs_source_output_video_external(obs_source_t *source,
+				 const struct obs_source_frame *frame,
+				 void (*release)(void *param), void *param);
+
 EXPORT void obs_source_set_async_rotation(obs_source_t *source, long rotation);
 
+/** Gets the texture upload statistics of an asynchronous video source */
+EXPORT void
+obs_source_get_upload_stats(const obs_source_t *source,
+			    struct obs_source_upload_stats *stats);
+
+/** Gets the tick, render, upload and audio costs of a source */
+EXPORT void obs_source_get_perf_stats(const obs_source_t *source,
+				      struct obs_source_perf_stats *stats);
+
 EXPORT void obs_source_output_cea708(obs_source_t *source,
 				     const struct obs_source_cea_708 *captions);
 
@@ -1438,6 +1658,8 @@ EXPORT int64_t obs_source_media_get_duration(obs_source_t *source);
 EXPORT int64_t obs_source_media_get_time(obs_source_t *source);
 EXPORT void obs_source_media_set_time(obs_source_t *source, int64_t ms);
 EXPORT enum obs_media_state obs_source_media_get_state(obs_source_t *source);
+EXPORT bool obs_source_media_get_stats(obs_source_t *source,
+				       struct obs_source_media_stats *stats);
 EXPORT void obs_source_media_started(obs_source_t *source);
 EXPORT void obs_source_media_ended(obs_source_t *source);
 
@@ -2159,6 +2381,14 @@ EXPORT enum obs_encoder_type obs_encoder_get_type(const obs_encoder_t *encoder);
 EXPORT void obs_encoder_set_scaled_size(obs_encoder_t *encoder, uint32_t width,
 					uint32_t height);
 
+/**
+ * Sets the scaler used when frames for a video encoder are scaled or
+ * converted on the CPU, see enum video_scaler_impl.  If the encoder is
+ * active, this function will trigger a warning, and do nothing.
+ */
+EXPORT void obs_encoder_set_scaler(obs_encoder_t *encoder,
+				   enum video_scaler_impl scaler);
+
 /** For video encoders, returns true if pre-encode scaling is enabled */
 EXPORT bool obs_encoder_scaling_enabled(const obs_encoder_t *encoder);
 
@@ -17,6 +17,7 @@
 #include <inttypes.h>
 #include <stdio.h>
 #include <wchar.h>
+#include <ctype.h>
 #include "config-file.h"
 #include "threading.h"
 #include "platform.h"
@@ -26,6 +27,112 @@
 #include "lexer.h"
 #include "dstr.h"
 
+/* ------------------------------------------------------------------------- */
+/* open-addressed name index over a darray of sections or items.  both struct
+ * config_section and struct config_item start with their name, and names are
+ * compared case-insensitively, so the hash is case-insensitive as well */
+
+#define CONFIG_INDEX_MIN_SIZE 16
+
+struct config_index_slot {
+	uint32_t hash;
+	size_t idx; /* darray index + 1, 0 if the slot is empty */
+};
+
+struct config_index {
+	struct config_index_slot *slots;
+	size_t capacity;
+	size_t num;
+};
+
+static inline uint32_t config_hash(const char *str)
+{
+	uint32_t hash = 2166136261U;
+
+	while (*str) {
+		hash ^= (uint8_t)toupper((unsigned char)*(str++));
+		hash *= 16777619U;
+	}
+
+	return hash;
+}
+
+static inline void config_index_free(struct config_index *index)
+{
+	bfree(index->slots);
+	memset(index, 0, sizeof(*index));
+}
+
+static inline void config_index_insert_slot(struct config_index *index,
+					    uint32_t hash, size_t idx)
+{
+	size_t mask = index->capacity - 1;
+	size_t pos = hash & mask;
+
+	while (index->slots[pos].idx)
+		pos = (pos + 1) & mask;
+
+	index->slots[pos].hash = hash;
+	index->slots[pos].idx = idx + 1;
+	index->num++;
+}
+
+static void config_index_add(struct config_index *index, uint32_t hash,
+			     size_t idx)
+{
+	if ((index->num + 1) * 2 > index->capacity) {
+		struct config_index_slot *old_slots = index->slots;
+		size_t old_capacity = index->capacity;
+
+		index->capacity = old_capacity ? old_capacity * 2
+					       : CONFIG_INDEX_MIN_SIZE;
+		index->slots = bzalloc(sizeof(struct config_index_slot) *
+				       index->capacity);
+		index->num = 0;
+
+		for (size_t i = 0; i < old_capacity; i++) {
+			if (old_slots[i].idx)
+				config_index_insert_slot(
+					index, old_slots[i].hash,
+					old_slots[i].idx - 1);
+		}
+
+		bfree(old_slots);
+	}
+
+	config_index_insert_slot(index, hash, idx);
+}
+
+static size_t config_index_find(const struct config_index *index,
+				const struct darray *array, size_t element_size,
+				uint32_t hash, const char *name)
+{
+	size_t mask = index->capacity - 1;
+	size_t pos;
+
+	if (!index->capacity)
+		return DARRAY_INVALID;
+
+	pos = hash & mask;
+
+	while (index->slots[pos].idx) {
+		const struct config_index_slot *slot = &index->slots[pos];
+
+		if (slot->hash == hash) {
+			char **cur_name = darray_item(element_size, array,
+						      slot->idx - 1);
+			if (astrcmpi(*cur_name, name) == 0)
+				return slot->idx - 1;
+		}
+
+		pos = (pos + 1) & mask;
+	}
+
+	return DARRAY_INVALID;
+}
+
+/* ------------------------------------------------------------------------- */
+
 struct config_item {
 	char *name;
 	char *value;
@@ -40,6 +147,7 @@ static inline void config_item_free(struct config_item *item)
 struct config_section {
 	char *name;
 	struct darray items; /* struct config_item */
+	struct config_index index;
 };
 
 static inline void config_section_free(struct config_section *section)
@@ -51,16 +159,95 @@ static inline void config_section_free(struct config_section *section)
 		config_item_free(items + i);
 
 	darray_free(&section->items);
+	config_index_free(&section->index);
 	bfree(section->name);
 }
 
+static inline size_t config_section_find_item(struct config_section *section,
+					      const char *name)
+{
+	return config_index_find(&section->index, &section->items,
+				 sizeof(struct config_item), config_hash(name),
+				 name);
+}
+
+/* the first item of a given name wins, later duplicates are kept in the array
+ * (so they're written back out on save) but are not reachable by name */
+static void config_section_index_item(struct config_section *section,
+				      size_t idx)
+{
+	struct config_item *item =
+		darray_item(sizeof(struct config_item), &section->items, idx);
+	uint32_t hash = config_hash(item->name);
+
+	if (config_index_find(&section->index, &section->items,
+			      sizeof(struct config_item), hash,
+			      item->name) == DARRAY_INVALID)
+		config_index_add(&section->index, hash, idx);
+}
+
+static void config_section_reindex(struct config_section *section)
+{
+	config_index_free(&section->index);
+
+	for (size_t i = 0; i < section->items.num; i++)
+		config_section_index_item(section, i);
+}
+
 struct config_data {
 	char *file;
 	struct darray sections; /* struct config_section */
 	struct darray defaults; /* struct config_section */
+	struct config_index sections_index;
+	struct config_index defaults_index;
 	pthread_mutex_t mutex;
+
+	/* set when user values change, cleared on save */
+	bool dirty;
+
+	/* deferred save thread, created on first config_save_safe_deferred */
+	pthread_t save_thread;
+	os_event_t *save_event;
+	os_event_t *save_exit_event;
+	volatile bool save_thread_active;
+	bool save_pending;
+	char *save_temp_ext;
+	char *save_backup_ext;
 };
 
+static struct config_section *config_find_section(struct darray *sections,
+						  struct config_index *index,
+						  const char *name)
+{
+	size_t idx = config_index_find(index, sections,
+				       sizeof(struct config_section),
+				       config_hash(name), name);
+
+	return idx != DARRAY_INVALID
+		       ? darray_item(sizeof(struct config_section), sections,
+				     idx)
+		       : NULL;
+}
+
+/* as with items, the first section of a given name wins and repeated ones
+ * are only kept so they're written back out in the same place */
+static struct config_section *config_add_section(struct darray *sections,
+						 struct config_index *index,
+						 char *name)
+{
+	struct config_section *section;
+	uint32_t hash = config_hash(name);
+	bool repeated = config_index_find(index, sections,
+					  sizeof(struct config_section), hash,
+					  name) != DARRAY_INVALID;
+
+	section = darray_push_back_new(sizeof(struct config_section), sections);
+	section->name = name;
+	if (!repeated)
+		config_index_add(index, hash, sections->num - 1);
+	return section;
+}
+
 static inline bool init_mutex(config_t *config)
 {
 	pthread_mutexattr_t attr;
@@ -162,18 +349,21 @@ static void unescape(struct dstr *str)
 		*write = '\0';
 }
 
-static void config_add_item(struct darray *items, struct strref *name,
-			    struct strref *value)
+static void config_add_item(struct config_section *section,
+			    struct strref *name, struct strref *value)
 {
 	struct config_item item;
 	struct dstr item_value;
+	size_t idx;
 	dstr_init_copy_strref(&item_value, value);
 
 	unescape(&item_value);
 
 	item.name = bstrdup_n(name->array, name->len);
 	item.value = item_value.array;
-	darray_push_back(sizeof(struct config_item), items, &item);
+	idx = darray_push_back(sizeof(struct config_item), &section->items,
+			       &item);
+	config_section_index_item(section, idx);
 }
 
 static void config_parse_section(struct config_section *section,
@@ -214,17 +404,20 @@ static void config_parse_section(struct config_section *section,
 
 		if (strref_is_empty(&value)) {
 			struct config_item item;
+			size_t idx;
 			item.name = bstrdup_n(name.array, name.len);
 			item.value = bzalloc(1);
-			darray_push_back(sizeof(struct config_item),
-					 &section->items, &item);
+			idx = darray_push_back(sizeof(struct config_item),
+					       &section->items, &item);
+			config_section_index_item(section, idx);
 		} else {
-			config_add_item(&section->items, &name, &value);
+			config_add_item(section, &name, &value);
 		}
 	}
 }
 
-static void parse_config_data(struct darray *sections, struct lexer *lex)
+static void parse_config_data(struct darray *sections,
+			      struct config_index *index, struct lexer *lex)
 {
 	struct strref section_name;
 	struct base_token token;
@@ -233,6 +426,7 @@ static void parse_config_data(struct darray *sections, struct lexer *lex)
 
 	while (lexer_getbasetoken(lex, &token, PARSE_WHITESPACE)) {
 		struct config_section *section;
+		char *name;
 
 		while (token.type == BASETOKEN_WHITESPACE) {
 			if (!lexer_getbasetoken(lex, &token, PARSE_WHITESPACE))
@@ -254,14 +448,14 @@ static void parse_config_data(struct darray *sections, struct lexer *lex)
 		if (!section_name.len)
 			return;
 
-		section = darray_push_back_new(sizeof(struct config_section),
-					       sections);
-		section->name = bstrdup_n(section_name.array, section_name.len);
+		name = bstrdup_n(section_name.array, section_name.len);
+		section = config_add_section(sections, index, name);
 		config_parse_section(section, lex);
 	}
 }
 
-static int config_parse_file(struct darray *sections, const char *file,
+static int config_parse_file(struct darray *sections,
+			     struct config_index *index, const char *file,
 			     bool always_open)
 {
 	char *file_data;
@@ -283,7 +477,7 @@ static int config_parse_file(struct darray *sections, const char *file,
 	lexer_init(&lex);
 	lexer_start_move(&lex, file_data);
 
-	parse_config_data(sections, &lex);
+	parse_config_data(sections, index, &lex);
 
 	lexer_free(&lex);
 	return CONFIG_SUCCESS;
@@ -309,7 +503,9 @@ int config_open(config_t **config, const char *file,
 
 	(*config)->file = bstrdup(file);
 
-	errorcode = config_parse_file(&(*config)->sections, file, always_open);
+	errorcode = config_parse_file(&(*config)->sections,
+				      &(*config)->sections_index, file,
+				      always_open);
 
 	if (errorcode != CONFIG_SUCCESS) {
 		config_close(*config);
@@ -339,7 +535,8 @@ int config_open_string(config_t **config, const char *str)
 
 	lexer_init(&lex);
 	lexer_start(&lex, str);
-	parse_config_data(&(*config)->sections, &lex);
+	parse_config_data(&(*config)->sections, &(*config)->sections_index,
+			  &lex);
 	lexer_free(&lex);
 
 	return CONFIG_SUCCESS;
@@ -350,7 +547,8 @@ int config_open_defaults(config_t *config, const char *file)
 	if (!config)
 		return CONFIG_ERROR;
 
-	return config_parse_file(&config->defaults, file, false);
+	return config_parse_file(&config->defaults, &config->defaults_index,
+				 file, false);
 }
 
 int config_save(config_t *config)
@@ -407,10 +605,11 @@ int config_save(config_t *config)
 	if (fwrite("\xEF\xBB\xBF", 3, 1, f) != 1)
 		goto cleanup;
 #endif
-	if (fwrite(str.array, str.len, 1, f) != 1)
+	if (str.len && fwrite(str.array, str.len, 1, f) != 1)
 		goto cleanup;
 
 	ret = CONFIG_SUCCESS;
+	config->dirty = false;
 
 cleanup:
 	fclose(f);
@@ -439,6 +638,13 @@ int config_save_safe(config_t *config, const char *temp_ext,
 
 	pthread_mutex_lock(&config->mutex);
 
+	/* nothing changed since the last save, the file is already current,
+	 * unless it has been deleted or never got created */
+	if (!config->dirty && os_file_exists(config->file)) {
+		pthread_mutex_unlock(&config->mutex);
+		return CONFIG_SUCCESS;
+	}
+
 	dstr_copy(&temp_file, config->file);
 	if (*temp_ext != '.')
 		dstr_cat(&temp_file, ".");
@@ -463,8 +669,10 @@ int config_save_safe(config_t *config, const char *temp_ext,
 		dstr_cat(&backup_file, backup_ext);
 	}
 
-	if (os_safe_replace(file, temp_file.array, backup_file.array) != 0)
+	if (os_safe_replace(file, temp_file.array, backup_file.array) != 0) {
+		config->dirty = true;
 		ret = CONFIG_ERROR;
+	}
 
 cleanup:
 	pthread_mutex_unlock(&config->mutex);
@@ -473,6 +681,99 @@ cleanup:
 	return ret;
 }
 
+#define DEFERRED_SAVE_DELAY_MS 1000
+
+static void config_save_pending(config_t *config)
+{
+	char *temp_ext;
+	char *backup_ext;
+	bool pending;
+
+	pthread_mutex_lock(&config->mutex);
+	pending = config->save_pending;
+	temp_ext = config->save_temp_ext;
+	backup_ext = config->save_backup_ext;
+	config->save_pending = false;
+	config->save_temp_ext = NULL;
+	config->save_backup_ext = NULL;
+	pthread_mutex_unlock(&config->mutex);
+
+	if (pending)
+		config_save_safe(config, temp_ext, backup_ext);
+
+	bfree(temp_ext);
+	bfree(backup_ext);
+}
+
+static void *config_save_thread(void *param)
+{
+	config_t *config = param;
+
+	os_set_thread_name("config: deferred save");
+
+	while (os_event_wait(config->save_event) == 0) {
+		/* coalesce any further changes made within the delay, unless
+		 * the config is being closed, which saves it right away */
+		if (os_event_timedwait(config->save_exit_event,
+				       DEFERRED_SAVE_DELAY_MS) != ETIMEDOUT)
+			break;
+
+		config_save_pending(config);
+	}
+
+	return NULL;
+}
+
+int config_save_safe_deferred(config_t *config, const char *temp_ext,
+			      const char *backup_ext)
+{
+	if (!config || !config->file)
+		return CONFIG_ERROR;
+	if (!temp_ext || !*temp_ext) {
+		blog(LOG_ERROR, "config_save_safe_deferred: invalid "
+				"temporary extension specified");
+		return CONFIG_ERROR;
+	}
+
+	pthread_mutex_lock(&config->mutex);
+
+	if (!config->save_thread_active) {
+		if (os_event_init(&config->save_event, OS_EVENT_TYPE_AUTO) !=
+		    0)
+			goto fail;
+		if (os_event_init(&config->save_exit_event,
+				  OS_EVENT_TYPE_MANUAL) != 0) {
+			os_event_destroy(config->save_event);
+			config->save_event = NULL;
+			goto fail;
+		}
+		if (pthread_create(&config->save_thread, NULL,
+				   config_save_thread, config) != 0) {
+			os_event_destroy(config->save_event);
+			os_event_destroy(config->save_exit_event);
+			config->save_event = NULL;
+			config->save_exit_event = NULL;
+			goto fail;
+		}
+		config->save_thread_active = true;
+	}
+
+	bfree(config->save_temp_ext);
+	bfree(config->save_backup_ext);
+	config->save_temp_ext = bstrdup(temp_ext);
+	config->save_backup_ext = backup_ext ? bstrdup(backup_ext) : NULL;
+	config->save_pending = true;
+
+	pthread_mutex_unlock(&config->mutex);
+
+	os_event_signal(config->save_event);
+	return CONFIG_SUCCESS;
+
+fail:
+	pthread_mutex_unlock(&config->mutex);
+	return config_save_safe(config, temp_ext, backup_ext);
+}
+
 void config_close(config_t *config)
 {
 	struct config_section *defaults, *sections;
@@ -481,6 +782,17 @@ void config_close(config_t *config)
 	if (!config)
 		return;
 
+	if (config->save_thread_active) {
+		os_event_signal(config->save_exit_event);
+		os_event_signal(config->save_event);
+		pthread_join(config->save_thread, NULL);
+		os_event_destroy(config->save_event);
+		os_event_destroy(config->save_exit_event);
+	}
+
+	/* flush anything that was still waiting to be written */
+	config_save_pending(config);
+
 	defaults = config->defaults.array;
 	sections = config->sections.array;
 
@@ -491,6 +803,8 @@ void config_close(config_t *config)
 
 	darray_free(&config->defaults);
 	darray_free(&config->sections);
+	config_index_free(&config->defaults_index);
+	config_index_free(&config->sections_index);
 	bfree(config->file);
 	pthread_mutex_destroy(&config->mutex);
 	bfree(config);
@@ -520,70 +834,64 @@ unlock:
 	return name;
 }
 
-static const struct config_item *config_find_item(const struct darray *sections,
+static const struct config_item *config_find_item(struct darray *sections,
+						  struct config_index *index,
 						  const char *section,
 						  const char *name)
 {
-	size_t i, j;
-
-	for (i = 0; i < sections->num; i++) {
-		const struct config_section *sec =
-			darray_item(sizeof(struct config_section), sections, i);
+	struct config_section *sec;
+	size_t idx;
 
-		if (astrcmpi(sec->name, section) == 0) {
-			for (j = 0; j < sec->items.num; j++) {
-				struct config_item *item =
-					darray_item(sizeof(struct config_item),
-						    &sec->items, j);
-
-				if (astrcmpi(item->name, name) == 0)
-					return item;
-			}
-		}
-	}
+	sec = config_find_section(sections, index, section);
+	if (!sec)
+		return NULL;
 
-	return NULL;
+	idx = config_section_find_item(sec, name);
+	return idx != DARRAY_INVALID
+		       ? darray_item(sizeof(struct config_item), &sec->items,
+				     idx)
+		       : NULL;
 }
 
 static void config_set_item(config_t *config, struct darray *sections,
-			    const char *section, const char *name, char *value)
+			    struct config_index *index, const char *section,
+			    const char *name, char *value)
 {
-	struct config_section *sec = NULL;
-	struct config_section *array = sections->array;
+	struct config_section *sec;
 	struct config_item *item;
-	size_t i, j;
-
-	pthread_mutex_lock(&config->mutex);
-
-	for (i = 0; i < sections->num; i++) {
-		struct config_section *cur_sec = array + i;
-		struct config_item *items = cur_sec->items.array;
+	size_t idx;
 
-		if (astrcmpi(cur_sec->name, section) == 0) {
-			for (j = 0; j < cur_sec->items.num; j++) {
-				item = items + j;
+	bool user = sections == &config->sections;
 
-				if (astrcmpi(item->name, name) == 0) {
-					bfree(item->value);
-					item->value = value;
-					goto unlock;
-				}
-			}
-
-			sec = cur_sec;
-			break;
-		}
-	}
+	pthread_mutex_lock(&config->mutex);
 
+	sec = config_find_section(sections, index, section);
 	if (!sec) {
-		sec = darray_push_back_new(sizeof(struct config_section),
-					   sections);
-		sec->name = bstrdup(section);
+		sec = config_add_section(sections, index, bstrdup(section));
+	} else {
+		idx = config_section_find_item(sec, name);
+		if (idx != DARRAY_INVALID) {
+			item = darray_item(sizeof(struct config_item),
+					   &sec->items, idx);
+
+			/* setting the same value again doesn't need a save */
+			if (user && strcmp(item->value ? item->value : "",
+					   value ? value : "") != 0)
+				config->dirty = true;
+
+			bfree(item->value);
+			item->value = value;
+			goto unlock;
+		}
 	}
 
 	item = darray_push_back_new(sizeof(struct config_item), &sec->items);
 	item->name = bstrdup(name);
 	item->value = value;
+	config_index_add(&sec->index, config_hash(name), sec->items.num - 1);
+
+	if (user)
+		config->dirty = true;
 
 unlock:
 	pthread_mutex_unlock(&config->mutex);
@@ -594,8 +902,8 @@ void config_set_string(config_t *config, const char *section, const char *name,
 {
 	if (!value)
 		value = "";
-	config_set_item(config, &config->sections, section, name,
-			bstrdup(value));
+	config_set_item(config, &config->sections, &config->sections_index,
+			section, name, bstrdup(value));
 }
 
 void config_set_int(config_t *config, const char *section, const char *name,
@@ -604,7 +912,8 @@ void config_set_int(config_t *config, const char *section, const char *name,
 	struct dstr str;
 	dstr_init(&str);
 	dstr_printf(&str, "%" PRId64, value);
-	config_set_item(config, &config->sections, section, name, str.array);
+	config_set_item(config, &config->sections, &config->sections_index,
+			section, name, str.array);
 }
 
 void config_set_uint(config_t *config, const char *section, const char *name,
@@ -613,14 +922,16 @@ void config_set_uint(config_t *config, const char *section, const char *name,
 	struct dstr str;
 	dstr_init(&str);
 	dstr_printf(&str, "%" PRIu64, value);
-	config_set_item(config, &config->sections, section, name, str.array);
+	config_set_item(config, &config->sections, &config->sections_index,
+			section, name, str.array);
 }
 
 void config_set_bool(config_t *config, const char *section, const char *name,
 		     bool value)
 {
 	char *str = bstrdup(value ? "true" : "false");
-	config_set_item(config, &config->sections, section, name, str);
+	config_set_item(config, &config->sections, &config->sections_index,
+			section, name, str);
 }
 
 void config_set_double(config_t *config, const char *section, const char *name,
@@ -628,7 +939,8 @@ void config_set_double(config_t *config, const char *section, const char *name,
 {
 	char *str = bzalloc(64);
 	os_dtostr(value, str, 64);
-	config_set_item(config, &config->sections, section, name, str);
+	config_set_item(config, &config->sections, &config->sections_index,
+			section, name, str);
 }
 
 void config_set_default_string(config_t *config, const char *section,
@@ -636,8 +948,8 @@ void config_set_default_string(config_t *config, const char *section,
 {
 	if (!value)
 		value = "";
-	config_set_item(config, &config->defaults, section, name,
-			bstrdup(value));
+	config_set_item(config, &config->defaults, &config->defaults_index,
+			section, name, bstrdup(value));
 }
 
 void config_set_default_int(config_t *config, const char *section,
@@ -646,7 +958,8 @@ void config_set_default_int(config_t *config, const char *section,
 	struct dstr str;
 	dstr_init(&str);
 	dstr_printf(&str, "%" PRId64, value);
-	config_set_item(config, &config->defaults, section, name, str.array);
+	config_set_item(config, &config->defaults, &config->defaults_index,
+			section, name, str.array);
 }
 
 void config_set_default_uint(config_t *config, const char *section,
@@ -655,14 +968,16 @@ void config_set_default_uint(config_t *config, const char *section,
 	struct dstr str;
 	dstr_init(&str);
 	dstr_printf(&str, "%" PRIu64, value);
-	config_set_item(config, &config->defaults, section, name, str.array);
+	config_set_item(config, &config->defaults, &config->defaults_index,
+			section, name, str.array);
 }
 
 void config_set_default_bool(config_t *config, const char *section,
 			     const char *name, bool value)
 {
 	char *str = bstrdup(value ? "true" : "false");
-	config_set_item(config, &config->defaults, section, name, str);
+	config_set_item(config, &config->defaults, &config->defaults_index,
+			section, name, str);
 }
 
 void config_set_default_double(config_t *config, const char *section,
@@ -671,7 +986,8 @@ void config_set_default_double(config_t *config, const char *section,
 	struct dstr str;
 	dstr_init(&str);
 	dstr_printf(&str, "%g", value);
-	config_set_item(config, &config->defaults, section, name, str.array);
+	config_set_item(config, &config->defaults, &config->defaults_index,
+			section, name, str.array);
 }
 
 const char *config_get_string(config_t *config, const char *section,
@@ -682,9 +998,11 @@ const char *config_get_string(config_t *config, const char *section,
 
 	pthread_mutex_lock(&config->mutex);
 
-	item = config_find_item(&config->sections, section, name);
+	item = config_find_item(&config->sections, &config->sections_index,
+				section, name);
 	if (!item)
-		item = config_find_item(&config->defaults, section, name);
+		item = config_find_item(&config->defaults,
+					&config->defaults_index, section, name);
 	if (item)
 		value = item->value;
 
@@ -755,31 +1073,28 @@ double config_get_double(config_t *config, const char *section,
 bool config_remove_value(config_t *config, const char *section,
 			 const char *name)
 {
-	struct darray *sections = &config->sections;
+	struct config_section *sec;
 	bool success = false;
+	size_t idx;
 
 	pthread_mutex_lock(&config->mutex);
 
-	for (size_t i = 0; i < sections->num; i++) {
-		struct config_section *sec =
-			darray_item(sizeof(struct config_section), sections, i);
+	sec = config_find_section(&config->sections, &config->sections_index,
+				  section);
+	if (!sec)
+		goto unlock;
 
-		if (astrcmpi(sec->name, section) != 0)
-			continue;
+	idx = config_section_find_item(sec, name);
+	if (idx == DARRAY_INVALID)
+		goto unlock;
 
-		for (size_t j = 0; j < sec->items.num; j++) {
-			struct config_item *item = darray_item(
-				sizeof(struct config_item), &sec->items, j);
+	config_item_free(
+		darray_item(sizeof(struct config_item), &sec->items, idx));
+	darray_erase(sizeof(struct config_item), &sec->items, idx);
+	config_section_reindex(sec);
 
-			if (astrcmpi(item->name, name) == 0) {
-				config_item_free(item);
-				darray_erase(sizeof(struct config_item),
-					     &sec->items, j);
-				success = true;
-				goto unlock;
-			}
-		}
-	}
+	config->dirty = true;
+	success = true;
 
 unlock:
 	pthread_mutex_unlock(&config->mutex);
@@ -794,7 +1109,8 @@ const char *config_get_default_string(config_t *config, const char *section,
 
 	pthread_mutex_lock(&config->mutex);
 
-	item = config_find_item(&config->defaults, section, name);
+	item = config_find_item(&config->defaults, &config->defaults_index,
+				section, name);
 	if (item)
 		value = item->value;
 
@@ -847,7 +1163,8 @@ bool config_has_user_value(config_t *config, const char *section,
 {
 	bool success;
 	pthread_mutex_lock(&config->mutex);
-	success = config_find_item(&config->sections, section, name) != NULL;
+	success = config_find_item(&config->sections, &config->sections_index,
+				   section, name) != NULL;
 	pthread_mutex_unlock(&config->mutex);
 	return success;
 }
@@ -857,7 +1174,8 @@ bool config_has_default_value(config_t *config, const char *section,
 {
 	bool success;
 	pthread_mutex_lock(&config->mutex);
-	success = config_find_item(&config->defaults, section, name) != NULL;
+	success = config_find_item(&config->defaults, &config->defaults_index,
+				   section, name) != NULL;
 	pthread_mutex_unlock(&config->mutex);
 	return success;
 }
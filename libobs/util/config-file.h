@@ -48,6 +48,17 @@ EXPORT int config_open_string(config_t **config, const char *str);
 EXPORT int config_save(config_t *config);
 EXPORT int config_save_safe(config_t *config, const char *temp_ext,
 			    const char *backup_ext);
+
+/*
+ * Same as config_save_safe, but the file is written on a background thread a
+ * short time later.  Multiple calls made within that time are coalesced into a
+ * single write, and any pending write is flushed by config_close.
+ *
+ * NOTE: config_save_safe only writes the file if user values have changed
+ * since it was opened or last saved, or if the file doesn't exist yet.
+ */
+EXPORT int config_save_safe_deferred(config_t *config, const char *temp_ext,
+				     const char *backup_ext);
 EXPORT void config_close(config_t *config);
 
 EXPORT size_t config_num_sections(config_t *config);
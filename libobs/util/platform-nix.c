@@ -19,6 +19,8 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <sys/statvfs.h>
+#include <sys/mman.h>
+#include <fcntl.h>
 #include <dirent.h>
 #include <stdlib.h>
 #include <limits.h>
@@ -389,6 +391,60 @@ bool os_file_exists(const char *path)
 	return access(path, F_OK) == 0;
 }
 
+struct os_mapped_file {
+	void *data;
+	size_t size;
+};
+
+os_mapped_file_t *os_mapped_file_open(const char *path)
+{
+	struct os_mapped_file *file;
+	struct stat st;
+	void *data;
+	int fd;
+
+	if (!path)
+		return NULL;
+
+	fd = open(path, O_RDONLY);
+	if (fd == -1)
+		return NULL;
+
+	if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+		close(fd);
+		return NULL;
+	}
+
+	data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+
+	if (data == MAP_FAILED)
+		return NULL;
+
+	file = bmalloc(sizeof(struct os_mapped_file));
+	file->data = data;
+	file->size = (size_t)st.st_size;
+	return file;
+}
+
+void os_mapped_file_close(os_mapped_file_t *file)
+{
+	if (file) {
+		munmap(file->data, file->size);
+		bfree(file);
+	}
+}
+
+const void *os_mapped_file_data(const os_mapped_file_t *file)
+{
+	return file ? file->data : NULL;
+}
+
+size_t os_mapped_file_size(const os_mapped_file_t *file)
+{
+	return file ? file->size : 0;
+}
+
 size_t os_get_abs_path(const char *path, char *abspath, size_t size)
 {
 	size_t min_size = size < PATH_MAX ? size : PATH_MAX;
@@ -459,6 +459,78 @@ char *os_get_executable_path_ptr(const char *name)
 	return path.array;
 }
 
+struct os_mapped_file {
+	HANDLE file;
+	HANDLE mapping;
+	void *data;
+	size_t size;
+};
+
+os_mapped_file_t *os_mapped_file_open(const char *path)
+{
+	struct os_mapped_file *file;
+	LARGE_INTEGER size;
+	wchar_t *wpath;
+	HANDLE hFile;
+	HANDLE hMapping;
+	void *data;
+
+	if (!os_utf8_to_wcs_ptr(path, 0, &wpath))
+		return NULL;
+
+	hFile = CreateFileW(wpath, GENERIC_READ, FILE_SHARE_READ, NULL,
+			    OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	bfree(wpath);
+
+	if (hFile == INVALID_HANDLE_VALUE)
+		return NULL;
+
+	if (!GetFileSizeEx(hFile, &size) || size.QuadPart <= 0) {
+		CloseHandle(hFile);
+		return NULL;
+	}
+
+	hMapping = CreateFileMapping(hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (!hMapping) {
+		CloseHandle(hFile);
+		return NULL;
+	}
+
+	data = MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0);
+	if (!data) {
+		CloseHandle(hMapping);
+		CloseHandle(hFile);
+		return NULL;
+	}
+
+	file = bmalloc(sizeof(struct os_mapped_file));
+	file->file = hFile;
+	file->mapping = hMapping;
+	file->data = data;
+	file->size = (size_t)size.QuadPart;
+	return file;
+}
+
+void os_mapped_file_close(os_mapped_file_t *file)
+{
+	if (file) {
+		UnmapViewOfFile(file->data);
+		CloseHandle(file->mapping);
+		CloseHandle(file->file);
+		bfree(file);
+	}
+}
+
+const void *os_mapped_file_data(const os_mapped_file_t *file)
+{
+	return file ? file->data : NULL;
+}
+
+size_t os_mapped_file_size(const os_mapped_file_t *file)
+{
+	return file ? file->size : 0;
+}
+
 bool os_file_exists(const char *path)
 {
 	WIN32_FIND_DATAW wfd;
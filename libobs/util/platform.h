@@ -61,6 +61,15 @@ EXPORT bool os_quick_write_mbs_file(const char *path, const char *str,
 EXPORT int64_t os_get_file_size(const char *path);
 EXPORT int64_t os_get_free_space(const char *path);
 
+/* read-only memory mapped files */
+struct os_mapped_file;
+typedef struct os_mapped_file os_mapped_file_t;
+
+EXPORT os_mapped_file_t *os_mapped_file_open(const char *path);
+EXPORT void os_mapped_file_close(os_mapped_file_t *file);
+EXPORT const void *os_mapped_file_data(const os_mapped_file_t *file);
+EXPORT size_t os_mapped_file_size(const os_mapped_file_t *file);
+
 EXPORT size_t os_mbs_to_wcs(const char *str, size_t str_len, wchar_t *dst,
 			    size_t dst_size);
 EXPORT size_t os_utf8_to_wcs(const char *str, size_t len, wchar_t *dst,
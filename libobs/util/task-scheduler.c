@@ -0,0 +1,457 @@
+/*
+ * Copyright (c) 2021 Hugh Bailey <obs.jim@gmail.com>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "threading.h"
+#include "circlebuf.h"
+#include "platform.h"
+#include "bmem.h"
+#include "base.h"
+
+/*
+ * Work-stealing task scheduler.
+ *
+ * Each worker owns one queue per priority.  Tasks are pushed to a worker's
+ * queues either round-robin or to the worker named by the affinity hint.  A
+ * worker always services its own queues first (newest task first, which
+ * keeps data warm in cache), and when they're empty it steals the oldest task
+ * from the other workers, highest priority first.
+ */
+
+struct task_item {
+	os_task_t task;
+	void *param;
+	uint64_t queue_ts;
+};
+
+struct task_worker {
+	struct os_task_scheduler *ts;
+	pthread_t thread;
+	bool thread_created;
+	size_t idx;
+
+	pthread_mutex_t mutex;
+	struct circlebuf queues[OS_TASK_PRIORITY_COUNT];
+};
+
+struct os_task_scheduler {
+	struct task_worker *workers;
+	size_t num_workers;
+
+	os_sem_t *sem;
+	volatile bool exiting;
+	volatile long next_worker;
+	volatile long pending;
+
+	pthread_mutex_t stats_mutex;
+	struct os_task_scheduler_stats stats;
+	uint64_t total_latency_ns;
+};
+
+static THREAD_LOCAL struct task_worker *current_worker = NULL;
+
+/* ------------------------------------------------------------------------- */
+
+static bool pop_task(struct task_worker *worker, struct task_item *item,
+		     bool steal)
+{
+	bool found = false;
+
+	pthread_mutex_lock(&worker->mutex);
+
+	for (int i = OS_TASK_PRIORITY_COUNT - 1; i >= 0; i--) {
+		struct circlebuf *queue = &worker->queues[i];
+
+		if (!queue->size)
+			continue;
+
+		if (steal)
+			circlebuf_pop_front(queue, item, sizeof(*item));
+		else
+			circlebuf_pop_back(queue, item, sizeof(*item));
+		found = true;
+		break;
+	}
+
+	pthread_mutex_unlock(&worker->mutex);
+	return found;
+}
+
+static void record_task_stats(struct os_task_scheduler *ts,
+			      uint64_t latency_ns, bool stolen)
+{
+	pthread_mutex_lock(&ts->stats_mutex);
+
+	ts->stats.tasks_executed++;
+	if (stolen)
+		ts->stats.tasks_stolen++;
+	if (latency_ns > ts->stats.max_queue_latency_ns)
+		ts->stats.max_queue_latency_ns = latency_ns;
+
+	ts->total_latency_ns += latency_ns;
+	ts->stats.avg_queue_latency_ns =
+		ts->total_latency_ns / ts->stats.tasks_executed;
+
+	pthread_mutex_unlock(&ts->stats_mutex);
+}
+
+/* runs one queued task on the calling thread, if there is one.  "self" is the
+ * worker the calling thread belongs to, or NULL for any other thread */
+static bool run_next_task(struct os_task_scheduler *ts,
+			  struct task_worker *self)
+{
+	struct task_item item;
+	bool stolen = false;
+	bool found = false;
+	size_t start;
+
+	if (self)
+		found = pop_task(self, &item, false);
+
+	if (!found) {
+		start = self ? self->idx + 1 : 0;
+
+		for (size_t i = 0; i < ts->num_workers; i++) {
+			struct task_worker *victim =
+				&ts->workers[(start + i) % ts->num_workers];
+
+			if (victim == self)
+				continue;
+
+			if (pop_task(victim, &item, true)) {
+				stolen = true;
+				found = true;
+				break;
+			}
+		}
+	}
+
+	if (!found)
+		return false;
+
+	record_task_stats(ts, os_gettime_ns() - item.queue_ts, stolen);
+
+	item.task(item.param);
+	os_atomic_dec_long(&ts->pending);
+	return true;
+}
+
+static void *task_worker_thread(void *param)
+{
+	struct task_worker *worker = param;
+	struct os_task_scheduler *ts = worker->ts;
+
+	os_set_thread_name("libobs: task worker");
+	current_worker = worker;
+
+	/* the semaphore is posted once per queued task (and once per worker on
+	 * exit), but another thread may have already run the task we were
+	 * woken for, so an empty wakeup is only fatal when exiting */
+	while (os_sem_wait(ts->sem) == 0) {
+		if (run_next_task(ts, worker))
+			continue;
+		if (os_atomic_load_bool(&ts->exiting))
+			break;
+	}
+
+	current_worker = NULL;
+	return NULL;
+}
+
+/* ------------------------------------------------------------------------- */
+
+os_task_scheduler_t *os_task_scheduler_create(size_t num_threads)
+{
+	struct os_task_scheduler *ts;
+
+	if (!num_threads) {
+		int cores = os_get_logical_cores();
+		num_threads = cores > 1 ? (size_t)cores - 1 : 1;
+	}
+
+	ts = bzalloc(sizeof(struct os_task_scheduler));
+	ts->num_workers = num_threads;
+	ts->workers = bzalloc(sizeof(struct task_worker) * num_threads);
+
+	if (pthread_mutex_init(&ts->stats_mutex, NULL) != 0) {
+		bfree(ts->workers);
+		bfree(ts);
+		return NULL;
+	}
+	if (os_sem_init(&ts->sem, 0) != 0)
+		goto fail;
+
+	for (size_t i = 0; i < num_threads; i++) {
+		struct task_worker *worker = &ts->workers[i];
+
+		worker->ts = ts;
+		worker->idx = i;
+		pthread_mutex_init_value(&worker->mutex);
+		if (pthread_mutex_init(&worker->mutex, NULL) != 0)
+			goto fail;
+	}
+
+	for (size_t i = 0; i < num_threads; i++) {
+		struct task_worker *worker = &ts->workers[i];
+
+		if (pthread_create(&worker->thread, NULL, task_worker_thread,
+				   worker) != 0)
+			goto fail;
+		worker->thread_created = true;
+	}
+
+	return ts;
+
+fail:
+	blog(LOG_ERROR, "os_task_scheduler_create: failed to create "
+			"task scheduler");
+	os_task_scheduler_destroy(ts);
+	return NULL;
+}
+
+void os_task_scheduler_destroy(os_task_scheduler_t *ts)
+{
+	if (!ts)
+		return;
+
+	os_atomic_set_bool(&ts->exiting, true);
+
+	for (size_t i = 0; i < ts->num_workers; i++) {
+		if (ts->workers[i].thread_created)
+			os_sem_post(ts->sem);
+	}
+
+	for (size_t i = 0; i < ts->num_workers; i++) {
+		struct task_worker *worker = &ts->workers[i];
+
+		if (worker->thread_created)
+			pthread_join(worker->thread, NULL);
+	}
+
+	/* run anything that was queued after the workers stopped */
+	while (run_next_task(ts, NULL))
+		;
+
+	for (size_t i = 0; i < ts->num_workers; i++) {
+		struct task_worker *worker = &ts->workers[i];
+
+		for (size_t j = 0; j < OS_TASK_PRIORITY_COUNT; j++)
+			circlebuf_free(&worker->queues[j]);
+		pthread_mutex_destroy(&worker->mutex);
+	}
+
+	os_sem_destroy(ts->sem);
+	pthread_mutex_destroy(&ts->stats_mutex);
+	bfree(ts->workers);
+	bfree(ts);
+}
+
+size_t os_task_scheduler_num_threads(const os_task_scheduler_t *ts)
+{
+	return ts ? ts->num_workers : 0;
+}
+
+bool os_task_scheduler_queue(os_task_scheduler_t *ts, os_task_t task,
+			     void *param, enum os_task_priority priority,
+			     int affinity)
+{
+	struct task_worker *worker;
+	struct task_item item;
+	size_t idx;
+
+	if (!ts || !task)
+		return false;
+	if ((int)priority < 0 || priority >= OS_TASK_PRIORITY_COUNT)
+		priority = OS_TASK_PRIORITY_NORMAL;
+
+	if (affinity >= 0)
+		idx = (size_t)affinity % ts->num_workers;
+	else
+		idx = (size_t)os_atomic_inc_long(&ts->next_worker) %
+		      ts->num_workers;
+
+	item.task = task;
+	item.param = param;
+	item.queue_ts = os_gettime_ns();
+
+	worker = &ts->workers[idx];
+
+	os_atomic_inc_long(&ts->pending);
+
+	pthread_mutex_lock(&worker->mutex);
+	circlebuf_push_back(&worker->queues[priority], &item, sizeof(item));
+	pthread_mutex_unlock(&worker->mutex);
+
+	os_sem_post(ts->sem);
+	return true;
+}
+
+void os_task_scheduler_wait(os_task_scheduler_t *ts)
+{
+	if (!ts)
+		return;
+
+	while (os_atomic_load_long(&ts->pending) > 0) {
+		if (!run_next_task(ts, current_worker))
+			os_sleep_ms(1);
+	}
+}
+
+/* ------------------------------------------------------------------------- */
+
+/*
+ * The data of a parallel_for is shared by the calling thread and the helper
+ * tasks, and freed once the last of them released it.  The caller only waits
+ * for chunks that were already claimed to complete, not for the helpers to
+ * run, so helpers still waiting in a queue find nothing left to do and just
+ * release the data.  This also means the caller never has to run unrelated
+ * tasks to make progress.
+ */
+struct parallel_for_data {
+	os_parallel_for_t func;
+	void *param;
+	size_t count;
+	size_t grain;
+	volatile long next_chunk;
+	long num_chunks;
+	volatile long refs;
+
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+	long chunks_done;
+};
+
+static void parallel_for_release(struct parallel_for_data *pf)
+{
+	if (os_atomic_dec_long(&pf->refs) > 0)
+		return;
+
+	pthread_cond_destroy(&pf->cond);
+	pthread_mutex_destroy(&pf->mutex);
+	bfree(pf);
+}
+
+static void run_parallel_chunks(struct parallel_for_data *pf)
+{
+	long chunk;
+	long done = 0;
+
+	while ((chunk = os_atomic_inc_long(&pf->next_chunk) - 1) <
+	       pf->num_chunks) {
+		size_t start = (size_t)chunk * pf->grain;
+		size_t end = start + pf->grain;
+
+		if (end > pf->count)
+			end = pf->count;
+
+		pf->func(pf->param, start, end);
+		done++;
+	}
+
+	if (!done)
+		return;
+
+	pthread_mutex_lock(&pf->mutex);
+	pf->chunks_done += done;
+	if (pf->chunks_done == pf->num_chunks)
+		pthread_cond_signal(&pf->cond);
+	pthread_mutex_unlock(&pf->mutex);
+}
+
+static void parallel_for_helper(void *param)
+{
+	struct parallel_for_data *pf = param;
+
+	run_parallel_chunks(pf);
+	parallel_for_release(pf);
+}
+
+void os_task_scheduler_parallel_for(os_task_scheduler_t *ts, size_t count,
+				    size_t grain, os_parallel_for_t func,
+				    void *param)
+{
+	struct parallel_for_data *pf;
+	long num_chunks;
+	long num_helpers;
+
+	if (!count || !func)
+		return;
+
+	if (!grain) {
+		size_t threads = ts ? ts->num_workers + 1 : 1;
+		grain = (count + threads * 4 - 1) / (threads * 4);
+	}
+
+	num_chunks = (long)((count + grain - 1) / grain);
+	num_helpers = ts ? (long)ts->num_workers : 0;
+	if (num_helpers > num_chunks - 1)
+		num_helpers = num_chunks - 1;
+
+	if (num_helpers <= 0) {
+		func(param, 0, count);
+		return;
+	}
+
+	pf = bzalloc(sizeof(struct parallel_for_data));
+	pf->func = func;
+	pf->param = param;
+	pf->count = count;
+	pf->grain = grain;
+	pf->num_chunks = num_chunks;
+	pf->refs = num_helpers + 1;
+
+	if (pthread_mutex_init(&pf->mutex, NULL) != 0) {
+		bfree(pf);
+		func(param, 0, count);
+		return;
+	}
+	if (pthread_cond_init(&pf->cond, NULL) != 0) {
+		pthread_mutex_destroy(&pf->mutex);
+		bfree(pf);
+		func(param, 0, count);
+		return;
+	}
+
+	for (long i = 0; i < num_helpers; i++) {
+		if (!os_task_scheduler_queue(ts, parallel_for_helper, pf,
+					     OS_TASK_PRIORITY_HIGH, -1))
+			os_atomic_dec_long(&pf->refs);
+	}
+
+	/* the calling thread takes part as well */
+	run_parallel_chunks(pf);
+
+	pthread_mutex_lock(&pf->mutex);
+	while (pf->chunks_done < pf->num_chunks)
+		pthread_cond_wait(&pf->cond, &pf->mutex);
+	pthread_mutex_unlock(&pf->mutex);
+
+	parallel_for_release(pf);
+}
+
+/* ------------------------------------------------------------------------- */
+
+void os_task_scheduler_get_stats(os_task_scheduler_t *ts,
+				 struct os_task_scheduler_stats *stats)
+{
+	if (!ts || !stats)
+		return;
+
+	pthread_mutex_lock(&ts->stats_mutex);
+	*stats = ts->stats;
+	pthread_mutex_unlock(&ts->stats_mutex);
+
+	stats->tasks_pending = (uint64_t)os_atomic_load_long(&ts->pending);
+}
@@ -14,10 +14,14 @@
  * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
  */
 
+#include <stdlib.h>
+#include <sys/stat.h>
+#include "darray.h"
 #include "dstr.h"
 #include "text-lookup.h"
 #include "lexer.h"
 #include "platform.h"
+#include "base.h"
 
 /* ------------------------------------------------------------------------- */
 
@@ -97,10 +101,6 @@ static struct text_node *text_node_byname(struct text_node *node,
 
 /* ------------------------------------------------------------------------- */
 
-struct text_lookup {
-	struct dstr language;
-	struct text_node *top;
-};
 
 static void lookup_createsubnode(const char *lookup_val, struct text_leaf *leaf,
 				 struct text_node *node)
@@ -292,8 +292,10 @@ static char *convert_string(const char *str, size_t len)
 	return out.array;
 }
 
-static void lookup_addfiledata(struct text_lookup *lookup,
-			       const char *file_data)
+typedef void (*lookup_add_cb)(void *param, char *lookup, char *value);
+
+static void lookup_parsefiledata(const char *file_data, lookup_add_cb add,
+				 void *param)
 {
 	struct lexer lex;
 	struct strref name, value;
@@ -304,7 +306,6 @@ static void lookup_addfiledata(struct text_lookup *lookup,
 	strref_clear(&value);
 
 	while (lookup_gettoken(&lex, &name)) {
-		struct text_leaf *leaf;
 		bool got_eq = false;
 
 		if (*name.array == '\n')
@@ -319,11 +320,8 @@ static void lookup_addfiledata(struct text_lookup *lookup,
 			goto getval;
 		}
 
-		leaf = bmalloc(sizeof(struct text_leaf));
-		leaf->lookup = bstrdup_n(name.array, name.len);
-		leaf->value = convert_string(value.array, value.len);
-
-		lookup_addstring(leaf->lookup, leaf, lookup->top);
+		add(param, bstrdup_n(name.array, name.len),
+		    convert_string(value.array, value.len));
 
 		if (!lookup_goto_nextline(&lex))
 			break;
@@ -332,6 +330,38 @@ static void lookup_addfiledata(struct text_lookup *lookup,
 	lexer_free(&lex);
 }
 
+static void lookup_addleaf(void *param, char *lookup, char *value)
+{
+	struct text_node *top = param;
+	struct text_leaf *leaf = bmalloc(sizeof(struct text_leaf));
+
+	leaf->lookup = lookup;
+	leaf->value = value;
+
+	lookup_addstring(leaf->lookup, leaf, top);
+}
+
+static char *lookup_readfile(const char *path)
+{
+	struct dstr file_str;
+	char *temp = NULL;
+	FILE *file;
+
+	file = os_fopen(path, "rb");
+	if (!file)
+		return NULL;
+
+	os_fread_utf8(file, &temp);
+	dstr_init_move_array(&file_str, temp);
+	fclose(file);
+
+	if (!file_str.array)
+		return NULL;
+
+	dstr_replace(&file_str, "\r", " ");
+	return file_str.array;
+}
+
 static inline bool lookup_getstring(const char *lookup_val, const char **out,
 				    struct text_node *node)
 {
@@ -358,6 +388,450 @@ static inline bool lookup_getstring(const char *lookup_val, const char **out,
 }
 
 /* ------------------------------------------------------------------------- */
+/* precompiled lookup tables
+ *
+ * A compiled table is a flat file that is memory mapped as-is:
+ *
+ *   header
+ *   uint32_t seeds[num_buckets]
+ *   struct text_table_entry entries[num_entries]
+ *   strings (null-terminated, values already unescaped)
+ *
+ * Lookups use a minimal perfect hash (hash and displace): the first hash
+ * picks a bucket, and the seed stored for that bucket is mixed into the
+ * second hash which gives the entry slot.  Keys are case-insensitive, like
+ * the radix tree used for .ini files. */
+
+#define TEXT_TABLE_MAGIC 0x4C53424F /* "OBSL" */
+#define TEXT_TABLE_VERSION 1
+#define TEXT_TABLE_EXT ".locale"
+#define TEXT_TABLE_BUCKET_SIZE 4
+#define TEXT_TABLE_MAX_SEED_TRIES (1 << 20)
+
+struct text_table_header {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t num_entries;
+	uint32_t num_slots;
+	uint32_t num_buckets;
+	uint32_t strings_size;
+};
+
+struct text_table_entry {
+	uint32_t lookup;
+	uint32_t value;
+};
+
+struct text_table {
+	os_mapped_file_t *file;
+	const struct text_table_header *header;
+	const uint32_t *seeds;
+	const struct text_table_entry *entries;
+	const char *strings;
+};
+
+static inline uint32_t text_table_hash(const char *str, uint32_t seed)
+{
+	uint32_t hash = 2166136261U ^ (seed * 0x9E3779B9U);
+
+	while (*str) {
+		char ch = *(str++);
+		if (ch >= 'A' && ch <= 'Z')
+			ch += 0x20;
+
+		hash ^= (uint8_t)ch;
+		hash *= 16777619U;
+	}
+
+	hash ^= hash >> 16;
+	hash *= 0x85EBCA6BU;
+	hash ^= hash >> 13;
+	hash *= 0xC2B2AE35U;
+	hash ^= hash >> 16;
+	return hash;
+}
+
+static bool text_table_load(struct text_table *table, const char *path)
+{
+	const struct text_table_header *header;
+	const uint8_t *data;
+	size_t size, expected;
+
+	table->file = os_mapped_file_open(path);
+	if (!table->file)
+		return false;
+
+	data = os_mapped_file_data(table->file);
+	size = os_mapped_file_size(table->file);
+	header = (const struct text_table_header *)data;
+
+	if (size < sizeof(*header) || header->magic != TEXT_TABLE_MAGIC ||
+	    header->version != TEXT_TABLE_VERSION || !header->num_buckets ||
+	    header->num_slots < header->num_entries)
+		goto invalid;
+
+	expected = sizeof(*header) +
+		   sizeof(uint32_t) * (size_t)header->num_buckets +
+		   sizeof(struct text_table_entry) * (size_t)header->num_slots +
+		   (size_t)header->strings_size;
+	if (expected != size || !header->strings_size)
+		goto invalid;
+
+	table->header = header;
+	table->seeds = (const uint32_t *)(data + sizeof(*header));
+	table->entries = (const struct text_table_entry *)(table->seeds +
+							   header->num_buckets);
+	table->strings = (const char *)(table->entries + header->num_slots);
+
+	if (table->strings[header->strings_size - 1] != 0)
+		goto invalid;
+
+	for (uint32_t i = 0; i < header->num_slots; i++) {
+		if (table->entries[i].lookup >= header->strings_size ||
+		    table->entries[i].value >= header->strings_size)
+			goto invalid;
+	}
+
+	return true;
+
+invalid:
+	blog(LOG_WARNING, "text_lookup: invalid compiled table '%s'", path);
+	os_mapped_file_close(table->file);
+	memset(table, 0, sizeof(*table));
+	return false;
+}
+
+static bool text_table_getstr(const struct text_table *table,
+			      const char *lookup_val, const char **out)
+{
+	const struct text_table_header *header = table->header;
+	const struct text_table_entry *entry;
+	uint32_t bucket, slot;
+
+	/* unused slots have an empty lookup string, and the .ini parser never
+	 * adds an empty key, so an empty key could only ever match those */
+	if (!header->num_entries || !*lookup_val)
+		return false;
+
+	bucket = text_table_hash(lookup_val, 0) % header->num_buckets;
+	slot = text_table_hash(lookup_val, table->seeds[bucket]) %
+	       header->num_slots;
+
+	entry = &table->entries[slot];
+	if (astrcmpi(table->strings + entry->lookup, lookup_val) != 0)
+		return false;
+
+	*out = table->strings + entry->value;
+	return true;
+}
+
+/* ------------------------------------------------------------------------- */
+/* table compilation */
+
+struct compile_pair {
+	char *lookup;
+	char *value;
+	size_t order;
+};
+
+struct compile_data {
+	DARRAY(struct compile_pair) pairs;
+};
+
+struct compile_bucket {
+	uint32_t idx;
+	DARRAY(struct compile_pair *) pairs;
+};
+
+static void compile_addpair(void *param, char *lookup, char *value)
+{
+	struct compile_data *data = param;
+	struct compile_pair *pair = da_push_back_new(data->pairs);
+
+	pair->lookup = lookup;
+	pair->value = value;
+	pair->order = data->pairs.num - 1;
+}
+
+static int compare_pairs(const void *val1, const void *val2)
+{
+	const struct compile_pair *pair1 = val1;
+	const struct compile_pair *pair2 = val2;
+	int cmp = astrcmpi(pair1->lookup, pair2->lookup);
+
+	if (cmp != 0)
+		return cmp;
+	return pair1->order < pair2->order ? -1 : 1;
+}
+
+static int compare_buckets(const void *val1, const void *val2)
+{
+	const struct compile_bucket *bucket1 = val1;
+	const struct compile_bucket *bucket2 = val2;
+
+	if (bucket1->pairs.num != bucket2->pairs.num)
+		return bucket1->pairs.num > bucket2->pairs.num ? -1 : 1;
+	return bucket1->idx < bucket2->idx ? -1 : 1;
+}
+
+/* finds a seed for every bucket, largest buckets first, such that all of the
+ * bucket's keys land in distinct free slots */
+static bool compile_place(struct compile_bucket *buckets, size_t num_buckets,
+			  uint32_t *seeds, struct compile_pair **slots,
+			  uint32_t num_slots)
+{
+	DARRAY(uint32_t) taken = {0};
+	bool success = true;
+
+	for (size_t i = 0; i < num_buckets; i++) {
+		struct compile_bucket *bucket = &buckets[i];
+		uint32_t seed;
+
+		if (!bucket->pairs.num)
+			break;
+
+		for (seed = 1; seed < TEXT_TABLE_MAX_SEED_TRIES; seed++) {
+			bool fits = true;
+
+			da_resize(taken, 0);
+
+			for (size_t j = 0; j < bucket->pairs.num; j++) {
+				struct compile_pair *pair =
+					bucket->pairs.array[j];
+				uint32_t slot =
+					text_table_hash(pair->lookup, seed) %
+					num_slots;
+
+				if (slots[slot] || da_find(taken, &slot, 0) !=
+							   DARRAY_INVALID) {
+					fits = false;
+					break;
+				}
+
+				da_push_back(taken, &slot);
+			}
+
+			if (fits)
+				break;
+		}
+
+		if (seed == TEXT_TABLE_MAX_SEED_TRIES) {
+			success = false;
+			break;
+		}
+
+		for (size_t j = 0; j < bucket->pairs.num; j++)
+			slots[taken.array[j]] = bucket->pairs.array[j];
+		seeds[bucket->idx] = seed;
+	}
+
+	da_free(taken);
+	return success;
+}
+
+static bool compile_write(const char *out_path, struct compile_pair *pairs,
+			  size_t num_pairs)
+{
+	struct text_table_header header = {0};
+	struct compile_bucket *buckets;
+	struct compile_pair **slots;
+	struct text_table_entry *entries;
+	uint32_t *seeds;
+	DARRAY(char) strings = {0};
+	uint32_t num_slots = (uint32_t)(num_pairs ? num_pairs : 1);
+	uint32_t num_buckets;
+	bool success = false;
+	FILE *f;
+
+	num_buckets = (uint32_t)((num_pairs + TEXT_TABLE_BUCKET_SIZE - 1) /
+				 TEXT_TABLE_BUCKET_SIZE);
+	if (!num_buckets)
+		num_buckets = 1;
+
+	buckets = bzalloc(sizeof(struct compile_bucket) * num_buckets);
+	seeds = bzalloc(sizeof(uint32_t) * num_buckets);
+
+	for (uint32_t i = 0; i < num_buckets; i++)
+		buckets[i].idx = i;
+	for (size_t i = 0; i < num_pairs; i++) {
+		struct compile_pair *pair = &pairs[i];
+		uint32_t idx = text_table_hash(pair->lookup, 0) % num_buckets;
+
+		da_push_back(buckets[idx].pairs, &pair);
+	}
+
+	qsort(buckets, num_buckets, sizeof(struct compile_bucket),
+	      compare_buckets);
+
+	/* very unlikely, but if no seed fits, retry with some spare slots */
+	for (;;) {
+		slots = bzalloc(sizeof(struct compile_pair *) * num_slots);
+		memset(seeds, 0, sizeof(uint32_t) * num_buckets);
+
+		if (compile_place(buckets, num_buckets, seeds, slots,
+				  num_slots))
+			break;
+
+		bfree(slots);
+		num_slots += num_slots / 8 + 1;
+	}
+
+	/* offset 0 is the empty string used by unused slots */
+	da_push_back_array(strings, "", 1);
+	entries = bzalloc(sizeof(struct text_table_entry) * num_slots);
+
+	for (uint32_t i = 0; i < num_slots; i++) {
+		struct compile_pair *pair = slots[i];
+		if (!pair)
+			continue;
+
+		entries[i].lookup = (uint32_t)strings.num;
+		da_push_back_array(strings, pair->lookup,
+				   strlen(pair->lookup) + 1);
+		entries[i].value = (uint32_t)strings.num;
+		da_push_back_array(strings, pair->value,
+				   strlen(pair->value) + 1);
+	}
+
+	header.magic = TEXT_TABLE_MAGIC;
+	header.version = TEXT_TABLE_VERSION;
+	header.num_entries = (uint32_t)num_pairs;
+	header.num_slots = num_slots;
+	header.num_buckets = num_buckets;
+	header.strings_size = (uint32_t)strings.num;
+
+	f = os_fopen(out_path, "wb");
+	if (f) {
+		success = fwrite(&header, sizeof(header), 1, f) == 1 &&
+			  fwrite(seeds, sizeof(uint32_t), num_buckets, f) ==
+				  num_buckets &&
+			  fwrite(entries, sizeof(struct text_table_entry),
+				 num_slots, f) == num_slots &&
+			  fwrite(strings.array, 1, strings.num, f) ==
+				  strings.num;
+		fclose(f);
+	}
+
+	for (uint32_t i = 0; i < num_buckets; i++)
+		da_free(buckets[i].pairs);
+	bfree(buckets);
+	bfree(seeds);
+	bfree(slots);
+	bfree(entries);
+	da_free(strings);
+	return success;
+}
+
+static void get_compiled_path(struct dstr *out, const char *path)
+{
+	size_t len = strlen(path);
+
+	dstr_copy(out, path);
+	if (len > 4 && astrcmpi(path + len - 4, ".ini") == 0)
+		dstr_resize(out, len - 4);
+	dstr_cat(out, TEXT_TABLE_EXT);
+}
+
+bool text_lookup_compile(const char *path, const char *out_path)
+{
+	struct compile_data data = {0};
+	struct dstr compiled_path = {0};
+	char *file_data;
+	size_t num = 0;
+	bool success;
+
+	file_data = lookup_readfile(path);
+	if (!file_data)
+		return false;
+
+	lookup_parsefiledata(file_data, compile_addpair, &data);
+	bfree(file_data);
+
+	/* sort case-insensitively, and where a key is repeated keep only the
+	 * last value, the same as the radix tree replacing its leaf */
+	qsort(data.pairs.array, data.pairs.num, sizeof(struct compile_pair),
+	      compare_pairs);
+
+	for (size_t i = 0; i < data.pairs.num; i++) {
+		struct compile_pair *pair = &data.pairs.array[i];
+		struct compile_pair *next = pair + 1;
+
+		if (i + 1 < data.pairs.num &&
+		    astrcmpi(pair->lookup, next->lookup) == 0) {
+			bfree(pair->lookup);
+			bfree(pair->value);
+			continue;
+		}
+
+		data.pairs.array[num++] = *pair;
+	}
+
+	if (!out_path) {
+		get_compiled_path(&compiled_path, path);
+		out_path = compiled_path.array;
+	}
+
+	success = compile_write(out_path, data.pairs.array, num);
+	if (!success)
+		blog(LOG_WARNING, "text_lookup_compile: failed to write '%s'",
+		     out_path);
+
+	for (size_t i = 0; i < num; i++) {
+		bfree(data.pairs.array[i].lookup);
+		bfree(data.pairs.array[i].value);
+	}
+	da_free(data.pairs);
+	dstr_free(&compiled_path);
+	return success;
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* each text_lookup_add call adds a layer, and later layers take precedence.
+ * consecutive .ini files are merged into the same radix tree */
+struct text_layer {
+	struct text_node *top;
+	struct text_table table;
+};
+
+struct text_lookup {
+	DARRAY(struct text_layer) layers;
+};
+
+static bool compiled_table_usable(const char *path, const char *table_path)
+{
+	struct stat ini_stats;
+	struct stat table_stats;
+
+	if (os_stat(table_path, &table_stats) != 0)
+		return false;
+
+	/* don't use a table that is older than the file it was built from */
+	if (os_stat(path, &ini_stats) == 0 &&
+	    ini_stats.st_mtime > table_stats.st_mtime)
+		return false;
+
+	return true;
+}
+
+static bool text_lookup_add_table(lookup_t *lookup, const char *path)
+{
+	struct dstr table_path = {0};
+	struct text_table table = {0};
+	bool success = false;
+
+	get_compiled_path(&table_path, path);
+
+	if (compiled_table_usable(path, table_path.array) &&
+	    text_table_load(&table, table_path.array)) {
+		struct text_layer *layer = da_push_back_new(lookup->layers);
+		layer->table = table;
+		success = true;
+	}
+
+	dstr_free(&table_path);
+	return success;
+}
 
 lookup_t *text_lookup_create(const char *path)
 {
@@ -373,27 +847,28 @@ lookup_t *text_lookup_create(const char *path)
 
 bool text_lookup_add(lookup_t *lookup, const char *path)
 {
-	struct dstr file_str;
-	char *temp = NULL;
-	FILE *file;
+	struct text_layer *layer = NULL;
+	char *file_data;
 
-	file = os_fopen(path, "rb");
-	if (!file)
+	if (!path)
 		return false;
 
-	os_fread_utf8(file, &temp);
-	dstr_init_move_array(&file_str, temp);
-	fclose(file);
+	if (text_lookup_add_table(lookup, path))
+		return true;
 
-	if (!file_str.array)
+	file_data = lookup_readfile(path);
+	if (!file_data)
 		return false;
 
-	if (!lookup->top)
-		lookup->top = bzalloc(sizeof(struct text_node));
+	if (lookup->layers.num)
+		layer = da_end(lookup->layers);
+	if (!layer || !layer->top) {
+		layer = da_push_back_new(lookup->layers);
+		layer->top = bzalloc(sizeof(struct text_node));
+	}
 
-	dstr_replace(&file_str, "\r", " ");
-	lookup_addfiledata(lookup, file_str.array);
-	dstr_free(&file_str);
+	lookup_parsefiledata(file_data, lookup_addleaf, layer->top);
+	bfree(file_data);
 
 	return true;
 }
@@ -401,9 +876,14 @@ bool text_lookup_add(lookup_t *lookup, const char *path)
 void text_lookup_destroy(lookup_t *lookup)
 {
 	if (lookup) {
-		dstr_free(&lookup->language);
-		text_node_destroy(lookup->top);
+		for (size_t i = 0; i < lookup->layers.num; i++) {
+			struct text_layer *layer = &lookup->layers.array[i];
+
+			text_node_destroy(layer->top);
+			os_mapped_file_close(layer->table.file);
+		}
 
+		da_free(lookup->layers);
 		bfree(lookup);
 	}
 }
@@ -411,7 +891,19 @@ void text_lookup_destroy(lookup_t *lookup)
 bool text_lookup_getstr(lookup_t *lookup, const char *lookup_val,
 			const char **out)
 {
-	if (lookup)
-		return lookup_getstring(lookup_val, out, lookup->top);
+	if (!lookup || !lookup_val)
+		return false;
+
+	for (size_t i = lookup->layers.num; i > 0; i--) {
+		struct text_layer *layer = &lookup->layers.array[i - 1];
+
+		if (layer->top) {
+			if (lookup_getstring(lookup_val, out, layer->top))
+				return true;
+		} else if (text_table_getstr(&layer->table, lookup_val, out)) {
+			return true;
+		}
+	}
+
 	return false;
 }
@@ -21,7 +21,8 @@
  *
  *   Used for storing and looking up localized strings.  Stores localization
  * strings in a radix/trie tree to efficiently look up associated strings via a
- * unique string identifier name.
+ * unique string identifier name, or memory maps a precompiled perfect hash
+ * table of them if one is available (see text_lookup_compile).
  */
 
 #include "c99defs.h"
@@ -41,6 +42,17 @@ EXPORT void text_lookup_destroy(lookup_t *lookup);
 EXPORT bool text_lookup_getstr(lookup_t *lookup, const char *lookup_val,
 			       const char **out);
 
+/*
+ * Compiles a locale .ini file into a table that text_lookup_add memory maps
+ * directly instead of parsing the .ini.  If out_path is NULL, the table is
+ * written next to the .ini with the .locale extension (en-US.ini ->
+ * en-US.locale), which is where text_lookup_add looks for it.  Tables older
+ * than their .ini file are ignored, and the .ini is parsed instead.
+ *
+ * obs-locale-compiler runs this on all installed locale files.
+ */
+EXPORT bool text_lookup_compile(const char *path, const char *out_path);
+
 #ifdef __cplusplus
 }
 #endif
@@ -78,6 +78,68 @@ EXPORT int os_sem_wait(os_sem_t *sem);
 
 EXPORT void os_set_thread_name(const char *name);
 
+/* ------------------------------------------------------------------------- */
+/* work-stealing task scheduler */
+
+enum os_task_priority {
+	OS_TASK_PRIORITY_LOW,
+	OS_TASK_PRIORITY_NORMAL,
+	OS_TASK_PRIORITY_HIGH,
+	OS_TASK_PRIORITY_COUNT,
+};
+
+struct os_task_scheduler_stats {
+	uint64_t tasks_executed;
+	uint64_t tasks_stolen;
+	uint64_t tasks_pending;
+	uint64_t avg_queue_latency_ns;
+	uint64_t max_queue_latency_ns;
+};
+
+struct os_task_scheduler;
+typedef struct os_task_scheduler os_task_scheduler_t;
+
+typedef void (*os_task_t)(void *param);
+typedef void (*os_parallel_for_t)(void *param, size_t start, size_t end);
+
+/** Creates a scheduler with the given number of worker threads, or one less
+ * than the number of logical cores if zero */
+EXPORT os_task_scheduler_t *os_task_scheduler_create(size_t num_threads);
+
+/** Stops the worker threads.  Tasks still queued are run before returning */
+EXPORT void os_task_scheduler_destroy(os_task_scheduler_t *ts);
+
+EXPORT size_t os_task_scheduler_num_threads(const os_task_scheduler_t *ts);
+
+/**
+ * Queues a task.  Higher priority tasks are always picked up first.
+ *
+ * affinity is a hint for the worker that should run the task (tasks that
+ * touch the same data run best on the same worker), or -1 for any worker.
+ * Idle workers may still steal the task from the hinted worker.
+ */
+EXPORT bool os_task_scheduler_queue(os_task_scheduler_t *ts, os_task_t task,
+				    void *param,
+				    enum os_task_priority priority,
+				    int affinity);
+
+/** Waits until all queued tasks have run, helping to run them meanwhile */
+EXPORT void os_task_scheduler_wait(os_task_scheduler_t *ts);
+
+/**
+ * Splits [0, count) into chunks of "grain" elements (or an automatic size if
+ * zero) and calls func for each of them across the worker threads and the
+ * calling thread.  Returns once every chunk has been processed.  While
+ * waiting, the calling thread only works on chunks of this call.
+ */
+EXPORT void os_task_scheduler_parallel_for(os_task_scheduler_t *ts,
+					   size_t count, size_t grain,
+					   os_parallel_for_t func,
+					   void *param);
+
+EXPORT void os_task_scheduler_get_stats(os_task_scheduler_t *ts,
+					struct os_task_scheduler_stats *stats);
+
 #ifdef _MSC_VER
 #define THREAD_LOCAL __declspec(thread)
 #else
@@ -23,6 +23,10 @@ struct image_source {
 	uint64_t last_time;
 	bool active;
 
+	/* still images are shared through the image cache, animated images
+	 * are loaded by every source separately */
+	obs_cached_image_t *image;
+	obs_cached_image_t *pending_image;
 	gs_image_file3_t if3;
 };
 
@@ -40,37 +44,114 @@ static const char *image_source_get_name(void *unused)
 	return obs_module_text("ImageInput");
 }
 
-static void image_source_load(struct image_source *context)
+static inline enum gs_image_alpha_mode
+get_alpha_mode(const struct image_source *context)
 {
-	char *file = context->file;
+	return context->linear_alpha ? GS_IMAGE_ALPHA_PREMULTIPLY_SRGB
+				     : GS_IMAGE_ALPHA_PREMULTIPLY;
+}
+
+static void image_source_free(struct image_source *context)
+{
+	obs_cached_image_release(context->pending_image);
+	obs_cached_image_release(context->image);
+	context->pending_image = NULL;
+	context->image = NULL;
 
 	obs_enter_graphics();
 	gs_image_file3_free(&context->if3);
 	obs_leave_graphics();
+}
 
-	if (file && *file) {
-		debug("loading texture '%s'", file);
-		context->file_timestamp = get_modified_timestamp(file);
-		gs_image_file3_init(&context->if3, file,
-				    context->linear_alpha
-					    ? GS_IMAGE_ALPHA_PREMULTIPLY_SRGB
-					    : GS_IMAGE_ALPHA_PREMULTIPLY);
-		context->update_time_elapsed = 0;
+/* replaces the current image once the pending one has been decoded */
+static void image_source_check_pending(struct image_source *context, bool wait)
+{
+	obs_cached_image_t *image = context->pending_image;
+	gs_image_file3_t if3;
+	bool animated;
+	bool loaded;
+
+	if (!image || obs_cached_image_pending(image))
+		return;
+
+	/* another source took the decoded animation first, so it is decoded
+	 * again (in the background unless waiting) and the current image stays
+	 * up until then */
+	animated = obs_cached_image_animated(image);
+	if (animated && !obs_cached_image_take_animated(image, &if3)) {
+		obs_cached_image_release(image);
+		context->pending_image = obs_image_cache_acquire(
+			context->file, get_alpha_mode(context), wait);
+
+		if (wait)
+			image_source_check_pending(context, wait);
+		return;
+	}
+
+	context->pending_image = NULL;
+	obs_cached_image_release(context->image);
+	context->image = NULL;
+
+	obs_enter_graphics();
+	gs_image_file3_free(&context->if3);
+	obs_leave_graphics();
+
+	if (animated) {
+		context->if3 = if3;
+		obs_cached_image_release(image);
 
 		obs_enter_graphics();
 		gs_image_file3_init_texture(&context->if3);
 		obs_leave_graphics();
 
-		if (!context->if3.image2.image.loaded)
-			warn("failed to load texture '%s'", file);
+		loaded = context->if3.image2.image.loaded;
+	} else {
+		context->image = image;
+		loaded = obs_cached_image_loaded(image);
+	}
+
+	if (!loaded)
+		warn("failed to load texture '%s'", context->file);
+
+	obs_source_invalidate_video(context->source);
+}
+
+/* loads the image right away if wait is true, otherwise it is decoded in the
+ * background (unless it is already cached) and shown once it is ready */
+static void image_source_load(struct image_source *context, bool wait)
+{
+	char *file = context->file;
+
+	image_source_free(context);
+
+	if (file && *file) {
+		debug("loading texture '%s'", file);
+		context->file_timestamp = get_modified_timestamp(file);
+		context->pending_image = obs_image_cache_acquire(
+			file, get_alpha_mode(context), wait);
+		context->update_time_elapsed = 0;
+
+		image_source_check_pending(context, wait);
 	}
+
+	obs_source_invalidate_video(context->source);
+}
+
+/* keeps showing the current image while the changed file is decoded */
+static void image_source_reload(struct image_source *context)
+{
+	obs_cached_image_release(context->pending_image);
+
+	context->file_timestamp = get_modified_timestamp(context->file);
+	context->pending_image = obs_image_cache_acquire(
+		context->file, get_alpha_mode(context), false);
 }
 
 static void image_source_unload(struct image_source *context)
 {
-	obs_enter_graphics();
-	gs_image_file3_free(&context->if3);
-	obs_leave_graphics();
+	image_source_free(context);
+
+	obs_source_invalidate_video(context->source);
 }
 
 static void image_source_update(void *data, obs_data_t *settings)
@@ -88,7 +169,7 @@ static void image_source_update(void *data, obs_data_t *settings)
 
 	/* Load the image if the source is persistent or showing */
 	if (context->persistent || obs_source_showing(context->source))
-		image_source_load(data);
+		image_source_load(data, true);
 	else
 		image_source_unload(data);
 }
@@ -104,7 +185,7 @@ static void image_source_show(void *data)
 	struct image_source *context = data;
 
 	if (!context->persistent)
-		image_source_load(context);
+		image_source_load(context, false);
 }
 
 static void image_source_hide(void *data)
@@ -138,20 +219,32 @@ static void image_source_destroy(void *data)
 static uint32_t image_source_getwidth(void *data)
 {
 	struct image_source *context = data;
+
+	if (context->image)
+		return obs_cached_image_get_width(context->image);
 	return context->if3.image2.image.cx;
 }
 
 static uint32_t image_source_getheight(void *data)
 {
 	struct image_source *context = data;
+
+	if (context->image)
+		return obs_cached_image_get_height(context->image);
 	return context->if3.image2.image.cy;
 }
 
 static void image_source_render(void *data, gs_effect_t *effect)
 {
 	struct image_source *context = data;
+	gs_texture_t *texture = context->if3.image2.image.texture;
+	gs_atlas_region_t *region = NULL;
 
-	if (!context->if3.image2.image.texture)
+	if (context->image) {
+		texture = obs_cached_image_get_texture(context->image);
+		region = obs_cached_image_get_atlas_region(context->image);
+	}
+	if (!texture)
 		return;
 
 	const bool previous = gs_framebuffer_srgb_enabled();
@@ -161,11 +254,13 @@ static void image_source_render(void *data, gs_effect_t *effect)
 	gs_blend_function(GS_BLEND_ONE, GS_BLEND_INVSRCALPHA);
 
 	gs_eparam_t *const param = gs_effect_get_param_by_name(effect, "image");
-	gs_effect_set_texture_srgb(param, context->if3.image2.image.texture);
+	gs_effect_set_texture_srgb(param, texture);
 
-	gs_draw_sprite(context->if3.image2.image.texture, 0,
-		       context->if3.image2.image.cx,
-		       context->if3.image2.image.cy);
+	if (region)
+		gs_draw_atlas_region(region, 0);
+	else
+		gs_draw_sprite(texture, 0, image_source_getwidth(context),
+			       image_source_getheight(context));
 
 	gs_blend_state_pop();
 
@@ -179,13 +274,15 @@ static void image_source_tick(void *data, float seconds)
 
 	context->update_time_elapsed += seconds;
 
+	image_source_check_pending(context, false);
+
 	if (obs_source_showing(context->source)) {
 		if (context->update_time_elapsed >= 1.0f) {
 			time_t t = get_modified_timestamp(context->file);
 			context->update_time_elapsed = 0.0f;
 
 			if (context->file_timestamp != t) {
-				image_source_load(context);
+				image_source_reload(context);
 			}
 		}
 	}
@@ -207,6 +304,8 @@ static void image_source_tick(void *data, float seconds)
 				obs_enter_graphics();
 				gs_image_file3_update_texture(&context->if3);
 				obs_leave_graphics();
+
+				obs_source_invalidate_video(context->source);
 			}
 
 			context->active = false;
@@ -223,6 +322,8 @@ static void image_source_tick(void *data, float seconds)
 			obs_enter_graphics();
 			gs_image_file3_update_texture(&context->if3);
 			obs_leave_graphics();
+
+			obs_source_invalidate_video(context->source);
 		}
 	}
 
@@ -271,6 +372,9 @@ static obs_properties_t *image_source_properties(void *data)
 uint64_t image_source_get_memory_usage(void *data)
 {
 	struct image_source *s = data;
+
+	if (s->image)
+		return obs_cached_image_get_memory_usage(s->image);
 	return s->if3.image2.mem_usage;
 }
 
@@ -308,7 +412,8 @@ static obs_missing_files_t *image_source_missingfiles(void *data)
 static struct obs_source_info image_source_info = {
 	.id = "image_source",
 	.type = OBS_SOURCE_TYPE_INPUT,
-	.output_flags = OBS_SOURCE_VIDEO | OBS_SOURCE_SRGB,
+	.output_flags = OBS_SOURCE_VIDEO | OBS_SOURCE_SRGB |
+			OBS_SOURCE_STATIC_VIDEO,
 	.get_name = image_source_get_name,
 	.create = image_source_create,
 	.destroy = image_source_destroy,
@@ -37,6 +37,8 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "v4l2-controls.h"
 #include "v4l2-helpers.h"
+#include "v4l2-mjpeg.h"
+#include "v4l2-userptr.h"
 
 #if HAVE_UDEV
 #include "v4l2-udev.h"
@@ -62,6 +64,11 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #define blog(level, msg, ...) blog(level, "v4l2-input: " msg, ##__VA_ARGS__)
 
+enum v4l2_buffer_mode {
+	BUFFER_MODE_MMAP,
+	BUFFER_MODE_USERPTR,
+};
+
 /**
  * Data structure for the v4l2 source
  */
@@ -75,6 +82,8 @@ struct v4l2_data {
 	int resolution;
 	int framerate;
 	int color_range;
+	int buffer_mode;
+	int buffer_count;
 
 	/* internal data */
 	obs_source_t *source;
@@ -88,6 +97,8 @@ struct v4l2_data {
 	int height;
 	int linesize;
 	struct v4l2_buffer_data buffers;
+	struct v4l2_mjpeg_pool *mjpeg;
+	struct v4l2_userptr_pool *userptr;
 
 	bool auto_reset;
 	int timeout_frames;
@@ -149,6 +160,17 @@ static void v4l2_prep_obs_frame(struct v4l2_data *data,
 	}
 }
 
+/** Restart the stream with the buffers the source uses */
+static int_fast32_t v4l2_reset_stream(struct v4l2_data *data)
+{
+	if (!data->userptr)
+		return v4l2_reset_capture(data->dev, &data->buffers);
+
+	if (v4l2_userptr_pool_stop(data->userptr) < 0)
+		return -1;
+	return v4l2_userptr_pool_start(data->userptr);
+}
+
 /*
  * Worker thread to get video data
  */
@@ -180,8 +202,19 @@ static void *v4l2_thread(void *vptr)
 	blog(LOG_INFO, "%s: select timeout set to %ldus (%dx frame periods)",
 	     data->device_id, timeout_usec, data->timeout_frames);
 
-	if (v4l2_start_capture(data->dev, &data->buffers) < 0)
+	if (data->pixfmt == V4L2_PIX_FMT_MJPEG) {
+		data->mjpeg = v4l2_mjpeg_pool_create(data->source,
+						     data->color_range, 0);
+		if (!data->mjpeg)
+			goto exit;
+	}
+
+	if (data->userptr) {
+		if (v4l2_userptr_pool_start(data->userptr) < 0)
+			goto exit;
+	} else if (v4l2_start_capture(data->dev, &data->buffers) < 0) {
 		goto exit;
+	}
 
 	blog(LOG_DEBUG, "%s: new capture started", data->device_id);
 
@@ -219,8 +252,7 @@ static void *v4l2_thread(void *vptr)
 			}
 
 			if (data->auto_reset) {
-				if (v4l2_reset_capture(data->dev,
-						       &data->buffers) == 0)
+				if (v4l2_reset_stream(data) == 0)
 					blog(LOG_INFO,
 					     "%s: stream reset successful",
 					     data->device_id);
@@ -232,8 +264,10 @@ static void *v4l2_thread(void *vptr)
 			continue;
 		}
 
+		memset(&buf, 0, sizeof(buf));
 		buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-		buf.memory = V4L2_MEMORY_MMAP;
+		buf.memory = data->userptr ? V4L2_MEMORY_USERPTR
+					   : V4L2_MEMORY_MMAP;
 
 		if (v4l2_ioctl(data->dev, VIDIOC_DQBUF, &buf) < 0) {
 			if (errno == EAGAIN) {
@@ -256,10 +290,39 @@ static void *v4l2_thread(void *vptr)
 			first_ts = out.timestamp;
 		out.timestamp -= first_ts;
 
+		if (data->userptr) {
+			start = v4l2_userptr_pool_get(data->userptr, &buf);
+			if (data->mjpeg) {
+				v4l2_mjpeg_pool_submit(data->mjpeg, start,
+						       buf.bytesused,
+						       out.timestamp);
+				if (v4l2_userptr_pool_requeue(data->userptr,
+							      &buf) < 0)
+					break;
+			} else {
+				/* requeued once the source released it */
+				for (uint_fast32_t i = 0; i < MAX_AV_PLANES;
+				     ++i)
+					out.data[i] = start + plane_offsets[i];
+				if (v4l2_userptr_pool_output(data->userptr,
+							     data->source, &out,
+							     &buf) < 0)
+					break;
+			}
+
+			frames++;
+			continue;
+		}
+
 		start = (uint8_t *)data->buffers.info[buf.index].start;
-		for (uint_fast32_t i = 0; i < MAX_AV_PLANES; ++i)
-			out.data[i] = start + plane_offsets[i];
-		obs_source_output_video(data->source, &out);
+		if (data->mjpeg) {
+			v4l2_mjpeg_pool_submit(data->mjpeg, start,
+					       buf.bytesused, out.timestamp);
+		} else {
+			for (uint_fast32_t i = 0; i < MAX_AV_PLANES; ++i)
+				out.data[i] = start + plane_offsets[i];
+			obs_source_output_video(data->source, &out);
+		}
 
 		if (v4l2_ioctl(data->dev, VIDIOC_QBUF, &buf) < 0) {
 			blog(LOG_ERROR, "%s: failed to enqueue buffer",
@@ -274,7 +337,12 @@ static void *v4l2_thread(void *vptr)
 	     data->device_id, frames);
 
 exit:
-	v4l2_stop_capture(data->dev);
+	if (data->userptr)
+		v4l2_userptr_pool_stop(data->userptr);
+	else
+		v4l2_stop_capture(data->dev);
+	v4l2_mjpeg_pool_destroy(data->mjpeg);
+	data->mjpeg = NULL;
 	return NULL;
 }
 
@@ -296,6 +364,8 @@ static void v4l2_defaults(obs_data_t *settings)
 	obs_data_set_default_bool(settings, "buffering", true);
 	obs_data_set_default_bool(settings, "auto_reset", false);
 	obs_data_set_default_int(settings, "timeout_frames", 5);
+	obs_data_set_default_int(settings, "buffer_mode", BUFFER_MODE_MMAP);
+	obs_data_set_default_int(settings, "buffer_count", 4);
 }
 
 /**
@@ -456,8 +526,10 @@ static void v4l2_format_list(int dev, obs_property_t *prop)
 		if (fmt.flags & V4L2_FMT_FLAG_EMULATED)
 			dstr_cat(&buffer, " (Emulated)");
 
+		/* MJPEG is decoded by the plugin */
 		if (v4l2_to_obs_video_format(fmt.pixelformat) !=
-		    VIDEO_FORMAT_NONE) {
+			    VIDEO_FORMAT_NONE ||
+		    fmt.pixelformat == V4L2_PIX_FMT_MJPEG) {
 			obs_property_list_add_int(prop, buffer.array,
 						  fmt.pixelformat);
 			blog(LOG_INFO, "Pixelformat: %s (available)",
@@ -862,6 +934,19 @@ static obs_properties_t *v4l2_properties(void *vptr)
 			       obs_module_text("FramesUntilTimeout"), 2, 120,
 			       1);
 
+	obs_property_t *buffer_mode_list = obs_properties_add_list(
+		props, "buffer_mode", obs_module_text("BufferMode"),
+		OBS_COMBO_TYPE_LIST, OBS_COMBO_FORMAT_INT);
+	obs_property_list_add_int(buffer_mode_list,
+				  obs_module_text("BufferMode.MMAP"),
+				  BUFFER_MODE_MMAP);
+	obs_property_list_add_int(buffer_mode_list,
+				  obs_module_text("BufferMode.UserPtr"),
+				  BUFFER_MODE_USERPTR);
+
+	obs_properties_add_int(props, "buffer_count",
+			       obs_module_text("BufferCount"), 2, 32, 1);
+
 	// a group to contain the camera control
 	obs_properties_t *ctrl_props = obs_properties_create();
 	obs_properties_add_group(props, "controls",
@@ -891,6 +976,8 @@ static void v4l2_terminate(struct v4l2_data *data)
 	}
 
 	v4l2_destroy_mmap(&data->buffers);
+	v4l2_userptr_pool_destroy(data->userptr);
+	data->userptr = NULL;
 
 	if (data->dev != -1) {
 		v4l2_close(data->dev);
@@ -929,7 +1016,7 @@ static void v4l2_destroy(void *vptr)
  * - tries to open the device
  * - sets pixelformat and requested resolution
  * - sets the requested framerate
- * - maps the buffers
+ * - allocates or maps the buffers
  * - starts the capture thread
  */
 static void v4l2_init(struct v4l2_data *data)
@@ -980,7 +1067,8 @@ static void v4l2_init(struct v4l2_data *data)
 		blog(LOG_ERROR, "Unable to set format");
 		goto fail;
 	}
-	if (v4l2_to_obs_video_format(data->pixfmt) == VIDEO_FORMAT_NONE) {
+	if (v4l2_to_obs_video_format(data->pixfmt) == VIDEO_FORMAT_NONE &&
+	    data->pixfmt != V4L2_PIX_FMT_MJPEG) {
 		blog(LOG_ERROR, "Selected video format not supported");
 		goto fail;
 	}
@@ -997,11 +1085,18 @@ static void v4l2_init(struct v4l2_data *data)
 	v4l2_unpack_tuple(&fps_num, &fps_denom, data->framerate);
 	blog(LOG_INFO, "Framerate: %.2f fps", (float)fps_denom / fps_num);
 
-	/* map buffers */
-	if (v4l2_create_mmap(data->dev, &data->buffers) < 0) {
+	/* allocate user pointer buffers, map buffers if not supported */
+	if (data->buffer_mode == BUFFER_MODE_USERPTR)
+		data->userptr = v4l2_userptr_pool_create(
+			data->dev, (uint32_t)data->buffer_count);
+	if (!data->userptr &&
+	    v4l2_create_mmap(data->dev, &data->buffers,
+			     (uint32_t)data->buffer_count) < 0) {
 		blog(LOG_ERROR, "Failed to map buffers");
 		goto fail;
 	}
+	blog(LOG_INFO, "Buffers: %s",
+	     data->userptr ? "user pointer" : "memory mapped");
 
 	/* start the capture thread */
 	if (os_event_init(&data->event, OS_EVENT_TYPE_MANUAL) != 0)
@@ -1071,6 +1166,10 @@ static bool v4l2_settings_changed(struct v4l2_data *data, obs_data_t *settings)
 
 		res |= data->color_range !=
 		       obs_data_get_int(settings, "color_range");
+		res |= data->buffer_mode !=
+		       obs_data_get_int(settings, "buffer_mode");
+		res |= data->buffer_count !=
+		       obs_data_get_int(settings, "buffer_count");
 	} else {
 		res = true;
 	}
@@ -1108,6 +1207,8 @@ static void v4l2_update(void *vptr, obs_data_t *settings)
 	data->color_range = obs_data_get_int(settings, "color_range");
 	data->auto_reset = obs_data_get_bool(settings, "auto_reset");
 	data->timeout_frames = obs_data_get_int(settings, "timeout_frames");
+	data->buffer_mode = obs_data_get_int(settings, "buffer_mode");
+	data->buffer_count = obs_data_get_int(settings, "buffer_count");
 
 	v4l2_update_source_flags(data, settings);
 
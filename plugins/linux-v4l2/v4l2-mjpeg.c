@@ -0,0 +1,359 @@
+/*
+Copyright (C) 2021 by Hugh Bailey <obs.jim@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <inttypes.h>
+
+#include <util/threading.h>
+#include <util/platform.h>
+#include <util/bmem.h>
+
+#include <libavcodec/avcodec.h>
+
+#include "v4l2-mjpeg.h"
+
+#define blog(level, msg, ...) blog(level, "v4l2-input: " msg, ##__VA_ARGS__)
+
+#define MJPEG_MAX_WORKERS 4
+
+/*
+ * Every worker has its own decoder and decodes one frame at a time.  Frames
+ * are handed to the workers round-robin, and a worker only outputs its frame
+ * once it got the turn from the worker before it, which keeps the frames in
+ * order.  When the next worker is still busy the decoders are behind the
+ * device and the frame is dropped.
+ */
+struct mjpeg_worker {
+	struct v4l2_mjpeg_pool *pool;
+	struct mjpeg_worker *next;
+
+	pthread_t thread;
+	bool thread_valid;
+	os_sem_t *job;
+	os_sem_t *turn;
+	volatile bool busy;
+
+	AVCodecContext *context;
+	AVFrame *frame;
+
+	uint8_t *data;
+	size_t size;
+	size_t capacity;
+	uint64_t timestamp;
+	uint64_t submit_ns;
+};
+
+struct v4l2_mjpeg_pool {
+	obs_source_t *source;
+	enum video_range_type range;
+	volatile bool stop;
+
+	struct mjpeg_worker workers[MJPEG_MAX_WORKERS];
+	size_t num_workers;
+	size_t next_worker;
+
+	/* only touched by the capture thread */
+	uint64_t submitted;
+	uint64_t dropped;
+
+	/* only touched by the worker that has the turn */
+	uint64_t decoded;
+	uint64_t failed;
+	uint64_t latency_ns;
+	uint64_t max_latency_ns;
+	bool format_warned;
+};
+
+static enum video_format mjpeg_video_format(int format)
+{
+	switch (format) {
+	case AV_PIX_FMT_YUVJ420P:
+	case AV_PIX_FMT_YUV420P:
+		return VIDEO_FORMAT_I420;
+	case AV_PIX_FMT_YUVJ422P:
+	case AV_PIX_FMT_YUV422P:
+		return VIDEO_FORMAT_I422;
+	case AV_PIX_FMT_YUVJ444P:
+	case AV_PIX_FMT_YUV444P:
+		return VIDEO_FORMAT_I444;
+	case AV_PIX_FMT_GRAY8:
+		return VIDEO_FORMAT_Y800;
+	default:
+		return VIDEO_FORMAT_NONE;
+	}
+}
+
+static bool mjpeg_decode(struct mjpeg_worker *w)
+{
+	AVPacket packet;
+	int ret;
+
+	av_init_packet(&packet);
+	packet.data = w->data;
+	packet.size = (int)w->size;
+
+	ret = avcodec_send_packet(w->context, &packet);
+	if (ret == 0)
+		ret = avcodec_receive_frame(w->context, w->frame);
+	return ret == 0;
+}
+
+/* outputs the decoded planes directly, the source copies them */
+static bool mjpeg_output(struct mjpeg_worker *w)
+{
+	struct v4l2_mjpeg_pool *pool = w->pool;
+	enum video_range_type range = pool->range;
+	struct obs_source_frame2 out = {0};
+	AVFrame *frame = w->frame;
+
+	out.format = mjpeg_video_format(frame->format);
+	if (out.format == VIDEO_FORMAT_NONE) {
+		if (!pool->format_warned) {
+			blog(LOG_WARNING, "MJPEG: unsupported pixel format %d",
+			     frame->format);
+			pool->format_warned = true;
+		}
+		return false;
+	}
+
+	for (size_t i = 0; i < MAX_AV_PLANES; i++) {
+		out.data[i] = frame->data[i];
+		out.linesize[i] = frame->linesize[i];
+	}
+
+	if (range == VIDEO_RANGE_DEFAULT) {
+		range = frame->color_range == AVCOL_RANGE_MPEG
+				? VIDEO_RANGE_PARTIAL
+				: VIDEO_RANGE_FULL;
+	}
+
+	video_format_get_parameters(VIDEO_CS_601, range, out.color_matrix,
+				    out.color_range_min, out.color_range_max);
+	out.range = range;
+	out.width = frame->width;
+	out.height = frame->height;
+	out.timestamp = w->timestamp;
+
+	obs_source_output_video2(pool->source, &out);
+	return true;
+}
+
+static void *mjpeg_worker_thread(void *param)
+{
+	struct mjpeg_worker *w = param;
+	struct v4l2_mjpeg_pool *pool = w->pool;
+
+	os_set_thread_name("v4l2: mjpeg decoder");
+
+	for (;;) {
+		bool decoded;
+		uint64_t latency;
+
+		os_sem_wait(w->job);
+		if (os_atomic_load_bool(&pool->stop))
+			break;
+
+		decoded = mjpeg_decode(w);
+
+		os_sem_wait(w->turn);
+		if (os_atomic_load_bool(&pool->stop))
+			break;
+
+		if (decoded && mjpeg_output(w)) {
+			latency = os_gettime_ns() - w->submit_ns;
+			pool->decoded++;
+			pool->latency_ns += latency;
+			if (latency > pool->max_latency_ns)
+				pool->max_latency_ns = latency;
+		} else {
+			pool->failed++;
+		}
+
+		os_atomic_set_bool(&w->busy, false);
+		os_sem_post(w->next->turn);
+	}
+
+	return NULL;
+}
+
+static bool mjpeg_worker_init(struct v4l2_mjpeg_pool *pool,
+			      struct mjpeg_worker *w, AVCodec *codec)
+{
+	w->pool = pool;
+
+	if (os_sem_init(&w->job, 0) != 0)
+		return false;
+	if (os_sem_init(&w->turn, w == pool->workers ? 1 : 0) != 0)
+		return false;
+
+	w->context = avcodec_alloc_context3(codec);
+	if (!w->context)
+		return false;
+
+	/* the pool decodes frames in parallel, not the decoder */
+	w->context->thread_count = 1;
+
+	if (avcodec_open2(w->context, codec, NULL) < 0)
+		return false;
+
+	w->frame = av_frame_alloc();
+	if (!w->frame)
+		return false;
+
+	w->thread_valid =
+		pthread_create(&w->thread, NULL, mjpeg_worker_thread, w) == 0;
+	return w->thread_valid;
+}
+
+static void mjpeg_worker_free(struct mjpeg_worker *w)
+{
+	if (w->thread_valid)
+		pthread_join(w->thread, NULL);
+
+	if (w->context)
+		avcodec_free_context(&w->context);
+	av_frame_free(&w->frame);
+	os_sem_destroy(w->job);
+	os_sem_destroy(w->turn);
+	bfree(w->data);
+}
+
+struct v4l2_mjpeg_pool *v4l2_mjpeg_pool_create(obs_source_t *source,
+					       enum video_range_type range,
+					       size_t threads)
+{
+	struct v4l2_mjpeg_pool *pool;
+	AVCodec *codec;
+
+#if LIBAVCODEC_VERSION_INT < AV_VERSION_INT(58, 9, 100)
+	avcodec_register_all();
+#endif
+
+	codec = avcodec_find_decoder(AV_CODEC_ID_MJPEG);
+	if (!codec) {
+		blog(LOG_ERROR, "MJPEG: decoder not found");
+		return NULL;
+	}
+
+	if (!threads) {
+		int cores = os_get_physical_cores();
+		threads = cores < 1 ? 1 : (size_t)cores;
+	}
+
+	pool = bzalloc(sizeof(struct v4l2_mjpeg_pool));
+	pool->source = source;
+	pool->range = range;
+	pool->num_workers = threads;
+	if (pool->num_workers > MJPEG_MAX_WORKERS)
+		pool->num_workers = MJPEG_MAX_WORKERS;
+
+	for (size_t i = 0; i < pool->num_workers; i++) {
+		struct mjpeg_worker *w = &pool->workers[i];
+
+		w->next = &pool->workers[(i + 1) % pool->num_workers];
+		if (!mjpeg_worker_init(pool, w, codec)) {
+			blog(LOG_ERROR, "MJPEG: failed to create decoder");
+			v4l2_mjpeg_pool_destroy(pool);
+			return NULL;
+		}
+	}
+
+	blog(LOG_INFO, "MJPEG: decoding on %zu threads", pool->num_workers);
+	return pool;
+}
+
+void v4l2_mjpeg_pool_destroy(struct v4l2_mjpeg_pool *pool)
+{
+	if (!pool)
+		return;
+
+	os_atomic_set_bool(&pool->stop, true);
+
+	for (size_t i = 0; i < pool->num_workers; i++) {
+		struct mjpeg_worker *w = &pool->workers[i];
+
+		if (w->job)
+			os_sem_post(w->job);
+		if (w->turn)
+			os_sem_post(w->turn);
+	}
+
+	for (size_t i = 0; i < pool->num_workers; i++)
+		mjpeg_worker_free(&pool->workers[i]);
+
+	if (pool->submitted) {
+		double avg = pool->decoded ? (double)pool->latency_ns /
+						     (double)pool->decoded
+					   : 0.0;
+
+		blog(LOG_INFO,
+		     "MJPEG: %" PRIu64 " frames decoded, %" PRIu64
+		     " dropped, %" PRIu64 " failed, "
+		     "latency %.2fms average, %.2fms max",
+		     pool->decoded, pool->dropped, pool->failed, avg / 1e6,
+		     (double)pool->max_latency_ns / 1e6);
+	}
+
+	bfree(pool);
+}
+
+bool v4l2_mjpeg_pool_submit(struct v4l2_mjpeg_pool *pool, const uint8_t *data,
+			    size_t size, uint64_t timestamp)
+{
+	struct mjpeg_worker *w = &pool->workers[pool->next_worker];
+	size_t capacity = size + AV_INPUT_BUFFER_PADDING_SIZE;
+
+	pool->submitted++;
+
+	/* the next worker has the oldest frame, so all of them are busy */
+	if (os_atomic_load_bool(&w->busy)) {
+		pool->dropped++;
+		return false;
+	}
+
+	if (w->capacity < capacity) {
+		w->data = brealloc(w->data, capacity);
+		w->capacity = capacity;
+	}
+
+	memcpy(w->data, data, size);
+	memset(w->data + size, 0, AV_INPUT_BUFFER_PADDING_SIZE);
+	w->size = size;
+	w->timestamp = timestamp;
+	w->submit_ns = os_gettime_ns();
+
+	os_atomic_set_bool(&w->busy, true);
+	os_sem_post(w->job);
+
+	pool->next_worker = (pool->next_worker + 1) % pool->num_workers;
+	return true;
+}
+
+void v4l2_mjpeg_pool_get_stats(struct v4l2_mjpeg_pool *pool,
+			       struct v4l2_mjpeg_stats *stats)
+{
+	/* a worker is done with the decode counters once it isn't busy */
+	for (size_t i = 0; i < pool->num_workers; i++) {
+		while (os_atomic_load_bool(&pool->workers[i].busy))
+			os_sleep_ms(1);
+	}
+
+	stats->submitted = pool->submitted;
+	stats->decoded = pool->decoded;
+	stats->dropped = pool->dropped;
+	stats->failed = pool->failed;
+	stats->latency_ns = pool->latency_ns;
+	stats->max_latency_ns = pool->max_latency_ns;
+}
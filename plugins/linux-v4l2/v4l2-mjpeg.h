@@ -0,0 +1,95 @@
+/*
+Copyright (C) 2021 by Hugh Bailey <obs.jim@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <obs-module.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct v4l2_mjpeg_pool;
+
+struct v4l2_mjpeg_stats {
+	uint64_t submitted;
+	uint64_t decoded;
+	uint64_t dropped;
+	uint64_t failed;
+
+	/* from submit until the frame was output to the source */
+	uint64_t latency_ns; /* total over all decoded frames */
+	uint64_t max_latency_ns;
+};
+
+/**
+ * Create a pool of MJPEG decoder threads for a source
+ *
+ * Frames are decoded on the pool threads and output to the source as planar
+ * YUV in the order they were submitted.
+ *
+ * @param source the source decoded frames are output to
+ * @param range color range of the frames, VIDEO_RANGE_DEFAULT to use the
+ *              range of the decoded frames
+ * @param threads number of decoder threads, 0 for one per physical core
+ *
+ * @return the pool or NULL on failure
+ */
+extern struct v4l2_mjpeg_pool *
+v4l2_mjpeg_pool_create(obs_source_t *source, enum video_range_type range,
+		       size_t threads);
+
+/**
+ * Stop the decoder threads, log the statistics and free the pool
+ *
+ * Frames that are still being decoded are discarded.
+ *
+ * @param pool the pool, may be NULL
+ */
+extern void v4l2_mjpeg_pool_destroy(struct v4l2_mjpeg_pool *pool);
+
+/**
+ * Queue a compressed frame for decoding
+ *
+ * The data is copied, so the capture buffer can be requeued right away.
+ * The frame is dropped if the decoders can't keep up with the device.
+ *
+ * @param pool the pool
+ * @param data compressed frame
+ * @param size size of the compressed frame
+ * @param timestamp timestamp of the frame in nanoseconds
+ *
+ * @return false if the frame was dropped
+ */
+extern bool v4l2_mjpeg_pool_submit(struct v4l2_mjpeg_pool *pool,
+				   const uint8_t *data, size_t size,
+				   uint64_t timestamp);
+
+/**
+ * Wait for the frames that are being decoded and get the statistics
+ *
+ * Must be called from the thread frames are submitted on.
+ *
+ * @param pool the pool
+ * @param stats receives the statistics since the pool was created
+ */
+extern void v4l2_mjpeg_pool_get_stats(struct v4l2_mjpeg_pool *pool,
+				      struct v4l2_mjpeg_stats *stats);
+
+#ifdef __cplusplus
+}
+#endif
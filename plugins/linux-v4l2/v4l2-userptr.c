@@ -0,0 +1,306 @@
+/*
+Copyright (C) 2021 by Hugh Bailey <obs.jim@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <libv4l2.h>
+
+#include <util/threading.h>
+#include <util/bmem.h>
+
+#include "v4l2-userptr.h"
+
+#define blog(level, msg, ...) blog(level, "v4l2-input: " msg, ##__VA_ARGS__)
+
+/*
+ * The buffers are plain page aligned allocations owned by the plugin, not
+ * frames from a libobs frame pool.  libobs has no pool that a driver could
+ * write into, so frames are output with obs_source_output_video_external,
+ * which keeps a reference to the buffer instead of copying it and calls back
+ * once the frame was rendered or dropped.
+ *
+ * The pool is shared between the capture thread and the threads libobs
+ * releases frames on, and stays alive until the source stopped using it and
+ * every frame output from it was released.  The mutex serializes queueing
+ * buffers with starting and stopping the capture.
+ *
+ * A held buffer is not available to the driver, so once all but
+ * MIN_QUEUED_BUFFERS would be held by libobs, frames are copied like the
+ * memory mapped path does and their buffer is queued again right away.
+ * Otherwise a source that keeps frames for a while (a paused async source,
+ * or buffering) would starve the driver and stall the capture.
+ */
+
+#define MIN_QUEUED_BUFFERS 2
+
+struct userptr_buffer {
+	struct v4l2_userptr_pool *pool;
+	uint32_t index;
+	void *start;
+	size_t length;
+	bool held;
+};
+
+struct v4l2_userptr_pool {
+	int_fast32_t dev;
+	pthread_mutex_t mutex;
+	volatile long refs;
+	bool streaming;
+
+	uint32_t count;
+	uint32_t num_held;
+	uint64_t num_copied;
+	struct userptr_buffer *buffers;
+};
+
+static int_fast32_t queue_buffer(struct v4l2_userptr_pool *pool,
+				 struct userptr_buffer *b)
+{
+	struct v4l2_buffer enq;
+
+	memset(&enq, 0, sizeof(enq));
+	enq.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+	enq.memory = V4L2_MEMORY_USERPTR;
+	enq.index = b->index;
+	enq.m.userptr = (unsigned long)b->start;
+	enq.length = (uint32_t)b->length;
+
+	if (v4l2_ioctl(pool->dev, VIDIOC_QBUF, &enq) < 0) {
+		blog(LOG_ERROR, "unable to queue buffer");
+		return -1;
+	}
+
+	return 0;
+}
+
+static void pool_release(struct v4l2_userptr_pool *pool)
+{
+	if (os_atomic_dec_long(&pool->refs) > 0)
+		return;
+
+	for (uint32_t i = 0; i < pool->count; i++)
+		free(pool->buffers[i].start);
+
+	pthread_mutex_destroy(&pool->mutex);
+	bfree(pool->buffers);
+	bfree(pool);
+}
+
+static void release_buffer(void *param)
+{
+	struct userptr_buffer *b = param;
+	struct v4l2_userptr_pool *pool = b->pool;
+
+	pthread_mutex_lock(&pool->mutex);
+	b->held = false;
+	pool->num_held--;
+	if (pool->streaming)
+		queue_buffer(pool, b);
+	pthread_mutex_unlock(&pool->mutex);
+
+	pool_release(pool);
+}
+
+struct v4l2_userptr_pool *v4l2_userptr_pool_create(int_fast32_t dev,
+						   uint32_t count)
+{
+	struct v4l2_userptr_pool *pool;
+	struct v4l2_requestbuffers req;
+	struct v4l2_format fmt;
+	size_t page = (size_t)sysconf(_SC_PAGESIZE);
+	size_t size;
+
+	memset(&fmt, 0, sizeof(fmt));
+	fmt.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+	if (v4l2_ioctl(dev, VIDIOC_G_FMT, &fmt) < 0) {
+		blog(LOG_ERROR, "unable to get the image size");
+		return NULL;
+	}
+
+	memset(&req, 0, sizeof(req));
+	req.count = count;
+	req.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+	req.memory = V4L2_MEMORY_USERPTR;
+
+	if (v4l2_ioctl(dev, VIDIOC_REQBUFS, &req) < 0) {
+		blog(LOG_INFO, "device does not support user pointer buffers");
+		return NULL;
+	}
+
+	if (req.count < 2) {
+		blog(LOG_ERROR, "Device returned less than 2 buffers");
+		return NULL;
+	}
+
+	size = (fmt.fmt.pix.sizeimage + page - 1) & ~(page - 1);
+
+	pool = bzalloc(sizeof(struct v4l2_userptr_pool));
+	pool->dev = dev;
+	pool->refs = 1;
+	pool->count = req.count;
+	pool->buffers = bzalloc(req.count * sizeof(struct userptr_buffer));
+	pthread_mutex_init_value(&pool->mutex);
+
+	if (pthread_mutex_init(&pool->mutex, NULL) != 0)
+		goto fail;
+
+	for (uint32_t i = 0; i < pool->count; i++) {
+		struct userptr_buffer *b = &pool->buffers[i];
+
+		b->pool = pool;
+		b->index = i;
+		b->length = size;
+		if (posix_memalign(&b->start, page, size) != 0) {
+			b->start = NULL;
+			goto fail;
+		}
+	}
+
+	blog(LOG_INFO, "%" PRIu32 " buffers of %zu bytes", pool->count, size);
+	return pool;
+
+fail:
+	blog(LOG_ERROR, "failed to allocate buffers");
+	v4l2_userptr_pool_destroy(pool);
+	return NULL;
+}
+
+void v4l2_userptr_pool_destroy(struct v4l2_userptr_pool *pool)
+{
+	struct v4l2_requestbuffers req;
+
+	if (!pool)
+		return;
+
+	v4l2_userptr_pool_stop(pool);
+
+	if (pool->num_copied)
+		blog(LOG_INFO,
+		     "%" PRIu64 " frames were copied because libobs held "
+		     "too many buffers",
+		     pool->num_copied);
+
+	/* frees the buffers of the driver, the memory stays with the pool */
+	memset(&req, 0, sizeof(req));
+	req.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+	req.memory = V4L2_MEMORY_USERPTR;
+	v4l2_ioctl(pool->dev, VIDIOC_REQBUFS, &req);
+
+	pthread_mutex_lock(&pool->mutex);
+	pool->dev = -1;
+	pthread_mutex_unlock(&pool->mutex);
+
+	pool_release(pool);
+}
+
+int_fast32_t v4l2_userptr_pool_start(struct v4l2_userptr_pool *pool)
+{
+	enum v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+	int_fast32_t ret = 0;
+
+	pthread_mutex_lock(&pool->mutex);
+
+	for (uint32_t i = 0; i < pool->count && ret == 0; i++) {
+		if (!pool->buffers[i].held)
+			ret = queue_buffer(pool, &pool->buffers[i]);
+	}
+
+	if (ret == 0 && v4l2_ioctl(pool->dev, VIDIOC_STREAMON, &type) < 0) {
+		blog(LOG_ERROR, "unable to start stream");
+		ret = -1;
+	}
+
+	pool->streaming = ret == 0;
+	pthread_mutex_unlock(&pool->mutex);
+	return ret;
+}
+
+int_fast32_t v4l2_userptr_pool_stop(struct v4l2_userptr_pool *pool)
+{
+	enum v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+	int_fast32_t ret = 0;
+
+	pthread_mutex_lock(&pool->mutex);
+
+	if (pool->streaming) {
+		pool->streaming = false;
+		if (v4l2_ioctl(pool->dev, VIDIOC_STREAMOFF, &type) < 0) {
+			blog(LOG_ERROR, "unable to stop stream");
+			ret = -1;
+		}
+	}
+
+	pthread_mutex_unlock(&pool->mutex);
+	return ret;
+}
+
+uint8_t *v4l2_userptr_pool_get(struct v4l2_userptr_pool *pool,
+			       const struct v4l2_buffer *buf)
+{
+	return buf->index < pool->count ? pool->buffers[buf->index].start
+					: NULL;
+}
+
+int_fast32_t v4l2_userptr_pool_requeue(struct v4l2_userptr_pool *pool,
+				       const struct v4l2_buffer *buf)
+{
+	int_fast32_t ret = 0;
+
+	if (buf->index >= pool->count)
+		return -1;
+
+	pthread_mutex_lock(&pool->mutex);
+	if (pool->streaming)
+		ret = queue_buffer(pool, &pool->buffers[buf->index]);
+	pthread_mutex_unlock(&pool->mutex);
+	return ret;
+}
+
+int_fast32_t v4l2_userptr_pool_output(struct v4l2_userptr_pool *pool,
+				      obs_source_t *source,
+				      const struct obs_source_frame *frame,
+				      const struct v4l2_buffer *buf)
+{
+	struct userptr_buffer *b;
+	bool copy;
+
+	if (buf->index >= pool->count)
+		return -1;
+
+	b = &pool->buffers[buf->index];
+
+	pthread_mutex_lock(&pool->mutex);
+	copy = pool->num_held + 1 > pool->count - MIN_QUEUED_BUFFERS;
+	if (copy) {
+		pool->num_copied++;
+	} else {
+		b->held = true;
+		pool->num_held++;
+	}
+	pthread_mutex_unlock(&pool->mutex);
+
+	if (copy) {
+		obs_source_output_video(source, frame);
+		return v4l2_userptr_pool_requeue(pool, buf);
+	}
+
+	os_atomic_inc_long(&pool->refs);
+	obs_source_output_video_external(source, frame, release_buffer, b);
+	return 0;
+}
@@ -0,0 +1,99 @@
+/*
+Copyright (C) 2021 by Hugh Bailey <obs.jim@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <linux/videodev2.h>
+
+#include <obs-module.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct v4l2_userptr_pool;
+
+/**
+ * Allocate user pointer buffers for the device
+ *
+ * The driver writes directly into these buffers, which are then output to
+ * libobs without a copy.  A buffer is only queued again once libobs released
+ * the frame that uses it.
+ *
+ * @param dev handle for the v4l2 device
+ * @param count number of buffers to request
+ *
+ * @return the pool or NULL if the device does not support user pointers
+ */
+extern struct v4l2_userptr_pool *v4l2_userptr_pool_create(int_fast32_t dev,
+							  uint32_t count);
+
+/**
+ * Stop using the device and release the pool
+ *
+ * The buffers are freed once libobs released all frames that use them.
+ *
+ * @param pool the pool, may be NULL
+ */
+extern void v4l2_userptr_pool_destroy(struct v4l2_userptr_pool *pool);
+
+/**
+ * Queue all free buffers and start the capture
+ *
+ * @return negative on failure
+ */
+extern int_fast32_t v4l2_userptr_pool_start(struct v4l2_userptr_pool *pool);
+
+/**
+ * Stop the capture, buffers released afterwards are not queued again
+ *
+ * @return negative on failure
+ */
+extern int_fast32_t v4l2_userptr_pool_stop(struct v4l2_userptr_pool *pool);
+
+/**
+ * Get the start address of a dequeued buffer
+ *
+ * @param pool the pool
+ * @param buf buffer returned by VIDIOC_DQBUF
+ */
+extern uint8_t *v4l2_userptr_pool_get(struct v4l2_userptr_pool *pool,
+				      const struct v4l2_buffer *buf);
+
+/**
+ * Queue a dequeued buffer again, if its data was not output
+ */
+extern int_fast32_t v4l2_userptr_pool_requeue(struct v4l2_userptr_pool *pool,
+					      const struct v4l2_buffer *buf);
+
+/**
+ * Output a frame that points into a dequeued buffer to the source
+ *
+ * The buffer is queued again once libobs releases the frame.  If libobs
+ * already holds so many buffers that the driver would run short, the frame is
+ * copied instead and the buffer is queued again right away.
+ *
+ * @return negative if the buffer could not be queued again
+ */
+extern int_fast32_t
+v4l2_userptr_pool_output(struct v4l2_userptr_pool *pool, obs_source_t *source,
+			 const struct obs_source_frame *frame,
+			 const struct v4l2_buffer *buf);
+
+#ifdef __cplusplus
+}
+#endif
@@ -51,6 +51,8 @@ struct ffmpeg_source {
 	char *input_format;
 	int buffering_mb;
 	int speed_percent;
+	int lookahead_frames;
+	int cache_size_mb;
 	bool is_looping;
 	bool is_local_file;
 	bool is_hw_decoding;
@@ -82,6 +84,7 @@ static bool is_local_file_modified(obs_properties_t *props,
 	UNUSED_PARAMETER(prop);
 
 	bool enabled = obs_data_get_bool(settings, "is_local_file");
+	bool cache_enabled = obs_data_get_bool(settings, "cache_frames");
 	obs_property_t *input = obs_properties_get(props, "input");
 	obs_property_t *input_format =
 		obs_properties_get(props, "input_format");
@@ -90,6 +93,11 @@ static bool is_local_file_modified(obs_properties_t *props,
 	obs_property_t *buffering = obs_properties_get(props, "buffering_mb");
 	obs_property_t *seekable = obs_properties_get(props, "seekable");
 	obs_property_t *speed = obs_properties_get(props, "speed_percent");
+	obs_property_t *lookahead =
+		obs_properties_get(props, "lookahead_frames");
+	obs_property_t *cache = obs_properties_get(props, "cache_frames");
+	obs_property_t *cache_size =
+		obs_properties_get(props, "cache_size_mb");
 	obs_property_t *reconnect_delay_sec =
 		obs_properties_get(props, "reconnect_delay_sec");
 	obs_property_set_visible(input, !enabled);
@@ -98,6 +106,9 @@ static bool is_local_file_modified(obs_properties_t *props,
 	obs_property_set_visible(local_file, enabled);
 	obs_property_set_visible(looping, enabled);
 	obs_property_set_visible(speed, enabled);
+	obs_property_set_visible(lookahead, enabled);
+	obs_property_set_visible(cache, enabled);
+	obs_property_set_visible(cache_size, enabled && cache_enabled);
 	obs_property_set_visible(seekable, !enabled);
 	obs_property_set_visible(reconnect_delay_sec, !enabled);
 
@@ -114,6 +125,10 @@ static void ffmpeg_source_defaults(obs_data_t *settings)
 	obs_data_set_default_int(settings, "reconnect_delay_sec", 10);
 	obs_data_set_default_int(settings, "buffering_mb", 2);
 	obs_data_set_default_int(settings, "speed_percent", 100);
+	obs_data_set_default_int(settings, "lookahead_frames",
+				 MP_DEFAULT_LOOKAHEAD);
+	obs_data_set_default_bool(settings, "cache_frames", false);
+	obs_data_set_default_int(settings, "cache_size_mb", 512);
 }
 
 static const char *media_filter =
@@ -205,6 +220,21 @@ static obs_properties_t *ffmpeg_source_getproperties(void *data)
 					     1, 200, 1);
 	obs_property_int_set_suffix(prop, "%");
 
+	obs_properties_add_int_slider(props, "lookahead_frames",
+				      obs_module_text("LookaheadFrames"), 1,
+				      MP_MAX_LOOKAHEAD, 1);
+
+	prop = obs_properties_add_bool(props, "cache_frames",
+				       obs_module_text("CacheFrames"));
+	obs_property_set_long_description(
+		prop, obs_module_text("CacheFrames.ToolTip"));
+	obs_property_set_modified_callback(prop, is_local_file_modified);
+
+	prop = obs_properties_add_int(props, "cache_size_mb",
+				      obs_module_text("CacheSizeMB"), 16, 8192,
+				      16);
+	obs_property_int_set_suffix(prop, " MB");
+
 	prop = obs_properties_add_list(props, "color_range",
 				       obs_module_text("ColorRange"),
 				       OBS_COMBO_TYPE_LIST,
@@ -232,6 +262,8 @@ static void dump_source_info(struct ffmpeg_source *s, const char *input,
 		"\tinput:                   %s\n"
 		"\tinput_format:            %s\n"
 		"\tspeed:                   %d\n"
+		"\tlookahead_frames:        %d\n"
+		"\tcache_size_mb:           %d\n"
 		"\tis_looping:              %s\n"
 		"\tis_linear_alpha:         %s\n"
 		"\tis_hw_decoding:          %s\n"
@@ -240,7 +272,9 @@ static void dump_source_info(struct ffmpeg_source *s, const char *input,
 		"\tclose_when_inactive:     %s",
 		input ? input : "(null)",
 		input_format ? input_format : "(null)", s->speed_percent,
-		s->is_looping ? "yes" : "no", s->is_linear_alpha ? "yes" : "no",
+		s->lookahead_frames, s->cache_size_mb,
+		s->is_looping ? "yes" : "no",
+		s->is_linear_alpha ? "yes" : "no",
 		s->is_hw_decoding ? "yes" : "no",
 		s->is_clear_on_media_end ? "yes" : "no",
 		s->restart_on_activate ? "yes" : "no",
@@ -298,6 +332,7 @@ static void media_stopped(void *opaque)
 static void ffmpeg_source_open(struct ffmpeg_source *s)
 {
 	if (s->input && *s->input) {
+		char *index_dir = obs_module_config_path("keyframes");
 		struct mp_media_info info = {
 			.opaque = s,
 			.v_cb = get_frame,
@@ -309,14 +344,19 @@ static void ffmpeg_source_open(struct ffmpeg_source *s)
 			.format = s->input_format,
 			.buffering = s->buffering_mb * 1024 * 1024,
 			.speed = s->speed_percent,
+			.lookahead_frames = s->lookahead_frames,
+			.cache_size_mb = s->cache_size_mb,
 			.force_range = s->range,
 			.is_linear_alpha = s->is_linear_alpha,
 			.hardware_decoding = s->is_hw_decoding,
 			.is_local_file = s->is_local_file || s->seekable,
 			.reconnecting = s->reconnecting,
+			.shareable = s->is_local_file,
+			.index_cache_dir = index_dir,
 		};
 
 		s->media_valid = mp_media_init(&s->media, &info);
+		bfree(index_dir);
 	}
 }
 
@@ -435,6 +475,12 @@ static void ffmpeg_source_update(void *data, obs_data_t *settings)
 	s->is_linear_alpha = obs_data_get_bool(settings, "linear_alpha");
 	s->buffering_mb = (int)obs_data_get_int(settings, "buffering_mb");
 	s->speed_percent = (int)obs_data_get_int(settings, "speed_percent");
+	s->lookahead_frames =
+		(int)obs_data_get_int(settings, "lookahead_frames");
+	s->cache_size_mb =
+		obs_data_get_bool(settings, "cache_frames")
+			? (int)obs_data_get_int(settings, "cache_size_mb")
+			: 0;
 	s->is_local_file = is_local_file;
 	s->seekable = obs_data_get_bool(settings, "seekable");
 
@@ -484,9 +530,10 @@ static void restart_proc(void *data, calldata_t *cd)
 static void get_duration(void *data, calldata_t *cd)
 {
 	struct ffmpeg_source *s = data;
+	AVFormatContext *fmt = mp_media_get_format(&s->media);
 	int64_t dur = 0;
-	if (s->media.fmt)
-		dur = s->media.fmt->duration;
+	if (fmt)
+		dur = fmt->duration;
 
 	calldata_set_int(cd, "duration", dur * 1000);
 }
@@ -494,15 +541,16 @@ static void get_duration(void *data, calldata_t *cd)
 static void get_nb_frames(void *data, calldata_t *cd)
 {
 	struct ffmpeg_source *s = data;
+	AVFormatContext *fmt = mp_media_get_format(&s->media);
 	int64_t frames = 0;
 
-	if (!s->media.fmt) {
+	if (!fmt) {
 		calldata_set_int(cd, "num_frames", frames);
 		return;
 	}
 
-	int video_stream_index = av_find_best_stream(
-		s->media.fmt, AVMEDIA_TYPE_VIDEO, -1, -1, NULL, 0);
+	int video_stream_index =
+		av_find_best_stream(fmt, AVMEDIA_TYPE_VIDEO, -1, -1, NULL, 0);
 
 	if (video_stream_index < 0) {
 		FF_BLOG(LOG_WARNING, "Getting number of frames failed: No "
@@ -511,7 +559,7 @@ static void get_nb_frames(void *data, calldata_t *cd)
 		return;
 	}
 
-	AVStream *stream = s->media.fmt->streams[video_stream_index];
+	AVStream *stream = fmt->streams[video_stream_index];
 
 	if (stream->nb_frames > 0) {
 		frames = stream->nb_frames;
@@ -519,7 +567,7 @@ static void get_nb_frames(void *data, calldata_t *cd)
 		FF_BLOG(LOG_DEBUG, "nb_frames not set, estimating using frame "
 				   "rate and duration");
 		AVRational avg_frame_rate = stream->avg_frame_rate;
-		frames = (int64_t)ceil((double)s->media.fmt->duration /
+		frames = (int64_t)ceil((double)fmt->duration /
 				       (double)AV_TIME_BASE *
 				       (double)avg_frame_rate.num /
 				       (double)avg_frame_rate.den);
@@ -703,10 +751,11 @@ static void ffmpeg_source_restart(void *data)
 static int64_t ffmpeg_source_get_duration(void *data)
 {
 	struct ffmpeg_source *s = data;
+	AVFormatContext *fmt = mp_media_get_format(&s->media);
 	int64_t dur = 0;
 
-	if (s->media.fmt)
-		dur = s->media.fmt->duration / INT64_C(1000);
+	if (fmt)
+		dur = fmt->duration / INT64_C(1000);
 
 	return dur;
 }
@@ -735,6 +784,15 @@ static enum obs_media_state ffmpeg_source_get_state(void *data)
 	return s->state;
 }
 
+static void ffmpeg_source_get_stats(void *data,
+				    struct obs_source_media_stats *stats)
+{
+	struct ffmpeg_source *s = data;
+
+	if (s->media_valid)
+		mp_media_get_stats(&s->media, stats);
+}
+
 static void missing_file_callback(void *src, const char *new_path, void *data)
 {
 	struct ffmpeg_source *s = src;
@@ -790,4 +848,5 @@ struct obs_source_info ffmpeg_source = {
 	.media_get_time = ffmpeg_source_get_time,
 	.media_set_time = ffmpeg_source_set_time,
 	.media_get_state = ffmpeg_source_get_state,
+	.media_get_stats = ffmpeg_source_get_stats,
 };
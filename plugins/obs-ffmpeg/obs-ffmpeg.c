@@ -3,6 +3,7 @@
 #include <libavutil/avutil.h>
 #include <libavcodec/avcodec.h>
 #include <libavformat/avformat.h>
+#include <media-playback/share.h>
 
 #include "obs-ffmpeg-config.h"
 
@@ -268,6 +269,9 @@ bool obs_module_load(void)
 
 void obs_module_unload(void)
 {
+	/* shared media may still be freed on the task scheduler */
+	mp_share_wait();
+
 #if ENABLE_FFMPEG_LOGGING
 	obs_ffmpeg_unload_logging();
 #endif
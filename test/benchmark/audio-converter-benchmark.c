@@ -0,0 +1,156 @@
+/*
+ * Times the source audio converter against swresample for the conversions
+ * sources commonly need, in 1024 frame packets.
+ *
+ * usage: audio-converter-benchmark [seconds of audio]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <media-io/audio-converter.h>
+#include <media-io/audio-resampler.h>
+#include <util/platform.h>
+#include <util/bmem.h>
+
+#define PACKET_FRAMES 1024
+
+struct conversion {
+	const char *name;
+	struct resample_info src;
+	struct resample_info dst;
+};
+
+static const struct conversion conversions[] = {
+	{"48k -> 44.1k stereo",
+	 {48000, AUDIO_FORMAT_FLOAT_PLANAR, SPEAKERS_STEREO},
+	 {44100, AUDIO_FORMAT_FLOAT_PLANAR, SPEAKERS_STEREO}},
+	{"44.1k -> 48k stereo s16",
+	 {44100, AUDIO_FORMAT_16BIT, SPEAKERS_STEREO},
+	 {48000, AUDIO_FORMAT_FLOAT_PLANAR, SPEAKERS_STEREO}},
+	{"5.1 -> stereo",
+	 {48000, AUDIO_FORMAT_FLOAT_PLANAR, SPEAKERS_5POINT1},
+	 {48000, AUDIO_FORMAT_FLOAT_PLANAR, SPEAKERS_STEREO}},
+	{"stereo -> 5.1",
+	 {48000, AUDIO_FORMAT_FLOAT_PLANAR, SPEAKERS_STEREO},
+	 {48000, AUDIO_FORMAT_FLOAT_PLANAR, SPEAKERS_5POINT1}},
+	{"5.1 s16 -> stereo",
+	 {48000, AUDIO_FORMAT_16BIT, SPEAKERS_5POINT1},
+	 {48000, AUDIO_FORMAT_FLOAT_PLANAR, SPEAKERS_STEREO}},
+	{"48k 5.1 -> 44.1k stereo",
+	 {48000, AUDIO_FORMAT_FLOAT_PLANAR, SPEAKERS_5POINT1},
+	 {44100, AUDIO_FORMAT_FLOAT_PLANAR, SPEAKERS_STEREO}},
+};
+
+#define NUM_CONVERSIONS (sizeof(conversions) / sizeof(conversions[0]))
+
+/* packed input only uses the first plane, but it has every channel */
+#define PLANE_SIZE (PACKET_FRAMES * MAX_AUDIO_CHANNELS * sizeof(float))
+
+static double time_converter(const struct conversion *c,
+			     const uint8_t *const input[], int packets)
+{
+	audio_converter_t *conv = audio_converter_create(
+		&c->dst, &c->src, AUDIO_CONVERTER_QUALITY_MEDIUM);
+	float *output[MAX_AUDIO_CHANNELS];
+	uint32_t max_frames;
+	uint64_t start;
+	double ns;
+
+	if (!conv)
+		return -1.0;
+
+	max_frames = audio_converter_get_max_frames(conv, PACKET_FRAMES);
+	for (size_t i = 0; i < MAX_AUDIO_CHANNELS; i++)
+		output[i] = bmalloc(max_frames * sizeof(float));
+
+	start = os_gettime_ns();
+	for (int p = 0; p < packets; p++) {
+		uint32_t out_frames;
+		uint64_t ts_offset;
+
+		audio_converter_convert(conv, output, &out_frames, &ts_offset,
+					input, PACKET_FRAMES);
+	}
+	ns = (double)(os_gettime_ns() - start) / packets / PACKET_FRAMES;
+
+	for (size_t i = 0; i < MAX_AUDIO_CHANNELS; i++)
+		bfree(output[i]);
+
+	audio_converter_destroy(conv);
+	return ns;
+}
+
+static double time_swresample(const struct conversion *c,
+			      const uint8_t *const input[], int packets)
+{
+	audio_resampler_t *resampler =
+		audio_resampler_create(&c->dst, &c->src);
+	uint64_t start;
+	double ns;
+
+	if (!resampler)
+		return -1.0;
+
+	start = os_gettime_ns();
+	for (int p = 0; p < packets; p++) {
+		uint8_t *output[MAX_AUDIO_CHANNELS];
+		uint32_t out_frames;
+		uint64_t ts_offset;
+
+		audio_resampler_resample(resampler, output, &out_frames,
+					 &ts_offset, input, PACKET_FRAMES);
+	}
+	ns = (double)(os_gettime_ns() - start) / packets / PACKET_FRAMES;
+
+	audio_resampler_destroy(resampler);
+	return ns;
+}
+
+static void print_result(const char *name, double ns)
+{
+	if (ns < 0.0)
+		printf("  %-10s       failed\n", name);
+	else
+		printf("  %-10s %7.1f ns/frame\n", name, ns);
+}
+
+int main(int argc, char *argv[])
+{
+	int seconds = argc > 1 ? atoi(argv[1]) : 60;
+	uint8_t *input[MAX_AUDIO_CHANNELS];
+	int packets;
+
+	if (seconds <= 0)
+		seconds = 60;
+
+	packets = seconds * 48000 / PACKET_FRAMES;
+
+	for (size_t i = 0; i < MAX_AUDIO_CHANNELS; i++) {
+		float *samples = bmalloc(PLANE_SIZE);
+
+		for (size_t j = 0; j < PLANE_SIZE / sizeof(float); j++)
+			samples[j] = (float)rand() / (float)RAND_MAX - 0.5f;
+
+		input[i] = (uint8_t *)samples;
+	}
+
+	printf("%d packets of %d frames\n", packets, PACKET_FRAMES);
+
+	for (size_t i = 0; i < NUM_CONVERSIONS; i++) {
+		const struct conversion *c = &conversions[i];
+
+		printf("%s\n", c->name);
+		print_result("converter",
+			     time_converter(c, (const uint8_t *const *)input,
+					    packets));
+		print_result("swresample",
+			     time_swresample(c, (const uint8_t *const *)input,
+					     packets));
+	}
+
+	for (size_t i = 0; i < MAX_AUDIO_CHANNELS; i++)
+		bfree(input[i]);
+
+	return 0;
+}
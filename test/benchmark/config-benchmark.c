@@ -0,0 +1,120 @@
+/*
+ * Times getting and setting config values, on a config the size of a large
+ * profile (sections x items, with defaults for half of the items).
+ *
+ * usage: config-benchmark [sections] [items] [iterations]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <util/config-file.h>
+#include <util/platform.h>
+#include <util/bmem.h>
+#include <util/dstr.h>
+
+struct key {
+	char *section;
+	char *name;
+};
+
+static double time_get(config_t *config, const struct key *keys,
+		       int num_keys, int iterations)
+{
+	uint64_t start = os_gettime_ns();
+	int64_t sum = 0;
+
+	for (int i = 0; i < iterations; i++) {
+		const struct key *key = &keys[rand() % num_keys];
+		sum += config_get_int(config, key->section, key->name);
+	}
+
+	if (sum == -1)
+		printf("\n");
+
+	return (double)(os_gettime_ns() - start) / iterations;
+}
+
+static double time_set(config_t *config, const struct key *keys,
+		       int num_keys, int iterations)
+{
+	uint64_t start = os_gettime_ns();
+
+	for (int i = 0; i < iterations; i++) {
+		const struct key *key = &keys[rand() % num_keys];
+		config_set_int(config, key->section, key->name, i & 1);
+	}
+
+	return (double)(os_gettime_ns() - start) / iterations;
+}
+
+int main(int argc, char *argv[])
+{
+	int sections = argc > 1 ? atoi(argv[1]) : 30;
+	int items = argc > 2 ? atoi(argv[2]) : 40;
+	int iterations = argc > 3 ? atoi(argv[3]) : 1000000;
+	struct dstr str = {0};
+	config_t *config;
+	struct key *keys;
+	int num_keys;
+
+	if (sections <= 0)
+		sections = 30;
+	if (items <= 0)
+		items = 40;
+	if (iterations <= 0)
+		iterations = 1000000;
+
+	num_keys = sections * items;
+	keys = bmalloc(sizeof(struct key) * num_keys);
+
+	for (int s = 0; s < sections; s++) {
+		char section[32];
+
+		snprintf(section, sizeof(section), "Section%d", s);
+		dstr_catf(&str, "[%s]\n", section);
+
+		for (int i = 0; i < items; i++) {
+			struct key *key = &keys[s * items + i];
+			char name[32];
+
+			snprintf(name, sizeof(name), "Item%d", i);
+			key->section = bstrdup(section);
+			key->name = bstrdup(name);
+
+			if (i & 1)
+				dstr_catf(&str, "%s=%d\n", name, i);
+		}
+	}
+
+	if (config_open_string(&config, str.array) != CONFIG_SUCCESS) {
+		fprintf(stderr, "Could not parse the config\n");
+		return 1;
+	}
+
+	/* the other half of the items only have defaults */
+	for (int i = 0; i < num_keys; i++)
+		config_set_default_int(config, keys[i].section, keys[i].name,
+				       i);
+
+	printf("%d sections, %d items each, %d iterations\n", sections, items,
+	       iterations);
+
+	srand(1);
+	printf("get    %8.1f ns/call\n",
+	       time_get(config, keys, num_keys, iterations));
+	srand(1);
+	printf("set    %8.1f ns/call\n",
+	       time_set(config, keys, num_keys, iterations));
+
+	config_close(config);
+
+	for (int i = 0; i < num_keys; i++) {
+		bfree(keys[i].section);
+		bfree(keys[i].name);
+	}
+
+	bfree(keys);
+	dstr_free(&str);
+	return 0;
+}
@@ -0,0 +1,155 @@
+/*
+ * Times loading the libobs effects with gs_effect_create_from_file, without
+ * a shader cache, with an empty one (cold, the first start after an update)
+ * and with the one the cold run filled in (warm, every start after that).
+ *
+ * Each run creates a new graphics context, as effects loaded from a file
+ * stay cached in the context they were loaded in.  The software renderer
+ * is used so the numbers only cover libobs, a graphics module that also
+ * caches its linked programs saves its own compile time on top of this.
+ *
+ * usage: effect-cache-benchmark [runs]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+
+#include <graphics/graphics.h>
+#include <util/platform.h>
+#include <util/base.h>
+#include <util/dstr.h>
+
+#define CACHE_PATH "effect-cache-benchmark"
+
+static const char *effects[] = {
+	"default.effect",
+	"default_rect.effect",
+	"opaque.effect",
+	"solid.effect",
+	"repeat.effect",
+	"premultiplied_alpha.effect",
+	"format_conversion.effect",
+	"bicubic_scale.effect",
+	"lanczos_scale.effect",
+	"area.effect",
+	"bilinear_lowres_scale.effect",
+	"deinterlace_base.effect",
+	"deinterlace_blend.effect",
+	"deinterlace_blend_2x.effect",
+	"deinterlace_discard.effect",
+	"deinterlace_discard_2x.effect",
+	"deinterlace_linear.effect",
+	"deinterlace_linear_2x.effect",
+	"deinterlace_yadif.effect",
+	"deinterlace_yadif_2x.effect",
+};
+
+#define NUM_EFFECTS (sizeof(effects) / sizeof(effects[0]))
+
+/* the software renderer warns about every shader it can't run natively */
+static void log_handler(int lvl, const char *msg, va_list args, void *p)
+{
+	UNUSED_PARAMETER(p);
+
+	if (lvl <= LOG_ERROR) {
+		vfprintf(stderr, msg, args);
+		fprintf(stderr, "\n");
+	}
+}
+
+static void clear_cache(void)
+{
+	os_glob_t *glob;
+
+	if (os_glob(CACHE_PATH "/*", 0, &glob) == 0) {
+		for (size_t i = 0; i < glob->gl_pathc; i++)
+			os_unlink(glob->gl_pathv[i].path);
+		os_globfree(glob);
+	}
+
+	os_rmdir(CACHE_PATH);
+}
+
+/* returns the time taken in ms, or a negative value if an effect failed */
+static double load_effects(const char *cache_path,
+			   struct gs_shader_cache_stats *stats)
+{
+	graphics_t *graphics = NULL;
+	struct dstr path = {0};
+	uint64_t start;
+	double ms = -1.0;
+
+	if (gs_create(&graphics, SW_MODULE, 0) != GS_SUCCESS) {
+		fprintf(stderr, "Could not load '%s'\n", SW_MODULE);
+		return ms;
+	}
+
+	gs_enter_context(graphics);
+	gs_set_shader_cache_path(cache_path);
+
+	start = os_gettime_ns();
+
+	for (size_t i = 0; i < NUM_EFFECTS; i++) {
+		dstr_printf(&path, "%s%s", DATA_PATH, effects[i]);
+
+		if (!gs_effect_create_from_file(path.array, NULL)) {
+			fprintf(stderr, "Could not load '%s'\n", path.array);
+			goto fail;
+		}
+	}
+
+	ms = (double)(os_gettime_ns() - start) / 1000000.0;
+	gs_get_shader_cache_stats(stats);
+
+fail:
+	gs_leave_context();
+	gs_destroy(graphics);
+	dstr_free(&path);
+	return ms;
+}
+
+static bool run(const char *name, const char *cache_path, int runs,
+		bool clear)
+{
+	struct gs_shader_cache_stats stats = {0};
+	double total = 0.0;
+
+	for (int i = 0; i < runs; i++) {
+		double ms;
+
+		if (clear)
+			clear_cache();
+
+		ms = load_effects(cache_path, &stats);
+		if (ms < 0.0)
+			return false;
+
+		total += ms;
+	}
+
+	printf("%-9s %8.2f ms %4u hits %4u misses %4u writes\n", name,
+	       total / runs, stats.effect_hits, stats.effect_misses,
+	       stats.effect_writes);
+	return true;
+}
+
+int main(int argc, char *argv[])
+{
+	int runs = argc > 1 ? atoi(argv[1]) : 10;
+	bool success;
+
+	if (runs <= 0)
+		runs = 10;
+
+	base_set_log_handler(log_handler, NULL);
+
+	printf("%d effects, %d runs\n", (int)NUM_EFFECTS, runs);
+
+	success = run("uncached", NULL, runs, false) &&
+		  run("cold", CACHE_PATH, runs, true) &&
+		  run("warm", CACHE_PATH, runs, false);
+
+	clear_cache();
+	return success ? 0 : 1;
+}
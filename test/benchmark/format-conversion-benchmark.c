@@ -0,0 +1,138 @@
+/*
+ * Times the converters returned by video_format_get_convert on 1080p frames,
+ * throughput counts the bytes read plus the bytes written per frame.
+ *
+ * usage: format-conversion-benchmark [frames]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <media-io/format-conversion.h>
+#include <util/platform.h>
+#include <util/bmem.h>
+
+#define WIDTH 1920
+#define HEIGHT 1080
+
+struct pair {
+	enum video_format src;
+	enum video_format dst;
+};
+
+static const struct pair pairs[] = {
+	{VIDEO_FORMAT_NV12, VIDEO_FORMAT_I420},
+	{VIDEO_FORMAT_I420, VIDEO_FORMAT_NV12},
+	{VIDEO_FORMAT_RGBA, VIDEO_FORMAT_BGRA},
+	{VIDEO_FORMAT_BGRA, VIDEO_FORMAT_RGBA},
+	{VIDEO_FORMAT_RGBA, VIDEO_FORMAT_BGRX},
+	{VIDEO_FORMAT_BGRX, VIDEO_FORMAT_RGBA},
+	{VIDEO_FORMAT_BGRX, VIDEO_FORMAT_BGRA},
+	{VIDEO_FORMAT_BGRA, VIDEO_FORMAT_BGRX},
+	{VIDEO_FORMAT_I40A, VIDEO_FORMAT_I420},
+	{VIDEO_FORMAT_I42A, VIDEO_FORMAT_I422},
+	{VIDEO_FORMAT_YUVA, VIDEO_FORMAT_I444},
+	{VIDEO_FORMAT_YUY2, VIDEO_FORMAT_I422},
+	{VIDEO_FORMAT_UYVY, VIDEO_FORMAT_I422},
+	{VIDEO_FORMAT_YVYU, VIDEO_FORMAT_I422},
+	{VIDEO_FORMAT_P010, VIDEO_FORMAT_I010},
+	{VIDEO_FORMAT_I010, VIDEO_FORMAT_P010},
+};
+
+/* bytes per frame, in eighths of a byte per pixel */
+static size_t get_frame_size(enum video_format format)
+{
+	size_t eighths = 0;
+
+	switch (format) {
+	case VIDEO_FORMAT_NV12:
+	case VIDEO_FORMAT_I420:
+		eighths = 12;
+		break;
+	case VIDEO_FORMAT_I422:
+	case VIDEO_FORMAT_YUY2:
+	case VIDEO_FORMAT_UYVY:
+	case VIDEO_FORMAT_YVYU:
+		eighths = 16;
+		break;
+	case VIDEO_FORMAT_I40A:
+		eighths = 20;
+		break;
+	case VIDEO_FORMAT_I444:
+	case VIDEO_FORMAT_I42A:
+	case VIDEO_FORMAT_P010:
+	case VIDEO_FORMAT_I010:
+		eighths = 24;
+		break;
+	case VIDEO_FORMAT_YUVA:
+	case VIDEO_FORMAT_RGBA:
+	case VIDEO_FORMAT_BGRA:
+	case VIDEO_FORMAT_BGRX:
+		eighths = 32;
+		break;
+	default:
+		break;
+	}
+
+	return (size_t)WIDTH * HEIGHT * eighths / 8;
+}
+
+/* every plane is allocated as large as the largest one of these formats */
+#define PLANE_SIZE ((size_t)WIDTH * 4 * HEIGHT)
+#define LINESIZE (WIDTH * 4)
+
+int main(int argc, char *argv[])
+{
+	int frames = argc > 1 ? atoi(argv[1]) : 500;
+	uint8_t *input[MAX_AV_PLANES];
+	uint8_t *output[MAX_AV_PLANES];
+	uint32_t linesize[MAX_AV_PLANES];
+
+	if (frames <= 0)
+		frames = 500;
+
+	for (size_t i = 0; i < MAX_AV_PLANES; i++) {
+		input[i] = bmalloc(PLANE_SIZE);
+		output[i] = bmalloc(PLANE_SIZE);
+		linesize[i] = LINESIZE;
+
+		for (size_t j = 0; j < PLANE_SIZE; j++)
+			input[i][j] = (uint8_t)rand();
+	}
+
+	printf("%dx%d, %d frames\n", WIDTH, HEIGHT, frames);
+
+	for (size_t i = 0; i < sizeof(pairs) / sizeof(pairs[0]); i++) {
+		const struct pair *p = &pairs[i];
+		video_format_convert_t convert =
+			video_format_get_convert(p->src, p->dst);
+		size_t bytes = get_frame_size(p->src) + get_frame_size(p->dst);
+		uint64_t start;
+		double ms;
+
+		if (!convert)
+			continue;
+
+		/* warm up */
+		convert((const uint8_t *const *)input, linesize, WIDTH, 0,
+			HEIGHT, output, linesize);
+
+		start = os_gettime_ns();
+		for (int f = 0; f < frames; f++)
+			convert((const uint8_t *const *)input, linesize, WIDTH,
+				0, HEIGHT, output, linesize);
+		ms = (double)(os_gettime_ns() - start) / 1000000.0 / frames;
+
+		printf("%-5s -> %-5s %8.3f ms/frame %6.2f GB/s\n",
+		       get_video_format_name(p->src),
+		       get_video_format_name(p->dst), ms,
+		       (double)bytes / (ms * 1000000.0));
+	}
+
+	for (size_t i = 0; i < MAX_AV_PLANES; i++) {
+		bfree(input[i]);
+		bfree(output[i]);
+	}
+
+	return 0;
+}
@@ -0,0 +1,140 @@
+/*
+ * Times the CPU side of playing 10-bit 1080p frames in a media source: the
+ * sws_scale conversion to 8-bit that media playback used to do (SWS_POINT,
+ * to the format closest_format picked) followed by the copy into the async
+ * frame cache, against copying the 10-bit frame as is, which is all that is
+ * left on the CPU now that format_conversion.effect converts it.  The GPU
+ * time of the conversion technique is not included.
+ *
+ * usage: high-bit-depth-benchmark [frames]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <obs.h>
+#include <media-io/video-scaler.h>
+#include <util/platform.h>
+
+#define WIDTH 1920
+#define HEIGHT 1080
+
+struct pair {
+	enum video_format src;
+	enum video_format dst;
+};
+
+static const struct pair pairs[] = {
+	{VIDEO_FORMAT_I010, VIDEO_FORMAT_I420},
+	{VIDEO_FORMAT_P010, VIDEO_FORMAT_NV12},
+	{VIDEO_FORMAT_I210, VIDEO_FORMAT_I422},
+};
+
+static void fill_frame(struct obs_source_frame *frame)
+{
+	/* only I210 has full height chroma */
+	uint32_t chroma_height = frame->format == VIDEO_FORMAT_I210
+					 ? frame->height
+					 : frame->height / 2;
+
+	for (size_t i = 0; i < MAX_AV_PLANES && frame->data[i]; i++) {
+		size_t size = (size_t)frame->linesize[i] *
+			      (i ? chroma_height : frame->height);
+
+		for (size_t j = 0; j < size; j++)
+			frame->data[i][j] = (uint8_t)rand();
+	}
+}
+
+static double time_swscale(const struct pair *p, struct obs_source_frame *src,
+			   int frames)
+{
+	struct video_scale_info src_info = {p->src, WIDTH, HEIGHT,
+					    VIDEO_RANGE_PARTIAL, VIDEO_CS_709};
+	struct video_scale_info dst_info = {p->dst, WIDTH, HEIGHT,
+					    VIDEO_RANGE_PARTIAL, VIDEO_CS_709};
+	struct obs_source_frame *out;
+	struct obs_source_frame *cache;
+	video_scaler_t *scaler;
+	uint64_t start;
+	double ms;
+	int ret;
+
+	ret = video_scaler_create2(&scaler, &dst_info, &src_info,
+				   VIDEO_SCALE_POINT,
+				   VIDEO_SCALER_IMPL_SWSCALE);
+	if (ret != VIDEO_SCALER_SUCCESS)
+		return -1.0;
+
+	out = obs_source_frame_create(p->dst, WIDTH, HEIGHT);
+	cache = obs_source_frame_create(p->dst, WIDTH, HEIGHT);
+
+	start = os_gettime_ns();
+	for (int f = 0; f < frames; f++) {
+		video_scaler_scale(scaler, out->data, out->linesize,
+				   (const uint8_t *const *)src->data,
+				   src->linesize);
+		obs_source_frame_copy(cache, out);
+	}
+
+	ms = (double)(os_gettime_ns() - start) / 1000000.0 / frames;
+
+	obs_source_frame_destroy(out);
+	obs_source_frame_destroy(cache);
+	video_scaler_destroy(scaler);
+	return ms;
+}
+
+static double time_copy(const struct pair *p, struct obs_source_frame *src,
+			int frames)
+{
+	struct obs_source_frame *cache =
+		obs_source_frame_create(p->src, WIDTH, HEIGHT);
+	uint64_t start = os_gettime_ns();
+	double ms;
+
+	for (int f = 0; f < frames; f++)
+		obs_source_frame_copy(cache, src);
+
+	ms = (double)(os_gettime_ns() - start) / 1000000.0 / frames;
+
+	obs_source_frame_destroy(cache);
+	return ms;
+}
+
+static void print_result(const char *name, double ms)
+{
+	if (ms < 0.0)
+		printf("  %-8s        failed\n", name);
+	else
+		printf("  %-8s %8.3f ms/frame %8.1f fps\n", name, ms,
+		       1000.0 / ms);
+}
+
+int main(int argc, char *argv[])
+{
+	int frames = argc > 1 ? atoi(argv[1]) : 200;
+
+	if (frames <= 0)
+		frames = 200;
+
+	printf("%dx%d, %d frames\n", WIDTH, HEIGHT, frames);
+
+	for (size_t i = 0; i < sizeof(pairs) / sizeof(pairs[0]); i++) {
+		const struct pair *p = &pairs[i];
+		struct obs_source_frame *src =
+			obs_source_frame_create(p->src, WIDTH, HEIGHT);
+
+		fill_frame(src);
+
+		printf("%s (was converted to %s)\n",
+		       get_video_format_name(p->src),
+		       get_video_format_name(p->dst));
+		print_result("swscale", time_swscale(p, src, frames));
+		print_result("gpu", time_copy(p, src, frames));
+
+		obs_source_frame_destroy(src);
+	}
+
+	return 0;
+}
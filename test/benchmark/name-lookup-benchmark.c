@@ -0,0 +1,131 @@
+/*
+ * Times looking up sources by name through the name index, against walking
+ * the source list the way lookups did before the index.
+ *
+ * usage: name-lookup-benchmark [sources] [lookups]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <obs.h>
+#include <util/platform.h>
+#include <util/bmem.h>
+
+#define SOURCE_ID "name_lookup_benchmark_source"
+
+static const char *get_name(void *type_data)
+{
+	UNUSED_PARAMETER(type_data);
+	return "Name lookup benchmark";
+}
+
+static void *create(obs_data_t *settings, obs_source_t *source)
+{
+	UNUSED_PARAMETER(settings);
+	UNUSED_PARAMETER(source);
+	return bzalloc(1);
+}
+
+static void destroy(void *data)
+{
+	bfree(data);
+}
+
+static struct obs_source_info source_info = {
+	.id = SOURCE_ID,
+	.type = OBS_SOURCE_TYPE_INPUT,
+	.get_name = get_name,
+	.create = create,
+	.destroy = destroy,
+};
+
+struct walk {
+	const char *name;
+	obs_source_t *found;
+};
+
+static bool walk_cb(void *param, obs_source_t *source)
+{
+	struct walk *walk = param;
+
+	if (strcmp(obs_source_get_name(source), walk->name) == 0) {
+		walk->found = obs_source_get_ref(source);
+		return false;
+	}
+
+	return true;
+}
+
+static obs_source_t *walk_lookup(const char *name)
+{
+	struct walk walk = {name, NULL};
+
+	obs_enum_sources(walk_cb, &walk);
+	return walk.found;
+}
+
+static double run(obs_source_t *(*lookup)(const char *name), char **names,
+		  int num_sources, int lookups)
+{
+	uint64_t start = os_gettime_ns();
+
+	for (int i = 0; i < lookups; i++) {
+		obs_source_t *source = lookup(names[rand() % num_sources]);
+
+		if (!source)
+			fprintf(stderr, "lookup failed\n");
+		obs_source_release(source);
+	}
+
+	return (double)(os_gettime_ns() - start) / lookups;
+}
+
+int main(int argc, char *argv[])
+{
+	int num_sources = argc > 1 ? atoi(argv[1]) : 1000;
+	int lookups = argc > 2 ? atoi(argv[2]) : 100000;
+	obs_source_t **sources;
+	char **names;
+
+	if (num_sources <= 0)
+		num_sources = 1000;
+	if (lookups <= 0)
+		lookups = 100000;
+
+	if (!obs_startup("en-US", NULL, NULL))
+		return 1;
+
+	obs_register_source(&source_info);
+
+	sources = bmalloc(sizeof(obs_source_t *) * num_sources);
+	names = bmalloc(sizeof(char *) * num_sources);
+
+	for (int i = 0; i < num_sources; i++) {
+		char name[32];
+
+		snprintf(name, sizeof(name), "Source %d", i);
+		names[i] = bstrdup(name);
+		sources[i] = obs_source_create(SOURCE_ID, name, NULL, NULL);
+	}
+
+	printf("%d sources, %d lookups\n", num_sources, lookups);
+
+	srand(1);
+	printf("index  %10.1f ns/lookup\n",
+	       run(obs_get_source_by_name, names, num_sources, lookups));
+	srand(1);
+	printf("walk   %10.1f ns/lookup\n",
+	       run(walk_lookup, names, num_sources, lookups));
+
+	for (int i = 0; i < num_sources; i++) {
+		obs_source_release(sources[i]);
+		bfree(names[i]);
+	}
+
+	bfree(sources);
+	bfree(names);
+	obs_shutdown();
+	return 0;
+}
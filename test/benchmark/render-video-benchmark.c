@@ -0,0 +1,229 @@
+/*
+ * Times render_video on the graphics thread with a scene of many small
+ * items, half of them cropped so they also go through the item texture.
+ * The software renderer is used at a small canvas size, so the time is
+ * mostly the per-item work in libobs rather than drawing pixels.
+ *
+ * usage: render-video-benchmark [items] [seconds]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+
+#include <obs.h>
+#include <util/platform.h>
+#include <util/profiler.h>
+#include <util/base.h>
+#include <util/bmem.h>
+
+#define SOURCE_ID "render_video_benchmark_source"
+
+#define WIDTH 320
+#define HEIGHT 180
+#define SIZE 16
+
+struct source {
+	gs_texture_t *tex;
+};
+
+static const char *get_name(void *type_data)
+{
+	UNUSED_PARAMETER(type_data);
+	return "Render video benchmark";
+}
+
+static void *create(obs_data_t *settings, obs_source_t *source)
+{
+	struct source *context = bzalloc(sizeof(struct source));
+	uint32_t pixels[SIZE * SIZE];
+	const uint8_t *data = (const uint8_t *)pixels;
+
+	for (size_t i = 0; i < SIZE * SIZE; i++)
+		pixels[i] = 0xFF000000 | (uint32_t)(i * 0x010101);
+
+	obs_enter_graphics();
+	context->tex = gs_texture_create(SIZE, SIZE, GS_RGBA, 1, &data, 0);
+	obs_leave_graphics();
+
+	UNUSED_PARAMETER(settings);
+	UNUSED_PARAMETER(source);
+	return context;
+}
+
+static void destroy(void *data)
+{
+	struct source *context = data;
+
+	obs_enter_graphics();
+	gs_texture_destroy(context->tex);
+	obs_leave_graphics();
+
+	bfree(context);
+}
+
+static uint32_t get_size(void *data)
+{
+	UNUSED_PARAMETER(data);
+	return SIZE;
+}
+
+static void video_render(void *data, gs_effect_t *effect)
+{
+	struct source *context = data;
+
+	obs_source_draw(context->tex, 0, 0, 0, 0, false);
+	UNUSED_PARAMETER(effect);
+}
+
+static struct obs_source_info source_info = {
+	.id = SOURCE_ID,
+	.type = OBS_SOURCE_TYPE_INPUT,
+	.output_flags = OBS_SOURCE_VIDEO,
+	.get_name = get_name,
+	.create = create,
+	.destroy = destroy,
+	.get_width = get_size,
+	.get_height = get_size,
+	.video_render = video_render,
+};
+
+static void log_handler(int lvl, const char *msg, va_list args, void *p)
+{
+	UNUSED_PARAMETER(p);
+
+	if (lvl <= LOG_ERROR) {
+		vfprintf(stderr, msg, args);
+		fprintf(stderr, "\n");
+	}
+}
+
+struct find {
+	const char *name;
+	profiler_snapshot_entry_t *entry;
+};
+
+static bool find_cb(void *param, profiler_snapshot_entry_t *entry)
+{
+	struct find *find = param;
+
+	if (strcmp(profiler_snapshot_entry_name(entry), find->name) == 0) {
+		find->entry = entry;
+		return false;
+	}
+
+	profiler_snapshot_enumerate_children(entry, find_cb, find);
+	return !find->entry;
+}
+
+static void print_entry(profiler_snapshot_t *snap, const char *name)
+{
+	struct find find = {name, NULL};
+	profiler_time_entries_t *times;
+	uint64_t total = 0;
+	uint64_t count = 0;
+
+	profiler_snapshot_enumerate_roots(snap, find_cb, &find);
+	if (!find.entry) {
+		fprintf(stderr, "no '%s' in the profiler snapshot\n", name);
+		return;
+	}
+
+	times = profiler_snapshot_entry_times(find.entry);
+	for (size_t i = 0; i < times->num; i++) {
+		total += times->array[i].time_delta * times->array[i].count;
+		count += times->array[i].count;
+	}
+
+	printf("%-20s %8.1f us/frame, %llu frames\n", name,
+	       count ? (double)total / (double)count : 0.0,
+	       (unsigned long long)count);
+}
+
+int main(int argc, char *argv[])
+{
+	int num_items = argc > 1 ? atoi(argv[1]) : 200;
+	int seconds = argc > 2 ? atoi(argv[2]) : 5;
+	struct obs_video_info ovi = {
+		.graphics_module = SW_MODULE,
+		.fps_num = 30,
+		.fps_den = 1,
+		.base_width = WIDTH,
+		.base_height = HEIGHT,
+		.output_width = WIDTH,
+		.output_height = HEIGHT,
+		.output_format = VIDEO_FORMAT_NV12,
+		.gpu_conversion = true,
+		.colorspace = VIDEO_CS_709,
+		.range = VIDEO_RANGE_PARTIAL,
+		.scale_type = OBS_SCALE_BICUBIC,
+	};
+	profiler_snapshot_t *snap;
+	obs_scene_t *scene;
+	int ret = 1;
+
+	if (num_items <= 0)
+		num_items = 200;
+	if (seconds <= 0)
+		seconds = 5;
+
+	/* the software renderer warns about every shader it can't run
+	 * natively */
+	base_set_log_handler(log_handler, NULL);
+	profiler_start();
+
+	if (!obs_startup("en-US", NULL, NULL))
+		goto fail;
+
+	obs_add_data_path(DATA_PATH);
+	obs_register_source(&source_info);
+
+	if (obs_reset_video(&ovi) != OBS_VIDEO_SUCCESS) {
+		fprintf(stderr, "Could not start video with '%s'\n",
+			SW_MODULE);
+		goto fail;
+	}
+
+	scene = obs_scene_create("Render video benchmark");
+
+	for (int i = 0; i < num_items; i++) {
+		obs_source_t *source =
+			obs_source_create(SOURCE_ID, "item", NULL, NULL);
+		obs_sceneitem_t *item = obs_scene_add(scene, source);
+		struct vec2 pos;
+
+		vec2_set(&pos, (float)(i * SIZE % WIDTH),
+			 (float)(i * SIZE / WIDTH * SIZE % HEIGHT));
+		obs_sceneitem_set_pos(item, &pos);
+
+		if (i & 1) {
+			struct obs_sceneitem_crop crop = {1, 1, 1, 1};
+			obs_sceneitem_set_crop(item, &crop);
+		}
+
+		obs_source_release(source);
+	}
+
+	obs_set_output_source(0, obs_scene_get_source(scene));
+
+	printf("%d items, %dx%d, %d seconds\n", num_items, WIDTH, HEIGHT,
+	       seconds);
+
+	os_sleep_ms(seconds * 1000);
+
+	snap = profile_snapshot_create();
+	print_entry(snap, "render_video");
+	print_entry(snap, "render_main_texture");
+	profile_snapshot_free(snap);
+
+	obs_set_output_source(0, NULL);
+	obs_scene_release(scene);
+	ret = 0;
+
+fail:
+	obs_shutdown();
+	profiler_stop();
+	profiler_free();
+	return ret;
+}
@@ -0,0 +1,203 @@
+/*
+ * Times the software renderer drawing common scene operations into a 1080p
+ * render target.
+ *
+ * usage: sw-render-benchmark [frames]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <obs.h>
+#include <graphics/graphics.h>
+#include <util/platform.h>
+#include <util/bmem.h>
+
+#define WIDTH 1920
+#define HEIGHT 1080
+
+struct context {
+	gs_effect_t *default_effect;
+	gs_effect_t *bicubic_effect;
+	gs_texture_t *frame;
+	gs_texture_t *sprite;
+};
+
+static void draw_texture(gs_effect_t *effect, const char *tech,
+			 gs_texture_t *tex, uint32_t cx, uint32_t cy)
+{
+	gs_eparam_t *image = gs_effect_get_param_by_name(effect, "image");
+	gs_eparam_t *dim = gs_effect_get_param_by_name(effect,
+						       "base_dimension");
+	gs_eparam_t *dim_i = gs_effect_get_param_by_name(effect,
+							 "base_dimension_i");
+	struct vec2 size;
+	struct vec2 size_i;
+
+	vec2_set(&size, (float)gs_texture_get_width(tex),
+		 (float)gs_texture_get_height(tex));
+	vec2_set(&size_i, 1.0f / size.x, 1.0f / size.y);
+
+	gs_effect_set_texture(image, tex);
+	if (dim)
+		gs_effect_set_vec2(dim, &size);
+	if (dim_i)
+		gs_effect_set_vec2(dim_i, &size_i);
+
+	while (gs_effect_loop(effect, tech))
+		gs_draw_sprite(tex, 0, cx, cy);
+}
+
+/* a full frame source, like a game or display capture */
+static void draw_copy(struct context *ctx)
+{
+	gs_enable_blending(false);
+	draw_texture(ctx->default_effect, "Draw", ctx->frame, WIDTH, HEIGHT);
+	gs_enable_blending(true);
+}
+
+static void draw_blend(struct context *ctx)
+{
+	draw_texture(ctx->default_effect, "Draw", ctx->frame, WIDTH, HEIGHT);
+}
+
+/* lots of small overlays, like images and text */
+static void draw_sprites(struct context *ctx)
+{
+	for (int y = 0; y < 10; y++) {
+		for (int x = 0; x < 10; x++) {
+			gs_matrix_push();
+			gs_matrix_translate3f((float)x * 192.0f,
+					      (float)y * 108.0f, 0.0f);
+			draw_texture(ctx->default_effect, "Draw", ctx->sprite,
+				     256, 144);
+			gs_matrix_pop();
+		}
+	}
+}
+
+/* not axis-aligned, so every pixel goes through the edge tests */
+static void draw_rotated(struct context *ctx)
+{
+	gs_matrix_push();
+	gs_matrix_translate3f(WIDTH / 2.0f, HEIGHT / 2.0f, 0.0f);
+	gs_matrix_rotaa4f(0.0f, 0.0f, 1.0f, RAD(10.0f));
+	gs_matrix_translate3f(-WIDTH / 2.0f, -HEIGHT / 2.0f, 0.0f);
+	draw_texture(ctx->default_effect, "Draw", ctx->frame, WIDTH, HEIGHT);
+	gs_matrix_pop();
+}
+
+/* a 1080p source scaled to 720p with the bicubic filter */
+static void draw_bicubic(struct context *ctx)
+{
+	draw_texture(ctx->bicubic_effect, "Draw", ctx->frame, 1280, 720);
+}
+
+struct benchmark {
+	const char *name;
+	void (*draw)(struct context *ctx);
+};
+
+static const struct benchmark benchmarks[] = {
+	{"copy", draw_copy},       {"blend", draw_blend},
+	{"sprites", draw_sprites}, {"rotated", draw_rotated},
+	{"bicubic", draw_bicubic},
+};
+
+static gs_texture_t *create_texture(uint32_t cx, uint32_t cy)
+{
+	uint8_t *data = bmalloc(cx * cy * 4);
+	const uint8_t *planes[] = {data};
+	gs_texture_t *tex;
+
+	for (uint32_t i = 0; i < cx * cy * 4; i++)
+		data[i] = (uint8_t)rand();
+
+	tex = gs_texture_create(cx, cy, GS_RGBA, 1, planes, 0);
+	bfree(data);
+	return tex;
+}
+
+static void run(struct context *ctx, int frames)
+{
+	gs_texture_t *target =
+		gs_texture_create(WIDTH, HEIGHT, GS_RGBA, 1, NULL,
+				  GS_RENDER_TARGET);
+
+	gs_set_render_target(target, NULL);
+	gs_set_viewport(0, 0, WIDTH, HEIGHT);
+	gs_ortho(0.0f, (float)WIDTH, 0.0f, (float)HEIGHT, -100.0f, 100.0f);
+	gs_enable_depth_test(false);
+	gs_set_cull_mode(GS_NEITHER);
+	gs_enable_blending(true);
+	gs_blend_function(GS_BLEND_SRCALPHA, GS_BLEND_INVSRCALPHA);
+
+	for (size_t i = 0; i < sizeof(benchmarks) / sizeof(benchmarks[0]);
+	     i++) {
+		const struct benchmark *b = &benchmarks[i];
+		uint64_t start;
+		double ms;
+
+		/* warm up */
+		b->draw(ctx);
+
+		start = os_gettime_ns();
+		for (int f = 0; f < frames; f++)
+			b->draw(ctx);
+		gs_flush();
+		ms = (double)(os_gettime_ns() - start) / 1000000.0 / frames;
+
+		printf("%-8s %8.3f ms/frame %8.1f fps\n", b->name, ms,
+		       1000.0 / ms);
+	}
+
+	gs_set_render_target(NULL, NULL);
+	gs_texture_destroy(target);
+}
+
+int main(int argc, char *argv[])
+{
+	int frames = argc > 1 ? atoi(argv[1]) : 50;
+	struct context ctx = {0};
+	graphics_t *graphics = NULL;
+	int ret = 1;
+
+	if (frames <= 0)
+		frames = 50;
+
+	/* the software renderer shades on the libobs task scheduler */
+	if (!obs_startup("en-US", NULL, NULL))
+		return 1;
+
+	if (gs_create(&graphics, SW_MODULE, 0) != GS_SUCCESS) {
+		fprintf(stderr, "Could not load '%s'\n", SW_MODULE);
+		goto fail;
+	}
+
+	gs_enter_context(graphics);
+
+	ctx.default_effect =
+		gs_effect_create_from_file(DATA_PATH "default.effect", NULL);
+	ctx.bicubic_effect = gs_effect_create_from_file(
+		DATA_PATH "bicubic_scale.effect", NULL);
+	ctx.frame = create_texture(WIDTH, HEIGHT);
+	ctx.sprite = create_texture(256, 144);
+
+	if (ctx.default_effect && ctx.bicubic_effect && ctx.frame &&
+	    ctx.sprite) {
+		printf("%dx%d, %d frames\n", WIDTH, HEIGHT, frames);
+		run(&ctx, frames);
+		ret = 0;
+	}
+
+	gs_effect_destroy(ctx.default_effect);
+	gs_effect_destroy(ctx.bicubic_effect);
+	gs_texture_destroy(ctx.frame);
+	gs_texture_destroy(ctx.sprite);
+	gs_leave_context();
+	gs_destroy(graphics);
+
+fail:
+	obs_shutdown();
+	return ret;
+}
@@ -0,0 +1,152 @@
+/*
+ * Times the native scaler against swscale for the downscales outputs
+ * commonly do, on the libobs task scheduler.
+ *
+ * usage: video-scaler-benchmark [frames]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <obs.h>
+#include <media-io/video-scaler.h>
+#include <util/platform.h>
+#include <util/bmem.h>
+
+struct scale {
+	uint32_t src_cx;
+	uint32_t src_cy;
+	uint32_t dst_cx;
+	uint32_t dst_cy;
+};
+
+static const struct scale scales[] = {
+	{2560, 1440, 1920, 1080},
+	{2560, 1440, 1280, 720},
+	{3840, 2160, 1920, 1080},
+};
+
+#define NUM_SCALES (sizeof(scales) / sizeof(scales[0]))
+
+static const enum video_format formats[] = {
+	VIDEO_FORMAT_NV12,
+	VIDEO_FORMAT_I420,
+	VIDEO_FORMAT_BGRA,
+};
+
+#define NUM_FORMATS (sizeof(formats) / sizeof(formats[0]))
+
+static const enum video_scale_type types[] = {
+	VIDEO_SCALE_BILINEAR,
+	VIDEO_SCALE_BICUBIC,
+};
+
+#define NUM_TYPES (sizeof(types) / sizeof(types[0]))
+
+static const char *get_type_name(enum video_scale_type type)
+{
+	return type == VIDEO_SCALE_BICUBIC ? "bicubic" : "bilinear";
+}
+
+/* every plane is allocated as large as a 4K BGRA frame */
+#define PLANE_SIZE ((size_t)3840 * 4 * 2160)
+
+static double run(const struct scale *s, enum video_format format,
+		  enum video_scale_type type, enum video_scaler_impl impl,
+		  uint8_t *input[], uint8_t *output[], int frames)
+{
+	struct video_scale_info src = {format, s->src_cx, s->src_cy,
+				       VIDEO_RANGE_PARTIAL, VIDEO_CS_709};
+	struct video_scale_info dst = {format, s->dst_cx, s->dst_cy,
+				       VIDEO_RANGE_PARTIAL, VIDEO_CS_709};
+	uint32_t in_linesize[MAX_AV_PLANES];
+	uint32_t out_linesize[MAX_AV_PLANES];
+	uint32_t bpp = format == VIDEO_FORMAT_BGRA ? 4 : 1;
+	video_scaler_t *scaler;
+	uint64_t start;
+	double ms;
+
+	if (video_scaler_create2(&scaler, &dst, &src, type, impl) !=
+	    VIDEO_SCALER_SUCCESS)
+		return -1.0;
+
+	for (size_t i = 0; i < MAX_AV_PLANES; i++) {
+		in_linesize[i] = s->src_cx * bpp;
+		out_linesize[i] = s->dst_cx * bpp;
+	}
+
+	/* warm up */
+	video_scaler_scale(scaler, output, out_linesize,
+			   (const uint8_t *const *)input, in_linesize);
+
+	start = os_gettime_ns();
+	for (int f = 0; f < frames; f++)
+		video_scaler_scale(scaler, output, out_linesize,
+				   (const uint8_t *const *)input, in_linesize);
+	ms = (double)(os_gettime_ns() - start) / 1000000.0 / frames;
+
+	video_scaler_destroy(scaler);
+	return ms;
+}
+
+static void print_result(const char *name, double ms)
+{
+	if (ms < 0.0)
+		printf("  %-8s        failed\n", name);
+	else
+		printf("  %-8s %8.3f ms/frame\n", name, ms);
+}
+
+static void bench(const struct scale *s, enum video_format format,
+		  enum video_scale_type type, uint8_t *input[],
+		  uint8_t *output[], int frames)
+{
+	printf("%ux%u -> %ux%u %s %s\n", s->src_cx, s->src_cy, s->dst_cx,
+	       s->dst_cy, get_video_format_name(format), get_type_name(type));
+
+	print_result("native", run(s, format, type, VIDEO_SCALER_IMPL_NATIVE,
+				   input, output, frames));
+	print_result("swscale", run(s, format, type, VIDEO_SCALER_IMPL_SWSCALE,
+				    input, output, frames));
+}
+
+int main(int argc, char *argv[])
+{
+	int frames = argc > 1 ? atoi(argv[1]) : 100;
+	uint8_t *input[MAX_AV_PLANES];
+	uint8_t *output[MAX_AV_PLANES];
+
+	if (frames <= 0)
+		frames = 100;
+
+	/* the native scaler splits frames on the libobs task scheduler */
+	if (!obs_startup("en-US", NULL, NULL))
+		return 1;
+
+	for (size_t i = 0; i < MAX_AV_PLANES; i++) {
+		input[i] = bmalloc(PLANE_SIZE);
+		output[i] = bmalloc(PLANE_SIZE);
+
+		for (size_t j = 0; j < PLANE_SIZE; j++)
+			input[i][j] = (uint8_t)rand();
+	}
+
+	printf("%d frames, %d logical cores\n", frames,
+	       os_get_logical_cores());
+
+	for (size_t i = 0; i < NUM_SCALES; i++) {
+		for (size_t j = 0; j < NUM_FORMATS; j++) {
+			for (size_t k = 0; k < NUM_TYPES; k++)
+				bench(&scales[i], formats[j], types[k], input,
+				      output, frames);
+		}
+	}
+
+	for (size_t i = 0; i < MAX_AV_PLANES; i++) {
+		bfree(input[i]);
+		bfree(output[i]);
+	}
+
+	obs_shutdown();
+	return 0;
+}
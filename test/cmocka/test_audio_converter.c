@@ -0,0 +1,407 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include <math.h>
+#include <stdlib.h>
+
+#include <media-io/audio-converter.h>
+#include <util/bmem.h>
+
+#define FRAMES 1031
+#define SQRT1_2 0.70710678f
+
+static const enum audio_format formats[] = {
+	AUDIO_FORMAT_U8BIT,        AUDIO_FORMAT_16BIT,
+	AUDIO_FORMAT_32BIT,        AUDIO_FORMAT_FLOAT,
+	AUDIO_FORMAT_U8BIT_PLANAR, AUDIO_FORMAT_16BIT_PLANAR,
+	AUDIO_FORMAT_32BIT_PLANAR, AUDIO_FORMAT_FLOAT_PLANAR,
+};
+
+static const enum speaker_layout layouts[] = {
+	SPEAKERS_MONO,    SPEAKERS_STEREO,  SPEAKERS_2POINT1, SPEAKERS_4POINT0,
+	SPEAKERS_4POINT1, SPEAKERS_5POINT1, SPEAKERS_7POINT1,
+};
+
+#define NUM_FORMATS (sizeof(formats) / sizeof(formats[0]))
+#define NUM_LAYOUTS (sizeof(layouts) / sizeof(layouts[0]))
+
+struct packet {
+	uint8_t *data[MAX_AV_PLANES];
+	float *out[MAX_AUDIO_CHANNELS];
+};
+
+static void packet_init(struct packet *p, enum audio_format format,
+			uint32_t frames)
+{
+	size_t size = get_audio_bytes_per_channel(format) * frames *
+		      MAX_AUDIO_CHANNELS;
+
+	for (size_t i = 0; i < MAX_AV_PLANES; i++) {
+		p->data[i] = bmalloc(size);
+
+		if (format == AUDIO_FORMAT_FLOAT ||
+		    format == AUDIO_FORMAT_FLOAT_PLANAR) {
+			float *f = (float *)p->data[i];
+			for (size_t j = 0; j < size / 4; j++)
+				f[j] = (float)rand() / (float)RAND_MAX - 0.5f;
+		} else {
+			for (size_t j = 0; j < size; j++)
+				p->data[i][j] = (uint8_t)rand();
+		}
+	}
+
+	for (size_t i = 0; i < MAX_AUDIO_CHANNELS; i++)
+		p->out[i] = bzalloc(sizeof(float) * frames * 2 + 64);
+}
+
+static void packet_free(struct packet *p)
+{
+	for (size_t i = 0; i < MAX_AV_PLANES; i++)
+		bfree(p->data[i]);
+	for (size_t i = 0; i < MAX_AUDIO_CHANNELS; i++)
+		bfree(p->out[i]);
+}
+
+/* scalar reference of the sample formats */
+static float ref_sample(enum audio_format format, const struct packet *p,
+			uint32_t channels, uint32_t ch, uint32_t frame)
+{
+	size_t size = get_audio_bytes_per_channel(format);
+	const uint8_t *src;
+
+	if (is_audio_planar(format))
+		src = p->data[ch] + frame * size;
+	else
+		src = p->data[0] + (frame * channels + ch) * size;
+
+	switch (format) {
+	case AUDIO_FORMAT_U8BIT:
+	case AUDIO_FORMAT_U8BIT_PLANAR:
+		return ((float)*src - 128.0f) / 128.0f;
+	case AUDIO_FORMAT_16BIT:
+	case AUDIO_FORMAT_16BIT_PLANAR:
+		return (float)*(const int16_t *)src / 32768.0f;
+	case AUDIO_FORMAT_32BIT:
+	case AUDIO_FORMAT_32BIT_PLANAR:
+		return (float)*(const int32_t *)src / 2147483648.0f;
+	default:
+		return *(const float *)src;
+	}
+}
+
+static audio_converter_t *create(enum audio_format format,
+				 enum speaker_layout in, uint32_t in_rate,
+				 enum speaker_layout out, uint32_t out_rate)
+{
+	struct resample_info src = {in_rate, format, in};
+	struct resample_info dst = {out_rate, AUDIO_FORMAT_FLOAT_PLANAR, out};
+
+	return audio_converter_create(&dst, &src,
+				      AUDIO_CONVERTER_QUALITY_MEDIUM);
+}
+
+/* every format converted to stereo compared against the scalar reference */
+static void format_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	for (size_t f = 0; f < NUM_FORMATS; f++) {
+		audio_converter_t *conv = create(formats[f], SPEAKERS_STEREO,
+						 48000, SPEAKERS_STEREO, 48000);
+		struct packet p;
+		uint32_t frames;
+		uint64_t offset;
+
+		assert_non_null(conv);
+		packet_init(&p, formats[f], FRAMES);
+
+		audio_converter_convert(conv, p.out, &frames, &offset,
+					(const uint8_t *const *)p.data, FRAMES);
+		assert_int_equal(frames, FRAMES);
+		assert_int_equal(offset, 0);
+
+		for (uint32_t c = 0; c < 2; c++) {
+			for (uint32_t i = 0; i < FRAMES; i++) {
+				float ref = ref_sample(formats[f], &p, 2, c, i);
+				assert_true(fabsf(p.out[c][i] - ref) < 1e-6f);
+			}
+		}
+
+		packet_free(&p);
+		audio_converter_destroy(conv);
+	}
+}
+
+static void check_matrix(enum speaker_layout in, enum speaker_layout out,
+			 const float *matrix)
+{
+	audio_converter_t *conv = create(AUDIO_FORMAT_FLOAT_PLANAR, in, 48000,
+					 out, 48000);
+	uint32_t in_ch = get_audio_channels(in);
+	uint32_t out_ch = get_audio_channels(out);
+	struct packet p;
+	uint32_t frames;
+	uint64_t offset;
+
+	assert_non_null(conv);
+	packet_init(&p, AUDIO_FORMAT_FLOAT_PLANAR, FRAMES);
+
+	audio_converter_convert(conv, p.out, &frames, &offset,
+				(const uint8_t *const *)p.data, FRAMES);
+
+	for (uint32_t o = 0; o < out_ch; o++) {
+		for (uint32_t i = 0; i < FRAMES; i++) {
+			float ref = 0.0f;
+
+			for (uint32_t c = 0; c < in_ch; c++)
+				ref += matrix[o * in_ch + c] *
+				       ((float *)p.data[c])[i];
+			assert_true(fabsf(p.out[o][i] - ref) < 1e-5f);
+		}
+	}
+
+	packet_free(&p);
+	audio_converter_destroy(conv);
+}
+
+/* the matrices swresample uses with its default mix levels */
+static void remix_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	const float surround_to_stereo[] = {
+		1, 0, SQRT1_2, 0, SQRT1_2, 0, /* FL */
+		0, 1, SQRT1_2, 0, 0, SQRT1_2, /* FR */
+	};
+	const float stereo_to_surround[] = {
+		1, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0,
+	};
+	const float stereo_to_mono[] = {SQRT1_2, SQRT1_2};
+	const float mono_to_surround[] = {1, 1, 1, 0, 1, 1};
+	const float surround71_to_51[] = {
+		1, 0, 0, 0, 0,       0,       0,       0, /* FL */
+		0, 1, 0, 0, 0,       0,       0,       0, /* FR */
+		0, 0, 1, 0, 0,       0,       0,       0, /* FC */
+		0, 0, 0, 1, 0,       0,       0,       0, /* LFE */
+		0, 0, 0, 0, 1,       0,       SQRT1_2, 0, /* BL */
+		0, 0, 0, 0, 0,       1,       0,       SQRT1_2, /* BR */
+	};
+
+	check_matrix(SPEAKERS_5POINT1, SPEAKERS_STEREO, surround_to_stereo);
+	check_matrix(SPEAKERS_STEREO, SPEAKERS_5POINT1, stereo_to_surround);
+	check_matrix(SPEAKERS_STEREO, SPEAKERS_MONO, stereo_to_mono);
+	check_matrix(SPEAKERS_MONO, SPEAKERS_5POINT1, mono_to_surround);
+	check_matrix(SPEAKERS_7POINT1, SPEAKERS_5POINT1, surround71_to_51);
+}
+
+static void mix_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+	audio_converter_t *conv = create(AUDIO_FORMAT_FLOAT_PLANAR,
+					 SPEAKERS_STEREO, 48000,
+					 SPEAKERS_STEREO, 48000);
+	const float gains[MAX_AUDIO_CHANNELS] = {0.25f, 1.5f};
+	struct packet p;
+	uint32_t frames;
+	uint64_t offset;
+
+	packet_init(&p, AUDIO_FORMAT_FLOAT_PLANAR, FRAMES);
+
+	audio_converter_set_mix(conv, gains, false);
+	audio_converter_convert(conv, p.out, &frames, &offset,
+				(const uint8_t *const *)p.data, FRAMES);
+
+	for (uint32_t c = 0; c < 2; c++) {
+		for (uint32_t i = 0; i < FRAMES; i++) {
+			float ref = gains[c] * ((float *)p.data[c])[i];
+			assert_true(fabsf(p.out[c][i] - ref) < 1e-6f);
+		}
+	}
+
+	audio_converter_set_mix(conv, gains, true);
+	audio_converter_convert(conv, p.out, &frames, &offset,
+				(const uint8_t *const *)p.data, FRAMES);
+
+	for (uint32_t i = 0; i < FRAMES; i++) {
+		float ref = (gains[0] * ((float *)p.data[0])[i] +
+			     gains[1] * ((float *)p.data[1])[i]) *
+			    0.5f;
+		assert_true(fabsf(p.out[0][i] - ref) < 1e-6f);
+		assert_true(fabsf(p.out[1][i] - ref) < 1e-6f);
+	}
+
+	packet_free(&p);
+	audio_converter_destroy(conv);
+}
+
+/* converts the packet through conv in pieces of one to three frames, which
+ * only go through the scalar tails of the kernels */
+static uint32_t convert_scalar(audio_converter_t *conv, float *const output[],
+			       const struct packet *p, enum audio_format format,
+			       uint32_t in_ch, uint32_t out_ch)
+{
+	size_t size = get_audio_bytes_per_channel(format);
+	size_t step = is_audio_planar(format) ? size : size * in_ch;
+	uint32_t total = 0;
+
+	for (uint32_t i = 0; i < FRAMES;) {
+		const uint8_t *in[MAX_AV_PLANES];
+		float *out[MAX_AUDIO_CHANNELS];
+		uint32_t n = 1 + i % 3;
+		uint32_t frames;
+		uint64_t offset;
+
+		if (n > FRAMES - i)
+			n = FRAMES - i;
+		for (size_t c = 0; c < MAX_AV_PLANES; c++)
+			in[c] = p->data[c] + i * step;
+		for (size_t c = 0; c < out_ch; c++)
+			out[c] = output[c] + total;
+
+		audio_converter_convert(conv, out, &frames, &offset, in, n);
+		total += frames;
+		i += n;
+	}
+
+	return total;
+}
+
+/* the vector loops of every kernel have to match their scalar tails */
+static void simd_scalar_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+	const float gains[MAX_AUDIO_CHANNELS] = {0.5f, 2.0f, 1.0f, 1.0f,
+						 1.0f, 1.0f, 1.0f, 0.25f};
+	float *scalar[MAX_AUDIO_CHANNELS];
+
+	for (size_t c = 0; c < MAX_AUDIO_CHANNELS; c++)
+		scalar[c] = bzalloc(sizeof(float) * FRAMES * 2);
+
+	for (size_t f = 0; f < NUM_FORMATS; f++) {
+		for (size_t a = 0; a < NUM_LAYOUTS; a++) {
+			for (size_t b = 0; b < NUM_LAYOUTS; b++) {
+				enum audio_format format = formats[f];
+				uint32_t in_ch = get_audio_channels(layouts[a]);
+				uint32_t out_ch =
+					get_audio_channels(layouts[b]);
+				uint32_t rate = b % 2 ? 44100 : 48000;
+				audio_converter_t *conv[2];
+				uint32_t frames[2];
+				uint64_t offset;
+				struct packet p;
+
+				for (size_t i = 0; i < 2; i++) {
+					conv[i] = create(format, layouts[a],
+							 48000, layouts[b],
+							 rate);
+					assert_non_null(conv[i]);
+					audio_converter_set_mix(conv[i], gains,
+								a == b);
+				}
+
+				packet_init(&p, format, FRAMES);
+
+				audio_converter_convert(
+					conv[0], p.out, &frames[0], &offset,
+					(const uint8_t *const *)p.data, FRAMES);
+				frames[1] = convert_scalar(conv[1], scalar, &p,
+							   format, in_ch,
+							   out_ch);
+				assert_int_equal(frames[0], frames[1]);
+
+				for (uint32_t c = 0; c < out_ch; c++) {
+					for (uint32_t i = 0; i < frames[0];
+					     i++)
+						assert_true(
+							fabsf(p.out[c][i] -
+							      scalar[c][i]) <
+							1e-5f);
+				}
+
+				packet_free(&p);
+				audio_converter_destroy(conv[0]);
+				audio_converter_destroy(conv[1]);
+			}
+		}
+	}
+
+	for (size_t c = 0; c < MAX_AUDIO_CHANNELS; c++)
+		bfree(scalar[c]);
+}
+
+static double sine_snr(uint32_t in_rate, uint32_t out_rate, double freq)
+{
+	audio_converter_t *conv = create(AUDIO_FORMAT_FLOAT_PLANAR,
+					 SPEAKERS_MONO, in_rate, SPEAKERS_MONO,
+					 out_rate);
+	float *in = bmalloc(sizeof(float) * in_rate);
+	float *out = bmalloc(sizeof(float) * (out_rate + 64));
+	double signal = 0.0;
+	double noise = 0.0;
+
+	for (uint32_t i = 0; i < in_rate; i++)
+		in[i] = (float)(0.5 * sin(2.0 * M_PI * freq * i / in_rate));
+
+	for (uint32_t i = 0; i < in_rate; i += 480) {
+		const uint8_t *data[MAX_AV_PLANES] = {(uint8_t *)(in + i)};
+		float *dst[MAX_AUDIO_CHANNELS] = {out};
+		uint32_t n = in_rate - i < 480 ? in_rate - i : 480;
+		uint32_t max = audio_converter_get_max_frames(conv, n);
+		uint32_t frames;
+		uint64_t offset;
+
+		audio_converter_convert(conv, dst, &frames, &offset, data, n);
+		assert_true(frames <= max);
+
+		/* time of the output samples from the reported delay */
+		for (uint32_t j = 0; j < frames; j++) {
+			double t = (double)i / in_rate - offset * 1e-9 +
+				   (double)j / out_rate;
+			double ref = 0.5 * sin(2.0 * M_PI * freq * t);
+
+			if (t < 0.05 || t > 0.95)
+				continue;
+
+			signal += ref * ref;
+			noise += (out[j] - ref) * (out[j] - ref);
+		}
+	}
+
+	bfree(in);
+	bfree(out);
+	audio_converter_destroy(conv);
+	return 10.0 * log10(signal / noise);
+}
+
+static void resample_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+	struct resample_info odd = {44056, AUDIO_FORMAT_FLOAT_PLANAR,
+				    SPEAKERS_STEREO};
+	struct resample_info dst = {48000, AUDIO_FORMAT_FLOAT_PLANAR,
+				    SPEAKERS_STEREO};
+
+	assert_true(sine_snr(48000, 44100, 1000.0) > 90.0);
+	assert_true(sine_snr(44100, 48000, 1000.0) > 90.0);
+	assert_true(sine_snr(48000, 44100, 15000.0) > 80.0);
+	assert_true(sine_snr(22050, 48000, 1000.0) > 90.0);
+
+	/* ratios with too many phases have to go through swresample */
+	assert_null(audio_converter_create(&dst, &odd,
+					   AUDIO_CONVERTER_QUALITY_MEDIUM));
+}
+
+int main()
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(format_test),
+		cmocka_unit_test(remix_test),
+		cmocka_unit_test(mix_test),
+		cmocka_unit_test(simd_scalar_test),
+		cmocka_unit_test(resample_test),
+	};
+
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,226 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include <stdio.h>
+#include <string.h>
+
+#include <util/config-file.h>
+#include <util/platform.h>
+#include <util/bmem.h>
+
+#define TEST_FILE "test_config_file.ini"
+
+static void cleanup(void)
+{
+	os_unlink(TEST_FILE);
+	os_unlink(TEST_FILE ".tmp");
+	os_unlink(TEST_FILE ".bak");
+}
+
+static void lookup_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+	config_t *config = config_create(TEST_FILE);
+	char section[32];
+	char name[32];
+
+	assert_non_null(config);
+
+	for (int s = 0; s < 50; s++) {
+		snprintf(section, sizeof(section), "Section%d", s);
+		for (int i = 0; i < 200; i++) {
+			snprintf(name, sizeof(name), "Item%d", i);
+			config_set_int(config, section, name, s * 1000 + i);
+		}
+	}
+
+	assert_int_equal(config_num_sections(config), 50);
+	assert_string_equal(config_get_section(config, 7), "Section7");
+
+	for (int s = 0; s < 50; s++) {
+		snprintf(section, sizeof(section), "Section%d", s);
+		for (int i = 0; i < 200; i++) {
+			snprintf(name, sizeof(name), "Item%d", i);
+			assert_int_equal(config_get_int(config, section, name),
+					 s * 1000 + i);
+		}
+	}
+
+	/* removing items reindexes the ones after them */
+	for (int i = 0; i < 200; i += 2) {
+		snprintf(name, sizeof(name), "Item%d", i);
+		assert_true(config_remove_value(config, "Section3", name));
+	}
+
+	for (int i = 0; i < 200; i++) {
+		snprintf(name, sizeof(name), "Item%d", i);
+		assert_int_equal(config_has_user_value(config, "Section3",
+						       name),
+				 i % 2 == 1);
+		if (i % 2)
+			assert_int_equal(
+				config_get_int(config, "Section3", name),
+				3000 + i);
+	}
+
+	assert_false(config_remove_value(config, "Section3", "Item0"));
+	assert_false(config_has_user_value(config, "Missing", "Item1"));
+	assert_null(config_get_string(config, "Section1", "Missing"));
+
+	/* defaults are looked up when there is no user value */
+	config_set_default_int(config, "Section3", "Item0", 42);
+	config_set_default_int(config, "Section3", "Item1", 42);
+	assert_int_equal(config_get_int(config, "Section3", "Item0"), 42);
+	assert_int_equal(config_get_int(config, "Section3", "Item1"), 3001);
+
+	config_close(config);
+}
+
+static void write_file(const char *str)
+{
+	FILE *f = fopen(TEST_FILE, "wb");
+
+	assert_non_null(f);
+	fputs(str, f);
+	fclose(f);
+}
+
+static bool file_has(const char *str)
+{
+	char *data = os_quick_read_utf8_file(TEST_FILE);
+	bool found = data && strstr(data, str) != NULL;
+
+	bfree(data);
+	return found;
+}
+
+static void save_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+	config_t *config;
+
+	cleanup();
+
+	/* a missing file is written on save even without changes */
+	assert_int_equal(config_open(&config, TEST_FILE, CONFIG_OPEN_ALWAYS),
+			 CONFIG_SUCCESS);
+	config_set_default_int(config, "General", "Value", 1);
+	os_unlink(TEST_FILE);
+	assert_int_equal(config_save_safe(config, "tmp", "bak"),
+			 CONFIG_SUCCESS);
+	assert_true(os_file_exists(TEST_FILE));
+
+	config_set_int(config, "General", "Value", 2);
+	assert_int_equal(config_save_safe(config, "tmp", "bak"),
+			 CONFIG_SUCCESS);
+	assert_true(file_has("Value=2"));
+
+	/* the file isn't written when nothing changed, which the contents
+	 * written behind the back of the config show */
+	write_file("[General]\nValue=3\n");
+
+	config_set_int(config, "General", "Value", 2);
+	config_set_default_int(config, "General", "Other", 5);
+	assert_int_equal(config_save_safe(config, "tmp", "bak"),
+			 CONFIG_SUCCESS);
+	assert_true(file_has("Value=3"));
+
+	/* a changed value is written */
+	config_set_int(config, "General", "Value", 4);
+	assert_int_equal(config_save_safe(config, "tmp", "bak"),
+			 CONFIG_SUCCESS);
+	assert_true(file_has("Value=4"));
+
+	/* so is a new one */
+	write_file("[General]\nValue=3\n");
+	config_set_bool(config, "Video", "Enabled", true);
+	assert_int_equal(config_save_safe(config, "tmp", "bak"),
+			 CONFIG_SUCCESS);
+	assert_true(file_has("Enabled=true"));
+
+	/* and a removed one */
+	write_file("[General]\nValue=3\n");
+	assert_true(config_remove_value(config, "Video", "Enabled"));
+	assert_int_equal(config_save_safe(config, "tmp", "bak"),
+			 CONFIG_SUCCESS);
+	assert_true(file_has("Value=4"));
+	assert_false(file_has("Enabled"));
+
+	config_close(config);
+
+	/* a loaded file keeps its values */
+	assert_int_equal(config_open(&config, TEST_FILE, CONFIG_OPEN_EXISTING),
+			 CONFIG_SUCCESS);
+	assert_int_equal(config_get_int(config, "General", "Value"), 4);
+	config_close(config);
+
+	cleanup();
+}
+
+static void repeated_section_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+	config_t *config;
+	char *data;
+
+	cleanup();
+
+	/* the first section of a name is the one looked up, and repeated
+	 * ones are written back where they were */
+	write_file("[A]\nValue=1\n[B]\nValue=2\n[A]\nValue=3\n");
+	assert_int_equal(config_open(&config, TEST_FILE, CONFIG_OPEN_EXISTING),
+			 CONFIG_SUCCESS);
+	assert_int_equal(config_num_sections(config), 3);
+	assert_int_equal(config_get_int(config, "A", "Value"), 1);
+
+	config_set_int(config, "A", "Value", 4);
+	assert_int_equal(config_save_safe(config, "tmp", "bak"),
+			 CONFIG_SUCCESS);
+	config_close(config);
+
+	data = os_quick_read_utf8_file(TEST_FILE);
+	assert_non_null(data);
+	assert_non_null(strstr(data, "[A]\nValue=4\n\n[B]\nValue=2\n\n"
+				     "[A]\nValue=3\n"));
+	bfree(data);
+
+	cleanup();
+}
+
+static void deferred_save_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+	config_t *config;
+	uint64_t start;
+
+	cleanup();
+
+	assert_int_equal(config_open(&config, TEST_FILE, CONFIG_OPEN_ALWAYS),
+			 CONFIG_SUCCESS);
+	config_set_int(config, "General", "Value", 1);
+	assert_int_equal(config_save_safe_deferred(config, "tmp", "bak"),
+			 CONFIG_SUCCESS);
+
+	/* closing doesn't wait out the save delay, but still saves */
+	os_sleep_ms(100);
+	start = os_gettime_ns();
+	config_close(config);
+	assert_true(os_gettime_ns() - start < 500000000ULL);
+	assert_true(file_has("Value=1"));
+
+	cleanup();
+}
+
+int main()
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(lookup_test),
+		cmocka_unit_test(save_test),
+		cmocka_unit_test(repeated_section_test),
+		cmocka_unit_test(deferred_save_test),
+	};
+
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}
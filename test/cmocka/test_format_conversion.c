@@ -0,0 +1,337 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <media-io/format-conversion.h>
+#include <util/bmem.h>
+
+#define HEIGHT 6
+#define PADDING 32
+
+struct frame {
+	uint8_t *data[MAX_AV_PLANES];
+	uint32_t linesize[MAX_AV_PLANES];
+	uint32_t rows[MAX_AV_PLANES];
+	uint32_t planes;
+};
+
+struct pair {
+	enum video_format src;
+	enum video_format dst;
+};
+
+static const struct pair pairs[] = {
+	{VIDEO_FORMAT_NV12, VIDEO_FORMAT_I420},
+	{VIDEO_FORMAT_I420, VIDEO_FORMAT_NV12},
+	{VIDEO_FORMAT_RGBA, VIDEO_FORMAT_BGRA},
+	{VIDEO_FORMAT_BGRA, VIDEO_FORMAT_RGBA},
+	{VIDEO_FORMAT_RGBA, VIDEO_FORMAT_BGRX},
+	{VIDEO_FORMAT_BGRX, VIDEO_FORMAT_RGBA},
+	{VIDEO_FORMAT_BGRX, VIDEO_FORMAT_BGRA},
+	{VIDEO_FORMAT_BGRA, VIDEO_FORMAT_BGRX},
+	{VIDEO_FORMAT_I40A, VIDEO_FORMAT_I420},
+	{VIDEO_FORMAT_I42A, VIDEO_FORMAT_I422},
+	{VIDEO_FORMAT_YUVA, VIDEO_FORMAT_I444},
+	{VIDEO_FORMAT_YUY2, VIDEO_FORMAT_I422},
+	{VIDEO_FORMAT_UYVY, VIDEO_FORMAT_I422},
+	{VIDEO_FORMAT_YVYU, VIDEO_FORMAT_I422},
+	{VIDEO_FORMAT_P010, VIDEO_FORMAT_I010},
+	{VIDEO_FORMAT_I010, VIDEO_FORMAT_P010},
+};
+
+/* odd multiples of the vector sizes, so every kernel runs its tail */
+static const uint32_t widths[] = {2, 6, 30, 34, 62, 66, 98, 1922};
+
+#define NUM_PAIRS (sizeof(pairs) / sizeof(pairs[0]))
+#define NUM_WIDTHS (sizeof(widths) / sizeof(widths[0]))
+
+static void frame_init(struct frame *f, enum video_format format,
+		       uint32_t width)
+{
+	uint32_t w = width;
+	uint32_t h = HEIGHT;
+
+	memset(f, 0, sizeof(*f));
+
+	switch (format) {
+	case VIDEO_FORMAT_NV12:
+		f->planes = 2;
+		f->linesize[0] = w, f->rows[0] = h;
+		f->linesize[1] = w, f->rows[1] = h / 2;
+		break;
+	case VIDEO_FORMAT_I420:
+	case VIDEO_FORMAT_I40A:
+		f->planes = format == VIDEO_FORMAT_I40A ? 4 : 3;
+		f->linesize[0] = f->linesize[3] = w;
+		f->rows[0] = f->rows[3] = h;
+		f->linesize[1] = f->linesize[2] = w / 2;
+		f->rows[1] = f->rows[2] = h / 2;
+		break;
+	case VIDEO_FORMAT_I422:
+	case VIDEO_FORMAT_I42A:
+		f->planes = format == VIDEO_FORMAT_I42A ? 4 : 3;
+		f->linesize[0] = f->linesize[3] = w;
+		f->linesize[1] = f->linesize[2] = w / 2;
+		f->rows[0] = f->rows[1] = f->rows[2] = f->rows[3] = h;
+		break;
+	case VIDEO_FORMAT_I444:
+	case VIDEO_FORMAT_YUVA:
+		f->planes = format == VIDEO_FORMAT_YUVA ? 4 : 3;
+		for (size_t i = 0; i < f->planes; i++)
+			f->linesize[i] = w, f->rows[i] = h;
+		break;
+	case VIDEO_FORMAT_RGBA:
+	case VIDEO_FORMAT_BGRA:
+	case VIDEO_FORMAT_BGRX:
+		f->planes = 1;
+		f->linesize[0] = w * 4, f->rows[0] = h;
+		break;
+	case VIDEO_FORMAT_YUY2:
+	case VIDEO_FORMAT_UYVY:
+	case VIDEO_FORMAT_YVYU:
+		f->planes = 1;
+		f->linesize[0] = w * 2, f->rows[0] = h;
+		break;
+	case VIDEO_FORMAT_P010:
+		f->planes = 2;
+		f->linesize[0] = w * 2, f->rows[0] = h;
+		f->linesize[1] = w * 2, f->rows[1] = h / 2;
+		break;
+	case VIDEO_FORMAT_I010:
+		f->planes = 3;
+		f->linesize[0] = w * 2, f->rows[0] = h;
+		f->linesize[1] = f->linesize[2] = w;
+		f->rows[1] = f->rows[2] = h / 2;
+		break;
+	default:
+		fail();
+	}
+
+	/* padded rows, which converters must not write to */
+	for (size_t i = 0; i < f->planes; i++) {
+		size_t size = (size_t)(f->linesize[i] + PADDING) * f->rows[i];
+
+		f->data[i] = bmalloc(size);
+		for (size_t j = 0; j < size; j++)
+			f->data[i][j] = (uint8_t)rand();
+		f->linesize[i] += PADDING;
+	}
+}
+
+static void frame_free(struct frame *f)
+{
+	for (size_t i = 0; i < f->planes; i++)
+		bfree(f->data[i]);
+}
+
+static inline uint8_t *row(const struct frame *f, size_t plane, uint32_t y)
+{
+	return f->data[plane] + (size_t)y * f->linesize[plane];
+}
+
+static void copy_plane(const struct frame *in, size_t in_plane,
+		       struct frame *out, size_t out_plane)
+{
+	size_t size = out->linesize[out_plane] - PADDING;
+
+	for (uint32_t y = 0; y < out->rows[out_plane]; y++)
+		memcpy(row(out, out_plane, y), row(in, in_plane, y), size);
+}
+
+/* plain C reference of every conversion */
+static void reference(const struct pair *p, const struct frame *in,
+		      struct frame *out, uint32_t w)
+{
+	switch (p->src) {
+	case VIDEO_FORMAT_NV12:
+		copy_plane(in, 0, out, 0);
+		for (uint32_t y = 0; y < HEIGHT / 2; y++) {
+			for (uint32_t x = 0; x < w / 2; x++) {
+				row(out, 1, y)[x] = row(in, 1, y)[x * 2];
+				row(out, 2, y)[x] = row(in, 1, y)[x * 2 + 1];
+			}
+		}
+		break;
+	case VIDEO_FORMAT_I420:
+		copy_plane(in, 0, out, 0);
+		for (uint32_t y = 0; y < HEIGHT / 2; y++) {
+			for (uint32_t x = 0; x < w / 2; x++) {
+				row(out, 1, y)[x * 2] = row(in, 1, y)[x];
+				row(out, 1, y)[x * 2 + 1] = row(in, 2, y)[x];
+			}
+		}
+		break;
+	case VIDEO_FORMAT_RGBA:
+	case VIDEO_FORMAT_BGRA:
+	case VIDEO_FORMAT_BGRX:
+		for (uint32_t y = 0; y < HEIGHT; y++) {
+			const uint8_t *src = row(in, 0, y);
+			uint8_t *dst = row(out, 0, y);
+			bool swap = p->src == VIDEO_FORMAT_RGBA ||
+				    p->dst == VIDEO_FORMAT_RGBA;
+			bool fill = p->src == VIDEO_FORMAT_BGRX &&
+				    p->dst != VIDEO_FORMAT_BGRX;
+
+			for (uint32_t x = 0; x < w; x++) {
+				dst[x * 4] = src[x * 4 + (swap ? 2 : 0)];
+				dst[x * 4 + 1] = src[x * 4 + 1];
+				dst[x * 4 + 2] = src[x * 4 + (swap ? 0 : 2)];
+				dst[x * 4 + 3] = fill ? 0xFF : src[x * 4 + 3];
+			}
+		}
+		break;
+	case VIDEO_FORMAT_I40A:
+	case VIDEO_FORMAT_I42A:
+	case VIDEO_FORMAT_YUVA:
+		for (size_t i = 0; i < 3; i++)
+			copy_plane(in, i, out, i);
+		break;
+	case VIDEO_FORMAT_YUY2:
+	case VIDEO_FORMAT_UYVY:
+	case VIDEO_FORMAT_YVYU: {
+		/* byte offsets of Y0, U and V in each pair of pixels */
+		size_t y_idx = p->src == VIDEO_FORMAT_UYVY ? 1 : 0;
+		size_t u_idx = p->src == VIDEO_FORMAT_YUY2   ? 1
+			       : p->src == VIDEO_FORMAT_UYVY ? 0
+							     : 3;
+		size_t v_idx = p->src == VIDEO_FORMAT_YUY2   ? 3
+			       : p->src == VIDEO_FORMAT_UYVY ? 2
+							     : 1;
+
+		for (uint32_t y = 0; y < HEIGHT; y++) {
+			const uint8_t *src = row(in, 0, y);
+
+			for (uint32_t x = 0; x < w; x += 2) {
+				row(out, 0, y)[x] = src[x * 2 + y_idx];
+				row(out, 0, y)[x + 1] = src[x * 2 + y_idx + 2];
+				row(out, 1, y)[x / 2] = src[x * 2 + u_idx];
+				row(out, 2, y)[x / 2] = src[x * 2 + v_idx];
+			}
+		}
+		break;
+	}
+	case VIDEO_FORMAT_P010:
+		for (uint32_t y = 0; y < HEIGHT; y++) {
+			const uint16_t *src = (uint16_t *)row(in, 0, y);
+			uint16_t *dst = (uint16_t *)row(out, 0, y);
+
+			for (uint32_t x = 0; x < w; x++)
+				dst[x] = src[x] >> 6;
+		}
+		for (uint32_t y = 0; y < HEIGHT / 2; y++) {
+			const uint16_t *src = (uint16_t *)row(in, 1, y);
+
+			for (uint32_t x = 0; x < w / 2; x++) {
+				((uint16_t *)row(out, 1, y))[x] =
+					src[x * 2] >> 6;
+				((uint16_t *)row(out, 2, y))[x] =
+					src[x * 2 + 1] >> 6;
+			}
+		}
+		break;
+	case VIDEO_FORMAT_I010:
+		for (uint32_t y = 0; y < HEIGHT; y++) {
+			const uint16_t *src = (uint16_t *)row(in, 0, y);
+			uint16_t *dst = (uint16_t *)row(out, 0, y);
+
+			for (uint32_t x = 0; x < w; x++)
+				dst[x] = (uint16_t)(src[x] << 6);
+		}
+		for (uint32_t y = 0; y < HEIGHT / 2; y++) {
+			uint16_t *dst = (uint16_t *)row(out, 1, y);
+
+			for (uint32_t x = 0; x < w / 2; x++) {
+				dst[x * 2] = (uint16_t)(
+					((uint16_t *)row(in, 1, y))[x] << 6);
+				dst[x * 2 + 1] = (uint16_t)(
+					((uint16_t *)row(in, 2, y))[x] << 6);
+			}
+		}
+		break;
+	default:
+		fail();
+	}
+}
+
+static void check_frames(const struct frame *a, const struct frame *b)
+{
+	for (size_t i = 0; i < a->planes; i++) {
+		size_t size = (size_t)a->linesize[i] * a->rows[i];
+		assert_memory_equal(a->data[i], b->data[i], size);
+	}
+}
+
+static void convert_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	for (size_t i = 0; i < NUM_PAIRS; i++) {
+		const struct pair *p = &pairs[i];
+		video_format_convert_t convert =
+			video_format_get_convert(p->src, p->dst);
+
+		assert_non_null(convert);
+
+		for (size_t j = 0; j < NUM_WIDTHS; j++) {
+			uint32_t w = widths[j];
+			struct frame in, out, sliced, ref;
+
+			frame_init(&in, p->src, w);
+			frame_init(&out, p->dst, w);
+			frame_init(&sliced, p->dst, w);
+			frame_init(&ref, p->dst, w);
+
+			/* same padding contents in every output */
+			for (size_t k = 0; k < out.planes; k++) {
+				size_t size = (size_t)out.linesize[k] *
+					      out.rows[k];
+				memcpy(sliced.data[k], out.data[k], size);
+				memcpy(ref.data[k], out.data[k], size);
+			}
+
+			reference(p, &in, &ref, w);
+
+			convert((const uint8_t *const *)in.data, in.linesize,
+				w, 0, HEIGHT, out.data, out.linesize);
+			check_frames(&out, &ref);
+
+			/* converting in slices gives the same frame */
+			convert((const uint8_t *const *)in.data, in.linesize,
+				w, 0, 2, sliced.data, sliced.linesize);
+			convert((const uint8_t *const *)in.data, in.linesize,
+				w, 2, HEIGHT, sliced.data, sliced.linesize);
+			check_frames(&sliced, &ref);
+
+			frame_free(&in);
+			frame_free(&out);
+			frame_free(&sliced);
+			frame_free(&ref);
+		}
+	}
+}
+
+static void unsupported_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	assert_null(video_format_get_convert(VIDEO_FORMAT_I444,
+					     VIDEO_FORMAT_I420));
+	assert_null(video_format_get_convert(VIDEO_FORMAT_NV12,
+					     VIDEO_FORMAT_NV12));
+	assert_null(video_format_get_convert(VIDEO_FORMAT_RGBA,
+					     VIDEO_FORMAT_I420));
+}
+
+int main()
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(convert_test),
+		cmocka_unit_test(unsupported_test),
+	};
+
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}
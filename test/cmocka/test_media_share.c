@@ -0,0 +1,167 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include <obs.h>
+#include <util/platform.h>
+#include <util/threading.h>
+#include <media-playback/media.h>
+#include <media-playback/share.h>
+
+#define TEST_WAV "test_media_share.wav"
+
+#define SAMPLE_RATE 48000
+#define SAMPLES (SAMPLE_RATE / 10)
+
+struct subscriber {
+	mp_media_t media;
+	os_event_t *stopped;
+	bool leave;
+};
+
+static void put_u32(uint8_t *p, uint32_t val)
+{
+	p[0] = (uint8_t)val;
+	p[1] = (uint8_t)(val >> 8);
+	p[2] = (uint8_t)(val >> 16);
+	p[3] = (uint8_t)(val >> 24);
+}
+
+/* 100 ms of silence, mono 16 bit */
+static void write_wav(void)
+{
+	const uint32_t data_size = SAMPLES * 2;
+	uint8_t header[44] = "RIFF....WAVEfmt ....\1\0\1\0"
+			     "........\2\0\20\0data....";
+	FILE *f = os_fopen(TEST_WAV, "wb");
+	uint8_t *samples = bzalloc(data_size);
+
+	put_u32(header + 4, 36 + data_size);
+	put_u32(header + 16, 16);
+	put_u32(header + 24, SAMPLE_RATE);
+	put_u32(header + 28, SAMPLE_RATE * 2);
+	put_u32(header + 40, data_size);
+
+	assert_non_null(f);
+	assert_int_equal(fwrite(header, 1, sizeof(header), f), sizeof(header));
+	assert_int_equal(fwrite(samples, 1, data_size, f), data_size);
+	fclose(f);
+	bfree(samples);
+}
+
+static void audio_cb(void *opaque, struct obs_source_audio *audio)
+{
+	UNUSED_PARAMETER(opaque);
+	UNUSED_PARAMETER(audio);
+}
+
+/* leaving from here runs on the thread of the shared media */
+static void stop_cb(void *opaque)
+{
+	struct subscriber *sub = opaque;
+
+	if (sub->leave)
+		mp_share_unsubscribe(&sub->media);
+	os_event_signal(sub->stopped);
+}
+
+static void init_subscriber(struct subscriber *sub, bool leave)
+{
+	struct mp_media_info info = {
+		.opaque = sub,
+		.a_cb = audio_cb,
+		.stop_cb = stop_cb,
+		.path = TEST_WAV,
+		.speed = 100,
+		.is_local_file = true,
+		.shareable = true,
+	};
+
+	sub->leave = leave;
+	assert_int_equal(os_event_init(&sub->stopped, OS_EVENT_TYPE_MANUAL),
+			 0);
+	assert_true(mp_media_init(&sub->media, &info));
+	assert_non_null(sub->media.share);
+}
+
+static void free_subscriber(struct subscriber *sub)
+{
+	mp_media_free(&sub->media);
+	os_event_destroy(sub->stopped);
+}
+
+static int setup(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	if (!obs_startup("en-US", NULL, NULL))
+		return -1;
+
+	write_wav();
+	return 0;
+}
+
+static int teardown(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	os_unlink(TEST_WAV);
+	obs_shutdown();
+	return 0;
+}
+
+/* the shared media is freed off its own thread once the callback returns */
+static void last_leaves_in_stop_cb_test(void **state)
+{
+	struct subscriber sub;
+
+	UNUSED_PARAMETER(state);
+
+	init_subscriber(&sub, true);
+	mp_media_play(&sub.media, false, false);
+
+	assert_int_equal(os_event_timedwait(sub.stopped, 10000), 0);
+	mp_share_wait();
+	assert_null(sub.media.share);
+
+	free_subscriber(&sub);
+}
+
+static void other_leaves_in_stop_cb_test(void **state)
+{
+	struct subscriber leaving;
+	struct subscriber staying;
+
+	UNUSED_PARAMETER(state);
+
+	init_subscriber(&leaving, true);
+	init_subscriber(&staying, false);
+	assert_ptr_equal(leaving.media.share, staying.media.share);
+
+	/* both loop through the shared media, stopping one of them only
+	 * stops it, stopping the other then stops the shared media */
+	mp_media_play(&leaving.media, true, false);
+	mp_media_play(&staying.media, true, false);
+	mp_media_stop(&staying.media);
+	assert_int_equal(os_event_try(staying.stopped), 0);
+	mp_media_stop(&leaving.media);
+
+	assert_int_equal(os_event_timedwait(leaving.stopped, 10000), 0);
+	assert_null(leaving.media.share);
+	assert_non_null(staying.media.share);
+
+	/* the last subscriber leaving outside of a callback frees it at once */
+	free_subscriber(&staying);
+	free_subscriber(&leaving);
+}
+
+int main()
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(last_leaves_in_stop_cb_test),
+		cmocka_unit_test(other_leaves_in_stop_cb_test),
+	};
+
+	return cmocka_run_group_tests(tests, setup, teardown);
+}
@@ -0,0 +1,248 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include <stdio.h>
+
+#include <obs.h>
+#include <util/bmem.h>
+
+#define TEST_SOURCE_ID "name_index_test_source"
+#define TEST_SERVICE_ID "name_index_test_service"
+
+/* more than the initial bucket count, so the index has to grow */
+#define NUM_SOURCES 300
+
+static const char *test_get_name(void *type_data)
+{
+	UNUSED_PARAMETER(type_data);
+	return "Name index test";
+}
+
+static void *test_source_create(obs_data_t *settings, obs_source_t *source)
+{
+	UNUSED_PARAMETER(settings);
+	UNUSED_PARAMETER(source);
+	return bzalloc(1);
+}
+
+static void *test_service_create(obs_data_t *settings, obs_service_t *service)
+{
+	UNUSED_PARAMETER(settings);
+	UNUSED_PARAMETER(service);
+	return bzalloc(1);
+}
+
+static void test_destroy(void *data)
+{
+	bfree(data);
+}
+
+static struct obs_source_info test_source = {
+	.id = TEST_SOURCE_ID,
+	.type = OBS_SOURCE_TYPE_INPUT,
+	.get_name = test_get_name,
+	.create = test_source_create,
+	.destroy = test_destroy,
+};
+
+static struct obs_service_info test_service = {
+	.id = TEST_SERVICE_ID,
+	.get_name = test_get_name,
+	.create = test_service_create,
+	.destroy = test_destroy,
+};
+
+static obs_source_t *create_source(const char *name)
+{
+	obs_source_t *source =
+		obs_source_create(TEST_SOURCE_ID, name, NULL, NULL);
+	assert_non_null(source);
+	return source;
+}
+
+/* looks up a source by name and returns it without holding a reference */
+static obs_source_t *find_source(const char *name)
+{
+	obs_source_t *source = obs_get_source_by_name(name);
+	obs_source_release(source);
+	return source;
+}
+
+static int setup(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	if (!obs_startup("en-US", NULL, NULL))
+		return -1;
+
+	obs_register_source(&test_source);
+	obs_register_service(&test_service);
+	return 0;
+}
+
+static int teardown(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	obs_shutdown();
+	return 0;
+}
+
+static void lookup_test(void **state)
+{
+	obs_source_t *sources[NUM_SOURCES];
+	char name[32];
+
+	UNUSED_PARAMETER(state);
+
+	for (size_t i = 0; i < NUM_SOURCES; i++) {
+		snprintf(name, sizeof(name), "Source %zu", i);
+		sources[i] = create_source(name);
+	}
+
+	for (size_t i = 0; i < NUM_SOURCES; i++) {
+		snprintf(name, sizeof(name), "Source %zu", i);
+		assert_ptr_equal(find_source(name), sources[i]);
+	}
+
+	assert_null(find_source("Source"));
+	assert_null(find_source("source 0"));
+	assert_null(find_source(""));
+	assert_null(obs_get_source_by_name(NULL));
+
+	/* renaming moves every source to another bucket, while the others
+	 * sharing its old bucket must stay reachable */
+	for (size_t i = 0; i < NUM_SOURCES; i++) {
+		snprintf(name, sizeof(name), "Renamed %zu", i);
+		obs_source_set_name(sources[i], name);
+	}
+
+	for (size_t i = 0; i < NUM_SOURCES; i++) {
+		snprintf(name, sizeof(name), "Source %zu", i);
+		assert_null(find_source(name));
+		snprintf(name, sizeof(name), "Renamed %zu", i);
+		assert_ptr_equal(find_source(name), sources[i]);
+	}
+
+	for (size_t i = 0; i < NUM_SOURCES; i++)
+		obs_source_release(sources[i]);
+
+	for (size_t i = 0; i < NUM_SOURCES; i++) {
+		snprintf(name, sizeof(name), "Renamed %zu", i);
+		assert_null(find_source(name));
+	}
+}
+
+static void rename_test(void **state)
+{
+	obs_source_t *source = create_source("Before");
+	obs_source_t *other = create_source("Other");
+
+	UNUSED_PARAMETER(state);
+
+	obs_source_set_name(source, "After");
+	assert_null(find_source("Before"));
+	assert_ptr_equal(find_source("After"), source);
+	assert_ptr_equal(find_source("Other"), other);
+
+	obs_source_release(source);
+	assert_null(find_source("After"));
+	assert_ptr_equal(find_source("Other"), other);
+
+	obs_source_release(other);
+}
+
+static void duplicate_test(void **state)
+{
+	obs_source_t *older = create_source("Duplicate");
+	obs_source_t *newer = create_source("Duplicate");
+
+	UNUSED_PARAMETER(state);
+
+	/* the most recently created context wins, as with the list walk */
+	assert_ptr_equal(find_source("Duplicate"), newer);
+
+	obs_source_release(newer);
+	assert_ptr_equal(find_source("Duplicate"), older);
+
+	obs_source_release(older);
+	assert_null(find_source("Duplicate"));
+}
+
+static void duplicate_rename_test(void **state)
+{
+	obs_source_t *older = create_source("Older");
+	obs_source_t *newer = create_source("Duplicate");
+
+	UNUSED_PARAMETER(state);
+
+	/* renaming doesn't change which one wins, the list walk found the
+	 * most recently created one no matter the renames */
+	obs_source_set_name(older, "Duplicate");
+	assert_ptr_equal(find_source("Duplicate"), newer);
+
+	obs_source_set_name(newer, "Newer");
+	assert_ptr_equal(find_source("Duplicate"), older);
+
+	obs_source_set_name(newer, "Duplicate");
+	assert_ptr_equal(find_source("Duplicate"), newer);
+
+	obs_source_release(newer);
+	assert_ptr_equal(find_source("Duplicate"), older);
+
+	obs_source_release(older);
+	assert_null(find_source("Duplicate"));
+}
+
+static void private_test(void **state)
+{
+	obs_source_t *source =
+		obs_source_create_private(TEST_SOURCE_ID, "Private", NULL);
+
+	UNUSED_PARAMETER(state);
+
+	assert_non_null(source);
+	assert_null(find_source("Private"));
+
+	obs_source_set_name(source, "Still private");
+	assert_null(find_source("Still private"));
+
+	obs_source_release(source);
+}
+
+static void service_test(void **state)
+{
+	obs_service_t *service =
+		obs_service_create(TEST_SERVICE_ID, "Service", NULL, NULL);
+	obs_service_t *found;
+
+	UNUSED_PARAMETER(state);
+
+	assert_non_null(service);
+
+	found = obs_get_service_by_name("Service");
+	assert_ptr_equal(found, service);
+	obs_service_release(found);
+
+	/* the indexes of different context types are separate */
+	assert_null(find_source("Service"));
+
+	obs_service_release(service);
+	assert_null(obs_get_service_by_name("Service"));
+}
+
+int main()
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(lookup_test),
+		cmocka_unit_test(rename_test),
+		cmocka_unit_test(duplicate_test),
+		cmocka_unit_test(duplicate_rename_test),
+		cmocka_unit_test(private_test),
+		cmocka_unit_test(service_test),
+	};
+
+	return cmocka_run_group_tests(tests, setup, teardown);
+}
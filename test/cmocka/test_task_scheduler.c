@@ -0,0 +1,146 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include <util/threading.h>
+#include <util/bmem.h>
+
+#define NUM_ITEMS 10000
+
+static void count_task(void *param)
+{
+	os_atomic_inc_long(param);
+}
+
+static void queue_wait_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+	os_task_scheduler_t *ts = os_task_scheduler_create(4);
+	volatile long count = 0;
+
+	assert_non_null(ts);
+
+	for (int i = 0; i < 1000; i++)
+		os_task_scheduler_queue(ts, count_task, (void *)&count,
+					(enum os_task_priority)(i % 3), i % 5);
+
+	os_task_scheduler_wait(ts);
+	assert_int_equal(count, 1000);
+
+	os_task_scheduler_destroy(ts);
+}
+
+static void mark_range(void *param, size_t start, size_t end)
+{
+	volatile long *marks = param;
+
+	for (size_t i = start; i < end; i++)
+		os_atomic_inc_long(&marks[i]);
+}
+
+static void parallel_for_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+	os_task_scheduler_t *ts = os_task_scheduler_create(4);
+	volatile long *marks = bzalloc(sizeof(long) * NUM_ITEMS);
+	size_t grains[] = {0, 1, 7, NUM_ITEMS - 1, NUM_ITEMS, NUM_ITEMS * 2};
+
+	for (size_t g = 0; g < sizeof(grains) / sizeof(grains[0]); g++) {
+		memset((void *)marks, 0, sizeof(long) * NUM_ITEMS);
+		os_task_scheduler_parallel_for(ts, NUM_ITEMS, grains[g],
+					       mark_range, (void *)marks);
+
+		for (size_t i = 0; i < NUM_ITEMS; i++)
+			assert_int_equal(marks[i], 1);
+	}
+
+	/* without a scheduler everything runs on the calling thread */
+	memset((void *)marks, 0, sizeof(long) * NUM_ITEMS);
+	os_task_scheduler_parallel_for(NULL, NUM_ITEMS, 16, mark_range,
+				       (void *)marks);
+	for (size_t i = 0; i < NUM_ITEMS; i++)
+		assert_int_equal(marks[i], 1);
+
+	bfree((void *)marks);
+	os_task_scheduler_destroy(ts);
+}
+
+/* many short calls: helpers still queued when a call returns must not touch
+ * anything owned by the caller */
+static void parallel_for_repeat_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+	os_task_scheduler_t *ts = os_task_scheduler_create(4);
+
+	for (int i = 0; i < 2000; i++) {
+		volatile long marks[16] = {0};
+
+		os_task_scheduler_parallel_for(ts, 16, 1, mark_range,
+					       (void *)marks);
+		for (size_t j = 0; j < 16; j++)
+			assert_int_equal(marks[j], 1);
+	}
+
+	os_task_scheduler_destroy(ts);
+}
+
+struct nested_data {
+	os_task_scheduler_t *ts;
+	volatile long total;
+};
+
+static void nested_inner(void *param, size_t start, size_t end)
+{
+	struct nested_data *data = param;
+
+	for (size_t i = start; i < end; i++)
+		os_atomic_inc_long(&data->total);
+}
+
+static void nested_outer(void *param, size_t start, size_t end)
+{
+	struct nested_data *data = param;
+
+	for (size_t i = start; i < end; i++)
+		os_task_scheduler_parallel_for(data->ts, 64, 4, nested_inner,
+					       data);
+}
+
+static void nested_task(void *param)
+{
+	struct nested_data *data = param;
+
+	os_task_scheduler_parallel_for(data->ts, 8, 1, nested_outer, data);
+}
+
+/* parallel_for inside tasks and inside other parallel_for calls, with every
+ * worker busy, must not deadlock */
+static void nested_parallel_for_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+	struct nested_data data = {0};
+
+	data.ts = os_task_scheduler_create(2);
+
+	for (int i = 0; i < 8; i++)
+		os_task_scheduler_queue(data.ts, nested_task, &data,
+					OS_TASK_PRIORITY_NORMAL, -1);
+
+	os_task_scheduler_wait(data.ts);
+	assert_int_equal(data.total, 8 * 8 * 64);
+
+	os_task_scheduler_destroy(data.ts);
+}
+
+int main()
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(queue_wait_test),
+		cmocka_unit_test(parallel_for_test),
+		cmocka_unit_test(parallel_for_repeat_test),
+		cmocka_unit_test(nested_parallel_for_test),
+	};
+
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,181 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <sys/utime.h>
+#define utime _utime
+#define utimbuf _utimbuf
+#else
+#include <utime.h>
+#endif
+
+#include <util/text-lookup.h>
+#include <util/platform.h>
+#include <util/bmem.h>
+
+#define TEST_INI "test_text_lookup.ini"
+#define TEST_TABLE "test_text_lookup.locale"
+
+static const char *ini_a = "Key1=\"First\"\n"
+			   "Key2=\"Line\\nBreak \\\"quoted\\\"\"\n"
+			   "# comment\n"
+			   "Dup=\"old\"\n"
+			   "Dup=\"new\"\n";
+
+static const char *ini_b = "Key1=\"Changed\"\n";
+
+static void write_file(const char *path, const char *data, time_t mtime)
+{
+	struct utimbuf times = {mtime, mtime};
+
+	assert_true(os_quick_write_utf8_file(path, data, strlen(data), false));
+	assert_int_equal(utime(path, &times), 0);
+}
+
+static void set_mtime(const char *path, time_t mtime)
+{
+	struct utimbuf times = {mtime, mtime};
+	assert_int_equal(utime(path, &times), 0);
+}
+
+static void cleanup(void)
+{
+	os_unlink(TEST_INI);
+	os_unlink(TEST_TABLE);
+}
+
+static void check_lookup(const char *key, const char *expected)
+{
+	lookup_t *lookup = text_lookup_create(TEST_INI);
+	const char *val = NULL;
+
+	assert_non_null(lookup);
+	assert_true(text_lookup_getstr(lookup, key, &val));
+	assert_string_equal(val, expected);
+	text_lookup_destroy(lookup);
+}
+
+static void check_values(lookup_t *lookup)
+{
+	const char *val = NULL;
+
+	assert_true(text_lookup_getstr(lookup, "Key1", &val));
+	assert_string_equal(val, "First");
+	assert_true(text_lookup_getstr(lookup, "kEY1", &val));
+	assert_string_equal(val, "First");
+	assert_true(text_lookup_getstr(lookup, "Key2", &val));
+	assert_string_equal(val, "Line\nBreak \"quoted\"");
+	assert_true(text_lookup_getstr(lookup, "Dup", &val));
+	assert_string_equal(val, "new");
+	assert_false(text_lookup_getstr(lookup, "Key", &val));
+	assert_false(text_lookup_getstr(lookup, "Key10", &val));
+	assert_false(text_lookup_getstr(lookup, "Missing", &val));
+	assert_false(text_lookup_getstr(lookup, "", &val));
+}
+
+/* compiled tables return the same strings as the .ini they come from */
+static void compile_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+	time_t now = time(NULL);
+	lookup_t *lookup;
+
+	cleanup();
+	write_file(TEST_INI, ini_a, now - 100);
+
+	lookup = text_lookup_create(TEST_INI);
+	assert_non_null(lookup);
+	check_values(lookup);
+	text_lookup_destroy(lookup);
+
+	assert_true(text_lookup_compile(TEST_INI, NULL));
+	assert_true(os_file_exists(TEST_TABLE));
+
+	lookup = text_lookup_create(TEST_INI);
+	assert_non_null(lookup);
+	check_values(lookup);
+	text_lookup_destroy(lookup);
+
+	cleanup();
+}
+
+/* the table is used while it is up to date, and the .ini is parsed instead
+ * when the table is out of date, invalid or missing */
+static void fallback_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+	time_t now = time(NULL);
+
+	cleanup();
+	write_file(TEST_INI, ini_a, now - 100);
+	assert_true(text_lookup_compile(TEST_INI, NULL));
+	set_mtime(TEST_TABLE, now - 50);
+
+	/* the .ini changed without changing its time, the table wins */
+	write_file(TEST_INI, ini_b, now - 100);
+	check_lookup("Key1", "First");
+
+	/* the .ini is newer than the table */
+	set_mtime(TEST_INI, now);
+	check_lookup("Key1", "Changed");
+
+	/* the table is newer but invalid */
+	write_file(TEST_TABLE, "not a table", now + 100);
+	check_lookup("Key1", "Changed");
+
+	/* the table is missing */
+	os_unlink(TEST_TABLE);
+	check_lookup("Key1", "Changed");
+
+	/* a table without an .ini next to it still works */
+	write_file(TEST_INI, ini_a, now - 100);
+	assert_true(text_lookup_compile(TEST_INI, NULL));
+	os_unlink(TEST_INI);
+	check_lookup("Key2", "Line\nBreak \"quoted\"");
+
+	cleanup();
+}
+
+/* later text_lookup_add calls override earlier ones in both formats */
+static void layer_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+	time_t now = time(NULL);
+	const char *val = NULL;
+	lookup_t *lookup;
+
+	cleanup();
+	write_file(TEST_INI, ini_a, now - 100);
+	assert_true(text_lookup_compile(TEST_INI, NULL));
+	write_file("test_text_lookup2.ini", ini_b, now - 100);
+
+	lookup = text_lookup_create(TEST_INI);
+	assert_non_null(lookup);
+	assert_true(text_lookup_add(lookup, "test_text_lookup2.ini"));
+	assert_true(text_lookup_getstr(lookup, "Key1", &val));
+	assert_string_equal(val, "Changed");
+	assert_true(text_lookup_getstr(lookup, "Dup", &val));
+	assert_string_equal(val, "new");
+	text_lookup_destroy(lookup);
+
+	os_unlink("test_text_lookup2.ini");
+	cleanup();
+}
+
+int main()
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(compile_test),
+		cmocka_unit_test(fallback_test),
+		cmocka_unit_test(layer_test),
+	};
+
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,336 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include <stdio.h>
+#include <string.h>
+
+#include <libavcodec/avcodec.h>
+
+#include <obs.h>
+#include <util/platform.h>
+#include <util/bmem.h>
+
+#include "v4l2-mjpeg.h"
+
+#define TEST_FILE "test_v4l2_mjpeg.mjpeg"
+
+#define WIDTH 160
+#define HEIGHT 120
+#define FRAMES 60
+#define FRAME_NS 16666667ULL
+
+/* ------------------------------------------------------------------------- */
+/* the pool outputs to this instead of a source, see CMakeLists.txt */
+
+struct output {
+	uint64_t timestamp;
+	enum video_format format;
+	uint32_t width;
+	uint32_t height;
+	uint8_t luma;
+};
+
+static struct output outputs[FRAMES * 10];
+static size_t num_outputs;
+
+void test_v4l2_mjpeg_output(obs_source_t *source,
+			    const struct obs_source_frame2 *frame)
+{
+	struct output *out = &outputs[num_outputs++];
+
+	out->timestamp = frame->timestamp;
+	out->format = frame->format;
+	out->width = frame->width;
+	out->height = frame->height;
+	out->luma = frame->data[0][frame->height / 2 * frame->linesize[0] +
+				   frame->width / 2];
+
+	UNUSED_PARAMETER(source);
+}
+
+/* every frame of the recording is a flat gray of its own brightness */
+static inline uint8_t frame_luma(size_t frame)
+{
+	return (uint8_t)(32 + frame % FRAMES * 3);
+}
+
+/* ------------------------------------------------------------------------- */
+/* the recording is a plain sequence of JPEG images, as devices send them */
+
+static void write_recording(void)
+{
+	AVCodec *codec = avcodec_find_encoder(AV_CODEC_ID_MJPEG);
+	AVCodecContext *context;
+	AVPacket *packet = av_packet_alloc();
+	AVFrame *frame = av_frame_alloc();
+	FILE *f = os_fopen(TEST_FILE, "wb");
+
+	assert_non_null(codec);
+	assert_non_null(f);
+
+	context = avcodec_alloc_context3(codec);
+	context->width = WIDTH;
+	context->height = HEIGHT;
+	context->pix_fmt = AV_PIX_FMT_YUVJ420P;
+	context->time_base = (AVRational){1, 60};
+	assert_int_equal(avcodec_open2(context, codec, NULL), 0);
+
+	frame->format = context->pix_fmt;
+	frame->width = WIDTH;
+	frame->height = HEIGHT;
+	assert_int_equal(av_frame_get_buffer(frame, 0), 0);
+
+	for (int i = 0; i < FRAMES; i++) {
+		memset(frame->data[0], frame_luma(i),
+		       frame->linesize[0] * HEIGHT);
+		memset(frame->data[1], 128, frame->linesize[1] * HEIGHT / 2);
+		memset(frame->data[2], 128, frame->linesize[2] * HEIGHT / 2);
+		frame->pts = i;
+
+		assert_int_equal(avcodec_send_frame(context, frame), 0);
+		assert_int_equal(avcodec_receive_packet(context, packet), 0);
+		fwrite(packet->data, 1, packet->size, f);
+		av_packet_unref(packet);
+	}
+
+	fclose(f);
+	av_frame_free(&frame);
+	av_packet_free(&packet);
+	avcodec_free_context(&context);
+}
+
+struct recording {
+	uint8_t *data;
+	size_t size;
+	size_t offsets[FRAMES + 1];
+	size_t num_frames;
+};
+
+/* entropy coded data stuffs 0xFF bytes, so 0xFFD9 only shows up as the end
+ * of image marker */
+static void read_recording(struct recording *rec)
+{
+	FILE *f = os_fopen(TEST_FILE, "rb");
+
+	assert_non_null(f);
+	rec->size = (size_t)os_fgetsize(f);
+	rec->data = bmalloc(rec->size);
+	assert_int_equal(fread(rec->data, 1, rec->size, f), rec->size);
+	fclose(f);
+
+	rec->num_frames = 0;
+	rec->offsets[0] = 0;
+
+	for (size_t i = 0; i + 1 < rec->size; i++) {
+		if (rec->data[i] == 0xFF && rec->data[i + 1] == 0xD9) {
+			assert_true(rec->num_frames < FRAMES);
+			rec->offsets[++rec->num_frames] = i + 2;
+		}
+	}
+
+	assert_int_equal(rec->num_frames, FRAMES);
+}
+
+static void check_outputs(const struct v4l2_mjpeg_stats *stats)
+{
+	assert_int_equal(stats->decoded + stats->dropped + stats->failed,
+			 stats->submitted);
+	assert_int_equal(num_outputs, stats->decoded);
+
+	for (size_t i = 0; i < num_outputs; i++) {
+		const struct output *out = &outputs[i];
+		size_t frame = (size_t)(out->timestamp / FRAME_NS);
+		int diff = (int)out->luma - (int)frame_luma(frame);
+
+		if (i)
+			assert_true(out->timestamp > outputs[i - 1].timestamp);
+
+		assert_int_equal(out->format, VIDEO_FORMAT_I420);
+		assert_int_equal(out->width, WIDTH);
+		assert_int_equal(out->height, HEIGHT);
+
+		/* the frame is the one submitted with this timestamp */
+		assert_true(diff >= -2 && diff <= 2);
+	}
+}
+
+static void print_stats(const struct v4l2_mjpeg_stats *stats)
+{
+	printf("%llu submitted, %llu decoded, %llu dropped, %llu failed, "
+	       "latency %.2fms average, %.2fms max\n",
+	       (unsigned long long)stats->submitted,
+	       (unsigned long long)stats->decoded,
+	       (unsigned long long)stats->dropped,
+	       (unsigned long long)stats->failed,
+	       stats->decoded ? (double)stats->latency_ns /
+					(double)stats->decoded / 1e6
+			      : 0.0,
+	       (double)stats->max_latency_ns / 1e6);
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* a single decoder, and as many as the pool uses at most */
+static const size_t thread_counts[] = {1, 4};
+
+#define NUM_THREAD_COUNTS (sizeof(thread_counts) / sizeof(thread_counts[0]))
+
+/* at the rate of a 60 fps device nothing is dropped */
+static void device_rate(const struct recording *rec, size_t threads)
+{
+	struct v4l2_mjpeg_pool *pool =
+		v4l2_mjpeg_pool_create(NULL, VIDEO_RANGE_DEFAULT, threads);
+	struct v4l2_mjpeg_stats stats;
+	uint64_t start = os_gettime_ns();
+
+	assert_non_null(pool);
+	num_outputs = 0;
+
+	for (size_t i = 0; i < rec->num_frames; i++) {
+		size_t offset = rec->offsets[i];
+
+		os_sleepto_ns(start + i * FRAME_NS);
+		assert_true(v4l2_mjpeg_pool_submit(
+			pool, rec->data + offset,
+			rec->offsets[i + 1] - offset, i * FRAME_NS));
+	}
+
+	v4l2_mjpeg_pool_get_stats(pool, &stats);
+	v4l2_mjpeg_pool_destroy(pool);
+
+	printf("device rate, %zu threads: ", threads);
+	print_stats(&stats);
+	assert_int_equal(stats.submitted, FRAMES);
+	assert_int_equal(stats.decoded, FRAMES);
+	assert_int_equal(stats.dropped, 0);
+	assert_int_equal(stats.failed, 0);
+	check_outputs(&stats);
+}
+
+/* submitted as fast as possible, frames are dropped but the ones that are
+ * output stay in order */
+static void burst(const struct recording *rec, size_t threads)
+{
+	struct v4l2_mjpeg_pool *pool =
+		v4l2_mjpeg_pool_create(NULL, VIDEO_RANGE_DEFAULT, threads);
+	struct v4l2_mjpeg_stats stats;
+	size_t submitted = 0;
+	size_t accepted = 0;
+
+	assert_non_null(pool);
+	num_outputs = 0;
+
+	for (size_t loop = 0; loop < 10; loop++) {
+		for (size_t i = 0; i < rec->num_frames; i++) {
+			size_t offset = rec->offsets[i];
+			uint64_t ts = (loop * FRAMES + i) * FRAME_NS;
+
+			accepted += v4l2_mjpeg_pool_submit(
+				pool, rec->data + offset,
+				rec->offsets[i + 1] - offset, ts);
+			submitted++;
+		}
+	}
+
+	v4l2_mjpeg_pool_get_stats(pool, &stats);
+	v4l2_mjpeg_pool_destroy(pool);
+
+	printf("burst, %zu threads: ", threads);
+	print_stats(&stats);
+	assert_int_equal(stats.submitted, submitted);
+	assert_int_equal(stats.dropped, submitted - accepted);
+	assert_int_equal(stats.failed, 0);
+	check_outputs(&stats);
+}
+
+/* a broken frame is counted and skipped without holding up the next one */
+static void corrupt_frame(const struct recording *rec, size_t threads)
+{
+	struct v4l2_mjpeg_pool *pool =
+		v4l2_mjpeg_pool_create(NULL, VIDEO_RANGE_DEFAULT, threads);
+	struct v4l2_mjpeg_stats stats;
+	uint8_t garbage[256];
+
+	assert_non_null(pool);
+	num_outputs = 0;
+	memset(garbage, 0x55, sizeof(garbage));
+
+	/* waiting for every frame keeps the decoders from dropping them */
+	assert_true(v4l2_mjpeg_pool_submit(pool, rec->data, rec->offsets[1],
+					   0));
+	v4l2_mjpeg_pool_get_stats(pool, &stats);
+	assert_true(v4l2_mjpeg_pool_submit(pool, garbage, sizeof(garbage),
+					   FRAME_NS));
+	v4l2_mjpeg_pool_get_stats(pool, &stats);
+	assert_true(v4l2_mjpeg_pool_submit(pool, rec->data + rec->offsets[2],
+					   rec->offsets[3] - rec->offsets[2],
+					   2 * FRAME_NS));
+
+	v4l2_mjpeg_pool_get_stats(pool, &stats);
+	v4l2_mjpeg_pool_destroy(pool);
+
+	assert_int_equal(stats.submitted, 3);
+	assert_int_equal(stats.decoded, 2);
+	assert_int_equal(stats.failed, 1);
+	check_outputs(&stats);
+	assert_int_equal(outputs[1].timestamp, 2 * FRAME_NS);
+}
+
+static void device_rate_test(void **state)
+{
+	for (size_t i = 0; i < NUM_THREAD_COUNTS; i++)
+		device_rate(*state, thread_counts[i]);
+}
+
+static void burst_test(void **state)
+{
+	for (size_t i = 0; i < NUM_THREAD_COUNTS; i++)
+		burst(*state, thread_counts[i]);
+}
+
+static void corrupt_frame_test(void **state)
+{
+	for (size_t i = 0; i < NUM_THREAD_COUNTS; i++)
+		corrupt_frame(*state, thread_counts[i]);
+}
+
+static int setup(void **state)
+{
+	struct recording *rec = bzalloc(sizeof(struct recording));
+
+#if LIBAVCODEC_VERSION_INT < AV_VERSION_INT(58, 9, 100)
+	avcodec_register_all();
+#endif
+
+	write_recording();
+	read_recording(rec);
+
+	printf("%zu frames of %dx%d, %zu bytes\n", rec->num_frames, WIDTH,
+	       HEIGHT, rec->size);
+
+	*state = rec;
+	return 0;
+}
+
+static int teardown(void **state)
+{
+	struct recording *rec = *state;
+
+	bfree(rec->data);
+	bfree(rec);
+	os_unlink(TEST_FILE);
+	return 0;
+}
+
+int main()
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(device_rate_test),
+		cmocka_unit_test(burst_test),
+		cmocka_unit_test(corrupt_frame_test),
+	};
+
+	return cmocka_run_group_tests(tests, setup, teardown);
+}
@@ -0,0 +1,571 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <obs.h>
+#include <media-io/video-scaler.h>
+#include <media-io/video-frame.h>
+#include <media-io/format-conversion.h>
+#include <util/threading.h>
+#include <util/platform.h>
+
+struct plane {
+	uint32_t channels;
+	uint32_t shift_x;
+	uint32_t shift_y;
+};
+
+static size_t get_planes(enum video_format format, struct plane *planes)
+{
+	const struct plane luma = {1, 0, 0};
+	const struct plane chroma = {1, 1, 1};
+
+	switch (format) {
+	case VIDEO_FORMAT_Y800:
+		planes[0] = luma;
+		return 1;
+	case VIDEO_FORMAT_NV12:
+		planes[0] = luma;
+		planes[1] = (struct plane){2, 1, 1};
+		return 2;
+	case VIDEO_FORMAT_I420:
+		planes[0] = luma;
+		planes[1] = planes[2] = chroma;
+		return 3;
+	case VIDEO_FORMAT_I444:
+		planes[0] = planes[1] = planes[2] = luma;
+		return 3;
+	case VIDEO_FORMAT_RGBA:
+	case VIDEO_FORMAT_BGRA:
+		planes[0] = (struct plane){4, 0, 0};
+		return 1;
+	default:
+		fail();
+	}
+
+	return 0;
+}
+
+static double weight(enum video_scale_type type, double x)
+{
+	x = fabs(x);
+
+	if (type == VIDEO_SCALE_BICUBIC) {
+		if (x < 1.0)
+			return (1.5 * x - 2.5) * x * x + 1.0;
+		if (x < 2.0)
+			return ((-0.5 * x + 2.5) * x - 4.0) * x + 2.0;
+		return 0.0;
+	}
+
+	return x < 1.0 ? 1.0 - x : 0.0;
+}
+
+/* most source pixels an output pixel can depend on */
+static uint32_t ref_taps(uint32_t src_size, uint32_t dst_size)
+{
+	double scale = (double)src_size / (double)dst_size;
+
+	return (uint32_t)ceil(4.0 * (scale > 1.0 ? scale : 1.0)) + 3;
+}
+
+/* weights of source pixels lo to lo + taps - 1 for output pixel i, pixels
+ * outside of the source are clamped to the edges */
+static uint32_t ref_weights(enum video_scale_type type, uint32_t i,
+			    uint32_t src_size, uint32_t dst_size, double *w)
+{
+	double scale = (double)src_size / (double)dst_size;
+	double stretch = scale > 1.0 ? scale : 1.0;
+	double center = ((double)i + 0.5) * scale - 0.5;
+	double radius = type == VIDEO_SCALE_BICUBIC ? 2.0 : 1.0;
+	uint32_t taps = ref_taps(src_size, dst_size);
+	long first = (long)floor(center - radius * stretch);
+	long last = (long)ceil(center + radius * stretch);
+	long lo = first < 0 ? 0 : first;
+	double total = 0.0;
+
+	if (type == VIDEO_SCALE_POINT) {
+		first = last = (long)floor(center + 0.5);
+		lo = first < 0 ? 0 : first;
+	} else if (type == VIDEO_SCALE_AREA && scale > 1.0) {
+		first = (long)floor((double)i * scale);
+		last = (long)ceil((double)(i + 1) * scale);
+		lo = first;
+	}
+
+	if (lo + (long)taps > (long)src_size)
+		lo = (long)src_size > (long)taps ? (long)(src_size - taps) : 0;
+
+	for (uint32_t k = 0; k < taps; k++)
+		w[k] = 0.0;
+
+	for (long k = first; k <= last; k++) {
+		long idx = k < 0 ? 0 : (k >= (long)src_size ? src_size - 1 : k);
+		double val;
+
+		if (type == VIDEO_SCALE_POINT) {
+			val = 1.0;
+		} else if (type == VIDEO_SCALE_AREA && scale > 1.0) {
+			double begin = (double)i * scale;
+			double a = fmax(begin, (double)k);
+			double b = fmin(begin + scale, (double)k + 1.0);
+			val = b > a ? b - a : 0.0;
+		} else {
+			val = weight(type, ((double)k - center) / stretch);
+		}
+
+		assert_true(idx >= lo && idx < lo + (long)taps);
+		w[idx - lo] += val;
+		total += val;
+	}
+
+	for (uint32_t k = 0; k < taps; k++)
+		w[k] /= total;
+
+	return (uint32_t)lo;
+}
+
+/* separable scaling in double precision */
+static void ref_scale_plane(enum video_scale_type type, const uint8_t *src,
+			    uint32_t src_linesize, uint32_t sw, uint32_t sh,
+			    uint8_t *dst, uint32_t dst_linesize, uint32_t dw,
+			    uint32_t dh, uint32_t channels)
+{
+	uint32_t v_taps = ref_taps(sh, dh);
+	uint32_t h_taps = ref_taps(sw, dw);
+	double *tmp = bmalloc(sizeof(double) * sw * channels * dh);
+	double *w = bmalloc(sizeof(double) * (v_taps > h_taps ? v_taps
+							      : h_taps));
+
+	for (uint32_t y = 0; y < dh; y++) {
+		uint32_t lo = ref_weights(type, y, sh, dh, w);
+
+		for (uint32_t x = 0; x < sw * channels; x++) {
+			double sum = 0.0;
+
+			for (uint32_t k = 0; k < v_taps && lo + k < sh; k++)
+				sum += w[k] * src[(lo + k) * src_linesize + x];
+			tmp[y * sw * channels + x] = sum;
+		}
+	}
+
+	for (uint32_t x = 0; x < dw; x++) {
+		uint32_t lo = ref_weights(type, x, sw, dw, w);
+
+		for (uint32_t y = 0; y < dh; y++) {
+			const double *row = tmp + y * sw * channels;
+
+			for (uint32_t c = 0; c < channels; c++) {
+				double sum = 0.0;
+
+				for (uint32_t k = 0; k < h_taps && lo + k < sw;
+				     k++)
+					sum += w[k] * row[(lo + k) * channels +
+							  c];
+
+				sum = floor(sum + 0.5);
+				dst[y * dst_linesize + x * channels + c] =
+					(uint8_t)(sum < 0.0     ? 0
+						  : sum > 255.0 ? 255
+								: sum);
+			}
+		}
+	}
+
+	bfree(tmp);
+	bfree(w);
+}
+
+static void fill_frame(struct video_frame *frame, enum video_format format,
+		       uint32_t width, uint32_t height, bool noise)
+{
+	struct plane planes[MAX_AV_PLANES];
+	size_t num_planes = get_planes(format, planes);
+
+	video_frame_init(frame, format, width, height);
+
+	for (size_t i = 0; i < num_planes; i++) {
+		uint32_t w = (width >> planes[i].shift_x) * planes[i].channels;
+		uint32_t h = height >> planes[i].shift_y;
+
+		for (uint32_t y = 0; y < h; y++) {
+			uint8_t *row = frame->data[i] + y * frame->linesize[i];
+
+			/* smooth gradients, plus noise to catch lost taps */
+			for (uint32_t x = 0; x < w; x++)
+				row[x] = (uint8_t)((x * 160 / w + y * 80 / h +
+						    i * 7) +
+						   (noise ? rand() % 16 : 0));
+		}
+	}
+}
+
+static video_scaler_t *create(enum video_format format, uint32_t sw,
+			      uint32_t sh, uint32_t dw, uint32_t dh,
+			      enum video_scale_type type,
+			      enum video_scaler_impl impl)
+{
+	struct video_scale_info src = {format, sw, sh, VIDEO_RANGE_PARTIAL,
+				       VIDEO_CS_709};
+	struct video_scale_info dst = {format, dw, dh, VIDEO_RANGE_PARTIAL,
+				       VIDEO_CS_709};
+	video_scaler_t *scaler = NULL;
+
+	assert_int_equal(video_scaler_create2(&scaler, &dst, &src, type, impl),
+			 VIDEO_SCALER_SUCCESS);
+	return scaler;
+}
+
+static void check_reference(enum video_format format, uint32_t sw,
+			    uint32_t sh, uint32_t dw, uint32_t dh,
+			    enum video_scale_type type)
+{
+	struct plane planes[MAX_AV_PLANES];
+	size_t num_planes = get_planes(format, planes);
+	video_scaler_t *scaler = create(format, sw, sh, dw, dh, type,
+					VIDEO_SCALER_IMPL_NATIVE);
+	struct video_frame in, out, ref;
+
+	fill_frame(&in, format, sw, sh, true);
+	video_frame_init(&out, format, dw, dh);
+	video_frame_init(&ref, format, dw, dh);
+
+	assert_true(video_scaler_scale(scaler, out.data, out.linesize,
+				       (const uint8_t *const *)in.data,
+				       in.linesize));
+
+	for (size_t i = 0; i < num_planes; i++) {
+		struct plane *p = &planes[i];
+		uint32_t w = dw >> p->shift_x;
+		uint32_t h = dh >> p->shift_y;
+
+		ref_scale_plane(type, in.data[i], in.linesize[i],
+				sw >> p->shift_x, sh >> p->shift_y,
+				ref.data[i], ref.linesize[i], w, h,
+				p->channels);
+
+		for (uint32_t y = 0; y < h; y++) {
+			const uint8_t *a = out.data[i] + y * out.linesize[i];
+			const uint8_t *b = ref.data[i] + y * ref.linesize[i];
+
+			for (uint32_t x = 0; x < w * p->channels; x++)
+				assert_in_range(a[x], b[x] > 0 ? b[x] - 1 : 0,
+						b[x] + 1);
+		}
+	}
+
+	video_frame_free(&in);
+	video_frame_free(&out);
+	video_frame_free(&ref);
+	video_scaler_destroy(scaler);
+}
+
+/* the native scaler against the reference, with enough output rows for
+ * several slices in the larger cases */
+static void native_reference_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+	const enum video_scale_type types[] = {
+		VIDEO_SCALE_POINT,
+		VIDEO_SCALE_BILINEAR,
+		VIDEO_SCALE_BICUBIC,
+		VIDEO_SCALE_AREA,
+	};
+
+	for (size_t i = 0; i < sizeof(types) / sizeof(types[0]); i++) {
+		enum video_scale_type type = types[i];
+
+		check_reference(VIDEO_FORMAT_Y800, 640, 360, 1280, 720, type);
+		check_reference(VIDEO_FORMAT_Y800, 1280, 720, 426, 240, type);
+		check_reference(VIDEO_FORMAT_I420, 1920, 1080, 1280, 720, type);
+		check_reference(VIDEO_FORMAT_I420, 854, 480, 1922, 1082, type);
+		check_reference(VIDEO_FORMAT_NV12, 1280, 720, 852, 480, type);
+		check_reference(VIDEO_FORMAT_I444, 333, 251, 97, 61, type);
+		check_reference(VIDEO_FORMAT_RGBA, 1280, 720, 1920, 1080, type);
+		check_reference(VIDEO_FORMAT_BGRA, 1920, 1080, 637, 359, type);
+	}
+}
+
+/* the native scaler against swscale on smooth content, where both have to
+ * agree up to small rounding and chroma siting differences */
+static void check_swscale(enum video_format format, uint32_t sw, uint32_t sh,
+			  uint32_t dw, uint32_t dh)
+{
+	struct plane planes[MAX_AV_PLANES];
+	size_t num_planes = get_planes(format, planes);
+	video_scaler_t *native = create(format, sw, sh, dw, dh,
+					VIDEO_SCALE_BILINEAR,
+					VIDEO_SCALER_IMPL_NATIVE);
+	video_scaler_t *swscale = create(format, sw, sh, dw, dh,
+					 VIDEO_SCALE_BILINEAR,
+					 VIDEO_SCALER_IMPL_SWSCALE);
+	struct video_frame in, a, b;
+
+	fill_frame(&in, format, sw, sh, false);
+	video_frame_init(&a, format, dw, dh);
+	video_frame_init(&b, format, dw, dh);
+
+	assert_true(video_scaler_scale(native, a.data, a.linesize,
+				       (const uint8_t *const *)in.data,
+				       in.linesize));
+	assert_true(video_scaler_scale(swscale, b.data, b.linesize,
+				       (const uint8_t *const *)in.data,
+				       in.linesize));
+
+	for (size_t i = 0; i < num_planes; i++) {
+		struct plane *p = &planes[i];
+		uint32_t w = (dw >> p->shift_x) * p->channels;
+		uint32_t h = dh >> p->shift_y;
+		uint64_t total = 0;
+
+		for (uint32_t y = 0; y < h; y++) {
+			for (uint32_t x = 0; x < w; x++) {
+				int diff = a.data[i][y * a.linesize[i] + x] -
+					   b.data[i][y * b.linesize[i] + x];
+
+				assert_true(abs(diff) <= 16);
+				total += (uint64_t)abs(diff);
+			}
+		}
+
+		assert_true(total <= (uint64_t)w * h);
+	}
+
+	video_frame_free(&in);
+	video_frame_free(&a);
+	video_frame_free(&b);
+	video_scaler_destroy(native);
+	video_scaler_destroy(swscale);
+}
+
+static void native_swscale_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	check_swscale(VIDEO_FORMAT_I420, 1920, 1080, 1280, 720);
+	check_swscale(VIDEO_FORMAT_I420, 1280, 720, 1920, 1080);
+	check_swscale(VIDEO_FORMAT_NV12, 2560, 1440, 1920, 1080);
+	check_swscale(VIDEO_FORMAT_RGBA, 1920, 1080, 1280, 720);
+}
+
+/* video_scaler_create only uses the native scaler if asked to */
+static void default_impl_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+	struct video_scale_info src = {VIDEO_FORMAT_I420, 1920, 1080,
+				       VIDEO_RANGE_PARTIAL, VIDEO_CS_709};
+	struct video_scale_info dst = {VIDEO_FORMAT_I420, 1280, 720,
+				       VIDEO_RANGE_PARTIAL, VIDEO_CS_709};
+	video_scaler_t *def = NULL;
+	video_scaler_t *swscale = create(VIDEO_FORMAT_I420, 1920, 1080, 1280,
+					 720, VIDEO_SCALE_BICUBIC,
+					 VIDEO_SCALER_IMPL_SWSCALE);
+	struct video_frame in, a, b;
+
+	assert_int_equal(video_scaler_create(&def, &dst, &src,
+					     VIDEO_SCALE_BICUBIC),
+			 VIDEO_SCALER_SUCCESS);
+
+	fill_frame(&in, VIDEO_FORMAT_I420, 1920, 1080, true);
+	video_frame_init(&a, VIDEO_FORMAT_I420, 1280, 720);
+	video_frame_init(&b, VIDEO_FORMAT_I420, 1280, 720);
+
+	assert_true(video_scaler_scale(def, a.data, a.linesize,
+				       (const uint8_t *const *)in.data,
+				       in.linesize));
+	assert_true(video_scaler_scale(swscale, b.data, b.linesize,
+				       (const uint8_t *const *)in.data,
+				       in.linesize));
+
+	for (uint32_t y = 0; y < 720; y++)
+		assert_memory_equal(a.data[0] + y * a.linesize[0],
+				    b.data[0] + y * b.linesize[0], 1280);
+
+	video_frame_free(&in);
+	video_frame_free(&a);
+	video_frame_free(&b);
+	video_scaler_destroy(def);
+	video_scaler_destroy(swscale);
+
+	/* conversions the native scaler can't do fail instead of falling
+	 * back to swscale */
+	src.format = VIDEO_FORMAT_YUY2;
+	assert_int_equal(video_scaler_create2(&def, &dst, &src,
+					      VIDEO_SCALE_BILINEAR,
+					      VIDEO_SCALER_IMPL_NATIVE),
+			 VIDEO_SCALER_BAD_CONVERSION);
+}
+
+/* conversions between formats of the same size are done in slices, which
+ * has to give the same result as converting the whole frame at once */
+static void check_convert(enum video_format src_format,
+			  enum video_format dst_format, uint32_t w, uint32_t h)
+{
+	struct video_scale_info src = {src_format, w, h, VIDEO_RANGE_PARTIAL,
+				       VIDEO_CS_709};
+	struct video_scale_info dst = {dst_format, w, h, VIDEO_RANGE_PARTIAL,
+				       VIDEO_CS_709};
+	video_format_convert_t convert =
+		video_format_get_convert(src_format, dst_format);
+	struct plane planes[MAX_AV_PLANES];
+	size_t num_planes = get_planes(dst_format, planes);
+	video_scaler_t *scaler = NULL;
+	struct video_frame in, a, b;
+
+	assert_non_null(convert);
+	assert_int_equal(video_scaler_create(&scaler, &dst, &src,
+					     VIDEO_SCALE_BILINEAR),
+			 VIDEO_SCALER_SUCCESS);
+
+	fill_frame(&in, src_format, w, h, true);
+	video_frame_init(&a, dst_format, w, h);
+	video_frame_init(&b, dst_format, w, h);
+
+	assert_true(video_scaler_scale(scaler, a.data, a.linesize,
+				       (const uint8_t *const *)in.data,
+				       in.linesize));
+	convert((const uint8_t *const *)in.data, in.linesize, w, 0, h, b.data,
+		b.linesize);
+
+	for (size_t i = 0; i < num_planes; i++) {
+		uint32_t row = (w >> planes[i].shift_x) * planes[i].channels;
+
+		for (uint32_t y = 0; y < h >> planes[i].shift_y; y++)
+			assert_memory_equal(a.data[i] + y * a.linesize[i],
+					    b.data[i] + y * b.linesize[i], row);
+	}
+
+	video_frame_free(&in);
+	video_frame_free(&a);
+	video_frame_free(&b);
+	video_scaler_destroy(scaler);
+}
+
+static void convert_slices_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	check_convert(VIDEO_FORMAT_NV12, VIDEO_FORMAT_I420, 1920, 1080);
+	check_convert(VIDEO_FORMAT_I420, VIDEO_FORMAT_NV12, 1920, 1080);
+
+	/* slices of uneven size, and a frame too small to be split */
+	check_convert(VIDEO_FORMAT_NV12, VIDEO_FORMAT_I420, 1280, 722);
+	check_convert(VIDEO_FORMAT_I420, VIDEO_FORMAT_NV12, 64, 100);
+}
+
+struct received {
+	os_event_t *event;
+	struct video_frame frame;
+};
+
+static void receive_video(void *param, struct video_data *data)
+{
+	struct received *received = param;
+	struct video_frame frame;
+
+	memcpy(frame.data, data->data, sizeof(frame.data));
+	memcpy(frame.linesize, data->linesize, sizeof(frame.linesize));
+	video_frame_copy(&received->frame, &frame, VIDEO_FORMAT_I420, 32);
+	os_event_signal(received->event);
+}
+
+/* video inputs are scaled with the scaler they ask for, and fall back to
+ * the default one if the native scaler can't do the conversion */
+static void output_scaler_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+	struct video_output_info voi = {
+		.name = "test",
+		.format = VIDEO_FORMAT_I420,
+		.fps_num = 30,
+		.fps_den = 1,
+		.width = 64,
+		.height = 64,
+		.cache_size = 4,
+		.colorspace = VIDEO_CS_709,
+		.range = VIDEO_RANGE_PARTIAL,
+	};
+	struct video_scale_info conversion = {VIDEO_FORMAT_I420, 32, 32,
+					      VIDEO_RANGE_PARTIAL, VIDEO_CS_709,
+					      VIDEO_SCALER_IMPL_NATIVE};
+	video_scaler_t *native = create(VIDEO_FORMAT_I420, 64, 64, 32, 32,
+					VIDEO_SCALE_FAST_BILINEAR,
+					VIDEO_SCALER_IMPL_NATIVE);
+	struct received received;
+	struct video_frame in, frame, ref;
+	video_t *video;
+
+	assert_int_equal(os_event_init(&received.event, OS_EVENT_TYPE_AUTO),
+			 0);
+	assert_int_equal(video_output_open(&video, &voi), VIDEO_OUTPUT_SUCCESS);
+
+	fill_frame(&in, VIDEO_FORMAT_I420, 64, 64, true);
+	video_frame_init(&received.frame, VIDEO_FORMAT_I420, 32, 32);
+	video_frame_init(&ref, VIDEO_FORMAT_I420, 32, 32);
+
+	assert_true(video_output_connect(video, &conversion, receive_video,
+					 &received));
+	assert_true(video_output_lock_frame(video, &frame, 1, os_gettime_ns()));
+	video_frame_copy(&frame, &in, VIDEO_FORMAT_I420, 64);
+	video_output_unlock_frame(video);
+	assert_int_equal(os_event_timedwait(received.event, 5000), 0);
+	video_output_disconnect(video, receive_video, &received);
+
+	assert_true(video_scaler_scale(native, ref.data, ref.linesize,
+				       (const uint8_t *const *)in.data,
+				       in.linesize));
+
+	for (size_t i = 0; i < 3; i++) {
+		uint32_t size = i ? 16 : 32;
+
+		for (uint32_t y = 0; y < size; y++)
+			assert_memory_equal(
+				received.frame.data[i] +
+					y * received.frame.linesize[i],
+				ref.data[i] + y * ref.linesize[i], size);
+	}
+
+	conversion.colorspace = VIDEO_CS_601;
+	assert_true(video_output_connect(video, &conversion, receive_video,
+					 &received));
+	video_output_disconnect(video, receive_video, &received);
+
+	video_output_close(video);
+	video_frame_free(&in);
+	video_frame_free(&received.frame);
+	video_frame_free(&ref);
+	video_scaler_destroy(native);
+	os_event_destroy(received.event);
+}
+
+/* the video output thread and the native scaler need the libobs core */
+static int setup(void **state)
+{
+	UNUSED_PARAMETER(state);
+	return obs_startup("en-US", NULL, NULL) ? 0 : -1;
+}
+
+static int teardown(void **state)
+{
+	UNUSED_PARAMETER(state);
+	obs_shutdown();
+	return 0;
+}
+
+int main()
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(native_reference_test),
+		cmocka_unit_test(native_swscale_test),
+		cmocka_unit_test(default_impl_test),
+		cmocka_unit_test(convert_slices_test),
+		cmocka_unit_test(output_scaler_test),
+	};
+
+	return cmocka_run_group_tests(tests, setup, teardown);
+}